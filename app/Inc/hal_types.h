@@ -33,13 +33,46 @@ typedef enum
   HAL_UART_STATE_ERROR             = 0xE0U
 } HAL_UART_StateTypeDef;
 
+typedef uint32_t HAL_UART_RxEventTypeTypeDef;
+
+typedef struct
+{
+  uint32_t WakeUpEvent;
+  uint16_t AddressLength;
+  uint8_t Address;
+} UART_WakeUpTypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0U,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
 // Handle typedefs (opaque)
 typedef struct SMBUS_HandleTypeDef SMBUS_HandleTypeDef;
 typedef struct UART_HandleTypeDef UART_HandleTypeDef;
+typedef struct SPI_HandleTypeDef SPI_HandleTypeDef;
+typedef struct GPIO_TypeDef GPIO_TypeDef;
 
 // Constants
 #define SMBUS_FIRST_AND_LAST_FRAME_NO_PEC  0x00020000U
 
+#define HAL_UART_RXEVENT_TC                0x00000000U
+#define HAL_UART_RXEVENT_HT                0x00000001U
+#define HAL_UART_RXEVENT_IDLE              0x00000002U
+
+#define HAL_UART_ERROR_NONE                0x00000000U
+#define HAL_UART_ERROR_FE                  0x00000004U
+#define HAL_UART_ERROR_ORE                 0x00000008U
+
+#define UART_WAKEUP_ON_ADDRESS             0x00000000U
+#define UART_WAKEUP_ON_STARTBIT            0x00200000U
+#define UART_WAKEUP_ON_READDATA_NONEMPTY   0x00300000U
+#define UART_ADDRESS_DETECT_4B             0x00000000U
+#define UART_ADDRESS_DETECT_7B             0x00000010U
+#define UART_WAKEUPMETHOD_ADDRESSMARK      0x00000800U
+#define UART_DE_POLARITY_HIGH              0x00000000U
+
 #endif /* HAL_MODULE_ENABLED */
 
 // ===============================
@@ -52,12 +85,110 @@ extern UART_HandleTypeDef huart2;
 
 // HAL functions - platform will provide implementations
 HAL_StatusTypeDef HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbus, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_SMBUS_DeInit(SMBUS_HandleTypeDef *hsmbus);
+HAL_StatusTypeDef HAL_SMBUS_Init(SMBUS_HandleTypeDef *hsmbus);
 HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
 HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
 HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart);
+uint32_t HAL_UART_GetError(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_UART_RxEventTypeTypeDef HAL_UARTEx_GetRxEventType(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig(UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection);
+HAL_StatusTypeDef HAL_UARTEx_EnableStopMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_DisableStopMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_RS485Ex_Init(UART_HandleTypeDef *huart, uint32_t Polarity, uint32_t AssertionTime, uint32_t DeassertionTime);
+HAL_StatusTypeDef HAL_MultiProcessor_Init(UART_HandleTypeDef *huart, uint8_t Address, uint32_t WakeUpMethod);
+HAL_StatusTypeDef HAL_MultiProcessorEx_AddressLength_Set(UART_HandleTypeDef *huart, uint32_t AddressLength);
+HAL_StatusTypeDef HAL_MultiProcessor_EnableMuteMode(UART_HandleTypeDef *huart);
+void HAL_MultiProcessor_EnterMuteMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+uint32_t HAL_RCC_GetHCLKFreq(void);
 
 // FreeRTOS functions - platform will provide implementations
 void HAL_Delay_MS(uint32_t ms);
+uint32_t HAL_GetTick(void);
+uint32_t HAL_GetIdleCycles(void);              // Cycle counter time spent in the idle task, wraps
+const char *HAL_TaskName(const void *task);     // Name of a task handle, "isr" for NULL
+
+// Worker tasks - platform maps them to RTOS tasks with a notification each
+HAL_StatusTypeDef HAL_WorkerCreate(void (*entry)(void *arg), void *arg, const char *name,
+                                   uint32_t stackWords, uint32_t priority, void **handle);
+void HAL_WorkerNotify(void *handle);            // Safe from tasks and interrupts
+void HAL_WorkerWait(uint32_t timeoutMs);        // Blocks the calling worker until notified, 0xFFFFFFFF waits forever
+
+// Task control for CPU budgets - handles are RTOS tasks, priorities are above idle like the workers'
+uint32_t HAL_TaskRunTime(void *task);           // Run-time stats counter of the task, wraps
+uint32_t HAL_TaskGetPriority(void *task);
+void HAL_TaskSetPriority(void *task, uint32_t priority);
+void HAL_TaskSuspend(void *task);
+void HAL_TaskResume(void *task);
+
+// Low-power and timing functions - platform will provide implementations
+void HAL_EnterStopMode(uint32_t depth);
+void HAL_ExitStopMode(uint32_t depth);
+void HAL_EnableCycleCounter(void);
+uint32_t HAL_GetCycleCount(void);
+
+// Clock and power domain gating - platform maps app identifiers to RCC/PWR bits
+void HAL_PeriphClockEnable(uint32_t clock);
+void HAL_PeriphClockDisable(uint32_t clock);
+void HAL_PowerDomainEnable(uint32_t domain);
+void HAL_PowerDomainDisable(uint32_t domain);
+
+// SPI per-device setup - platform reprograms prescaler, CPOL/CPHA and DMA for the handle
+HAL_StatusTypeDef HAL_SPI_SetDeviceConfig(SPI_HandleTypeDef *hspi, uint32_t clockHz, uint8_t mode);
+
+// UART rate control - platform reprograms BRR with the USART disabled and reports its kernel clock
+HAL_StatusTypeDef HAL_UART_SetBaudRate(UART_HandleTypeDef *huart, uint32_t baudRate);
+uint32_t HAL_UART_GetKernelClockFreq(UART_HandleTypeDef *huart);
+
+// Interrupt masking - platform will provide implementations
+uint32_t HAL_CriticalEnter(void);
+void HAL_CriticalExit(uint32_t state);
+
+// External NOR command descriptor - platform translates it to OCTOSPI (U5) or QUADSPI (H7) commands
+typedef struct
+{
+  uint8_t Instruction;
+  uint8_t AddressBytes;       // 0 = no address phase
+  uint8_t DummyCycles;
+  uint8_t DataLines;          // 0 = no data phase, otherwise 1, 2, 4 or 8
+  uint32_t Address;
+  uint32_t DataSize;
+} XSPI_NorCommandTypeDef;
+
+// External NOR bus functions - platform will provide implementations
+// Data phases use DMA; the calling task blocks until the transfer completes
+HAL_StatusTypeDef HAL_XSPI_NorCommand(const XSPI_NorCommandTypeDef *cmd);
+HAL_StatusTypeDef HAL_XSPI_NorRead(const XSPI_NorCommandTypeDef *cmd, uint8_t *pData);
+HAL_StatusTypeDef HAL_XSPI_NorWrite(const XSPI_NorCommandTypeDef *cmd, const uint8_t *pData);
+HAL_StatusTypeDef HAL_XSPI_NorWaitReady(uint8_t statusInstruction, uint8_t busyMask, uint32_t timeoutMs);
+HAL_StatusTypeDef HAL_XSPI_NorMemoryMapped(const XSPI_NorCommandTypeDef *readCmd, const uint8_t **mappedBase);
+HAL_StatusTypeDef HAL_XSPI_NorAbort(void);
+void HAL_XSPI_NorInvalidateCache(const uint8_t *address, uint32_t size);
+
+// Internal flash functions - platform maps them to the FLASH controller
+// Programs block until done. An erase only starts; the CPU keeps running
+// unless it reads the bank being erased, which stalls until the erase ends.
+HAL_StatusTypeDef HAL_FLASH_ProgramUnit(uint32_t address, const uint8_t *pData);   // Smallest program (U5 quad-word)
+HAL_StatusTypeDef HAL_FLASH_ProgramRow(uint32_t address, const uint8_t *pData);    // Fast row (U5 burst, G4 fast programming)
+HAL_StatusTypeDef HAL_FLASH_EraseStart(uint32_t address);                          // Page containing the address
+HAL_StatusTypeDef HAL_FLASH_EraseStatus(void);                                     // HAL_BUSY while erasing, then the result
+uint32_t HAL_FLASH_CodeBank(void);                                                 // Bank, by address, the application runs from
+
+// Microsecond timer - platform runs a free-running 32-bit counter at 1 MHz with one
+// compare channel (U5: TIM2) and calls usTimerCompareIrq from its compare interrupt
+HAL_StatusTypeDef HAL_UsTimerStart(void);
+uint32_t HAL_UsTimerNow(void);
+void HAL_UsTimerSetCompare(uint32_t deadline);  // Arms the compare interrupt
+void HAL_UsTimerDisableCompare(void);
+void HAL_UsTimerForce(void);                    // Raises the compare interrupt now
 
 #ifdef __cplusplus
 }
@@ -5,13 +5,66 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
+typedef enum
+{
+    LOG_DEBUG = 0,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR
+} LogLevel;
+
+/**
+ * @brief Second output for records, called from logWrite outside the lock
+ * @param text Record text, not terminated
+ */
+typedef void (*LogSinkFn)(LogLevel level, const char *text, size_t length);
+
 /**
  * @brief Initialize logging system with SEGGER RTT and display startup banner
  */
 void initLogging(void);
 
+/**
+ * @brief Queue a formatted record for RTT, call from tasks
+ *
+ * Records are buffered whole and written to RTT only when they fit, so RTT
+ * never skips part of one. A call writes out at most a few hundred bytes
+ * of the backlog, with interrupts masked only while a record is queued or
+ * taken off the queue. Each level keeps headroom the levels below it
+ * cannot use, and when space is short debug and info records are evicted
+ * before anything is refused: errors get through a flood of chatter. What
+ * was shed is summarized once the backlog has drained.
+ *
+ * @param level Severity, records below the current level are discarded
+ * @param format printf-style format
+ */
+void logWrite(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Move queued records to RTT as space allows, call from task loops
+ * @note  Writes a few hundred bytes at most per call, a long backlog takes several
+ */
+void logFlush(void);
+
+/**
+ * @brief Copy every record that passes the level filter to a second output, NULL for none
+ */
+void logSetSink(LogSinkFn sink);
+
+/**
+ * @brief Set the lowest level recorded, the overload controller may raise it further
+ */
+void logSetLevel(LogLevel level);
+
+/**
+ * @brief Lowest level currently recorded
+ */
+LogLevel logGetLevel(void);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif /* LOGGING_H */
\ No newline at end of file
+#endif /* LOGGING_H */
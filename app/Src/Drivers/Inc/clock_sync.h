@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file           : clock_sync.h
+  * @brief          : Wall-clock time from the host over the framed UART link
+  ******************************************************************************
+  * The device keeps a 64-bit microsecond clock since boot, extended from
+  * the cycle counter, and asks the host for its time with the four-stamp
+  * exchange of time_sync.h: every 2 s until eight exchanges are done and
+  * the clock is synced, then every 16 s. Requests leave only on an idle
+  * transmitter and responses are stamped with the receive event that
+  * completed them, so the stamps are taken on the wire, not in the task.
+  *
+  * The host answers with its wall clock in microseconds since the Unix
+  * epoch; the disciplined clock maps any local time to it, so logs can be
+  * aligned with host logs and with other devices.
+  ******************************************************************************
+  */
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+typedef struct
+{
+    uint32_t requests;
+    uint32_t responses;         // Matching the outstanding request
+    uint32_t timeouts;          // Requests without a response
+    uint32_t accepted;          // Responses the filter picked
+    uint32_t steps;
+    int32_t lastCorrectionUs;
+    uint32_t delayUs;           // Round trip of the last exchange
+    uint32_t minDelayUs;
+    int32_t driftPpb;
+    uint32_t jitterUs;
+    uint8_t synced;
+} ClockSyncStats;
+
+/**
+ * @brief Microseconds since boot
+ * @note  Any context; call at least every few seconds so the cycle counter cannot wrap unseen
+ */
+uint64_t clockSyncLocalUs(void);
+
+/**
+ * @brief Local time of a cycle counter value taken in the last few seconds
+ */
+uint64_t clockSyncCyclesToLocalUs(uint32_t cycles);
+
+/**
+ * @brief Send the next request when it is due
+ * @note  Call from the task that polls the UART link
+ */
+void clockSyncPoll(void);
+
+/**
+ * @brief Handle a time sync frame received by the link
+ * @param rxCycles Cycle counter at the receive event that completed the frame
+ */
+void clockSyncHandleFrame(const uint8_t *payload, uint16_t length, uint32_t rxCycles);
+
+/**
+ * @retval 1 once the host time is known, 0 otherwise
+ */
+int clockSyncIsSynced(void);
+
+/**
+ * @brief Host wall-clock time now, microseconds since the Unix epoch
+ * @retval 0 until synced
+ */
+uint64_t clockSyncWallUs(void);
+
+/**
+ * @brief Wall-clock time of a local time, 0 until synced
+ */
+uint64_t clockSyncToWallUs(uint64_t localUs);
+
+/**
+ * @brief Copy the synchronisation statistics
+ * @param stats Destination
+ */
+void clockSyncGetStats(ClockSyncStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_SYNC_H */
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file           : cpu_budget.h
+  * @brief          : Per-task CPU budgets with throttling
+  ******************************************************************************
+  * Tasks sharing a priority and relying on voluntary delays give no timing
+  * isolation: one that stops yielding starves its peers. This service
+  * gives each registered task a share of every replenishment period and
+  * charges it the run-time stats counter (cycles) the kernel keeps for the
+  * task. A monitor task above every application task checks the accounts a
+  * few times per period; since a context switch updates the counter of the
+  * task switched out, waking the monitor is enough to read a busy task's
+  * figure. While none of the accounted tasks runs the monitor wakes once
+  * per period only, so tickless idle keeps its long sleeps.
+  *
+  * A task over budget is demoted one level below its base priority, never
+  * under CPU_BUDGET_DEMOTE_FLOOR, or suspended until a replenishment
+  * leaves it budget again (see budget_ledger.h for the carry-over of
+  * overruns). Demotion keeps the task above the idle task, so it still
+  * runs whenever its peers block and tickless idle cannot starve it.
+  *
+  * Demotion only lowers the base priority. A demoted task that holds a
+  * mutex a higher task waits for keeps the priority it inherited until it
+  * gives the mutex back, so the waiter is not held up behind the penalty;
+  * the base priority is restored on replenishment. Suspension freezes any
+  * lock the task holds, so it suits tasks that do not share mutexes;
+  * demotion is the safer default. Violations are counted per task for the
+  * telemetry log.
+  ******************************************************************************
+  */
+
+#ifndef CPU_BUDGET_H
+#define CPU_BUDGET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define CPU_BUDGET_MAX_TASKS    8U
+
+#ifndef CPU_BUDGET_DEMOTE_FLOOR
+#define CPU_BUDGET_DEMOTE_FLOOR 1U      // Lowest priority a demotion goes to, above idle
+#endif
+
+typedef enum
+{
+    CPU_BUDGET_MONITOR = 0,     // Account only
+    CPU_BUDGET_DEMOTE,          // Drop one level, not under the floor, until replenished
+    CPU_BUDGET_SUSPEND          // Stop until replenished
+} CpuBudgetAction;
+
+typedef struct
+{
+    const char *name;
+    uint32_t budgetPermille;    // Share of the period
+    uint32_t lastPermille;      // Share used in the last period
+    uint32_t peakPermille;
+    uint32_t violations;
+    uint32_t throttledPeriods;
+    uint8_t throttled;
+} CpuBudgetTaskStats;
+
+/**
+ * @brief Start the monitor task
+ * @param periodMs Replenishment period
+ * @param checkMs Interval between checks, bounds how far a task overruns before it is throttled
+ * @retval HAL status
+ */
+HAL_StatusTypeDef cpuBudgetInit(uint32_t periodMs, uint32_t checkMs);
+
+/**
+ * @brief Give a task a budget, charged from now
+ * @param task RTOS task handle
+ * @param name Task name for the statistics, kept by reference
+ * @param budgetPermille Share of each period, 0 to account only
+ * @param action Penalty once the budget is exceeded
+ * @retval HAL_ERROR if the table is full or the task already has a budget
+ */
+HAL_StatusTypeDef cpuBudgetRegister(void *task, const char *name, uint32_t budgetPermille, CpuBudgetAction action);
+
+/**
+ * @brief Change the budget of a registered task, from the next check on
+ * @retval HAL_ERROR if the task has no budget
+ */
+HAL_StatusTypeDef cpuBudgetSet(void *task, uint32_t budgetPermille);
+
+/**
+ * @brief Copy the per-task statistics
+ * @param stats Destination
+ * @param max Entries available
+ * @retval Entries written
+ */
+uint32_t cpuBudgetGetStats(CpuBudgetTaskStats *stats, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPU_BUDGET_H */
@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file           : hal_callbacks.h
+  * @brief          : Routing of HAL completion callbacks to app drivers
+  ******************************************************************************
+  */
+
+#ifndef HAL_CALLBACKS_H
+#define HAL_CALLBACKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+/* Maximum number of UART / SPI / SMBus handles that can have callbacks registered */
+#define HAL_CALLBACKS_MAX_UART  4U
+#define HAL_CALLBACKS_MAX_SPI   2U
+#define HAL_CALLBACKS_MAX_SMBUS 1U
+
+/**
+ * @brief Per-handle UART callbacks, any member may be NULL
+ * @note  All callbacks run in interrupt context
+ */
+typedef struct
+{
+    void (*rxEvent)(void *ctx, uint16_t size);
+    void (*wakeup)(void *ctx);
+    void (*error)(void *ctx);
+    void (*txComplete)(void *ctx);
+} HalUartCallbacks;
+
+/**
+ * @brief Per-handle SPI callbacks, any member may be NULL
+ * @note  All callbacks run in interrupt context; transfer complete covers
+ *        transmit-only, receive-only and full-duplex transfers
+ */
+typedef struct
+{
+    void (*transferComplete)(void *ctx);
+    void (*error)(void *ctx);
+} HalSpiCallbacks;
+
+/**
+ * @brief Per-handle SMBus master callbacks, any member may be NULL
+ * @note  All callbacks run in interrupt context
+ */
+typedef struct
+{
+    void (*transmitComplete)(void *ctx);
+    void (*error)(void *ctx);
+} HalSmbusCallbacks;
+
+/**
+ * @brief Route the HAL callbacks of a UART handle to a driver
+ * @param huart UART handle the callbacks belong to
+ * @param callbacks Callback table, must stay valid while registered
+ * @param ctx Driver context passed back to every callback
+ * @retval HAL_OK on success, HAL_ERROR if the table is full
+ */
+HAL_StatusTypeDef halUartRegisterCallbacks(UART_HandleTypeDef *huart, const HalUartCallbacks *callbacks, void *ctx);
+
+/**
+ * @brief Stop routing the HAL callbacks of a UART handle
+ * @param huart UART handle to unregister
+ */
+void halUartUnregisterCallbacks(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Route the HAL callbacks of a SPI handle to a driver
+ * @param hspi SPI handle the callbacks belong to
+ * @param callbacks Callback table, must stay valid while registered
+ * @param ctx Driver context passed back to every callback
+ * @retval HAL_OK on success, HAL_ERROR if the table is full
+ */
+HAL_StatusTypeDef halSpiRegisterCallbacks(SPI_HandleTypeDef *hspi, const HalSpiCallbacks *callbacks, void *ctx);
+
+/**
+ * @brief Stop routing the HAL callbacks of a SPI handle
+ * @param hspi SPI handle to unregister
+ */
+void halSpiUnregisterCallbacks(SPI_HandleTypeDef *hspi);
+
+/**
+ * @brief Route the HAL callbacks of an SMBus handle to a driver
+ * @param hsmbus SMBus handle the callbacks belong to
+ * @param callbacks Callback table, must stay valid while registered
+ * @param ctx Driver context passed back to every callback
+ * @retval HAL_OK on success, HAL_ERROR if the table is full
+ */
+HAL_StatusTypeDef halSmbusRegisterCallbacks(SMBUS_HandleTypeDef *hsmbus, const HalSmbusCallbacks *callbacks, void *ctx);
+
+/**
+ * @brief Stop routing the HAL callbacks of an SMBus handle
+ * @param hsmbus SMBus handle to unregister
+ */
+void halSmbusUnregisterCallbacks(SMBUS_HandleTypeDef *hsmbus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_CALLBACKS_H */
@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file           : internal_flash.h
+  * @brief          : Internal flash storage with fast programming and background erase
+  ******************************************************************************
+  * Manages a region of the on-chip flash for the config store, update
+  * images and logs. Programs use the controller's fast row mode (U5 burst,
+  * G4 fast programming) for every aligned full row and single program
+  * units elsewhere, so offsets and lengths must be multiples of the unit.
+  *
+  * Page erases take milliseconds, so they are taken off the write path:
+  * each written page queues the pages after it, and an idle-priority
+  * worker erases them one at a time while nothing else runs. On dual-bank
+  * parts a region in the other bank is erased while the application keeps
+  * executing (read-while-write). Erasing the bank the code runs from
+  * stalls every fetch until the erase ends; those erases are held back
+  * while any caller is inside internalFlashGuardEnter/Exit, so timing
+  * critical sections never meet a stall that starts after they do.
+  *
+  * As on any NOR flash, programming needs erased cells and the caller
+  * decides when data may go. A page the writer reaches while it is still
+  * queued is erased first, in front of the caller; the statistics count
+  * these foreground erases and the longest time a caller or the core was
+  * stalled.
+  *
+  * The driver is not thread safe, a single task is expected to program
+  * and erase; the worker only runs queued erases.
+  ******************************************************************************
+  */
+
+#ifndef INTERNAL_FLASH_H
+#define INTERNAL_FLASH_H
+
+#include "hal_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint32_t base;              // Address of the region, page aligned
+    uint32_t size;              // Region size, whole pages
+    uint32_t flashBase;         // Address of bank 0
+    uint32_t bankSize;          // Bytes per bank, 0 on single-bank parts
+    uint32_t pageSize;          // Erase unit, 8 KB on U5
+    uint32_t programUnit;       // 16 bytes on U5 (quad-word), 8 on G4 (double-word)
+    uint32_t rowSize;           // Fast row, 128 bytes on U5 (burst), 256 on G4; 0 if none
+    uint32_t eraseAhead;        // Pages kept erased ahead of the last written one
+} InternalFlashConfig;
+
+typedef struct
+{
+    uint32_t bytesProgrammed;
+    uint32_t rowsProgrammed;
+    uint32_t unitsProgrammed;
+    uint32_t programCycles;     // Including waits for erases
+    uint32_t pagesErased;
+    uint32_t backgroundErases;  // Run by the worker
+    uint32_t foregroundErases;  // Run in front of a program or erase call
+    uint32_t eraseWaits;        // Calls that waited for a worker erase to end
+    uint32_t deferredErases;    // Code bank erases held back by a guard
+    uint32_t maxEraseCycles;
+    uint32_t maxStallCycles;    // Longest wait of a caller, or code bank erase
+    uint32_t errors;
+} InternalFlashStats;
+
+typedef struct
+{
+    uint32_t rowProgramKBps;
+    uint32_t unitProgramKBps;
+    uint32_t eraseUs;           // One page
+    uint32_t maxStallUs;        // From the statistics, all traffic so far
+} InternalFlashBenchmark;
+
+/**
+ * @brief Blank-check the region and start the erase worker
+ * @param config Region and controller geometry, copied
+ * @retval HAL_ERROR for an inconsistent geometry or when the worker cannot start
+ */
+HAL_StatusTypeDef internalFlashInit(const InternalFlashConfig *config);
+
+/**
+ * @brief Read from the region
+ * @param offset Region offset
+ * @param data Destination buffer
+ * @param length Number of bytes
+ * @retval HAL status
+ */
+HAL_StatusTypeDef internalFlashRead(uint32_t offset, uint8_t *data, uint32_t length);
+
+/**
+ * @brief Program erased cells, erasing first a page still queued for erase
+ * @param offset Region offset, a multiple of the program unit
+ * @param data Source buffer
+ * @param length Number of bytes, a multiple of the program unit
+ * @retval HAL status
+ */
+HAL_StatusTypeDef internalFlashProgram(uint32_t offset, const uint8_t *data, uint32_t length);
+
+/**
+ * @brief Erase the page containing the offset now, unless it is already erased
+ * @retval HAL status
+ */
+HAL_StatusTypeDef internalFlashErasePage(uint32_t offset);
+
+/**
+ * @brief Queue the pages of a range for background erase
+ * @param offset Region offset
+ * @param length Number of bytes
+ * @retval HAL_ERROR if the range is outside the region
+ */
+HAL_StatusTypeDef internalFlashEraseAsync(uint32_t offset, uint32_t length);
+
+/**
+ * @brief Advance the background erase, called by the worker
+ */
+void internalFlashPoll(void);
+
+/**
+ * @brief Hold back code bank erases until the matching exit; nests
+ */
+void internalFlashGuardEnter(void);
+void internalFlashGuardExit(void);
+
+/**
+ * @brief Copy the statistics
+ * @param stats Destination
+ */
+void internalFlashGetStats(InternalFlashStats *stats);
+
+/**
+ * @brief Measure row and unit program throughput and the page erase time
+ * @param offset Page-aligned region offset, the page is erased and overwritten twice
+ *               and the erase-ahead pages after it are queued
+ * @param buffer Scratch buffer of one page
+ * @param result Measured throughput
+ * @retval HAL status
+ */
+HAL_StatusTypeDef internalFlashBenchmark(uint32_t offset, uint8_t *buffer, InternalFlashBenchmark *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTERNAL_FLASH_H */
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file           : kalman_bench.h
+  * @brief          : Cycle counts of the Kalman filter update steps on the running core
+  ******************************************************************************
+  * Times one predict plus one update of ExtendedKalmanFilter and
+  * UnscentedKalmanFilter (kalman.h) on the cycle counter, with interrupts
+  * masked, for constant-acceleration trackers of one, two and four axes:
+  * N = 3, 6 and 12 states with one position measured per axis, in float
+  * and in double. Where the FPU is single precision only, the double
+  * figures are those of the software library.
+  *
+  * Each figure is the best of a few runs from the same starting state, so
+  * that a cache or flash accelerator warm-up does not count.
+  ******************************************************************************
+  */
+
+#ifndef KALMAN_BENCH_H
+#define KALMAN_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define KALMAN_BENCH_SIZES  3U      // N = 3, 6 and 12
+
+typedef struct
+{
+    uint32_t ekfFloatCycles[KALMAN_BENCH_SIZES];
+    uint32_t ukfFloatCycles[KALMAN_BENCH_SIZES];
+    uint32_t ekfDoubleCycles[KALMAN_BENCH_SIZES];
+    uint32_t ukfDoubleCycles[KALMAN_BENCH_SIZES];
+} KalmanBenchmark;
+
+/**
+ * @brief Time one predict and update of each filter, size and precision
+ * @param result Cycles per predict + update
+ * @retval HAL_ERROR for a missing result or a filter that lost definiteness
+ */
+HAL_StatusTypeDef kalmanBenchmark(KalmanBenchmark *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KALMAN_BENCH_H */
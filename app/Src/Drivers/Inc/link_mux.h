@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : link_mux.h
+  * @brief          : Logical channels for logs, telemetry and the shell on the UART link
+  ******************************************************************************
+  * The firmware end of the channel mux (channel_mux.h), carried in the
+  * application frames of the UART link. Both frame with frame_codec, so a
+  * link frame carrying a mux payload is a mux frame on the wire and the
+  * host's mux_host and muxcat read it as is. Channel ids and priorities
+  * match muxcat's default table.
+  *
+  * Once started, log records at warning and above are copied to the alarm
+  * channel and the rest to the log channel, whole records or not at all.
+  * Telemetry carries a stream of CBOR items, the shell lines of text in
+  * both directions.
+  *
+  * Writes may come from any task; the mux is used under a critical section.
+  * Receiving and moving frames to the link belong to the task that polls
+  * the link.
+  ******************************************************************************
+  */
+
+#ifndef LINK_MUX_H
+#define LINK_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#include <stddef.h>
+
+#define LINK_MUX_ALARM          1U      // Warnings and errors, most urgent
+#define LINK_MUX_SHELL          2U      // Command lines in, replies out
+#define LINK_MUX_TELEMETRY      3U      // CBOR items
+#define LINK_MUX_LOG            5U      // Debug and info records
+
+/**
+ * @brief Set up the channels and start copying log records to them
+ * @note  Install linkMuxReceive as the link's frame handler
+ * @retval HAL status
+ */
+HAL_StatusTypeDef linkMuxInit(void);
+
+/**
+ * @brief Check whether the channels have been started
+ * @retval 1 if active, 0 otherwise
+ */
+int linkMuxIsActive(void);
+
+/**
+ * @brief Frame handler for uartLinkInit, takes in the host's mux frames
+ */
+void linkMuxReceive(const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Move queued channel data to the link while it accepts frames
+ * @note  Call from the task that polls the link, after uartLinkPoll
+ */
+void linkMuxPoll(void);
+
+/**
+ * @brief Queue data on a channel, all of it or nothing
+ * @retval HAL_BUSY if the channel lacks room, HAL_ERROR for an unknown channel or before init
+ */
+HAL_StatusTypeDef linkMuxWrite(uint8_t channel, const uint8_t *data, size_t length);
+
+/**
+ * @brief Take received data from a channel
+ * @retval Number of bytes copied
+ */
+size_t linkMuxRead(uint8_t channel, uint8_t *dst, size_t size);
+
+/**
+ * @brief Re-advertise the receive windows, repairs lost credit frames
+ */
+void linkMuxRefreshCredits(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINK_MUX_H */
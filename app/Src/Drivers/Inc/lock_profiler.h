@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file           : lock_profiler.h
+  * @brief          : Contention report for RTOS mutexes, semaphores and queues
+  ******************************************************************************
+  * The kernel's queue trace hooks (FreeRTOSConfig.h) call into this module
+  * for every object added to the queue registry; unregistered objects cost
+  * one table lookup and are otherwise ignored. Times come from the cycle
+  * counter, the figures themselves are kept by contention_profiler.h.
+  *
+  * Register an object with vQueueAddToRegistry() right after creating it.
+  * The registry holds configQUEUE_REGISTRY_SIZE objects, the kernel's own
+  * timer queue among them.
+  ******************************************************************************
+  */
+
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define LOCK_PROFILER_MAX_OBJECTS   16U
+
+typedef struct
+{
+    const char *name;           // Registry name
+    const char *kindName;       // "queue", "mutex", "counting", "binary" or "recursive"
+    uint32_t length;
+    uint32_t operations;
+    uint32_t contentions;       // Operations that had to block
+    uint32_t timeouts;
+    uint32_t totalWaitUs;
+    uint32_t maxWaitUs;
+    const char *worstWaiter;    // Task of the longest wait
+    const char *worstOwner;     // Mutex holder when it started, "-" if none
+    uint32_t holds;
+    uint32_t avgHoldUs;
+    uint32_t maxHoldUs;
+    uint32_t highWater;         // Queues and counting semaphores
+} LockHotspot;
+
+// Kernel trace hooks, declared again in FreeRTOSConfig.h
+void lockProfilerRegister(const void *object, const char *name, uint8_t type, uint32_t length);
+void lockProfilerUnregister(const void *object);
+void lockProfilerBlock(const void *object, const void *task, uint8_t sending);
+void lockProfilerDone(const void *object, const void *task, uint8_t sending, uint32_t waiting);
+void lockProfilerFailed(const void *object, const void *task, uint8_t sending);
+
+/**
+ * @brief Copy the figures of the worst objects, ranked by total wait, contentions and hold time
+ * @param hotspots Destination
+ * @param max Entries available
+ * @retval Entries written
+ */
+uint32_t lockProfilerGetHotspots(LockHotspot *hotspots, uint32_t max);
+
+/**
+ * @brief Clear the figures of every object, keeping the registrations
+ */
+void lockProfilerReset(void);
+
+/**
+ * @brief Log the worst objects
+ * @param top Objects to list, 0 for all
+ */
+void lockProfilerDump(uint32_t top);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCK_PROFILER_H */
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : lpuart_wake.h
+  * @brief          : LPUART receive path that keeps working in Stop mode
+  ******************************************************************************
+  * The LPUART receives into a circular DMA ring while the core is stopped and
+  * wakes it on an address match (or start bit). Frames are delimited by line
+  * idle and must start with the node address byte.
+  *
+  * From the wake-up until a frame has been read the driver holds a Sleep
+  * lock in the power manager, otherwise it lets the idle hook enter Stop.
+  * The LPUART RX DMA channel must be configured in circular mode, and the
+  * RX FIFO enabled to hold the bytes that arrive while the core wakes up.
+  * Frames are limited to half the ring, and a queued frame that reception
+  * laps before it is read is dropped.
+  *
+  * Wake latency is counted from the first instruction after the core left
+  * Stop on the wake flag; the hardware Stop exit time ahead of it is a fixed
+  * figure the cycle counter cannot see.
+  ******************************************************************************
+  */
+
+#ifndef LPUART_WAKE_H
+#define LPUART_WAKE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define LPUART_WAKE_RING_SIZE   256U
+#define LPUART_WAKE_MAX_FRAMES  8U
+
+typedef enum
+{
+    LPUART_WAKE_ON_ADDRESS  = 0,
+    LPUART_WAKE_ON_STARTBIT = 1
+} LpuartWakeSource;
+
+typedef struct
+{
+    uint32_t wakeCount;             // LPUART wake-up events
+    uint32_t framesReceived;
+    uint32_t framesDropped;         // Frame queue full, or DMA wrapped over the frame before it was read
+    uint32_t framesDamagedAtWake;   // First frame after a wake not starting with the address
+    uint32_t bytesLostAtWake;       // Bytes discarded (or missing) ahead of the address byte
+    uint32_t overrunErrors;
+    uint32_t lastWakeLatencyCycles; // Core out of Stop on the wake flag to wake-up interrupt, in CPU cycles
+    uint32_t maxWakeLatencyCycles;
+} LpuartWakeStats;
+
+/**
+ * @brief Start the low-power receive path
+ * @param huart LPUART handle configured by the platform
+ * @param address Node address, first byte of every frame addressed to us
+ * @param source Wake-up source used while in Stop mode
+ * @retval HAL status
+ */
+HAL_StatusTypeDef lpuartWakeInit(UART_HandleTypeDef *huart, uint8_t address, LpuartWakeSource source);
+
+/**
+ * @brief Check whether the low-power receive path has been started
+ * @retval 1 if active, 0 otherwise
+ */
+int lpuartWakeIsActive(void);
+
+/**
+ * @brief Pop the oldest complete frame
+ * @param dst Destination buffer
+ * @param size Size of the destination buffer, longer frames are truncated
+ * @retval Number of bytes copied, 0 if no frame is pending
+ */
+uint16_t lpuartWakeReadFrame(uint8_t *dst, uint16_t size);
+
+/**
+ * @brief Copy the receive path statistics
+ * @param stats Destination
+ */
+void lpuartWakeGetStats(LpuartWakeStats *stats);
+
+/**
+ * @brief Convert a cycle count to microseconds at the current HCLK
+ * @param cycles CPU cycles
+ * @retval Microseconds, 0 if the clock frequency is unknown
+ */
+uint32_t lpuartWakeCyclesToUs(uint32_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LPUART_WAKE_H */
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file           : overload_control.h
+  * @brief          : Load shedding under CPU pressure
+  ******************************************************************************
+  * Once per second the controller takes a sample: CPU load from the idle
+  * task's share of the cycle counter, and the deadline misses of the period
+  * (reported misses, late RS-485 replies, work items refused by a full
+  * lane). Under sustained overload it steps service levels down, logging
+  * chatter first, then polling rates, then telemetry; it gives them back in
+  * reverse when the load has stayed low for a while.
+  *
+  * Components register the number of levels they can give up and a callback
+  * that applies one. Callbacks run inside a critical section on the task
+  * that polls the controller, so they should only store the new level.
+  ******************************************************************************
+  */
+
+#ifndef OVERLOAD_CONTROL_H
+#define OVERLOAD_CONTROL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define OVERLOAD_SAMPLE_MS      1000U   // Measurement period
+
+typedef enum
+{
+    OVERLOAD_ORDER_LOGGING = 0,     // Shed first
+    OVERLOAD_ORDER_POLLING,
+    OVERLOAD_ORDER_TELEMETRY        // Shed last
+} OverloadOrder;
+
+/**
+ * @brief Apply a service level
+ * @param level 0 for full service, up to the registered level count
+ * @param ctx Context given at registration
+ */
+typedef void (*OverloadApplyFn)(uint8_t level, void *ctx);
+
+typedef struct
+{
+    uint32_t loadPermille;      // CPU load over the last sample
+    uint32_t deadlineMisses;    // Total misses seen
+    uint32_t sheds;
+    uint32_t restores;
+    uint8_t level;              // Steps currently shed
+    uint8_t levelCount;         // Steps available
+    uint8_t peakLevel;
+} OverloadStats;
+
+/**
+ * @brief Register a component, its callback is called at once with the current level
+ * @param name Component name, kept by reference
+ * @param order Position on the shedding ladder
+ * @param levels Degradation steps the component offers
+ * @param apply Level callback
+ * @param ctx Callback context
+ * @retval HAL_ERROR if the table is full or the arguments are invalid
+ */
+HAL_StatusTypeDef overloadRegister(const char *name, OverloadOrder order, uint8_t levels,
+                                   OverloadApplyFn apply, void *ctx);
+
+/**
+ * @brief Count a missed deadline, safe from interrupts
+ */
+void overloadReportDeadlineMiss(void);
+
+/**
+ * @brief Take a sample when one is due, cheap to call from any task loop
+ */
+void overloadControlPoll(void);
+
+/**
+ * @brief Copy the controller statistics
+ * @param stats Destination
+ */
+void overloadGetStats(OverloadStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OVERLOAD_CONTROL_H */
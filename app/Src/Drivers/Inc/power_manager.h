@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file           : power_manager.h
+  * @brief          : Reference-counted peripheral clock and power domain manager
+  ******************************************************************************
+  * Drivers acquire the clocks and power domains they use and release them when
+  * idle. The last release gates the resource. Every active resource caps the
+  * low-power mode the idle hook may enter, so the deepest allowed mode follows
+  * directly from what is currently in use.
+  ******************************************************************************
+  */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+/* Low-power modes, ordered from shallowest to deepest */
+typedef enum
+{
+    POWER_MODE_RUN   = 0,   // Idle must not sleep at all
+    POWER_MODE_SLEEP = 1,   // Core clock stopped, peripherals running
+    POWER_MODE_STOP1 = 2,   // Stop mode, fast wake-up
+    POWER_MODE_STOP2 = 3,   // Stop mode, lowest retention current
+    POWER_MODE_COUNT
+} PowerMode;
+
+/* Peripheral clocks, the platform maps them to RCC enable bits */
+typedef enum
+{
+    POWER_CLOCK_USART2 = 0,
+    POWER_CLOCK_LPUART1,
+    POWER_CLOCK_I2C2,
+    POWER_CLOCK_SPI1,
+    POWER_CLOCK_DMA,
+    POWER_CLOCK_TIM2,
+    POWER_CLOCK_COUNT
+} PowerClock;
+
+/* Power domains, the platform maps them to PWR controls */
+typedef enum
+{
+    POWER_DOMAIN_VDDIO2 = 0,    // Independent I/O supply (U5 port G)
+    POWER_DOMAIN_SRAM2,
+    POWER_DOMAIN_SRAM3,
+    POWER_DOMAIN_COUNT
+} PowerDomain;
+
+typedef struct
+{
+    uint32_t clockMask;                         // Bit n set when PowerClock n is enabled
+    uint32_t domainMask;                        // Bit n set when PowerDomain n is enabled
+    uint8_t clockRefs[POWER_CLOCK_COUNT];
+    uint8_t domainRefs[POWER_DOMAIN_COUNT];
+    PowerMode deepestMode;
+    uint32_t modeEntries[POWER_MODE_COUNT];     // Idle periods spent in each mode
+} PowerActiveSet;
+
+/**
+ * @brief Initialize the manager with the resources enabled at boot
+ * @param bootClocks Mask of PowerClock bits enabled by the CubeMX init code
+ * @param bootDomains Mask of PowerDomain bits enabled by the CubeMX init code
+ */
+void powerManagerInit(uint32_t bootClocks, uint32_t bootDomains);
+
+/**
+ * @brief Gate every boot-enabled resource that no driver has acquired
+ * @note  Call once all drivers are initialized, before the scheduler starts
+ */
+void powerManagerGateUnused(void);
+
+HAL_StatusTypeDef powerManagerAcquireClock(PowerClock clock);
+HAL_StatusTypeDef powerManagerReleaseClock(PowerClock clock);
+HAL_StatusTypeDef powerManagerAcquireDomain(PowerDomain domain);
+HAL_StatusTypeDef powerManagerReleaseDomain(PowerDomain domain);
+
+/**
+ * @brief Forbid low-power modes deeper than the given one until unlocked
+ * @note  Interrupt safe, calls must be balanced with powerManagerUnlockMode
+ */
+void powerManagerLockMode(PowerMode deepest);
+void powerManagerUnlockMode(PowerMode deepest);
+
+/**
+ * @brief Deepest low-power mode allowed by the active resources and locks
+ */
+PowerMode powerManagerDeepestMode(void);
+
+/**
+ * @brief Cycle counter value sampled when the core last left Stop mode
+ * @note  Taken right after the wake-up instruction returns, ahead of the clock restore
+ */
+uint32_t powerManagerLastStopExitCycles(void);
+
+/**
+ * @brief Snapshot of the active clocks, domains and mode statistics
+ */
+void powerManagerGetActiveSet(PowerActiveSet *set);
+
+/**
+ * @brief Log the active clock and domain sets
+ */
+void powerManagerDump(void);
+
+/**
+ * @brief Tickless idle hooks, see configPRE_SLEEP_PROCESSING
+ */
+void powerManagerPreSleep(uint32_t *expectedIdleTime);
+void powerManagerPostSleep(uint32_t *expectedIdleTime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_MANAGER_H */
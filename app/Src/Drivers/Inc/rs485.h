@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file           : rs485.h
+  * @brief          : Half-duplex RS-485 multi-drop port with hardware driver enable
+  ******************************************************************************
+  * The USART drives the transceiver DE pin itself, with assertion and
+  * deassertion guard times programmed in fractions of a bit. Frames start
+  * with an address character flagged by the address mark (bit 8 in 9-bit
+  * mode, the MSB in 8-bit mode); the receiver sits in mute mode and only
+  * wakes on a mark carrying our address, so traffic for other nodes never
+  * raises an interrupt. Frames end on line idle.
+  *
+  * Replies can be produced directly in the receive interrupt through the
+  * responder callback, which keeps the RX to TX turnaround bounded by the
+  * idle detection time plus interrupt latency. The measured turnaround (last
+  * received stop bit to first transmitted start bit) is checked against the
+  * protocol limit given at init. The port holds a Sleep lock while active,
+  * waking from Stop would add several microseconds to every turnaround.
+  ******************************************************************************
+  */
+
+#ifndef RS485_H
+#define RS485_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define RS485_MAX_FRAME     128U    // Characters, address included
+#define RS485_MAX_FRAMES    4U
+
+typedef struct
+{
+    uint8_t address;            // 7-bit node address
+    uint8_t nineBit;            // UART configured for 9-bit characters by the platform
+    uint8_t deAssertTime;       // DE to start bit, in 1/16 bit (0-31)
+    uint8_t deDeassertTime;     // Last stop bit to DE release, in 1/16 bit (0-31)
+    uint32_t baudRate;          // Used to convert character times to cycles
+    uint32_t maxTurnaroundUs;   // Protocol limit from last RX character to first TX character
+} Rs485Config;
+
+typedef struct
+{
+    uint32_t framesReceived;
+    uint32_t framesDropped;         // Queue full or frame longer than RS485_MAX_FRAME
+    uint32_t framesSent;
+    uint32_t errors;
+    uint32_t replies;               // Frames answered from the responder callback
+    uint32_t lastTurnaroundCycles;
+    uint32_t maxTurnaroundCycles;
+    uint32_t turnaroundViolations;  // Replies later than maxTurnaroundUs
+} Rs485Stats;
+
+/**
+ * @brief Responder called in interrupt context for every frame addressed to us
+ * @param payload Received payload, address character removed
+ * @param length Payload length
+ * @param reply Reply payload buffer of RS485_MAX_FRAME - 1 bytes
+ * @param replyAddress Address character sent ahead of the reply, preset to our address
+ * @retval Reply length, 0 to queue the frame for rs485ReadFrame instead
+ */
+typedef uint16_t (*Rs485ResponderFn)(const uint8_t *payload, uint16_t length, uint8_t *reply, uint8_t *replyAddress);
+
+/**
+ * @brief Handler for frames the responder left, called from the normal work lane
+ */
+typedef void (*Rs485FrameFn)(const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Start the RS-485 port
+ * @param huart USART handle initialized by the platform (DMA on TX and RX)
+ * @param config Port configuration, copied
+ * @param responder Optional interrupt-context responder, may be NULL
+ * @retval HAL status
+ */
+HAL_StatusTypeDef rs485Init(UART_HandleTypeDef *huart, const Rs485Config *config, Rs485ResponderFn responder);
+
+/**
+ * @brief Check whether the port has been started
+ * @retval 1 if active, 0 otherwise
+ */
+int rs485IsActive(void);
+
+/**
+ * @brief Send a frame
+ * @param address Address character sent first with the address mark
+ * @param payload Payload, in 8-bit mode every byte must have the MSB clear
+ * @param length Payload length, up to RS485_MAX_FRAME - 1
+ * @retval HAL_BUSY while a transmission is in progress
+ */
+HAL_StatusTypeDef rs485Send(uint8_t address, const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Pop the oldest received frame not handled by the responder
+ * @param dst Destination buffer for the payload
+ * @param size Size of the destination buffer, longer frames are truncated
+ * @retval Number of bytes copied, 0 if no frame is pending
+ */
+uint16_t rs485ReadFrame(uint8_t *dst, uint16_t size);
+
+/**
+ * @brief Deliver queued frames to a handler on the normal work lane instead of rs485ReadFrame
+ * @param handler Frame handler, NULL to go back to polling
+ * @note  Frames stay queued for rs485ReadFrame when the work queue is not running
+ */
+void rs485SetFrameHandler(Rs485FrameFn handler);
+
+/**
+ * @brief Copy the port statistics
+ * @param stats Destination
+ */
+void rs485GetStats(Rs485Stats *stats);
+
+/**
+ * @brief Convert a cycle count to microseconds at the current HCLK
+ */
+uint32_t rs485CyclesToUs(uint32_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RS485_H */
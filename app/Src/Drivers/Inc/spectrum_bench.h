@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum_bench.h
+  * @brief          : Cycle counts of the 1024-point real FFTs on the running core
+  ******************************************************************************
+  * Times RealFft (real_fft.h) for float, q15 and q31 samples on the cycle
+  * counter, with interrupts masked so the figures are the core's and not
+  * the scheduler's. Built with SPECTRUM_BENCH_CMSIS (CMake option of the
+  * same name, needs the board's CMSIS-DSP target) the same transforms are
+  * timed through arm_rfft_fast_f32, arm_rfft_q15 and arm_rfft_q31 on the
+  * same input; otherwise their fields read 0.
+  *
+  * Each figure is the best of a few runs, so that a cache or flash
+  * accelerator warm-up does not count.
+  ******************************************************************************
+  */
+
+#ifndef SPECTRUM_BENCH_H
+#define SPECTRUM_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define SPECTRUM_BENCH_POINTS       1024U
+#define SPECTRUM_BENCH_BUFFER_SIZE  (SPECTRUM_BENCH_POINTS * 12U)   // q31 input and the 2N outputs of arm_rfft_q31
+
+typedef struct
+{
+    uint32_t floatCycles;
+    uint32_t q15Cycles;
+    uint32_t q31Cycles;
+    uint32_t cmsisFloatCycles;  // 0 without SPECTRUM_BENCH_CMSIS
+    uint32_t cmsisQ15Cycles;
+    uint32_t cmsisQ31Cycles;
+} SpectrumBenchmark;
+
+/**
+ * @brief Time one 1024-point transform of each kind
+ * @param buffer Scratch, SPECTRUM_BENCH_BUFFER_SIZE bytes, 4-byte aligned
+ * @param result Cycles per transform
+ * @retval HAL_ERROR for a missing or misaligned buffer, or when CMSIS-DSP refuses the size
+ */
+HAL_StatusTypeDef spectrumBenchmark(uint8_t *buffer, SpectrumBenchmark *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPECTRUM_BENCH_H */
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file           : spi_bus.h
+  * @brief          : SPI master with a DMA transaction queue shared by several chip-selects
+  ******************************************************************************
+  * Transactions are caller-owned and linked into the bus queue, the DMA works
+  * directly on the caller buffers (zero copy, no heap). The completion
+  * interrupt releases the chip-select, starts the next queued transaction
+  * right away and only then runs the completion callback, so back-to-back
+  * transfers are separated by the interrupt latency alone. The bus is only
+  * reprogrammed when the next device needs a different clock or mode.
+  *
+  * The gap between the end of one transfer and the start of the next chained
+  * one is measured with the cycle counter and reported in SpiBusStats.
+  ******************************************************************************
+  */
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+#include "power_manager.h"
+
+/* Transaction states */
+#define SPI_TXN_IDLE        0U
+#define SPI_TXN_QUEUED      1U
+#define SPI_TXN_ACTIVE      2U
+#define SPI_TXN_DONE        3U
+
+typedef struct
+{
+    GPIO_TypeDef *csPort;       // NULL if the device has no chip-select under our control
+    uint16_t csPin;
+    uint32_t clockHz;           // Maximum SCK frequency of the device
+    uint8_t mode;               // SPI mode 0-3, (CPOL << 1) | CPHA
+} SpiDevice;
+
+typedef struct SpiTransaction SpiTransaction;
+
+/**
+ * @brief Transaction completion callback
+ * @note  Runs in interrupt context, may submit further transactions
+ */
+typedef void (*SpiCompleteFn)(SpiTransaction *txn, void *ctx);
+
+struct SpiTransaction
+{
+    const SpiDevice *device;
+    const uint8_t *tx;          // NULL for receive-only (0xFF is clocked out)
+    uint8_t *rx;                // NULL for transmit-only
+    uint16_t length;
+    uint8_t keepSelected;       // Keep CS asserted if the next queued transaction targets the same device
+    SpiCompleteFn complete;     // Optional
+    void *ctx;
+
+    // Owned by the bus from submission until the state reaches SPI_TXN_DONE
+    SpiTransaction *next;
+    volatile uint8_t state;
+    HAL_StatusTypeDef status;
+};
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;
+    uint32_t reconfigurations;  // Clock or mode changes between devices
+    uint32_t chained;           // Transfers started from the completion interrupt
+    uint32_t chainGapCycles;    // Total bus idle between chained transfers, in CPU cycles
+    uint32_t maxChainGapCycles;
+    uint32_t busyCycles;        // Time with a transfer in flight
+    uint32_t maxQueueDepth;
+} SpiBusStats;
+
+typedef struct
+{
+    SPI_HandleTypeDef *hspi;
+    PowerClock clock;
+    SpiTransaction *head;       // In flight
+    SpiTransaction *tail;
+    const SpiDevice *configured;
+    const SpiDevice *selected;  // Device whose CS is currently asserted
+    uint32_t queueDepth;
+    uint32_t startCycles;
+    SpiBusStats stats;
+} SpiBus;
+
+/**
+ * @brief Attach a bus to a SPI handle configured by the platform (master, DMA on TX and RX)
+ * @param bus Bus instance, must stay valid while in use
+ * @param hspi SPI handle
+ * @param clock Peripheral clock kept enabled while the bus is attached
+ * @retval HAL status
+ */
+HAL_StatusTypeDef spiBusInit(SpiBus *bus, SPI_HandleTypeDef *hspi, PowerClock clock);
+
+/**
+ * @brief Queue a transaction, it starts immediately if the bus is idle
+ * @param bus Bus instance
+ * @param txn Transaction, its buffers must stay valid until it completes
+ * @retval HAL_OK if queued, HAL_BUSY if the transaction is already queued, HAL_ERROR on bad parameters
+ * @note  Interrupt safe
+ */
+HAL_StatusTypeDef spiBusSubmit(SpiBus *bus, SpiTransaction *txn);
+
+/**
+ * @brief Check whether a submitted transaction has finished
+ * @retval 1 once done (see txn->status), 0 otherwise
+ */
+int spiTransactionDone(const SpiTransaction *txn);
+
+/**
+ * @brief Check whether the bus has no transaction queued or in flight
+ */
+int spiBusIsIdle(const SpiBus *bus);
+
+/**
+ * @brief Copy the bus statistics
+ * @param bus Bus instance
+ * @param stats Destination
+ */
+void spiBusGetStats(const SpiBus *bus, SpiBusStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPI_BUS_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file           : trace_recorder.h
+  * @brief          : Recording of peripheral traffic for host replay
+  ******************************************************************************
+  * Streams what the peripherals did, in the compact format of trace_codec.h,
+  * on RTT up channel TRACE_RECORDER_CHANNEL. Capture the channel to a file
+  * from reset (J-Link RTT Logger, channel 1) and feed it to the host replay
+  * tool, which runs the task code against the same HAL results and timing.
+  *
+  * The HAL calls are recorded by link-time wrappers: building the board with
+  * PERIPHERAL_TRACE passes --wrap for each recorded function, so the call
+  * sites stay untouched and untraced builds carry no cost. Completion and
+  * error interrupts are recorded by the HAL callback routing.
+  *
+  * Host requests are traced as spans: the command gets a correlation id
+  * when it arrives, every queue and task it passes through marks the start
+  * and end of its stage with that id, and the host tool rebuilds a
+  * waterfall per request from the stream. Spans cost one call each and
+  * nothing is written while the recorder is not started.
+  *
+  * Events are written whole or not at all; when RTT is full they are
+  * counted and a DROPPED event is written once there is room again.
+  ******************************************************************************
+  */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define TRACE_RECORDER_CHANNEL      1U
+#define TRACE_RECORDER_BUFFER_SIZE  4096U
+#define TRACE_RECORDER_MAX_PORTS    4U
+
+typedef struct
+{
+    uint32_t events;
+    uint32_t bytes;
+    uint32_t dropped;
+} TraceRecorderStats;
+
+/**
+ * @brief Claim the RTT channel and write the trace header
+ * @retval HAL_ERROR if the channel could not be configured
+ */
+HAL_StatusTypeDef traceRecorderStart(void);
+
+/**
+ * @brief Record a UART handle under its instance number
+ * @retval HAL_ERROR if the table is full
+ */
+HAL_StatusTypeDef traceRecorderAddUart(UART_HandleTypeDef *huart, uint8_t port);
+
+/**
+ * @brief Record an SMBus handle under its instance number
+ * @retval HAL_ERROR if the table is full
+ */
+HAL_StatusTypeDef traceRecorderAddSmbus(SMBUS_HandleTypeDef *hsmbus, uint8_t port);
+
+/**
+ * @brief Copy the recorder statistics
+ * @param stats Destination
+ */
+void traceRecorderGetStats(TraceRecorderStats *stats);
+
+// Recording hooks, safe from interrupts. They do nothing before the recorder
+// is started or for handles that were not added.
+void traceRecordUartTransmit(UART_HandleTypeDef *huart, HAL_StatusTypeDef status, uint16_t size);
+void traceRecordUartReceive(UART_HandleTypeDef *huart, HAL_StatusTypeDef status, const uint8_t *buffer, uint16_t size);
+void traceRecordUartState(UART_HandleTypeDef *huart, HAL_UART_StateTypeDef state);
+void traceRecordUartTxDone(UART_HandleTypeDef *huart);
+void traceRecordUartError(UART_HandleTypeDef *huart);
+void traceRecordUartRxEvent(UART_HandleTypeDef *huart, uint16_t size);
+void traceRecordSmbusTransmit(SMBUS_HandleTypeDef *hsmbus, HAL_StatusTypeDef status, uint16_t address, uint16_t size);
+
+/**
+ * @brief Correlation id for a request entering the system, never 0
+ */
+uint32_t traceNewCorrelationId(void);
+
+// Span hooks, safe from interrupts. Stages are TraceSpanStage values (trace_codec.h),
+// id 0 means untraced and records nothing.
+void traceSpanStart(uint32_t id, uint8_t stage);
+void traceSpanEnd(uint32_t id, uint8_t stage, HAL_StatusTypeDef status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_RECORDER_H */
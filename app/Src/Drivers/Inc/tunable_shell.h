@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : tunable_shell.h
+  * @brief          : Tunable parameter commands over RTT and the UART link
+  ******************************************************************************
+  * Lines typed on RTT down channel TUNABLE_SHELL_CHANNEL (J-Link RTT Viewer
+  * or telnet to the RTT port) are run as tunables commands (tunables.h) and
+  * answered on the log channel. The UART task hands the lines typed on the
+  * link's shell channel (link_mux.h) to the same shell, so both transports
+  * see one table and one save function.
+  ******************************************************************************
+  */
+
+#ifndef TUNABLE_SHELL_H
+#define TUNABLE_SHELL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TUNABLE_SHELL_CHANNEL   0U
+#define TUNABLE_SHELL_LINE_MAX  64U
+
+/**
+ * @brief Keep a saved blob, see tunableSave
+ * @retval true once the blob is stored
+ */
+typedef bool (*TunableShellSaveFn)(const uint8_t *blob, size_t size, void *ctx);
+
+/**
+ * @brief Install where "save" writes the changed tunables, none by default
+ */
+void tunableShellSetSave(TunableShellSaveFn fn, void *ctx);
+
+/**
+ * @brief Run one command line
+ * @param out Reply text, always terminated
+ * @retval 0 if the line is not a tunables command (out then holds the usage)
+ */
+int tunableShellExecute(const char *line, char *out, size_t capacity);
+
+/**
+ * @brief Read typed characters from RTT and answer completed lines
+ */
+void tunableShellPoll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TUNABLE_SHELL_H */
@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file           : uart_link.h
+  * @brief          : Framed UART link with automatic baud-rate negotiation
+  ******************************************************************************
+  * Frames are COBS encoded with a CRC (frame_codec) and carried over DMA in
+  * both directions; reception uses a circular DMA buffer and idle-line
+  * events. The link starts at the safe rate and the negotiator (see
+  * baud_negotiator.h) moves both ends to the fastest rate in the table that
+  * the clocks can generate and that passes a test burst. CRC failures,
+  * framing and noise errors are fed back so a rate that degrades in the
+  * field drops back to the safe rate and is renegotiated.
+  *
+  * Time sync frames (first byte TIME_SYNC_TAG) are handed to clock_sync
+  * with the cycle count of the receive event that completed them.
+  *
+  * Application frames are refused while a negotiation is in progress.
+  * The owner keeps USART2 and its DMA clocked while the link listens, which
+  * holds the idle hook at Sleep since DMA stops in Stop mode. A link that has
+  * been quiet can be parked so the owner can gate both; a parked link hears
+  * nothing, so the peer has to wake the board some other way first.
+  ******************************************************************************
+  */
+
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define UART_LINK_MAX_PAYLOAD   128U
+#define UART_LINK_RX_DMA_SIZE   256U
+
+typedef enum
+{
+    UART_LINK_SLAVE = 0,    // Follows proposals from the peer
+    UART_LINK_MASTER        // Proposes rates and probes the link
+} UartLinkRole;
+
+typedef struct
+{
+    uint32_t baudRate;          // Current line rate
+    uint32_t negotiations;
+    uint32_t trialsFailed;
+    uint32_t fallbacks;
+    uint32_t lineErrors;        // CRC, framing, noise and overrun errors
+    uint32_t throughputBps;     // Application payload bytes received per second
+    uint32_t framesReceived;
+    uint32_t framesSent;
+    uint32_t rxOverflows;       // Bytes lost because the task did not poll in time
+} UartLinkStats;
+
+/**
+ * @brief Handler for received application frames, called from uartLinkPoll
+ */
+typedef void (*UartLinkRxFn)(const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Start the link at the safe rate
+ * @param huart USART handle initialized by the platform (TX DMA, circular RX DMA)
+ * @param role Which end drives the negotiation
+ * @param handler Receives application frames, may be NULL
+ * @retval HAL status
+ */
+HAL_StatusTypeDef uartLinkInit(UART_HandleTypeDef *huart, UartLinkRole role, UartLinkRxFn handler);
+
+/**
+ * @brief Replace the application frame handler
+ * @param handler Called from uartLinkPoll, may be NULL
+ */
+void uartLinkSetHandler(UartLinkRxFn handler);
+
+/**
+ * @brief Check whether the link has been started
+ * @retval 1 if active, 0 otherwise
+ */
+int uartLinkIsActive(void);
+
+/**
+ * @brief Check whether application frames can be sent
+ * @retval 1 once a rate is settled, 0 while negotiating
+ */
+int uartLinkIsReady(void);
+
+/**
+ * @brief Time since the link last moved a byte
+ * @retval Milliseconds, 0 while a frame or a negotiation is in flight or the link is parked
+ */
+uint32_t uartLinkIdleTime(void);
+
+/**
+ * @brief Stop listening so the owner can gate USART2 and its DMA
+ * @retval HAL_BUSY while a frame or a negotiation is in flight, HAL_ERROR if not started or already parked
+ */
+HAL_StatusTypeDef uartLinkPark(void);
+
+/**
+ * @brief Listen again once the owner has clocked USART2 and its DMA
+ * @retval HAL_ERROR if not parked
+ */
+HAL_StatusTypeDef uartLinkResume(void);
+
+/**
+ * @brief Check whether the link is parked
+ * @retval 1 if parked, 0 otherwise
+ */
+int uartLinkIsParked(void);
+
+/**
+ * @brief Check whether a frame was refused because the link is parked
+ * @retval 1 if the owner should resume the link, 0 otherwise
+ */
+int uartLinkWakeRequested(void);
+
+/**
+ * @brief Queue an application frame
+ * @param payload Payload, not starting like a negotiation or time sync message
+ * @param length Payload length, up to UART_LINK_MAX_PAYLOAD
+ * @retval HAL_BUSY while negotiating, parked or when the transmit queue is full
+ */
+HAL_StatusTypeDef uartLinkSend(const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Queue a time sync frame, only on an idle transmitter
+ * @param payload Encoded TimeSyncMessage
+ * @param length TIME_SYNC_FRAME_SIZE
+ * @retval HAL_BUSY while negotiating, parked or transmitting, HAL_ERROR for other payloads
+ */
+HAL_StatusTypeDef uartLinkSendService(const uint8_t *payload, uint16_t length);
+
+/**
+ * @brief Process received bytes and run the negotiation timers
+ * @note  Call from the owning task at least every 10 ms
+ */
+void uartLinkPoll(void);
+
+/**
+ * @brief Copy the link statistics
+ * @param stats Destination
+ */
+void uartLinkGetStats(UartLinkStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_LINK_H */
@@ -0,0 +1,134 @@
+/**
+  ******************************************************************************
+  * @file           : us_timer.h
+  * @brief          : Microsecond one-shot and periodic timer events
+  ******************************************************************************
+  * The RTOS tick resolves 1 ms, too coarse for bus turnarounds, SMBus
+  * timeouts and sensor conversions of tens of microseconds. This service
+  * runs on a free-running 32-bit counter at 1 MHz: pending deadlines sit
+  * in a heap (deadline_heap.h) and the compare channel is always armed for
+  * the earliest, so one interrupt fires per due deadline wherever the RTOS
+  * tick is.
+  *
+  * Callbacks run either in the compare interrupt, for work of a few
+  * microseconds, or on the high work lane (work_queue.h). Periodic timers
+  * are anchored to their first deadline so they do not drift; periods
+  * missed entirely are skipped and counted as overruns. Delays are limited
+  * to 2^31 us (35 minutes) by the wrapping compare.
+  *
+  * The latency from deadline to callback start is measured for both
+  * contexts, giving the scheduling jitter. The counter needs TIM2 clocked,
+  * so the service keeps the core out of Stop mode once started.
+  ******************************************************************************
+  */
+
+#ifndef US_TIMER_H
+#define US_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define US_TIMER_MAX            16U
+#define US_TIMER_MAX_DELAY_US   0x7FFFFFFFU
+
+typedef enum
+{
+    US_TIMER_IN_ISR = 0,        // In the compare interrupt, keep it short
+    US_TIMER_DEFERRED           // On the high work lane
+} UsTimerContext;
+
+/**
+ * @brief Timer callback
+ * @param ctx Context given at creation
+ */
+typedef void (*UsTimerFn)(void *ctx);
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t minUs;             // Deadline to callback start
+    uint32_t maxUs;
+    uint32_t avgUs;
+} UsTimerJitter;
+
+typedef struct
+{
+    uint32_t interrupts;
+    uint32_t fired;             // Deadlines reached, either context
+    uint32_t overruns;          // Periods skipped because the previous one ran late
+    uint32_t deferFailures;     // Work lane full, the run was lost
+    uint32_t staleRuns;         // Deferred runs dropped because the timer was stopped or restarted
+    UsTimerJitter isr;
+    UsTimerJitter deferred;
+} UsTimerStats;
+
+/**
+ * @brief Start the counter
+ * @retval HAL status
+ */
+HAL_StatusTypeDef usTimerInit(void);
+
+/**
+ * @brief Allocate a timer
+ * @param fn Callback
+ * @param ctx Context passed to the callback
+ * @param context Where the callback runs
+ * @param id Receives the timer id
+ * @retval HAL_ERROR if all timers are taken
+ */
+HAL_StatusTypeDef usTimerCreate(UsTimerFn fn, void *ctx, UsTimerContext context, uint8_t *id);
+
+/**
+ * @brief Arm a timer, restarting it if it runs; safe from interrupts and callbacks
+ * @param id Timer id
+ * @param delayUs Time to the first deadline, up to US_TIMER_MAX_DELAY_US
+ * @param periodUs Period after that, 0 for a one-shot
+ * @retval HAL_ERROR for an unknown id or a delay out of range
+ */
+HAL_StatusTypeDef usTimerStart(uint8_t id, uint32_t delayUs, uint32_t periodUs);
+
+/**
+ * @brief Arm a timer for an absolute counter value
+ */
+HAL_StatusTypeDef usTimerStartAt(uint8_t id, uint32_t deadline, uint32_t periodUs);
+
+/**
+ * @brief Disarm a timer; a deferred run already queued is dropped
+ */
+void usTimerStop(uint8_t id);
+
+/**
+ * @brief Check whether a timer is armed
+ * @retval 1 if armed, 0 otherwise
+ */
+int usTimerIsActive(uint8_t id);
+
+/**
+ * @brief Counter value, microseconds, wraps
+ */
+uint32_t usTimerNow(void);
+
+/**
+ * @brief Busy-wait, for waits too short to give the CPU away
+ */
+void usTimerDelay(uint32_t us);
+
+/**
+ * @brief Compare interrupt, called by the platform
+ */
+void usTimerCompareIrq(void);
+
+/**
+ * @brief Copy the statistics
+ * @param stats Destination
+ */
+void usTimerGetStats(UsTimerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* US_TIMER_H */
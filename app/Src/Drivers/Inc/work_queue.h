@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : work_queue.h
+  * @brief          : Deferred work service with priority lanes
+  ******************************************************************************
+  * Interrupt handlers hand the slow part of their job to a worker task by
+  * submitting a work item: a function and up to WORK_DATA_SIZE bytes of
+  * context copied into a fixed slot. Each lane is a lock-free ring served by
+  * one worker at its own priority, so every driver shares three stacks
+  * instead of owning a task. Submitting never blocks; a full lane counts an
+  * overflow and returns HAL_BUSY.
+  *
+  * Items run in submission order within a lane, to completion, in task
+  * context. Latency is measured from submission to the start of execution.
+  ******************************************************************************
+  */
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define WORK_DATA_SIZE      16U     // Context bytes carried by one item
+#define WORK_LANE_DEPTH     16U     // Items per lane, power of two
+
+typedef enum
+{
+    WORK_LANE_HIGH = 0,     // Protocol deadlines, replies
+    WORK_LANE_NORMAL,       // Frame processing, I/O completion
+    WORK_LANE_LOW,          // Statistics, housekeeping
+    WORK_LANE_COUNT
+} WorkLane;
+
+/**
+ * @brief Deferred function
+ * @param data Copy of the context given at submission
+ * @param size Context size
+ */
+typedef void (*WorkFn)(const void *data, uint16_t size);
+
+typedef struct
+{
+    uint32_t submitted;
+    uint32_t executed;
+    uint32_t overflows;         // Items refused because the lane was full
+    uint32_t depth;             // Items waiting now
+    uint32_t maxDepth;          // Deepest backlog seen by the worker
+    uint32_t lastLatencyUs;     // Submission to start of execution
+    uint32_t maxLatencyUs;
+    uint32_t avgLatencyUs;
+} WorkQueueStats;
+
+/**
+ * @brief Create the lane workers
+ * @retval HAL_ERROR if the platform could not create a worker
+ */
+HAL_StatusTypeDef workQueueInit(void);
+
+/**
+ * @brief Queue a function for execution on a lane, safe from interrupts
+ * @param lane Lane to run on
+ * @param fn Function to call
+ * @param data Context copied into the item, may be NULL when size is 0
+ * @param size Context size, up to WORK_DATA_SIZE
+ * @retval HAL_BUSY if the lane is full, HAL_ERROR if not initialized or invalid
+ */
+HAL_StatusTypeDef workQueueSubmit(WorkLane lane, WorkFn fn, const void *data, uint16_t size);
+
+/**
+ * @brief Copy the statistics of a lane
+ * @param lane Lane to report
+ * @param stats Destination
+ */
+void workQueueGetStats(WorkLane lane, WorkQueueStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORK_QUEUE_H */
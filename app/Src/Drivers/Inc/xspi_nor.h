@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file           : xspi_nor.h
+  * @brief          : External serial NOR flash on OCTOSPI / QUADSPI
+  ******************************************************************************
+  * Standard JEDEC command set (single-line commands, quad data phases). Reads
+  * go through the memory-mapped window whenever it is enabled; program and
+  * erase temporarily leave memory-mapped mode, run as indirect DMA transfers
+  * and re-enter it afterwards, invalidating the cached range.
+  *
+  * The driver is not thread safe, a single task is expected to own the device
+  * (typically through a NorLog instance built on xspiNorDevice()).
+  ******************************************************************************
+  */
+
+#ifndef XSPI_NOR_H
+#define XSPI_NOR_H
+
+#include "hal_types.h"
+#include "nor_flash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint32_t size;              // Device size in bytes, above 16 MB 4-byte address opcodes are used
+    uint32_t sectorSize;        // Smallest erase unit, 4 KB on most parts
+    uint32_t pageSize;          // Program page, 256 bytes on most parts
+    uint8_t quad;               // Use quad data lines for read and program
+    uint8_t memoryMapped;       // Serve reads from the memory-mapped window
+} XspiNorConfig;
+
+typedef struct
+{
+    uint32_t bytesRead;
+    uint32_t bytesProgrammed;
+    uint32_t sectorsErased;
+    uint32_t readCycles;        // Indirect and memory-mapped reads, in CPU cycles
+    uint32_t programCycles;     // Including busy polling
+    uint32_t eraseCycles;
+    uint32_t maxEraseCycles;
+    uint32_t mappedSwitches;    // Memory-mapped mode exits for program/erase
+    uint32_t errors;
+} XspiNorStats;
+
+typedef struct
+{
+    uint32_t mappedReadKBps;
+    uint32_t indirectReadKBps;
+    uint32_t programKBps;
+    uint32_t eraseUs;           // One sector
+} XspiNorBenchmark;
+
+/**
+ * @brief Probe the device and enable memory-mapped reads if requested
+ * @param config Device geometry and bus options, copied
+ * @retval HAL status, HAL_ERROR if the JEDEC ID reads as all zeros or ones
+ */
+HAL_StatusTypeDef xspiNorInit(const XspiNorConfig *config);
+
+/**
+ * @brief JEDEC ID read at init (manufacturer << 16 | type << 8 | capacity)
+ */
+uint32_t xspiNorJedecId(void);
+
+/**
+ * @brief Read from the device
+ * @param address Device offset
+ * @param data Destination buffer
+ * @param length Number of bytes
+ * @retval HAL status
+ */
+HAL_StatusTypeDef xspiNorRead(uint32_t address, uint8_t *data, uint32_t length);
+
+/**
+ * @brief Program data, split on page boundaries; can only clear bits
+ * @param address Device offset
+ * @param data Source buffer, must stay valid until the call returns
+ * @param length Number of bytes
+ * @retval HAL status
+ */
+HAL_StatusTypeDef xspiNorProgram(uint32_t address, const uint8_t *data, uint32_t length);
+
+/**
+ * @brief Erase the sector containing the address
+ * @param address Device offset
+ * @retval HAL status
+ */
+HAL_StatusTypeDef xspiNorEraseSector(uint32_t address);
+
+/**
+ * @brief Device descriptor for storage layers such as NorLog
+ * @retval Descriptor, valid after a successful xspiNorInit
+ */
+const NorFlash *xspiNorDevice(void);
+
+/**
+ * @brief Copy the transfer statistics
+ * @param stats Destination
+ */
+void xspiNorGetStats(XspiNorStats *stats);
+
+/**
+ * @brief Measure read, program and erase throughput
+ * @param address Sector-aligned device offset, the sector is erased and overwritten
+ * @param buffer Scratch buffer of one sector
+ * @param result Measured throughput
+ * @retval HAL status
+ */
+HAL_StatusTypeDef xspiNorBenchmark(uint32_t address, uint8_t *buffer, XspiNorBenchmark *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSPI_NOR_H */
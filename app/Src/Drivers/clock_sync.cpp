@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file           : clock_sync.cpp
+  * @brief          : Wall-clock time from the host over the framed UART link
+  ******************************************************************************
+  */
+
+#include "clock_sync.h"
+#include "uart_link.h"
+#include "time_sync.h"
+
+#include <stddef.h>
+
+namespace {
+
+constexpr uint32_t FAST_PERIOD_MS = 2000;
+constexpr uint32_t SLOW_PERIOD_MS = 16000;
+constexpr uint32_t FAST_EXCHANGES = 8;
+constexpr uint32_t RESPONSE_TIMEOUT_MS = 1000;
+constexpr uint32_t LONG_GAP_MS = 10000;         // Past this the cycle counter may have wrapped
+
+struct ClockSync
+{
+    // Local clock, advanced under the critical section
+    uint64_t nowUs;
+    uint32_t lastCycles;
+    uint32_t lastTick;
+    uint32_t pendingCycles;         // Below one microsecond, carried to the next update
+    bool clockStarted;
+
+    // Published copy, replaced as a whole once an exchange has been folded in
+    TimeSyncClock clock;
+
+    // Owned by the link task
+    uint16_t sequence;
+    bool awaiting;
+    uint64_t requestUs;
+    uint32_t requestTick;
+    uint32_t nextTick;
+    uint32_t exchanges;
+
+    uint32_t requests;
+    uint32_t responses;
+    uint32_t timeouts;
+};
+
+ClockSync syncState;
+
+/**
+ * @brief Advance the local clock. Caller holds the critical section.
+ */
+void updateClock(void)
+{
+    uint32_t cycles = HAL_GetCycleCount();
+    uint32_t tick = HAL_GetTick();
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+
+    if(!syncState.clockStarted)
+    {
+        HAL_EnableCycleCounter();
+        cycles = HAL_GetCycleCount();
+        syncState.nowUs = (uint64_t)tick * 1000U;
+        syncState.clockStarted = true;
+    }
+    else if(tick - syncState.lastTick > LONG_GAP_MS || mhz == 0)
+    {
+        syncState.nowUs += (uint64_t)(tick - syncState.lastTick) * 1000U;
+        syncState.pendingCycles = 0;
+    }
+    else
+    {
+        uint32_t elapsed = syncState.pendingCycles + (cycles - syncState.lastCycles);
+        syncState.nowUs += elapsed / mhz;
+        syncState.pendingCycles = elapsed % mhz;
+    }
+    syncState.lastCycles = cycles;
+    syncState.lastTick = tick;
+}
+
+} // namespace
+
+extern "C" {
+
+uint64_t clockSyncLocalUs(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    updateClock();
+    uint64_t now = syncState.nowUs;
+    HAL_CriticalExit(state);
+    return now;
+}
+
+uint64_t clockSyncCyclesToLocalUs(uint32_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    uint32_t state = HAL_CriticalEnter();
+    updateClock();
+    uint32_t back = syncState.lastCycles - cycles;
+    uint64_t local = syncState.nowUs;
+    if(mhz != 0 && back > syncState.pendingCycles)
+    {
+        uint64_t ago = (back - syncState.pendingCycles) / mhz;
+        local = local > ago ? local - ago : 0;
+    }
+    HAL_CriticalExit(state);
+    return local;
+}
+
+void clockSyncPoll(void)
+{
+    if(!uartLinkIsReady())
+    {
+        return;
+    }
+
+    uint32_t tick = HAL_GetTick();
+    if(syncState.awaiting && tick - syncState.requestTick > RESPONSE_TIMEOUT_MS)
+    {
+        syncState.awaiting = false;
+        syncState.timeouts++;
+    }
+    if(syncState.awaiting || (syncState.requests > 0 && (int32_t)(tick - syncState.nextTick) < 0))
+    {
+        return;
+    }
+
+    TimeSyncMessage request = {};
+    request.type = TIME_SYNC_REQUEST;
+    request.sequence = (uint16_t)(syncState.sequence + 1U);
+    request.t1 = clockSyncLocalUs();
+    uint8_t frame[TIME_SYNC_FRAME_SIZE];
+    size_t length = request.encode(frame, sizeof(frame));
+
+    // Busy transmitter: the stamp would not be the send time, retry on the next poll
+    if(uartLinkSendService(frame, (uint16_t)length) != HAL_OK)
+    {
+        return;
+    }
+
+    syncState.sequence = request.sequence;
+    syncState.requestUs = request.t1;
+    syncState.requestTick = tick;
+    syncState.awaiting = true;
+    syncState.requests++;
+    bool fast = syncState.exchanges < FAST_EXCHANGES || !clockSyncIsSynced();
+    syncState.nextTick = tick + (fast ? FAST_PERIOD_MS : SLOW_PERIOD_MS);
+}
+
+void clockSyncHandleFrame(const uint8_t *payload, uint16_t length, uint32_t rxCycles)
+{
+    uint64_t receivedUs = clockSyncCyclesToLocalUs(rxCycles);
+
+    TimeSyncMessage response;
+    if(!response.decode(payload, length) || response.type != TIME_SYNC_RESPONSE || !syncState.awaiting ||
+       response.sequence != syncState.sequence || response.t1 != syncState.requestUs)
+    {
+        return;
+    }
+    syncState.awaiting = false;
+    syncState.responses++;
+    syncState.exchanges++;
+
+    // The fit runs outside the critical section on a copy
+    uint32_t state = HAL_CriticalEnter();
+    TimeSyncClock updated = syncState.clock;
+    HAL_CriticalExit(state);
+
+    updated.addSample(response.t1, response.t2, response.t3, receivedUs);
+
+    state = HAL_CriticalEnter();
+    syncState.clock = updated;
+    HAL_CriticalExit(state);
+}
+
+int clockSyncIsSynced(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    bool synced = syncState.clock.synced();
+    HAL_CriticalExit(state);
+    return synced ? 1 : 0;
+}
+
+uint64_t clockSyncWallUs(void)
+{
+    return clockSyncToWallUs(clockSyncLocalUs());
+}
+
+uint64_t clockSyncToWallUs(uint64_t localUs)
+{
+    uint32_t state = HAL_CriticalEnter();
+    uint64_t wall = syncState.clock.synced() ? syncState.clock.toReference(localUs) : 0;
+    HAL_CriticalExit(state);
+    return wall;
+}
+
+void clockSyncGetStats(ClockSyncStats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    TimeSyncClockStats clock = syncState.clock.stats();
+    stats->synced = syncState.clock.synced() ? 1U : 0U;
+    HAL_CriticalExit(state);
+
+    stats->requests = syncState.requests;
+    stats->responses = syncState.responses;
+    stats->timeouts = syncState.timeouts;
+    stats->accepted = clock.accepted;
+    stats->steps = clock.steps;
+    stats->lastCorrectionUs = (int32_t)clock.lastCorrectionUs;
+    stats->delayUs = clock.lastDelayUs;
+    stats->minDelayUs = clock.minDelayUs;
+    stats->driftPpb = clock.driftPpb;
+    stats->jitterUs = clock.jitterUs;
+}
+
+} // extern "C"
@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file           : cpu_budget.cpp
+  * @brief          : Per-task CPU budgets with throttling
+  ******************************************************************************
+  */
+
+#include "cpu_budget.h"
+#include "budget_ledger.h"
+
+#include <stddef.h>
+
+namespace {
+
+static_assert(CPU_BUDGET_MAX_TASKS == BUDGET_LEDGER_MAX_ACCOUNTS, "Table sizes differ");
+
+constexpr uint32_t MONITOR_STACK_WORDS = 256;
+constexpr uint32_t MONITOR_PRIORITY = 6;        // Above the high work lane, it has to preempt any of them
+
+struct TaskBudget
+{
+    void *task;
+    CpuBudgetAction action;
+    uint32_t permille;
+    uint32_t basePriority;          // Restored after a demotion
+    uint32_t demotedPriority;
+};
+
+struct CpuBudgetService
+{
+    BudgetLedger ledger;
+    TaskBudget tasks[CPU_BUDGET_MAX_TASKS];
+    void *monitor;
+    uint32_t periodMs;
+    uint32_t checkMs;
+    uint32_t periodStartMs;
+};
+
+CpuBudgetService budget;
+
+uint32_t periodCycles(void)
+{
+    return (HAL_RCC_GetHCLKFreq() / 1000U) * budget.periodMs;
+}
+
+uint32_t budgetCycles(uint32_t permille)
+{
+    return (uint32_t)(((uint64_t)periodCycles() * permille) / 1000U);
+}
+
+uint32_t toPermille(uint32_t cycles)
+{
+    uint32_t period = periodCycles();
+    return period == 0 ? 0 : (uint32_t)(((uint64_t)cycles * 1000U) / period);
+}
+
+/**
+ * @brief One level below the base priority, clamped to the floor and never above the base
+ */
+uint32_t demotedPriority(uint32_t basePriority)
+{
+    if(basePriority <= CPU_BUDGET_DEMOTE_FLOOR)
+    {
+        return basePriority;
+    }
+    return basePriority - 1U;
+}
+
+void penalize(const TaskBudget &entry, BudgetEvent event)
+{
+    if(event == BUDGET_EXCEEDED)
+    {
+        if(entry.action == CPU_BUDGET_DEMOTE)
+        {
+            HAL_TaskSetPriority(entry.task, entry.demotedPriority);
+        }
+        else if(entry.action == CPU_BUDGET_SUSPEND)
+        {
+            HAL_TaskSuspend(entry.task);
+        }
+    }
+    else if(event == BUDGET_RESTORED)
+    {
+        if(entry.action == CPU_BUDGET_DEMOTE)
+        {
+            HAL_TaskSetPriority(entry.task, entry.basePriority);
+        }
+        else if(entry.action == CPU_BUDGET_SUSPEND)
+        {
+            HAL_TaskResume(entry.task);
+        }
+    }
+}
+
+void monitorMain(void *arg)
+{
+    (void)arg;
+
+    uint32_t waitMs = budget.checkMs;
+    for(;;)
+    {
+        HAL_WorkerWait(waitMs);
+
+        uint32_t now = HAL_GetTick();
+        bool replenish = now - budget.periodStartMs >= budget.periodMs;
+        if(replenish)
+        {
+            // Keep the period grid unless the monitor was held off for more than a period
+            budget.periodStartMs = (now - budget.periodStartMs >= 2U * budget.periodMs) ? now
+                                   : budget.periodStartMs + budget.periodMs;
+        }
+
+        uint32_t state = HAL_CriticalEnter();
+        size_t count = budget.ledger.count();
+        HAL_CriticalExit(state);
+
+        bool busy = false;
+        for(size_t i = 0; i < count; i++)
+        {
+            const TaskBudget &entry = budget.tasks[i];
+            uint32_t counter = HAL_TaskRunTime(entry.task);
+
+            state = HAL_CriticalEnter();
+            busy = busy || counter != budget.ledger.account(i).lastCounter || budget.ledger.account(i).throttled;
+            BudgetEvent event;
+            if(replenish)
+            {
+                event = budget.ledger.replenish(i, counter);
+                budget.ledger.setBudget(i, budgetCycles(entry.permille));
+            }
+            else
+            {
+                event = budget.ledger.charge(i, counter);
+            }
+            HAL_CriticalExit(state);
+
+            // Kernel calls outside the critical section, they may switch tasks
+            penalize(entry, event);
+        }
+
+        // Nothing ran since the last check: sleep to the end of the period instead of cutting idle time short
+        uint32_t elapsed = HAL_GetTick() - budget.periodStartMs;
+        uint32_t remaining = elapsed < budget.periodMs ? budget.periodMs - elapsed : 1U;
+        waitMs = busy || remaining < budget.checkMs ? budget.checkMs : remaining;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef cpuBudgetInit(uint32_t periodMs, uint32_t checkMs)
+{
+    if(budget.monitor != NULL)
+    {
+        return HAL_OK;
+    }
+    if(periodMs == 0 || checkMs == 0 || checkMs > periodMs)
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_EnableCycleCounter();
+    budget.periodMs = periodMs;
+    budget.checkMs = checkMs;
+    budget.periodStartMs = HAL_GetTick();
+    return HAL_WorkerCreate(monitorMain, NULL, "cpuBudget", MONITOR_STACK_WORDS, MONITOR_PRIORITY, &budget.monitor);
+}
+
+HAL_StatusTypeDef cpuBudgetRegister(void *task, const char *name, uint32_t budgetPermille, CpuBudgetAction action)
+{
+    if(task == NULL || budgetPermille > 1000U || budget.periodMs == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef status = HAL_ERROR;
+    uint32_t basePriority = HAL_TaskGetPriority(task);
+    uint32_t counter = HAL_TaskRunTime(task);
+
+    uint32_t state = HAL_CriticalEnter();
+    size_t index = budget.ledger.count();
+    if(index < CPU_BUDGET_MAX_TASKS)
+    {
+        // The entry is filled before the account appears, the monitor reads it without the lock
+        budget.tasks[index] = TaskBudget{task, action, budgetPermille, basePriority, demotedPriority(basePriority)};
+        if(budget.ledger.add(task, name, budgetCycles(budgetPermille), counter))
+        {
+            status = HAL_OK;
+        }
+    }
+    HAL_CriticalExit(state);
+    return status;
+}
+
+HAL_StatusTypeDef cpuBudgetSet(void *task, uint32_t budgetPermille)
+{
+    if(budgetPermille > 1000U)
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef status = HAL_ERROR;
+    uint32_t state = HAL_CriticalEnter();
+    size_t index = budget.ledger.find(task);
+    if(index < budget.ledger.count())
+    {
+        budget.tasks[index].permille = budgetPermille;
+        budget.ledger.setBudget(index, budgetCycles(budgetPermille));
+        status = HAL_OK;
+    }
+    HAL_CriticalExit(state);
+    return status;
+}
+
+uint32_t cpuBudgetGetStats(CpuBudgetTaskStats *stats, uint32_t max)
+{
+    if(stats == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    uint32_t count = (uint32_t)budget.ledger.count();
+    count = count < max ? count : max;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const BudgetAccount &account = budget.ledger.account(i);
+        stats[i].name = account.name;
+        stats[i].budgetPermille = budget.tasks[i].permille;
+        stats[i].lastPermille = toPermille(account.lastPeriod);
+        stats[i].peakPermille = toPermille(account.peak);
+        stats[i].violations = account.violations;
+        stats[i].throttledPeriods = account.throttledPeriods;
+        stats[i].throttled = account.throttled ? 1U : 0U;
+    }
+    HAL_CriticalExit(state);
+    return count;
+}
+
+} // extern "C"
@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file           : hal_callbacks.cpp
+  * @brief          : Routing of HAL completion callbacks to app drivers
+  ******************************************************************************
+  */
+
+#include "hal_callbacks.h"
+#include "trace_recorder.h"
+
+#include <stddef.h>
+
+namespace {
+
+template <typename Handle, typename Callbacks>
+struct Route
+{
+    Handle *handle;
+    const Callbacks *callbacks;
+    void *ctx;
+};
+
+template <typename Handle, typename Callbacks, uint32_t N>
+const Route<Handle, Callbacks> *findRoute(const Route<Handle, Callbacks> (&routes)[N], const Handle *handle)
+{
+    for(uint32_t i = 0; i < N; i++)
+    {
+        if(routes[i].handle == handle && routes[i].callbacks != NULL)
+        {
+            return &routes[i];
+        }
+    }
+    return NULL;
+}
+
+template <typename Handle, typename Callbacks, uint32_t N>
+HAL_StatusTypeDef registerRoute(Route<Handle, Callbacks> (&routes)[N], Handle *handle, const Callbacks *callbacks, void *ctx)
+{
+    if(handle == NULL || callbacks == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    Route<Handle, Callbacks> *freeRoute = NULL;
+    for(uint32_t i = 0; i < N; i++)
+    {
+        if(routes[i].handle == handle)
+        {
+            freeRoute = &routes[i];
+            break;
+        }
+        if(freeRoute == NULL && routes[i].handle == NULL)
+        {
+            freeRoute = &routes[i];
+        }
+    }
+
+    if(freeRoute == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    // Publish the handle last so an interrupt never sees a half-filled entry
+    freeRoute->callbacks = callbacks;
+    freeRoute->ctx = ctx;
+    freeRoute->handle = handle;
+    return HAL_OK;
+}
+
+template <typename Handle, typename Callbacks, uint32_t N>
+void unregisterRoute(Route<Handle, Callbacks> (&routes)[N], const Handle *handle)
+{
+    for(uint32_t i = 0; i < N; i++)
+    {
+        if(routes[i].handle == handle)
+        {
+            routes[i].handle = NULL;
+            routes[i].callbacks = NULL;
+            routes[i].ctx = NULL;
+        }
+    }
+}
+
+typedef Route<UART_HandleTypeDef, HalUartCallbacks> UartRoute;
+typedef Route<SPI_HandleTypeDef, HalSpiCallbacks> SpiRoute;
+typedef Route<SMBUS_HandleTypeDef, HalSmbusCallbacks> SmbusRoute;
+
+UartRoute uartRoutes[HAL_CALLBACKS_MAX_UART];
+SpiRoute spiRoutes[HAL_CALLBACKS_MAX_SPI];
+SmbusRoute smbusRoutes[HAL_CALLBACKS_MAX_SMBUS];
+
+void spiTransferComplete(SPI_HandleTypeDef *hspi)
+{
+    const SpiRoute *route = findRoute(spiRoutes, hspi);
+    if(route != NULL && route->callbacks->transferComplete != NULL)
+    {
+        route->callbacks->transferComplete(route->ctx);
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef halUartRegisterCallbacks(UART_HandleTypeDef *huart, const HalUartCallbacks *callbacks, void *ctx)
+{
+    return registerRoute(uartRoutes, huart, callbacks, ctx);
+}
+
+void halUartUnregisterCallbacks(UART_HandleTypeDef *huart)
+{
+    unregisterRoute(uartRoutes, huart);
+}
+
+HAL_StatusTypeDef halSpiRegisterCallbacks(SPI_HandleTypeDef *hspi, const HalSpiCallbacks *callbacks, void *ctx)
+{
+    return registerRoute(spiRoutes, hspi, callbacks, ctx);
+}
+
+void halSpiUnregisterCallbacks(SPI_HandleTypeDef *hspi)
+{
+    unregisterRoute(spiRoutes, hspi);
+}
+
+HAL_StatusTypeDef halSmbusRegisterCallbacks(SMBUS_HandleTypeDef *hsmbus, const HalSmbusCallbacks *callbacks, void *ctx)
+{
+    return registerRoute(smbusRoutes, hsmbus, callbacks, ctx);
+}
+
+void halSmbusUnregisterCallbacks(SMBUS_HandleTypeDef *hsmbus)
+{
+    unregisterRoute(smbusRoutes, hsmbus);
+}
+
+// ===============================
+// HAL callback overrides
+// ===============================
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    traceRecordUartRxEvent(huart, Size);
+
+    const UartRoute *route = findRoute(uartRoutes, huart);
+    if(route != NULL && route->callbacks->rxEvent != NULL)
+    {
+        route->callbacks->rxEvent(route->ctx, Size);
+    }
+}
+
+void HAL_UARTEx_WakeupCallback(UART_HandleTypeDef *huart)
+{
+    const UartRoute *route = findRoute(uartRoutes, huart);
+    if(route != NULL && route->callbacks->wakeup != NULL)
+    {
+        route->callbacks->wakeup(route->ctx);
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    traceRecordUartError(huart);
+
+    const UartRoute *route = findRoute(uartRoutes, huart);
+    if(route != NULL && route->callbacks->error != NULL)
+    {
+        route->callbacks->error(route->ctx);
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    traceRecordUartTxDone(huart);
+
+    const UartRoute *route = findRoute(uartRoutes, huart);
+    if(route != NULL && route->callbacks->txComplete != NULL)
+    {
+        route->callbacks->txComplete(route->ctx);
+    }
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    spiTransferComplete(hspi);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    spiTransferComplete(hspi);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    spiTransferComplete(hspi);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    const SpiRoute *route = findRoute(spiRoutes, hspi);
+    if(route != NULL && route->callbacks->error != NULL)
+    {
+        route->callbacks->error(route->ctx);
+    }
+}
+
+void HAL_SMBUS_MasterTxCpltCallback(SMBUS_HandleTypeDef *hsmbus)
+{
+    const SmbusRoute *route = findRoute(smbusRoutes, hsmbus);
+    if(route != NULL && route->callbacks->transmitComplete != NULL)
+    {
+        route->callbacks->transmitComplete(route->ctx);
+    }
+}
+
+void HAL_SMBUS_ErrorCallback(SMBUS_HandleTypeDef *hsmbus)
+{
+    const SmbusRoute *route = findRoute(smbusRoutes, hsmbus);
+    if(route != NULL && route->callbacks->error != NULL)
+    {
+        route->callbacks->error(route->ctx);
+    }
+}
+
+}
@@ -0,0 +1,630 @@
+/**
+ ******************************************************************************
+ * @file           : hal_implementations.cpp
+ * @brief          : HAL function weak implementations for Drivers
+ ******************************************************************************
+ */
+
+#include "hal_types.h"
+#include "logging.h"
+#include "SEGGER_RTT.h"
+#define __weak __attribute__((used))  __attribute__((weak))
+
+extern "C" {
+
+// ===============================
+// Weak HAL implementations for Drivers library
+// ===============================
+
+/**
+ * @brief Weak implementation of UART Get Error
+ */
+__weak uint32_t HAL_UART_GetError(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_UART_GetError not implemented by platform\n\r");
+    return HAL_UART_ERROR_NONE;
+}
+
+/**
+ * @brief Weak implementation of UART Abort Receive
+ */
+__weak HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_UART_AbortReceive not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of UART Receive To Idle DMA
+ */
+__weak HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    logWrite(LOG_WARN, "HAL_UARTEx_ReceiveToIdle_DMA not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of UART Get Rx Event Type
+ */
+__weak HAL_UART_RxEventTypeTypeDef HAL_UARTEx_GetRxEventType(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return HAL_UART_RXEVENT_IDLE;
+}
+
+/**
+ * @brief Weak implementation of UART Stop Mode Wake Up Source Config
+ */
+__weak HAL_StatusTypeDef HAL_UARTEx_StopModeWakeUpSourceConfig(UART_HandleTypeDef *huart, UART_WakeUpTypeDef WakeUpSelection)
+{
+    (void)huart;
+    (void)WakeUpSelection;
+    logWrite(LOG_WARN, "HAL_UARTEx_StopModeWakeUpSourceConfig not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of UART Enable Stop Mode
+ */
+__weak HAL_StatusTypeDef HAL_UARTEx_EnableStopMode(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_UARTEx_EnableStopMode not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of UART Disable Stop Mode
+ */
+__weak HAL_StatusTypeDef HAL_UARTEx_DisableStopMode(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_UARTEx_DisableStopMode not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of UART Transmit DMA
+ */
+__weak HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    logWrite(LOG_WARN, "HAL_UART_Transmit_DMA not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of RS485 Init
+ */
+__weak HAL_StatusTypeDef HAL_RS485Ex_Init(UART_HandleTypeDef *huart, uint32_t Polarity, uint32_t AssertionTime, uint32_t DeassertionTime)
+{
+    (void)huart;
+    (void)Polarity;
+    (void)AssertionTime;
+    (void)DeassertionTime;
+    logWrite(LOG_WARN, "HAL_RS485Ex_Init not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of Multi Processor Init
+ */
+__weak HAL_StatusTypeDef HAL_MultiProcessor_Init(UART_HandleTypeDef *huart, uint8_t Address, uint32_t WakeUpMethod)
+{
+    (void)huart;
+    (void)Address;
+    (void)WakeUpMethod;
+    logWrite(LOG_WARN, "HAL_MultiProcessor_Init not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of Multi Processor Address Length Set
+ */
+__weak HAL_StatusTypeDef HAL_MultiProcessorEx_AddressLength_Set(UART_HandleTypeDef *huart, uint32_t AddressLength)
+{
+    (void)huart;
+    (void)AddressLength;
+    logWrite(LOG_WARN, "HAL_MultiProcessorEx_AddressLength_Set not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of Multi Processor Enable Mute Mode
+ */
+__weak HAL_StatusTypeDef HAL_MultiProcessor_EnableMuteMode(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_MultiProcessor_EnableMuteMode not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of Multi Processor Enter Mute Mode
+ */
+__weak void HAL_MultiProcessor_EnterMuteMode(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_MultiProcessor_EnterMuteMode not implemented by platform\n\r");
+}
+
+/**
+ * @brief Weak implementation of SPI Transmit Receive DMA
+ */
+__weak HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size)
+{
+    (void)hspi;
+    (void)pTxData;
+    (void)pRxData;
+    (void)Size;
+    logWrite(LOG_WARN, "HAL_SPI_TransmitReceive_DMA not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of SPI Transmit DMA
+ */
+__weak HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size)
+{
+    (void)hspi;
+    (void)pData;
+    (void)Size;
+    logWrite(LOG_WARN, "HAL_SPI_Transmit_DMA not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of SPI Receive DMA
+ */
+__weak HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    (void)hspi;
+    (void)pData;
+    (void)Size;
+    logWrite(LOG_WARN, "HAL_SPI_Receive_DMA not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of SPI Abort
+ */
+__weak HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    logWrite(LOG_WARN, "HAL_SPI_Abort not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of SPI Set Device Config
+ */
+__weak HAL_StatusTypeDef HAL_SPI_SetDeviceConfig(SPI_HandleTypeDef *hspi, uint32_t clockHz, uint8_t mode)
+{
+    (void)hspi;
+    (void)clockHz;
+    (void)mode;
+    logWrite(LOG_WARN, "HAL_SPI_SetDeviceConfig not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of GPIO Write Pin
+ */
+__weak void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    (void)GPIOx;
+    (void)GPIO_Pin;
+    (void)PinState;
+}
+
+/**
+ * @brief Weak implementation of RCC Get HCLK Freq
+ * @note  Straight to RTT, logWrite reads the clock for its timestamps
+ */
+__weak uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    SEGGER_RTT_printf(0, "WARNING: HAL_RCC_GetHCLKFreq not implemented by platform\n\r");
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Enter Stop Mode - falls back to Sleep
+ * @note  Called from the idle hook, so it stays silent
+ */
+__weak void HAL_EnterStopMode(uint32_t depth)
+{
+    (void)depth;
+#if defined(__arm__)
+    __asm volatile ("dsb\n\twfi\n\tisb" ::: "memory");
+#endif
+}
+
+/**
+ * @brief Weak implementation of Exit Stop Mode - nothing to restore after Sleep
+ */
+__weak void HAL_ExitStopMode(uint32_t depth)
+{
+    (void)depth;
+}
+
+/**
+ * @brief Weak implementation of Enable Cycle Counter - uses the DWT on Cortex-M
+ */
+__weak void HAL_EnableCycleCounter(void)
+{
+#if defined(__arm__)
+    volatile uint32_t *demcr = (volatile uint32_t *)0xE000EDFCU;
+    volatile uint32_t *dwtCtrl = (volatile uint32_t *)0xE0001000U;
+    *demcr |= (1UL << 24);  // TRCENA
+    *dwtCtrl |= 1UL;        // CYCCNTENA
+#endif
+}
+
+/**
+ * @brief Weak implementation of Get Cycle Count - reads DWT CYCCNT on Cortex-M
+ */
+__weak uint32_t HAL_GetCycleCount(void)
+{
+#if defined(__arm__)
+    return *(volatile uint32_t *)0xE0001004U;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Weak implementation of Periph Clock Enable
+ */
+__weak void HAL_PeriphClockEnable(uint32_t clock)
+{
+    logWrite(LOG_WARN, "HAL_PeriphClockEnable(%u) not implemented by platform\n\r", (unsigned int)clock);
+}
+
+/**
+ * @brief Weak implementation of Periph Clock Disable
+ */
+__weak void HAL_PeriphClockDisable(uint32_t clock)
+{
+    logWrite(LOG_WARN, "HAL_PeriphClockDisable(%u) not implemented by platform\n\r", (unsigned int)clock);
+}
+
+/**
+ * @brief Weak implementation of Power Domain Enable
+ */
+__weak void HAL_PowerDomainEnable(uint32_t domain)
+{
+    logWrite(LOG_WARN, "HAL_PowerDomainEnable(%u) not implemented by platform\n\r", (unsigned int)domain);
+}
+
+/**
+ * @brief Weak implementation of Power Domain Disable
+ */
+__weak void HAL_PowerDomainDisable(uint32_t domain)
+{
+    logWrite(LOG_WARN, "HAL_PowerDomainDisable(%u) not implemented by platform\n\r", (unsigned int)domain);
+}
+
+/**
+ * @brief Weak implementation of Critical Enter - masks interrupts via PRIMASK on Cortex-M
+ * @retval Previous PRIMASK value
+ */
+__weak uint32_t HAL_CriticalEnter(void)
+{
+#if defined(__arm__)
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    return primask;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Weak implementation of Critical Exit - restores PRIMASK on Cortex-M
+ */
+__weak void HAL_CriticalExit(uint32_t state)
+{
+#if defined(__arm__)
+    __asm volatile ("msr primask, %0" :: "r" (state) : "memory");
+#else
+    (void)state;
+#endif
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Command
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorCommand(const XSPI_NorCommandTypeDef *cmd)
+{
+    (void)cmd;
+    logWrite(LOG_WARN, "HAL_XSPI_NorCommand not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Read
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorRead(const XSPI_NorCommandTypeDef *cmd, uint8_t *pData)
+{
+    (void)cmd;
+    (void)pData;
+    logWrite(LOG_WARN, "HAL_XSPI_NorRead not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Write
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorWrite(const XSPI_NorCommandTypeDef *cmd, const uint8_t *pData)
+{
+    (void)cmd;
+    (void)pData;
+    logWrite(LOG_WARN, "HAL_XSPI_NorWrite not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Wait Ready
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorWaitReady(uint8_t statusInstruction, uint8_t busyMask, uint32_t timeoutMs)
+{
+    (void)statusInstruction;
+    (void)busyMask;
+    (void)timeoutMs;
+    logWrite(LOG_WARN, "HAL_XSPI_NorWaitReady not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Memory Mapped
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorMemoryMapped(const XSPI_NorCommandTypeDef *readCmd, const uint8_t **mappedBase)
+{
+    (void)readCmd;
+    *mappedBase = 0;
+    logWrite(LOG_WARN, "HAL_XSPI_NorMemoryMapped not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Abort
+ */
+__weak HAL_StatusTypeDef HAL_XSPI_NorAbort(void)
+{
+    logWrite(LOG_WARN, "HAL_XSPI_NorAbort not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of XSPI NOR Invalidate Cache - no data cache to maintain
+ */
+__weak void HAL_XSPI_NorInvalidateCache(const uint8_t *address, uint32_t size)
+{
+    (void)address;
+    (void)size;
+}
+
+/**
+ * @brief Weak implementation of FLASH Program Unit
+ */
+__weak HAL_StatusTypeDef HAL_FLASH_ProgramUnit(uint32_t address, const uint8_t *pData)
+{
+    (void)address;
+    (void)pData;
+    logWrite(LOG_WARN, "HAL_FLASH_ProgramUnit not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of FLASH Program Row
+ */
+__weak HAL_StatusTypeDef HAL_FLASH_ProgramRow(uint32_t address, const uint8_t *pData)
+{
+    (void)address;
+    (void)pData;
+    logWrite(LOG_WARN, "HAL_FLASH_ProgramRow not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of FLASH Erase Start
+ */
+__weak HAL_StatusTypeDef HAL_FLASH_EraseStart(uint32_t address)
+{
+    (void)address;
+    logWrite(LOG_WARN, "HAL_FLASH_EraseStart not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of FLASH Erase Status - erases finish at once
+ */
+__weak HAL_StatusTypeDef HAL_FLASH_EraseStatus(void)
+{
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of FLASH Code Bank - single bank
+ */
+__weak uint32_t HAL_FLASH_CodeBank(void)
+{
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Us Timer Start
+ */
+__weak HAL_StatusTypeDef HAL_UsTimerStart(void)
+{
+    logWrite(LOG_WARN, "HAL_UsTimerStart not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of Us Timer Now - millisecond tick scaled up
+ */
+__weak uint32_t HAL_UsTimerNow(void)
+{
+    return HAL_GetTick() * 1000U;
+}
+
+/**
+ * @brief Weak implementation of Us Timer Set Compare - no compare interrupt
+ */
+__weak void HAL_UsTimerSetCompare(uint32_t deadline)
+{
+    (void)deadline;
+}
+
+/**
+ * @brief Weak implementation of Us Timer Disable Compare
+ */
+__weak void HAL_UsTimerDisableCompare(void)
+{
+}
+
+/**
+ * @brief Weak implementation of Us Timer Force
+ */
+__weak void HAL_UsTimerForce(void)
+{
+}
+
+/**
+ * @brief Weak implementation of Get Tick - no time base
+ */
+__weak uint32_t HAL_GetTick(void)
+{
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of UART Set Baud Rate
+ */
+__weak HAL_StatusTypeDef HAL_UART_SetBaudRate(UART_HandleTypeDef *huart, uint32_t baudRate)
+{
+    (void)huart;
+    (void)baudRate;
+    logWrite(LOG_WARN, "HAL_UART_SetBaudRate not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of UART Get Kernel Clock Freq
+ */
+__weak uint32_t HAL_UART_GetKernelClockFreq(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    logWrite(LOG_WARN, "HAL_UART_GetKernelClockFreq not implemented by platform\n\r");
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Worker Create
+ */
+__weak HAL_StatusTypeDef HAL_WorkerCreate(void (*entry)(void *arg), void *arg, const char *name,
+                                          uint32_t stackWords, uint32_t priority, void **handle)
+{
+    (void)entry;
+    (void)arg;
+    (void)name;
+    (void)stackWords;
+    (void)priority;
+    *handle = 0;
+    logWrite(LOG_WARN, "HAL_WorkerCreate not implemented by platform\n\r");
+    return HAL_ERROR;
+}
+
+/**
+ * @brief Weak implementation of Worker Notify - may run in interrupt context, stays silent
+ */
+__weak void HAL_WorkerNotify(void *handle)
+{
+    (void)handle;
+}
+
+/**
+ * @brief Weak implementation of Worker Wait
+ */
+__weak void HAL_WorkerWait(uint32_t timeoutMs)
+{
+    (void)timeoutMs;
+    logWrite(LOG_WARN, "HAL_WorkerWait not implemented by platform\n\r");
+}
+
+/**
+ * @brief Weak implementation of Get Idle Cycles
+ */
+__weak uint32_t HAL_GetIdleCycles(void)
+{
+    logWrite(LOG_WARN, "Weak HAL_GetIdleCycles called - platform should implement this!\n\r");
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Task Name
+ */
+__weak const char *HAL_TaskName(const void *task)
+{
+    (void)task;
+    logWrite(LOG_WARN, "Weak HAL_TaskName called - platform should implement this!\n\r");
+    return "?";
+}
+
+/**
+ * @brief Weak implementation of Task Run Time
+ */
+__weak uint32_t HAL_TaskRunTime(void *task)
+{
+    (void)task;
+    logWrite(LOG_WARN, "Weak HAL_TaskRunTime called - platform should implement this!\n\r");
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Task Get Priority
+ */
+__weak uint32_t HAL_TaskGetPriority(void *task)
+{
+    (void)task;
+    logWrite(LOG_WARN, "Weak HAL_TaskGetPriority called - platform should implement this!\n\r");
+    return 0;
+}
+
+/**
+ * @brief Weak implementation of Task Set Priority
+ */
+__weak void HAL_TaskSetPriority(void *task, uint32_t priority)
+{
+    (void)task;
+    (void)priority;
+    logWrite(LOG_WARN, "Weak HAL_TaskSetPriority called - platform should implement this!\n\r");
+}
+
+/**
+ * @brief Weak implementation of Task Suspend
+ */
+__weak void HAL_TaskSuspend(void *task)
+{
+    (void)task;
+    logWrite(LOG_WARN, "Weak HAL_TaskSuspend called - platform should implement this!\n\r");
+}
+
+/**
+ * @brief Weak implementation of Task Resume
+ */
+__weak void HAL_TaskResume(void *task)
+{
+    (void)task;
+    logWrite(LOG_WARN, "Weak HAL_TaskResume called - platform should implement this!\n\r");
+}
+
+}
@@ -0,0 +1,508 @@
+/**
+  ******************************************************************************
+  * @file           : internal_flash.cpp
+  * @brief          : Internal flash storage with fast programming and background erase
+  ******************************************************************************
+  */
+
+#include "internal_flash.h"
+#include "erase_scheduler.h"
+#include "power_manager.h"
+
+#include <string.h>
+
+#include <atomic>
+
+namespace {
+
+constexpr uint32_t WORKER_STACK_WORDS = 256;
+constexpr uint32_t WORKER_PRIORITY = 0;         // Shares the idle level, runs only when everything else waits
+constexpr uint32_t WORKER_ERASE_POLL_MS = 1;
+constexpr uint32_t WAIT_FOREVER = 0xFFFFFFFFU;
+constexpr uint32_t MAX_PROGRAM_UNIT = 32;
+
+struct InternalFlash
+{
+    InternalFlashConfig config;
+    EraseScheduler pages;
+    uint32_t codeFirst;             // Region pages in the bank the code runs from
+    uint32_t codeCount;
+
+    // Shared with the worker, changed inside critical sections
+    bool eraseActive;
+    bool eraseInForeground;
+    uint32_t erasingPage;
+    uint32_t eraseStart;
+    bool programming;
+
+    std::atomic<uint32_t> guards;
+    void *worker;
+    bool ready;
+    InternalFlashStats stats;
+};
+
+InternalFlash flash;
+
+uint32_t pageOf(uint32_t offset)
+{
+    return offset / flash.config.pageSize;
+}
+
+bool inRange(uint32_t offset, uint32_t length)
+{
+    return offset <= flash.config.size && length <= flash.config.size - offset;
+}
+
+void noteStall(uint32_t cycles)
+{
+    if(cycles > flash.stats.maxStallCycles)
+    {
+        flash.stats.maxStallCycles = cycles;
+    }
+}
+
+bool inCodeBank(uint32_t page)
+{
+    return page >= flash.codeFirst && page - flash.codeFirst < flash.codeCount;
+}
+
+/**
+ * @brief Start erasing a page, inside a critical section
+ */
+HAL_StatusTypeDef startErase(uint32_t page, bool foreground)
+{
+    HAL_StatusTypeDef status = HAL_FLASH_EraseStart(flash.config.base + page * flash.config.pageSize);
+    if(status != HAL_OK)
+    {
+        flash.stats.errors++;
+        flash.pages.finished(page, false);
+        return status;
+    }
+
+    // Stop mode would abort the operation
+    powerManagerLockMode(POWER_MODE_SLEEP);
+    flash.pages.started(page);
+    flash.erasingPage = page;
+    flash.eraseActive = true;
+    flash.eraseInForeground = foreground;
+    flash.eraseStart = HAL_GetCycleCount();
+    return HAL_OK;
+}
+
+/**
+ * @brief Collect the active erase if it ended, inside a critical section
+ * @retval HAL_BUSY while it runs, otherwise its result
+ */
+HAL_StatusTypeDef finishErase(void)
+{
+    HAL_StatusTypeDef status = HAL_FLASH_EraseStatus();
+    if(status == HAL_BUSY)
+    {
+        return status;
+    }
+
+    uint32_t elapsed = HAL_GetCycleCount() - flash.eraseStart;
+    if(elapsed > flash.stats.maxEraseCycles)
+    {
+        flash.stats.maxEraseCycles = elapsed;
+    }
+    if(inCodeBank(flash.erasingPage))
+    {
+        // The core could not fetch for the whole erase
+        noteStall(elapsed);
+    }
+
+    flash.pages.finished(flash.erasingPage, status == HAL_OK);
+    flash.eraseActive = false;
+    powerManagerUnlockMode(POWER_MODE_SLEEP);
+    if(status == HAL_OK)
+    {
+        flash.stats.pagesErased++;
+        if(flash.eraseInForeground)
+        {
+            flash.stats.foregroundErases++;
+        }
+        else
+        {
+            flash.stats.backgroundErases++;
+        }
+    }
+    else
+    {
+        flash.stats.errors++;
+    }
+    return status;
+}
+
+/**
+ * @brief Block until the controller has no erase in flight
+ */
+HAL_StatusTypeDef waitErase(void)
+{
+    HAL_StatusTypeDef status = HAL_BUSY;
+    while(status == HAL_BUSY)
+    {
+        uint32_t state = HAL_CriticalEnter();
+        status = flash.eraseActive ? finishErase() : HAL_OK;
+        HAL_CriticalExit(state);
+    }
+    return status;
+}
+
+/**
+ * @brief Settle a page before it is used, waiting for or running its erase in front of the caller
+ * @param always Erase unless already erased; otherwise only a page queued for erase is erased
+ * @retval HAL status of the erase, HAL_OK if none was needed
+ */
+HAL_StatusTypeDef settlePage(uint32_t page, bool always)
+{
+    uint32_t start = HAL_GetCycleCount();
+    uint32_t state = HAL_CriticalEnter();
+    bool waited = flash.eraseActive;
+    HAL_CriticalExit(state);
+
+    // The controller runs one operation at a time, whatever page the worker picked
+    HAL_StatusTypeDef status = waitErase();
+    ErasePageState pageState = flash.pages.state(page);
+    if(always ? pageState != ERASE_PAGE_ERASED : pageState == ERASE_PAGE_QUEUED)
+    {
+        state = HAL_CriticalEnter();
+        status = startErase(page, true);
+        HAL_CriticalExit(state);
+        if(status == HAL_OK)
+        {
+            status = waitErase();
+        }
+        waited = true;
+    }
+
+    if(waited)
+    {
+        flash.stats.eraseWaits++;
+        noteStall(HAL_GetCycleCount() - start);
+    }
+    return status;
+}
+
+void workerMain(void *arg)
+{
+    (void)arg;
+    for(;;)
+    {
+        internalFlashPoll();
+
+        uint32_t state = HAL_CriticalEnter();
+        bool busy = flash.eraseActive || flash.pages.queued() > 0;
+        HAL_CriticalExit(state);
+        HAL_WorkerWait(busy ? WORKER_ERASE_POLL_MS : WAIT_FOREVER);
+    }
+}
+
+bool pageBlank(uint32_t page)
+{
+    const uint32_t *word = (const uint32_t *)(uintptr_t)(flash.config.base + page * flash.config.pageSize);
+    for(uint32_t i = 0; i < flash.config.pageSize / sizeof(uint32_t); i++)
+    {
+        if(word[i] != 0xFFFFFFFFU)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t toKBps(uint32_t bytes, uint32_t cycles)
+{
+    if(cycles == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)bytes * HAL_RCC_GetHCLKFreq()) / ((uint64_t)cycles * 1024U));
+}
+
+uint32_t toUs(uint32_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    return mhz == 0 ? 0 : cycles / mhz;
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef internalFlashInit(const InternalFlashConfig *config)
+{
+    if(config == NULL || config->pageSize == 0 || config->programUnit == 0 ||
+       config->programUnit > MAX_PROGRAM_UNIT || config->pageSize % config->programUnit != 0 ||
+       config->size == 0 || config->size % config->pageSize != 0 ||
+       config->base % config->pageSize != 0 || config->base < config->flashBase ||
+       (config->rowSize != 0 && (config->rowSize % config->programUnit != 0 ||
+                                 config->pageSize % config->rowSize != 0)))
+    {
+        return HAL_ERROR;
+    }
+
+    flash.ready = false;
+    flash.config = *config;
+    flash.eraseActive = false;
+    flash.programming = false;
+    flash.guards = 0;
+    memset(&flash.stats, 0, sizeof(flash.stats));
+    if(!flash.pages.init(config->size / config->pageSize, config->eraseAhead))
+    {
+        return HAL_ERROR;
+    }
+    HAL_EnableCycleCounter();
+
+    // Which region pages share the bank the code runs from
+    uint32_t count = flash.pages.pageCount();
+    flash.codeFirst = 0;
+    flash.codeCount = count;
+    if(config->bankSize != 0)
+    {
+        uint32_t codeBankStart = config->flashBase + HAL_FLASH_CodeBank() * config->bankSize;
+        uint32_t first = codeBankStart > config->base ? (codeBankStart - config->base) / config->pageSize : 0;
+        uint32_t end = (codeBankStart + config->bankSize - config->base) / config->pageSize;
+        flash.codeFirst = first < count ? first : count;
+        flash.codeCount = (end < count ? end : count) - flash.codeFirst;
+        if(codeBankStart + config->bankSize <= config->base)
+        {
+            flash.codeCount = 0;
+        }
+    }
+
+    for(uint32_t page = 0; page < count; page++)
+    {
+        flash.pages.checked(page, pageBlank(page));
+    }
+
+    if(flash.worker == NULL &&
+       HAL_WorkerCreate(workerMain, NULL, "flash erase", WORKER_STACK_WORDS, WORKER_PRIORITY, &flash.worker) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    flash.ready = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef internalFlashRead(uint32_t offset, uint8_t *data, uint32_t length)
+{
+    if(!flash.ready || data == NULL || !inRange(offset, length))
+    {
+        return HAL_ERROR;
+    }
+
+    // A read of a bank being erased stalls in hardware until the erase ends
+    memcpy(data, (const uint8_t *)(uintptr_t)(flash.config.base + offset), length);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef internalFlashProgram(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    uint32_t unit = flash.config.programUnit;
+    if(!flash.ready || data == NULL || !inRange(offset, length) || offset % unit != 0 || length % unit != 0)
+    {
+        return HAL_ERROR;
+    }
+    if(length == 0)
+    {
+        return HAL_OK;
+    }
+
+    uint32_t start = HAL_GetCycleCount();
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t done = 0;
+    uint32_t row = flash.config.rowSize;
+    while(done < length && status == HAL_OK)
+    {
+        uint32_t address = offset + done;
+        uint32_t page = pageOf(address);
+        if(address % flash.config.pageSize == 0 || done == 0)
+        {
+            status = settlePage(page, false);
+            if(status != HAL_OK)
+            {
+                break;
+            }
+
+            // Keep the worker off the controller until this page is done
+            uint32_t state = HAL_CriticalEnter();
+            flash.programming = true;
+            flash.pages.written(page);
+            HAL_CriticalExit(state);
+        }
+
+        if(row != 0 && address % row == 0 && length - done >= row)
+        {
+            status = HAL_FLASH_ProgramRow(flash.config.base + address, data + done);
+            done += status == HAL_OK ? row : 0;
+            flash.stats.rowsProgrammed += status == HAL_OK ? 1U : 0U;
+        }
+        else
+        {
+            // Program units are read whole, copy the source so it may be unaligned
+            uint8_t buffer[MAX_PROGRAM_UNIT];
+            memcpy(buffer, data + done, unit);
+            status = HAL_FLASH_ProgramUnit(flash.config.base + address, buffer);
+            done += status == HAL_OK ? unit : 0;
+            flash.stats.unitsProgrammed += status == HAL_OK ? 1U : 0U;
+        }
+
+        if((offset + done) % flash.config.pageSize == 0)
+        {
+            flash.programming = false;
+        }
+    }
+    flash.programming = false;
+
+    flash.stats.programCycles += HAL_GetCycleCount() - start;
+    flash.stats.bytesProgrammed += done;
+    if(status != HAL_OK)
+    {
+        flash.stats.errors++;
+    }
+    if(flash.worker != NULL)
+    {
+        HAL_WorkerNotify(flash.worker);
+    }
+    return status;
+}
+
+HAL_StatusTypeDef internalFlashErasePage(uint32_t offset)
+{
+    if(!flash.ready || offset >= flash.config.size)
+    {
+        return HAL_ERROR;
+    }
+    return settlePage(pageOf(offset), true);
+}
+
+HAL_StatusTypeDef internalFlashEraseAsync(uint32_t offset, uint32_t length)
+{
+    if(!flash.ready || !inRange(offset, length))
+    {
+        return HAL_ERROR;
+    }
+    if(length == 0)
+    {
+        return HAL_OK;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    for(uint32_t page = pageOf(offset); page <= pageOf(offset + length - 1U); page++)
+    {
+        flash.pages.request(page);
+    }
+    HAL_CriticalExit(state);
+
+    HAL_WorkerNotify(flash.worker);
+    return HAL_OK;
+}
+
+void internalFlashPoll(void)
+{
+    if(!flash.ready)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    if(flash.programming || (flash.eraseActive && finishErase() == HAL_BUSY))
+    {
+        HAL_CriticalExit(state);
+        return;
+    }
+
+    uint32_t page;
+    bool guarded = flash.guards.load() > 0;
+    if(flash.pages.next(page, flash.codeFirst, guarded ? flash.codeCount : 0))
+    {
+        (void)startErase(page, false);
+    }
+    else if(guarded && flash.pages.next(page))
+    {
+        flash.stats.deferredErases++;
+    }
+    HAL_CriticalExit(state);
+}
+
+void internalFlashGuardEnter(void)
+{
+    flash.guards++;
+}
+
+void internalFlashGuardExit(void)
+{
+    if(flash.guards.fetch_sub(1) == 1 && flash.worker != NULL)
+    {
+        HAL_WorkerNotify(flash.worker);
+    }
+}
+
+void internalFlashGetStats(InternalFlashStats *stats)
+{
+    if(stats != NULL)
+    {
+        uint32_t state = HAL_CriticalEnter();
+        *stats = flash.stats;
+        HAL_CriticalExit(state);
+    }
+}
+
+HAL_StatusTypeDef internalFlashBenchmark(uint32_t offset, uint8_t *buffer, InternalFlashBenchmark *result)
+{
+    uint32_t length = flash.config.pageSize;
+    if(!flash.ready || buffer == NULL || result == NULL || offset % length != 0 || !inRange(offset, length))
+    {
+        return HAL_ERROR;
+    }
+    memset(result, 0, sizeof(*result));
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        buffer[i] = (uint8_t)(i * 31U + 7U);
+    }
+
+    // Rows first; the rows pass needs the page erased, time that erase too
+    HAL_StatusTypeDef status = waitErase();
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    uint32_t state = HAL_CriticalEnter();
+    flash.pages.checked(pageOf(offset), false);
+    HAL_CriticalExit(state);
+    uint32_t start = HAL_GetCycleCount();
+    status = settlePage(pageOf(offset), true);
+    result->eraseUs = toUs(HAL_GetCycleCount() - start);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    start = HAL_GetCycleCount();
+    status = internalFlashProgram(offset, buffer, length);
+    result->rowProgramKBps = toKBps(length, HAL_GetCycleCount() - start);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    // Same page again in single units, with the rows disabled for the pass
+    status = settlePage(pageOf(offset), true);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    uint32_t row = flash.config.rowSize;
+    flash.config.rowSize = 0;
+    start = HAL_GetCycleCount();
+    status = internalFlashProgram(offset, buffer, length);
+    result->unitProgramKBps = toKBps(length, HAL_GetCycleCount() - start);
+    flash.config.rowSize = row;
+
+    result->maxStallUs = toUs(flash.stats.maxStallCycles);
+    return status;
+}
+
+} // extern "C"
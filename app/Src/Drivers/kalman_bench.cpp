@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file           : kalman_bench.cpp
+  * @brief          : Cycle counts of the Kalman filter update steps on the running core
+  ******************************************************************************
+  */
+
+#include "kalman_bench.h"
+#include "kalman.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr uint32_t RUNS = 4;
+
+/**
+ * @brief Position, velocity and acceleration per axis, the position measured
+ */
+template<typename T, size_t N>
+struct Tracker
+{
+    static constexpr size_t AXES = N / 3U;
+    static constexpr T DT = T(0.01);
+
+    Matrix<T, N, N> f = Matrix<T, N, N>::identity();
+    Matrix<T, AXES, N> h;
+    SymMatrix<T, N> q = SymMatrix<T, N>::diagonal(T(1e-4));
+    SymMatrix<T, AXES> r = SymMatrix<T, AXES>::diagonal(T(0.05));
+    Vector<T, AXES> z;
+
+    Tracker()
+    {
+        for(size_t a = 0; a < AXES; a++)
+        {
+            size_t i = 3U * a;
+            f(i, i + 1U) = DT;
+            f(i, i + 2U) = DT * DT / T(2);
+            f(i + 1U, i + 2U) = DT;
+            h(a, i) = T(1);
+            z(a, 0) = T(0.5) + T(a);
+        }
+    }
+
+    Vector<T, N> process(const Vector<T, N> &x) const { return f * x; }
+    Vector<T, AXES> measure(const Vector<T, N> &x) const { return h * x; }
+};
+
+template<typename Step>
+uint32_t best(Step step)
+{
+    uint32_t fastest = 0xFFFFFFFFU;
+    for(uint32_t run = 0; run < RUNS; run++)
+    {
+        uint32_t state = HAL_CriticalEnter();
+        uint32_t start = HAL_GetCycleCount();
+        bool ok = step();
+        uint32_t cycles = HAL_GetCycleCount() - start;
+        HAL_CriticalExit(state);
+        if(!ok)
+        {
+            return 0;
+        }
+        if(cycles < fastest)
+        {
+            fastest = cycles;
+        }
+    }
+    return fastest;
+}
+
+/**
+ * @brief EKF and UKF cycles for one size, 0 if a step failed
+ */
+template<typename T, size_t N>
+void benchmarkSize(uint32_t *ekfCycles, uint32_t *ukfCycles)
+{
+    // Static: the UKF sigma points of the larger double filters would crowd the caller's stack
+    static Tracker<T, N> model;
+    static ExtendedKalmanFilter<T, N> ekf;
+    static UnscentedKalmanFilter<T, N> ukf;
+    const Vector<T, N> x0;
+    const SymMatrix<T, N> p0 = SymMatrix<T, N>::identity();
+
+    *ekfCycles = best([&]() {
+        ekf.reset(x0, p0);
+        ekf.predict(model.process(ekf.state()), model.f, model.q);
+        return ekf.update(Vector<T, Tracker<T, N>::AXES>(model.z - model.measure(ekf.state())), model.h, model.r);
+    });
+    *ukfCycles = best([&]() {
+        ukf.reset(x0, p0);
+        return ukf.predict([&](const Vector<T, N> &x) { return model.process(x); }, model.q)
+            && ukf.update([&](const Vector<T, N> &x) { return model.measure(x); }, model.z, model.r);
+    });
+}
+
+template<typename T>
+void benchmarkPrecision(uint32_t *ekfCycles, uint32_t *ukfCycles)
+{
+    benchmarkSize<T, 3>(&ekfCycles[0], &ukfCycles[0]);
+    benchmarkSize<T, 6>(&ekfCycles[1], &ukfCycles[1]);
+    benchmarkSize<T, 12>(&ekfCycles[2], &ukfCycles[2]);
+}
+
+} // namespace
+
+HAL_StatusTypeDef kalmanBenchmark(KalmanBenchmark *result)
+{
+    if(result == NULL)
+    {
+        return HAL_ERROR;
+    }
+    memset(result, 0, sizeof(*result));
+    HAL_EnableCycleCounter();
+
+    benchmarkPrecision<float>(result->ekfFloatCycles, result->ukfFloatCycles);
+    benchmarkPrecision<double>(result->ekfDoubleCycles, result->ukfDoubleCycles);
+
+    for(size_t i = 0; i < KALMAN_BENCH_SIZES; i++)
+    {
+        if(result->ekfFloatCycles[i] == 0 || result->ukfFloatCycles[i] == 0
+           || result->ekfDoubleCycles[i] == 0 || result->ukfDoubleCycles[i] == 0)
+        {
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
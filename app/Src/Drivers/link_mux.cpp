@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file           : link_mux.cpp
+  * @brief          : Logical channels for logs, telemetry and the shell on the UART link
+  ******************************************************************************
+  */
+
+#include "link_mux.h"
+#include "uart_link.h"
+#include "channel_mux.h"
+#include "logging.h"
+
+namespace {
+
+uint8_t alarmTx[512];
+uint8_t alarmRx[16];
+uint8_t shellTx[512];
+uint8_t shellRx[128];
+uint8_t telemetryTx[512];
+uint8_t telemetryRx[16];
+uint8_t logTx[1024];
+uint8_t logRx[16];
+
+// Ids and priorities as in muxcat's default table
+const MuxChannelConfig channels[] = {
+    { LINK_MUX_ALARM,     0, alarmTx,     sizeof(alarmTx),     alarmRx,     sizeof(alarmRx) },
+    { LINK_MUX_SHELL,     1, shellTx,     sizeof(shellTx),     shellRx,     sizeof(shellRx) },
+    { LINK_MUX_TELEMETRY, 2, telemetryTx, sizeof(telemetryTx), telemetryRx, sizeof(telemetryRx) },
+    { LINK_MUX_LOG,       3, logTx,       sizeof(logTx),       logRx,       sizeof(logRx) },
+};
+
+static_assert(MUX_PAYLOAD_SIZE(MUX_DEFAULT_PAYLOAD) <= UART_LINK_MAX_PAYLOAD, "mux frames must fit a link frame");
+
+ChannelMux mux;
+bool active;
+
+uint8_t held[MUX_PAYLOAD_SIZE(MUX_DEFAULT_PAYLOAD)];   // Taken from the mux, not yet accepted by the link
+size_t heldLength;
+
+/**
+ * @brief Log sink, a record that does not fit is left to RTT alone
+ */
+void copyRecord(LogLevel level, const char *text, size_t length)
+{
+    uint8_t channel = level >= LOG_WARN ? LINK_MUX_ALARM : LINK_MUX_LOG;
+    (void)linkMuxWrite(channel, (const uint8_t *)text, length);
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef linkMuxInit(void)
+{
+    if(!mux.init(channels, sizeof(channels) / sizeof(channels[0])))
+    {
+        return HAL_ERROR;
+    }
+    heldLength = 0;
+    active = true;
+    logSetSink(copyRecord);
+    return HAL_OK;
+}
+
+int linkMuxIsActive(void)
+{
+    return active ? 1 : 0;
+}
+
+void linkMuxReceive(const uint8_t *payload, uint16_t length)
+{
+    if(!active)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    mux.receivePayload(payload, length);
+    HAL_CriticalExit(state);
+}
+
+void linkMuxPoll(void)
+{
+    if(!active || !uartLinkIsReady())
+    {
+        return;
+    }
+
+    for(;;)
+    {
+        if(heldLength == 0)
+        {
+            uint32_t state = HAL_CriticalEnter();
+            heldLength = mux.pollPayload(held, sizeof(held));
+            HAL_CriticalExit(state);
+            if(heldLength == 0)
+            {
+                return;
+            }
+        }
+
+        // A full transmit queue keeps the frame for the next poll, the mux has already counted it sent
+        HAL_StatusTypeDef status = uartLinkSend(held, (uint16_t)heldLength);
+        if(status == HAL_BUSY)
+        {
+            return;
+        }
+        heldLength = 0;
+    }
+}
+
+HAL_StatusTypeDef linkMuxWrite(uint8_t channel, const uint8_t *data, size_t length)
+{
+    if(!active || data == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef status = HAL_OK;
+    uint32_t state = HAL_CriticalEnter();
+    if(mux.stats(channel) == NULL)      // Not in the table
+    {
+        status = HAL_ERROR;
+    }
+    else if(mux.writable(channel) < length)
+    {
+        status = HAL_BUSY;
+    }
+    else
+    {
+        (void)mux.write(channel, data, length);
+    }
+    HAL_CriticalExit(state);
+    return status;
+}
+
+size_t linkMuxRead(uint8_t channel, uint8_t *dst, size_t size)
+{
+    if(!active || dst == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    size_t length = mux.read(channel, dst, size);
+    HAL_CriticalExit(state);
+    return length;
+}
+
+void linkMuxRefreshCredits(void)
+{
+    if(!active)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    mux.refreshCredits();
+    HAL_CriticalExit(state);
+}
+
+} // extern "C"
@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file           : lock_profiler.cpp
+  * @brief          : Contention report for RTOS mutexes, semaphores and queues
+  ******************************************************************************
+  */
+
+#include "lock_profiler.h"
+#include "contention_profiler.h"
+#include "logging.h"
+
+#include <stddef.h>
+
+namespace {
+
+static_assert(LOCK_PROFILER_MAX_OBJECTS == CONTENTION_PROFILER_MAX_OBJECTS, "Table sizes differ");
+
+const char *const kindNames[] = {"queue", "mutex", "counting", "binary", "recursive"};
+
+ContentionProfiler profiler;
+
+uint32_t cyclesToUs(uint64_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    if(mhz == 0)
+    {
+        return 0;
+    }
+    uint64_t us = cycles / mhz;
+    return us > 0xFFFFFFFFU ? 0xFFFFFFFFU : (uint32_t)us;
+}
+
+const char *taskName(const void *task)
+{
+    return task != NULL ? HAL_TaskName(task) : "-";
+}
+
+} // namespace
+
+extern "C" {
+
+void lockProfilerRegister(const void *object, const char *name, uint8_t type, uint32_t length)
+{
+    uint32_t state = HAL_CriticalEnter();
+    (void)profiler.add(object, name, type, length);
+    HAL_CriticalExit(state);
+}
+
+void lockProfilerUnregister(const void *object)
+{
+    uint32_t state = HAL_CriticalEnter();
+    profiler.remove(object);
+    HAL_CriticalExit(state);
+}
+
+void lockProfilerBlock(const void *object, const void *task, uint8_t sending)
+{
+    uint32_t state = HAL_CriticalEnter();
+    profiler.blocked(object, task, sending != 0U, HAL_GetCycleCount());
+    HAL_CriticalExit(state);
+}
+
+void lockProfilerDone(const void *object, const void *task, uint8_t sending, uint32_t waiting)
+{
+    uint32_t state = HAL_CriticalEnter();
+    profiler.completed(object, task, sending != 0U, waiting, HAL_GetCycleCount());
+    HAL_CriticalExit(state);
+}
+
+void lockProfilerFailed(const void *object, const void *task, uint8_t sending)
+{
+    uint32_t state = HAL_CriticalEnter();
+    profiler.failed(object, task, sending != 0U, HAL_GetCycleCount());
+    HAL_CriticalExit(state);
+}
+
+uint32_t lockProfilerGetHotspots(LockHotspot *hotspots, uint32_t max)
+{
+    if(hotspots == NULL)
+    {
+        return 0;
+    }
+
+    const ContentionFigures *ranked[CONTENTION_PROFILER_MAX_OBJECTS];
+    uint32_t state = HAL_CriticalEnter();
+    size_t count = profiler.rank(ranked, max < CONTENTION_PROFILER_MAX_OBJECTS ? max : CONTENTION_PROFILER_MAX_OBJECTS);
+    for(size_t i = 0; i < count; i++)
+    {
+        const ContentionFigures &figures = *ranked[i];
+        LockHotspot &hotspot = hotspots[i];
+        hotspot.name = figures.name;
+        hotspot.kindName = figures.kind < sizeof(kindNames) / sizeof(kindNames[0]) ? kindNames[figures.kind] : "?";
+        hotspot.length = figures.length;
+        hotspot.operations = figures.operations;
+        hotspot.contentions = figures.contentions;
+        hotspot.timeouts = figures.timeouts;
+        hotspot.totalWaitUs = cyclesToUs(figures.waitCycles);
+        hotspot.maxWaitUs = cyclesToUs(figures.maxWaitCycles);
+        hotspot.worstWaiter = taskName(figures.worstWaiter);
+        hotspot.worstOwner = taskName(figures.worstOwner);
+        hotspot.holds = figures.holds;
+        hotspot.avgHoldUs = figures.holds != 0 ? cyclesToUs(figures.holdCycles / figures.holds) : 0;
+        hotspot.maxHoldUs = cyclesToUs(figures.maxHoldCycles);
+        hotspot.highWater = figures.highWater;
+    }
+    HAL_CriticalExit(state);
+    return (uint32_t)count;
+}
+
+void lockProfilerReset(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    profiler.reset();
+    HAL_CriticalExit(state);
+}
+
+void lockProfilerDump(uint32_t top)
+{
+    // Static so the report does not need a large stack in the calling task
+    static LockHotspot hotspots[LOCK_PROFILER_MAX_OBJECTS];
+    uint32_t count = lockProfilerGetHotspots(hotspots, top == 0 ? LOCK_PROFILER_MAX_OBJECTS : top);
+
+    logWrite(LOG_INFO, "Locks: %u objects ranked by wait\n\r", (unsigned int)count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        // Two lines per object, one would not fit a log record with long names
+        const LockHotspot &hotspot = hotspots[i];
+        logWrite(LOG_INFO, "  %u. %s (%s): ops %u, contended %u, timeouts %u\n\r",
+                 (unsigned int)(i + 1U), hotspot.name, hotspot.kindName,
+                 (unsigned int)hotspot.operations, (unsigned int)hotspot.contentions,
+                 (unsigned int)hotspot.timeouts);
+        logWrite(LOG_INFO, "     wait %u us, max %u us by %s behind %s\n\r",
+                 (unsigned int)hotspot.totalWaitUs, (unsigned int)hotspot.maxWaitUs,
+                 hotspot.worstWaiter, hotspot.worstOwner);
+        if(hotspot.holds != 0)
+        {
+            logWrite(LOG_INFO, "     holds %u, avg %u us, max %u us\n\r",
+                     (unsigned int)hotspot.holds, (unsigned int)hotspot.avgHoldUs,
+                     (unsigned int)hotspot.maxHoldUs);
+        }
+        else if(hotspot.highWater != 0)
+        {
+            logWrite(LOG_INFO, "     high water %u of %u\n\r",
+                     (unsigned int)hotspot.highWater, (unsigned int)hotspot.length);
+        }
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+  * @file           : lpuart_wake.cpp
+  * @brief          : LPUART receive path that keeps working in Stop mode
+  ******************************************************************************
+  */
+
+#include "lpuart_wake.h"
+#include "hal_callbacks.h"
+#include "power_manager.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+struct Frame
+{
+    uint16_t start;
+    uint16_t length;
+    uint32_t offset;            // Bytes received before the frame, tells whether DMA has lapped it
+};
+
+struct LpuartWake
+{
+    UART_HandleTypeDef *huart;
+    uint8_t address;
+
+    uint8_t ring[LPUART_WAKE_RING_SIZE];
+    uint16_t rxHead;            // Ring index up to which DMA data has been accounted
+    volatile uint32_t rxTotal;  // Bytes accounted since start, wraps
+    uint16_t frameStart;
+    uint16_t frameLength;
+    uint32_t frameOffset;
+    volatile uint8_t frameInProgress;
+
+    Frame frames[LPUART_WAKE_MAX_FRAMES];
+    volatile uint8_t frameWrite;
+    volatile uint8_t frameRead;
+
+    volatile uint8_t checkNextFrame; // Next frame is the first one after a wake
+    uint32_t lastStopExitCycles;
+
+    LpuartWakeStats stats;
+};
+
+LpuartWake lpuart;
+
+/**
+ * @brief Count a frame lost after queueing, pushFrame counts from interrupt context as well
+ */
+void countDroppedFrame(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    lpuart.stats.framesDropped++;
+    HAL_CriticalExit(state);
+}
+
+void pushFrame(void)
+{
+    if(lpuart.frameLength == 0)
+    {
+        return;
+    }
+
+    uint8_t next = (uint8_t)((lpuart.frameWrite + 1U) % LPUART_WAKE_MAX_FRAMES);
+    // DMA may run half a ring ahead of the last event, longer frames cannot be kept intact
+    if(next == lpuart.frameRead || lpuart.frameLength > LPUART_WAKE_RING_SIZE / 2U)
+    {
+        lpuart.stats.framesDropped++;
+    }
+    else
+    {
+        lpuart.frames[lpuart.frameWrite].start = lpuart.frameStart;
+        lpuart.frames[lpuart.frameWrite].length = lpuart.frameLength;
+        lpuart.frames[lpuart.frameWrite].offset = lpuart.frameOffset;
+        lpuart.frameWrite = next;
+        lpuart.stats.framesReceived++;
+
+        // Unread frames keep the core out of Stop, released in lpuartWakeReadFrame
+        powerManagerLockMode(POWER_MODE_SLEEP);
+    }
+
+    lpuart.frameLength = 0;
+}
+
+/**
+ * @brief Stay in Sleep until the frame in flight is complete, DMA stops in Stop mode
+ */
+void holdSleep(void)
+{
+    if(!lpuart.frameInProgress)
+    {
+        lpuart.frameInProgress = 1;
+        powerManagerLockMode(POWER_MODE_SLEEP);
+    }
+}
+
+/**
+ * @brief Check whether DMA may have written over a queued frame
+ * @note  Receive events come at least every half ring, so DMA can be up to half a ring past rxTotal
+ */
+bool overwritten(const Frame &frame)
+{
+    return lpuart.rxTotal - frame.offset + LPUART_WAKE_RING_SIZE / 2U > LPUART_WAKE_RING_SIZE;
+}
+
+void onRxEvent(void *ctx, uint16_t size)
+{
+    (void)ctx;
+
+    // In circular mode the HAL reports the DMA write position in the ring
+    uint16_t position = (uint16_t)(size % LPUART_WAKE_RING_SIZE);
+    uint16_t received = (uint16_t)((position + LPUART_WAKE_RING_SIZE - lpuart.rxHead) % LPUART_WAKE_RING_SIZE);
+    if(received == 0 && size == LPUART_WAKE_RING_SIZE && lpuart.rxHead == 0)
+    {
+        received = LPUART_WAKE_RING_SIZE;
+    }
+
+    if(received > 0)
+    {
+        if(lpuart.frameLength == 0)
+        {
+            lpuart.frameStart = lpuart.rxHead;
+            lpuart.frameOffset = lpuart.rxTotal;
+        }
+        lpuart.frameLength = (uint16_t)(lpuart.frameLength + received);
+        lpuart.rxHead = position;
+        lpuart.rxTotal = lpuart.rxTotal + received;
+    }
+
+    if(HAL_UARTEx_GetRxEventType(lpuart.huart) == HAL_UART_RXEVENT_IDLE)
+    {
+        pushFrame();
+        if(lpuart.frameInProgress)
+        {
+            lpuart.frameInProgress = 0;
+            powerManagerUnlockMode(POWER_MODE_SLEEP);
+        }
+    }
+    else
+    {
+        holdSleep();
+    }
+}
+
+void onWakeup(void *ctx)
+{
+    (void)ctx;
+
+    lpuart.stats.wakeCount++;
+    lpuart.checkNextFrame = 1;
+
+    // The rest of the frame follows, receive it with DMA running
+    holdSleep();
+
+    // Only the first wake-up interrupt after a Stop exit measures latency, from the
+    // moment the wake flag brought the core out of Stop
+    uint32_t stopExitCycles = powerManagerLastStopExitCycles();
+    if(stopExitCycles != lpuart.lastStopExitCycles)
+    {
+        uint32_t latency = HAL_GetCycleCount() - stopExitCycles;
+        lpuart.stats.lastWakeLatencyCycles = latency;
+        if(latency > lpuart.stats.maxWakeLatencyCycles)
+        {
+            lpuart.stats.maxWakeLatencyCycles = latency;
+        }
+        lpuart.lastStopExitCycles = stopExitCycles;
+    }
+}
+
+void onError(void *ctx)
+{
+    (void)ctx;
+
+    if((HAL_UART_GetError(lpuart.huart) & HAL_UART_ERROR_ORE) != 0U)
+    {
+        lpuart.stats.overrunErrors++;
+    }
+
+    // Any error aborts the DMA transfer, restart the ring from the top
+    lpuart.frameLength = 0;
+    if(lpuart.frameInProgress)
+    {
+        lpuart.frameInProgress = 0;
+        powerManagerUnlockMode(POWER_MODE_SLEEP);
+    }
+    lpuart.rxHead = 0;
+    (void)HAL_UARTEx_ReceiveToIdle_DMA(lpuart.huart, lpuart.ring, LPUART_WAKE_RING_SIZE);
+}
+
+const HalUartCallbacks lpuartCallbacks = {
+    onRxEvent,
+    onWakeup,
+    onError,
+    NULL
+};
+
+uint16_t copyFromRing(uint8_t *dst, uint16_t start, uint16_t length)
+{
+    uint16_t firstPart = (uint16_t)(LPUART_WAKE_RING_SIZE - start);
+    if(firstPart > length)
+    {
+        firstPart = length;
+    }
+    memcpy(dst, &lpuart.ring[start], firstPart);
+    memcpy(dst + firstPart, &lpuart.ring[0], (size_t)(length - firstPart));
+    return length;
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef lpuartWakeInit(UART_HandleTypeDef *huart, uint8_t address, LpuartWakeSource source)
+{
+    if(huart == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    memset(&lpuart, 0, sizeof(lpuart));
+    lpuart.huart = huart;
+    lpuart.address = address;
+    lpuart.lastStopExitCycles = powerManagerLastStopExitCycles();
+
+    HAL_StatusTypeDef status = powerManagerAcquireClock(POWER_CLOCK_LPUART1);
+    if(status != HAL_OK)
+    {
+        lpuart.huart = NULL;
+        return status;
+    }
+
+    UART_WakeUpTypeDef wakeUp;
+    wakeUp.WakeUpEvent = (source == LPUART_WAKE_ON_ADDRESS) ? UART_WAKEUP_ON_ADDRESS : UART_WAKEUP_ON_STARTBIT;
+    wakeUp.AddressLength = UART_ADDRESS_DETECT_7B;
+    wakeUp.Address = address;
+
+    status = HAL_UARTEx_StopModeWakeUpSourceConfig(huart, wakeUp);
+    if(status == HAL_OK)
+    {
+        status = HAL_UARTEx_EnableStopMode(huart);
+    }
+    if(status == HAL_OK)
+    {
+        status = halUartRegisterCallbacks(huart, &lpuartCallbacks, NULL);
+    }
+    if(status == HAL_OK)
+    {
+        status = HAL_UARTEx_ReceiveToIdle_DMA(huart, lpuart.ring, LPUART_WAKE_RING_SIZE);
+        if(status != HAL_OK)
+        {
+            halUartUnregisterCallbacks(huart);
+        }
+    }
+
+    if(status != HAL_OK)
+    {
+        (void)powerManagerReleaseClock(POWER_CLOCK_LPUART1);
+        lpuart.huart = NULL;
+    }
+    return status;
+}
+
+int lpuartWakeIsActive(void)
+{
+    return lpuart.huart != NULL;
+}
+
+uint16_t lpuartWakeReadFrame(uint8_t *dst, uint16_t size)
+{
+    while(lpuart.frameRead != lpuart.frameWrite)
+    {
+        Frame frame = lpuart.frames[lpuart.frameRead];
+        lpuart.frameRead = (uint8_t)((lpuart.frameRead + 1U) % LPUART_WAKE_MAX_FRAMES);
+        powerManagerUnlockMode(POWER_MODE_SLEEP);
+
+        if(overwritten(frame))
+        {
+            countDroppedFrame();
+            continue;
+        }
+
+        uint16_t skip = 0;
+        if(lpuart.checkNextFrame)
+        {
+            // Bytes ahead of the address were clocked in while the core was still waking up
+            lpuart.checkNextFrame = 0;
+            while(skip < frame.length && lpuart.ring[(frame.start + skip) % LPUART_WAKE_RING_SIZE] != lpuart.address)
+            {
+                skip++;
+            }
+            if(skip == frame.length)
+            {
+                // Address byte itself was lost, the whole frame is unusable
+                lpuart.stats.framesDamagedAtWake++;
+                lpuart.stats.bytesLostAtWake += (uint32_t)frame.length + 1U;
+                continue;
+            }
+            if(skip > 0)
+            {
+                lpuart.stats.framesDamagedAtWake++;
+                lpuart.stats.bytesLostAtWake += skip;
+            }
+        }
+
+        uint16_t length = (uint16_t)(frame.length - skip);
+        if(length > size)
+        {
+            length = size;
+        }
+        copyFromRing(dst, (uint16_t)((frame.start + skip) % LPUART_WAKE_RING_SIZE), length);
+
+        // Reception carried on during the copy, the frame may have been lapped meanwhile
+        if(overwritten(frame))
+        {
+            countDroppedFrame();
+            continue;
+        }
+        return length;
+    }
+    return 0;
+}
+
+void lpuartWakeGetStats(LpuartWakeStats *stats)
+{
+    if(stats != NULL)
+    {
+        *stats = lpuart.stats;
+    }
+}
+
+uint32_t lpuartWakeCyclesToUs(uint32_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    if(mhz == 0)
+    {
+        return 0;
+    }
+    return cycles / mhz;
+}
+
+}
@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file           : overload_control.cpp
+  * @brief          : Load shedding under CPU pressure
+  ******************************************************************************
+  */
+
+#include "overload_control.h"
+#include "load_shedder.h"
+#include "rs485.h"
+#include "work_queue.h"
+
+#include <stddef.h>
+
+#include <atomic>
+
+namespace {
+
+LoadShedder shedder;
+bool started;
+
+uint32_t lastSampleMs;
+uint32_t lastCycles;
+uint32_t lastIdleCycles;
+
+// Counters of the other drivers that are read as misses, by delta
+uint32_t lastTurnaroundViolations;
+uint32_t lastWorkOverflows;
+
+std::atomic<uint32_t> reportedMisses;
+uint32_t lastReportedMisses;
+uint32_t totalMisses;
+
+/**
+ * @brief Misses in the drivers' counters since the previous sample
+ */
+uint32_t collectMisses(void)
+{
+    uint32_t misses = 0;
+
+    uint32_t reported = reportedMisses.load(std::memory_order_relaxed);
+    misses += reported - lastReportedMisses;
+    lastReportedMisses = reported;
+
+    if(rs485IsActive())
+    {
+        Rs485Stats rs485;
+        rs485GetStats(&rs485);
+        misses += rs485.turnaroundViolations - lastTurnaroundViolations;
+        lastTurnaroundViolations = rs485.turnaroundViolations;
+    }
+
+    uint32_t overflows = 0;
+    for(size_t lane = 0; lane < WORK_LANE_COUNT; lane++)
+    {
+        WorkQueueStats work;
+        workQueueGetStats((WorkLane)lane, &work);
+        overflows += work.overflows;
+    }
+    misses += overflows - lastWorkOverflows;
+    lastWorkOverflows = overflows;
+
+    return misses;
+}
+
+/**
+ * @brief Start the measurement so the first period is a full one
+ */
+void start(uint32_t now)
+{
+    HAL_EnableCycleCounter();
+    lastSampleMs = now;
+    lastCycles = HAL_GetCycleCount();
+    lastIdleCycles = HAL_GetIdleCycles();
+    (void)collectMisses();
+    started = true;
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef overloadRegister(const char *name, OverloadOrder order, uint8_t levels,
+                                   OverloadApplyFn apply, void *ctx)
+{
+    LoadShedClient client = { name, (uint8_t)order, levels, apply, ctx };
+
+    uint32_t state = HAL_CriticalEnter();
+    bool added = shedder.addClient(client);
+    HAL_CriticalExit(state);
+
+    return added ? HAL_OK : HAL_ERROR;
+}
+
+void overloadReportDeadlineMiss(void)
+{
+    reportedMisses.fetch_add(1U, std::memory_order_relaxed);
+}
+
+void overloadControlPoll(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    // Both task loops poll, the first one to see a sample due takes it
+    uint32_t state = HAL_CriticalEnter();
+    if(!started)
+    {
+        start(now);
+        HAL_CriticalExit(state);
+        return;
+    }
+    if(now - lastSampleMs < OVERLOAD_SAMPLE_MS)
+    {
+        HAL_CriticalExit(state);
+        return;
+    }
+
+    uint32_t cycles = HAL_GetCycleCount();
+    uint32_t idle = HAL_GetIdleCycles();
+    uint32_t elapsed = cycles - lastCycles;
+    uint32_t idleElapsed = idle - lastIdleCycles;
+
+    // A platform without run-time stats reports no idle time at all: leave the load unknown
+    uint32_t load = 0;
+    if(idle != 0 && elapsed != 0)
+    {
+        uint32_t idlePermille = (uint32_t)(((uint64_t)idleElapsed * 1000U) / elapsed);
+        load = idlePermille >= 1000U ? 0 : 1000U - idlePermille;
+    }
+
+    uint32_t misses = collectMisses();
+    totalMisses += misses;
+    lastSampleMs = now;
+    lastCycles = cycles;
+    lastIdleCycles = idle;
+
+    shedder.sample(load, misses);
+    HAL_CriticalExit(state);
+}
+
+void overloadGetStats(OverloadStats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    const LoadShedStats &source = shedder.stats();
+    stats->loadPermille = source.lastLoadPermille;
+    stats->deadlineMisses = totalMisses;
+    stats->sheds = source.sheds;
+    stats->restores = source.restores;
+    stats->level = source.level;
+    stats->levelCount = shedder.levelCount();
+    stats->peakLevel = source.peakLevel;
+    HAL_CriticalExit(state);
+}
+
+} // extern "C"
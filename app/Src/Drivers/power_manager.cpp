@@ -0,0 +1,308 @@
+/**
+  ******************************************************************************
+  * @file           : power_manager.cpp
+  * @brief          : Reference-counted peripheral clock and power domain manager
+  ******************************************************************************
+  */
+
+#include "power_manager.h"
+#include "logging.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+struct ResourceInfo
+{
+    const char *name;
+    PowerMode deepestWhileActive;
+};
+
+// Only LPUART1 keeps running (and can wake us) in Stop mode
+const ResourceInfo clockInfo[POWER_CLOCK_COUNT] = {
+    { "USART2",  POWER_MODE_SLEEP },
+    { "LPUART1", POWER_MODE_STOP2 },
+    { "I2C2",    POWER_MODE_SLEEP },
+    { "SPI1",    POWER_MODE_SLEEP },
+    { "DMA",     POWER_MODE_SLEEP },
+    { "TIM2",    POWER_MODE_SLEEP },
+};
+
+// Domains are retained in Stop, they only matter for the active-set export
+const ResourceInfo domainInfo[POWER_DOMAIN_COUNT] = {
+    { "VDDIO2", POWER_MODE_STOP2 },
+    { "SRAM2",  POWER_MODE_STOP2 },
+    { "SRAM3",  POWER_MODE_STOP2 },
+};
+
+struct PowerManager
+{
+    uint8_t clockRefs[POWER_CLOCK_COUNT];
+    uint8_t domainRefs[POWER_DOMAIN_COUNT];
+    uint32_t clockMask;
+    uint32_t domainMask;
+    uint8_t modeLocks[POWER_MODE_COUNT];
+    uint32_t modeEntries[POWER_MODE_COUNT];
+    PowerMode stoppedIn;
+    volatile uint32_t lastStopExitCycles;
+};
+
+PowerManager pm;
+
+HAL_StatusTypeDef acquire(uint8_t *refs, uint32_t *mask, uint32_t index, void (*enable)(uint32_t))
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(refs[index] == UINT8_MAX)
+    {
+        HAL_CriticalExit(state);
+        return HAL_ERROR;
+    }
+    if(refs[index]++ == 0 && (*mask & (1UL << index)) == 0U)
+    {
+        enable(index);
+        *mask |= (1UL << index);
+    }
+    HAL_CriticalExit(state);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef release(uint8_t *refs, uint32_t *mask, uint32_t index, void (*disable)(uint32_t))
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(refs[index] == 0)
+    {
+        HAL_CriticalExit(state);
+        return HAL_ERROR;
+    }
+    if(--refs[index] == 0)
+    {
+        disable(index);
+        *mask &= ~(1UL << index);
+    }
+    HAL_CriticalExit(state);
+    return HAL_OK;
+}
+
+PowerMode deepestMode(void)
+{
+    PowerMode deepest = POWER_MODE_STOP2;
+
+    for(uint32_t mode = 0; mode < POWER_MODE_COUNT; mode++)
+    {
+        if(pm.modeLocks[mode] != 0 && (PowerMode)mode < deepest)
+        {
+            deepest = (PowerMode)mode;
+        }
+    }
+    for(uint32_t i = 0; i < POWER_CLOCK_COUNT; i++)
+    {
+        if((pm.clockMask & (1UL << i)) != 0U && clockInfo[i].deepestWhileActive < deepest)
+        {
+            deepest = clockInfo[i].deepestWhileActive;
+        }
+    }
+    for(uint32_t i = 0; i < POWER_DOMAIN_COUNT; i++)
+    {
+        if((pm.domainMask & (1UL << i)) != 0U && domainInfo[i].deepestWhileActive < deepest)
+        {
+            deepest = domainInfo[i].deepestWhileActive;
+        }
+    }
+    return deepest;
+}
+
+const char *const modeNames[POWER_MODE_COUNT] = { "RUN", "SLEEP", "STOP1", "STOP2" };
+
+} // namespace
+
+extern "C" {
+
+void powerManagerInit(uint32_t bootClocks, uint32_t bootDomains)
+{
+    memset(&pm, 0, sizeof(pm));
+    pm.clockMask = bootClocks & ((1UL << POWER_CLOCK_COUNT) - 1U);
+    pm.domainMask = bootDomains & ((1UL << POWER_DOMAIN_COUNT) - 1U);
+    HAL_EnableCycleCounter();
+}
+
+void powerManagerGateUnused(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    for(uint32_t i = 0; i < POWER_CLOCK_COUNT; i++)
+    {
+        if((pm.clockMask & (1UL << i)) != 0U && pm.clockRefs[i] == 0)
+        {
+            HAL_PeriphClockDisable(i);
+            pm.clockMask &= ~(1UL << i);
+        }
+    }
+    for(uint32_t i = 0; i < POWER_DOMAIN_COUNT; i++)
+    {
+        if((pm.domainMask & (1UL << i)) != 0U && pm.domainRefs[i] == 0)
+        {
+            HAL_PowerDomainDisable(i);
+            pm.domainMask &= ~(1UL << i);
+        }
+    }
+    HAL_CriticalExit(state);
+}
+
+HAL_StatusTypeDef powerManagerAcquireClock(PowerClock clock)
+{
+    if(clock >= POWER_CLOCK_COUNT)
+    {
+        return HAL_ERROR;
+    }
+    return acquire(pm.clockRefs, &pm.clockMask, clock, HAL_PeriphClockEnable);
+}
+
+HAL_StatusTypeDef powerManagerReleaseClock(PowerClock clock)
+{
+    if(clock >= POWER_CLOCK_COUNT)
+    {
+        return HAL_ERROR;
+    }
+    return release(pm.clockRefs, &pm.clockMask, clock, HAL_PeriphClockDisable);
+}
+
+HAL_StatusTypeDef powerManagerAcquireDomain(PowerDomain domain)
+{
+    if(domain >= POWER_DOMAIN_COUNT)
+    {
+        return HAL_ERROR;
+    }
+    return acquire(pm.domainRefs, &pm.domainMask, domain, HAL_PowerDomainEnable);
+}
+
+HAL_StatusTypeDef powerManagerReleaseDomain(PowerDomain domain)
+{
+    if(domain >= POWER_DOMAIN_COUNT)
+    {
+        return HAL_ERROR;
+    }
+    return release(pm.domainRefs, &pm.domainMask, domain, HAL_PowerDomainDisable);
+}
+
+void powerManagerLockMode(PowerMode deepest)
+{
+    if(deepest >= POWER_MODE_COUNT)
+    {
+        return;
+    }
+    uint32_t state = HAL_CriticalEnter();
+    pm.modeLocks[deepest]++;
+    HAL_CriticalExit(state);
+}
+
+void powerManagerUnlockMode(PowerMode deepest)
+{
+    if(deepest >= POWER_MODE_COUNT)
+    {
+        return;
+    }
+    uint32_t state = HAL_CriticalEnter();
+    if(pm.modeLocks[deepest] > 0)
+    {
+        pm.modeLocks[deepest]--;
+    }
+    HAL_CriticalExit(state);
+}
+
+PowerMode powerManagerDeepestMode(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    PowerMode mode = deepestMode();
+    HAL_CriticalExit(state);
+    return mode;
+}
+
+uint32_t powerManagerLastStopExitCycles(void)
+{
+    return pm.lastStopExitCycles;
+}
+
+void powerManagerGetActiveSet(PowerActiveSet *set)
+{
+    if(set == NULL)
+    {
+        return;
+    }
+    uint32_t state = HAL_CriticalEnter();
+    set->clockMask = pm.clockMask;
+    set->domainMask = pm.domainMask;
+    memcpy(set->clockRefs, pm.clockRefs, sizeof(set->clockRefs));
+    memcpy(set->domainRefs, pm.domainRefs, sizeof(set->domainRefs));
+    set->deepestMode = deepestMode();
+    memcpy(set->modeEntries, pm.modeEntries, sizeof(set->modeEntries));
+    HAL_CriticalExit(state);
+}
+
+void powerManagerDump(void)
+{
+    PowerActiveSet set;
+    powerManagerGetActiveSet(&set);
+
+    logWrite(LOG_INFO, "Power: deepest mode %s, clocks 0x%08X, domains 0x%08X\n\r",
+             modeNames[set.deepestMode], (unsigned int)set.clockMask, (unsigned int)set.domainMask);
+    for(uint32_t i = 0; i < POWER_CLOCK_COUNT; i++)
+    {
+        if((set.clockMask & (1UL << i)) != 0U)
+        {
+            logWrite(LOG_INFO, "  clock %s refs %u\n\r", clockInfo[i].name, (unsigned int)set.clockRefs[i]);
+        }
+    }
+    for(uint32_t i = 0; i < POWER_DOMAIN_COUNT; i++)
+    {
+        if((set.domainMask & (1UL << i)) != 0U)
+        {
+            logWrite(LOG_INFO, "  domain %s refs %u\n\r", domainInfo[i].name, (unsigned int)set.domainRefs[i]);
+        }
+    }
+    for(uint32_t mode = 0; mode < POWER_MODE_COUNT; mode++)
+    {
+        logWrite(LOG_INFO, "  %s entries %u\n\r", modeNames[mode], (unsigned int)set.modeEntries[mode]);
+    }
+}
+
+void powerManagerPreSleep(uint32_t *expectedIdleTime)
+{
+    // Called by the kernel with interrupts masked
+    PowerMode mode = deepestMode();
+    pm.modeEntries[mode]++;
+
+    switch(mode)
+    {
+        case POWER_MODE_RUN:
+            *expectedIdleTime = 0;
+            break;
+
+        case POWER_MODE_SLEEP:
+            // Leave the idle time untouched, the port executes WFI itself
+            break;
+
+        default:
+            pm.stoppedIn = mode;
+            HAL_EnterStopMode(mode);
+            // First instruction after the wake-up, before the clocks are restored
+            pm.lastStopExitCycles = HAL_GetCycleCount();
+            // Stop mode already consumed the idle period, the port must not WFI again
+            *expectedIdleTime = 0;
+            break;
+    }
+}
+
+void powerManagerPostSleep(uint32_t *expectedIdleTime)
+{
+    (void)expectedIdleTime;
+
+    if(pm.stoppedIn == POWER_MODE_RUN)
+    {
+        return;
+    }
+
+    HAL_ExitStopMode(pm.stoppedIn);
+    pm.stoppedIn = POWER_MODE_RUN;
+}
+
+}
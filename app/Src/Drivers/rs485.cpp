@@ -0,0 +1,368 @@
+/**
+  ******************************************************************************
+  * @file           : rs485.cpp
+  * @brief          : Half-duplex RS-485 multi-drop port with hardware driver enable
+  ******************************************************************************
+  */
+
+#include "rs485.h"
+#include "hal_callbacks.h"
+#include "power_manager.h"
+#include "work_queue.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+constexpr uint16_t ADDRESS_MARK_9BIT = 0x100U;
+constexpr uint8_t ADDRESS_MARK_8BIT = 0x80U;
+constexpr uint8_t DE_TIME_MAX = 31U;
+
+struct Slot
+{
+    // DMA target, 16-bit characters in 9-bit mode; rewritten to payload bytes once complete
+    uint16_t chars[RS485_MAX_FRAME];
+    uint16_t length;
+};
+
+struct Rs485
+{
+    UART_HandleTypeDef *huart;
+    Rs485Config config;
+    Rs485ResponderFn responder;
+
+    Slot slots[RS485_MAX_FRAMES];
+    volatile uint8_t slotWrite;     // Slot being filled by the DMA
+    volatile uint8_t slotRead;
+
+    uint16_t tx[RS485_MAX_FRAME];
+    uint8_t reply[RS485_MAX_FRAME];
+    volatile uint8_t txBusy;
+
+    uint32_t bitCycles;
+    uint32_t charCycles;
+    uint32_t lastRxEndCycles;
+    volatile uint8_t awaitingReply; // A frame was received and not answered yet
+
+    Rs485Stats stats;
+};
+
+Rs485 port;
+
+// Kept apart from the port state, the handler may be set before the platform starts the port
+Rs485FrameFn frameHandler;
+volatile uint8_t deliveryPending;
+
+void deliverFrames(const void *data, uint16_t size)
+{
+    (void)data;
+    (void)size;
+
+    // Clear first, a frame completing from here on schedules another pass
+    deliveryPending = 0;
+    uint8_t payload[RS485_MAX_FRAME];
+    uint16_t length;
+    while(frameHandler != NULL && (length = rs485ReadFrame(payload, sizeof(payload))) > 0)
+    {
+        frameHandler(payload, length);
+    }
+}
+
+uint8_t *slotBytes(Slot *slot)
+{
+    return (uint8_t *)slot->chars;
+}
+
+void armReceive(void)
+{
+    uint8_t *dst = slotBytes(&port.slots[port.slotWrite]);
+    if(HAL_UARTEx_ReceiveToIdle_DMA(port.huart, dst, RS485_MAX_FRAME) != HAL_OK)
+    {
+        port.stats.errors++;
+        return;
+    }
+
+    // Sleep until the next address mark carrying our address
+    HAL_MultiProcessor_EnterMuteMode(port.huart);
+}
+
+/**
+ * @brief Strip the address character and pack the payload as bytes at the start of the slot
+ * @retval Payload length
+ */
+uint16_t extractPayload(Slot *slot, uint16_t chars)
+{
+    uint8_t *bytes = slotBytes(slot);
+    uint16_t length = chars > 0 ? (uint16_t)(chars - 1U) : 0U;
+    for(uint16_t i = 0; i < length; i++)
+    {
+        // In-place is safe, the byte written never overtakes the character read
+        bytes[i] = port.config.nineBit ? (uint8_t)slot->chars[i + 1U] : bytes[i + 1U];
+    }
+    return length;
+}
+
+bool payloadValid(const uint8_t *payload, uint16_t length)
+{
+    if(port.config.nineBit)
+    {
+        return true;
+    }
+
+    // The MSB is the address mark in 8-bit mode
+    for(uint16_t i = 0; i < length; i++)
+    {
+        if(payload[i] & ADDRESS_MARK_8BIT)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+HAL_StatusTypeDef startTransmit(uint8_t address, const uint8_t *payload, uint16_t length)
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(port.txBusy)
+    {
+        HAL_CriticalExit(state);
+        return HAL_BUSY;
+    }
+    port.txBusy = 1;
+    HAL_CriticalExit(state);
+
+    uint8_t *txBytes = (uint8_t *)port.tx;
+    if(port.config.nineBit)
+    {
+        port.tx[0] = (uint16_t)(ADDRESS_MARK_9BIT | address);
+        for(uint16_t i = 0; i < length; i++)
+        {
+            port.tx[i + 1U] = payload[i];
+        }
+    }
+    else
+    {
+        txBytes[0] = (uint8_t)(ADDRESS_MARK_8BIT | address);
+        memcpy(&txBytes[1], payload, length);
+    }
+
+    uint32_t start = HAL_GetCycleCount();
+    HAL_StatusTypeDef status = HAL_UART_Transmit_DMA(port.huart, txBytes, (uint16_t)(length + 1U));
+    if(status != HAL_OK)
+    {
+        port.stats.errors++;
+        port.txBusy = 0;
+        return status;
+    }
+
+    if(port.awaitingReply)
+    {
+        // First start bit leaves after the DE assertion time
+        uint32_t deCycles = (port.bitCycles * port.config.deAssertTime) / 16U;
+        uint32_t turnaround = start + deCycles - port.lastRxEndCycles;
+        port.awaitingReply = 0;
+        port.stats.lastTurnaroundCycles = turnaround;
+        if(turnaround > port.stats.maxTurnaroundCycles)
+        {
+            port.stats.maxTurnaroundCycles = turnaround;
+        }
+        if(port.config.maxTurnaroundUs != 0 && rs485CyclesToUs(turnaround) > port.config.maxTurnaroundUs)
+        {
+            port.stats.turnaroundViolations++;
+        }
+    }
+    return HAL_OK;
+}
+
+void onRxEvent(void *ctx, uint16_t size)
+{
+    (void)ctx;
+    uint32_t now = HAL_GetCycleCount();
+
+    if(HAL_UARTEx_GetRxEventType(port.huart) != HAL_UART_RXEVENT_IDLE)
+    {
+        // Buffer filled without idle, the frame is longer than we accept
+        port.stats.framesDropped++;
+        HAL_UART_AbortReceive(port.huart);
+        armReceive();
+        return;
+    }
+
+    // Idle is flagged one character time after the last stop bit
+    port.lastRxEndCycles = now - port.charCycles;
+    port.awaitingReply = 1;
+
+    Slot *slot = &port.slots[port.slotWrite];
+    uint16_t length = extractPayload(slot, size);
+    port.stats.framesReceived++;
+
+    if(port.responder != NULL)
+    {
+        uint8_t replyAddress = port.config.address;
+        uint16_t replyLength = port.responder(slotBytes(slot), length, port.reply, &replyAddress);
+        if(replyLength > 0)
+        {
+            if(replyLength > RS485_MAX_FRAME - 1U || !payloadValid(port.reply, replyLength) ||
+               startTransmit(replyAddress, port.reply, replyLength) != HAL_OK)
+            {
+                port.stats.errors++;
+            }
+            else
+            {
+                port.stats.replies++;
+            }
+            armReceive();
+            return;
+        }
+    }
+
+    uint8_t next = (uint8_t)((port.slotWrite + 1U) % RS485_MAX_FRAMES);
+    if(next == port.slotRead)
+    {
+        port.stats.framesDropped++;
+    }
+    else
+    {
+        slot->length = length;
+        port.slotWrite = next;
+        if(frameHandler != NULL && !deliveryPending &&
+           workQueueSubmit(WORK_LANE_NORMAL, deliverFrames, NULL, 0) == HAL_OK)
+        {
+            deliveryPending = 1;
+        }
+    }
+    armReceive();
+}
+
+void onTxComplete(void *ctx)
+{
+    (void)ctx;
+    port.txBusy = 0;
+    port.stats.framesSent++;
+}
+
+void onError(void *ctx)
+{
+    (void)ctx;
+    port.stats.errors++;
+    HAL_UART_AbortReceive(port.huart);
+    armReceive();
+}
+
+const HalUartCallbacks rs485Callbacks = {
+    onRxEvent,
+    NULL,
+    onError,
+    onTxComplete
+};
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef rs485Init(UART_HandleTypeDef *huart, const Rs485Config *config, Rs485ResponderFn responder)
+{
+    if(huart == NULL || config == NULL || config->baudRate == 0 || config->address > 0x7FU ||
+       config->deAssertTime > DE_TIME_MAX || config->deDeassertTime > DE_TIME_MAX)
+    {
+        return HAL_ERROR;
+    }
+
+    memset(&port, 0, sizeof(port));
+    port.config = *config;
+    port.responder = responder;
+    port.huart = huart;
+    HAL_EnableCycleCounter();
+
+    // Start bit, data bits and one stop bit
+    port.bitCycles = HAL_RCC_GetHCLKFreq() / config->baudRate;
+    port.charCycles = port.bitCycles * (config->nineBit ? 11U : 10U);
+
+    HAL_StatusTypeDef status = HAL_RS485Ex_Init(huart, UART_DE_POLARITY_HIGH, config->deAssertTime, config->deDeassertTime);
+    if(status == HAL_OK)
+    {
+        // Address mark wake-up with a 7-bit address, compared in hardware
+        status = HAL_MultiProcessor_Init(huart, config->address, UART_WAKEUPMETHOD_ADDRESSMARK);
+    }
+    if(status == HAL_OK)
+    {
+        status = HAL_MultiProcessorEx_AddressLength_Set(huart, UART_ADDRESS_DETECT_7B);
+    }
+    if(status == HAL_OK)
+    {
+        status = HAL_MultiProcessor_EnableMuteMode(huart);
+    }
+    if(status == HAL_OK)
+    {
+        status = halUartRegisterCallbacks(huart, &rs485Callbacks, &port);
+    }
+    if(status != HAL_OK)
+    {
+        port.huart = NULL;
+        return status;
+    }
+
+    powerManagerLockMode(POWER_MODE_SLEEP);
+    armReceive();
+    return HAL_OK;
+}
+
+int rs485IsActive(void)
+{
+    return port.huart != NULL ? 1 : 0;
+}
+
+HAL_StatusTypeDef rs485Send(uint8_t address, const uint8_t *payload, uint16_t length)
+{
+    if(port.huart == NULL || address > 0x7FU || length > RS485_MAX_FRAME - 1U || (payload == NULL && length > 0))
+    {
+        return HAL_ERROR;
+    }
+
+    if(!payloadValid(payload, length))
+    {
+        return HAL_ERROR;
+    }
+
+    return startTransmit(address, payload, length);
+}
+
+uint16_t rs485ReadFrame(uint8_t *dst, uint16_t size)
+{
+    if(port.slotRead == port.slotWrite)
+    {
+        return 0;
+    }
+
+    Slot *slot = &port.slots[port.slotRead];
+    uint16_t length = slot->length < size ? slot->length : size;
+    memcpy(dst, slotBytes(slot), length);
+    port.slotRead = (uint8_t)((port.slotRead + 1U) % RS485_MAX_FRAMES);
+    return length;
+}
+
+void rs485SetFrameHandler(Rs485FrameFn handler)
+{
+    frameHandler = handler;
+}
+
+void rs485GetStats(Rs485Stats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    *stats = port.stats;
+    HAL_CriticalExit(state);
+}
+
+uint32_t rs485CyclesToUs(uint32_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    return mhz == 0 ? 0 : cycles / mhz;
+}
+
+} // extern "C"
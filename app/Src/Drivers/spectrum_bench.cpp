@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum_bench.cpp
+  * @brief          : Cycle counts of the 1024-point real FFTs on the running core
+  ******************************************************************************
+  */
+
+#include "spectrum_bench.h"
+#include "real_fft.h"
+
+#ifdef SPECTRUM_BENCH_CMSIS
+#include "arm_math.h"
+#endif
+
+#include <string.h>
+
+namespace {
+
+constexpr size_t N = SPECTRUM_BENCH_POINTS;
+constexpr uint32_t RUNS = 4;
+
+// Two tones and a little DC, the same for every kind so the arithmetic paths are comparable
+float sample(size_t i)
+{
+    return 0.4f * (float)fftSinTurn((uint32_t)(37U * i), (uint32_t)N)
+         + 0.3f * (float)fftCosTurn((uint32_t)(211U * i), (uint32_t)N) + 0.05f;
+}
+
+template<typename T>
+void load(T *data)
+{
+    for(size_t i = 0; i < N; i++)
+    {
+        data[i] = FftTraits<T>::fromDouble(sample(i));
+    }
+}
+
+/**
+ * @brief Best of RUNS, the input reloaded before each run and not timed
+ */
+template<typename T, typename Transform>
+uint32_t best(T *data, Transform transform)
+{
+    uint32_t fastest = 0xFFFFFFFFU;
+    for(uint32_t run = 0; run < RUNS; run++)
+    {
+        load(data);
+        uint32_t state = HAL_CriticalEnter();
+        uint32_t start = HAL_GetCycleCount();
+        transform(data);
+        uint32_t cycles = HAL_GetCycleCount() - start;
+        HAL_CriticalExit(state);
+        if(cycles < fastest)
+        {
+            fastest = cycles;
+        }
+    }
+    return fastest;
+}
+
+#ifdef SPECTRUM_BENCH_CMSIS
+HAL_StatusTypeDef benchmarkCmsis(uint8_t *buffer, SpectrumBenchmark *result)
+{
+    // Input first, the output after it: the CMSIS transforms are not in place
+    arm_rfft_fast_instance_f32 fast;
+    if(arm_rfft_fast_init_f32(&fast, N) != ARM_MATH_SUCCESS)
+    {
+        return HAL_ERROR;
+    }
+    float32_t *fin = reinterpret_cast<float32_t *>(buffer);
+    float32_t *fout = fin + N;
+    result->cmsisFloatCycles = best(fin, [&](float32_t *d) { arm_rfft_fast_f32(&fast, d, fout, 0); });
+
+    arm_rfft_instance_q15 q15;
+    if(arm_rfft_init_q15(&q15, N, 0, 1) != ARM_MATH_SUCCESS)
+    {
+        return HAL_ERROR;
+    }
+    q15_t *q15in = reinterpret_cast<q15_t *>(buffer);
+    q15_t *q15out = q15in + N;
+    result->cmsisQ15Cycles = best(q15in, [&](q15_t *d) { arm_rfft_q15(&q15, d, q15out); });
+
+    arm_rfft_instance_q31 q31;
+    if(arm_rfft_init_q31(&q31, N, 0, 1) != ARM_MATH_SUCCESS)
+    {
+        return HAL_ERROR;
+    }
+    q31_t *q31in = reinterpret_cast<q31_t *>(buffer);
+    q31_t *q31out = q31in + N;
+    result->cmsisQ31Cycles = best(q31in, [&](q31_t *d) { arm_rfft_q31(&q31, d, q31out); });
+    return HAL_OK;
+}
+#endif
+
+} // namespace
+
+HAL_StatusTypeDef spectrumBenchmark(uint8_t *buffer, SpectrumBenchmark *result)
+{
+    if(buffer == NULL || result == NULL || ((uintptr_t)buffer & 3U) != 0)
+    {
+        return HAL_ERROR;
+    }
+    memset(result, 0, sizeof(*result));
+    HAL_EnableCycleCounter();
+
+    result->floatCycles = best(reinterpret_cast<float *>(buffer), [](float *d) { RealFft<float, N>::forward(d); });
+    result->q15Cycles = best(reinterpret_cast<q15_t *>(buffer), [](q15_t *d) { RealFft<q15_t, N>::forward(d); });
+    result->q31Cycles = best(reinterpret_cast<q31_t *>(buffer), [](q31_t *d) { RealFft<q31_t, N>::forward(d); });
+
+#ifdef SPECTRUM_BENCH_CMSIS
+    return benchmarkCmsis(buffer, result);
+#else
+    return HAL_OK;
+#endif
+}
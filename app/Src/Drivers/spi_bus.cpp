@@ -0,0 +1,311 @@
+/**
+  ******************************************************************************
+  * @file           : spi_bus.cpp
+  * @brief          : SPI master with a DMA transaction queue shared by several chip-selects
+  ******************************************************************************
+  */
+
+#include "spi_bus.h"
+#include "hal_callbacks.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+void deselect(SpiBus *bus)
+{
+    if(bus->selected != NULL && bus->selected->csPort != NULL)
+    {
+        HAL_GPIO_WritePin(bus->selected->csPort, bus->selected->csPin, GPIO_PIN_SET);
+    }
+    bus->selected = NULL;
+}
+
+HAL_StatusTypeDef selectDevice(SpiBus *bus, const SpiDevice *device)
+{
+    if(bus->selected == device)
+    {
+        return HAL_OK;
+    }
+    deselect(bus);
+
+    // Change clock and mode only while no chip-select is asserted
+    const SpiDevice *cfg = bus->configured;
+    if(cfg == NULL || cfg->clockHz != device->clockHz || cfg->mode != device->mode)
+    {
+        HAL_StatusTypeDef status = HAL_SPI_SetDeviceConfig(bus->hspi, device->clockHz, device->mode);
+        if(status != HAL_OK)
+        {
+            bus->configured = NULL;
+            return status;
+        }
+        bus->stats.reconfigurations++;
+    }
+    bus->configured = device;
+
+    if(device->csPort != NULL)
+    {
+        HAL_GPIO_WritePin(device->csPort, device->csPin, GPIO_PIN_RESET);
+    }
+    bus->selected = device;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef startTransfer(SpiBus *bus, SpiTransaction *txn)
+{
+    HAL_StatusTypeDef status = selectDevice(bus, txn->device);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    bus->startCycles = HAL_GetCycleCount();
+    txn->state = SPI_TXN_ACTIVE;
+    if(txn->tx != NULL && txn->rx != NULL)
+    {
+        status = HAL_SPI_TransmitReceive_DMA(bus->hspi, txn->tx, txn->rx, txn->length);
+    }
+    else if(txn->tx != NULL)
+    {
+        status = HAL_SPI_Transmit_DMA(bus->hspi, txn->tx, txn->length);
+    }
+    else
+    {
+        status = HAL_SPI_Receive_DMA(bus->hspi, txn->rx, txn->length);
+    }
+
+    if(status != HAL_OK)
+    {
+        deselect(bus);
+    }
+    return status;
+}
+
+/**
+ * @brief Start the head of the queue, failing transactions are moved to a list
+ * @retval Transactions that could not be started, to be completed outside the critical section
+ * @note   Called with interrupts masked
+ */
+SpiTransaction *startHead(SpiBus *bus)
+{
+    SpiTransaction *failed = NULL;
+    SpiTransaction **failedTail = &failed;
+
+    while(bus->head != NULL)
+    {
+        SpiTransaction *txn = bus->head;
+        HAL_StatusTypeDef status = startTransfer(bus, txn);
+        if(status == HAL_OK)
+        {
+            return failed;
+        }
+
+        bus->stats.errors++;
+        bus->head = txn->next;
+        bus->queueDepth--;
+        txn->status = status;
+        txn->next = NULL;
+        *failedTail = txn;
+        failedTail = &txn->next;
+    }
+
+    bus->tail = NULL;
+    powerManagerUnlockMode(POWER_MODE_SLEEP);
+    powerManagerReleaseClock(POWER_CLOCK_DMA);
+    return failed;
+}
+
+void complete(SpiTransaction *txn)
+{
+    while(txn != NULL)
+    {
+        SpiTransaction *next = txn->next;
+        txn->next = NULL;
+        txn->state = SPI_TXN_DONE;
+        if(txn->complete != NULL)
+        {
+            txn->complete(txn, txn->ctx);
+        }
+        txn = next;
+    }
+}
+
+void finish(SpiBus *bus, HAL_StatusTypeDef status)
+{
+    uint32_t now = HAL_GetCycleCount();
+    uint32_t state = HAL_CriticalEnter();
+
+    SpiTransaction *done = bus->head;
+    if(done == NULL || done->state != SPI_TXN_ACTIVE)
+    {
+        HAL_CriticalExit(state);
+        return;
+    }
+
+    bus->stats.busyCycles += now - bus->startCycles;
+    bus->stats.transactions++;
+    if(status == HAL_OK)
+    {
+        bus->stats.bytes += done->length;
+    }
+    else
+    {
+        bus->stats.errors++;
+    }
+
+    bus->head = done->next;
+    bus->queueDepth--;
+    done->next = NULL;
+    done->status = status;
+
+    SpiTransaction *next = bus->head;
+    bool keep = status == HAL_OK && done->keepSelected && next != NULL && next->device == done->device;
+    if(!keep)
+    {
+        deselect(bus);
+    }
+
+    SpiTransaction *failed = NULL;
+    if(next != NULL)
+    {
+        failed = startHead(bus);
+        if(bus->head != NULL)
+        {
+            uint32_t gap = bus->startCycles - now;
+            bus->stats.chained++;
+            bus->stats.chainGapCycles += gap;
+            if(gap > bus->stats.maxChainGapCycles)
+            {
+                bus->stats.maxChainGapCycles = gap;
+            }
+        }
+    }
+    else
+    {
+        bus->tail = NULL;
+        powerManagerUnlockMode(POWER_MODE_SLEEP);
+        powerManagerReleaseClock(POWER_CLOCK_DMA);
+    }
+    HAL_CriticalExit(state);
+
+    // The next transfer is already running, callbacks no longer add bus idle time
+    complete(done);
+    complete(failed);
+}
+
+void onTransferComplete(void *ctx)
+{
+    finish((SpiBus *)ctx, HAL_OK);
+}
+
+void onError(void *ctx)
+{
+    SpiBus *bus = (SpiBus *)ctx;
+    HAL_SPI_Abort(bus->hspi);
+    finish(bus, HAL_ERROR);
+}
+
+const HalSpiCallbacks spiBusCallbacks = {
+    onTransferComplete,
+    onError
+};
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef spiBusInit(SpiBus *bus, SPI_HandleTypeDef *hspi, PowerClock clock)
+{
+    if(bus == NULL || hspi == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    memset(bus, 0, sizeof(*bus));
+    bus->hspi = hspi;
+    bus->clock = clock;
+    HAL_EnableCycleCounter();
+
+    HAL_StatusTypeDef status = powerManagerAcquireClock(clock);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    status = halSpiRegisterCallbacks(hspi, &spiBusCallbacks, bus);
+    if(status != HAL_OK)
+    {
+        powerManagerReleaseClock(clock);
+        bus->hspi = NULL;
+    }
+    return status;
+}
+
+HAL_StatusTypeDef spiBusSubmit(SpiBus *bus, SpiTransaction *txn)
+{
+    if(bus == NULL || bus->hspi == NULL || txn == NULL || txn->device == NULL || txn->length == 0 ||
+       (txn->tx == NULL && txn->rx == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    if(txn->state == SPI_TXN_QUEUED || txn->state == SPI_TXN_ACTIVE)
+    {
+        HAL_CriticalExit(state);
+        return HAL_BUSY;
+    }
+
+    txn->next = NULL;
+    txn->status = HAL_OK;
+    txn->state = SPI_TXN_QUEUED;
+    if(++bus->queueDepth > bus->stats.maxQueueDepth)
+    {
+        bus->stats.maxQueueDepth = bus->queueDepth;
+    }
+
+    SpiTransaction *failed = NULL;
+    if(bus->head == NULL)
+    {
+        // DMA transfers stop in Stop mode, stay in Sleep and keep the DMA clocked until the queue drains
+        powerManagerLockMode(POWER_MODE_SLEEP);
+        (void)powerManagerAcquireClock(POWER_CLOCK_DMA);
+        bus->head = txn;
+        bus->tail = txn;
+        failed = startHead(bus);
+    }
+    else
+    {
+        bus->tail->next = txn;
+        bus->tail = txn;
+    }
+    HAL_CriticalExit(state);
+
+    complete(failed);
+    return HAL_OK;
+}
+
+int spiTransactionDone(const SpiTransaction *txn)
+{
+    return txn->state == SPI_TXN_DONE ? 1 : 0;
+}
+
+int spiBusIsIdle(const SpiBus *bus)
+{
+    return bus->head == NULL ? 1 : 0;
+}
+
+void spiBusGetStats(const SpiBus *bus, SpiBusStats *stats)
+{
+    if(bus == NULL || stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    *stats = bus->stats;
+    HAL_CriticalExit(state);
+}
+
+} // extern "C"
@@ -0,0 +1,329 @@
+/**
+  ******************************************************************************
+  * @file           : trace_recorder.cpp
+  * @brief          : Recording of peripheral traffic for host replay
+  ******************************************************************************
+  */
+
+#include "trace_recorder.h"
+#include "trace_codec.h"
+#include "SEGGER_RTT.h"
+
+#include <stddef.h>
+
+namespace {
+
+constexpr uint32_t DATA_CHUNK = 64;             // Received bytes per UART_DATA event
+constexpr uint32_t LONG_GAP_MS = 10000;         // Past this the cycle counter may have wrapped
+
+struct Port
+{
+    const void *handle;
+    uint8_t number;
+
+    // Reception started by HAL_UART_Receive_IT, recorded once the state says it completed
+    const uint8_t *rxBuffer;
+    uint16_t rxSize;
+};
+
+uint8_t rttBuffer[TRACE_RECORDER_BUFFER_SIZE];
+bool started;
+
+Port uartPorts[TRACE_RECORDER_MAX_PORTS];
+Port smbusPorts[TRACE_RECORDER_MAX_PORTS];
+
+TraceEncoder encoder;
+uint64_t nowUs;
+uint32_t lastCycles;
+uint32_t lastTick;
+uint32_t pendingCycles;         // Below one microsecond, carried to the next event
+
+uint32_t lastCorrelationId;
+
+uint32_t events;
+uint32_t bytes;
+uint32_t dropped;
+uint32_t unreportedDrops;
+
+Port *findPort(Port (&ports)[TRACE_RECORDER_MAX_PORTS], const void *handle)
+{
+    for(Port &port : ports)
+    {
+        if(port.handle == handle && handle != NULL)
+        {
+            return &port;
+        }
+    }
+    return NULL;
+}
+
+HAL_StatusTypeDef addPort(Port (&ports)[TRACE_RECORDER_MAX_PORTS], const void *handle, uint8_t number)
+{
+    if(handle == NULL || number > 0x0FU)
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    Port *slot = findPort(ports, handle);
+    for(size_t i = 0; slot == NULL && i < TRACE_RECORDER_MAX_PORTS; i++)
+    {
+        if(ports[i].handle == NULL)
+        {
+            slot = &ports[i];
+        }
+    }
+    if(slot != NULL)
+    {
+        slot->number = number;
+        slot->rxBuffer = NULL;
+        slot->rxSize = 0;
+        slot->handle = handle;
+    }
+    HAL_CriticalExit(state);
+
+    return slot != NULL ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Advance the trace clock. Caller holds the critical section.
+ */
+void updateClock(void)
+{
+    uint32_t cycles = HAL_GetCycleCount();
+    uint32_t tick = HAL_GetTick();
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+
+    if(tick - lastTick > LONG_GAP_MS || mhz == 0)
+    {
+        nowUs += (uint64_t)(tick - lastTick) * 1000U;
+        pendingCycles = 0;
+    }
+    else
+    {
+        uint32_t elapsed = pendingCycles + (cycles - lastCycles);
+        nowUs += elapsed / mhz;
+        pendingCycles = elapsed % mhz;
+    }
+    lastCycles = cycles;
+    lastTick = tick;
+}
+
+/**
+ * @brief Encode and write one event if RTT has room. Caller holds the critical section.
+ */
+bool emit(const TraceEvent &event)
+{
+    uint8_t out[TRACE_EVENT_MAX_HEADER + DATA_CHUNK];
+    TraceEncoder attempt = encoder;
+    size_t n = attempt.encode(event, out, sizeof(out));
+    if(n == 0 || SEGGER_RTT_GetAvailWriteSpace(TRACE_RECORDER_CHANNEL) < n)
+    {
+        return false;
+    }
+
+    SEGGER_RTT_WriteNoLock(TRACE_RECORDER_CHANNEL, out, (unsigned)n);
+    encoder = attempt;
+    events++;
+    bytes += (uint32_t)n;
+    return true;
+}
+
+void record(TraceKind kind, uint8_t port, uint8_t status, uint32_t value, uint32_t length,
+            const uint8_t *data)
+{
+    TraceEvent event = {};
+    event.kind = kind;
+    event.port = port;
+    event.status = status;
+    event.value = value;
+    event.length = length;
+    event.data = data;
+
+    uint32_t state = HAL_CriticalEnter();
+    updateClock();
+    event.timeUs = nowUs;
+
+    if(unreportedDrops > 0)
+    {
+        TraceEvent drop = {};
+        drop.kind = TRACE_DROPPED;
+        drop.timeUs = nowUs;
+        drop.value = unreportedDrops;
+        if(emit(drop))
+        {
+            unreportedDrops = 0;
+        }
+    }
+
+    if(unreportedDrops > 0 || !emit(event))
+    {
+        dropped++;
+        unreportedDrops++;
+    }
+    HAL_CriticalExit(state);
+}
+
+Port *activeUart(UART_HandleTypeDef *huart)
+{
+    return started ? findPort(uartPorts, huart) : NULL;
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef traceRecorderStart(void)
+{
+    if(started)
+    {
+        return HAL_OK;
+    }
+    if(SEGGER_RTT_ConfigUpBuffer(TRACE_RECORDER_CHANNEL, "PTrace", rttBuffer, sizeof(rttBuffer),
+                                 SEGGER_RTT_MODE_NO_BLOCK_SKIP) < 0)
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_EnableCycleCounter();
+    uint32_t state = HAL_CriticalEnter();
+    SEGGER_RTT_WriteNoLock(TRACE_RECORDER_CHANNEL, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    encoder.reset();
+    nowUs = 0;
+    pendingCycles = 0;
+    lastCycles = HAL_GetCycleCount();
+    lastTick = HAL_GetTick();
+    started = true;
+    HAL_CriticalExit(state);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef traceRecorderAddUart(UART_HandleTypeDef *huart, uint8_t port)
+{
+    return addPort(uartPorts, huart, port);
+}
+
+HAL_StatusTypeDef traceRecorderAddSmbus(SMBUS_HandleTypeDef *hsmbus, uint8_t port)
+{
+    return addPort(smbusPorts, hsmbus, port);
+}
+
+void traceRecorderGetStats(TraceRecorderStats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    stats->events = events;
+    stats->bytes = bytes;
+    stats->dropped = dropped;
+    HAL_CriticalExit(state);
+}
+
+void traceRecordUartTransmit(UART_HandleTypeDef *huart, HAL_StatusTypeDef status, uint16_t size)
+{
+    Port *port = activeUart(huart);
+    if(port != NULL)
+    {
+        record(TRACE_UART_TX, port->number, (uint8_t)status, size, 0, NULL);
+    }
+}
+
+void traceRecordUartReceive(UART_HandleTypeDef *huart, HAL_StatusTypeDef status, const uint8_t *buffer, uint16_t size)
+{
+    Port *port = activeUart(huart);
+    if(port != NULL)
+    {
+        port->rxBuffer = status == HAL_OK ? buffer : NULL;
+        port->rxSize = status == HAL_OK ? size : 0;
+        record(TRACE_UART_RX, port->number, (uint8_t)status, size, 0, NULL);
+    }
+}
+
+void traceRecordUartState(UART_HandleTypeDef *huart, HAL_UART_StateTypeDef state)
+{
+    Port *port = activeUart(huart);
+    if(port == NULL)
+    {
+        return;
+    }
+
+    record(TRACE_UART_STATE, port->number, (uint8_t)state, 0, 0, NULL);
+
+    // A ready state after Receive_IT means the whole buffer arrived: record what the task will read
+    if(state == HAL_UART_STATE_READY && port->rxBuffer != NULL)
+    {
+        for(uint32_t offset = 0; offset < port->rxSize; offset += DATA_CHUNK)
+        {
+            uint32_t length = port->rxSize - offset < DATA_CHUNK ? port->rxSize - offset : DATA_CHUNK;
+            record(TRACE_UART_DATA, port->number, 0, 0, length, port->rxBuffer + offset);
+        }
+        port->rxBuffer = NULL;
+        port->rxSize = 0;
+    }
+}
+
+void traceRecordUartTxDone(UART_HandleTypeDef *huart)
+{
+    Port *port = activeUart(huart);
+    if(port != NULL)
+    {
+        record(TRACE_UART_TX_DONE, port->number, 0, 0, 0, NULL);
+    }
+}
+
+void traceRecordUartError(UART_HandleTypeDef *huart)
+{
+    Port *port = activeUart(huart);
+    if(port != NULL)
+    {
+        record(TRACE_UART_ERROR, port->number, 0, HAL_UART_GetError(huart), 0, NULL);
+    }
+}
+
+void traceRecordUartRxEvent(UART_HandleTypeDef *huart, uint16_t size)
+{
+    Port *port = activeUart(huart);
+    if(port != NULL)
+    {
+        record(TRACE_UART_RX_EVENT, port->number, 0, size, 0, NULL);
+    }
+}
+
+void traceRecordSmbusTransmit(SMBUS_HandleTypeDef *hsmbus, HAL_StatusTypeDef status, uint16_t address, uint16_t size)
+{
+    Port *port = started ? findPort(smbusPorts, hsmbus) : NULL;
+    if(port != NULL)
+    {
+        record(TRACE_SMBUS_TX, port->number, (uint8_t)status, address, size, NULL);
+    }
+}
+
+uint32_t traceNewCorrelationId(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    lastCorrelationId = lastCorrelationId + 1U != 0 ? lastCorrelationId + 1U : 1U;
+    uint32_t id = lastCorrelationId;
+    HAL_CriticalExit(state);
+    return id;
+}
+
+void traceSpanStart(uint32_t id, uint8_t stage)
+{
+    if(started && id != 0)
+    {
+        record(TRACE_SPAN_START, stage, 0, id, 0, NULL);
+    }
+}
+
+void traceSpanEnd(uint32_t id, uint8_t stage, HAL_StatusTypeDef status)
+{
+    if(started && id != 0)
+    {
+        record(TRACE_SPAN_END, stage, (uint8_t)status, id, 0, NULL);
+    }
+}
+
+} // extern "C"
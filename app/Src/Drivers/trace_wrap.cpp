@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file           : trace_wrap.cpp
+  * @brief          : Link-time wrappers recording HAL peripheral calls
+  ******************************************************************************
+  * Only linked when the board passes -Wl,--wrap=<function> for each of these
+  * (PERIPHERAL_TRACE builds): the linker then routes every call from the app
+  * to __wrap_<function>, and __real_<function> reaches the HAL.
+  ******************************************************************************
+  */
+
+#include "trace_recorder.h"
+
+extern "C" {
+
+HAL_StatusTypeDef __real_HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef __real_HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_UART_StateTypeDef __real_HAL_UART_GetState(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef __real_HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbus, uint16_t DevAddress, uint8_t *pData,
+                                                      uint16_t Size, uint32_t XferOptions);
+
+HAL_StatusTypeDef __wrap_HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    HAL_StatusTypeDef status = __real_HAL_UART_Transmit_IT(huart, pData, Size);
+    traceRecordUartTransmit(huart, status, Size);
+    return status;
+}
+
+HAL_StatusTypeDef __wrap_HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    HAL_StatusTypeDef status = __real_HAL_UART_Receive_IT(huart, pData, Size);
+    traceRecordUartReceive(huart, status, pData, Size);
+    return status;
+}
+
+HAL_UART_StateTypeDef __wrap_HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    HAL_UART_StateTypeDef state = __real_HAL_UART_GetState(huart);
+    traceRecordUartState(huart, state);
+    return state;
+}
+
+HAL_StatusTypeDef __wrap_HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbus, uint16_t DevAddress, uint8_t *pData,
+                                                      uint16_t Size, uint32_t XferOptions)
+{
+    HAL_StatusTypeDef status = __real_HAL_SMBUS_Master_Transmit_IT(hsmbus, DevAddress, pData, Size, XferOptions);
+    traceRecordSmbusTransmit(hsmbus, status, DevAddress, Size);
+    return status;
+}
+
+} // extern "C"
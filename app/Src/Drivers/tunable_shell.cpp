@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : tunable_shell.cpp
+  * @brief          : Tunable parameter commands over RTT and the UART link
+  ******************************************************************************
+  */
+
+#include "tunable_shell.h"
+#include "tunables.h"
+#include "SEGGER_RTT.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const char USAGE[] = "usage: list [from] | get <name> | set <name> <value> | reset <name>|all | save\n";
+
+TunableShell shell;
+
+char typed[TUNABLE_SHELL_LINE_MAX];
+size_t lineLength;
+bool lineTooLong;               // Rest of an overlong line is dropped
+
+char reply[512];
+
+void answer(void)
+{
+    typed[lineLength] = '\0';
+    tunableShellExecute(typed, reply, sizeof(reply));
+    SEGGER_RTT_Write(0, reply, (unsigned)strlen(reply));
+}
+
+} // namespace
+
+extern "C" {
+
+void tunableShellSetSave(TunableShellSaveFn fn, void *ctx)
+{
+    shell.setSave(fn, ctx);
+}
+
+int tunableShellExecute(const char *line, char *out, size_t capacity)
+{
+    if(shell.execute(line, out, capacity))
+    {
+        return 1;
+    }
+    if(out != NULL && capacity > 0)
+    {
+        snprintf(out, capacity, "%s", USAGE);
+    }
+    return 0;
+}
+
+void tunableShellPoll(void)
+{
+    char input[16];
+    unsigned count;
+    while((count = SEGGER_RTT_Read(TUNABLE_SHELL_CHANNEL, input, sizeof(input))) > 0)
+    {
+        for(unsigned i = 0; i < count; i++)
+        {
+            char c = input[i];
+            if(c == '\r' || c == '\n')
+            {
+                if(lineTooLong)
+                {
+                    SEGGER_RTT_WriteString(0, "error: line too long\n");
+                }
+                else if(lineLength > 0)
+                {
+                    answer();
+                }
+                lineLength = 0;
+                lineTooLong = false;
+            }
+            else if(lineLength + 1U < sizeof(typed))
+            {
+                typed[lineLength++] = c;
+            }
+            else
+            {
+                lineTooLong = true;
+            }
+        }
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,533 @@
+/**
+  ******************************************************************************
+  * @file           : uart_link.cpp
+  * @brief          : Framed UART link with automatic baud-rate negotiation
+  ******************************************************************************
+  */
+
+#include "uart_link.h"
+#include "hal_callbacks.h"
+#include "clock_sync.h"
+#include "baud_negotiator.h"
+#include "byte_ring.h"
+#include "frame_codec.h"
+#include "time_sync.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+// Highest first, the last entry is the start-up and fallback rate
+const uint32_t linkRates[] = {2000000U, 1000000U, 921600U, 460800U, 230400U, 115200U};
+
+constexpr uint32_t OVERSAMPLING = 16U;
+constexpr uint32_t MAX_ERROR_PERMILLE = 20U;    // Receivers tolerate about 3.5 %, keep margin for the peer
+constexpr size_t RX_RING_SIZE = 1024U;
+constexpr size_t TX_RING_SIZE = 1024U;
+constexpr size_t TX_DMA_SIZE = 256U;
+constexpr uint32_t RX_STAMPS = 8U;              // Receive events remembered, power of two
+
+struct RxStamp
+{
+    uint32_t cycles;
+    uint32_t endCount;              // Bytes stored up to and including this event
+};
+
+struct UartLink
+{
+    UART_HandleTypeDef *huart;
+    UartLinkRxFn handler;
+
+    uint8_t rxDma[UART_LINK_RX_DMA_SIZE];
+    uint16_t rxDmaPos;              // Next unread position in the circular DMA buffer
+    uint8_t rxStorage[RX_RING_SIZE];
+    ByteRing rxRing;
+
+    // Receive events stamped in the interrupt, matched to frames by byte count
+    RxStamp rxStamps[RX_STAMPS];
+    volatile uint32_t rxStampHead;
+    volatile uint32_t rxStored;     // Bytes that entered the ring
+    uint32_t rxConsumed;            // Bytes the task took out of it
+
+    uint8_t txStorage[TX_RING_SIZE];
+    ByteRing txRing;
+    uint8_t txDma[TX_DMA_SIZE];
+    volatile uint8_t txBusy;
+
+    FrameDecoder decoder;
+    BaudNegotiator negotiator;
+    uint32_t decoderErrors;         // Decoder error total already reported to the negotiator
+    volatile uint32_t uartErrors;
+    uint32_t uartErrorsReported;
+
+    // Parked while quiet, the owner gates USART2 and its DMA meanwhile
+    bool parked;
+    volatile bool wakeRequested;    // Something was sent while parked
+    uint32_t lastActivityMs;        // Last poll that moved bytes or found the link busy
+
+    UartLinkStats stats;
+};
+
+UartLink link;
+
+// ===============================
+// Transmit
+// ===============================
+
+/**
+ * @brief Start the next DMA chunk if the transmitter is idle
+ * @note  Called from task and interrupt context
+ */
+void kickTransmit(void)
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(link.txBusy || link.txRing.used() == 0)
+    {
+        HAL_CriticalExit(state);
+        return;
+    }
+
+    uint16_t length = (uint16_t)link.txRing.read(link.txDma, sizeof(link.txDma));
+    link.txBusy = 1;
+    HAL_CriticalExit(state);
+
+    if(HAL_UART_Transmit_DMA(link.huart, link.txDma, length) != HAL_OK)
+    {
+        link.txBusy = 0;
+        link.uartErrors++;
+    }
+}
+
+bool queueFrame(const uint8_t *payload, size_t length)
+{
+    uint8_t encoded[FRAME_ENCODED_SIZE(BAUD_NEG_MAX_FRAME > UART_LINK_MAX_PAYLOAD ? BAUD_NEG_MAX_FRAME : UART_LINK_MAX_PAYLOAD)];
+    size_t size = frameEncode(payload, length, encoded, sizeof(encoded));
+    if(size == 0)
+    {
+        return false;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    bool fits = link.txRing.free() >= size;
+    if(fits)
+    {
+        link.txRing.write(encoded, size);
+    }
+    HAL_CriticalExit(state);
+
+    if(fits)
+    {
+        link.stats.framesSent++;
+        kickTransmit();
+    }
+    return fits;
+}
+
+// ===============================
+// Receive
+// ===============================
+
+void storeReceived(const uint8_t *data, size_t length)
+{
+    size_t stored = link.rxRing.write(data, length);
+    link.rxStored += (uint32_t)stored;
+    link.stats.rxOverflows += (uint32_t)(length - stored);
+}
+
+/**
+ * @brief Cycle counter at the receive event that delivered the byte ending at count
+ * @note  Falls back to now when the event has been overwritten
+ */
+uint32_t receiveStamp(uint32_t count)
+{
+    uint32_t cycles = HAL_GetCycleCount();
+    uint32_t state = HAL_CriticalEnter();
+    uint32_t head = link.rxStampHead;
+    for(uint32_t age = 0; age < RX_STAMPS && age < head; age++)
+    {
+        const RxStamp &stamp = link.rxStamps[(head - 1U - age) & (RX_STAMPS - 1U)];
+        if((int32_t)(stamp.endCount - count) < 0)
+        {
+            break;
+        }
+        cycles = stamp.cycles;
+    }
+    HAL_CriticalExit(state);
+    return cycles;
+}
+
+void armReceive(void)
+{
+    link.rxDmaPos = 0;
+    if(HAL_UARTEx_ReceiveToIdle_DMA(link.huart, link.rxDma, sizeof(link.rxDma)) != HAL_OK)
+    {
+        link.uartErrors++;
+    }
+}
+
+void onRxEvent(void *ctx, uint16_t position)
+{
+    (void)ctx;
+    uint32_t cycles = HAL_GetCycleCount();
+    uint32_t storedBefore = link.rxStored;
+
+    // Half, full and idle events all report the DMA write position
+    if(position < link.rxDmaPos)
+    {
+        storeReceived(&link.rxDma[link.rxDmaPos], sizeof(link.rxDma) - link.rxDmaPos);
+        link.rxDmaPos = 0;
+    }
+    if(position > link.rxDmaPos)
+    {
+        storeReceived(&link.rxDma[link.rxDmaPos], position - link.rxDmaPos);
+        link.rxDmaPos = position;
+    }
+    if(link.rxDmaPos == sizeof(link.rxDma))
+    {
+        link.rxDmaPos = 0;
+    }
+
+    if(link.rxStored != storedBefore)
+    {
+        RxStamp &stamp = link.rxStamps[link.rxStampHead & (RX_STAMPS - 1U)];
+        stamp.cycles = cycles;
+        stamp.endCount = link.rxStored;
+        link.rxStampHead = link.rxStampHead + 1U;
+    }
+}
+
+void onTxComplete(void *ctx)
+{
+    (void)ctx;
+    link.txBusy = 0;
+    kickTransmit();
+}
+
+void onError(void *ctx)
+{
+    (void)ctx;
+    link.uartErrors++;
+    HAL_UART_AbortReceive(link.huart);
+    armReceive();
+}
+
+const HalUartCallbacks linkCallbacks = {
+    onRxEvent,
+    NULL,
+    onError,
+    onTxComplete
+};
+
+// ===============================
+// Negotiator hooks
+// ===============================
+
+bool rateSupported(uint32_t baud, void *ctx)
+{
+    (void)ctx;
+    uint32_t clock = HAL_UART_GetKernelClockFreq(link.huart);
+    uint32_t divider = (clock + baud / 2U) / baud;
+    if(divider < OVERSAMPLING)
+    {
+        return false;
+    }
+
+    uint32_t actual = clock / divider;
+    uint32_t error = actual > baud ? actual - baud : baud - actual;
+    return (uint64_t)error * 1000U <= (uint64_t)baud * MAX_ERROR_PERMILLE;
+}
+
+bool setBaud(uint32_t baud, void *ctx)
+{
+    (void)ctx;
+    HAL_UART_AbortReceive(link.huart);
+    HAL_StatusTypeDef status = HAL_UART_SetBaudRate(link.huart, baud);
+
+    // Whatever was in flight belongs to the old rate
+    uint32_t state = HAL_CriticalEnter();
+    link.rxRing.clear();
+    link.rxConsumed = link.rxStored;
+    HAL_CriticalExit(state);
+    link.decoder.reset();
+    armReceive();
+    return status == HAL_OK;
+}
+
+bool sendFrame(const uint8_t *payload, size_t length, void *ctx)
+{
+    (void)ctx;
+    return queueFrame(payload, length);
+}
+
+/**
+ * @brief Check whether a frame or a negotiation is in flight, the link must keep listening
+ */
+bool busy(void)
+{
+    BaudNegotiator::State negotiation = link.negotiator.currentState();
+    uint32_t state = HAL_CriticalEnter();
+    bool moving = link.txBusy || link.txRing.used() > 0 || link.rxStored != link.rxConsumed;
+    HAL_CriticalExit(state);
+    return moving || (negotiation != BaudNegotiator::IDLE && negotiation != BaudNegotiator::RUNNING);
+}
+
+void reportLineErrors(uint32_t now)
+{
+    const FrameDecoderStats &decoderStats = link.decoder.stats();
+    uint32_t decoderErrors = decoderStats.crcErrors + decoderStats.malformed + decoderStats.overflows;
+    uint32_t uartErrors = link.uartErrors;
+    uint32_t fresh = (decoderErrors - link.decoderErrors) + (uartErrors - link.uartErrorsReported);
+    link.decoderErrors = decoderErrors;
+    link.uartErrorsReported = uartErrors;
+    if(fresh > 0)
+    {
+        link.negotiator.reportErrors(fresh, now);
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef uartLinkInit(UART_HandleTypeDef *huart, UartLinkRole role, UartLinkRxFn handler)
+{
+    if(huart == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    link.huart = huart;
+    link.handler = handler;
+    link.rxRing.attach(link.rxStorage, sizeof(link.rxStorage));
+    link.rxStampHead = 0;
+    link.rxStored = 0;
+    link.rxConsumed = 0;
+    link.txRing.attach(link.txStorage, sizeof(link.txStorage));
+    link.txBusy = 0;
+    link.decoder.reset();
+    link.decoderErrors = 0;
+    link.uartErrors = 0;
+    link.uartErrorsReported = 0;
+    link.parked = false;
+    link.wakeRequested = false;
+    link.lastActivityMs = HAL_GetTick();
+    memset(&link.stats, 0, sizeof(link.stats));
+
+    HAL_StatusTypeDef status = halUartRegisterCallbacks(huart, &linkCallbacks, &link);
+    if(status != HAL_OK)
+    {
+        link.huart = NULL;
+        return status;
+    }
+
+    BaudNegotiatorConfig config;
+    config.master = role == UART_LINK_MASTER;
+    config.rates = linkRates;
+    config.rateCount = sizeof(linkRates) / sizeof(linkRates[0]);
+    config.rateSupported = rateSupported;
+    config.setBaud = setBaud;
+    config.sendFrame = sendFrame;
+    config.ctx = &link;
+    if(!link.negotiator.init(config, HAL_GetTick()))
+    {
+        halUartUnregisterCallbacks(huart);
+        link.huart = NULL;
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+void uartLinkSetHandler(UartLinkRxFn handler)
+{
+    link.handler = handler;
+}
+
+int uartLinkIsActive(void)
+{
+    return link.huart != NULL ? 1 : 0;
+}
+
+int uartLinkIsReady(void)
+{
+    return link.huart != NULL && !link.parked && link.negotiator.linkReady() ? 1 : 0;
+}
+
+uint32_t uartLinkIdleTime(void)
+{
+    if(link.huart == NULL || link.parked || busy())
+    {
+        return 0;
+    }
+    return HAL_GetTick() - link.lastActivityMs;
+}
+
+HAL_StatusTypeDef uartLinkPark(void)
+{
+    if(link.huart == NULL || link.parked)
+    {
+        return HAL_ERROR;
+    }
+    if(busy())
+    {
+        return HAL_BUSY;
+    }
+
+    HAL_UART_AbortReceive(link.huart);
+    link.wakeRequested = false;
+    link.parked = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef uartLinkResume(void)
+{
+    if(link.huart == NULL || !link.parked)
+    {
+        return HAL_ERROR;
+    }
+
+    // Partial frames from before the link was parked cannot be completed
+    link.decoder.reset();
+    link.parked = false;
+    link.lastActivityMs = HAL_GetTick();
+    armReceive();
+    return HAL_OK;
+}
+
+int uartLinkIsParked(void)
+{
+    return link.parked ? 1 : 0;
+}
+
+int uartLinkWakeRequested(void)
+{
+    return link.parked && link.wakeRequested ? 1 : 0;
+}
+
+HAL_StatusTypeDef uartLinkSend(const uint8_t *payload, uint16_t length)
+{
+    if(link.huart == NULL || length > UART_LINK_MAX_PAYLOAD || (payload == NULL && length > 0))
+    {
+        return HAL_ERROR;
+    }
+    if(link.parked)
+    {
+        link.wakeRequested = true;
+        return HAL_BUSY;
+    }
+
+    // Payloads that look like negotiation or time sync messages would be swallowed by the peer
+    bool reserved = BaudNegotiator::isControlFrame(payload, length) || TimeSyncMessage::isMessage(payload, length);
+    if(!link.negotiator.linkReady() || reserved)
+    {
+        return link.negotiator.linkReady() ? HAL_ERROR : HAL_BUSY;
+    }
+
+    return queueFrame(payload, length) ? HAL_OK : HAL_BUSY;
+}
+
+HAL_StatusTypeDef uartLinkSendService(const uint8_t *payload, uint16_t length)
+{
+    if(link.huart == NULL || !TimeSyncMessage::isMessage(payload, length))
+    {
+        return HAL_ERROR;
+    }
+    if(link.parked)
+    {
+        link.wakeRequested = true;
+        return HAL_BUSY;
+    }
+
+    // On an idle transmitter the frame goes out now, the caller's stamp is its send time
+    uint32_t state = HAL_CriticalEnter();
+    bool idle = !link.txBusy && link.txRing.used() == 0;
+    HAL_CriticalExit(state);
+    if(!link.negotiator.linkReady() || !idle)
+    {
+        return HAL_BUSY;
+    }
+
+    return queueFrame(payload, length) ? HAL_OK : HAL_BUSY;
+}
+
+void uartLinkPoll(void)
+{
+    if(link.huart == NULL || link.parked)
+    {
+        return;
+    }
+
+    uint32_t now = HAL_GetTick();
+    uint8_t chunk[64];
+    size_t count;
+    for(;;)
+    {
+        uint32_t state = HAL_CriticalEnter();
+        count = link.rxRing.read(chunk, sizeof(chunk));
+        HAL_CriticalExit(state);
+        if(count == 0)
+        {
+            break;
+        }
+        uint32_t consumed = link.rxConsumed;
+        link.rxConsumed += (uint32_t)count;
+        link.lastActivityMs = now;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(link.decoder.push(chunk[i]) != FrameDecoder::FRAME)
+            {
+                continue;
+            }
+
+            const uint8_t *payload = link.decoder.payload();
+            size_t length = link.decoder.length();
+            if(BaudNegotiator::isControlFrame(payload, length))
+            {
+                link.negotiator.handleFrame(payload, length, now);
+                continue;
+            }
+            if(TimeSyncMessage::isMessage(payload, length))
+            {
+                link.negotiator.noteGoodFrame(now);
+                clockSyncHandleFrame(payload, (uint16_t)length, receiveStamp(consumed + (uint32_t)i + 1U));
+                continue;
+            }
+
+            link.stats.framesReceived++;
+            link.negotiator.noteGoodFrame(now);
+            link.negotiator.noteDelivered((uint32_t)length);
+            if(link.handler != NULL)
+            {
+                link.handler(payload, (uint16_t)length);
+            }
+        }
+    }
+
+    reportLineErrors(now);
+    link.negotiator.tick(now);
+    if(busy())
+    {
+        link.lastActivityMs = now;
+    }
+}
+
+void uartLinkGetStats(UartLinkStats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    const BaudNegotiatorStats &negotiation = link.negotiator.stats();
+    *stats = link.stats;
+    stats->baudRate = negotiation.baud;
+    stats->negotiations = negotiation.negotiations;
+    stats->trialsFailed = negotiation.trialsFailed;
+    stats->fallbacks = negotiation.fallbacks;
+    stats->lineErrors = negotiation.lineErrors;
+    stats->throughputBps = negotiation.throughputBps;
+}
+
+} // extern "C"
@@ -0,0 +1,297 @@
+/**
+  ******************************************************************************
+  * @file           : us_timer.cpp
+  * @brief          : Microsecond one-shot and periodic timer events
+  ******************************************************************************
+  */
+
+#include "us_timer.h"
+#include "deadline_heap.h"
+#include "power_manager.h"
+#include "work_queue.h"
+
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+struct Timer
+{
+    UsTimerFn fn;
+    void *ctx;
+    UsTimerContext context;
+    uint32_t periodUs;
+    uint8_t generation;         // Bumped by stop and restart, stale deferred runs compare it
+};
+
+struct DeferredRun
+{
+    uint8_t id;
+    uint8_t generation;
+    uint32_t deadline;
+};
+
+struct JitterSum
+{
+    uint32_t samples;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t sumUs;
+};
+
+struct UsTimerService
+{
+    Timer timers[US_TIMER_MAX];
+    uint8_t created;
+    DeadlineHeap<US_TIMER_MAX> pending;
+    bool started;
+
+    uint32_t interrupts;
+    uint32_t fired;
+    uint32_t overruns;
+    uint32_t deferFailures;
+    uint32_t staleRuns;
+    JitterSum isr;
+    JitterSum deferred;
+};
+
+UsTimerService service;
+
+void addSample(JitterSum &sum, uint32_t latencyUs)
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(sum.samples == 0 || latencyUs < sum.minUs)
+    {
+        sum.minUs = latencyUs;
+    }
+    if(latencyUs > sum.maxUs)
+    {
+        sum.maxUs = latencyUs;
+    }
+    sum.sumUs += latencyUs;
+    sum.samples++;
+    HAL_CriticalExit(state);
+}
+
+UsTimerJitter report(const JitterSum &sum)
+{
+    UsTimerJitter jitter;
+    jitter.samples = sum.samples;
+    jitter.minUs = sum.minUs;
+    jitter.maxUs = sum.maxUs;
+    jitter.avgUs = sum.samples > 0 ? (uint32_t)(sum.sumUs / sum.samples) : 0;
+    return jitter;
+}
+
+/**
+ * @brief Point the compare channel at the earliest deadline, inside a critical section
+ */
+void rearm(void)
+{
+    if(service.pending.empty())
+    {
+        HAL_UsTimerDisableCompare();
+        return;
+    }
+
+    uint32_t deadline = service.pending.top().deadline;
+    HAL_UsTimerSetCompare(deadline);
+
+    // A compare written after the counter passed it never matches, take the interrupt by hand
+    if(deadlineReached(deadline, HAL_UsTimerNow()))
+    {
+        HAL_UsTimerForce();
+    }
+}
+
+void runDeferred(const void *data, uint16_t size)
+{
+    (void)size;
+    DeferredRun run;
+    memcpy(&run, data, sizeof(run));
+    uint32_t now = HAL_UsTimerNow();
+
+    Timer &timer = service.timers[run.id];
+    if(timer.generation != run.generation)
+    {
+        service.staleRuns++;
+        return;
+    }
+    addSample(service.deferred, now - run.deadline);
+    timer.fn(timer.ctx);
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef usTimerInit(void)
+{
+    if(service.started)
+    {
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef status = powerManagerAcquireClock(POWER_CLOCK_TIM2);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    status = HAL_UsTimerStart();
+    if(status != HAL_OK)
+    {
+        powerManagerReleaseClock(POWER_CLOCK_TIM2);
+        return status;
+    }
+
+    service.started = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef usTimerCreate(UsTimerFn fn, void *ctx, UsTimerContext context, uint8_t *id)
+{
+    if(fn == NULL || id == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    if(service.created >= US_TIMER_MAX)
+    {
+        HAL_CriticalExit(state);
+        return HAL_ERROR;
+    }
+    uint8_t index = service.created++;
+    service.timers[index] = Timer{ fn, ctx, context, 0, 0 };
+    HAL_CriticalExit(state);
+
+    *id = index;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef usTimerStart(uint8_t id, uint32_t delayUs, uint32_t periodUs)
+{
+    if(delayUs > US_TIMER_MAX_DELAY_US)
+    {
+        return HAL_ERROR;
+    }
+    return usTimerStartAt(id, HAL_UsTimerNow() + delayUs, periodUs);
+}
+
+HAL_StatusTypeDef usTimerStartAt(uint8_t id, uint32_t deadline, uint32_t periodUs)
+{
+    if(!service.started || id >= service.created || periodUs > US_TIMER_MAX_DELAY_US)
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    Timer &timer = service.timers[id];
+    timer.periodUs = periodUs;
+    timer.generation++;
+    service.pending.schedule(id, deadline);
+    rearm();
+    HAL_CriticalExit(state);
+    return HAL_OK;
+}
+
+void usTimerStop(uint8_t id)
+{
+    if(id >= service.created)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    service.timers[id].generation++;
+    if(service.pending.remove(id))
+    {
+        rearm();
+    }
+    HAL_CriticalExit(state);
+}
+
+int usTimerIsActive(uint8_t id)
+{
+    return service.pending.contains(id) ? 1 : 0;
+}
+
+uint32_t usTimerNow(void)
+{
+    return HAL_UsTimerNow();
+}
+
+void usTimerDelay(uint32_t us)
+{
+    uint32_t start = HAL_UsTimerNow();
+    while(HAL_UsTimerNow() - start < us)
+    {
+    }
+}
+
+void usTimerCompareIrq(void)
+{
+    service.interrupts++;
+
+    for(;;)
+    {
+        uint32_t state = HAL_CriticalEnter();
+        uint32_t now = HAL_UsTimerNow();
+        if(service.pending.empty() || !deadlineReached(service.pending.top().deadline, now))
+        {
+            rearm();
+            HAL_CriticalExit(state);
+            return;
+        }
+
+        DeadlineHeap<US_TIMER_MAX>::Entry due = service.pending.pop();
+        Timer &timer = service.timers[due.id];
+        if(timer.periodUs != 0)
+        {
+            // Anchored to the schedule; whole periods already gone are skipped
+            uint32_t missed = (now - due.deadline) / timer.periodUs;
+            service.overruns += missed;
+            service.pending.schedule(due.id, due.deadline + (missed + 1U) * timer.periodUs);
+        }
+        service.fired++;
+        UsTimerFn fn = timer.fn;
+        void *ctx = timer.ctx;
+        UsTimerContext context = timer.context;
+        uint8_t generation = timer.generation;
+        HAL_CriticalExit(state);
+
+        if(context == US_TIMER_IN_ISR)
+        {
+            addSample(service.isr, HAL_UsTimerNow() - due.deadline);
+            fn(ctx);
+        }
+        else
+        {
+            DeferredRun run = { due.id, generation, due.deadline };
+            if(workQueueSubmit(WORK_LANE_HIGH, runDeferred, &run, sizeof(run)) != HAL_OK)
+            {
+                service.deferFailures++;
+            }
+        }
+    }
+}
+
+void usTimerGetStats(UsTimerStats *stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t state = HAL_CriticalEnter();
+    stats->interrupts = service.interrupts;
+    stats->fired = service.fired;
+    stats->overruns = service.overruns;
+    stats->deferFailures = service.deferFailures;
+    stats->staleRuns = service.staleRuns;
+    stats->isr = report(service.isr);
+    stats->deferred = report(service.deferred);
+    HAL_CriticalExit(state);
+}
+
+} // extern "C"
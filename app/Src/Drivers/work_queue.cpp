@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file           : work_queue.cpp
+  * @brief          : Deferred work service with priority lanes
+  ******************************************************************************
+  */
+
+#include "work_queue.h"
+#include "mpsc_ring.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <atomic>
+
+namespace {
+
+constexpr uint32_t WAIT_FOREVER = 0xFFFFFFFFU;
+
+struct WorkItem
+{
+    WorkFn fn;
+    uint32_t submitCycles;
+    uint16_t size;
+    uint8_t data[WORK_DATA_SIZE];
+};
+
+struct LaneConfig
+{
+    const char *name;
+    uint32_t stackWords;
+    uint32_t priority;          // Above idle
+};
+
+// The high lane preempts the application tasks (idle + 2), the low lane yields to them
+const LaneConfig laneConfigs[WORK_LANE_COUNT] = {
+    { "workHigh",   256, 5 },
+    { "workNormal", 384, 3 },
+    { "workLow",    256, 1 },
+};
+
+struct Lane
+{
+    MpscRing<WorkItem, WORK_LANE_DEPTH> ring;
+    void *worker;
+
+    // Producers may be several interrupts, the counters they touch are atomic
+    std::atomic<uint32_t> submitted;
+    std::atomic<uint32_t> overflows;
+
+    uint32_t executed;
+    uint32_t maxDepth;
+    uint32_t lastLatencyCycles;
+    uint32_t maxLatencyCycles;
+    uint64_t totalLatencyCycles;
+};
+
+Lane lanes[WORK_LANE_COUNT];
+bool initialized;
+
+uint32_t cyclesToUs(uint64_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    return mhz == 0 ? 0 : (uint32_t)(cycles / mhz);
+}
+
+void workerMain(void *arg)
+{
+    Lane *lane = static_cast<Lane *>(arg);
+    for(;;)
+    {
+        HAL_WorkerWait(WAIT_FOREVER);
+
+        uint32_t depth = (uint32_t)lane->ring.size();
+        if(depth > lane->maxDepth)
+        {
+            lane->maxDepth = depth;
+        }
+
+        WorkItem item;
+        while(lane->ring.pop(item))
+        {
+            uint32_t latency = HAL_GetCycleCount() - item.submitCycles;
+            lane->lastLatencyCycles = latency;
+            if(latency > lane->maxLatencyCycles)
+            {
+                lane->maxLatencyCycles = latency;
+            }
+            lane->totalLatencyCycles += latency;
+
+            item.fn(item.data, item.size);
+            lane->executed++;
+        }
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef workQueueInit(void)
+{
+    if(initialized)
+    {
+        return HAL_OK;
+    }
+
+    HAL_EnableCycleCounter();
+    for(size_t i = 0; i < WORK_LANE_COUNT; i++)
+    {
+        const LaneConfig &config = laneConfigs[i];
+        HAL_StatusTypeDef status = HAL_WorkerCreate(workerMain, &lanes[i], config.name, config.stackWords,
+                                                    config.priority, &lanes[i].worker);
+        if(status != HAL_OK)
+        {
+            return status;
+        }
+    }
+
+    initialized = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef workQueueSubmit(WorkLane lane, WorkFn fn, const void *data, uint16_t size)
+{
+    if(!initialized || lane >= WORK_LANE_COUNT || fn == NULL || size > WORK_DATA_SIZE || (data == NULL && size > 0))
+    {
+        return HAL_ERROR;
+    }
+
+    WorkItem item;
+    item.fn = fn;
+    item.size = size;
+    if(size > 0)
+    {
+        memcpy(item.data, data, size);
+    }
+    item.submitCycles = HAL_GetCycleCount();
+
+    Lane &target = lanes[lane];
+    if(!target.ring.push(item))
+    {
+        target.overflows.fetch_add(1U, std::memory_order_relaxed);
+        return HAL_BUSY;
+    }
+
+    target.submitted.fetch_add(1U, std::memory_order_relaxed);
+    HAL_WorkerNotify(target.worker);
+    return HAL_OK;
+}
+
+void workQueueGetStats(WorkLane lane, WorkQueueStats *stats)
+{
+    if(stats == NULL || lane >= WORK_LANE_COUNT)
+    {
+        return;
+    }
+
+    const Lane &source = lanes[lane];
+    uint32_t state = HAL_CriticalEnter();
+    stats->submitted = source.submitted.load(std::memory_order_relaxed);
+    stats->executed = source.executed;
+    stats->overflows = source.overflows.load(std::memory_order_relaxed);
+    stats->depth = (uint32_t)source.ring.size();
+    stats->maxDepth = source.maxDepth;
+    uint32_t lastLatency = source.lastLatencyCycles;
+    uint32_t maxLatency = source.maxLatencyCycles;
+    uint64_t totalLatency = source.totalLatencyCycles;
+    HAL_CriticalExit(state);
+
+    stats->lastLatencyUs = cyclesToUs(lastLatency);
+    stats->maxLatencyUs = cyclesToUs(maxLatency);
+    stats->avgLatencyUs = stats->executed == 0 ? 0 : cyclesToUs(totalLatency / stats->executed);
+}
+
+} // extern "C"
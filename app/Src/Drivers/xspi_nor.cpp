@@ -0,0 +1,451 @@
+/**
+  ******************************************************************************
+  * @file           : xspi_nor.cpp
+  * @brief          : External serial NOR flash on OCTOSPI / QUADSPI
+  ******************************************************************************
+  */
+
+#include "xspi_nor.h"
+
+#include <string.h>
+
+namespace {
+
+// JEDEC command set
+constexpr uint8_t CMD_READ_ID          = 0x9F;
+constexpr uint8_t CMD_WRITE_ENABLE     = 0x06;
+constexpr uint8_t CMD_READ_STATUS      = 0x05;
+constexpr uint8_t CMD_FAST_READ        = 0x0B;
+constexpr uint8_t CMD_FAST_READ_QUAD   = 0x6B;
+constexpr uint8_t CMD_PAGE_PROGRAM     = 0x02;
+constexpr uint8_t CMD_PAGE_PROGRAM_QUAD = 0x32;
+constexpr uint8_t CMD_SECTOR_ERASE     = 0x20;
+
+// 4-byte address variants for devices above 16 MB
+constexpr uint8_t CMD_FAST_READ_4B        = 0x0C;
+constexpr uint8_t CMD_FAST_READ_QUAD_4B   = 0x6C;
+constexpr uint8_t CMD_PAGE_PROGRAM_4B     = 0x12;
+constexpr uint8_t CMD_PAGE_PROGRAM_QUAD_4B = 0x34;
+constexpr uint8_t CMD_SECTOR_ERASE_4B     = 0x21;
+
+constexpr uint8_t STATUS_BUSY = 0x01;
+constexpr uint8_t FAST_READ_DUMMY_CYCLES = 8;
+
+constexpr uint32_t PROGRAM_TIMEOUT_MS = 10;
+constexpr uint32_t ERASE_TIMEOUT_MS = 500;
+
+struct XspiNor
+{
+    XspiNorConfig config;
+    uint8_t addressBytes;
+    uint8_t mappedActive;
+    uint32_t jedecId;
+    const uint8_t *mappedBase;
+    NorFlash device;
+    XspiNorStats stats;
+};
+
+XspiNor nor;
+
+XSPI_NorCommandTypeDef makeCommand(uint8_t instruction)
+{
+    XSPI_NorCommandTypeDef cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.Instruction = instruction;
+    return cmd;
+}
+
+XSPI_NorCommandTypeDef readCommand(uint32_t address, uint32_t length)
+{
+    bool wide = nor.addressBytes == 4;
+    XSPI_NorCommandTypeDef cmd;
+    if(nor.config.quad)
+    {
+        cmd = makeCommand(wide ? CMD_FAST_READ_QUAD_4B : CMD_FAST_READ_QUAD);
+        cmd.DataLines = 4;
+    }
+    else
+    {
+        cmd = makeCommand(wide ? CMD_FAST_READ_4B : CMD_FAST_READ);
+        cmd.DataLines = 1;
+    }
+    cmd.AddressBytes = nor.addressBytes;
+    cmd.DummyCycles = FAST_READ_DUMMY_CYCLES;
+    cmd.Address = address;
+    cmd.DataSize = length;
+    return cmd;
+}
+
+HAL_StatusTypeDef enterMapped(void)
+{
+    if(!nor.config.memoryMapped || nor.mappedActive)
+    {
+        return HAL_OK;
+    }
+
+    XSPI_NorCommandTypeDef cmd = readCommand(0, 0);
+    const uint8_t *base = NULL;
+    HAL_StatusTypeDef status = HAL_XSPI_NorMemoryMapped(&cmd, &base);
+    if(status != HAL_OK || base == NULL)
+    {
+        nor.stats.errors++;
+        return status != HAL_OK ? status : HAL_ERROR;
+    }
+
+    nor.mappedBase = base;
+    nor.mappedActive = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef leaveMapped(void)
+{
+    if(!nor.mappedActive)
+    {
+        return HAL_OK;
+    }
+
+    // Indirect commands are rejected by the controller while memory-mapped
+    HAL_StatusTypeDef status = HAL_XSPI_NorAbort();
+    if(status != HAL_OK)
+    {
+        nor.stats.errors++;
+        return status;
+    }
+
+    nor.mappedActive = 0;
+    nor.stats.mappedSwitches++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef restoreMapped(uint32_t address, uint32_t length, HAL_StatusTypeDef status)
+{
+    HAL_StatusTypeDef mapped = enterMapped();
+    if(nor.mappedActive)
+    {
+        // Lines fetched before the change would otherwise be served stale
+        HAL_XSPI_NorInvalidateCache(nor.mappedBase + address, length);
+    }
+    return status != HAL_OK ? status : mapped;
+}
+
+HAL_StatusTypeDef writeEnable(void)
+{
+    XSPI_NorCommandTypeDef cmd = makeCommand(CMD_WRITE_ENABLE);
+    return HAL_XSPI_NorCommand(&cmd);
+}
+
+HAL_StatusTypeDef programPage(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    HAL_StatusTypeDef status = writeEnable();
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    bool wide = nor.addressBytes == 4;
+    XSPI_NorCommandTypeDef cmd;
+    if(nor.config.quad)
+    {
+        cmd = makeCommand(wide ? CMD_PAGE_PROGRAM_QUAD_4B : CMD_PAGE_PROGRAM_QUAD);
+        cmd.DataLines = 4;
+    }
+    else
+    {
+        cmd = makeCommand(wide ? CMD_PAGE_PROGRAM_4B : CMD_PAGE_PROGRAM);
+        cmd.DataLines = 1;
+    }
+    cmd.AddressBytes = nor.addressBytes;
+    cmd.Address = address;
+    cmd.DataSize = length;
+
+    status = HAL_XSPI_NorWrite(&cmd, data);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    return HAL_XSPI_NorWaitReady(CMD_READ_STATUS, STATUS_BUSY, PROGRAM_TIMEOUT_MS);
+}
+
+bool inRange(uint32_t address, uint32_t length)
+{
+    return address <= nor.config.size && length <= nor.config.size - address;
+}
+
+bool deviceRead(void *ctx, uint32_t address, uint8_t *data, uint32_t length)
+{
+    (void)ctx;
+    return xspiNorRead(address, data, length) == HAL_OK;
+}
+
+bool deviceProgram(void *ctx, uint32_t address, const uint8_t *data, uint32_t length)
+{
+    (void)ctx;
+    return xspiNorProgram(address, data, length) == HAL_OK;
+}
+
+bool deviceEraseSector(void *ctx, uint32_t address)
+{
+    (void)ctx;
+    return xspiNorEraseSector(address) == HAL_OK;
+}
+
+uint32_t toKBps(uint32_t bytes, uint32_t cycles)
+{
+    if(cycles == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)bytes * HAL_RCC_GetHCLKFreq()) / ((uint64_t)cycles * 1024U));
+}
+
+uint32_t toUs(uint32_t cycles)
+{
+    uint32_t mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+    return mhz == 0 ? 0 : cycles / mhz;
+}
+
+} // namespace
+
+extern "C" {
+
+HAL_StatusTypeDef xspiNorInit(const XspiNorConfig *config)
+{
+    if(config == NULL || config->size == 0 || config->sectorSize == 0 || config->pageSize == 0 ||
+       config->size % config->sectorSize != 0 || config->sectorSize % config->pageSize != 0)
+    {
+        return HAL_ERROR;
+    }
+
+    memset(&nor, 0, sizeof(nor));
+    nor.config = *config;
+    nor.addressBytes = config->size > (1UL << 24) ? 4 : 3;
+    HAL_EnableCycleCounter();
+
+    uint8_t id[3] = {0};
+    XSPI_NorCommandTypeDef cmd = makeCommand(CMD_READ_ID);
+    cmd.DataLines = 1;
+    cmd.DataSize = sizeof(id);
+    HAL_StatusTypeDef status = HAL_XSPI_NorRead(&cmd, id);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    nor.jedecId = ((uint32_t)id[0] << 16) | ((uint32_t)id[1] << 8) | id[2];
+    if(nor.jedecId == 0 || nor.jedecId == 0xFFFFFFU)
+    {
+        return HAL_ERROR;
+    }
+
+    status = enterMapped();
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    nor.device.size = config->size;
+    nor.device.sectorSize = config->sectorSize;
+    nor.device.pageSize = config->pageSize;
+    nor.device.mapped = nor.mappedActive ? nor.mappedBase : NULL;
+    nor.device.read = deviceRead;
+    nor.device.program = deviceProgram;
+    nor.device.eraseSector = deviceEraseSector;
+    nor.device.ctx = &nor;
+    return HAL_OK;
+}
+
+uint32_t xspiNorJedecId(void)
+{
+    return nor.jedecId;
+}
+
+HAL_StatusTypeDef xspiNorRead(uint32_t address, uint8_t *data, uint32_t length)
+{
+    if(!inRange(address, length))
+    {
+        return HAL_ERROR;
+    }
+    if(length == 0)
+    {
+        return HAL_OK;
+    }
+
+    uint32_t start = HAL_GetCycleCount();
+    HAL_StatusTypeDef status = HAL_OK;
+    if(nor.mappedActive)
+    {
+        memcpy(data, nor.mappedBase + address, length);
+    }
+    else
+    {
+        XSPI_NorCommandTypeDef cmd = readCommand(address, length);
+        status = HAL_XSPI_NorRead(&cmd, data);
+    }
+    nor.stats.readCycles += HAL_GetCycleCount() - start;
+
+    if(status != HAL_OK)
+    {
+        nor.stats.errors++;
+        return status;
+    }
+    nor.stats.bytesRead += length;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef xspiNorProgram(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    if(!inRange(address, length))
+    {
+        return HAL_ERROR;
+    }
+    if(length == 0)
+    {
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef status = leaveMapped();
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    uint32_t start = HAL_GetCycleCount();
+    uint32_t done = 0;
+    while(done < length && status == HAL_OK)
+    {
+        // A page program wraps within the page, never cross a boundary
+        uint32_t offset = address + done;
+        uint32_t chunk = nor.config.pageSize - (offset % nor.config.pageSize);
+        if(chunk > length - done)
+        {
+            chunk = length - done;
+        }
+
+        status = programPage(offset, data + done, chunk);
+        if(status == HAL_OK)
+        {
+            done += chunk;
+        }
+    }
+    nor.stats.programCycles += HAL_GetCycleCount() - start;
+    nor.stats.bytesProgrammed += done;
+    if(status != HAL_OK)
+    {
+        nor.stats.errors++;
+    }
+
+    return restoreMapped(address, length, status);
+}
+
+HAL_StatusTypeDef xspiNorEraseSector(uint32_t address)
+{
+    if(address >= nor.config.size)
+    {
+        return HAL_ERROR;
+    }
+    address -= address % nor.config.sectorSize;
+
+    HAL_StatusTypeDef status = leaveMapped();
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+
+    uint32_t start = HAL_GetCycleCount();
+    status = writeEnable();
+    if(status == HAL_OK)
+    {
+        XSPI_NorCommandTypeDef cmd = makeCommand(nor.addressBytes == 4 ? CMD_SECTOR_ERASE_4B : CMD_SECTOR_ERASE);
+        cmd.AddressBytes = nor.addressBytes;
+        cmd.Address = address;
+        status = HAL_XSPI_NorCommand(&cmd);
+    }
+    if(status == HAL_OK)
+    {
+        status = HAL_XSPI_NorWaitReady(CMD_READ_STATUS, STATUS_BUSY, ERASE_TIMEOUT_MS);
+    }
+
+    uint32_t elapsed = HAL_GetCycleCount() - start;
+    nor.stats.eraseCycles += elapsed;
+    if(elapsed > nor.stats.maxEraseCycles)
+    {
+        nor.stats.maxEraseCycles = elapsed;
+    }
+    if(status == HAL_OK)
+    {
+        nor.stats.sectorsErased++;
+    }
+    else
+    {
+        nor.stats.errors++;
+    }
+
+    return restoreMapped(address, nor.config.sectorSize, status);
+}
+
+const NorFlash *xspiNorDevice(void)
+{
+    return nor.device.read != NULL ? &nor.device : NULL;
+}
+
+void xspiNorGetStats(XspiNorStats *stats)
+{
+    if(stats != NULL)
+    {
+        *stats = nor.stats;
+    }
+}
+
+HAL_StatusTypeDef xspiNorBenchmark(uint32_t address, uint8_t *buffer, XspiNorBenchmark *result)
+{
+    uint32_t length = nor.config.sectorSize;
+    if(buffer == NULL || result == NULL || address % length != 0 || !inRange(address, length))
+    {
+        return HAL_ERROR;
+    }
+    memset(result, 0, sizeof(*result));
+
+    uint32_t start = HAL_GetCycleCount();
+    HAL_StatusTypeDef status = xspiNorEraseSector(address);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    result->eraseUs = toUs(HAL_GetCycleCount() - start);
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        buffer[i] = (uint8_t)(i * 31U + 7U);
+    }
+    start = HAL_GetCycleCount();
+    status = xspiNorProgram(address, buffer, length);
+    if(status != HAL_OK)
+    {
+        return status;
+    }
+    result->programKBps = toKBps(length, HAL_GetCycleCount() - start);
+
+    if(nor.mappedActive)
+    {
+        HAL_XSPI_NorInvalidateCache(nor.mappedBase + address, length);
+        start = HAL_GetCycleCount();
+        status = xspiNorRead(address, buffer, length);
+        result->mappedReadKBps = toKBps(length, HAL_GetCycleCount() - start);
+        if(status != HAL_OK)
+        {
+            return status;
+        }
+    }
+
+    // Indirect read with the window released, as used before memory-mapped mode is set up
+    status = leaveMapped();
+    if(status == HAL_OK)
+    {
+        start = HAL_GetCycleCount();
+        status = xspiNorRead(address, buffer, length);
+        result->indirectReadKBps = toKBps(length, HAL_GetCycleCount() - start);
+    }
+    return restoreMapped(address, 0, status);
+}
+
+} // extern "C"
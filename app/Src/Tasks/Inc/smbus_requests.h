@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : smbus_requests.h
+  * @brief          : SMBus transfers requested by other tasks
+  ******************************************************************************
+  * Host commands are carried out by the SMBus task between its periodic
+  * transfers. A request is queued with the correlation id it was given at
+  * ingress and the task reports the outcome through the completion
+  * function, from its own context; the queue and bus stages are traced as
+  * spans under that id. While the bus is backing off after faults queued
+  * requests complete at once with HAL_BUSY.
+  ******************************************************************************
+  */
+
+#ifndef SMBUS_REQUESTS_H
+#define SMBUS_REQUESTS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hal_types.h"
+
+#define SMBUS_REQUEST_MAX_DATA  32U
+#define SMBUS_REQUEST_DEPTH     4U      // Requests queued, power of two
+
+typedef struct
+{
+    uint32_t traceId;               // Correlation id, 0 when untraced
+    uint16_t address;
+    uint16_t length;
+    uint8_t data[SMBUS_REQUEST_MAX_DATA];
+} SmbusRequest;
+
+/**
+ * @brief Outcome of a request, called from the SMBus task
+ */
+typedef void (*SmbusRequestDoneFn)(uint32_t traceId, HAL_StatusTypeDef status);
+
+/**
+ * @brief Queue a write for the SMBus task
+ * @param request Copied into the queue
+ * @param done Completion, called once unless the request is refused
+ * @retval HAL_BUSY when the queue is full, HAL_ERROR for a bad request
+ */
+HAL_StatusTypeDef smbusRequestSubmit(const SmbusRequest *request, SmbusRequestDoneFn done);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMBUS_REQUESTS_H */
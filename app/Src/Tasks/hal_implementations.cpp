@@ -6,7 +6,7 @@
  */
 
 #include "hal_types.h"
-#include "SEGGER_RTT.h"
+#include "logging.h"
 #define __weak __attribute__((used))  __attribute__((weak))
 
 extern "C" {
@@ -20,7 +20,7 @@ extern "C" {
  */
  __weak void HAL_Delay_MS(uint32_t ms)
 {
-    SEGGER_RTT_printf(0, "WARNING: HAL_Delay_MS(%u) not implemented by platform - no delay applied\n\r", (unsigned int)ms);
+    logWrite(LOG_WARN, "HAL_Delay_MS(%u) not implemented by platform - no delay applied\n\r", (unsigned int)ms);
     // No delay in hollow implementation
 }
 
@@ -34,7 +34,27 @@ __weak HAL_StatusTypeDef HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbu
     (void)pData;
     (void)Size;
     (void)XferOptions;
-    SEGGER_RTT_printf(0, "WARNING: HAL_SMBUS_Master_Transmit_IT not implemented by platform\n\r");
+    logWrite(LOG_WARN, "HAL_SMBUS_Master_Transmit_IT not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of SMBus DeInit
+ */
+__weak HAL_StatusTypeDef HAL_SMBUS_DeInit(SMBUS_HandleTypeDef *hsmbus)
+{
+    (void)hsmbus;
+    logWrite(LOG_WARN, "HAL_SMBUS_DeInit not implemented by platform\n\r");
+    return HAL_OK;
+}
+
+/**
+ * @brief Weak implementation of SMBus Init
+ */
+__weak HAL_StatusTypeDef HAL_SMBUS_Init(SMBUS_HandleTypeDef *hsmbus)
+{
+    (void)hsmbus;
+    logWrite(LOG_WARN, "HAL_SMBUS_Init not implemented by platform\n\r");
     return HAL_OK;
 }
 
@@ -46,7 +66,7 @@ __weak HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t
     (void)huart;
     (void)pData;
     (void)Size;
-    SEGGER_RTT_printf(0, "WARNING: HAL_UART_Transmit_IT not implemented by platform\n\r");
+    logWrite(LOG_WARN, "HAL_UART_Transmit_IT not implemented by platform\n\r");
     return HAL_OK;
 }
 
@@ -58,7 +78,7 @@ __weak HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t
     (void)huart;
     (void)pData;
     (void)Size;
-    SEGGER_RTT_printf(0, "WARNING: HAL_UART_Receive_IT not implemented by platform\n\r");
+    logWrite(LOG_WARN, "HAL_UART_Receive_IT not implemented by platform\n\r");
     return HAL_OK;
 }
 
@@ -68,7 +88,7 @@ __weak HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t
 __weak HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
 {
     (void)huart;
-    SEGGER_RTT_printf(0, "WARNING: HAL_UART_GetState not implemented by platform\n\r");
+    logWrite(LOG_WARN, "HAL_UART_GetState not implemented by platform\n\r");
     return HAL_UART_STATE_READY;
 }
 
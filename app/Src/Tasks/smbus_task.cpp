@@ -6,10 +6,320 @@
   */
 
 #include "hal_types.h"
-#include "SEGGER_RTT.h"
+#include "power_manager.h"
+#include "hal_callbacks.h"
+#include "overload_control.h"
+#include "smbus_requests.h"
+#include "trace_recorder.h"
+#include "hsm.h"
+#include "mpsc_ring.h"
+#include "trace_codec.h"
+#include "logging.h"
+#include "tunables.h"
+
+namespace {
+
+constexpr uint8_t DEVICE_ADDRESS = 0x48;    // Example device address
+TUNABLE_UINT(sendPeriodMs, "smbus.period_ms", 2000, 100, 60000);
+TUNABLE_UINT(tickMs, "smbus.tick_ms", 100, 10, 1000);
+TUNABLE_UINT(maxFailures, "smbus.max_failures", 3, 1, 100);       // Consecutive failures before backing off
+TUNABLE_UINT(backoffMs, "smbus.backoff_ms", 10000, 100, 600000);
+TUNABLE_UINT(timeoutMs, "smbus.timeout_ms", 35, 25, 1000);        // SMBus tTIMEOUT, checked once per tick
+
+struct HostTransfer
+{
+    SmbusRequest request;
+    SmbusRequestDoneFn done;
+};
+
+MpscRing<HostTransfer, SMBUS_REQUEST_DEPTH> hostRequests;
+
+struct SmbusLink
+{
+    uint8_t data[12];
+    uint16_t size;
+    uint32_t nextSendMs;
+    uint32_t failures;
+    uint32_t backoffUntilMs;
+
+    // Outcome of the transfer on the bus, set by the HAL callbacks or a failed start
+    volatile HAL_StatusTypeDef status;
+    volatile bool ended;
+    bool clocked;                       // I2C2 clock held for the transfer on the bus
+    uint32_t startedMs;                 // When the transfer was started, for the timeout
+
+    // Service levels set by the overload controller
+    volatile bool quiet;                // Progress messages suppressed
+    volatile uint8_t periodShift;       // Send period doubled this many times
+
+    // Host request on the bus instead of the periodic transfer
+    bool hostActive;
+    bool hostStaged;                    // Popped by the guard, not yet started or refused
+    HostTransfer host;
+};
+
+/**
+ * @brief Record the outcome of a transfer, from the HAL callbacks or a start that failed
+ * @note  The bus span ends here so it covers the transaction, not just the call that queued it
+ */
+void transferEnded(SmbusLink &link, HAL_StatusTypeDef status)
+{
+    if(link.hostActive)
+    {
+        traceSpanEnd(link.host.request.traceId, TRACE_SPAN_SMBUS, status);
+    }
+    link.status = status;
+    link.ended = true;
+}
+
+void onTransmitComplete(void *ctx)
+{
+    transferEnded(*static_cast<SmbusLink *>(ctx), HAL_OK);
+}
+
+void onError(void *ctx)
+{
+    transferEnded(*static_cast<SmbusLink *>(ctx), HAL_ERROR);
+}
+
+const HalSmbusCallbacks smbusCallbacks = {onTransmitComplete, onError};
+
+/**
+ * @brief Clock the bus and start a transfer, the clock is released once it has ended
+ */
+void startOnBus(SmbusLink &link, uint16_t address, uint8_t *data, uint16_t size, uint32_t now)
+{
+    link.ended = false;
+    link.startedMs = now;
+    HAL_StatusTypeDef status = powerManagerAcquireClock(POWER_CLOCK_I2C2);
+    if(status == HAL_OK)
+    {
+        link.clocked = true;
+        status = HAL_SMBUS_Master_Transmit_IT(&hsmbus2, address, data, size, SMBUS_FIRST_AND_LAST_FRAME_NO_PEC);
+    }
+    if(status != HAL_OK)
+    {
+        // No callback follows a transfer that never started
+        transferEnded(link, status);
+    }
+}
+
+/**
+ * @brief Give up on a transfer the bus never finished, a slave holding SCL low or a lost interrupt
+ * @note  Resetting the peripheral stops its interrupts, so a callback that got in first is kept
+ */
+void abortOnBus(SmbusLink &link)
+{
+    logWrite(LOG_WARN, "SMBus: transfer timed out after %u ms, resetting the bus\n\r", (unsigned int)timeoutMs);
+    (void)HAL_SMBUS_DeInit(&hsmbus2);
+    (void)HAL_SMBUS_Init(&hsmbus2);
+    if(!link.ended)
+    {
+        transferEnded(link, HAL_TIMEOUT);
+    }
+}
+
+/**
+ * @brief Gate the bus clock between transfers, from the task once the transfer has ended
+ */
+void releaseBus(SmbusLink &link)
+{
+    if(link.clocked)
+    {
+        link.clocked = false;
+        (void)powerManagerReleaseClock(POWER_CLOCK_I2C2);
+    }
+}
+
+void finishHost(SmbusLink &link, HAL_StatusTypeDef status)
+{
+    link.hostActive = false;
+    link.host.done(link.host.request.traceId, status);
+}
+
+/**
+ * @brief Periodic transfer with retry and bus-fault back-off
+ *
+ * ACTIVE
+ *   IDLE     --tick [host request] / start it-->   SENDING
+ *   IDLE     --tick [due] / start transfer-->      SENDING
+ *   SENDING  --done-->                             IDLE
+ *   SENDING  --error [retries left] / retry-->     IDLE
+ *   SENDING  --error-->                            BACKOFF
+ *   SENDING  --timeout / reset the bus-->          as error
+ * BACKOFF    --tick [elapsed]-->                   ACTIVE
+ * BACKOFF    --tick [host request] / refuse it
+ */
+struct SmbusMachine
+{
+    using Context = SmbusLink;
+    using Payload = uint32_t;       // Current time in ms
+
+    enum State : uint8_t { ACTIVE, IDLE, SENDING, BACKOFF };
+    enum Event : uint8_t { TICK, DONE, ERROR, EVENT_COUNT };
+    static constexpr uint8_t INITIAL = ACTIVE;
+
+    static void enterActive(SmbusLink &link)
+    {
+        link.failures = 0;
+    }
+
+    static void enterBackoff(SmbusLink &link)
+    {
+        logWrite(LOG_WARN, "SMBus: %u failures in a row, backing off\n\r", (unsigned int)link.failures + 1U);
+    }
+
+    static bool hostPending(SmbusLink &link, const uint32_t &now)
+    {
+        (void)now;
+        // size() counts cells a producer has claimed but not yet published, only a pop is certain
+        if(!link.hostStaged)
+        {
+            link.hostStaged = hostRequests.pop(link.host);
+        }
+        return link.hostStaged;
+    }
+
+    static bool due(SmbusLink &link, const uint32_t &now)
+    {
+        return (int32_t)(now - link.nextSendMs) >= 0;
+    }
+
+    static bool retriesLeft(SmbusLink &link, const uint32_t &now)
+    {
+        (void)now;
+        return link.failures + 1U < maxFailures;
+    }
+
+    static bool backoffElapsed(SmbusLink &link, const uint32_t &now)
+    {
+        return (int32_t)(now - link.backoffUntilMs) >= 0;
+    }
+
+    static void startTransfer(SmbusLink &link, const uint32_t &now)
+    {
+        link.nextSendMs = now + (sendPeriodMs << link.periodShift);
+        if(!link.quiet)
+        {
+            logWrite(LOG_DEBUG, "Sending 'hello world' via SMBus...\n\r");
+        }
+        startOnBus(link, DEVICE_ADDRESS, link.data, link.size, now);
+    }
+
+    static void startHostTransfer(SmbusLink &link, const uint32_t &now)
+    {
+        link.hostStaged = false;
+        const SmbusRequest &request = link.host.request;
+        traceSpanEnd(request.traceId, TRACE_SPAN_QUEUE, HAL_OK);
+        traceSpanStart(request.traceId, TRACE_SPAN_SMBUS);
+        link.hostActive = true;
+        startOnBus(link, request.address, link.host.request.data, request.length, now);
+    }
+
+    static void refuseHostTransfer(SmbusLink &link, const uint32_t &now)
+    {
+        (void)now;
+        link.hostStaged = false;
+        traceSpanEnd(link.host.request.traceId, TRACE_SPAN_QUEUE, HAL_BUSY);
+        link.host.done(link.host.request.traceId, HAL_BUSY);
+    }
+
+    static void completed(SmbusLink &link, const uint32_t &now)
+    {
+        (void)now;
+        link.failures = 0;
+        if(link.hostActive)
+        {
+            finishHost(link, HAL_OK);
+        }
+        if(!link.quiet)
+        {
+            logWrite(LOG_DEBUG, "SMBus transmit completed successfully\n\r");
+        }
+    }
+
+    static void failed(SmbusLink &link, const uint32_t &now)
+    {
+        if(link.hostActive)
+        {
+            finishHost(link, link.status);
+        }
+        link.failures++;
+        link.backoffUntilMs = now + backoffMs;
+        logWrite(LOG_ERROR, "SMBus transmit failed with status: %d\n\r", (int)link.status);
+    }
+
+    static void retry(SmbusLink &link, const uint32_t &now)
+    {
+        failed(link, now);
+        link.nextSendMs = now;
+    }
+
+    static constexpr HsmState<SmbusLink> states[] = {
+        { ACTIVE,  HSM_NONE, IDLE,     enterActive,  nullptr },
+        { IDLE,    ACTIVE,   HSM_NONE, nullptr,      nullptr },
+        { SENDING, ACTIVE,   HSM_NONE, nullptr,      nullptr },
+        { BACKOFF, HSM_NONE, HSM_NONE, enterBackoff, nullptr },
+    };
+
+    static constexpr HsmTransition<SmbusLink, uint32_t> transitions[] = {
+        { IDLE,    TICK,  SENDING,  hostPending,    startHostTransfer },
+        { IDLE,    TICK,  SENDING,  due,            startTransfer },
+        { SENDING, DONE,  IDLE,     nullptr,        completed },
+        { SENDING, ERROR, IDLE,     retriesLeft,    retry },
+        { SENDING, ERROR, BACKOFF,  nullptr,        failed },
+        { BACKOFF, TICK,  ACTIVE,   backoffElapsed, nullptr },
+        { BACKOFF, TICK,  HSM_NONE, hostPending,    refuseHostTransfer },
+    };
+};
+
+const char *const smbusStateNames[] = {"ACTIVE", "IDLE", "SENDING", "BACKOFF"};
+
+void traceTransition(void *ctx, uint8_t from, uint8_t to, uint8_t event)
+{
+    (void)ctx;
+    (void)event;
+
+    // Regular transfers are reported by the actions, only show entering and leaving back-off
+    if(from != HSM_NONE && from != to && (from == SmbusMachine::BACKOFF || to == SmbusMachine::BACKOFF))
+    {
+        logWrite(LOG_WARN, "SMBus: %s -> %s\n\r", smbusStateNames[from], smbusStateNames[to]);
+    }
+}
+
+void shedSmbusLogging(uint8_t level, void *ctx)
+{
+    static_cast<SmbusLink *>(ctx)->quiet = level > 0;
+}
+
+void shedSmbusPolling(uint8_t level, void *ctx)
+{
+    static_cast<SmbusLink *>(ctx)->periodShift = level;
+}
+
+} // namespace
 
 extern "C" {
 
+HAL_StatusTypeDef smbusRequestSubmit(const SmbusRequest *request, SmbusRequestDoneFn done)
+{
+    if(request == NULL || done == NULL || request->length == 0 || request->length > SMBUS_REQUEST_MAX_DATA)
+    {
+        return HAL_ERROR;
+    }
+
+    HostTransfer transfer;
+    transfer.request = *request;
+    transfer.done = done;
+    traceSpanStart(request->traceId, TRACE_SPAN_QUEUE);
+    if(!hostRequests.push(transfer))
+    {
+        traceSpanEnd(request->traceId, TRACE_SPAN_QUEUE, HAL_BUSY);
+        return HAL_BUSY;
+    }
+    return HAL_OK;
+}
+
 /**
  * @brief SMBus task for I2C/SMBus communication
  * @param pvParameters Task parameters
@@ -18,35 +328,44 @@ void smbusTask(void *pvParameters)
 {
     (void)pvParameters;
     
-    SEGGER_RTT_printf(0, "SMBus task started!\n\r");
+    logWrite(LOG_INFO, "SMBus task started!\n\r");
     
     // Wait a bit for system to stabilize
     HAL_Delay_MS(100);
     
+    static SmbusLink link = {"hello world", 11, 0, 0, 0, HAL_OK, false, false, 0, false, 0, false, false, {}};
+    if(halSmbusRegisterCallbacks(&hsmbus2, &smbusCallbacks, &link) != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to register SMBus callbacks\n\r");
+    }
+    overloadRegister("smbus log", OVERLOAD_ORDER_LOGGING, 1, shedSmbusLogging, &link);
+    overloadRegister("smbus poll", OVERLOAD_ORDER_POLLING, 2, shedSmbusPolling, &link);
+    static Hsm<SmbusMachine> machine;
+    machine.setTrace(traceTransition, nullptr);
+    link.nextSendMs = HAL_GetTick();
+    machine.start(link);
+    
     for(;;)
     {
-        /* SMBus operations - Send "hello world" */
-        
-        uint8_t device_addr = 0x48; // Example device address
-        uint8_t data[] = "hello world";
-        uint16_t data_size = sizeof(data) - 1; // Exclude null terminator
-        
-        SEGGER_RTT_printf(0, "Sending 'hello world' via SMBus...\n\r");
-        
-        // Send "hello world" using HAL function - platform will implement
-        HAL_StatusTypeDef status = HAL_SMBUS_Master_Transmit_IT(&hsmbus2, device_addr, data, data_size, 0x00020000U);
-        
-        if(status == HAL_OK)
+        uint32_t now = HAL_GetTick();
+        machine.dispatch(SmbusMachine::TICK, now);
+
+        // A transfer still on the bus past its deadline is ended here and handled as an error
+        if(machine.state() == SmbusMachine::SENDING && !link.ended && (now - link.startedMs) >= timeoutMs)
         {
-            SEGGER_RTT_printf(0, "SMBus transmit completed successfully\n\r");
+            abortOnBus(link);
         }
-        else
+
+        // The transfer was started on the way into SENDING, feed back its outcome once the bus reported it
+        if(machine.state() == SmbusMachine::SENDING && link.ended)
         {
-            SEGGER_RTT_printf(0, "SMBus transmit failed with status: %d\n\r", status);
+            releaseBus(link);
+            machine.dispatch(link.status == HAL_OK ? SmbusMachine::DONE : SmbusMachine::ERROR, now);
         }
-        
-        // Wait before next iteration
-        HAL_Delay_MS(2000);
+
+        overloadControlPoll();
+        logFlush();
+        HAL_Delay_MS(tickMs);
     }
 }
 
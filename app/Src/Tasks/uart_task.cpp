@@ -6,7 +6,370 @@
   */
 
 #include "hal_types.h"
-#include "SEGGER_RTT.h"
+#include "power_manager.h"
+#include "overload_control.h"
+#include "lpuart_wake.h"
+#include "rs485.h"
+#include "uart_link.h"
+#include "clock_sync.h"
+#include "cpu_budget.h"
+#include "work_queue.h"
+#include "lock_profiler.h"
+#include "smbus_requests.h"
+#include "trace_recorder.h"
+#include "tunable_shell.h"
+#include "mpsc_ring.h"
+#include "trace_codec.h"
+#include "cbor.h"
+#include "logging.h"
+#include "tunables.h"
+#include "link_mux.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+TUNABLE_UINT(periodMs, "uart.period_ms", 3000, 100, 60000);
+TUNABLE_UINT(linkPollMs, "uart.link_poll_ms", 10, 1, 100);   // Baud negotiation and clock sync timers
+TUNABLE_UINT(linkParkMs, "uart.link_park_ms", 0, 0, 3600000); // Quiet time before the link gives up its clocks, 0 never
+
+// SMBus writes from the host shell: "smbus <address> <byte>...", in hex; reply "smbus <id> <status>"
+const char SMBUS_COMMAND[] = "smbus";
+const char SMBUS_USAGE[] = "usage: smbus <address> <byte>... (hex)\n";
+
+struct Completion
+{
+    uint32_t traceId;
+    HAL_StatusTypeDef status;
+};
+
+// Filled by the SMBus task and by refusals here, drained here. Room for a full request
+// queue plus as many refusals keeps it from overflowing between two drains.
+MpscRing<Completion, SMBUS_REQUEST_DEPTH * 2U> completions;
+Completion heldReply;               // Reply the link had no room for
+bool replyHeld;
+
+// Service levels set by the overload controller
+volatile bool quiet;                // Progress messages suppressed
+volatile uint8_t periodShift;       // Period doubled this many times
+volatile bool telemetryPaused;      // Statistics reports suppressed
+
+void shedUartLogging(uint8_t level, void *ctx)
+{
+    (void)ctx;
+    quiet = level > 0;
+}
+
+void shedUartPolling(uint8_t level, void *ctx)
+{
+    (void)ctx;
+    periodShift = level;
+}
+
+void shedUartTelemetry(uint8_t level, void *ctx)
+{
+    (void)ctx;
+    telemetryPaused = level > 0;
+}
+
+/**
+ * @brief Gate USART2 and its DMA under a link that has been quiet for uart.link_park_ms
+ * @note  The port hears nothing until resumed, the host has to send an LPUART1 frame first
+ */
+void parkLink(void)
+{
+    if(uartLinkPark() == HAL_OK)
+    {
+        (void)powerManagerReleaseClock(POWER_CLOCK_DMA);
+        (void)powerManagerReleaseClock(POWER_CLOCK_USART2);
+        logWrite(LOG_INFO, "Link parked after %u ms quiet\n\r", (unsigned int)linkParkMs);
+    }
+}
+
+void resumeLink(void)
+{
+    if(powerManagerAcquireClock(POWER_CLOCK_USART2) != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to acquire peripheral clock\n\r");
+    }
+    else if(powerManagerAcquireClock(POWER_CLOCK_DMA) != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to acquire DMA clock\n\r");
+        (void)powerManagerReleaseClock(POWER_CLOCK_USART2);
+    }
+    else
+    {
+        (void)uartLinkResume();
+        logWrite(LOG_INFO, "Link resumed\n\r");
+    }
+}
+
+/**
+ * @brief RS-485 frames the interrupt responder left, delivered on the normal work lane
+ */
+void printRs485Frame(const uint8_t *payload, uint16_t length)
+{
+    char text[RS485_MAX_FRAME];
+    uint16_t n = length < sizeof(text) - 1U ? length : (uint16_t)(sizeof(text) - 1U);
+    memcpy(text, payload, n);
+    text[n] = '\0';
+    logWrite(LOG_INFO, "RS-485 frame (%u bytes): %s\n\r", (unsigned int)length, text);
+}
+
+/**
+ * @brief End of a host command, from the SMBus task
+ */
+void smbusRequestDone(uint32_t traceId, HAL_StatusTypeDef status)
+{
+    traceSpanStart(traceId, TRACE_SPAN_REPLY);
+    completions.push(Completion{ traceId, status });
+}
+
+/**
+ * @brief Queue the reply on the shell channel and close the request
+ * @retval false if the channel had no room, try again later
+ */
+bool sendReply(const Completion &done)
+{
+    char reply[32];
+    int length = snprintf(reply, sizeof(reply), "%s %08lx %d\n", SMBUS_COMMAND, (unsigned long)done.traceId,
+                          (int)done.status);
+    HAL_StatusTypeDef sent = linkMuxWrite(LINK_MUX_SHELL, (const uint8_t *)reply, (size_t)length);
+    if(sent == HAL_BUSY)
+    {
+        return false;
+    }
+
+    traceSpanEnd(done.traceId, TRACE_SPAN_REPLY, sent);
+    traceSpanEnd(done.traceId, TRACE_SPAN_REQUEST, done.status);
+    return true;
+}
+
+void drainReplies(void)
+{
+    if(replyHeld && !sendReply(heldReply))
+    {
+        return;
+    }
+    replyHeld = false;
+
+    Completion done;
+    while(completions.pop(done))
+    {
+        if(!sendReply(done))
+        {
+            heldReply = done;
+            replyHeld = true;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Hand an SMBus write typed on the shell to the SMBus task
+ * @param args Text after the command, address and data bytes in hex
+ * @retval false on a malformed line
+ */
+bool submitSmbusWrite(const char *args)
+{
+    SmbusRequest request;
+    request.length = 0;
+
+    char *end;
+    unsigned long address = strtoul(args, &end, 16);
+    if(end == args || address > 0x7FU)
+    {
+        return false;
+    }
+    request.address = (uint8_t)address;
+
+    for(const char *next = end; ; next = end)
+    {
+        unsigned long value = strtoul(next, &end, 16);
+        if(end == next)
+        {
+            break;
+        }
+        if(value > 0xFFU || request.length == SMBUS_REQUEST_MAX_DATA)
+        {
+            return false;
+        }
+        request.data[request.length++] = (uint8_t)value;
+    }
+    if(request.length == 0 || *end != '\0')
+    {
+        return false;
+    }
+
+    // Correlation id from here to the reply, across both tasks
+    request.traceId = traceNewCorrelationId();
+    traceSpanStart(request.traceId, TRACE_SPAN_REQUEST);
+
+    HAL_StatusTypeDef status = smbusRequestSubmit(&request, smbusRequestDone);
+    if(status != HAL_OK)
+    {
+        smbusRequestDone(request.traceId, status);
+    }
+    return true;
+}
+
+/**
+ * @brief Run one line typed on the shell channel, SMBus writes or tunables commands
+ */
+void runShellLine(const char *line)
+{
+    static char reply[256];
+    size_t commandLength = sizeof(SMBUS_COMMAND) - 1U;
+    if(strncmp(line, SMBUS_COMMAND, commandLength) == 0 && (line[commandLength] == ' ' || line[commandLength] == '\0'))
+    {
+        if(submitSmbusWrite(&line[commandLength]))
+        {
+            return;
+        }
+        snprintf(reply, sizeof(reply), "%s", SMBUS_USAGE);
+    }
+    else
+    {
+        // Lists that do not fit end with the command that continues them
+        tunableShellExecute(line, reply, sizeof(reply));
+    }
+
+    if(linkMuxWrite(LINK_MUX_SHELL, (const uint8_t *)reply, strlen(reply)) != HAL_OK)
+    {
+        logWrite(LOG_WARN, "Link: shell reply dropped\n\r");
+    }
+}
+
+/**
+ * @brief Collect the lines typed on the shell channel and run them
+ */
+void pollShell(void)
+{
+    static char line[TUNABLE_SHELL_LINE_MAX];
+    static size_t lineLength;
+    static bool lineTooLong;        // Rest of an overlong line is dropped
+
+    uint8_t input[16];
+    size_t count;
+    while((count = linkMuxRead(LINK_MUX_SHELL, input, sizeof(input))) > 0)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            char c = (char)input[i];
+            if(c == '\r' || c == '\n')
+            {
+                if(lineTooLong)
+                {
+                    static const char TOO_LONG[] = "error: line too long\n";
+                    (void)linkMuxWrite(LINK_MUX_SHELL, (const uint8_t *)TOO_LONG, sizeof(TOO_LONG) - 1U);
+                }
+                else if(lineLength > 0)
+                {
+                    line[lineLength] = '\0';
+                    runShellLine(line);
+                }
+                lineLength = 0;
+                lineTooLong = false;
+            }
+            else if(lineLength + 1U < sizeof(line))
+            {
+                line[lineLength++] = c;
+            }
+            else
+            {
+                lineTooLong = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Queue one telemetry section, {name: {key: value, ...}}, on the telemetry channel
+ * @retval false if it did not fit
+ */
+bool sendTelemetrySection(const char *name, const char *const *keys, const uint32_t *values, size_t count)
+{
+    uint8_t record[UART_LINK_MAX_PAYLOAD];
+    CborWriter cbor(record, sizeof(record));
+    cbor.beginMap(1);
+    cbor.writeText(name);
+    cbor.beginMap(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        cbor.writeText(keys[i]);
+        cbor.writeUnsigned(values[i]);
+    }
+    return cbor.ok() && linkMuxWrite(LINK_MUX_TELEMETRY, record, cbor.size()) == HAL_OK;
+}
+
+/**
+ * @brief The statistics the periodic reports log as text, self-describing for the host
+ */
+void sendTelemetry(void)
+{
+    static const char *const LINK_KEYS[] = { "baud", "bps", "err", "fb" };
+    static const char *const RS485_KEYS[] = { "last", "max", "late" };
+    static const char *const WORK_KEYS[] = { "run", "depth", "avg", "max", "ovf" };
+    static const char *const LOAD_KEYS[] = { "pm", "shed", "levels", "miss" };
+
+    UartLinkStats link;
+    uartLinkGetStats(&link);
+    const uint32_t linkValues[] = { link.baudRate, link.throughputBps, link.lineErrors, link.fallbacks };
+    bool sent = sendTelemetrySection("link", LINK_KEYS, linkValues, 4);
+
+    if(rs485IsActive())
+    {
+        Rs485Stats rs485;
+        rs485GetStats(&rs485);
+        const uint32_t rs485Values[] = {
+            rs485CyclesToUs(rs485.lastTurnaroundCycles), rs485CyclesToUs(rs485.maxTurnaroundCycles),
+            rs485.turnaroundViolations
+        };
+        sent = sendTelemetrySection("rs485", RS485_KEYS, rs485Values, 3) && sent;
+    }
+
+    WorkQueueStats work;
+    workQueueGetStats(WORK_LANE_NORMAL, &work);
+    const uint32_t workValues[] = { work.executed, work.maxDepth, work.avgLatencyUs, work.maxLatencyUs, work.overflows };
+    sent = sendTelemetrySection("work", WORK_KEYS, workValues, 5) && sent;
+
+    OverloadStats overload;
+    overloadGetStats(&overload);
+    const uint32_t loadValues[] = { overload.loadPermille, overload.level, overload.levelCount, overload.deadlineMisses };
+    sent = sendTelemetrySection("load", LOAD_KEYS, loadValues, 4) && sent;
+
+    if(!sent)
+    {
+        logWrite(LOG_WARN, "Link: telemetry dropped\n\r");
+    }
+}
+
+/**
+ * @brief Log the tasks that went over their CPU budget since the last report
+ */
+void reportBudgetViolations(void)
+{
+    static uint32_t reported[CPU_BUDGET_MAX_TASKS];
+    CpuBudgetTaskStats budgets[CPU_BUDGET_MAX_TASKS];
+    uint32_t count = cpuBudgetGetStats(budgets, CPU_BUDGET_MAX_TASKS);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(budgets[i].violations != reported[i])
+        {
+            logWrite(LOG_WARN, "CPU budget: %s over %u permille %u times, peak %u, %s\n\r",
+                     budgets[i].name,
+                     (unsigned int)budgets[i].budgetPermille,
+                     (unsigned int)(budgets[i].violations - reported[i]),
+                     (unsigned int)budgets[i].peakPermille,
+                     budgets[i].throttled ? "throttled" : "released");
+            reported[i] = budgets[i].violations;
+        }
+    }
+}
+
+} // namespace
 
 extern "C" {
 
@@ -18,10 +381,40 @@ void uartTask(void *pvParameters)
 {
     (void)pvParameters;
     
-    SEGGER_RTT_printf(0, "UART task started!\n\r");
+    logWrite(LOG_INFO, "UART task started!\n\r");
     
     // Wait a bit for system to stabilize
     HAL_Delay_MS(100);
+
+    // Field bus frames are handled as they arrive instead of on this task's period
+    rs485SetFrameHandler(printRs485Frame);
+
+    // The host negotiates the rate; without the link the port falls back to raw transfers.
+    // The link listens, so it keeps USART2 and its DMA clocked until it is parked.
+    if(powerManagerAcquireClock(POWER_CLOCK_USART2) != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to acquire peripheral clock\n\r");
+    }
+    else if(powerManagerAcquireClock(POWER_CLOCK_DMA) != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to acquire DMA clock\n\r");
+        (void)powerManagerReleaseClock(POWER_CLOCK_USART2);
+    }
+    else if(uartLinkInit(&huart2, UART_LINK_SLAVE, linkMuxReceive) != HAL_OK)
+    {
+        // Raw transfers clock the port for each round instead
+        logWrite(LOG_ERROR, "Failed to start the host link\n\r");
+        (void)powerManagerReleaseClock(POWER_CLOCK_DMA);
+        (void)powerManagerReleaseClock(POWER_CLOCK_USART2);
+    }
+    else if(linkMuxInit() != HAL_OK)
+    {
+        logWrite(LOG_ERROR, "Failed to start the link channels\n\r");
+    }
+
+    overloadRegister("uart log", OVERLOAD_ORDER_LOGGING, 1, shedUartLogging, NULL);
+    overloadRegister("uart poll", OVERLOAD_ORDER_POLLING, 2, shedUartPolling, NULL);
+    overloadRegister("uart stats", OVERLOAD_ORDER_TELEMETRY, 1, shedUartTelemetry, NULL);
     
     uint8_t tx_buffer[] = "Hello from UART task!\r\n";
     uint8_t rx_buffer[64];
@@ -29,54 +422,215 @@ void uartTask(void *pvParameters)
     
     for(;;)
     {
-        /* UART operations - Send hello message */
+        overloadControlPoll();
+        tunableShellPoll();
+        logFlush();
+
+        // Raw transfers only while the framed link does not own the port, clocked for the round
+        if(!uartLinkIsActive() && powerManagerAcquireClock(POWER_CLOCK_USART2) == HAL_OK)
+        {
+            /* UART operations - Send hello message */
         
-        SEGGER_RTT_printf(0, "Sending UART message...\n\r");
+            if(!quiet)
+            {
+                logWrite(LOG_DEBUG, "Sending UART message...\n\r");
+            }
         
-        // Send message via UART using HAL function - platform will implement
-        status = HAL_UART_Transmit_IT(&huart2, tx_buffer, sizeof(tx_buffer) - 1);
+            // Send message via UART using HAL function - platform will implement
+            status = HAL_UART_Transmit_IT(&huart2, tx_buffer, sizeof(tx_buffer) - 1);
         
-        if(status == HAL_OK)
-        {
-            SEGGER_RTT_printf(0, "UART transmit initiated successfully\n\r");
+            if(status == HAL_OK)
+            {
+                if(!quiet)
+                {
+                    logWrite(LOG_DEBUG, "UART transmit initiated successfully\n\r");
+                }
             
-            // Wait for transmission to complete
-            HAL_Delay_MS(50);
+                // Wait for transmission to complete
+                HAL_Delay_MS(50);
             
-            // Check transmission state using HAL function
-            if(HAL_UART_GetState(&huart2) == HAL_UART_STATE_READY)
-            {
-                SEGGER_RTT_printf(0, "UART transmission completed\n\r");
+                // Check transmission state using HAL function
+                if(!quiet)
+                {
+                    if(HAL_UART_GetState(&huart2) == HAL_UART_STATE_READY)
+                    {
+                        logWrite(LOG_DEBUG, "UART transmission completed\n\r");
+                    }
+                    else
+                    {
+                        logWrite(LOG_DEBUG, "UART transmission still in progress\n\r");
+                    }
+                }
             }
             else
             {
-                SEGGER_RTT_printf(0, "UART transmission still in progress\n\r");
+                logWrite(LOG_ERROR, "UART transmit failed with status: %d\n\r", status);
+            }
+        
+            // Try to receive data (non-blocking check) using HAL function
+            status = HAL_UART_Receive_IT(&huart2, rx_buffer, sizeof(rx_buffer) - 1);
+            if(status == HAL_OK)
+            {
+                if(!quiet)
+                {
+                    logWrite(LOG_DEBUG, "UART receive started\n\r");
+                }
+            
+                // Wait a bit to see if data arrives
+                HAL_Delay_MS(100);
+            
+                if(HAL_UART_GetState(&huart2) == HAL_UART_STATE_READY)
+                {
+                    // Null terminate and print received data
+                    rx_buffer[sizeof(rx_buffer) - 1] = '\0';
+                    logWrite(LOG_INFO, "UART received: %s\n\r", rx_buffer);
+                }
+                else
+                {
+                    // Nothing arrived, stop listening before the clock goes
+                    (void)HAL_UART_AbortReceive(&huart2);
+                }
             }
+
+            (void)powerManagerReleaseClock(POWER_CLOCK_USART2);
         }
-        else
+
+        // Drain command frames that arrived on the low-power UART, possibly while in Stop mode
+        bool lpuartFrames = false;
+        if(lpuartWakeIsActive())
         {
-            SEGGER_RTT_printf(0, "UART transmit failed with status: %d\n\r", status);
+            uint16_t frameLength;
+            while((frameLength = lpuartWakeReadFrame(rx_buffer, sizeof(rx_buffer) - 1)) > 0)
+            {
+                rx_buffer[frameLength] = '\0';
+                logWrite(LOG_INFO, "LPUART frame (%u bytes): %s\n\r", (unsigned int)frameLength, rx_buffer);
+                lpuartFrames = true;
+            }
+
+            if(!telemetryPaused)
+            {
+                LpuartWakeStats stats;
+                lpuartWakeGetStats(&stats);
+                logWrite(LOG_INFO, "LPUART wakes: %u, last latency: %u us, bytes lost at wake: %u\n\r",
+                         (unsigned int)stats.wakeCount,
+                         (unsigned int)lpuartWakeCyclesToUs(stats.lastWakeLatencyCycles),
+                         (unsigned int)stats.bytesLostAtWake);
+            }
         }
-        
-        // Try to receive data (non-blocking check) using HAL function
-        status = HAL_UART_Receive_IT(&huart2, rx_buffer, sizeof(rx_buffer) - 1);
-        if(status == HAL_OK)
+
+        // RS-485 frames arrive through the work queue, only the timing is reported here
+        if(rs485IsActive() && !telemetryPaused)
         {
-            SEGGER_RTT_printf(0, "UART receive started\n\r");
-            
-            // Wait a bit to see if data arrives
-            HAL_Delay_MS(100);
-            
-            if(HAL_UART_GetState(&huart2) == HAL_UART_STATE_READY)
+            Rs485Stats stats;
+            rs485GetStats(&stats);
+            logWrite(LOG_INFO, "RS-485 turnaround last: %u us, max: %u us, late: %u\n\r",
+                     (unsigned int)rs485CyclesToUs(stats.lastTurnaroundCycles),
+                     (unsigned int)rs485CyclesToUs(stats.maxTurnaroundCycles),
+                     (unsigned int)stats.turnaroundViolations);
+        }
+
+        if(!telemetryPaused)
+        {
+            WorkQueueStats work;
+            workQueueGetStats(WORK_LANE_NORMAL, &work);
+            logWrite(LOG_INFO, "Work lane: %u run, depth max %u, latency avg %u us max %u us, overflows %u\n\r",
+                     (unsigned int)work.executed,
+                     (unsigned int)work.maxDepth,
+                     (unsigned int)work.avgLatencyUs,
+                     (unsigned int)work.maxLatencyUs,
+                     (unsigned int)work.overflows);
+
+            // Only the worst kernel object, lockProfilerDump lists them all
+            LockHotspot hotspot;
+            if(lockProfilerGetHotspots(&hotspot, 1) == 1 && hotspot.contentions != 0)
             {
-                // Null terminate and print received data
-                rx_buffer[sizeof(rx_buffer) - 1] = '\0';
-                SEGGER_RTT_printf(0, "UART received: %s\n\r", rx_buffer);
+                logWrite(LOG_INFO, "Worst lock %s: contended %u, wait max %u us by %s behind %s\n\r",
+                         hotspot.name,
+                         (unsigned int)hotspot.contentions,
+                         (unsigned int)hotspot.maxWaitUs,
+                         hotspot.worstWaiter,
+                         hotspot.worstOwner);
             }
         }
-        
+
+        // Shedding is reported even while telemetry is paused, it explains the silence
+        OverloadStats overload;
+        overloadGetStats(&overload);
+        if(overload.level > 0 || !telemetryPaused)
+        {
+            logWrite(LOG_INFO, "Load %u permille, shed %u/%u, misses %u\n\r",
+                     (unsigned int)overload.loadPermille,
+                     (unsigned int)overload.level,
+                     (unsigned int)overload.levelCount,
+                     (unsigned int)overload.deadlineMisses);
+        }
+
+        // Like shedding, budget violations are reported even while telemetry is paused
+        reportBudgetViolations();
+
+        // A parked link wakes for a frame on LPUART1 or for something it had to refuse
+        if(uartLinkIsParked() && (lpuartFrames || uartLinkWakeRequested()))
+        {
+            resumeLink();
+        }
+
+        // Framed link to the host, negotiating its rate on the way
+        if(uartLinkIsActive() && !uartLinkIsParked())
+        {
+            // Repairs credit frames the line lost
+            linkMuxRefreshCredits();
+
+            if(!telemetryPaused)
+            {
+                if(linkMuxIsActive())
+                {
+                    sendTelemetry();
+                }
+
+                UartLinkStats stats;
+                uartLinkGetStats(&stats);
+                logWrite(LOG_INFO, "Link %u baud, %u B/s, errors: %u, fallbacks: %u\n\r",
+                         (unsigned int)stats.baudRate,
+                         (unsigned int)stats.throughputBps,
+                         (unsigned int)stats.lineErrors,
+                         (unsigned int)stats.fallbacks);
+
+                ClockSyncStats sync;
+                clockSyncGetStats(&sync);
+                logWrite(LOG_INFO, "Clock sync %s, delay %u us, correction %d us, drift %d ppb, jitter %u us, timeouts %u\n\r",
+                         sync.synced ? "locked" : "pending",
+                         (unsigned int)sync.delayUs,
+                         (int)sync.lastCorrectionUs,
+                         (int)sync.driftPpb,
+                         (unsigned int)sync.jitterUs,
+                         (unsigned int)sync.timeouts);
+            }
+
+            // The negotiation timers need a fast poll, keep the same overall period
+            uint32_t pollMs = linkPollMs;
+            uint32_t polls = (periodMs << periodShift) / pollMs;
+            for(uint32_t i = 0; i < polls; i++)
+            {
+                uartLinkPoll();
+                pollShell();
+                drainReplies();
+                linkMuxPoll();
+                clockSyncPoll();
+                tunableShellPoll();
+                logFlush();
+
+                if(linkParkMs > 0 && uartLinkIdleTime() >= linkParkMs)
+                {
+                    parkLink();
+                    break;
+                }
+                HAL_Delay_MS(pollMs);
+            }
+            continue;
+        }
+
         // Wait before next iteration
-        HAL_Delay_MS(3000);
+        HAL_Delay_MS(periodMs << periodShift);
     }
 }
 
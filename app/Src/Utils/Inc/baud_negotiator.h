@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file           : baud_negotiator.h
+  * @brief          : UART link-speed negotiation with error-driven fallback
+  ******************************************************************************
+  * Both ends start at the safe rate (last entry of the rate table). The
+  * master proposes the fastest rate not yet ruled out; the slave accepts it
+  * if its clock can generate it, both switch, and the master sends a burst
+  * of test frames. The slave reports how many arrived intact and the rate is
+  * confirmed only if all did, otherwise both return to the safe rate and the
+  * next lower rate is tried.
+  *
+  * Once running, the master pings periodically. Either end falls back to the
+  * safe rate when the error count in a window exceeds the limit or the peer
+  * goes silent; the master then renegotiates, skipping the rate that failed
+  * for a hold-off period. Once the hold-off expires the master probes the
+  * faster rates again from the rate it is running at.
+  *
+  * Negotiation messages are frame payloads starting with BAUD_NEG_TAG; the
+  * owner frames them (frame_codec), routes received ones to handleFrame()
+  * and keeps application traffic off the link until linkReady().
+  ******************************************************************************
+  */
+
+#ifndef BAUD_NEGOTIATOR_H
+#define BAUD_NEGOTIATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BAUD_NEG_TAG            0xFEU
+#define BAUD_NEG_MAX_RATES      12U
+#define BAUD_NEG_TEST_LENGTH    48U
+#define BAUD_NEG_MAX_FRAME      (BAUD_NEG_TEST_LENGTH + 4U)
+
+struct BaudNegotiatorConfig
+{
+    bool master;
+    const uint32_t *rates;      // Highest first, the last one is the safe start-up rate
+    size_t rateCount;
+
+    bool (*rateSupported)(uint32_t baud, void *ctx);    // Clock can generate it within tolerance
+    bool (*setBaud)(uint32_t baud, void *ctx);
+    bool (*sendFrame)(const uint8_t *payload, size_t length, void *ctx);
+    void *ctx;
+
+    uint32_t testFrames = 8;
+    uint32_t settleMs = 20;             // Both ends quiet around a rate switch
+    uint32_t replyTimeoutMs = 100;
+    uint32_t proposeRetries = 3;
+    uint32_t keepaliveMs = 500;
+    uint32_t silenceMs = 2000;          // No valid frame for this long triggers a fallback
+    uint32_t errorWindowMs = 1000;
+    uint32_t maxErrorsPerWindow = 4;
+    uint32_t retryHoldoffMs = 30000;    // A rate that failed is skipped this long
+};
+
+struct BaudNegotiatorStats
+{
+    uint32_t baud;
+    uint32_t negotiations;          // Completed negotiations
+    uint32_t trialsFailed;          // Rates that did not pass the test burst
+    uint32_t fallbacks;             // Returns to the safe rate while running
+    uint32_t lineErrors;
+    uint32_t throughputBps;         // Application bytes delivered over the last second
+};
+
+class BaudNegotiator
+{
+public:
+    enum State
+    {
+        IDLE,
+        PROPOSING,          // Master: waiting for accept / reject
+        SWITCHING,          // Rate switch pending, waiting for the line to settle
+        TESTING,            // Master: test burst sent, waiting for the result
+        TRIAL,              // Slave: collecting test frames, then waiting for confirm
+        RUNNING
+    };
+
+    bool init(const BaudNegotiatorConfig &config, uint32_t nowMs);
+
+    /**
+     * @brief Check whether a received frame belongs to the negotiation
+     */
+    static bool isControlFrame(const uint8_t *payload, size_t length)
+    {
+        return length >= 2U && payload[0] == BAUD_NEG_TAG;
+    }
+
+    void handleFrame(const uint8_t *payload, size_t length, uint32_t nowMs);
+
+    /**
+     * @brief Report a valid application frame, keeps the silence detector quiet
+     */
+    void noteGoodFrame(uint32_t nowMs) { lastGoodMs = nowMs; }
+
+    /**
+     * @brief Report CRC, framing or noise errors seen on the line
+     */
+    void reportErrors(uint32_t count, uint32_t nowMs);
+
+    /**
+     * @brief Account application payload bytes for the throughput metric
+     */
+    void noteDelivered(uint32_t bytes) { deliveredBytes += bytes; }
+
+    void tick(uint32_t nowMs);
+
+    /**
+     * @brief Restart negotiation from the safe rate
+     */
+    void restart(uint32_t nowMs);
+
+    bool linkReady() const { return state == RUNNING; }
+    State currentState() const { return state; }
+    uint32_t baud() const { return counters.baud; }
+    const BaudNegotiatorStats &stats() const { return counters; }
+
+private:
+    void send(uint8_t type, const uint8_t *data, size_t length);
+    void sendRate(uint8_t type, uint32_t rate);
+    void switchTo(uint32_t rate, uint32_t nowMs);
+    void proposeNext(uint32_t nowMs);
+    void trialFailed(uint32_t nowMs);
+    void fallback(uint32_t nowMs);
+    void enterRunning(uint32_t nowMs);
+    int rateIndex(uint32_t rate) const;
+    uint32_t safeRate() const { return cfg.rates[cfg.rateCount - 1U]; }
+
+    BaudNegotiatorConfig cfg;
+    State state = IDLE;
+
+    int candidate = -1;             // Rate table index under negotiation
+    uint32_t pendingRate = 0;       // Slave: rate to apply once the switch delay expires
+    uint32_t deadlineMs = 0;
+    uint32_t retries = 0;
+    uint32_t testsReceived = 0;
+    uint32_t failedUntilMs[BAUD_NEG_MAX_RATES] = {};
+
+    uint32_t lastGoodMs = 0;
+    uint32_t lastPingMs = 0;
+    uint32_t windowStartMs = 0;
+    uint32_t windowErrors = 0;
+    uint32_t deliveredBytes = 0;
+    uint32_t throughputStartMs = 0;
+
+    BaudNegotiatorStats counters = {};
+};
+
+#endif /* BAUD_NEGOTIATOR_H */
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file           : bit_stream.h
+  * @brief          : MSB-first bit writer and reader over caller buffers
+  ******************************************************************************
+  */
+
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class BitWriter
+{
+public:
+    BitWriter() : buffer(nullptr), capacityBits(0), position(0) {}
+
+    /**
+     * @brief Attach to a buffer, writing resumes at the given bit position
+     */
+    void attach(uint8_t *data, size_t sizeBytes, size_t bitPosition = 0);
+
+    /**
+     * @brief Append the low bitCount bits of value, most significant first
+     * @retval false if the buffer is full, nothing is written in that case
+     */
+    bool write(uint64_t value, uint32_t bitCount);
+
+    bool writeBit(bool bit) { return write(bit ? 1U : 0U, 1); }
+
+    size_t bitPosition() const { return position; }
+    size_t remainingBits() const { return capacityBits - position; }
+
+private:
+    uint8_t *buffer;
+    size_t capacityBits;
+    size_t position;
+};
+
+class BitReader
+{
+public:
+    BitReader() : buffer(nullptr), lengthBits(0), position(0) {}
+
+    void attach(const uint8_t *data, size_t bitLength);
+
+    /**
+     * @brief Read bitCount bits (up to 64), most significant first
+     * @retval false if the stream is exhausted
+     */
+    bool read(uint32_t bitCount, uint64_t &value);
+
+    bool readBit(bool &bit);
+
+    size_t bitPosition() const { return position; }
+    size_t remainingBits() const { return lengthBits - position; }
+
+private:
+    const uint8_t *buffer;
+    size_t lengthBits;
+    size_t position;
+};
+
+#endif /* BIT_STREAM_H */
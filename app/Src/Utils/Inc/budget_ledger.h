@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file           : budget_ledger.h
+  * @brief          : Per-task execution budgets over a replenishment period
+  ******************************************************************************
+  * Each account follows a free-running, wrapping run-time counter of its
+  * owner (cycles the task has run) and charges the growth to the current
+  * period. An account that goes over its budget is marked throttled once,
+  * and the caller applies the penalty. At the end of a period the budget is
+  * replenished; time used beyond the budget is carried over as debt, up to
+  * one budget, so a task that overshot before it was caught pays it back.
+  * The account is released at the first replenishment that leaves it some
+  * budget to run on; one whose debt is a whole budget sits out a period.
+  *
+  * A budget of 0 only accounts, it never throttles.
+  ******************************************************************************
+  */
+
+#ifndef BUDGET_LEDGER_H
+#define BUDGET_LEDGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUDGET_LEDGER_MAX_ACCOUNTS  8U
+
+enum BudgetEvent : uint8_t
+{
+    BUDGET_NONE = 0,
+    BUDGET_EXCEEDED,        // Went over budget, throttle the owner
+    BUDGET_RESTORED,        // Replenished and back within budget, release it
+};
+
+struct BudgetAccount
+{
+    const void *owner;
+    const char *name;
+    uint32_t budget;            // Counter units per period, 0 for no limit
+    uint32_t used;              // Charged this period, debt included
+    uint32_t ran;               // Run this period
+    uint32_t lastCounter;
+    uint32_t lastPeriod;        // Run in the last completed period
+    uint32_t peak;              // Most used in one completed period
+    uint32_t violations;
+    uint32_t throttledPeriods;  // Periods that ended with the account throttled
+    bool throttled;
+};
+
+class BudgetLedger
+{
+public:
+    /**
+     * @brief Open an account, charging from the counter value given
+     * @retval false if the table is full, the owner is NULL or already has one
+     */
+    bool add(const void *owner, const char *name, uint32_t budget, uint32_t counter);
+
+    /**
+     * @brief Index of the owner's account, count() if it has none
+     */
+    size_t find(const void *owner) const;
+
+    /**
+     * @brief Charge the counter growth since the last call
+     * @retval BUDGET_EXCEEDED the first time the budget is overrun in a period
+     */
+    BudgetEvent charge(size_t index, uint32_t counter);
+
+    /**
+     * @brief Close the period: charge, carry over the overrun and start a new budget
+     * @retval BUDGET_RESTORED if a throttled account is back within budget
+     */
+    BudgetEvent replenish(size_t index, uint32_t counter);
+
+    void setBudget(size_t index, uint32_t budget);
+
+    size_t count() const { return accountCount; }
+    const BudgetAccount &account(size_t index) const { return accounts[index]; }
+
+private:
+    BudgetAccount accounts[BUDGET_LEDGER_MAX_ACCOUNTS] = {};
+    size_t accountCount = 0;
+};
+
+#endif /* BUDGET_LEDGER_H */
@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : byte_ring.h
+  * @brief          : Byte FIFO over caller-provided storage
+  ******************************************************************************
+  * Single producer / single consumer, not interrupt safe on its own.
+  ******************************************************************************
+  */
+
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class ByteRing
+{
+public:
+    void attach(uint8_t *storage, size_t size);
+
+    /**
+     * @brief Append as many bytes as fit
+     * @retval Number of bytes stored
+     */
+    size_t write(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Remove up to length bytes
+     * @retval Number of bytes copied
+     */
+    size_t read(uint8_t *dst, size_t length);
+
+    /**
+     * @brief Copy up to length bytes without removing them
+     */
+    size_t peek(uint8_t *dst, size_t length) const;
+
+    /**
+     * @brief Drop up to length bytes from the front
+     */
+    void discard(size_t length);
+
+    void clear() { head = tail = count = 0; }
+    size_t used() const { return count; }
+    size_t free() const { return size - count; }
+    size_t capacity() const { return size; }
+
+private:
+    uint8_t *buffer = nullptr;
+    size_t size = 0;
+    size_t head = 0;        // Next write position
+    size_t tail = 0;        // Next read position
+    size_t count = 0;
+};
+
+#endif /* BYTE_RING_H */
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file           : cbor.h
+  * @brief          : Streaming CBOR (RFC 8949) writer and pull reader
+  ******************************************************************************
+  * Self-describing telemetry without a schema on either end. Neither side
+  * allocates or builds a tree.
+  *
+  * CborWriter encodes item by item into a caller buffer or straight into a
+  * ByteRing. Integers and lengths take the shortest head, and floats the
+  * shortest of half, single and double that holds the value exactly, which
+  * is the RFC's preferred serialization. Every item is written whole or not
+  * at all: the first one that does not fit fails the writer, and so does
+  * everything after it, so one ok() check at the end of a record covers it.
+  * In a ring the items before the failed one stay queued, so a caller that
+  * cannot drop a partial record checks free() against the record's worst
+  * case first.
+  *
+  * Arrays and maps take their count up front (the fast path, one head
+  * byte for up to 23 entries) or are indefinite and closed with end().
+  *
+  * CborReader walks a buffer an item at a time. A container gives its
+  * count and its entries follow as further items, and strings point into
+  * the buffer. skip() steps over a whole item with everything nested in
+  * it, so a consumer reads the keys it knows and skips the rest.
+  ******************************************************************************
+  */
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_ring.h"
+
+#define CBOR_MAX_HEAD       9U      // Initial byte and an 8-byte argument
+#define CBOR_MAX_DEPTH      16U     // Nesting skip() follows
+
+enum CborType : uint8_t
+{
+    CBOR_UNSIGNED = 0,
+    CBOR_NEGATIVE,              // value n stands for -1 - n
+    CBOR_BYTES,
+    CBOR_TEXT,
+    CBOR_ARRAY,
+    CBOR_MAP,
+    CBOR_TAG,                   // value is the tag, the tagged item follows
+    CBOR_SIMPLE,                // Unassigned simple value
+    CBOR_FALSE,
+    CBOR_TRUE,
+    CBOR_NULL,
+    CBOR_UNDEFINED,
+    CBOR_FLOAT,
+    CBOR_BREAK,                 // End of an indefinite container or string
+};
+
+struct CborItem
+{
+    CborType type;
+    bool indefinite;            // Count and length unknown, a BREAK ends the entries or chunks
+    uint64_t value;             // Integer, string length, entry count (pairs for maps), tag or simple value
+    double number;              // FLOAT
+    const uint8_t *data;        // Definite BYTES and TEXT, into the buffer
+};
+
+class CborWriter
+{
+public:
+    CborWriter() = default;
+    CborWriter(uint8_t *out, size_t capacity) { attach(out, capacity); }
+    explicit CborWriter(ByteRing &ring) { attach(ring); }
+
+    /**
+     * @brief Write from the start of a buffer
+     */
+    void attach(uint8_t *out, size_t capacity);
+
+    /**
+     * @brief Append to a ring
+     */
+    void attach(ByteRing &ring);
+
+    bool writeUnsigned(uint64_t value) { return head(MAJOR_UNSIGNED, value); }
+    bool writeInt(int64_t value);
+    bool writeBytes(const uint8_t *data, size_t length);
+    bool writeText(const char *text, size_t length);
+    bool writeText(const char *text);
+
+    /**
+     * @brief Shortest of half and single that holds value exactly
+     */
+    bool writeFloat(float value);
+
+    /**
+     * @brief Shortest of half, single and double that holds value exactly
+     */
+    bool writeDouble(double value);
+
+    bool writeBool(bool value) { return head(MAJOR_SIMPLE, value ? 21U : 20U); }
+    bool writeNull() { return head(MAJOR_SIMPLE, 22U); }
+    bool writeTag(uint64_t tag) { return head(MAJOR_TAG, tag); }
+
+    /**
+     * @brief Open a container of count items (pairs for a map)
+     */
+    bool beginArray(size_t count) { return head(MAJOR_ARRAY, count); }
+    bool beginMap(size_t pairs) { return head(MAJOR_MAP, pairs); }
+
+    /**
+     * @brief Open a container whose entries end with end()
+     */
+    bool beginArray() { return put(MAJOR_ARRAY | INDEFINITE); }
+    bool beginMap() { return put(MAJOR_MAP | INDEFINITE); }
+    bool end() { return put(0xFFU); }
+
+    /**
+     * @retval false once an item did not fit
+     */
+    bool ok() const { return !failed; }
+
+    /**
+     * @brief Bytes written since attach
+     */
+    size_t size() const { return written; }
+
+private:
+    static constexpr uint8_t MAJOR_UNSIGNED = 0x00;
+    static constexpr uint8_t MAJOR_NEGATIVE = 0x20;
+    static constexpr uint8_t MAJOR_BYTES = 0x40;
+    static constexpr uint8_t MAJOR_TEXT = 0x60;
+    static constexpr uint8_t MAJOR_ARRAY = 0x80;
+    static constexpr uint8_t MAJOR_MAP = 0xA0;
+    static constexpr uint8_t MAJOR_TAG = 0xC0;
+    static constexpr uint8_t MAJOR_SIMPLE = 0xE0;
+    static constexpr uint8_t INDEFINITE = 31;
+
+    bool head(uint8_t major, uint64_t value, const uint8_t *payload = nullptr, size_t length = 0);
+    bool put(uint8_t byte) { return emit(&byte, 1, nullptr, 0); }
+    bool emit(const uint8_t *first, size_t firstLength, const uint8_t *second, size_t secondLength);
+
+    uint8_t *out = nullptr;
+    size_t capacity = 0;
+    ByteRing *ring = nullptr;
+    size_t written = 0;
+    bool failed = false;
+};
+
+class CborReader
+{
+public:
+    CborReader() = default;
+    CborReader(const uint8_t *data, size_t size) { attach(data, size); }
+
+    void attach(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Decode the next item's head, the entries of a container come next
+     * @retval false at the end of the buffer or on a malformed item
+     */
+    bool next(CborItem &item);
+
+    /**
+     * @brief Step over the next item and everything nested in it
+     * @retval false on a malformed or truncated item, or nesting past CBOR_MAX_DEPTH
+     */
+    bool skip();
+
+    /**
+     * @brief Read the next item as the given kind
+     * @retval false, leaving the position alone, if it is of another kind or out of range
+     */
+    bool readUnsigned(uint64_t &value);
+    bool readInt(int64_t &value);
+    bool readFloat(double &value);        // Integers too
+    bool readBool(bool &value);
+    bool readText(const char *&text, size_t &length);       // Definite length only, not terminated
+    bool readBytes(const uint8_t *&data, size_t &length);   // Definite length only
+
+    /**
+     * @brief Consume the next item if it is a text string equal to text
+     */
+    bool readKey(const char *text);
+
+    /**
+     * @brief Open the next container, count is in items (pairs for a map)
+     * @retval false if it is not one or is indefinite
+     */
+    bool enterArray(size_t &count);
+    bool enterMap(size_t &pairs);
+
+    bool atEnd() const { return pos >= size; }
+    bool malformed() const { return bad; }
+    size_t offset() const { return pos; }
+
+private:
+    bool readArgument(uint8_t info, uint64_t &value);
+
+    const uint8_t *buffer = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    bool bad = false;
+};
+
+#endif /* CBOR_H */
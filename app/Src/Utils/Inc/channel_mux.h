@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file           : channel_mux.h
+  * @brief          : Logical channels with priorities and credit flow control over one link
+  ******************************************************************************
+  * Every mux frame carries one channel number followed by data, framed with
+  * the COBS codec. Channel 0 is reserved for control frames.
+  *
+  * Flow control is credit based and counted in bytes: each receiver
+  * advertises, per channel, the cumulative byte count it is willing to
+  * accept (bytes consumed + free buffer space). Limits are cumulative modulo
+  * 2^16, so a lost credit frame is repaired by the next one. A sender never
+  * exceeds the advertised limit, so the receiver buffers can not overflow.
+  *
+  * The transmit scheduler sends pending credit updates first, then the
+  * highest-priority channel that has data and credit, round-robin among
+  * channels of equal priority. Frames are capped at maxPayload bytes so a
+  * bulk channel delays a higher-priority one by at most one frame time.
+  *
+  * Links that frame on their own (uart_link, also frame_codec) exchange
+  * the unencoded payloads with pollPayload() and receivePayload(); a link
+  * frame carrying a mux payload is the same frame on the wire.
+  *
+  * Both ends of the link run the same class; it is not thread safe.
+  ******************************************************************************
+  */
+
+#ifndef CHANNEL_MUX_H
+#define CHANNEL_MUX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_ring.h"
+#include "frame_codec.h"
+
+#define MUX_MAX_CHANNELS        8U
+#define MUX_CONTROL_CHANNEL     0U
+#define MUX_DEFAULT_PAYLOAD     64U
+#define MUX_MAX_PAYLOAD         (FRAME_MAX_PAYLOAD - 1U)
+
+/* Largest payload pollPayload() can produce for a given maxPayload, a channel byte and data or a control frame */
+#define MUX_CONTROL_SIZE        (2U + MUX_MAX_CHANNELS * 3U)
+#define MUX_PAYLOAD_SIZE(maxPayload) \
+    ((maxPayload) + 1U > MUX_CONTROL_SIZE ? (maxPayload) + 1U : MUX_CONTROL_SIZE)
+
+/* Largest encoded frame poll() can produce for a given maxPayload */
+#define MUX_FRAME_SIZE(maxPayload) FRAME_ENCODED_SIZE(MUX_PAYLOAD_SIZE(maxPayload))
+
+struct MuxChannelConfig
+{
+    uint8_t id;                 // 1-255, must match on both ends
+    uint8_t priority;           // 0 is the most urgent
+    uint8_t *txBuffer;
+    uint16_t txSize;
+    uint8_t *rxBuffer;
+    uint16_t rxSize;            // Receive window advertised to the peer
+};
+
+struct MuxChannelStats
+{
+    uint32_t txBytes;
+    uint32_t txFrames;
+    uint32_t rxBytes;
+    uint32_t creditStalls;      // Polls where the channel had data but no credit
+    uint32_t overruns;          // Bytes received beyond the advertised window, dropped
+};
+
+/**
+ * @brief Called from receive() when data arrives on a channel
+ */
+typedef void (*MuxRxFn)(uint8_t channel, void *ctx);
+
+class ChannelMux
+{
+public:
+    /**
+     * @brief Set up the channels, the buffers are used in place
+     * @param channels Channel table, copied
+     * @param count Number of channels, up to MUX_MAX_CHANNELS
+     * @param maxPayload Data bytes per frame, up to MUX_MAX_PAYLOAD
+     * @retval false on an invalid table
+     */
+    bool init(const MuxChannelConfig *channels, size_t count, uint16_t maxPayload = MUX_DEFAULT_PAYLOAD);
+
+    /**
+     * @brief Queue data for transmission on a channel
+     * @retval Number of bytes accepted, limited by free space in the transmit buffer
+     */
+    size_t write(uint8_t channel, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Take received data from a channel, returning credit to the peer
+     * @retval Number of bytes copied
+     */
+    size_t read(uint8_t channel, uint8_t *dst, size_t size);
+
+    size_t readable(uint8_t channel) const;
+    size_t writable(uint8_t channel) const;
+
+    /**
+     * @brief Build the next frame to put on the wire
+     * @param out Output buffer, at least MUX_FRAME_SIZE(maxPayload) bytes
+     * @retval Encoded frame length, 0 if nothing can be sent
+     */
+    size_t poll(uint8_t *out, size_t size);
+
+    /**
+     * @brief Build the next frame payload, for a link that does its own framing
+     * @param out Output buffer, at least MUX_PAYLOAD_SIZE(maxPayload) bytes
+     * @retval Payload length, 0 if nothing can be sent
+     */
+    size_t pollPayload(uint8_t *out, size_t size);
+
+    /**
+     * @brief Feed bytes received from the link
+     */
+    void receive(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Feed one frame payload a framing link has already decoded
+     */
+    void receivePayload(const uint8_t *payload, size_t length) { handleFrame(payload, length); }
+
+    /**
+     * @brief Announce a restart to the peer, which then resets its credit state
+     */
+    void sendReset();
+
+    /**
+     * @brief Re-advertise every receive window, recovers from lost credit frames
+     */
+    void refreshCredits();
+
+    void setRxCallback(MuxRxFn fn, void *ctx);
+
+    const MuxChannelStats *stats(uint8_t channel) const;
+    const FrameDecoderStats &linkStats() const { return decoder.stats(); }
+
+private:
+    struct Channel
+    {
+        uint8_t id;
+        uint8_t priority;
+        ByteRing tx;
+        ByteRing rx;
+        uint16_t txSent;            // Cumulative bytes sent, mod 2^16
+        uint16_t txLimit;           // Cumulative limit advertised by the peer
+        uint16_t rxReceived;        // Cumulative bytes accepted
+        uint16_t rxConsumed;        // Cumulative bytes read by the application
+        uint16_t rxAdvertised;      // Limit last sent to the peer
+        bool creditDirty;
+        MuxChannelStats stats;
+    };
+
+    Channel *find(uint8_t id);
+    const Channel *find(uint8_t id) const;
+    void handleFrame(const uint8_t *payload, size_t length);
+    void handleControl(const uint8_t *payload, size_t length);
+    void updateCredit(Channel &ch, bool force);
+    size_t pollControl(uint8_t *out);
+    Channel *pickChannel();
+
+    Channel channels[MUX_MAX_CHANNELS];
+    size_t channelCount = 0;
+    uint16_t maxPayload = MUX_DEFAULT_PAYLOAD;
+    uint8_t lastServed = 0;
+    bool resetPending = false;
+
+    FrameDecoder decoder;
+    MuxRxFn rxCallback = nullptr;
+    void *rxContext = nullptr;
+};
+
+#endif /* CHANNEL_MUX_H */
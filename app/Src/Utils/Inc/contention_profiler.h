@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file           : contention_profiler.h
+  * @brief          : Wait and hold times of mutexes, semaphores and queues
+  ******************************************************************************
+  * Accumulates, per registered kernel object, how often a task had to block
+  * on it, how long it waited, how often the wait timed out and the longest
+  * single wait together with the task that waited and the task that held
+  * the lock at the time. Mutexes also get their hold times (take to give)
+  * and queues their fill high-water mark.
+  *
+  * The kernel feeds it from its trace hooks: an operation that cannot
+  * complete at once reports blocked(), and the same task later reports
+  * completed() or failed() on that object. Times are cycle counter values
+  * and may wrap. Calls are not serialised here, the caller masks
+  * interrupts around them.
+  ******************************************************************************
+  */
+
+#ifndef CONTENTION_PROFILER_H
+#define CONTENTION_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONTENTION_PROFILER_MAX_OBJECTS     16U     // Matches configQUEUE_REGISTRY_SIZE
+#define CONTENTION_PROFILER_MAX_WAITERS     8U      // Tasks blocked at the same time
+
+// Same values as the kernel's queue types
+enum ContentionKind : uint8_t
+{
+    CONTENTION_QUEUE = 0,
+    CONTENTION_MUTEX,
+    CONTENTION_COUNTING,
+    CONTENTION_BINARY,
+    CONTENTION_RECURSIVE_MUTEX,
+};
+
+struct ContentionFigures
+{
+    const void *object;
+    const char *name;
+    uint8_t kind;
+    uint32_t length;            // Queue length, 1 for mutexes and binary semaphores
+
+    uint32_t operations;        // Completed sends and receives (gives and takes)
+    uint32_t contentions;       // Operations that had to block
+    uint32_t timeouts;          // Blocked operations that gave up
+    uint64_t waitCycles;        // Total time spent blocked
+    uint32_t maxWaitCycles;
+    const void *worstWaiter;    // Task of the longest wait
+    const void *worstOwner;     // Mutex holder when that wait started, NULL if unknown
+
+    uint32_t holds;             // Mutexes only
+    uint64_t holdCycles;
+    uint32_t maxHoldCycles;
+    const void *owner;          // Current holder, NULL if free
+
+    uint32_t highWater;         // Most items ever waiting, queues and counting semaphores
+};
+
+class ContentionProfiler
+{
+public:
+    /**
+     * @brief Start tracking an object, a second registration renames it
+     * @retval false if the table is full
+     */
+    bool add(const void *object, const char *name, uint8_t kind, uint32_t length);
+
+    void remove(const void *object);
+
+    /**
+     * @brief The task found the object full (send) or empty (receive) and blocks
+     * @note  Repeated calls for the same wait keep its start time
+     */
+    void blocked(const void *object, const void *task, bool sending, uint32_t now);
+
+    /**
+     * @brief A send or receive succeeded
+     * @param task NULL from interrupts
+     * @param waiting Items in the object once the operation is done
+     */
+    void completed(const void *object, const void *task, bool sending, uint32_t waiting, uint32_t now);
+
+    /**
+     * @brief A send or receive gave up; counted as a timeout only if it had blocked
+     */
+    void failed(const void *object, const void *task, bool sending, uint32_t now);
+
+    const ContentionFigures *find(const void *object) const;
+    size_t count() const { return objectCount; }
+
+    /**
+     * @brief The objects, worst first: longest total wait, then most contentions, then longest hold
+     * @retval Entries written, at most max
+     */
+    size_t rank(const ContentionFigures **out, size_t max) const;
+
+    /**
+     * @brief Clear the figures, keeping the objects, their holders and running waits
+     */
+    void reset();
+
+private:
+    struct Waiter
+    {
+        const void *task;
+        const void *object;
+        uint32_t since;
+        const void *ownerAtBlock;
+        bool sending;
+    };
+
+    struct Entry
+    {
+        ContentionFigures figures;
+        uint32_t heldSince;
+    };
+
+    Entry *lookup(const void *object);
+    Waiter *waiterOf(const void *task, const void *object);
+    void endWait(Entry &entry, const void *task, bool sending, uint32_t now, bool timedOut);
+
+    Entry entries[CONTENTION_PROFILER_MAX_OBJECTS] = {};
+    Waiter waiters[CONTENTION_PROFILER_MAX_WAITERS] = {};
+    size_t objectCount = 0;
+};
+
+#endif /* CONTENTION_PROFILER_H */
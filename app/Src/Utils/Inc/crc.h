@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file           : crc.h
+  * @brief          : Table-free CRC routines shared by storage and protocols
+  ******************************************************************************
+  */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ * @param crc Running value, start with CRC16_INIT
+ */
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t length);
+
+/**
+ * @brief CRC-32/ISO-HDLC (reflected poly 0xEDB88320), as used by zlib
+ * @param crc Running value, start with CRC32_INIT and finish with crc32Final
+ */
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length);
+
+#define CRC16_INIT  0xFFFFU
+#define CRC32_INIT  0xFFFFFFFFUL
+
+static inline uint32_t crc32Final(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+static inline uint16_t crc16(const uint8_t *data, size_t length)
+{
+    return crc16Update(CRC16_INIT, data, length);
+}
+
+static inline uint32_t crc32(const uint8_t *data, size_t length)
+{
+    return crc32Final(crc32Update(CRC32_INIT, data, length));
+}
+
+#endif /* CRC_H */
@@ -0,0 +1,184 @@
+/**
+  ******************************************************************************
+  * @file           : deadline_heap.h
+  * @brief          : Binary min-heap of timer deadlines on a wrapping clock
+  ******************************************************************************
+  * Holds up to N entries, each a deadline and a caller-chosen id below N.
+  * Deadlines are compared by their signed difference, so the clock may
+  * wrap as long as all pending deadlines lie within 2^31 ticks of each
+  * other (35 minutes at 1 MHz). Each id has a slot recording where it sits
+  * in the heap, so an entry can be removed or rescheduled in O(log N)
+  * without searching. Nothing is allocated and nothing is locked; callers
+  * shared with an interrupt wrap the calls in a critical section.
+  ******************************************************************************
+  */
+
+#ifndef DEADLINE_HEAP_H
+#define DEADLINE_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Whether a deadline has been reached at the given time
+ */
+inline bool deadlineReached(uint32_t deadline, uint32_t now)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+template <size_t N>
+class DeadlineHeap
+{
+    static_assert(N >= 1 && N < 255, "DeadlineHeap holds 1 to 254 entries");
+
+public:
+    struct Entry
+    {
+        uint32_t deadline;
+        uint8_t id;
+    };
+
+    DeadlineHeap() { clear(); }
+
+    void clear()
+    {
+        count = 0;
+        for(size_t i = 0; i < N; i++)
+        {
+            slot[i] = NONE;
+        }
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool contains(uint8_t id) const { return id < N && slot[id] != NONE; }
+
+    /**
+     * @brief Earliest entry, the heap must not be empty
+     */
+    const Entry &top() const { return heap[0]; }
+
+    /**
+     * @brief Add an entry or move it to a new deadline
+     * @retval false if the id is out of range
+     */
+    bool schedule(uint8_t id, uint32_t deadline)
+    {
+        if(id >= N)
+        {
+            return false;
+        }
+        if(slot[id] != NONE)
+        {
+            uint8_t pos = slot[id];
+            uint32_t old = heap[pos].deadline;
+            heap[pos].deadline = deadline;
+            if(before(deadline, old))
+            {
+                up(pos);
+            }
+            else
+            {
+                down(pos);
+            }
+            return true;
+        }
+
+        heap[count] = Entry{ deadline, id };
+        slot[id] = (uint8_t)count;
+        up((uint8_t)count++);
+        return true;
+    }
+
+    /**
+     * @brief Remove an entry
+     * @retval false if the id was not scheduled
+     */
+    bool remove(uint8_t id)
+    {
+        if(!contains(id))
+        {
+            return false;
+        }
+        uint8_t pos = slot[id];
+        slot[id] = NONE;
+        count--;
+        if(pos != count)
+        {
+            // The last entry fills the hole and moves whichever way it belongs
+            uint8_t moved = heap[count].id;
+            place(pos, heap[count]);
+            up(pos);
+            down(slot[moved]);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Remove and return the earliest entry, the heap must not be empty
+     */
+    Entry pop()
+    {
+        Entry first = heap[0];
+        remove(first.id);
+        return first;
+    }
+
+private:
+    static constexpr uint8_t NONE = 0xFF;
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void place(uint8_t pos, const Entry &entry)
+    {
+        heap[pos] = entry;
+        slot[entry.id] = pos;
+    }
+
+    void up(uint8_t pos)
+    {
+        Entry entry = heap[pos];
+        while(pos > 0)
+        {
+            uint8_t parent = (uint8_t)((pos - 1U) / 2U);
+            if(!before(entry.deadline, heap[parent].deadline))
+            {
+                break;
+            }
+            place(pos, heap[parent]);
+            pos = parent;
+        }
+        place(pos, entry);
+    }
+
+    void down(uint8_t pos)
+    {
+        Entry entry = heap[pos];
+        for(;;)
+        {
+            size_t child = 2U * pos + 1U;
+            if(child >= count)
+            {
+                break;
+            }
+            if(child + 1U < count && before(heap[child + 1U].deadline, heap[child].deadline))
+            {
+                child++;
+            }
+            if(!before(heap[child].deadline, entry.deadline))
+            {
+                break;
+            }
+            place(pos, heap[child]);
+            pos = (uint8_t)child;
+        }
+        place(pos, entry);
+    }
+
+    Entry heap[N];
+    uint8_t slot[N];            // Heap position of each id, NONE if not scheduled
+    size_t count;
+};
+
+#endif /* DEADLINE_HEAP_H */
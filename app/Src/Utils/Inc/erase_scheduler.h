@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : erase_scheduler.h
+  * @brief          : Flash page states and the order of background erases
+  ******************************************************************************
+  * Keeps the state of every page of a flash region and decides which page
+  * to erase next, so erases run in idle time instead of in front of a
+  * write. Writes are expected to move forward through the region and wrap
+  * (logs, update images, config journals): each written page queues the
+  * pages after it, and of the queued pages the one the writer reaches
+  * first is erased first. Pages can also be queued by hand.
+  *
+  * Erasing ahead gives up the oldest data of a wrapping log a few pages
+  * earlier than strictly needed; the lookahead sets how many.
+  ******************************************************************************
+  */
+
+#ifndef ERASE_SCHEDULER_H
+#define ERASE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ERASE_SCHEDULER_MAX_PAGES   256U
+
+enum ErasePageState : uint8_t
+{
+    ERASE_PAGE_UNKNOWN = 0,         // Not checked, treated as written
+    ERASE_PAGE_ERASED,
+    ERASE_PAGE_WRITTEN,
+    ERASE_PAGE_QUEUED,              // Written, erase wanted
+    ERASE_PAGE_ERASING,
+};
+
+class EraseScheduler
+{
+public:
+    /**
+     * @brief Start over with every page unknown
+     * @param lookahead Pages kept erased ahead of the last written one
+     * @retval false if the page count is 0 or above the maximum
+     */
+    bool init(uint32_t pages, uint32_t lookahead);
+
+    uint32_t pageCount() const { return pages; }
+    ErasePageState state(uint32_t page) const { return page < pages ? (ErasePageState)states[page] : ERASE_PAGE_UNKNOWN; }
+
+    /**
+     * @brief Record the result of a blank check, the erased pages need no erase
+     */
+    void checked(uint32_t page, bool erased);
+
+    /**
+     * @brief A program touched the page; queue the lookahead pages after it
+     */
+    void written(uint32_t page);
+
+    /**
+     * @brief Queue a page for erase
+     * @retval false if it is erased, being erased or out of range
+     */
+    bool request(uint32_t page);
+
+    /**
+     * @brief Most urgent queued page, skipping a range that must not be erased now
+     * @param skipFirst First page of the range, e.g. the pages sharing a bank with the code
+     * @param skipCount Pages in the range, 0 for none
+     * @retval false if nothing eligible is queued
+     */
+    bool next(uint32_t &page, uint32_t skipFirst = 0, uint32_t skipCount = 0) const;
+
+    void started(uint32_t page);
+
+    /**
+     * @brief Erase done; a failed page goes back to unknown and is not retried by itself
+     */
+    void finished(uint32_t page, bool ok);
+
+    uint32_t queued() const { return queuedCount; }
+    uint32_t erased() const { return erasedCount; }
+
+private:
+    void set(uint32_t page, ErasePageState state);
+
+    uint8_t states[ERASE_SCHEDULER_MAX_PAGES];
+    uint32_t pages = 0;
+    uint32_t lookahead = 0;
+    uint32_t head = 0;                  // Page after the last written one
+    uint32_t queuedCount = 0;
+    uint32_t erasedCount = 0;
+};
+
+#endif /* ERASE_SCHEDULER_H */
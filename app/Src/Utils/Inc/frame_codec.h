@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file           : frame_codec.h
+  * @brief          : COBS framing with CRC-16 for byte-stream links
+  ******************************************************************************
+  * A frame on the wire is COBS(payload + CRC-16 big endian) followed by a
+  * single 0x00 delimiter. The encoding contains no zero bytes, so a receiver
+  * resynchronizes on the next delimiter after line noise or a dropped byte.
+  * The decoder works byte by byte and needs no buffer beyond the frame.
+  ******************************************************************************
+  */
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_MAX_PAYLOAD   256U
+#define FRAME_CRC_SIZE      2U
+
+/* Worst-case encoded size of a payload, delimiter included */
+#define FRAME_ENCODED_SIZE(payload) ((payload) + FRAME_CRC_SIZE + ((payload) + FRAME_CRC_SIZE) / 254U + 2U)
+
+/**
+ * @brief Encode one frame
+ * @param payload Frame payload
+ * @param length Payload length, up to FRAME_MAX_PAYLOAD
+ * @param out Output buffer
+ * @param size Size of the output buffer
+ * @retval Encoded length including the delimiter, 0 if it does not fit
+ */
+size_t frameEncode(const uint8_t *payload, size_t length, uint8_t *out, size_t size);
+
+struct FrameDecoderStats
+{
+    uint32_t frames;
+    uint32_t crcErrors;
+    uint32_t overflows;     // Frames longer than FRAME_MAX_PAYLOAD
+    uint32_t malformed;     // COBS structure broken by a lost or corrupted byte
+};
+
+class FrameDecoder
+{
+public:
+    enum Result
+    {
+        NONE,       // Frame still in progress
+        FRAME,      // Complete frame available through payload()/length()
+        ERROR       // Frame discarded, see stats()
+    };
+
+    /**
+     * @brief Feed one received byte
+     * @retval FRAME when a valid frame just completed, it stays valid until the next push
+     */
+    Result push(uint8_t byte);
+
+    const uint8_t *payload() const { return buffer; }
+    size_t length() const { return frameLength; }
+    const FrameDecoderStats &stats() const { return counters; }
+
+    /**
+     * @brief Drop any partial frame
+     */
+    void reset();
+
+private:
+    uint8_t buffer[FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE];
+    size_t fill = 0;
+    size_t frameLength = 0;
+    uint8_t blockRemaining = 0;
+    bool zeroPending = false;
+    bool discarding = false;
+    FrameDecoderStats counters = {};
+};
+
+#endif /* FRAME_CODEC_H */
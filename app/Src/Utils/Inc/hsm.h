@@ -0,0 +1,351 @@
+/**
+  ******************************************************************************
+  * @file           : hsm.h
+  * @brief          : Hierarchical state machine with compile-time tables
+  ******************************************************************************
+  * A machine is a struct describing its tables:
+  *
+  *   struct Machine
+  *   {
+  *       using Context = ...;                  // Passed to every action
+  *       using Payload = ...;                  // Event data passed to guards and actions
+  *       static constexpr uint8_t EVENT_COUNT = ...;
+  *       static constexpr uint8_t INITIAL = ...;
+  *       static constexpr HsmState<Context> states[] = { ... };
+  *       static constexpr HsmTransition<Context, Payload> transitions[] = { ... };
+  *   };
+  *
+  * States are numbered by their position in the table and must be listed
+  * after their parent. A composite state names the substate entered by
+  * default. An event is offered to the current leaf state first and then to
+  * each ancestor; within a state the transitions are tried in table order
+  * and the first one whose guard passes is taken. Exits run innermost
+  * first, then the action, then entries down to the target and its default
+  * substates. A transition without target is internal: only the action runs.
+  *
+  * The tables are checked with static_assert and indexed at compile time
+  * (first transition per state and event, common ancestor per state pair),
+  * so dispatch is a few table lookups and direct calls, no virtual calls and
+  * no heap. Machines are run to completion: dispatching from inside an
+  * action or entry/exit function is refused, queue the event instead.
+  ******************************************************************************
+  */
+
+#ifndef HSM_H
+#define HSM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HSM_NONE        0xFFU   // No parent, no default substate, or internal transition
+#define HSM_MAX_DEPTH   8U
+
+template <typename Context>
+struct HsmState
+{
+    uint8_t id;                                 // Must equal the table position
+    uint8_t parent;                             // HSM_NONE for top-level states
+    uint8_t initial;                            // Default substate, HSM_NONE for leaves
+    void (*entry)(Context &ctx);                // May be nullptr
+    void (*exit)(Context &ctx);                 // May be nullptr
+};
+
+template <typename Context, typename Payload>
+struct HsmTransition
+{
+    uint8_t source;
+    uint8_t event;
+    uint8_t target;                                         // HSM_NONE for an internal transition
+    bool (*guard)(Context &ctx, const Payload &payload);    // May be nullptr
+    void (*action)(Context &ctx, const Payload &payload);   // May be nullptr
+};
+
+namespace hsm_detail {
+
+template <typename T, size_t N>
+constexpr size_t count(const T (&)[N])
+{
+    return N;
+}
+
+template <typename Machine>
+struct Tables
+{
+    static constexpr size_t STATES = count(Machine::states);
+    static constexpr size_t TRANSITIONS = count(Machine::transitions);
+    static constexpr size_t EVENTS = Machine::EVENT_COUNT;
+
+    struct Index
+    {
+        uint8_t first[STATES][EVENTS];      // First transition per state and event
+        uint8_t next[TRANSITIONS];          // Next transition with the same state and event
+        uint8_t domain[STATES][STATES];     // Innermost state containing source and target, exclusive
+        uint8_t depth[STATES];
+    };
+
+    static constexpr bool contains(uint8_t outer, uint8_t inner)
+    {
+        for(uint8_t s = Machine::states[inner].parent; s != HSM_NONE; s = Machine::states[s].parent)
+        {
+            if(s == outer)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static constexpr bool statesValid()
+    {
+        if(STATES == 0 || STATES >= HSM_NONE || Machine::INITIAL >= STATES)
+        {
+            return false;
+        }
+        for(size_t i = 0; i < STATES; i++)
+        {
+            const HsmState<typename Machine::Context> &state = Machine::states[i];
+            if(state.id != i || (state.parent != HSM_NONE && state.parent >= i))
+            {
+                return false;
+            }
+            if(state.initial != HSM_NONE && (state.initial >= STATES || !contains((uint8_t)i, state.initial)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool transitionsValid()
+    {
+        if(TRANSITIONS >= HSM_NONE || EVENTS == 0)
+        {
+            return false;
+        }
+        for(size_t i = 0; i < TRANSITIONS; i++)
+        {
+            const HsmTransition<typename Machine::Context, typename Machine::Payload> &t = Machine::transitions[i];
+            if(t.source >= STATES || t.event >= EVENTS || (t.target != HSM_NONE && t.target >= STATES))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr Index build()
+    {
+        Index index = {};
+        for(size_t s = 0; s < STATES; s++)
+        {
+            for(size_t e = 0; e < EVENTS; e++)
+            {
+                index.first[s][e] = HSM_NONE;
+            }
+            uint8_t parent = Machine::states[s].parent;
+            index.depth[s] = parent == HSM_NONE ? 1U : (uint8_t)(index.depth[parent] + 1U);
+        }
+
+        // Chain backwards so each chain follows table order
+        for(size_t i = TRANSITIONS; i-- > 0;)
+        {
+            const auto &t = Machine::transitions[i];
+            index.next[i] = index.first[t.source][t.event];
+            index.first[t.source][t.event] = (uint8_t)i;
+        }
+
+        // External transitions leave the source even when the target is inside it
+        for(size_t a = 0; a < STATES; a++)
+        {
+            for(size_t b = 0; b < STATES; b++)
+            {
+                uint8_t s = Machine::states[a].parent;
+                while(s != HSM_NONE && !contains(s, (uint8_t)b))
+                {
+                    s = Machine::states[s].parent;
+                }
+                index.domain[a][b] = s;
+            }
+        }
+        return index;
+    }
+
+    static constexpr bool depthValid()
+    {
+        Index index = build();
+        for(size_t s = 0; s < STATES; s++)
+        {
+            if(index.depth[s] > HSM_MAX_DEPTH)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace hsm_detail
+
+template <typename Machine>
+class Hsm
+{
+    using Tables = hsm_detail::Tables<Machine>;
+
+    static_assert(Tables::statesValid(), "HSM states: ids must match table order, parents must come first, initial must be a descendant");
+    static_assert(Tables::transitionsValid(), "HSM transitions: source, event or target out of range");
+    static_assert(Tables::depthValid(), "HSM nesting deeper than HSM_MAX_DEPTH");
+
+    static constexpr typename Tables::Index index = Tables::build();
+
+public:
+    using Context = typename Machine::Context;
+    using Payload = typename Machine::Payload;
+
+    /**
+     * @brief Transition trace hook, called after every handled event
+     * @param from Leaf state before the event, HSM_NONE on start
+     * @param to Leaf state after the event, equal to from for internal transitions
+     * @param event Event id, HSM_NONE on start
+     */
+    using TraceFn = void (*)(void *traceCtx, uint8_t from, uint8_t to, uint8_t event);
+
+    void setTrace(TraceFn fn, void *traceCtx)
+    {
+        trace = fn;
+        traceContext = traceCtx;
+    }
+
+    /**
+     * @brief Enter the initial state, running entry functions from the top down
+     */
+    void start(Context &context)
+    {
+        ctx = &context;
+        busy = true;
+        enter(HSM_NONE, Machine::INITIAL);
+        busy = false;
+        if(trace != nullptr)
+        {
+            trace(traceContext, HSM_NONE, current, HSM_NONE);
+        }
+    }
+
+    /**
+     * @brief Process one event to completion
+     * @retval true if a transition was taken, false if no state handled it
+     */
+    bool dispatch(uint8_t event, const Payload &payload)
+    {
+        if(ctx == nullptr || busy || event >= Tables::EVENTS)
+        {
+            return false;
+        }
+
+        for(uint8_t s = current; s != HSM_NONE; s = Machine::states[s].parent)
+        {
+            for(uint8_t t = index.first[s][event]; t != HSM_NONE; t = index.next[t])
+            {
+                const HsmTransition<Context, Payload> &transition = Machine::transitions[t];
+                if(transition.guard == nullptr || transition.guard(*ctx, payload))
+                {
+                    take(s, transition, event, payload);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Current leaf state
+     */
+    uint8_t state() const { return current; }
+
+    /**
+     * @brief Check whether the machine is in a state or one of its substates
+     */
+    bool isIn(uint8_t state) const
+    {
+        for(uint8_t s = current; s != HSM_NONE; s = Machine::states[s].parent)
+        {
+            if(s == state)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    void take(uint8_t source, const HsmTransition<Context, Payload> &transition, uint8_t event, const Payload &payload)
+    {
+        uint8_t from = current;
+        busy = true;
+
+        if(transition.target == HSM_NONE)
+        {
+            if(transition.action != nullptr)
+            {
+                transition.action(*ctx, payload);
+            }
+        }
+        else
+        {
+            uint8_t domain = index.domain[source][transition.target];
+            for(uint8_t s = current; s != domain; s = Machine::states[s].parent)
+            {
+                if(Machine::states[s].exit != nullptr)
+                {
+                    Machine::states[s].exit(*ctx);
+                }
+            }
+            if(transition.action != nullptr)
+            {
+                transition.action(*ctx, payload);
+            }
+            enter(domain, transition.target);
+        }
+
+        busy = false;
+        if(trace != nullptr)
+        {
+            trace(traceContext, from, current, event);
+        }
+    }
+
+    /**
+     * @brief Enter target from just below domain, then its default substates
+     */
+    void enter(uint8_t domain, uint8_t target)
+    {
+        while(target != HSM_NONE)
+        {
+            uint8_t path[HSM_MAX_DEPTH];
+            size_t depth = 0;
+            for(uint8_t s = target; s != domain; s = Machine::states[s].parent)
+            {
+                path[depth++] = s;
+            }
+            while(depth > 0)
+            {
+                uint8_t s = path[--depth];
+                if(Machine::states[s].entry != nullptr)
+                {
+                    Machine::states[s].entry(*ctx);
+                }
+            }
+
+            current = target;
+            domain = target;
+            target = Machine::states[target].initial;
+        }
+    }
+
+    Context *ctx = nullptr;
+    uint8_t current = HSM_NONE;
+    bool busy = false;
+    TraceFn trace = nullptr;
+    void *traceContext = nullptr;
+};
+
+#endif /* HSM_H */
@@ -0,0 +1,260 @@
+/**
+  ******************************************************************************
+  * @file           : kalman.h
+  * @brief          : Extended and unscented Kalman filters on matrix.h
+  ******************************************************************************
+  * Both filters keep the state x and its covariance P, stored as the upper
+  * triangle only, with the dimension N fixed at compile time so the
+  * kernels unroll; measurements of any size M are fused one sensor at a
+  * time, each with its own update call.
+  *
+  * ExtendedKalmanFilter takes the caller's linearisation: the predicted
+  * state and the Jacobian F of the process for predict(), the innovation
+  * z - h(x) and the Jacobian H for update(). With a diagonal R, one
+  * updateScalar() per component needs no matrix solve at all and is the
+  * cheapest way to fuse several independent sensors.
+  *
+  * UnscentedKalmanFilter takes the process and measurement functions
+  * themselves and propagates 2N + 1 sigma points (scaled unscented
+  * transform, alpha, beta and kappa as in van der Merwe), so no Jacobians
+  * are needed. update() keeps the transformed sigma points on the stack:
+  * (2N + 1) * M scalars.
+  *
+  * The innovation covariance is factored by Cholesky rather than inverted.
+  * An update whose innovation covariance is not positive definite leaves
+  * the filter untouched and returns false, as does a predict() whose
+  * covariance has lost definiteness.
+  ******************************************************************************
+  */
+
+#ifndef KALMAN_H
+#define KALMAN_H
+
+#include "matrix.h"
+
+template<typename T, size_t N>
+class ExtendedKalmanFilter
+{
+public:
+    using State = Vector<T, N>;
+    using Covariance = SymMatrix<T, N>;
+
+    void reset(const State &state, const Covariance &covariance)
+    {
+        x = state;
+        p = covariance;
+    }
+
+    /**
+     * @brief x = f(x), P = F P F' + Q
+     * @param predicted f(x), evaluated by the caller
+     * @param f Jacobian of f at x
+     */
+    void predict(const State &predicted, const Matrix<T, N, N> &f, const Covariance &q)
+    {
+        x = predicted;
+        p = quadraticForm(f, p) + q;
+    }
+
+    /**
+     * @brief Fuse one measurement
+     * @param innovation z - h(x)
+     * @param h Jacobian of h at x
+     * @param r Measurement noise covariance
+     * @retval false if H P H' + R is not positive definite
+     */
+    template<size_t M>
+    bool update(const Vector<T, M> &innovation, const Matrix<T, M, N> &h, const SymMatrix<T, M> &r)
+    {
+        SymMatrix<T, M> s = quadraticForm(h, p) + r;
+        Matrix<T, M, M> l;
+        if(!cholesky(s, l))
+        {
+            return false;
+        }
+
+        // K' = S^-1 H P, so K = P H' S^-1 without an inverse; P H' is the transpose of H P
+        Matrix<T, M, N> hp = h * p;
+        Matrix<T, M, N> kt = hp;
+        choleskySolve(l, kt);
+
+        x += kt.transpose() * innovation;
+        p -= hp.transpose() * kt;           // K S K' = P H' K', symmetric
+        return true;
+    }
+
+    /**
+     * @brief Fuse one scalar measurement, no solve
+     * @param innovation z - h(x)
+     * @param h Gradient of h at x, as a row
+     * @param r Measurement noise variance
+     * @retval false if h P h' + r is not positive
+     */
+    bool updateScalar(T innovation, const Matrix<T, 1, N> &h, T r)
+    {
+        State ph = p * h.transpose();
+        T s = (h * ph)(0, 0) + r;
+        if(!(s > T(0)))
+        {
+            return false;
+        }
+
+        T inverse = T(1) / s;
+        x += ph * (innovation * inverse);
+        addOuter(p, ph, -inverse);
+        return true;
+    }
+
+    const State &state() const { return x; }
+    const Covariance &covariance() const { return p; }
+
+private:
+    State x;
+    Covariance p;
+};
+
+template<typename T, size_t N>
+class UnscentedKalmanFilter
+{
+public:
+    using State = Vector<T, N>;
+    using Covariance = SymMatrix<T, N>;
+
+    static constexpr size_t SIGMA = 2U * N + 1U;
+
+    /**
+     * @param alpha Spread of the sigma points, 0 < alpha <= 1
+     * @param beta Prior knowledge of the distribution, 2 for Gaussian
+     * @param kappa Secondary scaling, usually 0
+     */
+    explicit UnscentedKalmanFilter(T alpha = T(1), T beta = T(2), T kappa = T(0))
+    {
+        T n = T(N);
+        T lambda = alpha * alpha * (n + kappa) - n;
+        spread = matrix_detail::root(n + lambda);
+        meanWeight0 = lambda / (n + lambda);
+        covWeight0 = meanWeight0 + (T(1) - alpha * alpha + beta);
+        weight = T(1) / (T(2) * (n + lambda));
+    }
+
+    void reset(const State &state, const Covariance &covariance)
+    {
+        x = state;
+        p = covariance;
+    }
+
+    /**
+     * @brief Propagate the sigma points through the process
+     * @param f Callable State f(const State &)
+     * @retval false if P is no longer positive definite
+     */
+    template<typename F>
+    bool predict(F f, const Covariance &q)
+    {
+        if(!makeSigmaPoints())
+        {
+            return false;
+        }
+        for(size_t i = 0; i < SIGMA; i++)
+        {
+            sigma[i] = f(sigma[i]);
+        }
+
+        x = mean(sigma);
+        p = q;
+        for(size_t i = 0; i < SIGMA; i++)
+        {
+            addOuter(p, State(sigma[i] - x), i == 0 ? covWeight0 : weight);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Fuse one measurement
+     * @param h Callable Vector<T, M> h(const State &)
+     * @retval false if P or the innovation covariance is not positive definite
+     */
+    template<size_t M, typename H>
+    bool update(H h, const Vector<T, M> &z, const SymMatrix<T, M> &r)
+    {
+        if(!makeSigmaPoints())
+        {
+            return false;
+        }
+
+        Vector<T, M> zs[SIGMA];
+        for(size_t i = 0; i < SIGMA; i++)
+        {
+            zs[i] = h(sigma[i]);
+        }
+        Vector<T, M> zMean = mean(zs);
+
+        SymMatrix<T, M> s = r;
+        Matrix<T, M, N> czx;                // Cross covariance, transposed
+        for(size_t i = 0; i < SIGMA; i++)
+        {
+            T w = i == 0 ? covWeight0 : weight;
+            Vector<T, M> dz = zs[i] - zMean;
+            State dx = sigma[i] - x;
+            addOuter(s, dz, w);
+            czx += (w * dz) * dx.transpose();
+        }
+
+        Matrix<T, M, M> l;
+        if(!cholesky(s, l))
+        {
+            return false;
+        }
+        Matrix<T, M, N> kt = czx;
+        choleskySolve(l, kt);
+
+        x += kt.transpose() * (z - zMean);
+        p -= czx.transpose() * kt;          // K S K' = Pxz K', symmetric
+        return true;
+    }
+
+    const State &state() const { return x; }
+    const Covariance &covariance() const { return p; }
+
+private:
+    bool makeSigmaPoints()
+    {
+        Matrix<T, N, N> l;
+        if(!cholesky(p, l))
+        {
+            return false;
+        }
+        sigma[0] = x;
+        for(size_t c = 0; c < N; c++)
+        {
+            for(size_t r = 0; r < N; r++)
+            {
+                T d = spread * l(r, c);
+                sigma[1U + c](r, 0) = x[r] + d;
+                sigma[1U + N + c](r, 0) = x[r] - d;
+            }
+        }
+        return true;
+    }
+
+    template<size_t K>
+    Vector<T, K> mean(const Vector<T, K> *points) const
+    {
+        Vector<T, K> sum = meanWeight0 * points[0];
+        for(size_t i = 1; i < SIGMA; i++)
+        {
+            sum += weight * points[i];
+        }
+        return sum;
+    }
+
+    State x;
+    Covariance p;
+    State sigma[SIGMA];
+    T spread;
+    T meanWeight0;
+    T covWeight0;
+    T weight;                               // Every point but the centre, for the mean and the covariance
+};
+
+#endif /* KALMAN_H */
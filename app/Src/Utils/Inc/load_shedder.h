@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file           : load_shedder.h
+  * @brief          : Overload controller stepping service levels down and up
+  ******************************************************************************
+  * Components register how many degradation steps they offer and an order;
+  * together they form one ladder. Shedding takes the next step of the
+  * lowest-order component that still has one (log verbosity before polling
+  * rate before telemetry), restoring walks the ladder back in reverse.
+  *
+  * The controller is fed one sample per period: CPU load and the deadline
+  * misses seen during the period. A sample is overloaded when the load is
+  * above the shed threshold or misses reach the limit, calm when the load is
+  * below the restore threshold with no miss. A step is taken only after
+  * several consecutive samples of the same kind, and loads between the two
+  * thresholds hold the current level, so the ladder does not flap.
+  ******************************************************************************
+  */
+
+#ifndef LOAD_SHEDDER_H
+#define LOAD_SHEDDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOAD_SHED_MAX_CLIENTS   8U
+
+struct LoadShedClient
+{
+    const char *name;
+    uint8_t order;                              // Lower orders are degraded first and restored last
+    uint8_t levels;                             // Degradation steps beyond full service
+    void (*apply)(uint8_t level, void *ctx);    // 0 is full service, levels is the most degraded
+    void *ctx;
+};
+
+struct LoadShedConfig
+{
+    uint16_t shedAbovePermille = 850;
+    uint16_t restoreBelowPermille = 600;
+    uint32_t missesToShed = 1;          // Deadline misses in one sample that count as overload
+    uint8_t shedAfterSamples = 2;       // Consecutive overloaded samples per step down
+    uint8_t restoreAfterSamples = 5;    // Consecutive calm samples per step up
+};
+
+struct LoadShedStats
+{
+    uint8_t level;                  // Steps currently shed
+    uint8_t peakLevel;
+    uint32_t samples;
+    uint32_t overloadedSamples;
+    uint32_t sheds;
+    uint32_t restores;
+    uint32_t lastLoadPermille;
+};
+
+class LoadShedder
+{
+public:
+    void configure(const LoadShedConfig &config) { cfg = config; }
+
+    /**
+     * @brief Add a component to the ladder, it is told its level right away
+     * @retval false if the table is full or the client is invalid
+     */
+    bool addClient(const LoadShedClient &client);
+
+    /**
+     * @brief Feed one period of measurements, may step the ladder
+     * @param loadPermille CPU load over the period, 0-1000
+     * @param deadlineMisses Deadline misses counted during the period
+     */
+    void sample(uint32_t loadPermille, uint32_t deadlineMisses);
+
+    uint8_t level() const { return counters.level; }
+    uint8_t levelCount() const;
+    size_t clientCount() const { return count; }
+    const LoadShedClient &client(size_t index) const { return clients[index]; }
+    uint8_t clientLevel(size_t index) const { return levels[index]; }
+    const LoadShedStats &stats() const { return counters; }
+
+private:
+    void distribute();
+
+    LoadShedConfig cfg;
+    LoadShedClient clients[LOAD_SHED_MAX_CLIENTS] = {};
+    uint8_t levels[LOAD_SHED_MAX_CLIENTS] = {};
+    size_t count = 0;
+
+    uint8_t overloadedRun = 0;
+    uint8_t calmRun = 0;
+    LoadShedStats counters = {};
+};
+
+#endif /* LOAD_SHEDDER_H */
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file           : log_buffer.h
+  * @brief          : Log record queue with per-severity headroom
+  ******************************************************************************
+  * Records are queued whole and leave in arrival order. Each severity may
+  * only fill the buffer up to its capacity minus its reserve, so chatter
+  * cannot take the space kept for worse news. A record that does not fit
+  * evicts the oldest records of the lowest severity below its own; if that
+  * is still not enough it is dropped. Evicted and dropped records are counted
+  * per severity until the owner takes the summary.
+  *
+  * Not interrupt safe on its own.
+  ******************************************************************************
+  */
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_BUFFER_SEVERITIES   4U      // 0 is the least severe
+#define LOG_BUFFER_TEXT_MAX     255U    // Longest record text
+
+class LogBuffer
+{
+public:
+    void attach(uint8_t *storage, size_t size);
+
+    /**
+     * @brief Keep bytes free that records of this severity may not use
+     */
+    void setReserve(uint8_t severity, size_t bytes);
+
+    /**
+     * @brief Queue a record, evicting less severe ones if needed
+     * @retval false if the record was dropped
+     */
+    bool push(uint8_t severity, const char *text, size_t length);
+
+    /**
+     * @brief Text length of the oldest record, check records() first
+     */
+    size_t frontLength() const;
+
+    /**
+     * @brief Remove the oldest record
+     * @param severity Receives its severity
+     * @param dst Receives its text, truncated to dstSize and not terminated
+     * @retval Text length copied, 0 if the buffer is empty
+     */
+    size_t pop(uint8_t &severity, char *dst, size_t dstSize);
+
+    /**
+     * @brief Collect the records shed since the last call
+     * @param counts Receives one count per severity
+     * @retval false if nothing was shed
+     */
+    bool takeShed(uint32_t counts[LOG_BUFFER_SEVERITIES]);
+
+    size_t used() const { return end - begin; }
+    size_t capacity() const { return size; }
+    size_t records() const { return count; }
+    uint32_t totalShed(uint8_t severity) const { return shedTotal[severity]; }
+
+private:
+    static constexpr size_t HEADER = 2;     // Severity, text length
+
+    size_t limit(uint8_t severity) const;
+    bool evictBelow(uint8_t severity);
+    void compact();
+
+    uint8_t *buffer = nullptr;
+    size_t size = 0;
+    size_t begin = 0;       // Oldest record
+    size_t end = 0;         // Past the newest record
+    size_t count = 0;
+    size_t reserve[LOG_BUFFER_SEVERITIES] = {};
+
+    uint32_t shedPending[LOG_BUFFER_SEVERITIES] = {};
+    uint32_t shedTotal[LOG_BUFFER_SEVERITIES] = {};
+};
+
+#endif /* LOG_BUFFER_H */
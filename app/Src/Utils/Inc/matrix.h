@@ -0,0 +1,602 @@
+/**
+  ******************************************************************************
+  * @file           : matrix.h
+  * @brief          : Fixed-size matrices with expression templates, no heap
+  ******************************************************************************
+  * Matrix<T, R, C> holds its elements inline, so matrices live on the stack
+  * or in statics and every dimension is checked by the compiler. Sums,
+  * differences, scaling, transposes and products build expression objects
+  * instead of results; assigning one evaluates it element by element into
+  * the destination, so P + K * S * K.transpose() needs no temporary for
+  * the sum. A product operand that is itself an expression is evaluated
+  * once into a matrix first, or every element of the outer product would
+  * recompute the inner one.
+  *
+  * Assignment checks whether the destination is read by a product or a
+  * transpose on the right (P = F * P) and only then goes through a
+  * temporary. Expressions hold references to their matrix operands: use
+  * them within the statement, do not keep them in auto variables.
+  *
+  * SymMatrix<T, N> stores the upper triangle only, N(N + 1)/2 elements,
+  * and evaluates only that triangle when assigned, which halves the work
+  * of covariance updates. The expression assigned must be symmetric.
+  * quadraticForm(A, S) gives A S A' as a SymMatrix, cholesky() and
+  * choleskySolve() replace explicit inverses of positive-definite
+  * matrices.
+  *
+  * Loops run over compile-time bounds and are marked for unrolling, so the
+  * 3 to 12 sized kernels of a Kalman filter become straight-line code.
+  ******************************************************************************
+  */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+#include <math.h>
+
+#include <initializer_list>
+#include <type_traits>
+
+#ifndef MATRIX_UNROLL
+#if defined(__GNUC__) && !defined(__clang__)
+#define MATRIX_UNROLL _Pragma("GCC unroll 16")
+#else
+#define MATRIX_UNROLL
+#endif
+#endif
+
+template<typename T, size_t R, size_t C>
+class Matrix;
+
+template<typename T, size_t N>
+class SymMatrix;
+
+/**
+ * @brief Base of every matrix and expression, for overloads that take any of them
+ */
+template<typename E>
+struct MatExpr
+{
+    const E &self() const { return static_cast<const E &>(*this); }
+};
+
+namespace matrix_detail {
+
+/**
+ * @brief Matrices are held by reference, expressions by value
+ */
+template<typename E>
+using Operand = typename std::conditional<E::LEAF, const E &, const E>::type;
+
+template<typename E>
+using Evaluated = Matrix<typename E::Scalar, E::ROWS, E::COLS>;
+
+/**
+ * @brief Product operands: matrices and their transposes as they are, anything else evaluated once
+ */
+template<typename E>
+using ProductOperand = typename std::conditional<E::DIRECT, Operand<E>, const Evaluated<E>>::type;
+
+inline float root(float v) { return sqrtf(v); }
+inline double root(double v) { return sqrt(v); }
+
+struct Add
+{
+    template<typename T> static T apply(T a, T b) { return a + b; }
+};
+
+struct Subtract
+{
+    template<typename T> static T apply(T a, T b) { return a - b; }
+};
+
+template<typename Op, typename A, typename B>
+class Elementwise : public MatExpr<Elementwise<Op, A, B>>
+{
+    static_assert(A::ROWS == B::ROWS && A::COLS == B::COLS, "operands differ in size");
+
+public:
+    using Scalar = typename A::Scalar;
+    static constexpr size_t ROWS = A::ROWS;
+    static constexpr size_t COLS = A::COLS;
+    static constexpr bool LEAF = false;
+    static constexpr bool DIRECT = false;
+
+    Elementwise(const A &a, const B &b) : a(a), b(b) {}
+
+    Scalar operator()(size_t r, size_t c) const { return Op::apply(a(r, c), b(r, c)); }
+
+    // Element (r, c) only reads element (r, c) of a matrix operand
+    bool reads(const void *p) const { return a.reads(p) || b.reads(p); }
+    bool aliases(const void *p) const { return a.aliases(p) || b.aliases(p); }
+
+private:
+    Operand<A> a;
+    Operand<B> b;
+};
+
+template<typename A>
+class Scaled : public MatExpr<Scaled<A>>
+{
+public:
+    using Scalar = typename A::Scalar;
+    static constexpr size_t ROWS = A::ROWS;
+    static constexpr size_t COLS = A::COLS;
+    static constexpr bool LEAF = false;
+    static constexpr bool DIRECT = false;
+
+    Scaled(const A &a, Scalar k) : a(a), k(k) {}
+
+    Scalar operator()(size_t r, size_t c) const { return k * a(r, c); }
+    bool reads(const void *p) const { return a.reads(p); }
+    bool aliases(const void *p) const { return a.aliases(p); }
+
+private:
+    Operand<A> a;
+    Scalar k;
+};
+
+template<typename A>
+class Transposed : public MatExpr<Transposed<A>>
+{
+public:
+    using Scalar = typename A::Scalar;
+    static constexpr size_t ROWS = A::COLS;
+    static constexpr size_t COLS = A::ROWS;
+    static constexpr bool LEAF = false;
+    static constexpr bool DIRECT = A::LEAF;     // Reads the matrix with the indices swapped
+
+    explicit Transposed(const A &a) : a(a) {}
+
+    Scalar operator()(size_t r, size_t c) const { return a(c, r); }
+    bool reads(const void *p) const { return a.reads(p); }
+    bool aliases(const void *p) const { return a.reads(p); }
+
+private:
+    Operand<A> a;
+};
+
+template<typename A, typename B>
+class Product : public MatExpr<Product<A, B>>
+{
+    static_assert(A::COLS == B::ROWS, "inner dimensions differ");
+
+public:
+    using Scalar = typename A::Scalar;
+    static constexpr size_t ROWS = A::ROWS;
+    static constexpr size_t COLS = B::COLS;
+    static constexpr bool LEAF = false;
+    static constexpr bool DIRECT = false;
+
+    Product(const A &a, const B &b) : a(a), b(b) {}
+
+    Scalar operator()(size_t r, size_t c) const
+    {
+        Scalar sum = a(r, 0) * b(0, c);
+        MATRIX_UNROLL
+        for(size_t k = 1; k < A::COLS; k++)
+        {
+            sum += a(r, k) * b(k, c);
+        }
+        return sum;
+    }
+
+    bool reads(const void *p) const { return a.reads(p) || b.reads(p); }
+    bool aliases(const void *p) const { return a.reads(p) || b.reads(p); }
+
+private:
+    ProductOperand<A> a;
+    ProductOperand<B> b;
+};
+
+} // namespace matrix_detail
+
+template<typename T, size_t R, size_t C>
+class Matrix : public MatExpr<Matrix<T, R, C>>
+{
+    static_assert(R > 0 && C > 0, "empty matrix");
+
+public:
+    using Scalar = T;
+    static constexpr size_t ROWS = R;
+    static constexpr size_t COLS = C;
+    static constexpr bool LEAF = true;
+    static constexpr bool DIRECT = true;
+
+    Matrix() = default;
+
+    /**
+     * @brief Row by row, missing elements are zero
+     */
+    Matrix(std::initializer_list<T> values)
+    {
+        size_t i = 0;
+        for(T v : values)
+        {
+            if(i < R * C)
+            {
+                m[i / C][i % C] = v;
+                i++;
+            }
+        }
+    }
+
+    template<typename E>
+    Matrix(const MatExpr<E> &e)
+    {
+        assignDirect(e.self());
+    }
+
+    template<typename E>
+    Matrix &operator=(const MatExpr<E> &e)
+    {
+        if(e.self().aliases(this))
+        {
+            Matrix result(e);
+            *this = result;
+        }
+        else
+        {
+            assignDirect(e.self());
+        }
+        return *this;
+    }
+
+    template<typename E>
+    Matrix &operator+=(const MatExpr<E> &e) { return *this = *this + e; }
+
+    template<typename E>
+    Matrix &operator-=(const MatExpr<E> &e) { return *this = *this - e; }
+
+    Matrix &operator*=(T k)
+    {
+        MATRIX_UNROLL
+        for(size_t i = 0; i < R * C; i++)
+        {
+            m[i / C][i % C] *= k;
+        }
+        return *this;
+    }
+
+    T &operator()(size_t r, size_t c) { return m[r][c]; }
+    const T &operator()(size_t r, size_t c) const { return m[r][c]; }
+
+    // Vectors index by element
+    T &operator[](size_t i) { static_assert(R == 1 || C == 1, "not a vector"); return (&m[0][0])[i]; }
+    const T &operator[](size_t i) const { static_assert(R == 1 || C == 1, "not a vector"); return (&m[0][0])[i]; }
+
+    static Matrix zero() { return Matrix(); }
+
+    static Matrix identity()
+    {
+        static_assert(R == C, "identity of a non-square matrix");
+        Matrix result;
+        for(size_t i = 0; i < R; i++)
+        {
+            result.m[i][i] = T(1);
+        }
+        return result;
+    }
+
+    matrix_detail::Transposed<Matrix> transpose() const { return matrix_detail::Transposed<Matrix>(*this); }
+
+    bool reads(const void *p) const { return p == this; }
+    bool aliases(const void *) const { return false; }
+
+private:
+    template<typename E>
+    void assignDirect(const E &e)
+    {
+        static_assert(E::ROWS == R && E::COLS == C, "assigned expression differs in size");
+        MATRIX_UNROLL
+        for(size_t r = 0; r < R; r++)
+        {
+            MATRIX_UNROLL
+            for(size_t c = 0; c < C; c++)
+            {
+                m[r][c] = e(r, c);
+            }
+        }
+    }
+
+    T m[R][C] = {};
+};
+
+template<typename T, size_t N>
+using Vector = Matrix<T, N, 1>;
+
+/**
+ * @brief Symmetric N x N matrix, upper triangle stored row by row
+ */
+template<typename T, size_t N>
+class SymMatrix : public MatExpr<SymMatrix<T, N>>
+{
+public:
+    using Scalar = T;
+    static constexpr size_t ROWS = N;
+    static constexpr size_t COLS = N;
+    static constexpr size_t STORED = N * (N + 1U) / 2U;
+    static constexpr bool LEAF = true;
+    static constexpr bool DIRECT = true;
+
+    SymMatrix() = default;
+
+    /**
+     * @brief From a symmetric expression, evaluating the upper triangle only
+     */
+    template<typename E>
+    SymMatrix(const MatExpr<E> &e)
+    {
+        assignDirect(e.self());
+    }
+
+    template<typename E>
+    SymMatrix &operator=(const MatExpr<E> &e)
+    {
+        if(e.self().aliases(this))
+        {
+            SymMatrix result(e);
+            *this = result;
+        }
+        else
+        {
+            assignDirect(e.self());
+        }
+        return *this;
+    }
+
+    template<typename E>
+    SymMatrix &operator+=(const MatExpr<E> &e) { return *this = *this + e; }
+
+    template<typename E>
+    SymMatrix &operator-=(const MatExpr<E> &e) { return *this = *this - e; }
+
+    T &operator()(size_t r, size_t c) { return s[index(r, c)]; }
+    const T &operator()(size_t r, size_t c) const { return s[index(r, c)]; }
+
+    static SymMatrix identity()
+    {
+        SymMatrix result;
+        for(size_t i = 0; i < N; i++)
+        {
+            result(i, i) = T(1);
+        }
+        return result;
+    }
+
+    static SymMatrix diagonal(T v)
+    {
+        SymMatrix result;
+        for(size_t i = 0; i < N; i++)
+        {
+            result(i, i) = v;
+        }
+        return result;
+    }
+
+    const SymMatrix &transpose() const { return *this; }
+
+    // Element (r, c) and (c, r) are the same storage, so any read of it aliases
+    bool reads(const void *p) const { return p == this; }
+    bool aliases(const void *) const { return false; }
+
+private:
+    static constexpr size_t index(size_t r, size_t c)
+    {
+        return r <= c ? r * N - r * (r - 1U) / 2U + (c - r) : index(c, r);
+    }
+
+    template<typename E>
+    void assignDirect(const E &e)
+    {
+        static_assert(E::ROWS == N && E::COLS == N, "assigned expression differs in size");
+        size_t i = 0;
+        MATRIX_UNROLL
+        for(size_t r = 0; r < N; r++)
+        {
+            MATRIX_UNROLL
+            for(size_t c = r; c < N; c++)
+            {
+                s[i++] = e(r, c);
+            }
+        }
+    }
+
+    T s[STORED] = {};
+};
+
+template<typename A, typename B>
+matrix_detail::Elementwise<matrix_detail::Add, A, B> operator+(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return matrix_detail::Elementwise<matrix_detail::Add, A, B>(a.self(), b.self());
+}
+
+template<typename A, typename B>
+matrix_detail::Elementwise<matrix_detail::Subtract, A, B> operator-(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return matrix_detail::Elementwise<matrix_detail::Subtract, A, B>(a.self(), b.self());
+}
+
+template<typename A>
+matrix_detail::Scaled<A> operator*(typename A::Scalar k, const MatExpr<A> &a)
+{
+    return matrix_detail::Scaled<A>(a.self(), k);
+}
+
+template<typename A>
+matrix_detail::Scaled<A> operator*(const MatExpr<A> &a, typename A::Scalar k)
+{
+    return matrix_detail::Scaled<A>(a.self(), k);
+}
+
+template<typename A>
+matrix_detail::Scaled<A> operator-(const MatExpr<A> &a)
+{
+    return matrix_detail::Scaled<A>(a.self(), typename A::Scalar(-1));
+}
+
+template<typename A, typename B>
+matrix_detail::Product<A, B> operator*(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return matrix_detail::Product<A, B>(a.self(), b.self());
+}
+
+template<typename A>
+matrix_detail::Transposed<A> transpose(const MatExpr<A> &a)
+{
+    return matrix_detail::Transposed<A>(a.self());
+}
+
+/**
+ * @brief a . b of two vectors
+ */
+template<typename T, size_t N>
+T dot(const Vector<T, N> &a, const Vector<T, N> &b)
+{
+    T sum = a[0] * b[0];
+    MATRIX_UNROLL
+    for(size_t i = 1; i < N; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief A S A' with S symmetric, the upper triangle only
+ */
+template<typename T, size_t M, size_t N>
+SymMatrix<T, M> quadraticForm(const Matrix<T, M, N> &a, const SymMatrix<T, N> &s)
+{
+    // Unpacked once so the rows of A S build up as independent sums of rows of S
+    Matrix<T, N, N> full = s;
+    Matrix<T, M, N> as;
+    MATRIX_UNROLL
+    for(size_t r = 0; r < M; r++)
+    {
+        for(size_t k = 0; k < N; k++)
+        {
+            T ark = a(r, k);
+            MATRIX_UNROLL
+            for(size_t c = 0; c < N; c++)
+            {
+                as(r, c) += ark * full(k, c);
+            }
+        }
+    }
+    SymMatrix<T, M> result;
+    MATRIX_UNROLL
+    for(size_t r = 0; r < M; r++)
+    {
+        MATRIX_UNROLL
+        for(size_t c = r; c < M; c++)
+        {
+            T sum = as(r, 0) * a(c, 0);
+            MATRIX_UNROLL
+            for(size_t k = 1; k < N; k++)
+            {
+                sum += as(r, k) * a(c, k);
+            }
+            result(r, c) = sum;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief S += k v v', the upper triangle only
+ */
+template<typename T, size_t N>
+void addOuter(SymMatrix<T, N> &s, const Vector<T, N> &v, T k)
+{
+    MATRIX_UNROLL
+    for(size_t r = 0; r < N; r++)
+    {
+        T kv = k * v[r];
+        MATRIX_UNROLL
+        for(size_t c = r; c < N; c++)
+        {
+            s(r, c) += kv * v[c];
+        }
+    }
+}
+
+/**
+ * @brief S = L L' for S positive definite, L lower triangular
+ * @retval false if S is not positive definite, L is then incomplete
+ */
+template<typename T, size_t N>
+bool cholesky(const SymMatrix<T, N> &s, Matrix<T, N, N> &l)
+{
+    l = Matrix<T, N, N>::zero();
+    MATRIX_UNROLL
+    for(size_t c = 0; c < N; c++)
+    {
+        T d = s(c, c);
+        MATRIX_UNROLL
+        for(size_t k = 0; k < c; k++)
+        {
+            d -= l(c, k) * l(c, k);
+        }
+        if(!(d > T(0)))
+        {
+            return false;
+        }
+        T root = matrix_detail::root(d);
+        T inverse = T(1) / root;
+        l(c, c) = root;
+        MATRIX_UNROLL
+        for(size_t r = c + 1U; r < N; r++)
+        {
+            T v = s(r, c);
+            MATRIX_UNROLL
+            for(size_t k = 0; k < c; k++)
+            {
+                v -= l(r, k) * l(c, k);
+            }
+            l(r, c) = v * inverse;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief X = (L L')^-1 B in place, column by column
+ * @param l Factor from cholesky()
+ */
+template<typename T, size_t N, size_t K>
+void choleskySolve(const Matrix<T, N, N> &l, Matrix<T, N, K> &b)
+{
+    MATRIX_UNROLL
+    for(size_t j = 0; j < K; j++)
+    {
+        // L y = b
+        MATRIX_UNROLL
+        for(size_t r = 0; r < N; r++)
+        {
+            T v = b(r, j);
+            MATRIX_UNROLL
+            for(size_t k = 0; k < r; k++)
+            {
+                v -= l(r, k) * b(k, j);
+            }
+            b(r, j) = v / l(r, r);
+        }
+        // L' x = y
+        MATRIX_UNROLL
+        for(size_t i = 0; i < N; i++)
+        {
+            size_t r = N - 1U - i;
+            T v = b(r, j);
+            MATRIX_UNROLL
+            for(size_t k = r + 1U; k < N; k++)
+            {
+                v -= l(k, r) * b(k, j);
+            }
+            b(r, j) = v / l(r, r);
+        }
+    }
+}
+
+#endif /* MATRIX_H */
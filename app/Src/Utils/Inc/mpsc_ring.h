@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file           : mpsc_ring.h
+  * @brief          : Lock-free bounded queue, many producers and one consumer
+  ******************************************************************************
+  * Every cell carries a sequence number telling whether it is free for the
+  * producer at a given position or holds the item for the consumer at that
+  * position. Producers claim a position with a compare-and-swap and publish
+  * the item by bumping the sequence, so an interrupt that preempts another
+  * producer never waits for it: it claims the next cell. The consumer stops
+  * at a cell that is claimed but not yet published and picks it up on its
+  * next pass. Nothing blocks and nothing is allocated; on Cortex-M the
+  * atomics compile to LDREX/STREX.
+  ******************************************************************************
+  */
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+template <typename T, size_t N>
+class MpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing size must be a power of two");
+
+public:
+    MpscRing()
+    {
+        for(size_t i = 0; i < N; i++)
+        {
+            cells[i].sequence.store((uint32_t)i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Append an item, safe from any task or interrupt
+     * @retval false if the ring is full
+     */
+    bool push(const T &item)
+    {
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for(;;)
+        {
+            cell = &cells[pos & (N - 1U)];
+            int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+            if(diff == 0)
+            {
+                if(enqueuePos.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = item;
+        cell->sequence.store(pos + 1U, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest published item, consumer only
+     * @retval false if empty or the oldest item is still being written
+     */
+    bool pop(T &item)
+    {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell &cell = cells[pos & (N - 1U)];
+        if((int32_t)(cell.sequence.load(std::memory_order_acquire) - (pos + 1U)) < 0)
+        {
+            return false;
+        }
+
+        item = cell.value;
+        cell.sequence.store(pos + (uint32_t)N, std::memory_order_release);
+        dequeuePos.store(pos + 1U, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Claimed items not consumed yet, a snapshot when producers are active
+     */
+    size_t size() const
+    {
+        return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+
+    Cell cells[N];
+    std::atomic<uint32_t> enqueuePos{0};
+    std::atomic<uint32_t> dequeuePos{0};
+};
+
+#endif /* MPSC_RING_H */
@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file           : nn_kernels.h
+  * @brief          : Int8 quantised inference kernels
+  ******************************************************************************
+  * Activations are int8 with a scale and zero point per tensor, laid out
+  * position-major ([length][channels]) so the window of a 1-D convolution
+  * is one contiguous run of memory. Weights are int8 and symmetric per
+  * output channel (zero point 0), which lets the input zero point be folded
+  * into the int32 bias ahead of time (see nn_quantizer.h): every kernel is
+  * then a plain int8 dot product plus a bias, and no offset is added per
+  * element at run time.
+  *
+  * On cores with the DSP extension the dot product takes four weights and
+  * four activations per pair of word loads, sign-extends them in pairs
+  * (SXTB16) and accumulates two products per instruction (SMLAD). Other
+  * builds, the host included, run the same arithmetic byte by byte and
+  * produce identical results.
+  *
+  * Accumulators are brought back to int8 with a Q31 multiplier and a
+  * power-of-two shift per output channel, rounded, offset by the output
+  * zero point and clamped to the activation range; a fused ReLU is only a
+  * raised lower clamp.
+  ******************************************************************************
+  */
+
+#ifndef NN_KERNELS_H
+#define NN_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum NnOp : uint8_t
+{
+    NN_OP_DENSE = 0,            // Fully connected over the flattened input
+    NN_OP_CONV1D,               // Valid 1-D convolution, weights [filters][kernel][channels]
+    NN_OP_DEPTHWISE_CONV1D,     // One filter per channel, weights [kernel][channels]
+    NN_OP_MAX_POOL1D,
+    NN_OP_AVG_POOL1D,           // Input and output share their quantisation
+};
+
+/**
+ * @brief Accumulator to int8, per output channel
+ */
+struct NnRequant
+{
+    const int32_t *multiplier;  // Q31, in [0.5, 1)
+    const int8_t *shift;        // Left shift after the multiplier, negative for right
+    int32_t outZero;
+    int8_t min;                 // Activation clamp, min == outZero for a fused ReLU
+    int8_t max;
+};
+
+/**
+ * @brief Sum of a[i] * b[i]
+ */
+int32_t nnDot(const int8_t *a, const int8_t *b, size_t n);
+
+/**
+ * @brief One accumulator of output channel c to int8
+ */
+inline int8_t nnRequantize(int32_t acc, const NnRequant &rq, size_t c)
+{
+    // (acc * multiplier) >> (31 - shift) with round half up; shift stays in -31..30
+    int total = 31 - rq.shift[c];
+    int64_t product = (int64_t)acc * rq.multiplier[c];
+    int64_t v = (product + ((int64_t)1 << (total - 1))) >> total;
+    v += rq.outZero;
+    return v < rq.min ? rq.min : v > rq.max ? rq.max : (int8_t)v;
+}
+
+/**
+ * @brief Positions out of a valid convolution or pooling window
+ */
+constexpr size_t nnOutLength(size_t length, size_t kernel, size_t stride)
+{
+    return length < kernel || stride == 0 ? 0 : (length - kernel) / stride + 1U;
+}
+
+/**
+ * @brief Fully connected layer
+ * @param in size activations
+ * @param weights [outputs][size]
+ * @param bias outputs entries, input zero point folded in
+ */
+void nnDense(const int8_t *in, size_t size, const int8_t *weights, const int32_t *bias,
+             size_t outputs, const NnRequant &rq, int8_t *out);
+
+/**
+ * @brief Valid 1-D convolution
+ * @param in [length][channels]
+ * @param weights [filters][kernel][channels]
+ * @param out [nnOutLength(length, kernel, stride)][filters]
+ */
+void nnConv1d(const int8_t *in, size_t length, size_t channels, const int8_t *weights, const int32_t *bias,
+              size_t filters, size_t kernel, size_t stride, const NnRequant &rq, int8_t *out);
+
+/**
+ * @brief Valid depthwise 1-D convolution, one filter per channel
+ * @param weights [kernel][channels]
+ * @param out [nnOutLength(length, kernel, stride)][channels]
+ */
+void nnDepthwiseConv1d(const int8_t *in, size_t length, size_t channels, const int8_t *weights, const int32_t *bias,
+                       size_t kernel, size_t stride, const NnRequant &rq, int8_t *out);
+
+void nnMaxPool1d(const int8_t *in, size_t length, size_t channels, size_t pool, size_t stride, int8_t *out);
+
+/**
+ * @brief Average pooling, rounded to nearest
+ */
+void nnAvgPool1d(const int8_t *in, size_t length, size_t channels, size_t pool, size_t stride, int8_t *out);
+
+#endif /* NN_KERNELS_H */
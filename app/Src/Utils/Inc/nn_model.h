@@ -0,0 +1,202 @@
+/**
+  ******************************************************************************
+  * @file           : nn_model.h
+  * @brief          : Layer chains of int8 kernels with an arena planned at compile time
+  ******************************************************************************
+  * A model is a constant table of layers, each reading the tensor the one
+  * before it wrote. The converter (host/nn) emits the table, the weights
+  * and the quantisation parameters as a header of constant arrays that
+  * stay in flash.
+  *
+  * The activations live in one arena. Tensor t is the input of layer t
+  * (tensor 0 the model input, the last one its output) and is live from
+  * the layer that writes it to the layer that reads it. nnPlanArena gives
+  * every tensor an offset, largest first at the lowest offset clear of the
+  * tensors live at the same time, so that each layer's input and output
+  * never overlap while tensors further apart share memory. The plan is a
+  * constant expression: the arena is a static array sized by the compiler
+  * and a model that does not fit fails the build, not the device.
+  *
+  *   constexpr auto PLAN = nnPlanArena(LAYERS);
+  *   alignas(4) static uint8_t arena[PLAN.size];
+  ******************************************************************************
+  */
+
+#ifndef NN_MODEL_H
+#define NN_MODEL_H
+
+#include "nn_kernels.h"
+
+#define NN_ARENA_ALIGN  4U
+
+struct NnLayer
+{
+    NnOp op;
+    uint16_t length;        // Input positions
+    uint16_t channels;      // Input channels
+    uint16_t outChannels;   // Filters or outputs; equal to channels for depthwise and pooling
+    uint8_t kernel;         // Taps or pool width, 1 for dense
+    uint8_t stride;
+    const int8_t *weights;  // NULL for pooling
+    const int32_t *bias;
+    NnRequant requant;
+};
+
+constexpr size_t nnOutLength(const NnLayer &layer)
+{
+    return layer.op == NN_OP_DENSE ? 1U : nnOutLength(layer.length, layer.kernel, layer.stride);
+}
+
+constexpr uint32_t nnInputBytes(const NnLayer &layer)
+{
+    return (uint32_t)layer.length * layer.channels;
+}
+
+constexpr uint32_t nnOutputBytes(const NnLayer &layer)
+{
+    return (uint32_t)nnOutLength(layer) * layer.outChannels;
+}
+
+/**
+ * @brief Every layer produces what the next one reads
+ */
+constexpr bool nnChainValid(const NnLayer *layers, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        const NnLayer &layer = layers[i];
+        if(nnOutputBytes(layer) == 0 || (layer.op >= NN_OP_DEPTHWISE_CONV1D && layer.outChannels != layer.channels))
+        {
+            return false;
+        }
+        if(i + 1U < count && nnInputBytes(layers[i + 1U]) != nnOutputBytes(layer))
+        {
+            return false;
+        }
+    }
+    return count != 0;
+}
+
+/**
+ * @brief Bytes of tensor t of a chain of count layers
+ */
+constexpr uint32_t nnTensorBytes(const NnLayer *layers, size_t count, size_t t)
+{
+    return t < count ? nnInputBytes(layers[t]) : nnOutputBytes(layers[count - 1U]);
+}
+
+/**
+ * @brief Greedy offsets for the count + 1 tensors of a chain
+ * @param offsets Destination, count + 1 entries
+ * @retval Arena bytes
+ */
+constexpr uint32_t nnPlanOffsets(const NnLayer *layers, size_t count, uint32_t *offsets)
+{
+    constexpr uint32_t UNPLACED = 0xFFFFFFFFU;
+    size_t tensors = count + 1U;
+    for(size_t t = 0; t < tensors; t++)
+    {
+        offsets[t] = UNPLACED;
+    }
+
+    uint32_t arena = 0;
+    for(size_t placed = 0; placed < tensors; placed++)
+    {
+        // Largest tensor left, the earlier one on a tie
+        size_t next = tensors;
+        for(size_t t = 0; t < tensors; t++)
+        {
+            if(offsets[t] == UNPLACED && (next == tensors || nnTensorBytes(layers, count, t) > nnTensorBytes(layers, count, next)))
+            {
+                next = t;
+            }
+        }
+        uint32_t bytes = (nnTensorBytes(layers, count, next) + NN_ARENA_ALIGN - 1U) & ~(NN_ARENA_ALIGN - 1U);
+
+        // Tensors t and u are live together when one layer touches both, i.e. they are neighbours
+        uint32_t offset = 0;
+        bool moved = true;
+        while(moved)
+        {
+            moved = false;
+            for(size_t u = 0; u < tensors; u++)
+            {
+                bool neighbour = u + 1U == next || next + 1U == u;
+                if(!neighbour || offsets[u] == UNPLACED)
+                {
+                    continue;
+                }
+                uint32_t start = offsets[u];
+                uint32_t end = start + ((nnTensorBytes(layers, count, u) + NN_ARENA_ALIGN - 1U) & ~(NN_ARENA_ALIGN - 1U));
+                if(offset < end && start < offset + bytes)
+                {
+                    offset = end;
+                    moved = true;
+                }
+            }
+        }
+        offsets[next] = offset;
+        arena = offset + bytes > arena ? offset + bytes : arena;
+    }
+    return arena;
+}
+
+template<size_t L>
+struct NnArenaPlan
+{
+    uint32_t offset[L + 1U];    // Tensor t starts at arena + offset[t]
+    uint32_t size;
+};
+
+template<size_t L>
+constexpr NnArenaPlan<L> nnPlanArena(const NnLayer (&layers)[L])
+{
+    NnArenaPlan<L> plan = {};
+    plan.size = nnPlanOffsets(layers, L, plan.offset);
+    return plan;
+}
+
+struct NnModel
+{
+    const NnLayer *layers;
+    size_t count;
+    const uint32_t *offsets;
+    uint32_t arenaSize;
+    float inputScale;
+    int32_t inputZero;
+    float outputScale;
+    int32_t outputZero;
+};
+
+/**
+ * @brief Where the caller writes the quantised input
+ */
+inline int8_t *nnInput(const NnModel &model, uint8_t *arena)
+{
+    return reinterpret_cast<int8_t *>(arena + model.offsets[0]);
+}
+
+inline const int8_t *nnOutput(const NnModel &model, const uint8_t *arena)
+{
+    return reinterpret_cast<const int8_t *>(arena + model.offsets[model.count]);
+}
+
+int8_t nnQuantize(float value, float scale, int32_t zero);
+
+inline float nnDequantize(int8_t value, float scale, int32_t zero)
+{
+    return ((int32_t)value - zero) * scale;
+}
+
+/**
+ * @brief Run every layer over the input in the arena
+ * @param arena model.arenaSize bytes, NN_ARENA_ALIGN aligned, input already written
+ */
+void nnInvoke(const NnModel &model, uint8_t *arena);
+
+/**
+ * @brief Index of the largest output, the class of a classifier
+ */
+size_t nnArgMax(const NnModel &model, const uint8_t *arena);
+
+#endif /* NN_MODEL_H */
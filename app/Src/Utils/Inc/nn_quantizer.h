@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file           : nn_quantizer.h
+  * @brief          : Float layers to the int8 form of nn_model.h
+  ******************************************************************************
+  * Post-training quantisation as the model converter does it:
+  *
+  *   - activations asymmetric over their calibrated range, widened to
+  *     include 0 so that zero padding and ReLU are exact;
+  *   - weights symmetric per output channel, scale max|w| / 127;
+  *   - biases int32 in units of input scale times weight scale, minus
+  *     the input zero point times the channel's weight sum, which is the
+  *     offset the kernels leave out;
+  *   - requantisation by a Q31 multiplier and shift per output channel.
+  *
+  * Pooling layers do not rescale: their output takes the input's scale and
+  * zero point.
+  ******************************************************************************
+  */
+
+#ifndef NN_QUANTIZER_H
+#define NN_QUANTIZER_H
+
+#include "nn_model.h"
+#include "nn_reference.h"
+
+struct NnTensorQuant
+{
+    float scale;
+    int32_t zero;
+};
+
+/**
+ * @brief Scale and zero point covering min..max and 0
+ */
+NnTensorQuant nnChooseQuant(float min, float max);
+
+/**
+ * @brief real as multiplier * 2^(shift - 31), multiplier in [2^30, 2^31)
+ */
+void nnQuantizeMultiplier(double real, int32_t *multiplier, int8_t *shift);
+
+/**
+ * @brief Quantise one layer
+ * @param in Quantisation of the layer input
+ * @param out Quantisation of its output, the input's for pooling
+ * @param weights nnWeightCount(src) entries
+ * @param bias, multiplier, shift nnBiasCount(src) entries each
+ * @param dst Points at the arrays above
+ * @retval false for a pooling layer asked to change the quantisation
+ */
+bool nnQuantizeLayer(const NnFloatLayer &src, NnTensorQuant in, NnTensorQuant out,
+                     int8_t *weights, int32_t *bias, int32_t *multiplier, int8_t *shift, NnLayer &dst);
+
+#endif /* NN_QUANTIZER_H */
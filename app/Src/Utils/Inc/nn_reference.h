@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : nn_reference.h
+  * @brief          : Float reference of the nn_kernels.h layers
+  ******************************************************************************
+  * The same layers in float with the same layouts, for the model converter
+  * to calibrate activation ranges and for the host tests to check the int8
+  * kernels against. Not meant for the target, where it would take four
+  * times the memory of the int8 model.
+  ******************************************************************************
+  */
+
+#ifndef NN_REFERENCE_H
+#define NN_REFERENCE_H
+
+#include "nn_kernels.h"
+
+struct NnFloatLayer
+{
+    NnOp op;
+    uint16_t length;
+    uint16_t channels;
+    uint16_t outChannels;
+    uint8_t kernel;
+    uint8_t stride;
+    bool relu;
+    const float *weights;   // Layouts of nn_kernels.h
+    const float *bias;
+};
+
+constexpr size_t nnOutLength(const NnFloatLayer &layer)
+{
+    return layer.op == NN_OP_DENSE ? 1U : nnOutLength(layer.length, layer.kernel, layer.stride);
+}
+
+constexpr size_t nnOutputSize(const NnFloatLayer &layer)
+{
+    return nnOutLength(layer) * layer.outChannels;
+}
+
+/**
+ * @brief Weights of the layer, 0 for pooling
+ */
+constexpr size_t nnWeightCount(const NnFloatLayer &layer)
+{
+    return layer.op == NN_OP_DENSE ? (size_t)layer.outChannels * layer.length * layer.channels
+         : layer.op == NN_OP_CONV1D ? (size_t)layer.outChannels * layer.kernel * layer.channels
+         : layer.op == NN_OP_DEPTHWISE_CONV1D ? (size_t)layer.kernel * layer.channels
+         : 0U;
+}
+
+/**
+ * @brief Biases of the layer, one per output channel, 0 for pooling
+ */
+constexpr size_t nnBiasCount(const NnFloatLayer &layer)
+{
+    return layer.op <= NN_OP_DEPTHWISE_CONV1D ? layer.outChannels : 0U;
+}
+
+/**
+ * @brief One layer in float
+ * @param out nnOutputSize(layer) values
+ */
+void nnReferenceLayer(const NnFloatLayer &layer, const float *in, float *out);
+
+struct NnRange
+{
+    float min;
+    float max;
+};
+
+/**
+ * @brief Values in the largest tensor of a chain, input included
+ */
+size_t nnLargestTensor(const NnFloatLayer *layers, size_t count);
+
+/**
+ * @brief Run a chain of layers in float
+ * @param scratch 2 * nnLargestTensor(layers, count) floats
+ * @param ranges count + 1 entries widened to the values each tensor took, or NULL
+ * @retval The output, inside scratch
+ */
+const float *nnReferenceInvoke(const NnFloatLayer *layers, size_t count, const float *input,
+                               float *scratch, NnRange *ranges);
+
+#endif /* NN_REFERENCE_H */
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file           : nor_flash.h
+  * @brief          : NOR flash device interface shared by drivers and simulators
+  ******************************************************************************
+  * Programming can only clear bits, erasing sets a whole sector to 0xFF.
+  * Devices with a memory-mapped view publish its base so readers can access
+  * data in place without copying.
+  ******************************************************************************
+  */
+
+#ifndef NOR_FLASH_H
+#define NOR_FLASH_H
+
+#include <stdint.h>
+
+struct NorFlash
+{
+    uint32_t size;
+    uint32_t sectorSize;        // Erase granularity
+    uint32_t pageSize;          // Program granularity, writes are split on page boundaries
+    const uint8_t *mapped;      // Memory-mapped view of offset 0, NULL if not available
+
+    bool (*read)(void *ctx, uint32_t address, uint8_t *data, uint32_t length);
+    bool (*program)(void *ctx, uint32_t address, const uint8_t *data, uint32_t length);
+    bool (*eraseSector)(void *ctx, uint32_t address);
+    void *ctx;
+};
+
+#endif /* NOR_FLASH_H */
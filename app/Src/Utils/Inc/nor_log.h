@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file           : nor_log.h
+  * @brief          : Log-structured record storage on NOR flash
+  ******************************************************************************
+  * Records are appended sequentially; when the device is full the oldest
+  * sector is erased and reused. Every sector starts with a header carrying a
+  * sequence number, so the head and tail are recovered by a scan at mount.
+  * Each record has a length and a CRC-16; a torn write is detected by the CRC
+  * and skipped.
+  ******************************************************************************
+  */
+
+#ifndef NOR_LOG_H
+#define NOR_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nor_flash.h"
+
+#define NOR_LOG_SECTOR_HEADER_SIZE  8U
+#define NOR_LOG_RECORD_HEADER_SIZE  4U
+
+struct NorLogRecord
+{
+    uint32_t address;       // Device offset of the payload
+    uint16_t length;
+    bool valid;             // CRC matched
+};
+
+struct NorLogStats
+{
+    uint32_t appendedRecords;
+    uint32_t appendedBytes;
+    uint32_t erasedSectors;
+    uint32_t droppedSectors;    // Sectors reclaimed while still holding records
+    uint32_t corruptRecords;    // Seen by cursors since mount
+};
+
+class NorLog;
+
+class NorLogCursor
+{
+public:
+    /**
+     * @brief Advance to the next record, oldest first
+     * @retval false once past the newest record
+     */
+    bool next(NorLogRecord &record);
+
+private:
+    friend class NorLog;
+
+    NorLog *log = nullptr;
+    uint32_t sectorsLeft = 0;
+    uint32_t sector = 0;
+    uint32_t offset = 0;
+};
+
+class NorLog
+{
+public:
+    /**
+     * @brief Mount the log, formatting the device if no log is found
+     * @retval false on device errors or unusable geometry
+     */
+    bool mount(const NorFlash &device);
+
+    /**
+     * @brief Erase every sector and start an empty log
+     */
+    bool format();
+
+    /**
+     * @brief Append one record
+     * @retval false if the record is too large or the device failed
+     */
+    bool append(const uint8_t *data, uint16_t length);
+
+    NorLogCursor records();
+
+    /**
+     * @brief Copy a record payload into a buffer
+     * @retval Number of bytes copied, 0 on error
+     */
+    uint16_t read(const NorLogRecord &record, uint8_t *data, uint16_t size) const;
+
+    /**
+     * @brief Zero-copy access to a record payload through the mapped view
+     * @retval Pointer into the mapped device, NULL if the device is not mapped
+     */
+    const uint8_t *mapped(const NorLogRecord &record) const;
+
+    uint16_t maxRecordLength() const;
+    NorLogStats stats() const { return counters; }
+
+private:
+    friend class NorLogCursor;
+
+    bool startSector(uint32_t sector, uint32_t sequence);
+    bool readSectorSequence(uint32_t sector, uint32_t &sequence) const;
+    uint32_t scanWriteOffset(uint32_t sector) const;
+    uint32_t sectorAddress(uint32_t sector) const { return sector * device.sectorSize; }
+
+    NorFlash device = {};
+    uint32_t sectorCount = 0;
+    uint32_t tail = 0;
+    uint32_t head = 0;
+    uint32_t headOffset = 0;
+    uint32_t headSequence = 0;
+    NorLogStats counters = {};
+};
+
+#endif /* NOR_LOG_H */
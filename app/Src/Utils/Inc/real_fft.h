@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * @file           : real_fft.h
+  * @brief          : In-place real FFT for float, q15 and q31 samples
+  ******************************************************************************
+  * N real samples are transformed as N/2 complex points (even samples as
+  * the real parts, odd samples as the imaginary ones) by a radix-4
+  * decimation-in-frequency FFT, with one radix-2 stage when log2(N/2) is
+  * odd, followed by the split step that separates the two real spectra.
+  * Everything happens in the sample buffer: no scratch memory, and the
+  * block a DMA transfer just filled can be transformed where it lies.
+  *
+  * Twiddle factors and the bit-reversal swaps are computed by the compiler
+  * and live in flash; nothing is initialised at run time.
+  *
+  * The result is packed like CMSIS-DSP's arm_rfft_fast_f32: data[0] holds
+  * bin 0 (DC), data[1] bin N/2 (Nyquist), both real, and data[2k] and
+  * data[2k + 1] the real and imaginary parts of bin k for 0 < k < N/2.
+  * Float results are unscaled. Fixed-point stages scale their outputs to
+  * stay in range, so q15 and q31 results are divided by N; a full-scale
+  * sine then reads 0.5 in its bin. Sums saturate rather than wrap.
+  ******************************************************************************
+  */
+
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+/**
+ * @brief sin(2 * pi * num / den) for den a multiple of 4, usable in constant expressions
+ */
+constexpr double fftSinTurn(uint32_t num, uint32_t den)
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // Fold into the first quadrant on the integers, where the fold is exact
+    uint32_t quarter = den / 4U;
+    num %= den;
+    if(num >= 2U * quarter)
+    {
+        return -fftSinTurn(num - 2U * quarter, den);
+    }
+    if(num > quarter)
+    {
+        num = 2U * quarter - num;
+    }
+
+    double x = 2.0 * PI * num / den;
+    double term = x;
+    double sum = x;
+    for(int i = 1; i < 14; i++)
+    {
+        term *= -x * x / ((2.0 * i) * (2.0 * i + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double fftCosTurn(uint32_t num, uint32_t den)
+{
+    return fftSinTurn(4U * num + den, 4U * den);
+}
+
+/**
+ * @brief Sample type arithmetic: accumulator width, scaling and saturation
+ */
+template<typename T>
+struct FftTraits;
+
+template<>
+struct FftTraits<float>
+{
+    using Acc = float;
+    static constexpr bool FIXED = false;
+
+    static constexpr float fromDouble(double v) { return (float)v; }
+    static float narrow(Acc v) { return v; }
+    static Acc scale(Acc v, int shift) { (void)shift; return v; }
+    static Acc mul(Acc v, float w) { return v * w; }
+    static Acc half(Acc v) { return v * 0.5f; }
+};
+
+template<typename T, typename A, int FRAC>
+struct FixedFftTraits
+{
+    using Acc = A;
+    static constexpr bool FIXED = true;
+    static constexpr A MAX = (A(1) << FRAC) - 1;
+    static constexpr A MIN = -(A(1) << FRAC);
+
+    static constexpr T fromDouble(double v)
+    {
+        double scaled = v * (double)(A(1) << FRAC);
+        scaled += scaled >= 0.0 ? 0.5 : -0.5;
+        return scaled >= (double)MAX ? (T)MAX : scaled <= (double)MIN ? (T)MIN : (T)(A)scaled;
+    }
+
+    static T narrow(Acc v)
+    {
+        return v > MAX ? (T)MAX : v < MIN ? (T)MIN : (T)v;
+    }
+
+    static Acc scale(Acc v, int shift) { return v >> shift; }
+    static Acc mul(Acc v, T w) { return (v * w) >> FRAC; }
+    static Acc half(Acc v) { return v >> 1; }
+};
+
+template<>
+struct FftTraits<q15_t> : FixedFftTraits<q15_t, int32_t, 15> {};
+
+template<>
+struct FftTraits<q31_t> : FixedFftTraits<q31_t, int64_t, 31> {};
+
+/**
+ * @brief Real FFT of N samples, N a power of two from 16 to 4096
+ */
+template<typename T, size_t N>
+class RealFft
+{
+    static_assert(N >= 16 && N <= 4096 && (N & (N - 1U)) == 0, "N must be a power of two from 16 to 4096");
+
+    using Traits = FftTraits<T>;
+    using Acc = typename Traits::Acc;
+
+    static constexpr size_t M = N / 2U;                 // Complex points
+    static constexpr size_t TWIDDLES = 3U * N / 4U;     // W_N^i, the complex stages use every other one
+
+    static constexpr size_t log2(size_t n) { return n <= 1U ? 0U : 1U + log2(n / 2U); }
+    static constexpr size_t BITS = log2(M);
+
+    static constexpr size_t reverse(size_t i)
+    {
+        size_t r = 0;
+        for(size_t b = 0; b < BITS; b++)
+        {
+            r = (r << 1) | ((i >> b) & 1U);
+        }
+        return r;
+    }
+
+    static constexpr size_t countSwaps()
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < M; i++)
+        {
+            count += i < reverse(i) ? 1U : 0U;
+        }
+        return count;
+    }
+
+    static constexpr size_t SWAPS = countSwaps();
+    using Index = typename std::conditional<(M > 256U), uint16_t, uint8_t>::type;
+
+    struct Tables
+    {
+        T cos[TWIDDLES];
+        T sin[TWIDDLES];
+        Index swap[SWAPS][2];
+    };
+
+    static constexpr Tables makeTables()
+    {
+        Tables tables = {};
+        for(size_t i = 0; i < TWIDDLES; i++)
+        {
+            tables.cos[i] = Traits::fromDouble(fftCosTurn((uint32_t)i, (uint32_t)N));
+            tables.sin[i] = Traits::fromDouble(fftSinTurn((uint32_t)i, (uint32_t)N));
+        }
+        size_t used = 0;
+        for(size_t i = 0; i < M; i++)
+        {
+            if(i < reverse(i))
+            {
+                tables.swap[used][0] = (Index)i;
+                tables.swap[used][1] = (Index)reverse(i);
+                used++;
+            }
+        }
+        return tables;
+    }
+
+    static constexpr Tables tables = makeTables();
+
+    /**
+     * @brief (re + j im) * (cos - j sin), the forward twiddle
+     */
+    static void rotate(Acc re, Acc im, size_t i, T &outRe, T &outIm)
+    {
+        T c = tables.cos[i];
+        T s = tables.sin[i];
+        outRe = Traits::narrow(Traits::mul(re, c) + Traits::mul(im, s));
+        outIm = Traits::narrow(Traits::mul(im, c) - Traits::mul(re, s));
+    }
+
+    static void complexFft(T *z)
+    {
+        size_t length = M;
+
+        // Radix-4 stages; the outputs go to quarters 0, 2, 1, 3 so a plain bit reversal sorts them
+        for(; length >= 4U; length /= 4U)
+        {
+            size_t quarter = length / 4U;
+            size_t stride = 2U * (M / length);      // In W_N steps
+
+            // Packed real samples can have both parts at full scale, a magnitude of sqrt(2):
+            // the first stage takes one more halving than its 1/4 so no rotation saturates
+            int shift = Traits::FIXED ? (length == M ? 3 : 2) : 0;
+            for(size_t k = 0; k < quarter; k++)
+            {
+                for(size_t base = k; base < M; base += length)
+                {
+                    T *x0 = &z[2U * base];
+                    T *x1 = x0 + 2U * quarter;
+                    T *x2 = x1 + 2U * quarter;
+                    T *x3 = x2 + 2U * quarter;
+
+                    Acc ar = (Acc)x0[0] + x2[0], ai = (Acc)x0[1] + x2[1];
+                    Acc br = (Acc)x0[0] - x2[0], bi = (Acc)x0[1] - x2[1];
+                    Acc cr = (Acc)x1[0] + x3[0], ci = (Acc)x1[1] + x3[1];
+                    Acc dr = (Acc)x1[0] - x3[0], di = (Acc)x1[1] - x3[1];
+
+                    Acc y0r = Traits::scale(ar + cr, shift), y0i = Traits::scale(ai + ci, shift);
+                    Acc y2r = Traits::scale(ar - cr, shift), y2i = Traits::scale(ai - ci, shift);
+                    Acc y1r = Traits::scale(br + di, shift), y1i = Traits::scale(bi - dr, shift);
+                    Acc y3r = Traits::scale(br - di, shift), y3i = Traits::scale(bi + dr, shift);
+
+                    x0[0] = Traits::narrow(y0r);
+                    x0[1] = Traits::narrow(y0i);
+                    if(k == 0)
+                    {
+                        x1[0] = Traits::narrow(y2r);
+                        x1[1] = Traits::narrow(y2i);
+                        x2[0] = Traits::narrow(y1r);
+                        x2[1] = Traits::narrow(y1i);
+                        x3[0] = Traits::narrow(y3r);
+                        x3[1] = Traits::narrow(y3i);
+                    }
+                    else
+                    {
+                        rotate(y2r, y2i, 2U * k * stride, x1[0], x1[1]);
+                        rotate(y1r, y1i, k * stride, x2[0], x2[1]);
+                        rotate(y3r, y3i, 3U * k * stride, x3[0], x3[1]);
+                    }
+                }
+            }
+        }
+
+        // log2(M) odd: a last radix-2 stage, its twiddles are all 1
+        if(length == 2U)
+        {
+            constexpr int shift = Traits::FIXED ? 1 : 0;
+            for(size_t base = 0; base < M; base += 2U)
+            {
+                T *x0 = &z[2U * base];
+                T *x1 = x0 + 2U;
+                Acc sr = (Acc)x0[0] + x1[0], si = (Acc)x0[1] + x1[1];
+                Acc dr = (Acc)x0[0] - x1[0], di = (Acc)x0[1] - x1[1];
+                x0[0] = Traits::narrow(Traits::scale(sr, shift));
+                x0[1] = Traits::narrow(Traits::scale(si, shift));
+                x1[0] = Traits::narrow(Traits::scale(dr, shift));
+                x1[1] = Traits::narrow(Traits::scale(di, shift));
+            }
+        }
+
+        for(size_t i = 0; i < SWAPS; i++)
+        {
+            T *a = &z[2U * tables.swap[i][0]];
+            T *b = &z[2U * tables.swap[i][1]];
+            T re = a[0], im = a[1];
+            a[0] = b[0];
+            a[1] = b[1];
+            b[0] = re;
+            b[1] = im;
+        }
+    }
+
+    /**
+     * @brief Separate the spectra of the even and odd samples into the real spectrum
+     */
+    static void split(T *data)
+    {
+        // Bin 0 and the Nyquist bin are real, they share the first pair
+        Acc z0r = data[0];
+        Acc z0i = data[1];
+        data[0] = Traits::narrow(z0r + z0i);
+        data[1] = Traits::narrow(z0r - z0i);
+
+        // Bins k and M - k come from the same two points: X[k] = E - jWO, X[M-k] = conj(E) - j conj(WO)
+        for(size_t k = 1; k <= M / 2U; k++)
+        {
+            T *a = &data[2U * k];
+            T *b = &data[2U * (M - k)];
+            Acc er = Traits::half((Acc)a[0] + b[0]);
+            Acc ei = Traits::half((Acc)a[1] - b[1]);
+            Acc orr = Traits::half((Acc)a[0] - b[0]);
+            Acc oi = Traits::half((Acc)a[1] + b[1]);
+
+            T c = tables.cos[k];
+            T s = tables.sin[k];
+            Acc pr = Traits::mul(orr, c) + Traits::mul(oi, s);
+            Acc pi = Traits::mul(oi, c) - Traits::mul(orr, s);
+
+            a[0] = Traits::narrow(er + pi);
+            a[1] = Traits::narrow(ei - pr);
+            if(b != a)
+            {
+                b[0] = Traits::narrow(er - pi);
+                b[1] = Traits::narrow(-ei - pr);
+            }
+        }
+    }
+
+public:
+    static constexpr size_t SIZE = N;
+    static constexpr size_t BINS = N / 2U + 1U;     // DC to Nyquist
+
+    /**
+     * @brief Forward transform in place
+     * @param data N samples in, the packed spectrum out
+     */
+    static void forward(T *data)
+    {
+        complexFft(data);
+        split(data);
+    }
+
+    /**
+     * @brief Flash taken by the constant tables
+     */
+    static constexpr size_t tableBytes() { return sizeof(Tables); }
+};
+
+#endif /* REAL_FFT_H */
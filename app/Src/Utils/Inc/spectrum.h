@@ -0,0 +1,295 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.h
+  * @brief          : Windowing, magnitudes and band energies around real_fft.h
+  ******************************************************************************
+  * The steps of a spectral block, all in place or into caller buffers:
+  *
+  *   spectrumLoadAdc     raw ADC codes of a DMA block to signed samples
+  *   SpectrumWindow      taper against leakage, tables built by the compiler
+  *   RealFft::forward    the transform
+  *   spectrumPower       squared magnitude per bin, DC to Nyquist
+  *   spectrumMagnitude   magnitude per bin
+  *   spectrumBandEnergy  power summed over bin ranges, e.g. bearing bands
+  *
+  * Fixed-point powers keep the q15/q31 scale of the bins: q15 gives Q30 in
+  * 32 bits, q31 gives Q31 in 64 bits so that band sums cannot overflow.
+  * Windows reduce the level of a bin by their coherent gain and the energy
+  * of broadband noise by their power gain; both are given to correct for.
+  ******************************************************************************
+  */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "real_fft.h"
+
+#include <math.h>
+
+enum SpectrumWindowKind : uint8_t
+{
+    SPECTRUM_WINDOW_HANN = 0,           // General purpose
+    SPECTRUM_WINDOW_HAMMING,            // Narrower main lobe, higher far sidelobes
+    SPECTRUM_WINDOW_BLACKMAN_HARRIS,    // -92 dB sidelobes, for small tones next to large ones
+    SPECTRUM_WINDOW_FLAT_TOP,           // Amplitude accurate to 0.01 dB between bins
+};
+
+struct SpectrumBand
+{
+    uint16_t first;     // First bin
+    uint16_t last;      // One past the last bin
+};
+
+/**
+ * @brief Power and energy types per sample type
+ */
+template<typename T>
+struct SpectrumTraits;
+
+template<>
+struct SpectrumTraits<float>
+{
+    using Power = float;
+    using Energy = float;
+    static Power power(float re, float im) { return re * re + im * im; }
+    static float magnitude(float re, float im) { return sqrtf(re * re + im * im); }
+};
+
+/**
+ * @brief Integer square root, rounded down
+ */
+inline uint64_t spectrumIsqrt(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while(bit > v)
+    {
+        bit >>= 2;
+    }
+    while(bit != 0)
+    {
+        if(v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+template<>
+struct SpectrumTraits<q15_t>
+{
+    using Power = uint32_t;     // Q30
+    using Energy = uint64_t;
+    static Power power(q15_t re, q15_t im) { return (uint32_t)((int32_t)re * re) + (uint32_t)((int32_t)im * im); }
+    static q15_t magnitude(q15_t re, q15_t im)
+    {
+        uint64_t root = spectrumIsqrt(power(re, im));
+        return root > 0x7FFFU ? (q15_t)0x7FFF : (q15_t)root;
+    }
+};
+
+template<>
+struct SpectrumTraits<q31_t>
+{
+    using Power = uint64_t;     // Q31
+    using Energy = uint64_t;
+    static uint64_t exact(q31_t re, q31_t im) { return (uint64_t)((int64_t)re * re) + (uint64_t)((int64_t)im * im); }
+    static Power power(q31_t re, q31_t im) { return exact(re, im) >> 31; }
+    static q31_t magnitude(q31_t re, q31_t im)
+    {
+        uint64_t root = spectrumIsqrt(exact(re, im));
+        return root > 0x7FFFFFFFU ? (q31_t)0x7FFFFFFF : (q31_t)root;
+    }
+};
+
+/**
+ * @brief Cosine-sum window of N points, periodic so it tiles the FFT frame
+ */
+template<typename T, size_t N, SpectrumWindowKind KIND>
+class SpectrumWindow
+{
+    static_assert(N >= 4 && (N & (N - 1U)) == 0, "N must be a power of two");
+
+    static constexpr size_t HALF = N / 2U + 1U;    // w[n] == w[N - n], the table stops at the middle
+
+    static constexpr double coefficient(size_t i)
+    {
+        constexpr double coefficients[4][5] = {
+            {0.5, 0.5, 0.0, 0.0, 0.0},
+            {0.54, 0.46, 0.0, 0.0, 0.0},
+            {0.35875, 0.48829, 0.14128, 0.01168, 0.0},
+            {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368},
+        };
+        return coefficients[KIND][i];
+    }
+
+    static constexpr double value(size_t n)
+    {
+        double w = 0.0;
+        double sign = 1.0;
+        for(size_t i = 0; i < 5U; i++)
+        {
+            w += sign * coefficient(i) * fftCosTurn((uint32_t)(i * n), (uint32_t)N);
+            sign = -sign;
+        }
+        return w;
+    }
+
+    struct Table
+    {
+        T w[HALF];
+        double sum;
+        double squares;
+    };
+
+    static constexpr Table makeTable()
+    {
+        Table table = {};
+        for(size_t n = 0; n < N; n++)
+        {
+            double w = value(n);
+            if(n < HALF)
+            {
+                table.w[n] = FftTraits<T>::fromDouble(w);
+            }
+            table.sum += w;
+            table.squares += w * w;
+        }
+        return table;
+    }
+
+    static constexpr Table table = makeTable();
+
+public:
+    /**
+     * @brief Mean of the window: a tone in a bin reads this much of its level
+     */
+    static constexpr double coherentGain() { return table.sum / N; }
+
+    /**
+     * @brief Mean square of the window: broadband energy reads this much of its value
+     */
+    static constexpr double powerGain() { return table.squares / N; }
+
+    static constexpr T at(size_t n) { return table.w[n < HALF ? n : N - n]; }
+
+    /**
+     * @brief Multiply a frame by the window in place
+     */
+    static void apply(T *data)
+    {
+        using Acc = typename FftTraits<T>::Acc;
+        data[0] = FftTraits<T>::narrow(FftTraits<T>::mul((Acc)data[0], table.w[0]));
+        for(size_t n = 1; n < HALF; n++)
+        {
+            T w = table.w[n];
+            data[n] = FftTraits<T>::narrow(FftTraits<T>::mul((Acc)data[n], w));
+            if(n != N - n)
+            {
+                data[N - n] = FftTraits<T>::narrow(FftTraits<T>::mul((Acc)data[N - n], w));
+            }
+        }
+    }
+};
+
+/**
+ * @brief Right-aligned unsigned ADC codes to q15 samples in place, mid-scale becomes 0
+ * @param codes DMA block, reused for the samples
+ * @param bits ADC resolution, 8 to 16
+ * @retval The same memory as samples
+ */
+inline q15_t *spectrumLoadAdc(uint16_t *codes, size_t count, uint8_t bits)
+{
+    uint32_t mid = 1UL << (bits - 1U);
+    uint8_t shift = (uint8_t)(16U - bits);
+    q15_t *samples = reinterpret_cast<q15_t *>(codes);
+    for(size_t i = 0; i < count; i++)
+    {
+        samples[i] = (q15_t)(((int32_t)codes[i] - (int32_t)mid) * (1L << shift));
+    }
+    return samples;
+}
+
+/**
+ * @brief Right-aligned unsigned ADC codes to float samples in -1..1
+ */
+inline void spectrumLoadAdc(const uint16_t *codes, float *samples, size_t count, uint8_t bits)
+{
+    float mid = (float)(1UL << (bits - 1U));
+    float scale = 1.0f / mid;
+    for(size_t i = 0; i < count; i++)
+    {
+        samples[i] = ((float)codes[i] - mid) * scale;
+    }
+}
+
+/**
+ * @brief Squared magnitude of the N/2 + 1 bins of a packed spectrum
+ * @param packed Output of RealFft<T, N>::forward
+ * @param power Destination, N/2 + 1 entries
+ */
+template<typename T>
+void spectrumPower(const T *packed, size_t n, typename SpectrumTraits<T>::Power *power)
+{
+    power[0] = SpectrumTraits<T>::power(packed[0], 0);
+    power[n / 2U] = SpectrumTraits<T>::power(packed[1], 0);
+    for(size_t k = 1; k < n / 2U; k++)
+    {
+        power[k] = SpectrumTraits<T>::power(packed[2U * k], packed[2U * k + 1U]);
+    }
+}
+
+/**
+ * @brief Magnitude of the N/2 + 1 bins of a packed spectrum
+ * @param packed Output of RealFft<T, N>::forward
+ * @param magnitude Destination, N/2 + 1 entries; may be the packed buffer itself
+ */
+template<typename T>
+void spectrumMagnitude(T *packed, size_t n, T *magnitude)
+{
+    // Bin k reads slots 2k and 2k + 1, so writing bin k to slot k never overwrites an unread bin
+    T nyquist = packed[1];
+    magnitude[0] = SpectrumTraits<T>::magnitude(packed[0], 0);
+    for(size_t k = 1; k < n / 2U; k++)
+    {
+        magnitude[k] = SpectrumTraits<T>::magnitude(packed[2U * k], packed[2U * k + 1U]);
+    }
+    magnitude[n / 2U] = SpectrumTraits<T>::magnitude(nyquist, 0);
+}
+
+/**
+ * @brief Sum of the power over each band
+ * @param power Output of spectrumPower, bins bins
+ * @param energy Destination, one per band; bands reaching past the last bin are cut
+ */
+template<typename P, typename E>
+void spectrumBandEnergy(const P *power, size_t bins, const SpectrumBand *bands, size_t count, E *energy)
+{
+    for(size_t b = 0; b < count; b++)
+    {
+        E sum = 0;
+        size_t last = bands[b].last < bins ? bands[b].last : bins;
+        for(size_t k = bands[b].first; k < last; k++)
+        {
+            sum += power[k];
+        }
+        energy[b] = sum;
+    }
+}
+
+/**
+ * @brief Bin nearest to a frequency
+ */
+inline uint16_t spectrumBinOf(uint32_t frequencyHz, uint32_t sampleRateHz, size_t n)
+{
+    return sampleRateHz == 0 ? 0 : (uint16_t)(((uint64_t)frequencyHz * n + sampleRateHz / 2U) / sampleRateHz);
+}
+
+#endif /* SPECTRUM_H */
@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file           : time_series.h
+  * @brief          : Compressed time-series store for sensor history
+  ******************************************************************************
+  * Samples are packed Gorilla-style into fixed-size, self-contained blocks:
+  * timestamps as delta-of-delta, float values as XOR against the previous
+  * value and integer values as zigzag varint deltas. Full blocks rotate
+  * through a RAM ring and the oldest one is handed to a spill callback
+  * (typically the flash store) when the ring wraps. Queries are range scans
+  * that decode one block at a time and skip blocks outside the range.
+  *
+  * Not thread safe: appends and queries must come from the same context.
+  ******************************************************************************
+  */
+
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bit_stream.h"
+
+enum class TsValueType : uint8_t
+{
+    Float = 0,
+    Int = 1
+};
+
+struct TsSample
+{
+    uint32_t timestamp;     // Milliseconds, non-decreasing
+    uint32_t raw;           // Float bits or int32 bits depending on the series type
+
+    float asFloat() const;
+    int32_t asInt() const { return (int32_t)raw; }
+};
+
+/* Block header, stored uncompressed at the start of every block */
+struct TsBlockHeader
+{
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+    uint16_t count;
+    uint16_t bitLength;     // Payload bits following the header
+    uint8_t type;           // TsValueType
+    uint8_t reserved[3];
+};
+
+#define TS_BLOCK_HEADER_SIZE    sizeof(TsBlockHeader)
+#define TS_BLOCK_MIN_SIZE       64U
+#define TS_BLOCK_MAX_SIZE       8192U
+
+class TsBlockEncoder
+{
+public:
+    /**
+     * @brief Start a new empty block in the given buffer
+     */
+    void begin(uint8_t *block, size_t size, TsValueType type);
+
+    /**
+     * @brief Append one sample
+     * @retval false if the block is full or the timestamp goes backwards
+     */
+    bool append(uint32_t timestamp, uint32_t raw);
+
+    uint16_t count() const;
+    size_t usedBytes() const;
+
+private:
+    void writeTimestamp(uint32_t timestamp);
+    void writeFloat(uint32_t raw);
+    void writeInt(uint32_t raw);
+    void updateHeader();
+
+    uint8_t *block;
+    BitWriter writer;
+    TsValueType type;
+    uint16_t samples;
+    uint32_t previousTimestamp;
+    int64_t previousDelta;
+    uint32_t previousValue;
+    uint8_t previousLeading;
+    uint8_t previousTrailing;
+};
+
+class TsBlockDecoder
+{
+public:
+    /**
+     * @brief Attach to a sealed or in-progress block
+     * @retval false if the header is not valid for the given block size
+     */
+    bool begin(const uint8_t *block, size_t size);
+
+    bool next(TsSample &sample);
+
+    const TsBlockHeader &header() const { return blockHeader; }
+
+private:
+    bool readTimestamp(uint32_t &timestamp);
+    bool readFloat(uint32_t &raw);
+    bool readInt(uint32_t &raw);
+
+    TsBlockHeader blockHeader;
+    BitReader reader;
+    uint16_t decoded;
+    uint32_t previousTimestamp;
+    int64_t previousDelta;
+    uint32_t previousValue;
+    uint8_t previousLeading;
+    uint8_t previousTrailing;
+};
+
+/* Hands a full block to secondary storage, returns false if it could not be stored */
+typedef bool (*TsSpillFn)(uint32_t spillIndex, const uint8_t *block, size_t size, void *ctx);
+/* Loads a previously spilled block back into a scratch buffer */
+typedef bool (*TsLoadFn)(uint32_t spillIndex, uint8_t *block, size_t size, void *ctx);
+
+struct TimeSeriesConfig
+{
+    uint8_t *storage;       // blockCount * blockSize bytes
+    size_t blockSize;
+    size_t blockCount;
+    TsValueType type;
+    TsSpillFn spill;        // Optional
+    TsLoadFn load;          // Optional, needed to query spilled blocks
+    void *ctx;
+};
+
+struct TimeSeriesStats
+{
+    uint32_t samples;           // Samples currently held in RAM
+    uint32_t sealedBlocks;      // Blocks completed since init
+    uint32_t spilledBlocks;     // Blocks handed to the spill callback
+    uint32_t droppedBlocks;     // Blocks lost because spilling failed or was not configured
+    uint32_t rejectedSamples;   // Out-of-order timestamps
+    uint32_t payloadBits;       // Compressed bits held in RAM blocks
+};
+
+class TimeSeriesStore;
+
+class TsQuery
+{
+public:
+    /**
+     * @brief Next sample inside the range, decoding blocks lazily
+     * @retval false once the range is exhausted
+     */
+    bool next(TsSample &sample);
+
+private:
+    friend class TimeSeriesStore;
+
+    bool openNextBlock();
+
+    const TimeSeriesStore *store = nullptr;
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint8_t *scratch = nullptr;
+    uint32_t spillCursor = 0;
+    uint32_t ramCursor = 0;
+    bool blockOpen = false;
+    TsBlockDecoder decoder;
+};
+
+class TimeSeriesStore
+{
+public:
+    /**
+     * @brief Attach the store to its block storage
+     * @retval false if the configuration is invalid
+     */
+    bool init(const TimeSeriesConfig &config);
+
+    bool append(uint32_t timestamp, float value);
+    bool append(uint32_t timestamp, int32_t value);
+
+    /**
+     * @brief Start a range scan over [from, to]
+     * @param scratch Buffer of blockSize bytes for spilled blocks, may be NULL
+     *                to only scan what is still in RAM
+     */
+    TsQuery query(uint32_t from, uint32_t to, uint8_t *scratch = nullptr) const;
+
+    /**
+     * @brief Seal the active block and spill every sealed block
+     * @note  Used before power down so the RAM ring is not lost
+     */
+    void flush();
+
+    TimeSeriesStats stats() const;
+
+private:
+    friend class TsQuery;
+
+    bool appendRaw(uint32_t timestamp, uint32_t raw);
+    uint8_t *blockAt(size_t ringIndex) const;
+    void startActiveBlock();
+    void evictOldest();
+
+    TimeSeriesConfig config;
+    size_t oldest;          // Ring index of the oldest block held in RAM
+    size_t used;            // Blocks held in RAM, including the active one
+    uint32_t spilled;
+    uint32_t lastTimestamp;
+    TsBlockEncoder encoder;
+    TimeSeriesStats counters;
+};
+
+#endif /* TIME_SERIES_H */
@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file           : time_sync.h
+  * @brief          : Two-way time transfer and a disciplined software clock
+  ******************************************************************************
+  * One exchange carries four timestamps, NTP style: t1 when the client sent
+  * the request and t4 when the response arrived, on the client's local
+  * clock, t2 and t3 when the server received the request and sent the
+  * response, on the reference clock. Then
+  *
+  *   offset = ((t2 - t1) + (t3 - t4)) / 2     reference minus local
+  *   delay  = (t4 - t1) - (t3 - t2)           round trip on the wire
+  *
+  * and the offset is exact when both directions take the same time. The
+  * request is padded to the length of the response so that serialization
+  * on a slow link is symmetric, queueing and host latency are not.
+  *
+  * A late exchange has an asymmetric delay and a wrong offset, so the
+  * clock filters the last TIME_SYNC_WINDOW exchanges and picks the newest
+  * one whose delay is close to the smallest, each exchange at most once.
+  * A least-squares line through the last TIME_SYNC_HISTORY picked offsets
+  * gives the offset now and the frequency error of the local oscillator
+  * (drift). Corrections above the step threshold are applied at once,
+  * smaller ones are slewed in at a bounded rate so the clock never jumps,
+  * and between exchanges the drift is compensated.
+  ******************************************************************************
+  */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIME_SYNC_TAG           0xFDU   // First payload byte, link control frames use 0xFE
+#define TIME_SYNC_FRAME_SIZE    28U
+#define TIME_SYNC_WINDOW        8U      // Exchanges the filter picks from
+#define TIME_SYNC_HISTORY       16U     // Picks the fit runs on
+
+enum TimeSyncType : uint8_t
+{
+    TIME_SYNC_REQUEST = 1,
+    TIME_SYNC_RESPONSE = 2,
+};
+
+struct TimeSyncMessage
+{
+    uint8_t type;
+    uint16_t sequence;
+    uint64_t t1;                // Client transmit, echoed by the server
+    uint64_t t2;                // Server receive, zero in requests
+    uint64_t t3;                // Server transmit, zero in requests
+
+    static bool isMessage(const uint8_t *payload, size_t length);
+
+    /**
+     * @retval TIME_SYNC_FRAME_SIZE, 0 if out is too small
+     */
+    size_t encode(uint8_t *out, size_t capacity) const;
+
+    bool decode(const uint8_t *payload, size_t length);
+};
+
+struct TimeSyncConfig
+{
+    uint32_t stepThresholdUs = 128000;  // Larger corrections step the clock
+    uint32_t maxSlewPpm = 500;          // Rate at which smaller ones are absorbed
+    uint32_t maxDelayUs = 200000;       // Exchanges slower than this are discarded
+    uint32_t delayMarginUs = 250;       // Picked exchanges: delay up to the window minimum plus this
+    uint32_t minFitSpanUs = 20000000;   // Picked exchanges must span this long to estimate drift
+};
+
+struct TimeSyncClockStats
+{
+    uint32_t samples;
+    uint32_t accepted;              // Exchanges picked by the filter
+    uint32_t discarded;             // Too slow, or inconsistent timestamps
+    uint32_t steps;
+    int64_t lastCorrectionUs;       // Estimate minus the clock when the last exchange was used
+    uint32_t lastDelayUs;
+    uint32_t minDelayUs;            // In the current window
+    int32_t driftPpb;               // Local oscillator error compensated by the clock
+    uint32_t jitterUs;              // RMS residual of the picked offsets around the fit
+};
+
+class TimeSyncClock
+{
+public:
+    void configure(const TimeSyncConfig &config) { cfg = config; }
+
+    /**
+     * @brief Feed one completed exchange, t1 and t4 local, t2 and t3 reference
+     * @retval true if the filter picked an exchange and the clock was corrected
+     */
+    bool addSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+    bool synced() const { return isSynced; }
+
+    /**
+     * @brief Reference time at a local time, meaningful once synced
+     */
+    uint64_t toReference(uint64_t localUs) const;
+
+    const TimeSyncClockStats &stats() const { return totals; }
+
+    void reset();
+
+private:
+    struct Sample
+    {
+        uint64_t localUs;           // Midpoint of t1 and t4
+        int64_t offsetUs;
+        uint32_t delayUs;
+    };
+
+    template<size_t N>
+    struct Ring
+    {
+        Sample items[N];
+        size_t count = 0;
+        size_t head = 0;
+
+        void push(const Sample &sample)
+        {
+            items[head] = sample;
+            head = (head + 1U) % N;
+            count = count < N ? count + 1U : count;
+        }
+
+        // 0 is the newest
+        const Sample &at(size_t age) const { return items[(head + N - 1U - age) % N]; }
+    };
+
+    const Sample *pick();
+    void fit(int64_t &offsetAtUs, double &slope, uint64_t atLocalUs);
+    void apply(uint64_t nowLocalUs, uint64_t targetUs, int64_t ratePpb);
+
+    TimeSyncConfig cfg;
+    Ring<TIME_SYNC_WINDOW> window;      // Last exchanges
+    Ring<TIME_SYNC_HISTORY> picked;     // Filter output the fit runs on
+    uint64_t lastPickedUs = 0;
+
+    // Piecewise linear mapping: slewing from the anchor to slewEnd, then the drift rate
+    bool isSynced = false;
+    uint64_t anchorLocalUs = 0;
+    uint64_t anchorRefUs = 0;
+    uint64_t slewEndLocalUs = 0;
+    uint64_t slewEndRefUs = 0;
+    int64_t ratePpb = 0;
+
+    TimeSyncClockStats totals = {};
+};
+
+#endif /* TIME_SYNC_H */
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file           : trace_codec.h
+  * @brief          : Compact binary format for peripheral traffic traces
+  ******************************************************************************
+  * A trace is the magic "PTR1" followed by events. Every event starts with
+  * a byte holding its kind (high nibble) and peripheral port (low nibble),
+  * then the time since the previous event in microseconds as a varint, then
+  * the fields of its kind:
+  *
+  *   UART_TX       status, length          HAL_UART_Transmit_IT called
+  *   UART_RX       status, length          HAL_UART_Receive_IT called
+  *   UART_STATE    state                   HAL_UART_GetState result
+  *   UART_DATA     length, bytes           Bytes a reception delivered
+  *   UART_TX_DONE                          Transmit complete interrupt
+  *   UART_ERROR    code                    Error interrupt, HAL error flags
+  *   UART_RX_EVENT length                  Reception to idle event
+  *   SMBUS_TX      status, address, length HAL_SMBUS_Master_Transmit_IT called
+  *   DROPPED       count                   Events lost by the recorder
+  *   SPAN_START    id                      Request stage entered
+  *   SPAN_END      status, id              Request stage left, HAL status
+  *
+  * Status and state are single bytes, everything else is a varint. Ports
+  * are peripheral instance numbers (huart2 is UART port 2); span events
+  * carry their stage (TraceSpanStage) in the port nibble and the correlation
+  * id given to the request when it arrived.
+  ******************************************************************************
+  */
+
+#ifndef TRACE_CODEC_H
+#define TRACE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC_SIZE        4U
+#define TRACE_EVENT_MAX_HEADER  24U     // Longest event without its data bytes
+
+enum TraceKind : uint8_t
+{
+    TRACE_UART_TX = 1,
+    TRACE_UART_RX,
+    TRACE_UART_STATE,
+    TRACE_UART_DATA,
+    TRACE_UART_TX_DONE,
+    TRACE_UART_ERROR,
+    TRACE_UART_RX_EVENT,
+    TRACE_SMBUS_TX,
+    TRACE_DROPPED,
+    TRACE_SPAN_START,
+    TRACE_SPAN_END,
+};
+
+// Stages of a host request, the whole request first
+enum TraceSpanStage : uint8_t
+{
+    TRACE_SPAN_REQUEST = 0,         // Command frame decoded to reply queued on the link
+    TRACE_SPAN_QUEUE,               // Waiting for the SMBus task
+    TRACE_SPAN_SMBUS,               // Bus transaction
+    TRACE_SPAN_REPLY,               // Completion waiting for the UART task
+    TRACE_SPAN_STAGES
+};
+
+struct TraceEvent
+{
+    TraceKind kind;
+    uint8_t port;
+    uint64_t timeUs;            // Absolute, from the start of the trace
+    uint8_t status;             // HAL status or UART state
+    uint32_t value;             // Length, address, error code, drop count or correlation id by kind
+    uint32_t length;            // SMBus transfer length, data length
+    const uint8_t *data;        // UART_DATA bytes
+};
+
+extern const uint8_t TRACE_MAGIC[TRACE_MAGIC_SIZE];
+
+class TraceEncoder
+{
+public:
+    /**
+     * @brief Encode one event, times must not go backwards
+     * @retval Bytes written, 0 if out is too small (the encoder state is unchanged)
+     */
+    size_t encode(const TraceEvent &event, uint8_t *out, size_t capacity);
+
+    void reset() { lastUs = 0; }
+
+private:
+    uint64_t lastUs = 0;
+};
+
+class TraceDecoder
+{
+public:
+    /**
+     * @brief Start decoding a complete trace held in memory
+     * @retval false if the magic is missing
+     */
+    bool attach(const uint8_t *trace, size_t size);
+
+    /**
+     * @brief Decode the next event, data points into the trace
+     * @retval false at the end of the trace or on a malformed event
+     */
+    bool next(TraceEvent &event);
+
+    bool malformed() const { return bad; }
+    size_t offset() const { return pos; }
+
+private:
+    bool readVarint(uint64_t &value);
+
+    const uint8_t *buffer = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    uint64_t lastUs = 0;
+    bool bad = false;
+};
+
+/**
+ * @brief Printable name of an event kind
+ */
+const char *traceKindName(TraceKind kind);
+
+/**
+ * @brief Printable name of a span stage
+ */
+const char *traceSpanName(uint8_t stage);
+
+#endif /* TRACE_CODEC_H */
@@ -0,0 +1,144 @@
+/**
+  ******************************************************************************
+  * @file           : tunables.h
+  * @brief          : Runtime-tunable parameters registered in a linker section
+  ******************************************************************************
+  * A tunable is a 32-bit variable with a name, a range and a default:
+  *
+  *   TUNABLE_UINT(pollPeriodMs, "uart.period_ms", 3000, 10, 60000);
+  *
+  * defines the variable, initialised to the default, and places its
+  * descriptor in the "tunables" section. The linker gathers the descriptors
+  * of every file into one table (the board scripts KEEP it, host builds get
+  * it from the __start_/__stop_ symbols GNU ld provides), so no list has to
+  * be maintained by hand. Code reads the variable directly: one load, no
+  * lookup. Updates check the range and replace the value with a single
+  * aligned 32-bit store, so readers see the old value or the new one.
+  *
+  * Changed values can be saved to a blob keyed by the CRC of the name and
+  * loaded back, so a config store can keep them across resets even when
+  * the table changes between builds.
+  ******************************************************************************
+  */
+
+#ifndef TUNABLES_H
+#define TUNABLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum TunableType : uint8_t
+{
+    TUNABLE_TYPE_UINT = 0,
+    TUNABLE_TYPE_INT,
+};
+
+enum TunableResult : uint8_t
+{
+    TUNABLE_OK = 0,
+    TUNABLE_OUT_OF_RANGE,
+    TUNABLE_UNKNOWN,
+};
+
+struct Tunable
+{
+    const char *name;
+    volatile uint32_t *value;       // Signed tunables store the int32_t bit pattern
+    uint32_t defaultValue;
+    uint32_t minimum;
+    uint32_t maximum;
+    TunableType type;
+};
+
+#define TUNABLE_SECTION_ATTR \
+    __attribute__((used, section("tunables"), aligned(__alignof__(Tunable))))
+
+#define TUNABLE_UINT(var, name, def, lo, hi) \
+    static_assert((uint32_t)(lo) <= (uint32_t)(def) && (uint32_t)(def) <= (uint32_t)(hi), name " default out of range"); \
+    volatile uint32_t var = (def); \
+    static const Tunable var##Tunable TUNABLE_SECTION_ATTR = \
+        { name, &var, (uint32_t)(def), (uint32_t)(lo), (uint32_t)(hi), TUNABLE_TYPE_UINT }
+
+#define TUNABLE_INT(var, name, def, lo, hi) \
+    static_assert((int32_t)(lo) <= (int32_t)(def) && (int32_t)(def) <= (int32_t)(hi), name " default out of range"); \
+    volatile int32_t var = (def); \
+    static const Tunable var##Tunable TUNABLE_SECTION_ATTR = \
+        { name, (volatile uint32_t *)&var, (uint32_t)(int32_t)(def), (uint32_t)(int32_t)(lo), (uint32_t)(int32_t)(hi), \
+          TUNABLE_TYPE_INT }
+
+/**
+ * @brief Number of tunables linked into the image
+ */
+size_t tunableCount(void);
+
+/**
+ * @brief Tunable by table position, nullptr past the end
+ */
+const Tunable *tunableAt(size_t index);
+
+/**
+ * @brief Tunable by exact name, nullptr if there is none
+ */
+const Tunable *tunableFind(const char *name);
+
+/**
+ * @brief Current value, sign-extended for signed tunables
+ */
+int64_t tunableGet(const Tunable *tunable);
+
+/**
+ * @brief Replace the value if it is within the range
+ */
+TunableResult tunableSet(const Tunable *tunable, int64_t value);
+
+/**
+ * @brief Put every tunable back to its default
+ */
+void tunableResetAll(void);
+
+/**
+ * @brief Write the tunables that differ from their defaults
+ * @retval Bytes written, 0 if out is too small
+ */
+size_t tunableSave(uint8_t *out, size_t capacity);
+
+/**
+ * @brief Apply a blob written by tunableSave
+ * @retval Values applied, -1 if the blob is damaged; unknown names and
+ *         values now out of range are skipped
+ */
+int tunableLoad(const uint8_t *data, size_t size);
+
+/**
+ * @brief Text commands for tunables, shared by the RTT shell and the UART link
+ *
+ *   list [from]            name = value [min..max] default d, one per line
+ *   get <name>
+ *   set <name> <value>     decimal or 0x hex, negative for signed tunables
+ *   reset <name>|all
+ *   save                   through the save function, if one is installed
+ */
+class TunableShell
+{
+public:
+    using SaveFn = bool (*)(const uint8_t *blob, size_t size, void *ctx);
+
+    void setSave(SaveFn fn, void *ctx)
+    {
+        saveFn = fn;
+        saveCtx = ctx;
+    }
+
+    /**
+     * @brief Run one command line
+     * @param out Reply text, always terminated, truncated lists say where to go on
+     * @retval false if the line is not a tunables command
+     */
+    bool execute(const char *line, char *out, size_t capacity);
+
+private:
+    SaveFn saveFn = nullptr;
+    void *saveCtx = nullptr;
+};
+
+#endif /* TUNABLES_H */
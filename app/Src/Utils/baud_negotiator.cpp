@@ -0,0 +1,419 @@
+/**
+  ******************************************************************************
+  * @file           : baud_negotiator.cpp
+  * @brief          : UART link-speed negotiation with error-driven fallback
+  ******************************************************************************
+  */
+
+#include "baud_negotiator.h"
+
+#include <string.h>
+
+namespace {
+
+enum MessageType : uint8_t
+{
+    MSG_PROPOSE = 1,    // rate
+    MSG_ACCEPT  = 2,    // rate
+    MSG_REJECT  = 3,    // rate
+    MSG_TEST    = 4,    // seq, total, pattern
+    MSG_RESULT  = 5,    // good, total
+    MSG_CONFIRM = 6,    // rate
+    MSG_PING    = 7,
+    MSG_PONG    = 8
+};
+
+bool expired(uint32_t nowMs, uint32_t deadlineMs)
+{
+    return (int32_t)(nowMs - deadlineMs) >= 0;
+}
+
+void putRate(uint8_t *dst, uint32_t rate)
+{
+    dst[0] = (uint8_t)(rate >> 24);
+    dst[1] = (uint8_t)(rate >> 16);
+    dst[2] = (uint8_t)(rate >> 8);
+    dst[3] = (uint8_t)rate;
+}
+
+uint32_t getRate(const uint8_t *src)
+{
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3];
+}
+
+// Pseudo-random fill with the classic stress bytes at fixed positions
+void testPattern(uint8_t seq, uint8_t *dst)
+{
+    static const uint8_t stress[] = {0x00, 0xFF, 0x55, 0xAA, 0x0F, 0xF0};
+    uint32_t x = ((uint32_t)seq + 1U) * 0x9E3779B9UL;
+    for(size_t i = 0; i < BAUD_NEG_TEST_LENGTH; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        dst[i] = (i % 8U < sizeof(stress)) && (i / 8U) % 2U == 1U ? stress[i % 8U] : (uint8_t)x;
+    }
+}
+
+} // namespace
+
+bool BaudNegotiator::init(const BaudNegotiatorConfig &config, uint32_t nowMs)
+{
+    if(config.rates == nullptr || config.rateCount == 0 || config.rateCount > BAUD_NEG_MAX_RATES ||
+       config.setBaud == nullptr || config.sendFrame == nullptr || config.rateSupported == nullptr ||
+       config.testFrames == 0 || config.testFrames > 255U)
+    {
+        return false;
+    }
+
+    cfg = config;
+    memset(failedUntilMs, 0, sizeof(failedUntilMs));
+    counters = BaudNegotiatorStats();
+    deliveredBytes = 0;
+    throughputStartMs = nowMs;
+    restart(nowMs);
+    return true;
+}
+
+void BaudNegotiator::restart(uint32_t nowMs)
+{
+    switchTo(safeRate(), nowMs);
+    candidate = -1;
+    windowStartMs = nowMs;
+    windowErrors = 0;
+    lastGoodMs = nowMs;
+
+    if(cfg.master)
+    {
+        // Give the slave time to notice silence and return to the safe rate
+        state = IDLE;
+        deadlineMs = nowMs + cfg.settleMs;
+    }
+    else
+    {
+        // The slave serves traffic at the safe rate until a proposal arrives
+        state = RUNNING;
+    }
+}
+
+int BaudNegotiator::rateIndex(uint32_t rate) const
+{
+    for(size_t i = 0; i < cfg.rateCount; i++)
+    {
+        if(cfg.rates[i] == rate)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void BaudNegotiator::send(uint8_t type, const uint8_t *data, size_t length)
+{
+    uint8_t frame[BAUD_NEG_MAX_FRAME];
+    frame[0] = BAUD_NEG_TAG;
+    frame[1] = type;
+    if(length > 0)
+    {
+        memcpy(&frame[2], data, length);
+    }
+    cfg.sendFrame(frame, length + 2U, cfg.ctx);
+}
+
+void BaudNegotiator::sendRate(uint8_t type, uint32_t rate)
+{
+    uint8_t data[4];
+    putRate(data, rate);
+    send(type, data, sizeof(data));
+}
+
+void BaudNegotiator::switchTo(uint32_t rate, uint32_t nowMs)
+{
+    if(counters.baud != rate)
+    {
+        cfg.setBaud(rate, cfg.ctx);
+        counters.baud = rate;
+    }
+    lastGoodMs = nowMs;
+}
+
+void BaudNegotiator::proposeNext(uint32_t nowMs)
+{
+    // The safe rate is never negotiated, it is where every attempt returns to
+    for(int i = candidate + 1; i < (int)cfg.rateCount - 1; i++)
+    {
+        bool held = failedUntilMs[i] != 0 && !expired(nowMs, failedUntilMs[i]);
+        if(!held && cfg.rateSupported(cfg.rates[i], cfg.ctx))
+        {
+            candidate = i;
+            retries = 0;
+            state = PROPOSING;
+            deadlineMs = nowMs + cfg.replyTimeoutMs;
+            sendRate(MSG_PROPOSE, cfg.rates[i]);
+            return;
+        }
+    }
+
+    candidate = -1;
+    enterRunning(nowMs);
+}
+
+void BaudNegotiator::trialFailed(uint32_t nowMs)
+{
+    counters.trialsFailed++;
+    failedUntilMs[candidate] = nowMs + cfg.retryHoldoffMs;
+    switchTo(safeRate(), nowMs);
+
+    // Wait until the slave gave up on the trial too before the next proposal
+    state = IDLE;
+    deadlineMs = nowMs + 2U * cfg.settleMs + 2U * cfg.replyTimeoutMs;
+}
+
+void BaudNegotiator::fallback(uint32_t nowMs)
+{
+    counters.fallbacks++;
+    int index = rateIndex(counters.baud);
+    if(index >= 0)
+    {
+        failedUntilMs[index] = nowMs + cfg.retryHoldoffMs;
+    }
+
+    restart(nowMs);
+    if(cfg.master)
+    {
+        deadlineMs = nowMs + cfg.silenceMs + cfg.settleMs;
+    }
+}
+
+void BaudNegotiator::enterRunning(uint32_t nowMs)
+{
+    state = RUNNING;
+    counters.negotiations++;
+    lastGoodMs = nowMs;
+    lastPingMs = nowMs;
+    windowStartMs = nowMs;
+    windowErrors = 0;
+    deadlineMs = nowMs + cfg.retryHoldoffMs;
+}
+
+void BaudNegotiator::reportErrors(uint32_t count, uint32_t nowMs)
+{
+    counters.lineErrors += count;
+    windowErrors += count;
+    if(state == RUNNING && counters.baud != safeRate() && windowErrors > cfg.maxErrorsPerWindow)
+    {
+        fallback(nowMs);
+    }
+}
+
+// ===============================
+// Messages
+// ===============================
+
+void BaudNegotiator::handleFrame(const uint8_t *payload, size_t length, uint32_t nowMs)
+{
+    if(!isControlFrame(payload, length))
+    {
+        return;
+    }
+
+    lastGoodMs = nowMs;
+    uint8_t type = payload[1];
+    const uint8_t *data = &payload[2];
+    size_t dataLength = length - 2U;
+    uint32_t rate = dataLength >= 4U ? getRate(data) : 0;
+
+    if(cfg.master)
+    {
+        bool current = candidate >= 0 && rate == cfg.rates[candidate];
+        if(type == MSG_ACCEPT && state == PROPOSING && current)
+        {
+            // The accept has fully arrived, so the slave is done transmitting
+            switchTo(rate, nowMs);
+            state = SWITCHING;
+            deadlineMs = nowMs + cfg.settleMs;
+        }
+        else if(type == MSG_REJECT && state == PROPOSING && current)
+        {
+            failedUntilMs[candidate] = nowMs + cfg.retryHoldoffMs;
+            proposeNext(nowMs);
+        }
+        else if(type == MSG_RESULT && state == TESTING && dataLength >= 2U)
+        {
+            if(data[0] == data[1] && data[1] == cfg.testFrames)
+            {
+                sendRate(MSG_CONFIRM, cfg.rates[candidate]);
+                enterRunning(nowMs);
+            }
+            else
+            {
+                trialFailed(nowMs);
+            }
+        }
+        return;
+    }
+
+    if(type == MSG_PROPOSE && dataLength >= 4U)
+    {
+        int index = rateIndex(rate);
+        if(index >= 0 && cfg.rateSupported(rate, cfg.ctx))
+        {
+            sendRate(MSG_ACCEPT, rate);
+            pendingRate = rate;
+            state = SWITCHING;
+            // Switch once the accept has left the wire, well before the master starts testing
+            deadlineMs = nowMs + cfg.settleMs / 4U;
+        }
+        else
+        {
+            sendRate(MSG_REJECT, rate);
+        }
+    }
+    else if(type == MSG_TEST && state == TRIAL && dataLength == 2U + BAUD_NEG_TEST_LENGTH)
+    {
+        uint8_t expected[BAUD_NEG_TEST_LENGTH];
+        testPattern(data[0], expected);
+        if(memcmp(expected, &data[2], BAUD_NEG_TEST_LENGTH) == 0)
+        {
+            testsReceived++;
+        }
+
+        if(data[0] + 1U == data[1])
+        {
+            uint8_t result[2] = {(uint8_t)testsReceived, data[1]};
+            send(MSG_RESULT, result, sizeof(result));
+            deadlineMs = nowMs + cfg.settleMs + 2U * cfg.replyTimeoutMs;
+        }
+    }
+    else if(type == MSG_CONFIRM && state == TRIAL && rate == counters.baud)
+    {
+        enterRunning(nowMs);
+    }
+    else if(type == MSG_PING)
+    {
+        send(MSG_PONG, nullptr, 0);
+    }
+}
+
+// ===============================
+// Timers
+// ===============================
+
+void BaudNegotiator::tick(uint32_t nowMs)
+{
+    if(nowMs - throughputStartMs >= 1000U)
+    {
+        counters.throughputBps = (uint32_t)(((uint64_t)deliveredBytes * 1000U) / (nowMs - throughputStartMs));
+        deliveredBytes = 0;
+        throughputStartMs = nowMs;
+    }
+    if(nowMs - windowStartMs >= cfg.errorWindowMs)
+    {
+        windowErrors = 0;
+        windowStartMs = nowMs;
+    }
+
+    switch(state)
+    {
+    case IDLE:
+        if(cfg.master && expired(nowMs, deadlineMs))
+        {
+            proposeNext(nowMs);
+        }
+        break;
+
+    case PROPOSING:
+        if(expired(nowMs, deadlineMs))
+        {
+            if(++retries < cfg.proposeRetries)
+            {
+                deadlineMs = nowMs + cfg.replyTimeoutMs;
+                sendRate(MSG_PROPOSE, cfg.rates[candidate]);
+            }
+            else
+            {
+                // Nobody negotiates on the other end, stay at the current rate for now
+                candidate = -1;
+                enterRunning(nowMs);
+            }
+        }
+        break;
+
+    case SWITCHING:
+        if(expired(nowMs, deadlineMs))
+        {
+            if(cfg.master)
+            {
+                state = TESTING;
+                for(uint32_t seq = 0; seq < cfg.testFrames; seq++)
+                {
+                    uint8_t data[2U + BAUD_NEG_TEST_LENGTH];
+                    data[0] = (uint8_t)seq;
+                    data[1] = (uint8_t)cfg.testFrames;
+                    testPattern((uint8_t)seq, &data[2]);
+                    send(MSG_TEST, data, sizeof(data));
+                }
+                deadlineMs = nowMs + cfg.replyTimeoutMs;
+            }
+            else
+            {
+                switchTo(pendingRate, nowMs);
+                state = TRIAL;
+                testsReceived = 0;
+                deadlineMs = nowMs + cfg.settleMs + 2U * cfg.replyTimeoutMs;
+            }
+        }
+        break;
+
+    case TESTING:
+        if(expired(nowMs, deadlineMs))
+        {
+            trialFailed(nowMs);
+        }
+        break;
+
+    case TRIAL:
+        if(expired(nowMs, deadlineMs))
+        {
+            // No confirm: the master gave up on this rate
+            counters.trialsFailed++;
+            switchTo(safeRate(), nowMs);
+            state = RUNNING;
+        }
+        break;
+
+    case RUNNING:
+        if(cfg.master && nowMs - lastPingMs >= cfg.keepaliveMs)
+        {
+            lastPingMs = nowMs;
+            send(MSG_PING, nullptr, 0);
+        }
+        if(counters.baud != safeRate() && nowMs - lastGoodMs > cfg.silenceMs)
+        {
+            fallback(nowMs);
+        }
+        else if(cfg.master && expired(nowMs, deadlineMs) && rateIndex(counters.baud) > 0)
+        {
+            // Periodically try to climb back once failed rates are out of hold-off
+            bool faster = false;
+            for(int i = 0; i < rateIndex(counters.baud); i++)
+            {
+                if(failedUntilMs[i] == 0 || expired(nowMs, failedUntilMs[i]))
+                {
+                    faster = cfg.rateSupported(cfg.rates[i], cfg.ctx) || faster;
+                }
+            }
+            if(faster)
+            {
+                // Propose at the current rate, the slave still listens here
+                candidate = -1;
+                proposeNext(nowMs);
+            }
+            else
+            {
+                deadlineMs = nowMs + cfg.retryHoldoffMs;
+            }
+        }
+        break;
+    }
+}
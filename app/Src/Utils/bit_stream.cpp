@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : bit_stream.cpp
+  * @brief          : MSB-first bit writer and reader over caller buffers
+  ******************************************************************************
+  */
+
+#include "bit_stream.h"
+
+void BitWriter::attach(uint8_t *data, size_t sizeBytes, size_t bitPosition)
+{
+    buffer = data;
+    capacityBits = sizeBytes * 8U;
+    position = bitPosition;
+}
+
+bool BitWriter::write(uint64_t value, uint32_t bitCount)
+{
+    if(bitCount > 64U || bitCount > remainingBits())
+    {
+        return false;
+    }
+
+    while(bitCount > 0)
+    {
+        size_t byteIndex = position >> 3;
+        uint32_t bitOffset = (uint32_t)(position & 7U);
+        uint32_t freeBits = 8U - bitOffset;
+        uint32_t chunk = (bitCount < freeBits) ? bitCount : freeBits;
+
+        uint8_t bits = (uint8_t)((value >> (bitCount - chunk)) & ((1U << chunk) - 1U));
+        uint8_t shift = (uint8_t)(freeBits - chunk);
+        uint8_t mask = (uint8_t)(((1U << chunk) - 1U) << shift);
+
+        buffer[byteIndex] = (uint8_t)((buffer[byteIndex] & ~mask) | (bits << shift));
+
+        position += chunk;
+        bitCount -= chunk;
+    }
+    return true;
+}
+
+void BitReader::attach(const uint8_t *data, size_t bitLength)
+{
+    buffer = data;
+    lengthBits = bitLength;
+    position = 0;
+}
+
+bool BitReader::read(uint32_t bitCount, uint64_t &value)
+{
+    if(bitCount > 64U || bitCount > remainingBits())
+    {
+        return false;
+    }
+
+    uint64_t result = 0;
+    while(bitCount > 0)
+    {
+        size_t byteIndex = position >> 3;
+        uint32_t bitOffset = (uint32_t)(position & 7U);
+        uint32_t availableBits = 8U - bitOffset;
+        uint32_t chunk = (bitCount < availableBits) ? bitCount : availableBits;
+
+        uint8_t bits = (uint8_t)((buffer[byteIndex] >> (availableBits - chunk)) & ((1U << chunk) - 1U));
+        result = (result << chunk) | bits;
+
+        position += chunk;
+        bitCount -= chunk;
+    }
+    value = result;
+    return true;
+}
+
+bool BitReader::readBit(bool &bit)
+{
+    uint64_t value;
+    if(!read(1, value))
+    {
+        return false;
+    }
+    bit = (value != 0U);
+    return true;
+}
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file           : budget_ledger.cpp
+  * @brief          : Per-task execution budgets over a replenishment period
+  ******************************************************************************
+  */
+
+#include "budget_ledger.h"
+
+bool BudgetLedger::add(const void *owner, const char *name, uint32_t budget, uint32_t counter)
+{
+    if(owner == nullptr || accountCount >= BUDGET_LEDGER_MAX_ACCOUNTS || find(owner) != accountCount)
+    {
+        return false;
+    }
+
+    BudgetAccount &account = accounts[accountCount++];
+    account = BudgetAccount{};
+    account.owner = owner;
+    account.name = name;
+    account.budget = budget;
+    account.lastCounter = counter;
+    return true;
+}
+
+size_t BudgetLedger::find(const void *owner) const
+{
+    for(size_t i = 0; i < accountCount; i++)
+    {
+        if(accounts[i].owner == owner)
+        {
+            return i;
+        }
+    }
+    return accountCount;
+}
+
+BudgetEvent BudgetLedger::charge(size_t index, uint32_t counter)
+{
+    if(index >= accountCount)
+    {
+        return BUDGET_NONE;
+    }
+
+    BudgetAccount &account = accounts[index];
+    uint32_t ran = counter - account.lastCounter;
+    account.lastCounter = counter;
+    account.ran += ran;
+    account.used = (account.used + ran < account.used) ? UINT32_MAX : account.used + ran;
+
+    if(account.budget != 0 && !account.throttled && account.used > account.budget)
+    {
+        account.throttled = true;
+        account.violations++;
+        return BUDGET_EXCEEDED;
+    }
+    return BUDGET_NONE;
+}
+
+BudgetEvent BudgetLedger::replenish(size_t index, uint32_t counter)
+{
+    BudgetEvent event = charge(index, counter);
+    if(index >= accountCount)
+    {
+        return BUDGET_NONE;
+    }
+
+    BudgetAccount &account = accounts[index];
+    account.throttledPeriods += account.throttled ? 1U : 0U;
+    account.peak = account.ran > account.peak ? account.ran : account.peak;
+    account.lastPeriod = account.ran;
+    account.ran = 0;
+
+    if(account.budget == 0)
+    {
+        account.used = 0;
+        return BUDGET_NONE;
+    }
+
+    // Overrun becomes debt against the next period, at most one budget so a task that kept
+    // running while throttled sits out one more period and is not locked out for good
+    uint32_t overrun = account.used > account.budget ? account.used - account.budget : 0;
+    account.used = overrun < account.budget ? overrun : account.budget;
+    if(account.throttled && account.used < account.budget)
+    {
+        account.throttled = false;
+        return BUDGET_RESTORED;
+    }
+    return event;
+}
+
+void BudgetLedger::setBudget(size_t index, uint32_t budget)
+{
+    if(index < accountCount)
+    {
+        accounts[index].budget = budget;
+    }
+}
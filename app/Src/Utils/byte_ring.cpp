@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : byte_ring.cpp
+  * @brief          : Byte FIFO over caller-provided storage
+  ******************************************************************************
+  */
+
+#include "byte_ring.h"
+
+#include <string.h>
+
+void ByteRing::attach(uint8_t *storage, size_t storageSize)
+{
+    buffer = storage;
+    size = storage != nullptr ? storageSize : 0;
+    clear();
+}
+
+size_t ByteRing::write(const uint8_t *data, size_t length)
+{
+    if(length > free())
+    {
+        length = free();
+    }
+
+    size_t first = size - head;
+    if(first > length)
+    {
+        first = length;
+    }
+    memcpy(buffer + head, data, first);
+    memcpy(buffer, data + first, length - first);
+
+    head = (head + length) % (size != 0 ? size : 1);
+    count += length;
+    return length;
+}
+
+size_t ByteRing::peek(uint8_t *dst, size_t length) const
+{
+    if(length > count)
+    {
+        length = count;
+    }
+
+    size_t first = size - tail;
+    if(first > length)
+    {
+        first = length;
+    }
+    memcpy(dst, buffer + tail, first);
+    memcpy(dst + first, buffer, length - first);
+    return length;
+}
+
+void ByteRing::discard(size_t length)
+{
+    if(length > count)
+    {
+        length = count;
+    }
+    tail = (tail + length) % (size != 0 ? size : 1);
+    count -= length;
+}
+
+size_t ByteRing::read(uint8_t *dst, size_t length)
+{
+    length = peek(dst, length);
+    discard(length);
+    return length;
+}
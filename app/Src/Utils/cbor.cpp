@@ -0,0 +1,586 @@
+/**
+  ******************************************************************************
+  * @file           : cbor.cpp
+  * @brief          : Streaming CBOR (RFC 8949) writer and pull reader
+  ******************************************************************************
+  */
+
+#include "cbor.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+constexpr uint16_t HALF_NAN = 0x7E00;
+constexpr uint64_t INDEFINITE_LEFT = UINT64_MAX;
+
+uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000U) << 16;
+    uint32_t exponent = (half >> 10) & 0x1FU;
+    uint32_t mantissa = half & 0x3FFU;
+    if(exponent == 0)
+    {
+        float value = ldexpf((float)mantissa, -24);
+        return sign != 0 ? -value : value;
+    }
+
+    uint32_t bits = exponent == 31 ? (sign | 0x7F800000U | (mantissa << 13))
+                                   : (sign | ((exponent - 15U + 127U) << 23) | (mantissa << 13));
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief value as a half, truncated
+ * @param exact Set when the half converts back to the same float
+ */
+uint16_t floatToHalf(float value, bool &exact)
+{
+    uint32_t bits = floatBits(value);
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000U);
+    uint32_t exponent = (bits >> 23) & 0xFFU;
+    uint32_t mantissa = bits & 0x7FFFFFU;
+    int32_t halfExponent = (int32_t)exponent - 127 + 15;
+
+    uint16_t half;
+    if(exponent == 0xFFU)
+    {
+        half = (uint16_t)(sign | 0x7C00U | (mantissa >> 13));
+    }
+    else if(exponent == 0)
+    {
+        half = sign;                    // Float subnormals are far below the half range
+    }
+    else if(halfExponent >= 31 || halfExponent < -10)
+    {
+        exact = false;
+        return 0;
+    }
+    else if(halfExponent <= 0)
+    {
+        half = (uint16_t)(sign | ((mantissa | 0x800000U) >> (14 - halfExponent)));
+    }
+    else
+    {
+        half = (uint16_t)(sign | ((uint32_t)halfExponent << 10) | (mantissa >> 13));
+    }
+
+    exact = floatBits(halfToFloat(half)) == bits;
+    return half;
+}
+
+void putBigEndian(uint8_t *out, uint64_t value, size_t bytes)
+{
+    for(size_t i = 0; i < bytes; i++)
+    {
+        out[i] = (uint8_t)(value >> (8U * (bytes - 1U - i)));
+    }
+}
+
+} // namespace
+
+void CborWriter::attach(uint8_t *buffer, size_t bufferSize)
+{
+    out = buffer;
+    capacity = buffer != nullptr ? bufferSize : 0;
+    ring = nullptr;
+    written = 0;
+    failed = false;
+}
+
+void CborWriter::attach(ByteRing &target)
+{
+    out = nullptr;
+    capacity = 0;
+    ring = &target;
+    written = 0;
+    failed = false;
+}
+
+bool CborWriter::writeInt(int64_t value)
+{
+    // -1 - value, which is ~value, cannot overflow where the negation of INT64_MIN would
+    return value >= 0 ? head(MAJOR_UNSIGNED, (uint64_t)value) : head(MAJOR_NEGATIVE, ~(uint64_t)value);
+}
+
+bool CborWriter::writeBytes(const uint8_t *data, size_t length)
+{
+    return head(MAJOR_BYTES, length, data, length);
+}
+
+bool CborWriter::writeText(const char *text, size_t length)
+{
+    return head(MAJOR_TEXT, length, reinterpret_cast<const uint8_t *>(text), length);
+}
+
+bool CborWriter::writeText(const char *text)
+{
+    return writeText(text, text != nullptr ? strlen(text) : 0);
+}
+
+bool CborWriter::writeFloat(float value)
+{
+    uint8_t item[5];
+    if(value != value)
+    {
+        item[0] = MAJOR_SIMPLE | 25U;
+        putBigEndian(&item[1], HALF_NAN, 2);
+        return emit(item, 3, nullptr, 0);
+    }
+
+    bool exact;
+    uint16_t half = floatToHalf(value, exact);
+    if(exact)
+    {
+        item[0] = MAJOR_SIMPLE | 25U;
+        putBigEndian(&item[1], half, 2);
+        return emit(item, 3, nullptr, 0);
+    }
+    item[0] = MAJOR_SIMPLE | 26U;
+    putBigEndian(&item[1], floatBits(value), 4);
+    return emit(item, 5, nullptr, 0);
+}
+
+bool CborWriter::writeDouble(double value)
+{
+    float single = (float)value;
+    if(value != value || (double)single == value)
+    {
+        return writeFloat(single);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t item[9];
+    item[0] = MAJOR_SIMPLE | 27U;
+    putBigEndian(&item[1], bits, 8);
+    return emit(item, 9, nullptr, 0);
+}
+
+bool CborWriter::head(uint8_t major, uint64_t value, const uint8_t *payload, size_t length)
+{
+    uint8_t bytes[CBOR_MAX_HEAD];
+    size_t n;
+    if(value < 24U)
+    {
+        bytes[0] = (uint8_t)(major | value);
+        n = 1;
+    }
+    else if(value <= 0xFFU)
+    {
+        bytes[0] = major | 24U;
+        bytes[1] = (uint8_t)value;
+        n = 2;
+    }
+    else if(value <= 0xFFFFU)
+    {
+        bytes[0] = major | 25U;
+        putBigEndian(&bytes[1], value, 2);
+        n = 3;
+    }
+    else if(value <= 0xFFFFFFFFU)
+    {
+        bytes[0] = major | 26U;
+        putBigEndian(&bytes[1], value, 4);
+        n = 5;
+    }
+    else
+    {
+        bytes[0] = major | 27U;
+        putBigEndian(&bytes[1], value, 8);
+        n = 9;
+    }
+    return emit(bytes, n, payload, length);
+}
+
+bool CborWriter::emit(const uint8_t *first, size_t firstLength, const uint8_t *second, size_t secondLength)
+{
+    if(failed)
+    {
+        return false;
+    }
+
+    size_t room = ring != nullptr ? ring->free() : capacity - written;
+    if(firstLength > room || secondLength > room - firstLength)
+    {
+        failed = true;
+        return false;
+    }
+
+    if(ring != nullptr)
+    {
+        ring->write(first, firstLength);
+        if(secondLength > 0)
+        {
+            ring->write(second, secondLength);
+        }
+    }
+    else
+    {
+        memcpy(out + written, first, firstLength);
+        if(secondLength > 0)
+        {
+            memcpy(out + written + firstLength, second, secondLength);
+        }
+    }
+    written += firstLength + secondLength;
+    return true;
+}
+
+void CborReader::attach(const uint8_t *data, size_t dataSize)
+{
+    buffer = data;
+    size = data != nullptr ? dataSize : 0;
+    pos = 0;
+    bad = false;
+}
+
+bool CborReader::readArgument(uint8_t info, uint64_t &value)
+{
+    if(info < 24U)
+    {
+        value = info;
+        return true;
+    }
+    if(info > 27U)
+    {
+        return false;
+    }
+
+    size_t bytes = (size_t)1U << (info - 24U);
+    if(size - pos < bytes)
+    {
+        return false;
+    }
+    value = 0;
+    for(size_t i = 0; i < bytes; i++)
+    {
+        value = (value << 8) | buffer[pos++];
+    }
+    return true;
+}
+
+bool CborReader::next(CborItem &item)
+{
+    if(bad || pos >= size)
+    {
+        return false;
+    }
+
+    size_t start = pos;
+    uint8_t initial = buffer[pos++];
+    uint8_t major = initial >> 5;
+    uint8_t info = initial & 0x1FU;
+    item = CborItem{};
+
+    static const CborType MAJOR_TYPES[] = {
+        CBOR_UNSIGNED, CBOR_NEGATIVE, CBOR_BYTES, CBOR_TEXT, CBOR_ARRAY, CBOR_MAP, CBOR_TAG, CBOR_SIMPLE
+    };
+    item.type = MAJOR_TYPES[major];
+
+    if(info == 31U)
+    {
+        if(major == 7U)
+        {
+            item.type = CBOR_BREAK;
+            return true;
+        }
+        if(major >= 2U && major <= 5U)
+        {
+            item.indefinite = true;
+            return true;
+        }
+        bad = true;
+        pos = start;
+        return false;
+    }
+
+    uint64_t value;
+    if(!readArgument(info, value))
+    {
+        bad = true;
+        pos = start;
+        return false;
+    }
+
+    if(major == 7U)
+    {
+        switch(info)
+        {
+        case 20:
+            item.type = CBOR_FALSE;
+            break;
+        case 21:
+            item.type = CBOR_TRUE;
+            break;
+        case 22:
+            item.type = CBOR_NULL;
+            break;
+        case 23:
+            item.type = CBOR_UNDEFINED;
+            break;
+        case 24:
+            if(value < 32U)             // Two-byte forms of the one-byte simple values are not well-formed
+            {
+                bad = true;
+                pos = start;
+                return false;
+            }
+            item.value = value;
+            break;
+        case 25:
+            item.type = CBOR_FLOAT;
+            item.number = halfToFloat((uint16_t)value);
+            break;
+        case 26:
+        {
+            uint32_t bits = (uint32_t)value;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            item.type = CBOR_FLOAT;
+            item.number = single;
+            break;
+        }
+        case 27:
+            item.type = CBOR_FLOAT;
+            memcpy(&item.number, &value, sizeof(item.number));
+            break;
+        default:
+            item.value = value;
+            break;
+        }
+        return true;
+    }
+
+    item.value = value;
+    if(major == 2U || major == 3U)
+    {
+        if(value > size - pos)
+        {
+            bad = true;
+            pos = start;
+            return false;
+        }
+        item.data = buffer + pos;
+        pos += (size_t)value;
+    }
+    return true;
+}
+
+bool CborReader::skip()
+{
+    // Items still to step over at each level, the item asked for at level 0
+    uint64_t left[CBOR_MAX_DEPTH + 1U];
+    size_t depth = 0;
+    left[0] = 1;
+    size_t start = pos;
+
+    for(;;)
+    {
+        if(left[depth] == 0)
+        {
+            if(depth == 0)
+            {
+                return true;
+            }
+            depth--;
+            continue;
+        }
+
+        CborItem item;
+        if(!next(item))
+        {
+            break;
+        }
+
+        if(item.type == CBOR_BREAK)
+        {
+            if(left[depth] != INDEFINITE_LEFT)
+            {
+                break;
+            }
+            left[depth] = 0;
+            continue;
+        }
+        if(left[depth] != INDEFINITE_LEFT)
+        {
+            left[depth]--;
+        }
+
+        // Every item takes a byte at least, so a count beyond the buffer is a lie
+        uint64_t children = 0;
+        if(!item.indefinite)
+        {
+            if(item.type == CBOR_ARRAY || item.type == CBOR_MAP)
+            {
+                if(item.value > size - pos)
+                {
+                    break;
+                }
+                children = item.type == CBOR_MAP ? 2U * item.value : item.value;
+            }
+            else if(item.type == CBOR_TAG)
+            {
+                children = 1;
+            }
+        }
+
+        if(item.indefinite || children > 0)
+        {
+            if(depth == CBOR_MAX_DEPTH)
+            {
+                break;
+            }
+            left[++depth] = item.indefinite ? INDEFINITE_LEFT : children;
+        }
+    }
+
+    bad = true;
+    pos = start;
+    return false;
+}
+
+bool CborReader::readUnsigned(uint64_t &value)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || item.type != CBOR_UNSIGNED)
+    {
+        pos = start;
+        return false;
+    }
+    value = item.value;
+    return true;
+}
+
+bool CborReader::readInt(int64_t &value)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || (item.type != CBOR_UNSIGNED && item.type != CBOR_NEGATIVE) || item.value > (uint64_t)INT64_MAX)
+    {
+        pos = start;
+        return false;
+    }
+    value = item.type == CBOR_UNSIGNED ? (int64_t)item.value : -1 - (int64_t)item.value;
+    return true;
+}
+
+bool CborReader::readFloat(double &value)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item))
+    {
+        return false;
+    }
+    switch(item.type)
+    {
+    case CBOR_FLOAT:
+        value = item.number;
+        return true;
+    case CBOR_UNSIGNED:
+        value = (double)item.value;
+        return true;
+    case CBOR_NEGATIVE:
+        value = -1.0 - (double)item.value;
+        return true;
+    default:
+        pos = start;
+        return false;
+    }
+}
+
+bool CborReader::readBool(bool &value)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || (item.type != CBOR_FALSE && item.type != CBOR_TRUE))
+    {
+        pos = start;
+        return false;
+    }
+    value = item.type == CBOR_TRUE;
+    return true;
+}
+
+bool CborReader::readText(const char *&text, size_t &length)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || item.type != CBOR_TEXT || item.indefinite)
+    {
+        pos = start;
+        return false;
+    }
+    text = reinterpret_cast<const char *>(item.data);
+    length = (size_t)item.value;
+    return true;
+}
+
+bool CborReader::readBytes(const uint8_t *&data, size_t &length)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || item.type != CBOR_BYTES || item.indefinite)
+    {
+        pos = start;
+        return false;
+    }
+    data = item.data;
+    length = (size_t)item.value;
+    return true;
+}
+
+bool CborReader::readKey(const char *text)
+{
+    size_t start = pos;
+    const char *key;
+    size_t length;
+    if(!readText(key, length))
+    {
+        return false;
+    }
+    if(length != strlen(text) || memcmp(key, text, length) != 0)
+    {
+        pos = start;
+        return false;
+    }
+    return true;
+}
+
+bool CborReader::enterArray(size_t &count)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || item.type != CBOR_ARRAY || item.indefinite || item.value > size - pos)
+    {
+        pos = start;
+        return false;
+    }
+    count = (size_t)item.value;
+    return true;
+}
+
+bool CborReader::enterMap(size_t &pairs)
+{
+    size_t start = pos;
+    CborItem item;
+    if(!next(item) || item.type != CBOR_MAP || item.indefinite || item.value > size - pos)
+    {
+        pos = start;
+        return false;
+    }
+    pairs = (size_t)item.value;
+    return true;
+}
@@ -0,0 +1,376 @@
+/**
+  ******************************************************************************
+  * @file           : channel_mux.cpp
+  * @brief          : Logical channels with priorities and credit flow control over one link
+  ******************************************************************************
+  */
+
+#include "channel_mux.h"
+
+namespace {
+
+// Control frame: channel 0, type, then (channel, limit high, limit low) entries
+const uint8_t controlCredit = 0x01U;
+const uint8_t controlReset = 0x02U;     // Sender restarted, entries carry its fresh windows
+const size_t controlEntrySize = 3U;
+
+// Windows larger than half the counter range would make limits ambiguous
+const uint16_t maxWindow = 0x8000U;
+
+uint16_t creditAvailable(uint16_t limit, uint16_t sent)
+{
+    uint16_t available = (uint16_t)(limit - sent);
+    return available > maxWindow ? 0 : available;
+}
+
+} // namespace
+
+bool ChannelMux::init(const MuxChannelConfig *config, size_t count, uint16_t payload)
+{
+    if(config == nullptr || count == 0 || count > MUX_MAX_CHANNELS || payload == 0 || payload > MUX_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(config[i].id == MUX_CONTROL_CHANNEL || config[i].txBuffer == nullptr || config[i].txSize == 0 ||
+           config[i].rxBuffer == nullptr || config[i].rxSize == 0 || config[i].rxSize > maxWindow)
+        {
+            return false;
+        }
+        for(size_t j = 0; j < i; j++)
+        {
+            if(config[j].id == config[i].id)
+            {
+                return false;
+            }
+        }
+    }
+
+    channelCount = count;
+    maxPayload = payload;
+    lastServed = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        Channel &ch = channels[i];
+        ch = Channel();
+        ch.id = config[i].id;
+        ch.priority = config[i].priority;
+        ch.tx.attach(config[i].txBuffer, config[i].txSize);
+        ch.rx.attach(config[i].rxBuffer, config[i].rxSize);
+    }
+
+    decoder.reset();
+    sendReset();
+    return true;
+}
+
+ChannelMux::Channel *ChannelMux::find(uint8_t id)
+{
+    for(size_t i = 0; i < channelCount; i++)
+    {
+        if(channels[i].id == id)
+        {
+            return &channels[i];
+        }
+    }
+    return nullptr;
+}
+
+const ChannelMux::Channel *ChannelMux::find(uint8_t id) const
+{
+    return const_cast<ChannelMux *>(this)->find(id);
+}
+
+void ChannelMux::sendReset()
+{
+    for(size_t i = 0; i < channelCount; i++)
+    {
+        Channel &ch = channels[i];
+        ch.txSent = 0;
+        ch.txLimit = 0;
+
+        // Unread data stays, only the free space is offered to the peer
+        ch.rxReceived = 0;
+        ch.rxConsumed = (uint16_t)(0U - ch.rx.used());
+        ch.creditDirty = true;
+    }
+    resetPending = true;
+}
+
+void ChannelMux::refreshCredits()
+{
+    for(size_t i = 0; i < channelCount; i++)
+    {
+        updateCredit(channels[i], true);
+    }
+}
+
+void ChannelMux::setRxCallback(MuxRxFn fn, void *ctx)
+{
+    rxCallback = fn;
+    rxContext = ctx;
+}
+
+const MuxChannelStats *ChannelMux::stats(uint8_t channel) const
+{
+    const Channel *ch = find(channel);
+    return ch != nullptr ? &ch->stats : nullptr;
+}
+
+size_t ChannelMux::readable(uint8_t channel) const
+{
+    const Channel *ch = find(channel);
+    return ch != nullptr ? ch->rx.used() : 0;
+}
+
+size_t ChannelMux::writable(uint8_t channel) const
+{
+    const Channel *ch = find(channel);
+    return ch != nullptr ? ch->tx.free() : 0;
+}
+
+size_t ChannelMux::write(uint8_t channel, const uint8_t *data, size_t length)
+{
+    Channel *ch = find(channel);
+    return ch != nullptr ? ch->tx.write(data, length) : 0;
+}
+
+size_t ChannelMux::read(uint8_t channel, uint8_t *dst, size_t size)
+{
+    Channel *ch = find(channel);
+    if(ch == nullptr)
+    {
+        return 0;
+    }
+
+    size_t length = ch->rx.read(dst, size);
+    ch->rxConsumed = (uint16_t)(ch->rxConsumed + length);
+    updateCredit(*ch, false);
+    return length;
+}
+
+void ChannelMux::updateCredit(Channel &ch, bool force)
+{
+    // Batch small updates, a credit frame per read would waste the link
+    uint16_t limit = (uint16_t)(ch.rxConsumed + ch.rx.capacity());
+    uint16_t gained = (uint16_t)(limit - ch.rxAdvertised);
+    if(force || gained >= ch.rx.capacity() / 4U)
+    {
+        ch.creditDirty = true;
+    }
+}
+
+// ===============================
+// Transmit
+// ===============================
+
+size_t ChannelMux::pollControl(uint8_t *payload)
+{
+    size_t length = 2U;
+    payload[0] = MUX_CONTROL_CHANNEL;
+    payload[1] = resetPending ? controlReset : controlCredit;
+
+    for(size_t i = 0; i < channelCount; i++)
+    {
+        Channel &ch = channels[i];
+        if(!ch.creditDirty)
+        {
+            continue;
+        }
+
+        uint16_t limit = (uint16_t)(ch.rxConsumed + ch.rx.capacity());
+        payload[length++] = ch.id;
+        payload[length++] = (uint8_t)(limit >> 8);
+        payload[length++] = (uint8_t)limit;
+    }
+
+    if(length == 2U && !resetPending)
+    {
+        return 0;
+    }
+
+    for(size_t i = 0; i < channelCount; i++)
+    {
+        Channel &ch = channels[i];
+        if(ch.creditDirty)
+        {
+            ch.rxAdvertised = (uint16_t)(ch.rxConsumed + ch.rx.capacity());
+            ch.creditDirty = false;
+        }
+    }
+    resetPending = false;
+    return length;
+}
+
+ChannelMux::Channel *ChannelMux::pickChannel()
+{
+    Channel *best = nullptr;
+    size_t bestIndex = 0;
+
+    // Start after the last served channel so equal priorities take turns
+    for(size_t n = 0; n < channelCount; n++)
+    {
+        size_t i = (lastServed + 1U + n) % channelCount;
+        Channel &ch = channels[i];
+        if(ch.tx.used() == 0)
+        {
+            continue;
+        }
+        if(creditAvailable(ch.txLimit, ch.txSent) == 0)
+        {
+            ch.stats.creditStalls++;
+            continue;
+        }
+        if(best == nullptr || ch.priority < best->priority)
+        {
+            best = &ch;
+            bestIndex = i;
+        }
+    }
+
+    if(best != nullptr)
+    {
+        lastServed = (uint8_t)bestIndex;
+    }
+    return best;
+}
+
+size_t ChannelMux::poll(uint8_t *out, size_t size)
+{
+    if(out == nullptr || size < MUX_FRAME_SIZE(maxPayload))
+    {
+        return 0;
+    }
+
+    // The output holds the largest frame, so encoding cannot fail once a payload is taken
+    uint8_t payload[MUX_PAYLOAD_SIZE(MUX_MAX_PAYLOAD)];
+    size_t length = pollPayload(payload, sizeof(payload));
+    return length != 0 ? frameEncode(payload, length, out, size) : 0;
+}
+
+size_t ChannelMux::pollPayload(uint8_t *out, size_t size)
+{
+    if(out == nullptr || size < MUX_PAYLOAD_SIZE(maxPayload))
+    {
+        return 0;
+    }
+
+    size_t control = pollControl(out);
+    if(control != 0)
+    {
+        return control;
+    }
+
+    Channel *ch = pickChannel();
+    if(ch == nullptr)
+    {
+        return 0;
+    }
+
+    size_t length = ch->tx.used();
+    size_t credit = creditAvailable(ch->txLimit, ch->txSent);
+    if(length > credit)
+    {
+        length = credit;
+    }
+    if(length > maxPayload)
+    {
+        length = maxPayload;
+    }
+
+    out[0] = ch->id;
+    ch->tx.read(&out[1], length);
+    ch->txSent = (uint16_t)(ch->txSent + length);
+    ch->stats.txBytes += length;
+    ch->stats.txFrames++;
+    return length + 1U;
+}
+
+// ===============================
+// Receive
+// ===============================
+
+void ChannelMux::receive(const uint8_t *data, size_t length)
+{
+    for(size_t i = 0; i < length; i++)
+    {
+        if(decoder.push(data[i]) == FrameDecoder::FRAME)
+        {
+            handleFrame(decoder.payload(), decoder.length());
+        }
+    }
+}
+
+void ChannelMux::handleControl(const uint8_t *payload, size_t length)
+{
+    if(length < 2U)
+    {
+        return;
+    }
+
+    if(payload[1] == controlReset)
+    {
+        // The peer restarted: its counters start from zero, ours must follow
+        for(size_t i = 0; i < channelCount; i++)
+        {
+            Channel &ch = channels[i];
+            ch.txSent = 0;
+            ch.txLimit = 0;
+            ch.rxReceived = 0;
+            ch.rxConsumed = (uint16_t)(0U - ch.rx.used());
+            ch.creditDirty = true;
+        }
+    }
+    else if(payload[1] != controlCredit)
+    {
+        return;
+    }
+
+    for(size_t pos = 2U; pos + controlEntrySize <= length; pos += controlEntrySize)
+    {
+        Channel *ch = find(payload[pos]);
+        if(ch != nullptr)
+        {
+            ch->txLimit = (uint16_t)((payload[pos + 1U] << 8) | payload[pos + 2U]);
+        }
+    }
+}
+
+void ChannelMux::handleFrame(const uint8_t *payload, size_t length)
+{
+    if(length == 0)
+    {
+        return;
+    }
+    if(payload[0] == MUX_CONTROL_CHANNEL)
+    {
+        handleControl(payload, length);
+        return;
+    }
+
+    Channel *ch = find(payload[0]);
+    if(ch == nullptr)
+    {
+        return;
+    }
+
+    size_t dataLength = length - 1U;
+    size_t allowed = (uint16_t)(ch->rxConsumed + ch->rx.capacity() - ch->rxReceived);
+    if(allowed > ch->rx.free())
+    {
+        allowed = ch->rx.free();
+    }
+    size_t accepted = dataLength < allowed ? dataLength : allowed;
+
+    ch->rx.write(&payload[1], accepted);
+    ch->rxReceived = (uint16_t)(ch->rxReceived + accepted);
+    ch->stats.rxBytes += accepted;
+    ch->stats.overruns += dataLength - accepted;
+
+    if(accepted > 0 && rxCallback != nullptr)
+    {
+        rxCallback(ch->id, rxContext);
+    }
+}
@@ -0,0 +1,244 @@
+/**
+  ******************************************************************************
+  * @file           : contention_profiler.cpp
+  * @brief          : Wait and hold times of mutexes, semaphores and queues
+  ******************************************************************************
+  */
+
+#include "contention_profiler.h"
+
+namespace {
+
+bool isMutex(uint8_t kind)
+{
+    return kind == CONTENTION_MUTEX || kind == CONTENTION_RECURSIVE_MUTEX;
+}
+
+bool worse(const ContentionFigures &a, const ContentionFigures &b)
+{
+    if(a.waitCycles != b.waitCycles)
+    {
+        return a.waitCycles > b.waitCycles;
+    }
+    if(a.contentions != b.contentions)
+    {
+        return a.contentions > b.contentions;
+    }
+    return a.maxHoldCycles > b.maxHoldCycles;
+}
+
+} // namespace
+
+ContentionProfiler::Entry *ContentionProfiler::lookup(const void *object)
+{
+    for(size_t i = 0; i < objectCount; i++)
+    {
+        if(entries[i].figures.object == object)
+        {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+const ContentionFigures *ContentionProfiler::find(const void *object) const
+{
+    for(size_t i = 0; i < objectCount; i++)
+    {
+        if(entries[i].figures.object == object)
+        {
+            return &entries[i].figures;
+        }
+    }
+    return nullptr;
+}
+
+ContentionProfiler::Waiter *ContentionProfiler::waiterOf(const void *task, const void *object)
+{
+    for(Waiter &waiter : waiters)
+    {
+        if(waiter.task == task && (object == nullptr || waiter.object == object))
+        {
+            return &waiter;
+        }
+    }
+    return nullptr;
+}
+
+bool ContentionProfiler::add(const void *object, const char *name, uint8_t kind, uint32_t length)
+{
+    Entry *entry = lookup(object);
+    if(entry != nullptr)
+    {
+        entry->figures.name = name;
+        return true;
+    }
+    if(object == nullptr || objectCount >= CONTENTION_PROFILER_MAX_OBJECTS)
+    {
+        return false;
+    }
+
+    entry = &entries[objectCount++];
+    *entry = Entry{};
+    entry->figures.object = object;
+    entry->figures.name = name;
+    entry->figures.kind = kind;
+    entry->figures.length = length;
+    return true;
+}
+
+void ContentionProfiler::remove(const void *object)
+{
+    for(Waiter &waiter : waiters)
+    {
+        if(waiter.object == object)
+        {
+            waiter = Waiter{};
+        }
+    }
+
+    for(size_t i = 0; i < objectCount; i++)
+    {
+        if(entries[i].figures.object == object)
+        {
+            for(size_t j = i + 1U; j < objectCount; j++)
+            {
+                entries[j - 1U] = entries[j];
+            }
+            objectCount--;
+            return;
+        }
+    }
+}
+
+void ContentionProfiler::blocked(const void *object, const void *task, bool sending, uint32_t now)
+{
+    Entry *entry = lookup(object);
+    if(entry == nullptr || task == nullptr)
+    {
+        return;
+    }
+
+    // The kernel re-reports the block each time a wait wakes early and goes back to sleep
+    Waiter *waiter = waiterOf(task, nullptr);
+    if(waiter != nullptr && waiter->object == object && waiter->sending == sending)
+    {
+        return;
+    }
+    if(waiter == nullptr)
+    {
+        waiter = waiterOf(nullptr, nullptr);
+    }
+
+    entry->figures.contentions++;
+    if(waiter != nullptr)
+    {
+        *waiter = Waiter{task, object, now, entry->figures.owner, sending};
+    }
+}
+
+void ContentionProfiler::endWait(Entry &entry, const void *task, bool sending, uint32_t now, bool timedOut)
+{
+    Waiter *waiter = task != nullptr ? waiterOf(task, entry.figures.object) : nullptr;
+    if(waiter == nullptr || waiter->sending != sending)
+    {
+        return;
+    }
+
+    ContentionFigures &figures = entry.figures;
+    uint32_t waited = now - waiter->since;
+    figures.waitCycles += waited;
+    figures.timeouts += timedOut ? 1U : 0U;
+    if(waited >= figures.maxWaitCycles)
+    {
+        figures.maxWaitCycles = waited;
+        figures.worstWaiter = task;
+        figures.worstOwner = waiter->ownerAtBlock;
+    }
+    *waiter = Waiter{};
+}
+
+void ContentionProfiler::completed(const void *object, const void *task, bool sending, uint32_t waiting, uint32_t now)
+{
+    Entry *entry = lookup(object);
+    if(entry == nullptr)
+    {
+        return;
+    }
+
+    ContentionFigures &figures = entry->figures;
+    figures.operations++;
+    endWait(*entry, task, sending, now, false);
+
+    if(isMutex(figures.kind))
+    {
+        // A take is a receive, a give a send; recursive takes only report the outermost pair
+        if(!sending)
+        {
+            figures.owner = task;
+            entry->heldSince = now;
+        }
+        else if(figures.owner != nullptr)
+        {
+            uint32_t held = now - entry->heldSince;
+            figures.holds++;
+            figures.holdCycles += held;
+            figures.maxHoldCycles = held > figures.maxHoldCycles ? held : figures.maxHoldCycles;
+            figures.owner = nullptr;
+        }
+    }
+    else if(sending && waiting > figures.highWater)
+    {
+        figures.highWater = waiting;
+    }
+}
+
+void ContentionProfiler::failed(const void *object, const void *task, bool sending, uint32_t now)
+{
+    Entry *entry = lookup(object);
+    if(entry != nullptr)
+    {
+        endWait(*entry, task, sending, now, true);
+    }
+}
+
+size_t ContentionProfiler::rank(const ContentionFigures **out, size_t max) const
+{
+    size_t used = 0;
+    for(size_t i = 0; i < objectCount; i++)
+    {
+        const ContentionFigures *figures = &entries[i].figures;
+
+        // Insertion into the sorted prefix, dropping whatever falls off the end
+        size_t at = used;
+        while(at > 0 && worse(*figures, *out[at - 1U]))
+        {
+            if(at < max)
+            {
+                out[at] = out[at - 1U];
+            }
+            at--;
+        }
+        if(at < max)
+        {
+            out[at] = figures;
+            used += used < max ? 1U : 0U;
+        }
+    }
+    return used;
+}
+
+void ContentionProfiler::reset()
+{
+    for(size_t i = 0; i < objectCount; i++)
+    {
+        ContentionFigures &figures = entries[i].figures;
+        ContentionFigures kept = {};
+        kept.object = figures.object;
+        kept.name = figures.name;
+        kept.kind = figures.kind;
+        kept.length = figures.length;
+        kept.owner = figures.owner;
+        figures = kept;
+    }
+}
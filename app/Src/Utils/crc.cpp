@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file           : crc.cpp
+  * @brief          : Table-free CRC routines shared by storage and protocols
+  ******************************************************************************
+  */
+
+#include "crc.h"
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t length)
+{
+    for(size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)((uint16_t)data[i] << 8);
+        for(uint32_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+    for(size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for(uint32_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 1U) ? ((crc >> 1) ^ 0xEDB88320UL) : (crc >> 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file           : erase_scheduler.cpp
+  * @brief          : Flash page states and the order of background erases
+  ******************************************************************************
+  */
+
+#include "erase_scheduler.h"
+
+#include <string.h>
+
+bool EraseScheduler::init(uint32_t pageCount, uint32_t ahead)
+{
+    if(pageCount == 0 || pageCount > ERASE_SCHEDULER_MAX_PAGES)
+    {
+        return false;
+    }
+
+    memset(states, ERASE_PAGE_UNKNOWN, sizeof(states));
+    pages = pageCount;
+    lookahead = ahead < pageCount ? ahead : pageCount - 1U;
+    head = 0;
+    queuedCount = 0;
+    erasedCount = 0;
+    return true;
+}
+
+void EraseScheduler::set(uint32_t page, ErasePageState state)
+{
+    ErasePageState old = (ErasePageState)states[page];
+    queuedCount -= old == ERASE_PAGE_QUEUED ? 1U : 0U;
+    erasedCount -= old == ERASE_PAGE_ERASED ? 1U : 0U;
+    queuedCount += state == ERASE_PAGE_QUEUED ? 1U : 0U;
+    erasedCount += state == ERASE_PAGE_ERASED ? 1U : 0U;
+    states[page] = state;
+}
+
+void EraseScheduler::checked(uint32_t page, bool erased)
+{
+    if(page < pages && states[page] != ERASE_PAGE_ERASING)
+    {
+        set(page, erased ? ERASE_PAGE_ERASED : ERASE_PAGE_WRITTEN);
+    }
+}
+
+void EraseScheduler::written(uint32_t page)
+{
+    if(page >= pages)
+    {
+        return;
+    }
+
+    set(page, ERASE_PAGE_WRITTEN);
+    head = (page + 1U) % pages;
+    for(uint32_t i = 1; i <= lookahead; i++)
+    {
+        request((page + i) % pages);
+    }
+}
+
+bool EraseScheduler::request(uint32_t page)
+{
+    if(page >= pages)
+    {
+        return false;
+    }
+
+    ErasePageState current = (ErasePageState)states[page];
+    if(current == ERASE_PAGE_ERASED || current == ERASE_PAGE_ERASING)
+    {
+        return false;
+    }
+    set(page, ERASE_PAGE_QUEUED);
+    return true;
+}
+
+bool EraseScheduler::next(uint32_t &page, uint32_t skipFirst, uint32_t skipCount) const
+{
+    if(queuedCount == 0)
+    {
+        return false;
+    }
+
+    // Walk forward from the writer, the first queued page is the one it reaches first
+    for(uint32_t i = 0; i < pages; i++)
+    {
+        uint32_t candidate = (head + i) % pages;
+        bool skipped = candidate >= skipFirst && candidate - skipFirst < skipCount;
+        if(states[candidate] == ERASE_PAGE_QUEUED && !skipped)
+        {
+            page = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void EraseScheduler::started(uint32_t page)
+{
+    if(page < pages)
+    {
+        set(page, ERASE_PAGE_ERASING);
+    }
+}
+
+void EraseScheduler::finished(uint32_t page, bool ok)
+{
+    if(page < pages && states[page] == ERASE_PAGE_ERASING)
+    {
+        set(page, ok ? ERASE_PAGE_ERASED : ERASE_PAGE_UNKNOWN);
+    }
+}
@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file           : frame_codec.cpp
+  * @brief          : COBS framing with CRC-16 for byte-stream links
+  ******************************************************************************
+  */
+
+#include "frame_codec.h"
+#include "crc.h"
+
+namespace {
+
+class CobsWriter
+{
+public:
+    CobsWriter(uint8_t *out, size_t size) : out(out), size(size) {}
+
+    void put(uint8_t byte)
+    {
+        if(byte == 0)
+        {
+            closeBlock();
+            return;
+        }
+
+        if(pos >= size)
+        {
+            overflow = true;
+            return;
+        }
+        out[pos++] = byte;
+        if(++code == 0xFFU)
+        {
+            closeBlock();
+        }
+    }
+
+    /**
+     * @brief Close the last block and append the delimiter
+     * @retval Encoded length, 0 on overflow
+     */
+    size_t finish()
+    {
+        if(overflow || pos >= size)
+        {
+            return 0;
+        }
+        out[codePos] = code;
+        out[pos++] = 0;
+        return pos;
+    }
+
+private:
+    void closeBlock()
+    {
+        if(pos >= size)
+        {
+            overflow = true;
+            return;
+        }
+        out[codePos] = code;
+        codePos = pos++;
+        code = 1;
+    }
+
+    uint8_t *out;
+    size_t size;
+    size_t codePos = 0;
+    size_t pos = 1;
+    uint8_t code = 1;
+    bool overflow = false;
+};
+
+} // namespace
+
+size_t frameEncode(const uint8_t *payload, size_t length, uint8_t *out, size_t size)
+{
+    if(length > FRAME_MAX_PAYLOAD || out == nullptr || size < 2U)
+    {
+        return 0;
+    }
+
+    uint16_t crc = crc16(payload, length);
+    CobsWriter writer(out, size);
+    for(size_t i = 0; i < length; i++)
+    {
+        writer.put(payload[i]);
+    }
+    writer.put((uint8_t)(crc >> 8));
+    writer.put((uint8_t)crc);
+    return writer.finish();
+}
+
+// ===============================
+// Decoder
+// ===============================
+
+void FrameDecoder::reset()
+{
+    fill = 0;
+    blockRemaining = 0;
+    zeroPending = false;
+    discarding = false;
+}
+
+FrameDecoder::Result FrameDecoder::push(uint8_t byte)
+{
+    if(byte == 0)
+    {
+        // Delimiter: validate whatever was collected since the previous one
+        bool wasDiscarding = discarding;
+        bool truncated = blockRemaining != 0;
+        size_t collected = fill;
+        reset();
+
+        if(wasDiscarding)
+        {
+            return ERROR;
+        }
+        if(collected == 0 && !truncated)
+        {
+            // Back-to-back delimiters are idle fill
+            return NONE;
+        }
+        if(truncated || collected < FRAME_CRC_SIZE)
+        {
+            counters.malformed++;
+            return ERROR;
+        }
+
+        size_t payloadLength = collected - FRAME_CRC_SIZE;
+        uint16_t expected = (uint16_t)((buffer[payloadLength] << 8) | buffer[payloadLength + 1U]);
+        if(crc16(buffer, payloadLength) != expected)
+        {
+            counters.crcErrors++;
+            return ERROR;
+        }
+
+        frameLength = payloadLength;
+        counters.frames++;
+        return FRAME;
+    }
+
+    if(discarding)
+    {
+        return NONE;
+    }
+
+    if(blockRemaining == 0)
+    {
+        // Code byte, the previous block ended with an implicit zero unless it was full
+        if(zeroPending)
+        {
+            if(fill >= sizeof(buffer))
+            {
+                counters.overflows++;
+                discarding = true;
+                return NONE;
+            }
+            buffer[fill++] = 0;
+        }
+        blockRemaining = (uint8_t)(byte - 1U);
+        zeroPending = byte != 0xFFU;
+        return NONE;
+    }
+
+    if(fill >= sizeof(buffer))
+    {
+        counters.overflows++;
+        discarding = true;
+        return NONE;
+    }
+    buffer[fill++] = byte;
+    blockRemaining--;
+    return NONE;
+}
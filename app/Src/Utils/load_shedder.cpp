@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file           : load_shedder.cpp
+  * @brief          : Overload controller stepping service levels down and up
+  ******************************************************************************
+  */
+
+#include "load_shedder.h"
+
+bool LoadShedder::addClient(const LoadShedClient &client)
+{
+    if(count >= LOAD_SHED_MAX_CLIENTS || client.apply == nullptr || client.levels == 0)
+    {
+        return false;
+    }
+
+    // Keep the table sorted by order, registration order breaks ties
+    size_t pos = count;
+    while(pos > 0 && clients[pos - 1U].order > client.order)
+    {
+        clients[pos] = clients[pos - 1U];
+        levels[pos] = levels[pos - 1U];
+        pos--;
+    }
+    clients[pos] = client;
+    levels[pos] = 0;
+    count++;
+
+    client.apply(0, client.ctx);
+    distribute();
+    return true;
+}
+
+uint8_t LoadShedder::levelCount() const
+{
+    uint32_t total = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        total += clients[i].levels;
+    }
+    return total > 0xFFU ? 0xFFU : (uint8_t)total;
+}
+
+void LoadShedder::distribute()
+{
+    uint8_t remaining = counters.level;
+    for(size_t i = 0; i < count; i++)
+    {
+        uint8_t wanted = remaining < clients[i].levels ? remaining : clients[i].levels;
+        remaining = (uint8_t)(remaining - wanted);
+        if(wanted != levels[i])
+        {
+            levels[i] = wanted;
+            clients[i].apply(wanted, clients[i].ctx);
+        }
+    }
+}
+
+void LoadShedder::sample(uint32_t loadPermille, uint32_t deadlineMisses)
+{
+    counters.samples++;
+    counters.lastLoadPermille = loadPermille;
+
+    bool overloaded = loadPermille > cfg.shedAbovePermille ||
+                      (cfg.missesToShed > 0 && deadlineMisses >= cfg.missesToShed);
+    bool calm = loadPermille < cfg.restoreBelowPermille && deadlineMisses == 0;
+
+    if(overloaded)
+    {
+        counters.overloadedSamples++;
+        calmRun = 0;
+        if(++overloadedRun >= cfg.shedAfterSamples && counters.level < levelCount())
+        {
+            overloadedRun = 0;
+            counters.level++;
+            counters.sheds++;
+            if(counters.level > counters.peakLevel)
+            {
+                counters.peakLevel = counters.level;
+            }
+            distribute();
+        }
+    }
+    else if(calm)
+    {
+        overloadedRun = 0;
+        if(++calmRun >= cfg.restoreAfterSamples && counters.level > 0)
+        {
+            calmRun = 0;
+            counters.level--;
+            counters.restores++;
+            distribute();
+        }
+    }
+    else
+    {
+        // Between the thresholds: hold the level and restart both runs
+        overloadedRun = 0;
+        calmRun = 0;
+    }
+}
@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file           : log_buffer.cpp
+  * @brief          : Log record queue with per-severity headroom
+  ******************************************************************************
+  */
+
+#include "log_buffer.h"
+
+#include <string.h>
+
+void LogBuffer::attach(uint8_t *storage, size_t storageSize)
+{
+    buffer = storage;
+    size = storageSize;
+    begin = end = count = 0;
+}
+
+void LogBuffer::setReserve(uint8_t severity, size_t bytes)
+{
+    if(severity < LOG_BUFFER_SEVERITIES)
+    {
+        reserve[severity] = bytes;
+    }
+}
+
+size_t LogBuffer::limit(uint8_t severity) const
+{
+    return reserve[severity] >= size ? 0 : size - reserve[severity];
+}
+
+void LogBuffer::compact()
+{
+    if(begin > 0)
+    {
+        memmove(buffer, buffer + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+}
+
+bool LogBuffer::evictBelow(uint8_t severity)
+{
+    // Oldest record of the least severe level present
+    size_t victim = end;
+    uint8_t lowest = severity;
+    for(size_t pos = begin; pos < end; pos += HEADER + buffer[pos + 1U])
+    {
+        if(buffer[pos] < lowest)
+        {
+            lowest = buffer[pos];
+            victim = pos;
+        }
+    }
+    if(victim == end)
+    {
+        return false;
+    }
+
+    size_t recordSize = HEADER + buffer[victim + 1U];
+    if(victim == begin)
+    {
+        begin += recordSize;
+    }
+    else
+    {
+        memmove(buffer + victim, buffer + victim + recordSize, end - victim - recordSize);
+        end -= recordSize;
+    }
+    count--;
+    if(count == 0)
+    {
+        begin = end = 0;
+    }
+
+    shedPending[lowest]++;
+    shedTotal[lowest]++;
+    return true;
+}
+
+bool LogBuffer::push(uint8_t severity, const char *text, size_t length)
+{
+    if(buffer == nullptr)
+    {
+        return false;
+    }
+    if(severity >= LOG_BUFFER_SEVERITIES)
+    {
+        severity = LOG_BUFFER_SEVERITIES - 1U;
+    }
+    if(length > LOG_BUFFER_TEXT_MAX)
+    {
+        length = LOG_BUFFER_TEXT_MAX;
+    }
+
+    size_t need = HEADER + length;
+    while(used() + need > limit(severity))
+    {
+        if(!evictBelow(severity))
+        {
+            shedPending[severity]++;
+            shedTotal[severity]++;
+            return false;
+        }
+    }
+
+    if(end + need > size)
+    {
+        compact();
+    }
+    buffer[end] = severity;
+    buffer[end + 1U] = (uint8_t)length;
+    memcpy(buffer + end + HEADER, text, length);
+    end += need;
+    count++;
+    return true;
+}
+
+size_t LogBuffer::frontLength() const
+{
+    return count == 0 ? 0 : buffer[begin + 1U];
+}
+
+size_t LogBuffer::pop(uint8_t &severity, char *dst, size_t dstSize)
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    severity = buffer[begin];
+    size_t length = buffer[begin + 1U];
+    size_t copied = length < dstSize ? length : dstSize;
+    memcpy(dst, buffer + begin + HEADER, copied);
+
+    begin += HEADER + length;
+    count--;
+    if(count == 0)
+    {
+        begin = end = 0;
+    }
+    return copied;
+}
+
+bool LogBuffer::takeShed(uint32_t counts[LOG_BUFFER_SEVERITIES])
+{
+    bool any = false;
+    for(size_t i = 0; i < LOG_BUFFER_SEVERITIES; i++)
+    {
+        counts[i] = shedPending[i];
+        any = any || shedPending[i] != 0;
+        shedPending[i] = 0;
+    }
+    return any;
+}
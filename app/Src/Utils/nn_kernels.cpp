@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file           : nn_kernels.cpp
+  * @brief          : Int8 quantised inference kernels
+  ******************************************************************************
+  */
+
+#include "nn_kernels.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#define NN_SIMD 1
+#else
+#define NN_SIMD 0
+#endif
+
+int32_t nnDot(const int8_t *a, const int8_t *b, size_t n)
+{
+    int32_t acc = 0;
+    size_t i = 0;
+
+#if NN_SIMD
+    // Bytes 0 and 2, then 1 and 3, as halfword pairs; the pair order is the same on both sides
+    for(; i + 4U <= n; i += 4U)
+    {
+        uint32_t wa;
+        uint32_t wb;
+        memcpy(&wa, a + i, sizeof(wa));
+        memcpy(&wb, b + i, sizeof(wb));
+        acc = __smlad(__sxtb16(wa), __sxtb16(wb), acc);
+        acc = __smlad(__sxtb16(__ror(wa, 8)), __sxtb16(__ror(wb, 8)), acc);
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        acc += (int32_t)a[i] * b[i];
+    }
+    return acc;
+}
+
+void nnDense(const int8_t *in, size_t size, const int8_t *weights, const int32_t *bias,
+             size_t outputs, const NnRequant &rq, int8_t *out)
+{
+    for(size_t o = 0; o < outputs; o++)
+    {
+        int32_t acc = bias[o] + nnDot(in, weights + o * size, size);
+        out[o] = nnRequantize(acc, rq, o);
+    }
+}
+
+void nnConv1d(const int8_t *in, size_t length, size_t channels, const int8_t *weights, const int32_t *bias,
+              size_t filters, size_t kernel, size_t stride, const NnRequant &rq, int8_t *out)
+{
+    size_t outLength = nnOutLength(length, kernel, stride);
+    size_t window = kernel * channels;
+    for(size_t p = 0; p < outLength; p++)
+    {
+        const int8_t *x = in + p * stride * channels;
+        for(size_t f = 0; f < filters; f++)
+        {
+            int32_t acc = bias[f] + nnDot(x, weights + f * window, window);
+            *out++ = nnRequantize(acc, rq, f);
+        }
+    }
+}
+
+void nnDepthwiseConv1d(const int8_t *in, size_t length, size_t channels, const int8_t *weights, const int32_t *bias,
+                       size_t kernel, size_t stride, const NnRequant &rq, int8_t *out)
+{
+    // Channels are independent, so SMLAD's pairwise sums do not apply: one MAC per tap
+    size_t outLength = nnOutLength(length, kernel, stride);
+    for(size_t p = 0; p < outLength; p++)
+    {
+        const int8_t *x = in + p * stride * channels;
+        for(size_t c = 0; c < channels; c++)
+        {
+            int32_t acc = bias[c];
+            for(size_t k = 0; k < kernel; k++)
+            {
+                acc += (int32_t)x[k * channels + c] * weights[k * channels + c];
+            }
+            *out++ = nnRequantize(acc, rq, c);
+        }
+    }
+}
+
+void nnMaxPool1d(const int8_t *in, size_t length, size_t channels, size_t pool, size_t stride, int8_t *out)
+{
+    size_t outLength = nnOutLength(length, pool, stride);
+    for(size_t p = 0; p < outLength; p++)
+    {
+        const int8_t *x = in + p * stride * channels;
+        for(size_t c = 0; c < channels; c++)
+        {
+            int8_t best = x[c];
+            for(size_t k = 1; k < pool; k++)
+            {
+                int8_t v = x[k * channels + c];
+                best = v > best ? v : best;
+            }
+            *out++ = best;
+        }
+    }
+}
+
+void nnAvgPool1d(const int8_t *in, size_t length, size_t channels, size_t pool, size_t stride, int8_t *out)
+{
+    size_t outLength = nnOutLength(length, pool, stride);
+    int32_t half = (int32_t)(pool / 2U);
+    for(size_t p = 0; p < outLength; p++)
+    {
+        const int8_t *x = in + p * stride * channels;
+        for(size_t c = 0; c < channels; c++)
+        {
+            int32_t sum = 0;
+            for(size_t k = 0; k < pool; k++)
+            {
+                sum += x[k * channels + c];
+            }
+            // Round half away from zero, so the division is symmetric about 0
+            *out++ = (int8_t)(sum >= 0 ? (sum + half) / (int32_t)pool : (sum - half) / (int32_t)pool);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file           : nn_model.cpp
+  * @brief          : Layer chains of int8 kernels with an arena planned at compile time
+  ******************************************************************************
+  */
+
+#include "nn_model.h"
+
+#include <math.h>
+
+int8_t nnQuantize(float value, float scale, int32_t zero)
+{
+    long q = lroundf(value / scale) + zero;
+    return q < INT8_MIN ? INT8_MIN : q > INT8_MAX ? INT8_MAX : (int8_t)q;
+}
+
+void nnInvoke(const NnModel &model, uint8_t *arena)
+{
+    for(size_t i = 0; i < model.count; i++)
+    {
+        const NnLayer &layer = model.layers[i];
+        const int8_t *in = reinterpret_cast<const int8_t *>(arena + model.offsets[i]);
+        int8_t *out = reinterpret_cast<int8_t *>(arena + model.offsets[i + 1U]);
+
+        switch(layer.op)
+        {
+            case NN_OP_DENSE:
+                nnDense(in, nnInputBytes(layer), layer.weights, layer.bias, layer.outChannels, layer.requant, out);
+                break;
+            case NN_OP_CONV1D:
+                nnConv1d(in, layer.length, layer.channels, layer.weights, layer.bias,
+                         layer.outChannels, layer.kernel, layer.stride, layer.requant, out);
+                break;
+            case NN_OP_DEPTHWISE_CONV1D:
+                nnDepthwiseConv1d(in, layer.length, layer.channels, layer.weights, layer.bias,
+                                  layer.kernel, layer.stride, layer.requant, out);
+                break;
+            case NN_OP_MAX_POOL1D:
+                nnMaxPool1d(in, layer.length, layer.channels, layer.kernel, layer.stride, out);
+                break;
+            case NN_OP_AVG_POOL1D:
+                nnAvgPool1d(in, layer.length, layer.channels, layer.kernel, layer.stride, out);
+                break;
+        }
+    }
+}
+
+size_t nnArgMax(const NnModel &model, const uint8_t *arena)
+{
+    const int8_t *out = nnOutput(model, arena);
+    size_t outputs = nnOutputBytes(model.layers[model.count - 1U]);
+    size_t best = 0;
+    for(size_t i = 1; i < outputs; i++)
+    {
+        best = out[i] > out[best] ? i : best;
+    }
+    return best;
+}
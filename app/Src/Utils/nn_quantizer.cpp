@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file           : nn_quantizer.cpp
+  * @brief          : Float layers to the int8 form of nn_model.h
+  ******************************************************************************
+  */
+
+#include "nn_quantizer.h"
+
+#include <math.h>
+
+namespace {
+
+int32_t clampInt32(double v)
+{
+    return v >= 2147483647.0 ? INT32_MAX : v <= -2147483648.0 ? INT32_MIN : (int32_t)v;
+}
+
+} // namespace
+
+NnTensorQuant nnChooseQuant(float min, float max)
+{
+    min = min < 0.0f ? min : 0.0f;
+    max = max > 0.0f ? max : 0.0f;
+    if(max - min <= 0.0f)
+    {
+        return NnTensorQuant{1.0f, 0};
+    }
+
+    float scale = (max - min) / 255.0f;
+    long zero = lroundf(-128.0f - min / scale);
+    zero = zero < INT8_MIN ? INT8_MIN : zero > INT8_MAX ? INT8_MAX : zero;
+    return NnTensorQuant{scale, (int32_t)zero};
+}
+
+void nnQuantizeMultiplier(double real, int32_t *multiplier, int8_t *shift)
+{
+    if(real <= 0.0)
+    {
+        *multiplier = 0;
+        *shift = 0;
+        return;
+    }
+
+    int exponent = 0;
+    double mantissa = frexp(real, &exponent);
+    long long q = llround(mantissa * 2147483648.0);
+    if(q == 2147483648LL)
+    {
+        q /= 2;
+        exponent++;
+    }
+    if(exponent < -31)
+    {
+        // Below one output step for any int32 accumulator
+        q = 0;
+        exponent = 0;
+    }
+    else if(exponent > 30)
+    {
+        q = INT32_MAX;
+        exponent = 30;
+    }
+    *multiplier = (int32_t)q;
+    *shift = (int8_t)exponent;
+}
+
+bool nnQuantizeLayer(const NnFloatLayer &src, NnTensorQuant in, NnTensorQuant out,
+                     int8_t *weights, int32_t *bias, int32_t *multiplier, int8_t *shift, NnLayer &dst)
+{
+    dst = NnLayer{};
+    dst.op = src.op;
+    dst.length = src.length;
+    dst.channels = src.channels;
+    dst.outChannels = src.outChannels;
+    dst.kernel = src.op == NN_OP_DENSE ? 1U : src.kernel;
+    dst.stride = src.op == NN_OP_DENSE ? 1U : src.stride;
+
+    if(src.op == NN_OP_MAX_POOL1D || src.op == NN_OP_AVG_POOL1D)
+    {
+        return in.scale == out.scale && in.zero == out.zero;
+    }
+
+    // Per channel: the weights of channel c sit at first + c * step + i * spread for i < count
+    size_t channels = src.outChannels;
+    size_t count = nnWeightCount(src) / channels;
+    size_t step = src.op == NN_OP_DEPTHWISE_CONV1D ? 1U : count;
+    size_t spread = src.op == NN_OP_DEPTHWISE_CONV1D ? channels : 1U;
+
+    for(size_t c = 0; c < channels; c++)
+    {
+        float largest = 0.0f;
+        for(size_t i = 0; i < count; i++)
+        {
+            float w = fabsf(src.weights[c * step + i * spread]);
+            largest = w > largest ? w : largest;
+        }
+        float wScale = largest > 0.0f ? largest / 127.0f : 1.0f;
+
+        int32_t sum = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            size_t at = c * step + i * spread;
+            long q = lroundf(src.weights[at] / wScale);
+            q = q < -127 ? -127 : q > 127 ? 127 : q;
+            weights[at] = (int8_t)q;
+            sum += (int32_t)q;
+        }
+
+        double accScale = (double)in.scale * wScale;
+        bias[c] = clampInt32(llround((double)src.bias[c] / accScale) - (double)in.zero * sum);
+        nnQuantizeMultiplier(accScale / out.scale, &multiplier[c], &shift[c]);
+    }
+
+    dst.weights = weights;
+    dst.bias = bias;
+    dst.requant.multiplier = multiplier;
+    dst.requant.shift = shift;
+    dst.requant.outZero = out.zero;
+    dst.requant.min = (int8_t)(src.relu && out.zero > INT8_MIN ? out.zero : INT8_MIN);
+    dst.requant.max = INT8_MAX;
+    return true;
+}
@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file           : nn_reference.cpp
+  * @brief          : Float reference of the nn_kernels.h layers
+  ******************************************************************************
+  */
+
+#include "nn_reference.h"
+
+namespace {
+
+float activate(const NnFloatLayer &layer, float v)
+{
+    return layer.relu && v < 0.0f ? 0.0f : v;
+}
+
+void widen(NnRange *range, const float *values, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        range->min = values[i] < range->min ? values[i] : range->min;
+        range->max = values[i] > range->max ? values[i] : range->max;
+    }
+}
+
+} // namespace
+
+void nnReferenceLayer(const NnFloatLayer &layer, const float *in, float *out)
+{
+    size_t outLength = nnOutLength(layer);
+    size_t channels = layer.channels;
+
+    switch(layer.op)
+    {
+        case NN_OP_DENSE:
+        {
+            size_t size = (size_t)layer.length * channels;
+            for(size_t o = 0; o < layer.outChannels; o++)
+            {
+                float acc = layer.bias[o];
+                for(size_t i = 0; i < size; i++)
+                {
+                    acc += in[i] * layer.weights[o * size + i];
+                }
+                out[o] = activate(layer, acc);
+            }
+            break;
+        }
+        case NN_OP_CONV1D:
+        {
+            size_t window = (size_t)layer.kernel * channels;
+            for(size_t p = 0; p < outLength; p++)
+            {
+                const float *x = in + p * layer.stride * channels;
+                for(size_t f = 0; f < layer.outChannels; f++)
+                {
+                    float acc = layer.bias[f];
+                    for(size_t i = 0; i < window; i++)
+                    {
+                        acc += x[i] * layer.weights[f * window + i];
+                    }
+                    *out++ = activate(layer, acc);
+                }
+            }
+            break;
+        }
+        case NN_OP_DEPTHWISE_CONV1D:
+            for(size_t p = 0; p < outLength; p++)
+            {
+                const float *x = in + p * layer.stride * channels;
+                for(size_t c = 0; c < channels; c++)
+                {
+                    float acc = layer.bias[c];
+                    for(size_t k = 0; k < layer.kernel; k++)
+                    {
+                        acc += x[k * channels + c] * layer.weights[k * channels + c];
+                    }
+                    *out++ = activate(layer, acc);
+                }
+            }
+            break;
+        case NN_OP_MAX_POOL1D:
+        case NN_OP_AVG_POOL1D:
+            for(size_t p = 0; p < outLength; p++)
+            {
+                const float *x = in + p * layer.stride * channels;
+                for(size_t c = 0; c < channels; c++)
+                {
+                    float v = x[c];
+                    for(size_t k = 1; k < layer.kernel; k++)
+                    {
+                        float next = x[k * channels + c];
+                        v = layer.op == NN_OP_AVG_POOL1D ? v + next : (next > v ? next : v);
+                    }
+                    *out++ = layer.op == NN_OP_AVG_POOL1D ? v / (float)layer.kernel : v;
+                }
+            }
+            break;
+    }
+}
+
+size_t nnLargestTensor(const NnFloatLayer *layers, size_t count)
+{
+    size_t largest = count == 0 ? 0U : (size_t)layers[0].length * layers[0].channels;
+    for(size_t i = 0; i < count; i++)
+    {
+        largest = nnOutputSize(layers[i]) > largest ? nnOutputSize(layers[i]) : largest;
+    }
+    return largest;
+}
+
+const float *nnReferenceInvoke(const NnFloatLayer *layers, size_t count, const float *input,
+                               float *scratch, NnRange *ranges)
+{
+    size_t largest = nnLargestTensor(layers, count);
+    if(ranges != nullptr && count != 0)
+    {
+        widen(&ranges[0], input, (size_t)layers[0].length * layers[0].channels);
+    }
+
+    const float *in = input;
+    for(size_t i = 0; i < count; i++)
+    {
+        float *out = scratch + (i % 2U) * largest;
+        nnReferenceLayer(layers[i], in, out);
+        if(ranges != nullptr)
+        {
+            widen(&ranges[i + 1U], out, nnOutputSize(layers[i]));
+        }
+        in = out;
+    }
+    return in;
+}
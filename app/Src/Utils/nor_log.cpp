@@ -0,0 +1,308 @@
+/**
+  ******************************************************************************
+  * @file           : nor_log.cpp
+  * @brief          : Log-structured record storage on NOR flash
+  ******************************************************************************
+  */
+
+#include "nor_log.h"
+#include "crc.h"
+
+#include <string.h>
+
+namespace {
+
+const uint32_t sectorMagic = 0x474F4C4EUL;   // "NLOG"
+const uint16_t erasedLength = 0xFFFFU;
+
+uint32_t recordFootprint(uint32_t length)
+{
+    return (NOR_LOG_RECORD_HEADER_SIZE + length + 3U) & ~3UL;
+}
+
+void putLe16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+}
+
+void putLe32(uint8_t *dst, uint32_t value)
+{
+    putLe16(dst, (uint16_t)value);
+    putLe16(dst + 2, (uint16_t)(value >> 16));
+}
+
+uint16_t getLe16(const uint8_t *src)
+{
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+uint32_t getLe32(const uint8_t *src)
+{
+    return (uint32_t)getLe16(src) | ((uint32_t)getLe16(src + 2) << 16);
+}
+
+} // namespace
+
+// ===============================
+// Cursor
+// ===============================
+
+bool NorLogCursor::next(NorLogRecord &record)
+{
+    while(log != nullptr && sectorsLeft > 0)
+    {
+        const NorFlash &device = log->device;
+        uint32_t limit = (sectorsLeft == 1U) ? log->headOffset : device.sectorSize;
+
+        uint8_t header[NOR_LOG_RECORD_HEADER_SIZE];
+        uint16_t length = erasedLength;
+        if(offset + NOR_LOG_RECORD_HEADER_SIZE <= limit &&
+           device.read(device.ctx, log->sectorAddress(sector) + offset, header, sizeof(header)))
+        {
+            length = getLe16(header);
+        }
+
+        if(length == erasedLength || length > device.sectorSize - offset - NOR_LOG_RECORD_HEADER_SIZE)
+        {
+            // End of this sector's records, continue with the next newer one
+            sector = (sector + 1U) % log->sectorCount;
+            sectorsLeft--;
+            offset = NOR_LOG_SECTOR_HEADER_SIZE;
+            continue;
+        }
+
+        record.address = log->sectorAddress(sector) + offset + NOR_LOG_RECORD_HEADER_SIZE;
+        record.length = length;
+
+        uint16_t crc = CRC16_INIT;
+        if(device.mapped != nullptr)
+        {
+            crc = crc16Update(crc, device.mapped + record.address, length);
+        }
+        else
+        {
+            uint8_t chunk[64];
+            for(uint32_t done = 0; done < length; done += sizeof(chunk))
+            {
+                uint32_t part = (length - done < sizeof(chunk)) ? (length - done) : sizeof(chunk);
+                if(!device.read(device.ctx, record.address + done, chunk, part))
+                {
+                    break;
+                }
+                crc = crc16Update(crc, chunk, part);
+            }
+        }
+        record.valid = (crc == getLe16(header + 2));
+        if(!record.valid)
+        {
+            log->counters.corruptRecords++;
+        }
+
+        offset += recordFootprint(length);
+        return true;
+    }
+    return false;
+}
+
+// ===============================
+// Log
+// ===============================
+
+bool NorLog::mount(const NorFlash &flash)
+{
+    if(flash.read == nullptr || flash.program == nullptr || flash.eraseSector == nullptr ||
+       flash.sectorSize < 64U || (flash.size % flash.sectorSize) != 0U || flash.size / flash.sectorSize < 2U)
+    {
+        return false;
+    }
+
+    device = flash;
+    sectorCount = device.size / device.sectorSize;
+    memset(&counters, 0, sizeof(counters));
+
+    bool found = false;
+    uint32_t sequence = 0;
+    for(uint32_t sector = 0; sector < sectorCount; sector++)
+    {
+        uint32_t candidate;
+        if(readSectorSequence(sector, candidate) && (!found || candidate > sequence))
+        {
+            found = true;
+            sequence = candidate;
+            head = sector;
+        }
+    }
+
+    if(!found)
+    {
+        return format();
+    }
+
+    // Sectors are used in order, so the live ones form a run ending at the head
+    headSequence = sequence;
+    tail = head;
+    for(uint32_t i = 1; i < sectorCount; i++)
+    {
+        uint32_t previous = (head + sectorCount - i) % sectorCount;
+        uint32_t candidate;
+        if(!readSectorSequence(previous, candidate) || candidate != sequence - i)
+        {
+            break;
+        }
+        tail = previous;
+    }
+
+    headOffset = scanWriteOffset(head);
+    return true;
+}
+
+bool NorLog::format()
+{
+    for(uint32_t sector = 0; sector < sectorCount; sector++)
+    {
+        if(!device.eraseSector(device.ctx, sectorAddress(sector)))
+        {
+            return false;
+        }
+        counters.erasedSectors++;
+    }
+    tail = 0;
+    return startSector(0, 1);
+}
+
+bool NorLog::append(const uint8_t *data, uint16_t length)
+{
+    if(sectorCount == 0 || length > maxRecordLength() || (data == nullptr && length > 0))
+    {
+        return false;
+    }
+
+    uint32_t footprint = recordFootprint(length);
+    if(headOffset + footprint > device.sectorSize)
+    {
+        uint32_t next = (head + 1U) % sectorCount;
+        if(next == tail)
+        {
+            // Device full: reclaim the oldest sector
+            tail = (tail + 1U) % sectorCount;
+            counters.droppedSectors++;
+        }
+        if(!device.eraseSector(device.ctx, sectorAddress(next)))
+        {
+            return false;
+        }
+        counters.erasedSectors++;
+        if(!startSector(next, headSequence + 1U))
+        {
+            return false;
+        }
+    }
+
+    // Header first: a torn payload then fails its CRC instead of looking erased
+    uint8_t header[NOR_LOG_RECORD_HEADER_SIZE];
+    putLe16(header, length);
+    putLe16(header + 2, crc16(data, length));
+
+    uint32_t address = sectorAddress(head) + headOffset;
+    headOffset += footprint;
+    if(!device.program(device.ctx, address, header, sizeof(header)))
+    {
+        return false;
+    }
+    if(length > 0 && !device.program(device.ctx, address + NOR_LOG_RECORD_HEADER_SIZE, data, length))
+    {
+        return false;
+    }
+
+    counters.appendedRecords++;
+    counters.appendedBytes += length;
+    return true;
+}
+
+NorLogCursor NorLog::records()
+{
+    NorLogCursor cursor;
+    if(sectorCount > 0)
+    {
+        cursor.log = this;
+        cursor.sectorsLeft = (head + sectorCount - tail) % sectorCount + 1U;
+        cursor.sector = tail;
+        cursor.offset = NOR_LOG_SECTOR_HEADER_SIZE;
+    }
+    return cursor;
+}
+
+uint16_t NorLog::read(const NorLogRecord &record, uint8_t *data, uint16_t size) const
+{
+    uint16_t length = (record.length < size) ? record.length : size;
+    if(length == 0 || !device.read(device.ctx, record.address, data, length))
+    {
+        return 0;
+    }
+    return length;
+}
+
+const uint8_t *NorLog::mapped(const NorLogRecord &record) const
+{
+    return (device.mapped != nullptr) ? device.mapped + record.address : nullptr;
+}
+
+uint16_t NorLog::maxRecordLength() const
+{
+    uint32_t limit = device.sectorSize - NOR_LOG_SECTOR_HEADER_SIZE - NOR_LOG_RECORD_HEADER_SIZE;
+    return (limit < erasedLength) ? (uint16_t)limit : (uint16_t)(erasedLength - 1U);
+}
+
+bool NorLog::startSector(uint32_t sector, uint32_t sequence)
+{
+    uint8_t header[NOR_LOG_SECTOR_HEADER_SIZE];
+    putLe32(header, sectorMagic);
+    putLe32(header + 4, sequence);
+    if(!device.program(device.ctx, sectorAddress(sector), header, sizeof(header)))
+    {
+        return false;
+    }
+
+    head = sector;
+    headOffset = NOR_LOG_SECTOR_HEADER_SIZE;
+    headSequence = sequence;
+    return true;
+}
+
+bool NorLog::readSectorSequence(uint32_t sector, uint32_t &sequence) const
+{
+    uint8_t header[NOR_LOG_SECTOR_HEADER_SIZE];
+    if(!device.read(device.ctx, sectorAddress(sector), header, sizeof(header)) ||
+       getLe32(header) != sectorMagic)
+    {
+        return false;
+    }
+    sequence = getLe32(header + 4);
+    return sequence != 0xFFFFFFFFUL;
+}
+
+uint32_t NorLog::scanWriteOffset(uint32_t sector) const
+{
+    uint32_t offset = NOR_LOG_SECTOR_HEADER_SIZE;
+    while(offset + NOR_LOG_RECORD_HEADER_SIZE <= device.sectorSize)
+    {
+        uint8_t header[NOR_LOG_RECORD_HEADER_SIZE];
+        if(!device.read(device.ctx, sectorAddress(sector) + offset, header, sizeof(header)))
+        {
+            return device.sectorSize;
+        }
+        uint16_t length = getLe16(header);
+        if(length == erasedLength)
+        {
+            return offset;
+        }
+        if(length > device.sectorSize - offset - NOR_LOG_RECORD_HEADER_SIZE)
+        {
+            // Garbage length: the rest of the sector cannot be trusted for writing
+            return device.sectorSize;
+        }
+        offset += recordFootprint(length);
+    }
+    return device.sectorSize;
+}
@@ -0,0 +1,624 @@
+/**
+  ******************************************************************************
+  * @file           : time_series.cpp
+  * @brief          : Compressed time-series store for sensor history
+  ******************************************************************************
+  */
+
+#include "time_series.h"
+
+#include <string.h>
+
+namespace {
+
+// Worst case encoding of one sample: 4 + 32 timestamp bits, 2 + 5 + 5 + 32 float bits
+const size_t maxSampleBits = 80U;
+const uint8_t noWindow = 0xFFU;
+
+uint32_t leadingZeros(uint32_t value)
+{
+    return (value == 0U) ? 32U : (uint32_t)__builtin_clz(value);
+}
+
+uint32_t trailingZeros(uint32_t value)
+{
+    return (value == 0U) ? 32U : (uint32_t)__builtin_ctz(value);
+}
+
+} // namespace
+
+float TsSample::asFloat() const
+{
+    float value;
+    memcpy(&value, &raw, sizeof(value));
+    return value;
+}
+
+// ===============================
+// Block encoder
+// ===============================
+
+void TsBlockEncoder::begin(uint8_t *blockData, size_t size, TsValueType valueType)
+{
+    block = blockData;
+    type = valueType;
+    samples = 0;
+    previousTimestamp = 0;
+    previousDelta = 0;
+    previousValue = 0;
+    previousLeading = noWindow;
+    previousTrailing = 0;
+
+    memset(block, 0, size);
+    writer.attach(block + TS_BLOCK_HEADER_SIZE, size - TS_BLOCK_HEADER_SIZE);
+    updateHeader();
+}
+
+bool TsBlockEncoder::append(uint32_t timestamp, uint32_t raw)
+{
+    if(samples == UINT16_MAX || writer.remainingBits() < maxSampleBits)
+    {
+        return false;
+    }
+    if(samples > 0 && timestamp < previousTimestamp)
+    {
+        return false;
+    }
+
+    if(samples == 0)
+    {
+        // First sample: timestamp lives in the header, value is stored verbatim
+        TsBlockHeader header;
+        memcpy(&header, block, sizeof(header));
+        header.firstTimestamp = timestamp;
+        memcpy(block, &header, sizeof(header));
+        writer.write(raw, 32);
+    }
+    else
+    {
+        writeTimestamp(timestamp);
+        if(type == TsValueType::Float)
+        {
+            writeFloat(raw);
+        }
+        else
+        {
+            writeInt(raw);
+        }
+    }
+
+    previousTimestamp = timestamp;
+    previousValue = raw;
+    samples++;
+    updateHeader();
+    return true;
+}
+
+uint16_t TsBlockEncoder::count() const
+{
+    return samples;
+}
+
+size_t TsBlockEncoder::usedBytes() const
+{
+    return TS_BLOCK_HEADER_SIZE + (writer.bitPosition() + 7U) / 8U;
+}
+
+void TsBlockEncoder::writeTimestamp(uint32_t timestamp)
+{
+    int64_t delta = (int64_t)timestamp - (int64_t)previousTimestamp;
+    int64_t deltaOfDelta = delta - previousDelta;
+
+    if(deltaOfDelta == 0)
+    {
+        writer.write(0x0U, 1);
+    }
+    else if(deltaOfDelta >= -63 && deltaOfDelta <= 64)
+    {
+        writer.write(0x2U, 2);
+        writer.write((uint64_t)(deltaOfDelta + 63), 7);
+    }
+    else if(deltaOfDelta >= -255 && deltaOfDelta <= 256)
+    {
+        writer.write(0x6U, 3);
+        writer.write((uint64_t)(deltaOfDelta + 255), 9);
+    }
+    else if(deltaOfDelta >= -2047 && deltaOfDelta <= 2048)
+    {
+        writer.write(0xEU, 4);
+        writer.write((uint64_t)(deltaOfDelta + 2047), 12);
+    }
+    else
+    {
+        // Escape: store the plain delta, which always fits in 32 bits
+        writer.write(0xFU, 4);
+        writer.write((uint64_t)delta, 32);
+    }
+
+    previousDelta = delta;
+}
+
+void TsBlockEncoder::writeFloat(uint32_t raw)
+{
+    uint32_t xored = raw ^ previousValue;
+    if(xored == 0U)
+    {
+        writer.write(0x0U, 1);
+        return;
+    }
+
+    uint32_t leading = leadingZeros(xored);
+    uint32_t trailing = trailingZeros(xored);
+
+    if(previousLeading != noWindow && leading >= previousLeading && trailing >= previousTrailing)
+    {
+        // Meaningful bits fit in the previous window
+        uint32_t meaningful = 32U - previousLeading - previousTrailing;
+        writer.write(0x2U, 2);
+        writer.write(xored >> previousTrailing, meaningful);
+    }
+    else
+    {
+        uint32_t meaningful = 32U - leading - trailing;
+        writer.write(0x3U, 2);
+        writer.write(leading, 5);
+        writer.write(meaningful - 1U, 5);
+        writer.write(xored >> trailing, meaningful);
+        previousLeading = (uint8_t)leading;
+        previousTrailing = (uint8_t)trailing;
+    }
+}
+
+void TsBlockEncoder::writeInt(uint32_t raw)
+{
+    int64_t delta = (int64_t)(int32_t)raw - (int64_t)(int32_t)previousValue;
+    if(delta == 0)
+    {
+        writer.write(0x0U, 1);
+        return;
+    }
+
+    // Zigzag keeps small negative deltas short, then 7 bits per varint group
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    writer.write(0x1U, 1);
+    while(zigzag >= 0x80U)
+    {
+        writer.write((zigzag & 0x7FU) | 0x80U, 8);
+        zigzag >>= 7;
+    }
+    writer.write(zigzag, 8);
+}
+
+void TsBlockEncoder::updateHeader()
+{
+    TsBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    header.lastTimestamp = previousTimestamp;
+    header.count = samples;
+    header.bitLength = (uint16_t)writer.bitPosition();
+    header.type = (uint8_t)type;
+    memcpy(block, &header, sizeof(header));
+}
+
+// ===============================
+// Block decoder
+// ===============================
+
+bool TsBlockDecoder::begin(const uint8_t *block, size_t size)
+{
+    if(block == nullptr || size < TS_BLOCK_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    memcpy(&blockHeader, block, sizeof(blockHeader));
+    if(blockHeader.bitLength > (size - TS_BLOCK_HEADER_SIZE) * 8U ||
+       blockHeader.type > (uint8_t)TsValueType::Int)
+    {
+        return false;
+    }
+
+    reader.attach(block + TS_BLOCK_HEADER_SIZE, blockHeader.bitLength);
+    decoded = 0;
+    previousTimestamp = 0;
+    previousDelta = 0;
+    previousValue = 0;
+    previousLeading = noWindow;
+    previousTrailing = 0;
+    return true;
+}
+
+bool TsBlockDecoder::next(TsSample &sample)
+{
+    if(decoded >= blockHeader.count)
+    {
+        return false;
+    }
+
+    uint32_t timestamp;
+    uint32_t raw;
+
+    if(decoded == 0)
+    {
+        uint64_t value;
+        if(!reader.read(32, value))
+        {
+            return false;
+        }
+        timestamp = blockHeader.firstTimestamp;
+        raw = (uint32_t)value;
+    }
+    else
+    {
+        if(!readTimestamp(timestamp))
+        {
+            return false;
+        }
+        bool ok = (blockHeader.type == (uint8_t)TsValueType::Float) ? readFloat(raw) : readInt(raw);
+        if(!ok)
+        {
+            return false;
+        }
+    }
+
+    previousTimestamp = timestamp;
+    previousValue = raw;
+    decoded++;
+
+    sample.timestamp = timestamp;
+    sample.raw = raw;
+    return true;
+}
+
+bool TsBlockDecoder::readTimestamp(uint32_t &timestamp)
+{
+    uint32_t prefixBits = 0;
+    bool bit = true;
+    while(prefixBits < 4U && bit)
+    {
+        if(!reader.readBit(bit))
+        {
+            return false;
+        }
+        if(bit)
+        {
+            prefixBits++;
+        }
+    }
+
+    uint64_t value = 0;
+    int64_t delta;
+    switch(prefixBits)
+    {
+        case 0:
+            delta = previousDelta;
+            break;
+        case 1:
+            if(!reader.read(7, value)) { return false; }
+            delta = previousDelta + (int64_t)value - 63;
+            break;
+        case 2:
+            if(!reader.read(9, value)) { return false; }
+            delta = previousDelta + (int64_t)value - 255;
+            break;
+        case 3:
+            if(!reader.read(12, value)) { return false; }
+            delta = previousDelta + (int64_t)value - 2047;
+            break;
+        default:
+            if(!reader.read(32, value)) { return false; }
+            delta = (int64_t)value;
+            break;
+    }
+
+    previousDelta = delta;
+    timestamp = (uint32_t)((int64_t)previousTimestamp + delta);
+    return true;
+}
+
+bool TsBlockDecoder::readFloat(uint32_t &raw)
+{
+    bool bit;
+    if(!reader.readBit(bit))
+    {
+        return false;
+    }
+    if(!bit)
+    {
+        raw = previousValue;
+        return true;
+    }
+
+    if(!reader.readBit(bit))
+    {
+        return false;
+    }
+
+    uint64_t value;
+    if(bit)
+    {
+        uint64_t leading;
+        uint64_t meaningfulMinusOne;
+        if(!reader.read(5, leading) || !reader.read(5, meaningfulMinusOne))
+        {
+            return false;
+        }
+        uint32_t meaningful = (uint32_t)meaningfulMinusOne + 1U;
+        if(leading + meaningful > 32U)
+        {
+            return false;
+        }
+        previousLeading = (uint8_t)leading;
+        previousTrailing = (uint8_t)(32U - leading - meaningful);
+    }
+    else if(previousLeading == noWindow)
+    {
+        return false;
+    }
+
+    uint32_t meaningful = 32U - previousLeading - previousTrailing;
+    if(!reader.read(meaningful, value))
+    {
+        return false;
+    }
+    raw = previousValue ^ (uint32_t)(value << previousTrailing);
+    return true;
+}
+
+bool TsBlockDecoder::readInt(uint32_t &raw)
+{
+    bool bit;
+    if(!reader.readBit(bit))
+    {
+        return false;
+    }
+    if(!bit)
+    {
+        raw = previousValue;
+        return true;
+    }
+
+    uint64_t zigzag = 0;
+    for(uint32_t shift = 0; shift < 64U; shift += 7U)
+    {
+        uint64_t group;
+        if(!reader.read(8, group))
+        {
+            return false;
+        }
+        zigzag |= (group & 0x7FU) << shift;
+        if((group & 0x80U) == 0U)
+        {
+            int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1U);
+            raw = (uint32_t)(int32_t)((int64_t)(int32_t)previousValue + delta);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ===============================
+// Range query
+// ===============================
+
+bool TsQuery::openNextBlock()
+{
+    const TimeSeriesConfig &config = store->config;
+
+    while(spillCursor < store->spilled)
+    {
+        uint32_t index = spillCursor++;
+        if(config.load(index, scratch, config.blockSize, config.ctx) &&
+           decoder.begin(scratch, config.blockSize))
+        {
+            const TsBlockHeader &header = decoder.header();
+            if(header.count > 0 && header.lastTimestamp >= from && header.firstTimestamp <= to)
+            {
+                return true;
+            }
+        }
+    }
+
+    while(ramCursor < store->used)
+    {
+        const uint8_t *block = store->blockAt((store->oldest + ramCursor) % config.blockCount);
+        ramCursor++;
+        if(decoder.begin(block, config.blockSize))
+        {
+            const TsBlockHeader &header = decoder.header();
+            if(header.count > 0 && header.lastTimestamp >= from && header.firstTimestamp <= to)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TsQuery::next(TsSample &sample)
+{
+    if(store == nullptr)
+    {
+        return false;
+    }
+
+    for(;;)
+    {
+        if(!blockOpen)
+        {
+            if(!openNextBlock())
+            {
+                store = nullptr;
+                return false;
+            }
+            blockOpen = true;
+        }
+
+        while(decoder.next(sample))
+        {
+            if(sample.timestamp > to)
+            {
+                // Timestamps never go backwards, nothing further can match
+                store = nullptr;
+                return false;
+            }
+            if(sample.timestamp >= from)
+            {
+                return true;
+            }
+        }
+        blockOpen = false;
+    }
+}
+
+// ===============================
+// Store
+// ===============================
+
+bool TimeSeriesStore::init(const TimeSeriesConfig &storeConfig)
+{
+    if(storeConfig.storage == nullptr || storeConfig.blockCount == 0 ||
+       storeConfig.blockSize < TS_BLOCK_MIN_SIZE || storeConfig.blockSize > TS_BLOCK_MAX_SIZE ||
+       storeConfig.type > TsValueType::Int)
+    {
+        return false;
+    }
+
+    config = storeConfig;
+    oldest = 0;
+    used = 1;
+    spilled = 0;
+    lastTimestamp = 0;
+    memset(&counters, 0, sizeof(counters));
+    startActiveBlock();
+    return true;
+}
+
+bool TimeSeriesStore::append(uint32_t timestamp, float value)
+{
+    if(config.type != TsValueType::Float)
+    {
+        return false;
+    }
+    uint32_t raw;
+    memcpy(&raw, &value, sizeof(raw));
+    return appendRaw(timestamp, raw);
+}
+
+bool TimeSeriesStore::append(uint32_t timestamp, int32_t value)
+{
+    if(config.type != TsValueType::Int)
+    {
+        return false;
+    }
+    return appendRaw(timestamp, (uint32_t)value);
+}
+
+bool TimeSeriesStore::appendRaw(uint32_t timestamp, uint32_t raw)
+{
+    if(config.storage == nullptr)
+    {
+        return false;
+    }
+    if(timestamp < lastTimestamp)
+    {
+        counters.rejectedSamples++;
+        return false;
+    }
+
+    if(!encoder.append(timestamp, raw))
+    {
+        // Active block is full: seal it and move on to a fresh one
+        counters.sealedBlocks++;
+        if(used == config.blockCount)
+        {
+            evictOldest();
+        }
+        used++;
+        startActiveBlock();
+        if(!encoder.append(timestamp, raw))
+        {
+            return false;
+        }
+    }
+
+    lastTimestamp = timestamp;
+    return true;
+}
+
+TsQuery TimeSeriesStore::query(uint32_t from, uint32_t to, uint8_t *scratch) const
+{
+    TsQuery query;
+    query.store = (config.storage != nullptr) ? this : nullptr;
+    query.from = from;
+    query.to = to;
+    query.scratch = scratch;
+    query.spillCursor = (scratch != nullptr && config.load != nullptr) ? 0 : spilled;
+    query.ramCursor = 0;
+    query.blockOpen = false;
+    return query;
+}
+
+void TimeSeriesStore::flush()
+{
+    if(config.storage == nullptr || config.spill == nullptr)
+    {
+        return;
+    }
+
+    while(used > 0)
+    {
+        TsBlockHeader header;
+        memcpy(&header, blockAt(oldest), sizeof(header));
+        if(header.count == 0)
+        {
+            break;
+        }
+        evictOldest();
+    }
+    used = 1;
+    startActiveBlock();
+}
+
+TimeSeriesStats TimeSeriesStore::stats() const
+{
+    TimeSeriesStats result = counters;
+    result.samples = 0;
+    result.payloadBits = 0;
+
+    for(size_t i = 0; i < used; i++)
+    {
+        TsBlockHeader header;
+        memcpy(&header, blockAt((oldest + i) % config.blockCount), sizeof(header));
+        result.samples += header.count;
+        result.payloadBits += header.bitLength;
+    }
+    return result;
+}
+
+uint8_t *TimeSeriesStore::blockAt(size_t ringIndex) const
+{
+    return config.storage + ringIndex * config.blockSize;
+}
+
+void TimeSeriesStore::startActiveBlock()
+{
+    size_t active = (oldest + used - 1U) % config.blockCount;
+    encoder.begin(blockAt(active), config.blockSize, config.type);
+}
+
+void TimeSeriesStore::evictOldest()
+{
+    const uint8_t *block = blockAt(oldest);
+    if(config.spill != nullptr && config.spill(spilled, block, config.blockSize, config.ctx))
+    {
+        spilled++;
+        counters.spilledBlocks++;
+    }
+    else
+    {
+        counters.droppedBlocks++;
+    }
+    oldest = (oldest + 1U) % config.blockCount;
+    used--;
+}
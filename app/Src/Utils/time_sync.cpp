@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file           : time_sync.cpp
+  * @brief          : Two-way time transfer and a disciplined software clock
+  ******************************************************************************
+  */
+
+#include "time_sync.h"
+
+#include <math.h>
+
+namespace {
+
+constexpr int64_t PPB = 1000000000;
+
+void put64(uint8_t *out, uint64_t value)
+{
+    for(size_t i = 0; i < 8U; i++)
+    {
+        out[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+uint64_t get64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for(size_t i = 0; i < 8U; i++)
+    {
+        value |= (uint64_t)in[i] << (8U * i);
+    }
+    return value;
+}
+
+} // namespace
+
+// ===============================
+// Messages
+// ===============================
+
+bool TimeSyncMessage::isMessage(const uint8_t *payload, size_t length)
+{
+    return payload != nullptr && length == TIME_SYNC_FRAME_SIZE && payload[0] == TIME_SYNC_TAG;
+}
+
+size_t TimeSyncMessage::encode(uint8_t *out, size_t capacity) const
+{
+    if(out == nullptr || capacity < TIME_SYNC_FRAME_SIZE)
+    {
+        return 0;
+    }
+
+    out[0] = TIME_SYNC_TAG;
+    out[1] = type;
+    out[2] = (uint8_t)sequence;
+    out[3] = (uint8_t)(sequence >> 8);
+    put64(&out[4], t1);
+    put64(&out[12], t2);
+    put64(&out[20], t3);
+    return TIME_SYNC_FRAME_SIZE;
+}
+
+bool TimeSyncMessage::decode(const uint8_t *payload, size_t length)
+{
+    if(!isMessage(payload, length) || (payload[1] != TIME_SYNC_REQUEST && payload[1] != TIME_SYNC_RESPONSE))
+    {
+        return false;
+    }
+
+    type = payload[1];
+    sequence = (uint16_t)(payload[2] | (payload[3] << 8));
+    t1 = get64(&payload[4]);
+    t2 = get64(&payload[12]);
+    t3 = get64(&payload[20]);
+    return true;
+}
+
+// ===============================
+// Clock
+// ===============================
+
+void TimeSyncClock::reset()
+{
+    window = Ring<TIME_SYNC_WINDOW>();
+    picked = Ring<TIME_SYNC_HISTORY>();
+    lastPickedUs = 0;
+    isSynced = false;
+    anchorLocalUs = 0;
+    anchorRefUs = 0;
+    slewEndLocalUs = 0;
+    slewEndRefUs = 0;
+    ratePpb = 0;
+    totals = TimeSyncClockStats();
+}
+
+uint64_t TimeSyncClock::toReference(uint64_t localUs) const
+{
+    if(localUs <= slewEndLocalUs)
+    {
+        // Within the slew, or before the last correction: straight line between the slew ends
+        int64_t elapsed = (int64_t)(localUs - anchorLocalUs);
+        int64_t span = (int64_t)(slewEndLocalUs - anchorLocalUs);
+        int64_t extra = span > 0 ? (int64_t)(slewEndRefUs - anchorRefUs) - span : 0;
+        int64_t adjust = span > 0 ? elapsed * extra / span : elapsed * ratePpb / PPB;
+        return anchorRefUs + (uint64_t)(elapsed + adjust);
+    }
+
+    int64_t elapsed = (int64_t)(localUs - slewEndLocalUs);
+    return slewEndRefUs + (uint64_t)(elapsed + elapsed * ratePpb / PPB);
+}
+
+const TimeSyncClock::Sample *TimeSyncClock::pick()
+{
+    uint32_t minDelay = UINT32_MAX;
+    for(size_t i = 0; i < window.count; i++)
+    {
+        minDelay = window.at(i).delayUs < minDelay ? window.at(i).delayUs : minDelay;
+    }
+    totals.minDelayUs = minDelay;
+
+    // Newest close to the minimum; the first exchange after boot is always taken
+    for(size_t i = 0; i < window.count; i++)
+    {
+        const Sample &sample = window.at(i);
+        if(picked.count > 0 && sample.localUs <= lastPickedUs)
+        {
+            break;
+        }
+        if(sample.delayUs <= minDelay + cfg.delayMarginUs)
+        {
+            return &sample;
+        }
+    }
+    return nullptr;
+}
+
+void TimeSyncClock::fit(int64_t &offsetAtUs, double &slope, uint64_t atLocalUs)
+{
+    // Relative to the oldest pick to keep the doubles small
+    const Sample &first = picked.at(picked.count - 1U);
+    const Sample &last = picked.at(0);
+    const double n = (double)picked.count;
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for(size_t i = 0; i < picked.count; i++)
+    {
+        meanX += (double)(picked.at(i).localUs - first.localUs);
+        meanY += (double)(picked.at(i).offsetUs - first.offsetUs);
+    }
+    meanX /= n;
+    meanY /= n;
+
+    // Too short a span keeps the previous drift estimate
+    slope = (double)ratePpb / (double)PPB;
+    if(picked.count >= 2U && last.localUs - first.localUs >= cfg.minFitSpanUs)
+    {
+        double sxx = 0.0;
+        double sxy = 0.0;
+        for(size_t i = 0; i < picked.count; i++)
+        {
+            double dx = (double)(picked.at(i).localUs - first.localUs) - meanX;
+            double dy = (double)(picked.at(i).offsetUs - first.offsetUs) - meanY;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        slope = sxy / sxx;
+    }
+
+    double residuals = 0.0;
+    for(size_t i = 0; i < picked.count; i++)
+    {
+        double dx = (double)(picked.at(i).localUs - first.localUs) - meanX;
+        double r = (double)(picked.at(i).offsetUs - first.offsetUs) - meanY - slope * dx;
+        residuals += r * r;
+    }
+    totals.jitterUs = (uint32_t)sqrt(residuals / n);
+
+    double at = (double)(int64_t)(atLocalUs - first.localUs) - meanX;
+    offsetAtUs = first.offsetUs + (int64_t)llround(meanY + slope * at);
+}
+
+void TimeSyncClock::apply(uint64_t nowLocalUs, uint64_t targetUs, int64_t drift)
+{
+    totals.driftPpb = (int32_t)drift;
+
+    int64_t correction = isSynced ? (int64_t)(targetUs - toReference(nowLocalUs)) : 0;
+    uint64_t magnitude = (uint64_t)(correction < 0 ? -correction : correction);
+    totals.lastCorrectionUs = correction;
+
+    if(!isSynced || magnitude > cfg.stepThresholdUs)
+    {
+        anchorLocalUs = nowLocalUs;
+        anchorRefUs = targetUs;
+        slewEndLocalUs = nowLocalUs;
+        slewEndRefUs = targetUs;
+        ratePpb = drift;
+        isSynced = true;
+        totals.steps++;
+        return;
+    }
+
+    // Absorb the correction at the bounded rate, then run at the new drift
+    uint64_t slewUs = magnitude * 1000000U / cfg.maxSlewPpm;
+    anchorRefUs = toReference(nowLocalUs);
+    anchorLocalUs = nowLocalUs;
+    slewEndLocalUs = nowLocalUs + slewUs;
+    slewEndRefUs = targetUs + slewUs + (uint64_t)((int64_t)slewUs * drift / PPB);
+    ratePpb = drift;
+}
+
+bool TimeSyncClock::addSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+{
+    totals.samples++;
+    if(t4 < t1 || t3 < t2)
+    {
+        totals.discarded++;
+        return false;
+    }
+
+    // Drift can make the hold time a little longer than the round trip
+    uint64_t roundTrip = t4 - t1;
+    uint64_t hold = t3 - t2;
+    uint64_t delay = roundTrip > hold ? roundTrip - hold : 0;
+    totals.lastDelayUs = (uint32_t)(delay < UINT32_MAX ? delay : UINT32_MAX);
+    if(delay > cfg.maxDelayUs)
+    {
+        totals.discarded++;
+        return false;
+    }
+
+    Sample sample;
+    sample.localUs = t1 + roundTrip / 2U;
+    sample.offsetUs = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+    sample.delayUs = (uint32_t)delay;
+    window.push(sample);
+
+    const Sample *best = pick();
+    if(best == nullptr)
+    {
+        return false;
+    }
+    lastPickedUs = best->localUs;
+
+    // A pick far from the clock means the reference jumped, the old picks no longer apply
+    if(isSynced)
+    {
+        int64_t expected = best->offsetUs + (int64_t)(t4 - best->localUs) * ratePpb / PPB;
+        int64_t error = (int64_t)(t4 + (uint64_t)expected - toReference(t4));
+        if(error > (int64_t)cfg.stepThresholdUs || -error > (int64_t)cfg.stepThresholdUs)
+        {
+            picked = Ring<TIME_SYNC_HISTORY>();
+        }
+    }
+    picked.push(*best);
+
+    int64_t offset;
+    double slope;
+    fit(offset, slope, t4);
+    apply(t4, t4 + (uint64_t)offset, (int64_t)llround(slope * (double)PPB));
+    totals.accepted++;
+    return true;
+}
@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file           : trace_codec.cpp
+  * @brief          : Compact binary format for peripheral traffic traces
+  ******************************************************************************
+  */
+
+#include "trace_codec.h"
+
+#include <string.h>
+
+const uint8_t TRACE_MAGIC[TRACE_MAGIC_SIZE] = { 'P', 'T', 'R', '1' };
+
+namespace {
+
+size_t putVarint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while(value >= 0x80U)
+    {
+        out[n++] = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+} // namespace
+
+size_t TraceEncoder::encode(const TraceEvent &event, uint8_t *out, size_t capacity)
+{
+    uint8_t header[TRACE_EVENT_MAX_HEADER];
+    size_t n = 0;
+
+    uint64_t delta = event.timeUs >= lastUs ? event.timeUs - lastUs : 0;
+    header[n++] = (uint8_t)((event.kind << 4) | (event.port & 0x0FU));
+    n += putVarint(header + n, delta);
+
+    size_t dataLength = 0;
+    switch(event.kind)
+    {
+    case TRACE_UART_TX:
+    case TRACE_UART_RX:
+        header[n++] = event.status;
+        n += putVarint(header + n, event.value);
+        break;
+    case TRACE_UART_STATE:
+        header[n++] = event.status;
+        break;
+    case TRACE_UART_DATA:
+        dataLength = event.length;
+        n += putVarint(header + n, dataLength);
+        break;
+    case TRACE_UART_TX_DONE:
+        break;
+    case TRACE_UART_ERROR:
+    case TRACE_UART_RX_EVENT:
+    case TRACE_DROPPED:
+    case TRACE_SPAN_START:
+        n += putVarint(header + n, event.value);
+        break;
+    case TRACE_SPAN_END:
+        header[n++] = event.status;
+        n += putVarint(header + n, event.value);
+        break;
+    case TRACE_SMBUS_TX:
+        header[n++] = event.status;
+        n += putVarint(header + n, event.value);
+        n += putVarint(header + n, event.length);
+        break;
+    default:
+        return 0;
+    }
+
+    if(n + dataLength > capacity)
+    {
+        return 0;
+    }
+    memcpy(out, header, n);
+    if(dataLength > 0)
+    {
+        memcpy(out + n, event.data, dataLength);
+    }
+    lastUs += delta;
+    return n + dataLength;
+}
+
+bool TraceDecoder::attach(const uint8_t *trace, size_t traceSize)
+{
+    buffer = trace;
+    size = traceSize;
+    pos = 0;
+    lastUs = 0;
+    bad = false;
+
+    if(size < TRACE_MAGIC_SIZE || memcmp(buffer, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0)
+    {
+        bad = true;
+        return false;
+    }
+    pos = TRACE_MAGIC_SIZE;
+    return true;
+}
+
+bool TraceDecoder::readVarint(uint64_t &value)
+{
+    value = 0;
+    for(unsigned shift = 0; shift < 64U; shift += 7U)
+    {
+        if(pos >= size)
+        {
+            return false;
+        }
+        uint8_t byte = buffer[pos++];
+        value |= (uint64_t)(byte & 0x7FU) << shift;
+        if((byte & 0x80U) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TraceDecoder::next(TraceEvent &event)
+{
+    if(bad || pos >= size)
+    {
+        return false;
+    }
+
+    size_t start = pos;
+    uint8_t tag = buffer[pos++];
+    uint64_t delta;
+    uint64_t value = 0;
+    uint64_t length = 0;
+
+    event = TraceEvent();
+    event.kind = (TraceKind)(tag >> 4);
+    event.port = (uint8_t)(tag & 0x0FU);
+
+    bool ok = readVarint(delta);
+    switch(event.kind)
+    {
+    case TRACE_UART_TX:
+    case TRACE_UART_RX:
+        ok = ok && pos < size;
+        if(ok)
+        {
+            event.status = buffer[pos++];
+            ok = readVarint(value);
+        }
+        break;
+    case TRACE_UART_STATE:
+        ok = ok && pos < size;
+        if(ok)
+        {
+            event.status = buffer[pos++];
+        }
+        break;
+    case TRACE_UART_DATA:
+        ok = ok && readVarint(length) && length <= size - pos;
+        if(ok)
+        {
+            event.data = buffer + pos;
+            pos += (size_t)length;
+        }
+        break;
+    case TRACE_UART_TX_DONE:
+        break;
+    case TRACE_UART_ERROR:
+    case TRACE_UART_RX_EVENT:
+    case TRACE_DROPPED:
+    case TRACE_SPAN_START:
+        ok = ok && readVarint(value);
+        break;
+    case TRACE_SPAN_END:
+        ok = ok && pos < size;
+        if(ok)
+        {
+            event.status = buffer[pos++];
+            ok = readVarint(value);
+        }
+        break;
+    case TRACE_SMBUS_TX:
+        ok = ok && pos < size;
+        if(ok)
+        {
+            event.status = buffer[pos++];
+            ok = readVarint(value) && readVarint(length);
+        }
+        break;
+    default:
+        ok = false;
+        break;
+    }
+
+    if(!ok)
+    {
+        // A trace cut short by the recorder ends cleanly, anything else is corrupt
+        bad = pos < size;
+        pos = start;
+        return false;
+    }
+
+    lastUs += delta;
+    event.timeUs = lastUs;
+    event.value = (uint32_t)value;
+    event.length = (uint32_t)length;
+    return true;
+}
+
+const char *traceKindName(TraceKind kind)
+{
+    switch(kind)
+    {
+    case TRACE_UART_TX:         return "uart-tx";
+    case TRACE_UART_RX:         return "uart-rx";
+    case TRACE_UART_STATE:      return "uart-state";
+    case TRACE_UART_DATA:       return "uart-data";
+    case TRACE_UART_TX_DONE:    return "uart-tx-done";
+    case TRACE_UART_ERROR:      return "uart-error";
+    case TRACE_UART_RX_EVENT:   return "uart-rx-event";
+    case TRACE_SMBUS_TX:        return "smbus-tx";
+    case TRACE_DROPPED:         return "dropped";
+    case TRACE_SPAN_START:      return "span-start";
+    case TRACE_SPAN_END:        return "span-end";
+    default:                    return "unknown";
+    }
+}
+
+const char *traceSpanName(uint8_t stage)
+{
+    switch(stage)
+    {
+    case TRACE_SPAN_REQUEST:    return "request";
+    case TRACE_SPAN_QUEUE:      return "queue";
+    case TRACE_SPAN_SMBUS:      return "smbus";
+    case TRACE_SPAN_REPLY:      return "reply";
+    default:                    return "unknown";
+    }
+}
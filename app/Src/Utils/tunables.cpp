@@ -0,0 +1,390 @@
+/**
+  ******************************************************************************
+  * @file           : tunables.cpp
+  * @brief          : Runtime-tunable parameters registered in a linker section
+  ******************************************************************************
+  */
+
+#include "tunables.h"
+#include "crc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bounds of the section, absent when nothing declares a tunable
+extern "C" {
+extern const Tunable __start_tunables __attribute__((weak));
+extern const Tunable __stop_tunables __attribute__((weak));
+}
+
+namespace {
+
+const uint8_t BLOB_MAGIC[4] = { 'T', 'U', 'N', '1' };
+constexpr size_t BLOB_HEADER = 6;       // Magic, record count
+constexpr size_t BLOB_RECORD = 8;       // Name CRC, value
+constexpr size_t BLOB_TRAILER = 4;      // CRC-32 of everything before
+
+void put32(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+uint32_t get32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+uint32_t nameKey(const char *name)
+{
+    return crc32((const uint8_t *)name, strlen(name));
+}
+
+int64_t widen(const Tunable *tunable, uint32_t raw)
+{
+    return tunable->type == TUNABLE_TYPE_INT ? (int64_t)(int32_t)raw : (int64_t)raw;
+}
+
+bool inRange(const Tunable *tunable, int64_t value)
+{
+    return value >= widen(tunable, tunable->minimum) && value <= widen(tunable, tunable->maximum);
+}
+
+// Reply writer that never overflows and remembers whether it had to cut
+struct Reply
+{
+    char *out;
+    size_t capacity;
+    size_t used;
+    bool full;
+
+    bool line(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+bool Reply::line(const char *format, ...)
+{
+    char text[96];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if(n < 0 || full || used + (size_t)n + 1U > capacity)
+    {
+        full = true;
+        return false;
+    }
+    memcpy(out + used, text, (size_t)n + 1U);
+    used += (size_t)n;
+    return true;
+}
+
+bool describe(Reply &reply, const Tunable *tunable)
+{
+    if(tunable->type == TUNABLE_TYPE_INT)
+    {
+        return reply.line("%s = %ld [%ld..%ld] default %ld\n", tunable->name, (long)(int32_t)*tunable->value,
+                          (long)(int32_t)tunable->minimum, (long)(int32_t)tunable->maximum,
+                          (long)(int32_t)tunable->defaultValue);
+    }
+    return reply.line("%s = %lu [%lu..%lu] default %lu\n", tunable->name, (unsigned long)*tunable->value,
+                      (unsigned long)tunable->minimum, (unsigned long)tunable->maximum,
+                      (unsigned long)tunable->defaultValue);
+}
+
+/**
+ * @brief Split off the next space-separated word, nullptr at the end of the line
+ */
+const char *nextWord(const char *&cursor, size_t &length)
+{
+    while(*cursor == ' ' || *cursor == '\t')
+    {
+        cursor++;
+    }
+    if(*cursor == '\0' || *cursor == '\r' || *cursor == '\n')
+    {
+        return nullptr;
+    }
+    const char *word = cursor;
+    while(*cursor != '\0' && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n')
+    {
+        cursor++;
+    }
+    length = (size_t)(cursor - word);
+    return word;
+}
+
+bool wordIs(const char *word, size_t length, const char *keyword)
+{
+    return word != nullptr && strlen(keyword) == length && memcmp(word, keyword, length) == 0;
+}
+
+bool parseNumber(const char *word, size_t length, int64_t &value)
+{
+    char text[24];
+    if(word == nullptr || length == 0 || length >= sizeof(text))
+    {
+        return false;
+    }
+    memcpy(text, word, length);
+    text[length] = '\0';
+
+    char *end;
+    value = (int64_t)strtoll(text, &end, 0);
+    return *end == '\0';
+}
+
+const Tunable *findWord(const char *word, size_t length)
+{
+    for(size_t i = 0; word != nullptr && i < tunableCount(); i++)
+    {
+        const Tunable *tunable = tunableAt(i);
+        if(wordIs(word, length, tunable->name))
+        {
+            return tunable;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// ===============================
+// Table
+// ===============================
+
+size_t tunableCount(void)
+{
+    return &__start_tunables != nullptr ? (size_t)(&__stop_tunables - &__start_tunables) : 0;
+}
+
+const Tunable *tunableAt(size_t index)
+{
+    return index < tunableCount() ? &__start_tunables + index : nullptr;
+}
+
+const Tunable *tunableFind(const char *name)
+{
+    return name != nullptr ? findWord(name, strlen(name)) : nullptr;
+}
+
+int64_t tunableGet(const Tunable *tunable)
+{
+    return widen(tunable, *tunable->value);
+}
+
+TunableResult tunableSet(const Tunable *tunable, int64_t value)
+{
+    if(tunable == nullptr)
+    {
+        return TUNABLE_UNKNOWN;
+    }
+    if(!inRange(tunable, value))
+    {
+        return TUNABLE_OUT_OF_RANGE;
+    }
+
+    // One aligned word store, readers never see half an update
+    *tunable->value = (uint32_t)value;
+    return TUNABLE_OK;
+}
+
+void tunableResetAll(void)
+{
+    for(size_t i = 0; i < tunableCount(); i++)
+    {
+        *tunableAt(i)->value = tunableAt(i)->defaultValue;
+    }
+}
+
+// ===============================
+// Persistence
+// ===============================
+
+size_t tunableSave(uint8_t *out, size_t capacity)
+{
+    size_t records = 0;
+    for(size_t i = 0; i < tunableCount(); i++)
+    {
+        records += *tunableAt(i)->value != tunableAt(i)->defaultValue ? 1U : 0U;
+    }
+
+    size_t size = BLOB_HEADER + records * BLOB_RECORD + BLOB_TRAILER;
+    if(out == nullptr || size > capacity || records > 0xFFFFU)
+    {
+        return 0;
+    }
+
+    memcpy(out, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+    out[4] = (uint8_t)records;
+    out[5] = (uint8_t)(records >> 8);
+    size_t pos = BLOB_HEADER;
+    for(size_t i = 0; i < tunableCount(); i++)
+    {
+        const Tunable *tunable = tunableAt(i);
+        uint32_t value = *tunable->value;
+        if(value != tunable->defaultValue)
+        {
+            put32(out + pos, nameKey(tunable->name));
+            put32(out + pos + 4U, value);
+            pos += BLOB_RECORD;
+        }
+    }
+    put32(out + pos, crc32(out, pos));
+    return size;
+}
+
+int tunableLoad(const uint8_t *data, size_t size)
+{
+    if(data == nullptr || size < BLOB_HEADER + BLOB_TRAILER || memcmp(data, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0)
+    {
+        return -1;
+    }
+    size_t records = (size_t)data[4] | ((size_t)data[5] << 8);
+    size_t end = BLOB_HEADER + records * BLOB_RECORD;
+    if(end + BLOB_TRAILER != size || get32(data + end) != crc32(data, end))
+    {
+        return -1;
+    }
+
+    int applied = 0;
+    for(size_t pos = BLOB_HEADER; pos < end; pos += BLOB_RECORD)
+    {
+        uint32_t key = get32(data + pos);
+        for(size_t i = 0; i < tunableCount(); i++)
+        {
+            const Tunable *tunable = tunableAt(i);
+            if(nameKey(tunable->name) == key)
+            {
+                applied += tunableSet(tunable, widen(tunable, get32(data + pos + 4U))) == TUNABLE_OK ? 1 : 0;
+                break;
+            }
+        }
+    }
+    return applied;
+}
+
+// ===============================
+// Shell
+// ===============================
+
+bool TunableShell::execute(const char *line, char *out, size_t capacity)
+{
+    if(line == nullptr || out == nullptr || capacity == 0)
+    {
+        return false;
+    }
+    out[0] = '\0';
+
+    Reply reply = { out, capacity, 0, false };
+    const char *cursor = line;
+    size_t length = 0;
+    size_t nameLength = 0;
+    size_t argLength = 0;
+    const char *command = nextWord(cursor, length);
+    const char *name = nextWord(cursor, nameLength);
+    const char *arg = nextWord(cursor, argLength);
+
+    if(wordIs(command, length, "list"))
+    {
+        int64_t from = 0;
+        if(name != nullptr && (!parseNumber(name, nameLength, from) || from < 0))
+        {
+            reply.line("error: list takes a start index\n");
+            return true;
+        }
+
+        // Keep room for the continuation hint so a cut list always says where to go on
+        Reply body = { out, capacity > 24U ? capacity - 24U : capacity, 0, false };
+        size_t i = (size_t)from;
+        while(i < tunableCount() && describe(body, tunableAt(i)))
+        {
+            i++;
+        }
+        reply.used = body.used;
+        if(i < tunableCount())
+        {
+            reply.line("... list %u\n", (unsigned int)i);
+        }
+        return true;
+    }
+
+    if(wordIs(command, length, "get"))
+    {
+        const Tunable *tunable = findWord(name, nameLength);
+        if(tunable == nullptr)
+        {
+            reply.line("error: unknown tunable\n");
+            return true;
+        }
+        describe(reply, tunable);
+        return true;
+    }
+
+    if(wordIs(command, length, "set"))
+    {
+        const Tunable *tunable = findWord(name, nameLength);
+        int64_t value;
+        if(tunable == nullptr)
+        {
+            reply.line("error: unknown tunable\n");
+        }
+        else if(!parseNumber(arg, argLength, value))
+        {
+            reply.line("error: set takes a name and a number\n");
+        }
+        else if(tunableSet(tunable, value) != TUNABLE_OK)
+        {
+            reply.line("error: out of range\n");
+        }
+        else
+        {
+            describe(reply, tunable);
+        }
+        return true;
+    }
+
+    if(wordIs(command, length, "reset"))
+    {
+        const Tunable *tunable = findWord(name, nameLength);
+        if(wordIs(name, nameLength, "all"))
+        {
+            tunableResetAll();
+            reply.line("%u tunables reset\n", (unsigned int)tunableCount());
+        }
+        else if(tunable == nullptr)
+        {
+            reply.line("error: unknown tunable\n");
+        }
+        else
+        {
+            *tunable->value = tunable->defaultValue;
+            describe(reply, tunable);
+        }
+        return true;
+    }
+
+    if(wordIs(command, length, "save"))
+    {
+        uint8_t blob[256];
+        size_t size = tunableSave(blob, sizeof(blob));
+        if(saveFn == nullptr)
+        {
+            reply.line("error: no config store\n");
+        }
+        else if(size == 0 || !saveFn(blob, size, saveCtx))
+        {
+            reply.line("error: save failed\n");
+        }
+        else
+        {
+            reply.line("saved %u bytes\n", (unsigned int)size);
+        }
+        return true;
+    }
+
+    return false;
+}
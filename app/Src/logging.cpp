@@ -1,10 +1,125 @@
 #include "logging.h"
+#include "hal_types.h"
+#include "log_buffer.h"
+#include "overload_control.h"
+#include "clock_sync.h"
 #include "SEGGER_RTT.h"
 
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace {
+
+constexpr size_t LOG_BUFFER_SIZE = 2048;
+constexpr size_t LOG_LINE_MAX = 128;
+constexpr size_t LOG_DRAIN_MAX = 512;           // Bytes one logWrite or logFlush moves to RTT
+
+// Debug may fill half of the buffer, info three quarters, warnings all but the errors' share
+const size_t levelReserves[] = { 1024, 512, 192, 0 };
+const char *const levelNames[] = { "debug", "info", "warn", "error" };
+
+uint8_t storage[LOG_BUFFER_SIZE];
+LogBuffer buffer;
+
+volatile LogLevel configuredLevel = LOG_DEBUG;
+volatile uint8_t shedLevels;        // Raised by the overload controller
+volatile bool draining;             // One drainer at a time keeps records in order
+LogSinkFn volatile sink;
+
+LogLevel effectiveLevel(void)
+{
+    uint32_t level = (uint32_t)configuredLevel > shedLevels ? (uint32_t)configuredLevel : shedLevels;
+    return level > LOG_ERROR ? LOG_ERROR : (LogLevel)level;
+}
+
+void shedLogLevel(uint8_t level, void *ctx)
+{
+    (void)ctx;
+    shedLevels = level;
+}
+
+/**
+ * @brief Write whole records while RTT has room, then the shed summary
+ *
+ * Records are taken off the queue one at a time under the lock and written
+ * to RTT after it is released, so interrupts are masked for a pop rather
+ * than for the copy. One drainer at a time keeps the records in order; a
+ * caller that finds another draining leaves it to them.
+ *
+ * @param budget Bytes to write at most, bounds the time one call spends here
+ */
+void drain(size_t budget)
+{
+    uint32_t state = HAL_CriticalEnter();
+    if(draining)
+    {
+        HAL_CriticalExit(state);
+        return;
+    }
+    draining = true;
+    HAL_CriticalExit(state);
+
+    char text[LOG_BUFFER_TEXT_MAX];
+    for(;;)
+    {
+        size_t length = 0;
+        state = HAL_CriticalEnter();
+        if(buffer.records() > 0 && buffer.frontLength() <= budget &&
+           SEGGER_RTT_GetAvailWriteSpace(0) >= buffer.frontLength())
+        {
+            uint8_t severity;
+            length = buffer.pop(severity, text, sizeof(text));
+        }
+        HAL_CriticalExit(state);
+
+        if(length == 0)
+        {
+            break;
+        }
+        SEGGER_RTT_Write(0, text, length);
+        budget -= length;
+    }
+
+    uint32_t shed[LOG_BUFFER_SEVERITIES];
+    bool summary = false;
+    state = HAL_CriticalEnter();
+    if(buffer.records() == 0 && budget >= LOG_LINE_MAX && SEGGER_RTT_GetAvailWriteSpace(0) >= LOG_LINE_MAX)
+    {
+        summary = buffer.takeShed(shed);
+    }
+    HAL_CriticalExit(state);
+
+    if(summary)
+    {
+        int length = snprintf(text, sizeof(text), "Log shed: %lu %s, %lu %s, %lu %s, %lu %s\n\r",
+                              (unsigned long)shed[LOG_DEBUG], levelNames[LOG_DEBUG],
+                              (unsigned long)shed[LOG_INFO], levelNames[LOG_INFO],
+                              (unsigned long)shed[LOG_WARN], levelNames[LOG_WARN],
+                              (unsigned long)shed[LOG_ERROR], levelNames[LOG_ERROR]);
+        if(length > 0)
+        {
+            SEGGER_RTT_Write(0, text, (unsigned)length < sizeof(text) ? (unsigned)length : sizeof(text) - 1U);
+        }
+    }
+
+    draining = false;
+}
+
+} // namespace
+
 void initLogging(void)
 {
     // Configure SEGGER RTT
     SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    buffer.attach(storage, sizeof(storage));
+    for(size_t i = 0; i < LOG_BUFFER_SEVERITIES; i++)
+    {
+        buffer.setReserve((uint8_t)i, levelReserves[i]);
+    }
+
+    // Under CPU pressure drop debug, then info records at the source
+    overloadRegister("log", OVERLOAD_ORDER_LOGGING, 2, shedLogLevel, NULL);
     
     // Display startup banner
     SEGGER_RTT_printf(0, "mmmmm mmmmm mmmmm mmmmm mmmmm mmmmm \n\r");
@@ -18,4 +133,64 @@ void initLogging(void)
     SEGGER_RTT_printf(0, "MM     .JMMmmmmMMM P\"Ybmmd\"      MM \n\r");
     SEGGER_RTT_printf(0, "MM                               MM \n\r");
     SEGGER_RTT_printf(0, "mmmmm mmmmm mmmmm mmmmm mmmmm mmmmm \n\r");
-}
\ No newline at end of file
+}
+
+void logWrite(LogLevel level, const char *format, ...)
+{
+    if(level < effectiveLevel())
+    {
+        return;
+    }
+
+    // Host wall-clock time once the link has synced, split for newlib-nano's printf
+    char line[LOG_LINE_MAX];
+    int prefix = 0;
+    uint64_t wallUs = clockSyncWallUs();
+    if(wallUs != 0)
+    {
+        prefix = snprintf(line, sizeof(line), "[%lu.%06lu] ", (unsigned long)(wallUs / 1000000U),
+                          (unsigned long)(wallUs % 1000000U));
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line + prefix, sizeof(line) - (size_t)prefix, format, args);
+    va_end(args);
+    if(length <= 0)
+    {
+        return;
+    }
+    length += prefix;
+
+    size_t size = (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1U;
+    uint32_t state = HAL_CriticalEnter();
+    buffer.push((uint8_t)level, line, size);
+    HAL_CriticalExit(state);
+
+    LogSinkFn output = sink;
+    if(output != NULL)
+    {
+        output(level, line, size);
+    }
+    drain(LOG_DRAIN_MAX);
+}
+
+void logFlush(void)
+{
+    drain(LOG_DRAIN_MAX);
+}
+
+void logSetSink(LogSinkFn fn)
+{
+    sink = fn;
+}
+
+void logSetLevel(LogLevel level)
+{
+    configuredLevel = level;
+}
+
+LogLevel logGetLevel(void)
+{
+    return effectiveLevel();
+}
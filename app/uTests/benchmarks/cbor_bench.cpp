@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "cbor.h"
+
+namespace {
+
+// The periodic statistics of the UART task, as it logs them and as CBOR sections
+struct Telemetry
+{
+    uint32_t baud, bps, errors, fallbacks;
+    uint32_t turnaroundLast, turnaroundMax, late;
+    uint32_t run, depthMax, latencyAvg, latencyMax, overflows;
+    uint32_t loadPermille, shed, levels, misses;
+};
+
+size_t formatText(const Telemetry &t, char *out, size_t capacity)
+{
+    int n = snprintf(out, capacity,
+                     "Link %u baud, %u B/s, errors: %u, fallbacks: %u\n\r"
+                     "RS-485 turnaround last: %u us, max: %u us, late: %u\n\r"
+                     "Work lane: %u run, depth max %u, latency avg %u us max %u us, overflows %u\n\r"
+                     "Load %u permille, shed %u/%u, misses %u\n\r",
+                     t.baud, t.bps, t.errors, t.fallbacks, t.turnaroundLast, t.turnaroundMax, t.late,
+                     t.run, t.depthMax, t.latencyAvg, t.latencyMax, t.overflows,
+                     t.loadPermille, t.shed, t.levels, t.misses);
+    return (size_t)n;
+}
+
+bool parseText(const char *text, Telemetry &t)
+{
+    return sscanf(text,
+                  "Link %u baud, %u B/s, errors: %u, fallbacks: %u\n\r"
+                  "RS-485 turnaround last: %u us, max: %u us, late: %u\n\r"
+                  "Work lane: %u run, depth max %u, latency avg %u us max %u us, overflows %u\n\r"
+                  "Load %u permille, shed %u/%u, misses %u",
+                  &t.baud, &t.bps, &t.errors, &t.fallbacks, &t.turnaroundLast, &t.turnaroundMax, &t.late,
+                  &t.run, &t.depthMax, &t.latencyAvg, &t.latencyMax, &t.overflows,
+                  &t.loadPermille, &t.shed, &t.levels, &t.misses) == 16;
+}
+
+void writeSection(CborWriter &writer, const char *name, const char *const *keys, const uint32_t *values, size_t count)
+{
+    writer.beginMap(1);
+    writer.writeText(name);
+    writer.beginMap(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        writer.writeText(keys[i]);
+        writer.writeUnsigned(values[i]);
+    }
+}
+
+const char *const LINK_KEYS[] = { "baud", "bps", "err", "fb" };
+const char *const RS485_KEYS[] = { "last", "max", "late" };
+const char *const WORK_KEYS[] = { "run", "depth", "avg", "max", "ovf" };
+const char *const LOAD_KEYS[] = { "pm", "shed", "levels", "miss" };
+
+size_t formatCbor(const Telemetry &t, uint8_t *out, size_t capacity)
+{
+    CborWriter writer(out, capacity);
+    const uint32_t link[] = { t.baud, t.bps, t.errors, t.fallbacks };
+    const uint32_t rs485[] = { t.turnaroundLast, t.turnaroundMax, t.late };
+    const uint32_t work[] = { t.run, t.depthMax, t.latencyAvg, t.latencyMax, t.overflows };
+    const uint32_t load[] = { t.loadPermille, t.shed, t.levels, t.misses };
+    writeSection(writer, "link", LINK_KEYS, link, 4);
+    writeSection(writer, "rs485", RS485_KEYS, rs485, 3);
+    writeSection(writer, "work", WORK_KEYS, work, 5);
+    writeSection(writer, "load", LOAD_KEYS, load, 4);
+    return writer.ok() ? writer.size() : 0;
+}
+
+bool textIs(const char *text, size_t length, const char *expected)
+{
+    return strncmp(text, expected, length) == 0 && expected[length] == '\0';
+}
+
+/**
+ * @brief Read the sections by key, in any order, skipping whatever is not known
+ */
+bool parseCbor(const uint8_t *data, size_t size, Telemetry &t)
+{
+    struct Section
+    {
+        const char *name;
+        const char *const *keys;
+        uint32_t *values[5];
+        size_t count;
+    };
+    const Section sections[] = {
+        { "link", LINK_KEYS, { &t.baud, &t.bps, &t.errors, &t.fallbacks }, 4 },
+        { "rs485", RS485_KEYS, { &t.turnaroundLast, &t.turnaroundMax, &t.late }, 3 },
+        { "work", WORK_KEYS, { &t.run, &t.depthMax, &t.latencyAvg, &t.latencyMax, &t.overflows }, 5 },
+        { "load", LOAD_KEYS, { &t.loadPermille, &t.shed, &t.levels, &t.misses }, 4 },
+    };
+
+    CborReader reader(data, size);
+    size_t found = 0;
+    while(!reader.atEnd())
+    {
+        size_t entries;
+        const char *name;
+        size_t nameLength;
+        size_t pairs;
+        if(!reader.enterMap(entries) || entries != 1 || !reader.readText(name, nameLength) || !reader.enterMap(pairs))
+        {
+            return false;
+        }
+        const Section *section = nullptr;
+        for(const Section &candidate : sections)
+        {
+            if(textIs(name, nameLength, candidate.name))
+            {
+                section = &candidate;
+                break;
+            }
+        }
+
+        for(size_t i = 0; i < pairs; i++)
+        {
+            const char *key;
+            size_t keyLength;
+            if(!reader.readText(key, keyLength))
+            {
+                return false;
+            }
+            uint32_t *field = nullptr;
+            for(size_t k = 0; section != nullptr && k < section->count; k++)
+            {
+                if(textIs(key, keyLength, section->keys[k]))
+                {
+                    field = section->values[k];
+                    break;
+                }
+            }
+            uint64_t value;
+            if(field != nullptr && reader.readUnsigned(value) && value <= UINT32_MAX)
+            {
+                *field = (uint32_t)value;
+                found++;
+            }
+            else if(!reader.skip())
+            {
+                return false;
+            }
+        }
+    }
+    return found == 16U;
+}
+
+Telemetry sampleTelemetry(uint32_t i)
+{
+    // Counters of a board that has been up a while, varying so nothing is cached
+    Telemetry t;
+    t.baud = (i & 1U) != 0 ? 921600U : 115200U;
+    t.bps = 9000U + i % 2000U;
+    t.errors = i % 7U;
+    t.fallbacks = i % 3U;
+    t.turnaroundLast = 40U + i % 50U;
+    t.turnaroundMax = 180U;
+    t.late = i % 2U;
+    t.run = 100000U + i;
+    t.depthMax = 5U + i % 4U;
+    t.latencyAvg = 12U + i % 9U;
+    t.latencyMax = 900U + i % 300U;
+    t.overflows = 0;
+    t.loadPermille = 400U + i % 500U;
+    t.shed = i % 3U;
+    t.levels = 6;
+    t.misses = i % 5U;
+    return t;
+}
+
+} // namespace
+
+TEST(CborBench, AgainstText) {
+    constexpr uint32_t RECORDS = 100000;
+    char text[512];
+    uint8_t cbor[256];
+    volatile size_t sink = 0;
+
+    size_t textBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        size_t n = formatText(sampleTelemetry(i), text, sizeof(text));
+        textBytes += n;
+        sink = sink + text[n / 2];
+    }
+    double textEncodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+
+    size_t cborBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        size_t n = formatCbor(sampleTelemetry(i), cbor, sizeof(cbor));
+        cborBytes += n;
+        sink = sink + cbor[n / 2];
+    }
+    double cborEncodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+
+    // Decode the same record each time, checked against what was encoded
+    const uint32_t probe = 12345;
+    Telemetry expected = sampleTelemetry(probe);
+    size_t textLength = formatText(expected, text, sizeof(text));
+    size_t cborLength = formatCbor(expected, cbor, sizeof(cbor));
+    ASSERT_GT(cborLength, 0U);
+
+    Telemetry decoded = {};
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        ASSERT_TRUE(parseText(text, decoded));
+    }
+    double textDecodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+    EXPECT_EQ(memcmp(&decoded, &expected, sizeof(expected)), 0);
+
+    decoded = {};
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        ASSERT_TRUE(parseCbor(cbor, cborLength, decoded));
+    }
+    double cborDecodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+    EXPECT_EQ(memcmp(&decoded, &expected, sizeof(expected)), 0);
+
+    printf("[ BENCH    ] telemetry record: text %.1f bytes, encode %.0f ns, parse %.0f ns; "
+           "CBOR %.1f bytes, encode %.0f ns, decode %.0f ns (probe %zu/%zu bytes)\n",
+           (double)textBytes / RECORDS, textEncodeNs, textDecodeNs,
+           (double)cborBytes / RECORDS, cborEncodeNs, cborDecodeNs, textLength, cborLength);
+    RecordProperty("cbor_bytes", std::to_string(cborBytes / RECORDS));
+    EXPECT_LT(cborBytes, textBytes);
+}
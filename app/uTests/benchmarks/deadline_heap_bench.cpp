@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "deadline_heap.h"
+
+TEST(DeadlineHeapBench, ScheduleAndPop) {
+    constexpr size_t N = 64;
+    constexpr int ROUNDS = 200000;
+    DeadlineHeap<N> heap;
+    std::mt19937 rng(3);
+    for(uint8_t id = 0; id < N; id++)
+    {
+        heap.schedule(id, rng() % 10000U);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    for(int i = 0; i < ROUNDS; i++)
+    {
+        auto entry = heap.pop();
+        sum += entry.deadline;
+        heap.schedule(entry.id, entry.deadline + 1000U + rng() % 10000U);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+    EXPECT_EQ(heap.size(), N);
+    EXPECT_NE(sum, 0U);
+    printf("[ BENCH    ] %d pop+schedule with %u timers pending, %.1f ns each\n", ROUNDS, (unsigned int)N, ns);
+}
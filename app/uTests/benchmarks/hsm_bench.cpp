@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "hsm_bus_machine.h"
+
+TEST(HsmBench, DispatchAgainstSwitch) {
+    const size_t count = 1000000;
+    const std::vector<uint8_t> events = busEvents(count);
+
+    Bus bus;
+    Hsm<BusMachine> hsm;
+    hsm.start(bus);
+    auto start = std::chrono::steady_clock::now();
+    size_t handled = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        bus.now = (uint32_t)i;
+        handled += hsm.dispatch(events[i], (uint32_t)i) ? 1U : 0U;
+    }
+    double hsmNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+    SwitchBus reference;
+    start = std::chrono::steady_clock::now();
+    size_t referenceHandled = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        reference.bus.now = (uint32_t)i;
+        referenceHandled += reference.dispatch(events[i], (uint32_t)i) ? 1U : 0U;
+    }
+    double switchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+    EXPECT_EQ(referenceHandled, handled);
+    EXPECT_EQ(reference.bus.sent, bus.sent);
+    printf("[ BENCH    ] %zu events, hsm %.1f ns/event, switch %.1f ns/event\n", count, hsmNs, switchNs);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "kalman.h"
+#include "matrix.h"
+
+namespace {
+
+template<typename T, size_t R, size_t C>
+Matrix<T, R, C> randomMatrix(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix<T, R, C> m;
+    for(size_t r = 0; r < R; r++)
+    {
+        for(size_t c = 0; c < C; c++)
+        {
+            m(r, c) = (T)dist(rng);
+        }
+    }
+    return m;
+}
+
+// One predict and one update of M = N / 3 measurements, in ns
+template<typename T, size_t N>
+void benchmarkSize()
+{
+    constexpr size_t M = N / 3U;
+    constexpr int RUNS = 500;
+    std::mt19937 rng(5);
+
+    Matrix<T, N, N> f = Matrix<T, N, N>::identity();
+    for(size_t i = 0; i + 1U < N; i++)
+    {
+        f(i, i + 1U) = T(0.01);
+    }
+    Matrix<T, M, N> h;
+    for(size_t i = 0; i < M; i++)
+    {
+        h(i, 3U * i) = T(1);
+    }
+    SymMatrix<T, N> q = SymMatrix<T, N>::diagonal(T(1e-3));
+    SymMatrix<T, M> r = SymMatrix<T, M>::diagonal(T(0.1));
+    Vector<T, M> z = randomMatrix<T, M, 1>(rng);
+
+    ExtendedKalmanFilter<T, N> ekf;
+    ekf.reset(Vector<T, N>{}, SymMatrix<T, N>::identity());
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < RUNS; i++)
+    {
+        ekf.predict(Vector<T, N>(f * ekf.state()), f, q);
+        ekf.update(Vector<T, M>(z - h * ekf.state()), h, r);
+    }
+    double ekfNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RUNS;
+
+    UnscentedKalmanFilter<T, N> ukf;
+    ukf.reset(Vector<T, N>{}, SymMatrix<T, N>::identity());
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < RUNS; i++)
+    {
+        ukf.predict([&](const Vector<T, N> &s) { return Vector<T, N>(f * s); }, q);
+        ukf.update([&](const Vector<T, N> &s) { return Vector<T, M>(h * s); }, z, r);
+    }
+    double ukfNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RUNS;
+
+    printf("[ BENCH    ] %-6s N=%-2zu M=%zu: EKF %7.0f ns, UKF %7.0f ns per predict + update\n",
+           sizeof(T) == sizeof(float) ? "float" : "double", N, M, ekfNs, ukfNs);
+    EXPECT_TRUE(std::isfinite((double)ekf.state()[0]));
+    EXPECT_TRUE(std::isfinite((double)ukf.state()[0]));
+}
+
+} // namespace
+
+TEST(KalmanBench, UpdateSteps) {
+    benchmarkSize<float, 3>();
+    benchmarkSize<float, 6>();
+    benchmarkSize<float, 9>();
+    benchmarkSize<float, 12>();
+    benchmarkSize<double, 3>();
+    benchmarkSize<double, 12>();
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include "load_shedder.h"
+
+namespace {
+
+void applyLevel(uint8_t level, void *ctx)
+{
+    *static_cast<uint8_t *>(ctx) = level;
+}
+
+} // namespace
+
+TEST(LoadShedderBench, SampleCost) {
+    constexpr uint32_t SAMPLES = 1000000;
+    uint8_t levels[LOAD_SHED_MAX_CLIENTS] = {};
+    LoadShedder shedder;
+    for(uint8_t i = 0; i < LOAD_SHED_MAX_CLIENTS; i++)
+    {
+        LoadShedClient client = { "client", i, 2, applyLevel, &levels[i] };
+        ASSERT_TRUE(shedder.addClient(client));
+    }
+
+    // Open loop: load wanders over the whole range, so the ladder keeps moving
+    uint32_t seed = 12345;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < SAMPLES; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        uint32_t load = 300U + (seed >> 16) % 700U;
+        shedder.sample(load, load > 950U ? 1U : 0U);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / SAMPLES;
+
+    const LoadShedStats &stats = shedder.stats();
+    EXPECT_EQ(SAMPLES, stats.samples);
+    printf("[ BENCH    ] %u samples over %zu clients: %.1f ns/sample, %u sheds, %u restores, peak level %u\n",
+           (unsigned int)SAMPLES, shedder.clientCount(), ns, (unsigned int)stats.sheds,
+           (unsigned int)stats.restores, (unsigned int)stats.peakLevel);
+}
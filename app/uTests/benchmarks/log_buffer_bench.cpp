@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include "log_buffer.h"
+
+namespace {
+
+enum : uint8_t { DEBUG, INFO, WARN, ERROR };
+
+} // namespace
+
+TEST(LogBufferBench, PushEvictingAndPop) {
+    constexpr uint32_t RECORDS = 1000000;
+
+    // Same layout as the firmware: 2 KiB, debug half, info three quarters
+    uint8_t storage[2048];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+    buffer.setReserve(DEBUG, 1024);
+    buffer.setReserve(INFO, 512);
+    buffer.setReserve(WARN, 192);
+
+    char text[96];
+    int length = snprintf(text, sizeof(text), "chatter from a busy task, %s\n", "padding the record to a realistic length");
+
+    // Nobody reading: once full, every push evicts or is shed, errors included
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        buffer.push((uint8_t)(i % 4U), text, (size_t)length);
+    }
+    double pushNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+
+    char out[LOG_BUFFER_TEXT_MAX];
+    uint8_t severity;
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < RECORDS; i++)
+    {
+        buffer.push((uint8_t)(i % 4U), text, (size_t)length);
+        buffer.pop(severity, out, sizeof(out));
+    }
+    double pairNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RECORDS;
+
+    printf("[ BENCH    ] %u records: push into a full buffer %.1f ns, push + pop %.1f ns; shed debug %u, info %u, warn %u, error %u\n",
+           (unsigned int)RECORDS, pushNs, pairNs, (unsigned int)buffer.totalShed(DEBUG),
+           (unsigned int)buffer.totalShed(INFO), (unsigned int)buffer.totalShed(WARN),
+           (unsigned int)buffer.totalShed(ERROR));
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "mpsc_ring.h"
+
+TEST(MpscRingBench, ConcurrentProducers) {
+    constexpr uint32_t PRODUCERS = 4;
+    constexpr uint32_t ITEMS = 200000;
+    MpscRing<uint32_t, 64> ring;
+    std::atomic<uint32_t> overflows{0};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for(uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&ring, &overflows, p]() {
+            for(uint32_t i = 0; i < ITEMS; i++)
+            {
+                while(!ring.push((p << 24) | i))
+                {
+                    overflows.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(PRODUCERS, 0);
+    uint32_t received = 0;
+    uint32_t misordered = 0;
+    while(received < PRODUCERS * ITEMS)
+    {
+        uint32_t value;
+        if(!ring.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t producer = value >> 24;
+        if(producer >= PRODUCERS || next[producer] != (value & 0xFFFFFFU))
+        {
+            misordered++;
+        }
+        else
+        {
+            next[producer]++;
+        }
+        received++;
+    }
+
+    for(std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / received;
+
+    EXPECT_EQ(0U, misordered);
+    printf("[ BENCH    ] %u items from %u producers, %.1f ns/item, %u full retries\n",
+           (unsigned int)received, (unsigned int)PRODUCERS, ns, (unsigned int)overflows.load());
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "nn_test_model.h"
+
+TEST(NnKernelsBench, AgainstFloat) {
+    std::mt19937 rng(11);
+    TestModel m;
+    addLayer(m, NN_OP_CONV1D, 256, 6, 16, 7, 2, true, rng);
+    addLayer(m, NN_OP_MAX_POOL1D, 125, 16, 16, 2, 2, false, rng);
+    addLayer(m, NN_OP_DEPTHWISE_CONV1D, 62, 16, 16, 5, 1, true, rng);
+    addLayer(m, NN_OP_CONV1D, 58, 16, 32, 3, 2, true, rng);
+    addLayer(m, NN_OP_DENSE, 28, 32, 32, 1, 1, true, rng);
+    addLayer(m, NN_OP_DENSE, 1, 32, 6, 1, 1, false, rng);
+
+    std::vector<std::vector<float>> calibration;
+    for(int i = 0; i < 16; i++)
+    {
+        calibration.push_back(randomInput(m.inputSize(), rng));
+    }
+    quantise(m, calibration);
+
+    constexpr int RUNS = 200;
+    std::vector<float> x = randomInput(m.inputSize(), rng);
+    std::vector<float> scratch(2U * nnLargestTensor(m.layers.data(), m.layers.size()));
+    std::vector<uint8_t> arena(m.model.arenaSize);
+    int8_t *in = nnInput(m.model, arena.data());
+    volatile float sink = 0.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < RUNS; r++)
+    {
+        sink = sink + nnReferenceInvoke(m.layers.data(), m.layers.size(), x.data(), scratch.data(), nullptr)[0];
+    }
+    double floatUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / RUNS;
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < RUNS; r++)
+    {
+        for(size_t i = 0; i < x.size(); i++)
+        {
+            in[i] = nnQuantize(x[i], m.model.inputScale, m.model.inputZero);
+        }
+        nnInvoke(m.model, arena.data());
+        sink = sink + (float)nnOutput(m.model, arena.data())[0];
+    }
+    double int8Us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / RUNS;
+
+    size_t floatWeights = 0;
+    size_t int8Weights = 0;
+    for(size_t i = 0; i < m.layers.size(); i++)
+    {
+        floatWeights += (nnWeightCount(m.layers[i]) + nnBiasCount(m.layers[i])) * sizeof(float);
+        int8Weights += nnWeightCount(m.layers[i]) + nnBiasCount(m.layers[i]) * (2U * sizeof(int32_t) + 1U);
+    }
+    size_t floatArena = scratch.size() * sizeof(float) + x.size() * sizeof(float);
+
+    printf("[ BENCH    ] nn float %.1f us, int8 %.1f us; activations %zu vs %u bytes, weights %zu vs %zu bytes\n",
+           floatUs, int8Us, floatArena, (unsigned)m.model.arenaSize, floatWeights, int8Weights);
+    EXPECT_LT(m.model.arenaSize * 4U, floatArena);
+    EXPECT_LT(int8Weights * 3U, floatWeights);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "real_fft.h"
+#include "fft_reference.h"
+
+TEST(RealFftBench, Transform1024) {
+    constexpr size_t N = 1024;
+    constexpr int RUNS = 2000;
+    std::vector<double> x = randomSignal(N, 0.5, 9);
+
+    auto time = [&](auto *data, auto load, auto transform) {
+        double total = 0.0;
+        for(int r = 0; r < RUNS; r++)
+        {
+            load(data);
+            auto start = std::chrono::steady_clock::now();
+            transform(data);
+            total += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        return total / RUNS;
+    };
+
+    static float f[N];
+    static q15_t q15[N];
+    static q31_t q31[N];
+    double floatUs = time(f, [&](float *d) { for(size_t i = 0; i < N; i++) d[i] = (float)x[i]; },
+                          [](float *d) { RealFft<float, N>::forward(d); });
+    double q15Us = time(q15, [&](q15_t *d) { for(size_t i = 0; i < N; i++) d[i] = FftTraits<q15_t>::fromDouble(x[i]); },
+                        [](q15_t *d) { RealFft<q15_t, N>::forward(d); });
+    double q31Us = time(q31, [&](q31_t *d) { for(size_t i = 0; i < N; i++) d[i] = FftTraits<q31_t>::fromDouble(x[i]); },
+                        [](q31_t *d) { RealFft<q31_t, N>::forward(d); });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<double> reference = naiveSpectrum(x);
+    double dftUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("[ BENCH    ] 1024-point real FFT: float %.1f us, q15 %.1f us, q31 %.1f us, naive DFT %.0f us; tables %zu/%zu/%zu bytes\n",
+           floatUs, q15Us, q31Us, dftUs,
+           RealFft<float, N>::tableBytes(), RealFft<q15_t, N>::tableBytes(), RealFft<q31_t, N>::tableBytes());
+    EXPECT_LT(floatUs * 20.0, dftUs);
+    EXPECT_NEAR(f[2], reference[2], 1e-3);
+}
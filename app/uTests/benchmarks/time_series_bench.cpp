@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "time_series.h"
+
+namespace {
+
+struct FlashSim
+{
+    size_t blockSize = 0;
+    std::map<uint32_t, std::vector<uint8_t>> blocks;
+};
+
+bool spillToSim(uint32_t index, const uint8_t *block, size_t size, void *ctx)
+{
+    FlashSim *sim = static_cast<FlashSim *>(ctx);
+    sim->blocks[index].assign(block, block + size);
+    return true;
+}
+
+bool loadFromSim(uint32_t index, uint8_t *block, size_t size, void *ctx)
+{
+    FlashSim *sim = static_cast<FlashSim *>(ctx);
+    auto it = sim->blocks.find(index);
+    if(it == sim->blocks.end() || it->second.size() != size)
+    {
+        return false;
+    }
+    memcpy(block, it->second.data(), size);
+    return true;
+}
+
+struct Trace
+{
+    std::vector<uint32_t> timestamps;
+    std::vector<float> values;
+};
+
+// Temperature-like signal: 1 s sampling with jitter, slow drift and 0.01 quantization
+Trace syntheticTrace(size_t count)
+{
+    Trace trace;
+    uint32_t timestamp = 1000;
+    srand(1234);
+    for(size_t i = 0; i < count; i++)
+    {
+        timestamp += 1000U + (uint32_t)(rand() % 5);
+        float value = 21.5f + 2.0f * std::sin((float)i / 600.0f) + (float)(rand() % 3) * 0.01f;
+        value = std::round(value * 100.0f) / 100.0f;
+        trace.timestamps.push_back(timestamp);
+        trace.values.push_back(value);
+    }
+    return trace;
+}
+
+// Real traces can be benchmarked with TSDB_TRACE=<csv of "timestamp_ms,value" lines>
+Trace loadTrace()
+{
+    const char *path = getenv("TSDB_TRACE");
+    if(path == nullptr)
+    {
+        return syntheticTrace(20000);
+    }
+
+    Trace trace;
+    FILE *file = fopen(path, "r");
+    if(file == nullptr)
+    {
+        return syntheticTrace(20000);
+    }
+    unsigned long timestamp;
+    float value;
+    while(fscanf(file, "%lu,%f", &timestamp, &value) == 2)
+    {
+        trace.timestamps.push_back((uint32_t)timestamp);
+        trace.values.push_back(value);
+    }
+    fclose(file);
+    return trace;
+}
+
+} // namespace
+
+TEST(TimeSeriesBench, BitsPerSample) {
+    Trace trace = loadTrace();
+    ASSERT_FALSE(trace.timestamps.empty());
+
+    const size_t blockSize = 512;
+    const size_t blockCount = 4;
+    std::vector<uint8_t> storage(blockCount * blockSize);
+    std::vector<uint8_t> scratch(blockSize);
+    FlashSim sim;
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), blockSize, blockCount, TsValueType::Float, spillToSim, loadFromSim, &sim };
+    ASSERT_TRUE(store.init(config));
+
+    for(size_t i = 0; i < trace.timestamps.size(); i++)
+    {
+        ASSERT_TRUE(store.append(trace.timestamps[i], trace.values[i]));
+    }
+    store.flush();
+
+    size_t totalBits = 0;
+    for(const auto &entry : sim.blocks)
+    {
+        TsBlockHeader header;
+        memcpy(&header, entry.second.data(), sizeof(header));
+        totalBits += header.bitLength + TS_BLOCK_HEADER_SIZE * 8U;
+    }
+    double bitsPerSample = (double)totalBits / (double)trace.timestamps.size();
+
+    auto start = std::chrono::steady_clock::now();
+    TsQuery query = store.query(0, UINT32_MAX, scratch.data());
+    TsSample sample;
+    size_t decoded = 0;
+    while(query.next(sample))
+    {
+        ASSERT_EQ(sample.timestamp, trace.timestamps[decoded]);
+        ASSERT_EQ(sample.asFloat(), trace.values[decoded]);
+        decoded++;
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(decoded, trace.timestamps.size());
+
+    printf("[ BENCH    ] %zu samples, %.2f bits/sample (raw 64), decode %.1f ns/sample\n",
+           decoded, bitsPerSample, elapsed * 1000.0 / (double)decoded);
+    RecordProperty("bits_per_sample", std::to_string(bitsPerSample));
+    EXPECT_LT(bitsPerSample, 64.0);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "time_sync.h"
+
+namespace {
+
+struct Exchange
+{
+    uint64_t t1, t2, t3, t4;
+};
+
+// Exchanges one second apart against a reference 40 ppm slow, with up to 2 ms of jitter each way
+std::vector<Exchange> exchanges(size_t count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> jitter(0.0, 2000.0);
+    std::vector<Exchange> out(count);
+    double t = 0.0;
+    for(size_t i = 0; i < count; i++)
+    {
+        double arrive = t + 2500.0 + jitter(rng);
+        double reply = arrive + 200.0;
+        double back = reply + 2500.0 + jitter(rng);
+        out[i] = { (uint64_t)((t + 5e6) * 1.00004), (uint64_t)arrive, (uint64_t)reply, (uint64_t)((back + 5e6) * 1.00004) };
+        t += 1e6;
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(TimeSyncBench, SampleAndConvert) {
+    constexpr size_t COUNT = 100000;
+    const std::vector<Exchange> samples = exchanges(COUNT);
+
+    TimeSyncClock clock;
+    auto start = std::chrono::steady_clock::now();
+    for(const Exchange &e : samples)
+    {
+        clock.addSample(e.t1, e.t2, e.t3, e.t4);
+    }
+    double sampleNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / COUNT;
+    ASSERT_TRUE(clock.synced());
+
+    uint64_t sum = 0;
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < COUNT; i++)
+    {
+        sum += clock.toReference(samples[i].t4 + i);
+    }
+    double convertNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / COUNT;
+    EXPECT_GT(sum, 0U);
+
+    printf("[ BENCH    ] %zu exchanges: addSample %.1f ns, toReference %.1f ns; %u accepted, drift %d ppb, jitter %u us\n",
+           COUNT, sampleNs, convertNs, (unsigned int)clock.stats().accepted, (int)clock.stats().driftPpb,
+           (unsigned int)clock.stats().jitterUs);
+}
@@ -0,0 +1,59 @@
+#ifndef FFT_REFERENCE_H
+#define FFT_REFERENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Naive DFT and test signals the FFT is checked and timed against
+
+constexpr double FFT_REFERENCE_PI = 3.14159265358979323846;
+
+// Reference spectrum, packed the same way as RealFft
+inline std::vector<double> naiveSpectrum(const std::vector<double> &x)
+{
+    size_t n = x.size();
+    std::vector<double> packed(n);
+    for(size_t k = 0; k <= n / 2U; k++)
+    {
+        double re = 0.0;
+        double im = 0.0;
+        for(size_t i = 0; i < n; i++)
+        {
+            double angle = 2.0 * FFT_REFERENCE_PI * (double)((k * i) % n) / (double)n;
+            re += x[i] * std::cos(angle);
+            im -= x[i] * std::sin(angle);
+        }
+        if(k == 0)
+        {
+            packed[0] = re;
+        }
+        else if(k == n / 2U)
+        {
+            packed[1] = re;
+        }
+        else
+        {
+            packed[2U * k] = re;
+            packed[2U * k + 1U] = im;
+        }
+    }
+    return packed;
+}
+
+inline std::vector<double> randomSignal(size_t n, double amplitude, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-amplitude, amplitude);
+    std::vector<double> x(n);
+    for(double &v : x)
+    {
+        v = dist(rng);
+    }
+    return x;
+}
+
+#endif /* FFT_REFERENCE_H */
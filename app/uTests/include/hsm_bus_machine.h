@@ -0,0 +1,139 @@
+#ifndef HSM_BUS_MACHINE_H
+#define HSM_BUS_MACHINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "hsm.h"
+
+// Bus transfer protocol as driven by the SMBus task, as an HSM table and
+// as the hand-written switch it replaces. The unit tests check that the
+// two agree and the benchmark times them against each other.
+
+constexpr uint32_t PERIOD = 20;
+constexpr uint32_t BACKOFF = 100;
+constexpr uint32_t MAX_FAILURES = 3;
+
+struct Bus
+{
+    uint32_t nextSend = 0;
+    uint32_t failures = 0;
+    uint32_t backoffUntil = 0;
+    uint32_t sent = 0;
+    uint32_t faults = 0;
+    uint32_t now = 0;
+};
+
+struct BusMachine
+{
+    using Context = Bus;
+    using Payload = uint32_t;
+
+    enum State : uint8_t { ACTIVE, IDLE, SENDING, BACKOFF_WAIT };
+    enum Event : uint8_t { TICK, DONE, ERROR, EVENT_COUNT };
+    static constexpr uint8_t INITIAL = ACTIVE;
+
+    static void enterActive(Bus &bus) { bus.failures = 0; }
+    static void enterBackoff(Bus &bus) { bus.faults++; bus.backoffUntil = bus.now + BACKOFF; }
+
+    static bool due(Bus &bus, const uint32_t &now) { return now >= bus.nextSend; }
+    static bool canRetry(Bus &bus, const uint32_t &) { return bus.failures + 1U < MAX_FAILURES; }
+    static bool backoffOver(Bus &bus, const uint32_t &now) { return now >= bus.backoffUntil; }
+
+    static void start(Bus &bus, const uint32_t &now) { bus.nextSend = now + PERIOD; }
+    static void complete(Bus &bus, const uint32_t &) { bus.failures = 0; bus.sent++; }
+    static void retry(Bus &bus, const uint32_t &) { bus.failures++; }
+
+    static constexpr HsmState<Bus> states[] = {
+        { ACTIVE,       HSM_NONE, IDLE,     enterActive,  nullptr },
+        { IDLE,         ACTIVE,   HSM_NONE, nullptr,      nullptr },
+        { SENDING,      ACTIVE,   HSM_NONE, nullptr,      nullptr },
+        { BACKOFF_WAIT, HSM_NONE, HSM_NONE, enterBackoff, nullptr },
+    };
+
+    static constexpr HsmTransition<Bus, uint32_t> transitions[] = {
+        { IDLE,         TICK,  SENDING,      due,         start },
+        { SENDING,      DONE,  IDLE,         nullptr,     complete },
+        { SENDING,      ERROR, IDLE,         canRetry,    retry },
+        { SENDING,      ERROR, BACKOFF_WAIT, nullptr,     nullptr },
+        { BACKOFF_WAIT, TICK,  ACTIVE,       backoffOver, nullptr },
+    };
+};
+
+/**
+ * The same protocol written the usual way, as the baseline for the benchmark
+ */
+struct SwitchBus
+{
+    Bus bus;
+    uint8_t state = BusMachine::IDLE;
+
+    bool dispatch(uint8_t event, uint32_t now)
+    {
+        switch(state)
+        {
+        case BusMachine::IDLE:
+            if(event == BusMachine::TICK && now >= bus.nextSend)
+            {
+                bus.nextSend = now + PERIOD;
+                state = BusMachine::SENDING;
+                return true;
+            }
+            return false;
+
+        case BusMachine::SENDING:
+            if(event == BusMachine::DONE)
+            {
+                bus.failures = 0;
+                bus.sent++;
+                state = BusMachine::IDLE;
+                return true;
+            }
+            if(event == BusMachine::ERROR)
+            {
+                if(bus.failures + 1U < MAX_FAILURES)
+                {
+                    bus.failures++;
+                    state = BusMachine::IDLE;
+                }
+                else
+                {
+                    bus.faults++;
+                    bus.backoffUntil = bus.now + BACKOFF;
+                    state = BusMachine::BACKOFF_WAIT;
+                }
+                return true;
+            }
+            return false;
+
+        case BusMachine::BACKOFF_WAIT:
+            if(event == BusMachine::TICK && now >= bus.backoffUntil)
+            {
+                bus.failures = 0;
+                state = BusMachine::IDLE;
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+        }
+    }
+};
+
+inline std::vector<uint8_t> busEvents(size_t count)
+{
+    std::vector<uint8_t> events(count);
+    uint32_t x = 12345;
+    for(size_t i = 0; i < count; i++)
+    {
+        x = x * 1103515245U + 12345U;
+        uint32_t r = (x >> 16) % 16U;
+        events[i] = r < 10U ? BusMachine::TICK : (r < 14U ? BusMachine::DONE : BusMachine::ERROR);
+    }
+    return events;
+}
+
+#endif /* HSM_BUS_MACHINE_H */
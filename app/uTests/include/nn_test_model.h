@@ -0,0 +1,110 @@
+#ifndef NN_TEST_MODEL_H
+#define NN_TEST_MODEL_H
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "nn_model.h"
+#include "nn_quantizer.h"
+#include "nn_reference.h"
+
+// Random float models and their int8 copies, built the way the converter does
+
+// A float model with its quantised copy and everything both point at
+struct TestModel
+{
+    std::vector<NnFloatLayer> layers;
+    std::vector<std::vector<float>> weights;
+    std::vector<std::vector<float>> biases;
+
+    std::vector<NnLayer> quantised;
+    std::vector<std::vector<int8_t>> qWeights;
+    std::vector<std::vector<int32_t>> qBiases;
+    std::vector<std::vector<int32_t>> multipliers;
+    std::vector<std::vector<int8_t>> shifts;
+    std::vector<uint32_t> offsets;
+    std::vector<NnTensorQuant> quants;
+    NnModel model;
+
+    size_t inputSize() const { return (size_t)layers[0].length * layers[0].channels; }
+};
+
+inline void addLayer(TestModel &m, NnOp op, uint16_t length, uint16_t channels, uint16_t outChannels,
+                     uint8_t kernel, uint8_t stride, bool relu, std::mt19937 &rng)
+{
+    NnFloatLayer layer = {op, length, channels, outChannels, kernel, stride, relu, nullptr, nullptr};
+    size_t fanIn = op == NN_OP_DENSE ? (size_t)length * channels : op == NN_OP_CONV1D ? (size_t)kernel * channels : kernel;
+    std::normal_distribution<float> dist(0.0f, 1.0f / std::sqrt((float)fanIn));
+    m.weights.emplace_back(nnWeightCount(layer));
+    m.biases.emplace_back(nnBiasCount(layer));
+    for(float &w : m.weights.back())
+    {
+        w = dist(rng);
+    }
+    for(float &b : m.biases.back())
+    {
+        b = 0.1f * dist(rng);
+    }
+    m.layers.push_back(layer);
+}
+
+inline std::vector<float> randomInput(size_t n, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+    std::vector<float> x(n);
+    for(float &v : x)
+    {
+        v = dist(rng);
+    }
+    return x;
+}
+
+// Calibrate on the inputs given, then quantise layer by layer; pools keep their input's quantisation
+inline void quantise(TestModel &m, const std::vector<std::vector<float>> &calibration)
+{
+    size_t count = m.layers.size();
+    for(size_t i = 0; i < count; i++)
+    {
+        m.layers[i].weights = m.weights[i].data();
+        m.layers[i].bias = m.biases[i].data();
+    }
+
+    std::vector<NnRange> ranges(count + 1U, NnRange{0.0f, 0.0f});
+    std::vector<float> scratch(2U * nnLargestTensor(m.layers.data(), count));
+    for(const std::vector<float> &x : calibration)
+    {
+        nnReferenceInvoke(m.layers.data(), count, x.data(), scratch.data(), ranges.data());
+    }
+
+    m.quants.resize(count + 1U);
+    m.quants[0] = nnChooseQuant(ranges[0].min, ranges[0].max);
+    m.quantised.resize(count);
+    m.qWeights.resize(count);
+    m.qBiases.resize(count);
+    m.multipliers.resize(count);
+    m.shifts.resize(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        const NnFloatLayer &layer = m.layers[i];
+        bool pool = layer.op == NN_OP_MAX_POOL1D || layer.op == NN_OP_AVG_POOL1D;
+        m.quants[i + 1U] = pool ? m.quants[i] : nnChooseQuant(ranges[i + 1U].min, ranges[i + 1U].max);
+        m.qWeights[i].resize(nnWeightCount(layer));
+        m.qBiases[i].resize(nnBiasCount(layer));
+        m.multipliers[i].resize(nnBiasCount(layer));
+        m.shifts[i].resize(nnBiasCount(layer));
+        ASSERT_TRUE(nnQuantizeLayer(layer, m.quants[i], m.quants[i + 1U], m.qWeights[i].data(), m.qBiases[i].data(),
+                                    m.multipliers[i].data(), m.shifts[i].data(), m.quantised[i]));
+    }
+
+    ASSERT_TRUE(nnChainValid(m.quantised.data(), count));
+    m.offsets.resize(count + 1U);
+    uint32_t arena = nnPlanOffsets(m.quantised.data(), count, m.offsets.data());
+    m.model = NnModel{m.quantised.data(), count, m.offsets.data(), arena,
+                      m.quants[0].scale, m.quants[0].zero, m.quants[count].scale, m.quants[count].zero};
+}
+
+#endif /* NN_TEST_MODEL_H */
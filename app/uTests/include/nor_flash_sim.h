@@ -0,0 +1,50 @@
+#ifndef NOR_FLASH_SIM_H
+#define NOR_FLASH_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "nor_flash.h"
+
+// File-backed NOR flash simulator for host builds.
+// Keeps an in-memory image (also published as the memory-mapped view) and
+// writes every change through to the backing file, so a log survives a
+// "reboot" by reopening the same file. Enforces NOR semantics: programming
+// can only clear bits and erasing resets a whole sector to 0xFF.
+class NorFlashSim
+{
+public:
+    ~NorFlashSim();
+
+    bool open(const char *path, uint32_t size, uint32_t sectorSize, uint32_t pageSize);
+    void close();
+
+    const NorFlash &device() const { return flash; }
+
+    // Bits that a program operation tried to set from 0 to 1 (a driver bug on real parts)
+    uint32_t illegalBitSets() const { return badBits; }
+    uint32_t eraseCount(uint32_t sector) const { return erases[sector]; }
+
+    // Simulate a torn write: after 'skip' intact program operations, the next
+    // one only writes its first 'bytes' bytes
+    void tearProgram(uint32_t skip, uint32_t bytes) { tearSkip = skip; tearAfter = (int64_t)bytes; }
+
+private:
+    static bool read(void *ctx, uint32_t address, uint8_t *data, uint32_t length);
+    static bool program(void *ctx, uint32_t address, const uint8_t *data, uint32_t length);
+    static bool eraseSector(void *ctx, uint32_t address);
+
+    bool writeThrough(uint32_t address, uint32_t length);
+
+    FILE *file = nullptr;
+    std::vector<uint8_t> image;
+    std::vector<uint32_t> erases;
+    NorFlash flash = {};
+    uint32_t badBits = 0;
+    uint32_t tearSkip = 0;
+    int64_t tearAfter = -1;
+};
+
+#endif // NOR_FLASH_SIM_H
@@ -0,0 +1,50 @@
+#ifndef UART_LINK_SIM_H
+#define UART_LINK_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "channel_mux.h"
+
+// Full-duplex UART link between two ChannelMux ends for host builds.
+// Time advances in microseconds; each direction moves one byte per
+// character time (10 bits at the configured baud rate) and polls its mux
+// for the next frame as soon as the previous one has left the wire.
+class UartLinkSim
+{
+public:
+    UartLinkSim(ChannelMux &a, ChannelMux &b, uint32_t baudRate);
+
+    // Advance the simulated time by the given number of microseconds
+    void run(uint64_t us);
+
+    uint64_t nowUs() const { return nowNs / 1000U; }
+
+    // Flip bits in the next byte sent from end A (0) or B (1)
+    void corruptNext(int from, uint8_t mask) { ends[from].corruptMask = mask; }
+
+    uint64_t bytesSent(int from) const { return ends[from].bytes; }
+
+private:
+    struct End
+    {
+        ChannelMux *mux;
+        ChannelMux *peer;
+        std::vector<uint8_t> frame;
+        size_t pos = 0;
+        size_t length = 0;
+        uint64_t nextByteNs = 0;
+        uint64_t bytes = 0;
+        uint8_t corruptMask = 0;
+    };
+
+    void step(End &end);
+
+    End ends[2];
+    uint64_t nowNs = 0;
+    uint64_t byteNs;
+};
+
+#endif /* UART_LINK_SIM_H */
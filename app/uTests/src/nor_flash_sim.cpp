@@ -0,0 +1,120 @@
+#include "nor_flash_sim.h"
+
+#include <string.h>
+
+NorFlashSim::~NorFlashSim()
+{
+    close();
+}
+
+bool NorFlashSim::open(const char *path, uint32_t size, uint32_t sectorSize, uint32_t pageSize)
+{
+    close();
+
+    image.assign(size, 0xFF);
+    erases.assign(size / sectorSize, 0);
+
+    file = fopen(path, "r+b");
+    if(file != nullptr)
+    {
+        size_t got = fread(image.data(), 1, size, file);
+        (void)got;
+    }
+    else
+    {
+        file = fopen(path, "w+b");
+        if(file == nullptr)
+        {
+            return false;
+        }
+    }
+    if(!writeThrough(0, size))
+    {
+        return false;
+    }
+
+    flash.size = size;
+    flash.sectorSize = sectorSize;
+    flash.pageSize = pageSize;
+    flash.mapped = image.data();
+    flash.read = read;
+    flash.program = program;
+    flash.eraseSector = eraseSector;
+    flash.ctx = this;
+    return true;
+}
+
+void NorFlashSim::close()
+{
+    if(file != nullptr)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool NorFlashSim::read(void *ctx, uint32_t address, uint8_t *data, uint32_t length)
+{
+    NorFlashSim *sim = static_cast<NorFlashSim *>(ctx);
+    if((uint64_t)address + length > sim->image.size())
+    {
+        return false;
+    }
+    memcpy(data, &sim->image[address], length);
+    return true;
+}
+
+bool NorFlashSim::program(void *ctx, uint32_t address, const uint8_t *data, uint32_t length)
+{
+    NorFlashSim *sim = static_cast<NorFlashSim *>(ctx);
+    if((uint64_t)address + length > sim->image.size())
+    {
+        return false;
+    }
+
+    uint32_t written = length;
+    if(sim->tearAfter >= 0 && sim->tearSkip > 0)
+    {
+        sim->tearSkip--;
+    }
+    else if(sim->tearAfter >= 0)
+    {
+        written = ((uint64_t)sim->tearAfter < length) ? (uint32_t)sim->tearAfter : length;
+        sim->tearAfter = -1;
+    }
+
+    for(uint32_t i = 0; i < written; i++)
+    {
+        uint8_t before = sim->image[address + i];
+        if((data[i] & ~before) != 0U)
+        {
+            sim->badBits++;
+        }
+        sim->image[address + i] = (uint8_t)(before & data[i]);
+    }
+    return sim->writeThrough(address, written);
+}
+
+bool NorFlashSim::eraseSector(void *ctx, uint32_t address)
+{
+    NorFlashSim *sim = static_cast<NorFlashSim *>(ctx);
+    uint32_t sector = address / sim->flash.sectorSize;
+    if(sector >= sim->erases.size())
+    {
+        return false;
+    }
+    uint32_t start = sector * sim->flash.sectorSize;
+    memset(&sim->image[start], 0xFF, sim->flash.sectorSize);
+    sim->erases[sector]++;
+    return sim->writeThrough(start, sim->flash.sectorSize);
+}
+
+bool NorFlashSim::writeThrough(uint32_t address, uint32_t length)
+{
+    if(fseek(file, (long)address, SEEK_SET) != 0 ||
+       fwrite(&image[address], 1, length, file) != length)
+    {
+        return false;
+    }
+    return fflush(file) == 0;
+}
@@ -0,0 +1,49 @@
+#include "uart_link_sim.h"
+
+UartLinkSim::UartLinkSim(ChannelMux &a, ChannelMux &b, uint32_t baudRate)
+    : byteNs(10000000000ULL / baudRate)
+{
+    ends[0].mux = &a;
+    ends[0].peer = &b;
+    ends[1].mux = &b;
+    ends[1].peer = &a;
+    for(End &end : ends)
+    {
+        end.frame.resize(MUX_FRAME_SIZE(MUX_MAX_PAYLOAD));
+    }
+}
+
+void UartLinkSim::step(End &end)
+{
+    while(end.nextByteNs <= nowNs)
+    {
+        if(end.pos == end.length)
+        {
+            end.pos = 0;
+            end.length = end.mux->poll(end.frame.data(), end.frame.size());
+            if(end.length == 0)
+            {
+                // Line idle, the transmitter picks up new data on the next tick
+                end.nextByteNs = nowNs + 1000U;
+                return;
+            }
+        }
+
+        uint8_t byte = end.frame[end.pos++] ^ end.corruptMask;
+        end.corruptMask = 0;
+        end.peer->receive(&byte, 1);
+        end.bytes++;
+        end.nextByteNs += byteNs;
+    }
+}
+
+void UartLinkSim::run(uint64_t us)
+{
+    uint64_t until = nowNs + us * 1000U;
+    while(nowNs < until)
+    {
+        nowNs += 1000U;
+        step(ends[0]);
+        step(ends[1]);
+    }
+}
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "baud_negotiator.h"
+
+namespace {
+
+const uint32_t rates[] = {2000000U, 1000000U, 460800U, 115200U};
+
+/**
+ * Two negotiators on a frame-level line: a frame arrives 1 ms after it was
+ * sent, as garbage if the ends disagree on the rate or the rate exceeds what
+ * the cable carries.
+ */
+struct Line
+{
+    struct InFlight
+    {
+        uint32_t arrivalMs;
+        uint32_t baud;          // Sender rate
+        bool corrupted;
+        std::vector<uint8_t> payload;
+    };
+
+    struct End
+    {
+        Line *line;
+        BaudNegotiator negotiator;
+        uint32_t baud = 0;
+        uint32_t maxSupported = 0xFFFFFFFFU;
+        std::deque<InFlight> inbox;
+        uint32_t delivered = 0;
+    };
+
+    End ends[2];
+    uint32_t limit = 1000000U;
+    uint32_t now = 0;
+    bool slavePresent = true;
+
+    static bool supported(uint32_t baud, void *ctx)
+    {
+        return baud <= static_cast<End *>(ctx)->maxSupported;
+    }
+
+    static bool setBaud(uint32_t baud, void *ctx)
+    {
+        static_cast<End *>(ctx)->baud = baud;
+        return true;
+    }
+
+    static bool send(const uint8_t *payload, size_t length, void *ctx)
+    {
+        End *self = static_cast<End *>(ctx);
+        Line *line = self->line;
+        End &peer = self == &line->ends[0] ? line->ends[1] : line->ends[0];
+        peer.inbox.push_back({line->now + 1U, self->baud, self->baud > line->limit,
+                              std::vector<uint8_t>(payload, payload + length)});
+        return true;
+    }
+
+    void init()
+    {
+        for(int i = 0; i < 2; i++)
+        {
+            ends[i].line = this;
+            BaudNegotiatorConfig config;
+            config.master = i == 0;
+            config.rates = rates;
+            config.rateCount = 4;
+            config.rateSupported = supported;
+            config.setBaud = setBaud;
+            config.sendFrame = send;
+            config.ctx = &ends[i];
+            ASSERT_TRUE(ends[i].negotiator.init(config, now));
+        }
+    }
+
+    void deliver(End &end)
+    {
+        while(!end.inbox.empty() && end.inbox.front().arrivalMs <= now)
+        {
+            InFlight frame = end.inbox.front();
+            end.inbox.pop_front();
+
+            if(&end == &ends[1] && !slavePresent)
+            {
+                continue;
+            }
+            if(frame.baud != end.baud || frame.corrupted)
+            {
+                end.negotiator.reportErrors(1, now);
+            }
+            else if(BaudNegotiator::isControlFrame(frame.payload.data(), frame.payload.size()))
+            {
+                end.negotiator.handleFrame(frame.payload.data(), frame.payload.size(), now);
+            }
+            else
+            {
+                end.negotiator.noteGoodFrame(now);
+                end.negotiator.noteDelivered(static_cast<uint32_t>(frame.payload.size()));
+                end.delivered++;
+            }
+        }
+    }
+
+    /**
+     * @brief Advance in 1 ms steps, the master streams 32-byte data frames every 5 ms when ready
+     */
+    void run(uint32_t ms, bool traffic = true)
+    {
+        for(uint32_t i = 0; i < ms; i++)
+        {
+            now++;
+            deliver(ends[0]);
+            deliver(ends[1]);
+            ends[0].negotiator.tick(now);
+            ends[1].negotiator.tick(now);
+            if(traffic && now % 5U == 0 && ends[0].negotiator.linkReady())
+            {
+                uint8_t data[32] = {0x01};
+                send(data, sizeof(data), &ends[0]);
+            }
+        }
+    }
+
+    const BaudNegotiator &master() const { return ends[0].negotiator; }
+    const BaudNegotiator &slave() const { return ends[1].negotiator; }
+};
+
+} // namespace
+
+TEST(BaudNegotiatorTest, SettlesOnFastestRateThatPassesTheTest) {
+    Line line;
+    line.init();
+    line.run(2000);
+
+    // 2 Mbaud fails the test burst, 1 Mbaud is the cable limit
+    EXPECT_TRUE(line.master().linkReady());
+    EXPECT_TRUE(line.slave().linkReady());
+    EXPECT_EQ(1000000U, line.master().baud());
+    EXPECT_EQ(1000000U, line.slave().baud());
+    EXPECT_EQ(1U, line.master().stats().trialsFailed);
+    EXPECT_EQ(0U, line.master().stats().fallbacks);
+    EXPECT_GT(line.slave().stats().throughputBps, 5000U);
+}
+
+TEST(BaudNegotiatorTest, SkipsRatesThePeerCannotGenerate) {
+    Line line;
+    line.ends[1].maxSupported = 460800U;
+    line.init();
+    line.run(2000);
+
+    // Rejected rates cost one round trip each, no test burst
+    EXPECT_EQ(460800U, line.master().baud());
+    EXPECT_EQ(460800U, line.slave().baud());
+    EXPECT_EQ(0U, line.master().stats().trialsFailed);
+}
+
+TEST(BaudNegotiatorTest, FallsBackAndRenegotiatesWhenTheLineDegrades) {
+    Line line;
+    line.init();
+    line.run(2000);
+    ASSERT_EQ(1000000U, line.master().baud());
+
+    // The cable now only carries 460.8 kbaud: the slave sees the data frames fail
+    line.limit = 460800U;
+    line.run(200);
+    EXPECT_EQ(1U, line.slave().stats().fallbacks);
+    EXPECT_EQ(115200U, line.slave().baud());
+
+    // The master notices silence, then renegotiates skipping 1 Mbaud
+    line.run(5000);
+    EXPECT_TRUE(line.master().linkReady());
+    EXPECT_EQ(460800U, line.master().baud());
+    EXPECT_EQ(460800U, line.slave().baud());
+    uint32_t delivered = line.ends[1].delivered;
+    line.run(1000);
+    EXPECT_GT(line.ends[1].delivered, delivered + 150U);
+
+    // After the hold-off the master probes faster rates again and comes back down
+    line.run(40000);
+    EXPECT_EQ(460800U, line.master().baud());
+    EXPECT_EQ(460800U, line.slave().baud());
+    EXPECT_EQ(1U, line.master().stats().fallbacks);
+    EXPECT_EQ(1U, line.slave().stats().fallbacks);
+}
+
+TEST(BaudNegotiatorTest, StaysAtSafeRateWithoutPeer) {
+    Line line;
+    line.slavePresent = false;
+    line.init();
+    line.run(2000);
+
+    EXPECT_TRUE(line.master().linkReady());
+    EXPECT_EQ(115200U, line.master().baud());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "budget_ledger.h"
+
+namespace {
+
+int taskA;
+int taskB;
+
+} // namespace
+
+TEST(BudgetLedgerTest, AddRejectsDuplicatesAndOverflow) {
+    BudgetLedger ledger;
+    EXPECT_FALSE(ledger.add(nullptr, "none", 100, 0));
+    EXPECT_TRUE(ledger.add(&taskA, "a", 100, 0));
+    EXPECT_FALSE(ledger.add(&taskA, "again", 100, 0));
+    EXPECT_EQ(ledger.find(&taskA), 0U);
+    EXPECT_EQ(ledger.find(&taskB), ledger.count());
+
+    uint8_t others[BUDGET_LEDGER_MAX_ACCOUNTS];
+    for(size_t i = 1; i < BUDGET_LEDGER_MAX_ACCOUNTS; i++)
+    {
+        EXPECT_TRUE(ledger.add(&others[i], "x", 100, 0));
+    }
+    EXPECT_FALSE(ledger.add(&taskB, "full", 100, 0));
+}
+
+TEST(BudgetLedgerTest, ExceedingThrottlesOnceAndReplenishRestores) {
+    BudgetLedger ledger;
+    ASSERT_TRUE(ledger.add(&taskA, "a", 1000, 0xFFFFFF00U));
+
+    // The counter wraps while the task runs
+    EXPECT_EQ(ledger.charge(0, 0x00000100U), BUDGET_NONE);
+    EXPECT_EQ(ledger.account(0).used, 0x200U);
+    EXPECT_EQ(ledger.charge(0, 0x00000500U), BUDGET_EXCEEDED);
+    EXPECT_TRUE(ledger.account(0).throttled);
+    EXPECT_EQ(ledger.charge(0, 0x00000600U), BUDGET_NONE);
+    EXPECT_EQ(ledger.account(0).violations, 1U);
+
+    // 1792 run against 1000: the 792 overrun is carried, leaving budget to run on
+    EXPECT_EQ(ledger.replenish(0, 0x00000600U), BUDGET_RESTORED);
+    const BudgetAccount &account = ledger.account(0);
+    EXPECT_FALSE(account.throttled);
+    EXPECT_EQ(account.used, 792U);
+    EXPECT_EQ(account.lastPeriod, 1792U);
+    EXPECT_EQ(account.peak, 1792U);
+    EXPECT_EQ(account.throttledPeriods, 1U);
+
+    // The debt counts, 300 more is over again
+    EXPECT_EQ(ledger.charge(0, 0x00000600U + 300U), BUDGET_EXCEEDED);
+    EXPECT_EQ(account.violations, 2U);
+}
+
+TEST(BudgetLedgerTest, LargeOverrunSitsOutAPeriod) {
+    BudgetLedger ledger;
+    ASSERT_TRUE(ledger.add(&taskA, "a", 1000, 0));
+    EXPECT_EQ(ledger.charge(0, 5000), BUDGET_EXCEEDED);
+
+    // The debt is capped at one budget: one period throttled, then released if it stays quiet
+    EXPECT_EQ(ledger.replenish(0, 5000), BUDGET_NONE);
+    EXPECT_TRUE(ledger.account(0).throttled);
+    EXPECT_EQ(ledger.account(0).used, 1000U);
+    EXPECT_EQ(ledger.replenish(0, 5000), BUDGET_RESTORED);
+    EXPECT_EQ(ledger.account(0).used, 0U);
+    EXPECT_EQ(ledger.account(0).lastPeriod, 0U);
+    EXPECT_EQ(ledger.account(0).peak, 5000U);
+    EXPECT_EQ(ledger.account(0).violations, 1U);
+
+    // Still running while throttled keeps it out
+    EXPECT_EQ(ledger.charge(0, 7000), BUDGET_EXCEEDED);
+    EXPECT_EQ(ledger.replenish(0, 8000), BUDGET_NONE);
+    EXPECT_EQ(ledger.replenish(0, 9500), BUDGET_NONE);
+    EXPECT_EQ(ledger.replenish(0, 9500), BUDGET_RESTORED);
+}
+
+TEST(BudgetLedgerTest, ZeroBudgetOnlyAccounts) {
+    BudgetLedger ledger;
+    ASSERT_TRUE(ledger.add(&taskB, "b", 0, 0));
+    EXPECT_EQ(ledger.charge(0, 1000000), BUDGET_NONE);
+    EXPECT_EQ(ledger.replenish(0, 1500000), BUDGET_NONE);
+    EXPECT_EQ(ledger.account(0).lastPeriod, 1500000U);
+    EXPECT_EQ(ledger.account(0).used, 0U);
+    EXPECT_FALSE(ledger.account(0).throttled);
+
+    ledger.setBudget(0, 100);
+    EXPECT_EQ(ledger.charge(0, 1500200), BUDGET_EXCEEDED);
+}
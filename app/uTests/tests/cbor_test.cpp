@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "cbor.h"
+
+namespace {
+
+std::string hex(const uint8_t *data, size_t length)
+{
+    std::string text;
+    char digits[3];
+    for(size_t i = 0; i < length; i++)
+    {
+        snprintf(digits, sizeof(digits), "%02x", data[i]);
+        text += digits;
+    }
+    return text;
+}
+
+template<typename Encode>
+std::string encoded(Encode encode)
+{
+    uint8_t out[64];
+    CborWriter writer(out, sizeof(out));
+    encode(writer);
+    EXPECT_TRUE(writer.ok());
+    return hex(out, writer.size());
+}
+
+std::vector<uint8_t> bytes(const char *hexText)
+{
+    std::vector<uint8_t> out;
+    for(size_t i = 0; hexText[i] != '\0' && hexText[i + 1] != '\0'; i += 2)
+    {
+        unsigned int value;
+        sscanf(&hexText[i], "%2x", &value);
+        out.push_back((uint8_t)value);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(CborTest, EncodesTheRfcExamples) {
+    // RFC 8949 appendix A, preferred serialization
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(0); }), "00");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(23); }), "17");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(24); }), "1818");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(1000); }), "1903e8");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(1000000); }), "1a000f4240");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(1000000000000ULL); }), "1b000000e8d4a51000");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeUnsigned(UINT64_MAX); }), "1bffffffffffffffff");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeInt(-1); }), "20");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeInt(-1000); }), "3903e7");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeInt(INT64_MIN); }), "3b7fffffffffffffff");
+
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(0.0); }), "f90000");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(-0.0); }), "f98000");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(1.5); }), "f93e00");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(65504.0); }), "f97bff");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(100000.0); }), "fa47c35000");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(1.1); }), "fb3ff199999999999a");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(5.960464477539063e-8); }), "f90001");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(0.00006103515625); }), "f90400");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(-4.0); }), "f9c400");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(INFINITY); }), "f97c00");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(-INFINITY); }), "f9fc00");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(NAN); }), "f97e00");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeFloat(3.4028234663852886e+38f); }), "fa7f7fffff");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeDouble(1.0e+300); }), "fb7e37e43c8800759c");
+
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeBool(false); w.writeBool(true); w.writeNull(); }), "f4f5f6");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeText(""); w.writeText("IETF"); }), "606449455446");
+    EXPECT_EQ(encoded([](CborWriter &w) {
+        static const uint8_t data[] = { 1, 2, 3, 4 };
+        w.writeBytes(data, sizeof(data));
+    }), "4401020304");
+    EXPECT_EQ(encoded([](CborWriter &w) { w.writeTag(1); w.writeUnsigned(1363896240); }), "c11a514b67b0");
+
+    EXPECT_EQ(encoded([](CborWriter &w) {
+        w.beginMap(2);
+        w.writeText("a");
+        w.writeUnsigned(1);
+        w.writeText("b");
+        w.beginArray(2);
+        w.writeUnsigned(2);
+        w.writeUnsigned(3);
+    }), "a26161016162820203");
+    EXPECT_EQ(encoded([](CborWriter &w) {
+        w.beginArray();
+        w.writeUnsigned(1);
+        w.beginArray(2);
+        w.writeUnsigned(2);
+        w.writeUnsigned(3);
+        w.beginArray();
+        w.writeUnsigned(4);
+        w.writeUnsigned(5);
+        w.end();
+        w.end();
+    }), "9f018202039f0405ffff");
+    EXPECT_EQ(encoded([](CborWriter &w) {
+        w.beginArray(25);
+        for(uint64_t i = 1; i <= 25; i++)
+        {
+            w.writeUnsigned(i);
+        }
+    }), "98190102030405060708090a0b0c0d0e0f101112131415161718181819");
+}
+
+TEST(CborTest, DecodesEveryKindOfItem) {
+    std::vector<uint8_t> data = bytes("1b000000e8d4a510003903e7f97bfffa47c35000fb3ff199999999999a"
+                                      "f4f5f6f7f0f820c11a514b67b04401020304646e616d65"
+                                      "a26161016162820203");
+    CborReader reader(data.data(), data.size());
+
+    uint64_t u;
+    int64_t s;
+    double d;
+    bool b;
+    ASSERT_TRUE(reader.readUnsigned(u));
+    EXPECT_EQ(u, 1000000000000ULL);
+    EXPECT_FALSE(reader.readUnsigned(u));       // Negative next, the position stays
+    ASSERT_TRUE(reader.readInt(s));
+    EXPECT_EQ(s, -1000);
+    ASSERT_TRUE(reader.readFloat(d));
+    EXPECT_EQ(d, 65504.0);
+    ASSERT_TRUE(reader.readFloat(d));
+    EXPECT_EQ(d, 100000.0);
+    ASSERT_TRUE(reader.readFloat(d));
+    EXPECT_EQ(d, 1.1);
+    ASSERT_TRUE(reader.readBool(b));
+    EXPECT_FALSE(b);
+    ASSERT_TRUE(reader.readBool(b));
+    EXPECT_TRUE(b);
+
+    CborItem item;
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_NULL);
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_UNDEFINED);
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_SIMPLE);
+    EXPECT_EQ(item.value, 16U);
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_SIMPLE);
+    EXPECT_EQ(item.value, 32U);
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_TAG);
+    EXPECT_EQ(item.value, 1U);
+    ASSERT_TRUE(reader.readInt(s));
+    EXPECT_EQ(s, 1363896240);
+
+    const uint8_t *blob;
+    size_t length;
+    ASSERT_TRUE(reader.readBytes(blob, length));
+    ASSERT_EQ(length, 4U);
+    EXPECT_EQ(blob[3], 4);
+    EXPECT_FALSE(reader.readKey("nam"));
+    EXPECT_TRUE(reader.readKey("name"));
+
+    size_t pairs;
+    ASSERT_TRUE(reader.enterMap(pairs));
+    EXPECT_EQ(pairs, 2U);
+    EXPECT_TRUE(reader.readKey("a"));
+    EXPECT_TRUE(reader.skip());
+    EXPECT_TRUE(reader.readKey("b"));
+    size_t count;
+    ASSERT_TRUE(reader.enterArray(count));
+    EXPECT_EQ(count, 2U);
+    EXPECT_TRUE(reader.skip());
+    EXPECT_TRUE(reader.skip());
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_FALSE(reader.next(item));
+    EXPECT_FALSE(reader.malformed());
+}
+
+TEST(CborTest, SkipsIndefiniteAndNestedItems) {
+    // [_ 1, [2, 3], [_ 4, 5]], (_ "strea", "ming"), {_ "a": 1, "b": [_ ]}, 24(h'00'), then a marker
+    std::vector<uint8_t> data = bytes("9f018202039f0405ffff7f657374726561646d696e67ff"
+                                      "bf61610161629fffffd818410017");
+    CborReader reader(data.data(), data.size());
+    EXPECT_TRUE(reader.skip());
+    EXPECT_EQ(reader.offset(), 10U);
+
+    CborItem item;
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CBOR_TEXT);
+    EXPECT_TRUE(item.indefinite);
+    std::string text;
+    while(reader.next(item) && item.type == CBOR_TEXT)
+    {
+        text.append(reinterpret_cast<const char *>(item.data), (size_t)item.value);
+    }
+    EXPECT_EQ(item.type, CBOR_BREAK);
+    EXPECT_EQ(text, "streaming");
+
+    EXPECT_TRUE(reader.skip());
+    EXPECT_TRUE(reader.skip());
+    uint64_t marker;
+    ASSERT_TRUE(reader.readUnsigned(marker));
+    EXPECT_EQ(marker, 23U);
+    EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(CborTest, RejectsMalformedInput) {
+    const char *cases[] = {
+        "19",           // Argument cut short
+        "64616263",     // String longer than the buffer
+        "1c",           // Reserved additional information
+        "1f",           // Indefinite integer
+        "f818",         // Simple value in the two-byte form
+        "8301",         // Array missing entries
+        "82ff",         // Break in a definite array
+        "9f01",         // Indefinite array never closed
+        "9affffffff",   // Count beyond the buffer
+        "818181818181818181818181818181818100",     // Deeper than CBOR_MAX_DEPTH
+    };
+    for(const char *hexText : cases)
+    {
+        std::vector<uint8_t> data = bytes(hexText);
+        CborReader reader(data.data(), data.size());
+        EXPECT_FALSE(reader.skip()) << hexText;
+        EXPECT_TRUE(reader.malformed()) << hexText;
+        EXPECT_EQ(reader.offset(), 0U) << hexText;
+    }
+
+    // A reader that has seen a malformed item stays stopped
+    std::vector<uint8_t> data = bytes("1c00");
+    CborReader reader(data.data(), data.size());
+    CborItem item;
+    EXPECT_FALSE(reader.next(item));
+    EXPECT_FALSE(reader.next(item));
+}
+
+TEST(CborTest, WriterFailsWholeItemsAndStaysFailed) {
+    uint8_t out[8];
+    memset(out, 0xAA, sizeof(out));
+    CborWriter writer(out, sizeof(out));
+    EXPECT_TRUE(writer.beginArray(2));
+    EXPECT_TRUE(writer.writeUnsigned(1000));
+    EXPECT_FALSE(writer.writeText("long"));     // 5 bytes into the 4 left
+    EXPECT_FALSE(writer.writeUnsigned(1));      // Would fit, but the record is already broken
+    EXPECT_FALSE(writer.ok());
+    EXPECT_EQ(writer.size(), 4U);
+    EXPECT_EQ(hex(out, sizeof(out)), "821903e8aaaaaaaa");
+
+    // Into a ring: items wrap around the end and a full ring takes no part of an item
+    uint8_t storage[16];
+    ByteRing ring;
+    ring.attach(storage, sizeof(storage));
+    uint8_t skipped[10];
+    ring.write(skipped, sizeof(skipped));
+    ring.read(skipped, sizeof(skipped));
+
+    CborWriter ringWriter(ring);
+    EXPECT_TRUE(ringWriter.beginMap(1));
+    EXPECT_TRUE(ringWriter.writeText("temp"));
+    EXPECT_TRUE(ringWriter.writeFloat(21.5f));
+    EXPECT_EQ(ringWriter.size(), 9U);
+    EXPECT_FALSE(ringWriter.writeText("no room for this"));
+    EXPECT_EQ(ring.used(), 9U);
+
+    uint8_t queued[16];
+    size_t n = ring.read(queued, sizeof(queued));
+    CborReader reader(queued, n);
+    size_t pairs;
+    double value;
+    ASSERT_TRUE(reader.enterMap(pairs));
+    EXPECT_TRUE(reader.readKey("temp"));
+    ASSERT_TRUE(reader.readFloat(value));
+    EXPECT_EQ(value, 21.5);
+}
+
+TEST(CborTest, FloatsRoundTripExactly) {
+    const double values[] = {
+        0.0, -0.0, 1.0, -2.5, 0.1, 1.0 / 3.0, 3.0e-5, 6.0e-8, 1.0e-40, 65504.0, 65505.0, 1.0e10,
+        (double)std::numeric_limits<float>::denorm_min(), std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::max(), INFINITY, -INFINITY,
+    };
+    for(double value : values)
+    {
+        uint8_t out[CBOR_MAX_HEAD];
+        CborWriter writer(out, sizeof(out));
+        ASSERT_TRUE(writer.writeDouble(value));
+        CborReader reader(out, writer.size());
+        double decoded;
+        ASSERT_TRUE(reader.readFloat(decoded));
+        EXPECT_EQ(memcmp(&decoded, &value, sizeof(value)), 0) << value;
+    }
+
+    uint8_t out[CBOR_MAX_HEAD];
+    CborWriter writer(out, sizeof(out));
+    ASSERT_TRUE(writer.writeFloat(NAN));
+    CborReader reader(out, writer.size());
+    double decoded;
+    ASSERT_TRUE(reader.readFloat(decoded));
+    EXPECT_TRUE(std::isnan(decoded));
+}
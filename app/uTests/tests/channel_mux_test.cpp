@@ -0,0 +1,319 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "channel_mux.h"
+#include "frame_codec.h"
+#include "uart_link_sim.h"
+
+namespace {
+
+enum : uint8_t
+{
+    CH_ALARM = 1,
+    CH_SHELL = 2,
+    CH_TELEMETRY = 3,
+    CH_FIRMWARE = 4
+};
+
+struct MuxEnd
+{
+    uint8_t buffers[8][512];
+    ChannelMux mux;
+
+    bool init(uint16_t rxSize = 512, uint16_t maxPayload = MUX_DEFAULT_PAYLOAD)
+    {
+        const MuxChannelConfig config[] = {
+            { CH_ALARM,     0, buffers[0], 512, buffers[1], rxSize },
+            { CH_SHELL,     1, buffers[2], 512, buffers[3], rxSize },
+            { CH_TELEMETRY, 2, buffers[4], 512, buffers[5], rxSize },
+            { CH_FIRMWARE,  3, buffers[6], 512, buffers[7], rxSize },
+        };
+        return mux.init(config, 4, maxPayload);
+    }
+};
+
+std::vector<uint8_t> decodeAll(const uint8_t *data, size_t length, FrameDecoder &decoder)
+{
+    std::vector<uint8_t> out;
+    for(size_t i = 0; i < length; i++)
+    {
+        if(decoder.push(data[i]) == FrameDecoder::FRAME)
+        {
+            out.assign(decoder.payload(), decoder.payload() + decoder.length());
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(FrameCodecTest, RoundTripWithZerosAndLongRuns) {
+    // Scattered zeros, and runs longer than one COBS block
+    std::vector<uint8_t> zeros(FRAME_MAX_PAYLOAD);
+    for(size_t i = 0; i < zeros.size(); i++)
+    {
+        zeros[i] = (i % 7 == 0) ? 0 : (uint8_t)i;
+    }
+    std::vector<uint8_t> run(FRAME_MAX_PAYLOAD, 0x5A);
+
+    for(const std::vector<uint8_t> &payload : {zeros, run})
+    {
+        for(size_t length : {(size_t)0, (size_t)1, (size_t)253, (size_t)254, (size_t)255, (size_t)FRAME_MAX_PAYLOAD})
+        {
+            uint8_t encoded[FRAME_ENCODED_SIZE(FRAME_MAX_PAYLOAD)];
+            size_t size = frameEncode(payload.data(), length, encoded, sizeof(encoded));
+            ASSERT_GT(size, 0U) << length;
+            EXPECT_EQ(0, std::count(encoded, encoded + size - 1, 0)) << length;
+            EXPECT_EQ(0, encoded[size - 1]);
+
+            FrameDecoder decoder;
+            std::vector<uint8_t> decoded = decodeAll(encoded, size, decoder);
+            ASSERT_EQ(length, decoded.size());
+            EXPECT_EQ(0, memcmp(payload.data(), decoded.data(), length));
+        }
+    }
+}
+
+TEST(FrameCodecTest, ResynchronizesAfterCorruption) {
+    const uint8_t first[] = {1, 2, 3, 0, 4};
+    const uint8_t second[] = {9, 8, 7};
+    uint8_t stream[64];
+    size_t a = frameEncode(first, sizeof(first), stream, sizeof(stream));
+    size_t b = frameEncode(second, sizeof(second), stream + a, sizeof(stream) - a);
+    stream[2] ^= 0x10;
+
+    FrameDecoder decoder;
+    std::vector<uint8_t> decoded = decodeAll(stream, a + b, decoder);
+    EXPECT_EQ(std::vector<uint8_t>(second, second + sizeof(second)), decoded);
+    EXPECT_EQ(1U, decoder.stats().frames);
+    EXPECT_EQ(1U, decoder.stats().crcErrors + decoder.stats().malformed);
+}
+
+TEST(ChannelMuxTest, ChannelsArriveIndependently) {
+    MuxEnd a, b;
+    ASSERT_TRUE(a.init());
+    ASSERT_TRUE(b.init());
+    UartLinkSim link(a.mux, b.mux, 115200);
+
+    const char *shell = "help\n";
+    const char *log = "boot ok";
+    EXPECT_EQ(strlen(shell), a.mux.write(CH_SHELL, (const uint8_t *)shell, strlen(shell)));
+    EXPECT_EQ(strlen(log), a.mux.write(CH_TELEMETRY, (const uint8_t *)log, strlen(log)));
+    link.run(20000);
+
+    char out[32] = {0};
+    ASSERT_EQ(strlen(shell), b.mux.read(CH_SHELL, (uint8_t *)out, sizeof(out)));
+    EXPECT_STREQ(shell, out);
+    memset(out, 0, sizeof(out));
+    ASSERT_EQ(strlen(log), b.mux.read(CH_TELEMETRY, (uint8_t *)out, sizeof(out)));
+    EXPECT_STREQ(log, out);
+    EXPECT_EQ(0U, b.mux.readable(CH_FIRMWARE));
+}
+
+TEST(ChannelMuxTest, PayloadsTravelInAnotherLinksFrames) {
+    // a sits behind a link that frames on its own, b reads the wire directly
+    MuxEnd a, b;
+    ASSERT_TRUE(a.init());
+    ASSERT_TRUE(b.init());
+
+    const char *alarm = "overtemp\n";
+    const char *shell = "get uart.period_ms\n";
+    EXPECT_EQ(strlen(alarm), a.mux.write(CH_ALARM, (const uint8_t *)alarm, strlen(alarm)));
+    EXPECT_EQ(strlen(shell), b.mux.write(CH_SHELL, (const uint8_t *)shell, strlen(shell)));
+
+    FrameDecoder decoder;
+    for(int round = 0; round < 4; round++)
+    {
+        uint8_t payload[MUX_PAYLOAD_SIZE(MUX_DEFAULT_PAYLOAD)];
+        size_t length;
+        while((length = a.mux.pollPayload(payload, sizeof(payload))) > 0)
+        {
+            uint8_t frame[MUX_FRAME_SIZE(MUX_DEFAULT_PAYLOAD)];
+            size_t size = frameEncode(payload, length, frame, sizeof(frame));
+            ASSERT_GT(size, 0U);
+            b.mux.receive(frame, size);
+        }
+
+        uint8_t frame[MUX_FRAME_SIZE(MUX_DEFAULT_PAYLOAD)];
+        size_t size;
+        while((size = b.mux.poll(frame, sizeof(frame))) > 0)
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                if(decoder.push(frame[i]) == FrameDecoder::FRAME)
+                {
+                    a.mux.receivePayload(decoder.payload(), decoder.length());
+                }
+            }
+        }
+    }
+
+    char out[32] = {0};
+    ASSERT_EQ(strlen(alarm), b.mux.read(CH_ALARM, (uint8_t *)out, sizeof(out)));
+    EXPECT_STREQ(alarm, out);
+    memset(out, 0, sizeof(out));
+    ASSERT_EQ(strlen(shell), a.mux.read(CH_SHELL, (uint8_t *)out, sizeof(out)));
+    EXPECT_STREQ(shell, out);
+}
+
+TEST(ChannelMuxTest, CreditsBoundReceiverBuffer) {
+    MuxEnd a, b;
+    ASSERT_TRUE(a.init(128));
+    ASSERT_TRUE(b.init(128));
+    UartLinkSim link(a.mux, b.mux, 1000000);
+
+    std::vector<uint8_t> image(4096);
+    for(size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = (uint8_t)(i * 13U);
+    }
+
+    // Slow consumer: reads 32 bytes every 5 ms
+    std::vector<uint8_t> received;
+    size_t offset = 0;
+    for(int ms = 0; ms < 1000 && received.size() < image.size(); ms++)
+    {
+        offset += a.mux.write(CH_FIRMWARE, image.data() + offset, image.size() - offset);
+        link.run(1000);
+        if(ms % 5 == 0)
+        {
+            uint8_t chunk[32];
+            size_t n = b.mux.read(CH_FIRMWARE, chunk, sizeof(chunk));
+            received.insert(received.end(), chunk, chunk + n);
+        }
+        EXPECT_LE(b.mux.readable(CH_FIRMWARE), 128U);
+    }
+
+    ASSERT_EQ(image, received);
+    EXPECT_EQ(0U, b.mux.stats(CH_FIRMWARE)->overruns);
+    EXPECT_GT(a.mux.stats(CH_FIRMWARE)->creditStalls, 0U);
+}
+
+TEST(ChannelMuxTest, RecoversFromPeerResetAndLineNoise) {
+    MuxEnd a, b;
+    ASSERT_TRUE(a.init());
+    ASSERT_TRUE(b.init());
+    UartLinkSim link(a.mux, b.mux, 115200);
+    link.run(5000);
+
+    // Peer reboots, then a byte of the next frame is hit by noise
+    ASSERT_TRUE(b.init());
+    link.run(5000);
+    link.corruptNext(0, 0x04);
+    const uint8_t lost[] = "lost";
+    const uint8_t kept[] = "kept";
+    a.mux.write(CH_SHELL, lost, 4);
+    link.run(5000);
+    a.mux.write(CH_SHELL, kept, 4);
+    link.run(5000);
+
+    uint8_t out[16] = {0};
+    ASSERT_EQ(4U, b.mux.read(CH_SHELL, out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(out, kept, 4));
+    EXPECT_EQ(1U, b.mux.linkStats().crcErrors + b.mux.linkStats().malformed);
+
+    // The dropped frame consumed credit on the sender side, a refresh restores it
+    a.mux.refreshCredits();
+    b.mux.refreshCredits();
+    link.run(5000);
+    std::vector<uint8_t> bulk(2048, 0xA5);
+    size_t sent = 0;
+    size_t got = 0;
+    for(int i = 0; i < 500 && got < bulk.size(); i++)
+    {
+        sent += a.mux.write(CH_SHELL, bulk.data() + sent, bulk.size() - sent);
+        link.run(1000);
+        uint8_t chunk[256];
+        got += b.mux.read(CH_SHELL, chunk, sizeof(chunk));
+    }
+    EXPECT_EQ(bulk.size(), got);
+}
+
+// Mixed load on a 115200 baud link: the firmware channel is kept saturated
+// while alarms, shell commands and telemetry are written periodically.
+// Latency runs from write() on one end to the last byte being readable on
+// the other.
+TEST(ChannelMuxTest, LatencyUnderMixedLoad) {
+    MuxEnd a, b;
+    ASSERT_TRUE(a.init());
+    ASSERT_TRUE(b.init());
+    UartLinkSim link(a.mux, b.mux, 115200);
+
+    struct Stream
+    {
+        uint8_t channel;
+        const char *name;
+        size_t messageSize;
+        uint64_t periodUs;
+        std::deque<uint64_t> sent;
+        size_t pendingBytes = 0;
+        std::vector<uint64_t> latencies;
+    };
+    Stream streams[] = {
+        { CH_ALARM,     "alarm",     8,  250000, {}, 0, {} },
+        { CH_SHELL,     "shell",     16, 50000,  {}, 0, {} },
+        { CH_TELEMETRY, "telemetry", 48, 100000, {}, 0, {} },
+    };
+
+    std::vector<uint8_t> filler(512, 0x3C);
+    uint64_t firmwareBytes = 0;
+    const uint64_t durationUs = 10000000;
+    for(uint64_t t = 0; t < durationUs; t += 100)
+    {
+        for(Stream &s : streams)
+        {
+            // Offset the periods so the streams do not always collide
+            if((t + s.channel * 7000U) % s.periodUs == 0)
+            {
+                std::vector<uint8_t> msg(s.messageSize, s.channel);
+                ASSERT_EQ(s.messageSize, a.mux.write(s.channel, msg.data(), msg.size()));
+                s.sent.push_back(link.nowUs());
+            }
+        }
+        a.mux.write(CH_FIRMWARE, filler.data(), filler.size());
+
+        link.run(100);
+
+        for(Stream &s : streams)
+        {
+            uint8_t chunk[128];
+            size_t n;
+            while((n = b.mux.read(s.channel, chunk, sizeof(chunk))) > 0)
+            {
+                s.pendingBytes += n;
+                while(s.pendingBytes >= s.messageSize && !s.sent.empty())
+                {
+                    s.latencies.push_back(link.nowUs() - s.sent.front());
+                    s.sent.pop_front();
+                    s.pendingBytes -= s.messageSize;
+                }
+            }
+        }
+        uint8_t chunk[512];
+        firmwareBytes += b.mux.read(CH_FIRMWARE, chunk, sizeof(chunk));
+    }
+
+    const double frameUs = 10.0 * 1e6 / 115200.0 * MUX_FRAME_SIZE(MUX_DEFAULT_PAYLOAD);
+    printf("\n  Mux latency at 115200 baud, max frame %.1f ms:\n", frameUs / 1000.0);
+    for(Stream &s : streams)
+    {
+        ASSERT_FALSE(s.latencies.empty());
+        std::sort(s.latencies.begin(), s.latencies.end());
+        uint64_t p50 = s.latencies[s.latencies.size() / 2];
+        uint64_t max = s.latencies.back();
+        printf("    %-10s n=%-4zu p50=%6.2f ms  max=%6.2f ms\n", s.name, s.latencies.size(),
+               p50 / 1000.0, max / 1000.0);
+    }
+    double firmwareKBps = firmwareBytes / 1024.0 / (durationUs / 1e6);
+    printf("    firmware   %.2f KB/s of %.2f KB/s raw\n\n", firmwareKBps, 11520.0 / 1024.0);
+
+    // Priority channels wait for at most one bulk frame plus their own
+    EXPECT_LT(streams[0].latencies.back(), (uint64_t)(3 * frameUs));
+    EXPECT_LT(streams[1].latencies.back(), (uint64_t)(4 * frameUs));
+    EXPECT_GT(firmwareKBps, 0.7 * 11520.0 / 1024.0);
+}
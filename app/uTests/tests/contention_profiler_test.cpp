@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "contention_profiler.h"
+
+namespace {
+
+int lockA;
+int lockB;
+int queue;
+int taskHigh;
+int taskLow;
+
+} // namespace
+
+TEST(ContentionProfilerTest, UnregisteredObjectsAreIgnored) {
+    ContentionProfiler profiler;
+    profiler.blocked(&lockA, &taskHigh, false, 0);
+    profiler.completed(&lockA, &taskHigh, false, 0, 100);
+    EXPECT_EQ(profiler.count(), 0U);
+    EXPECT_EQ(profiler.find(&lockA), nullptr);
+
+    uint8_t others[CONTENTION_PROFILER_MAX_OBJECTS];
+    EXPECT_TRUE(profiler.add(&lockA, "x", CONTENTION_QUEUE, 4));
+    for(uint32_t i = 1; i < CONTENTION_PROFILER_MAX_OBJECTS; i++)
+    {
+        EXPECT_TRUE(profiler.add(&others[i], "x", CONTENTION_QUEUE, 4));
+    }
+    EXPECT_FALSE(profiler.add(&lockB, "full", CONTENTION_MUTEX, 1));
+    EXPECT_TRUE(profiler.add(&lockA, "renamed", CONTENTION_QUEUE, 4));
+    EXPECT_STREQ(profiler.find(&lockA)->name, "renamed");
+
+    profiler.remove(&lockA);
+    EXPECT_EQ(profiler.count(), CONTENTION_PROFILER_MAX_OBJECTS - 1U);
+    EXPECT_TRUE(profiler.add(&lockB, "fits", CONTENTION_MUTEX, 1));
+}
+
+TEST(ContentionProfilerTest, MutexWaitAndHold) {
+    ContentionProfiler profiler;
+    ASSERT_TRUE(profiler.add(&lockA, "bus", CONTENTION_MUTEX, 1));
+
+    // Low takes the lock, high blocks on it until low gives it back
+    profiler.completed(&lockA, &taskLow, false, 0, 1000);
+    profiler.blocked(&lockA, &taskHigh, false, 1200);
+    profiler.blocked(&lockA, &taskHigh, false, 1500);      // Woken early and back to sleep
+    profiler.completed(&lockA, &taskLow, true, 1, 1800);
+    profiler.completed(&lockA, &taskHigh, false, 0, 1850);
+
+    const ContentionFigures *figures = profiler.find(&lockA);
+    ASSERT_NE(figures, nullptr);
+    EXPECT_EQ(figures->operations, 3U);
+    EXPECT_EQ(figures->contentions, 1U);
+    EXPECT_EQ(figures->waitCycles, 650U);
+    EXPECT_EQ(figures->maxWaitCycles, 650U);
+    EXPECT_EQ(figures->worstWaiter, &taskHigh);
+    EXPECT_EQ(figures->worstOwner, &taskLow);
+    EXPECT_EQ(figures->holds, 1U);
+    EXPECT_EQ(figures->maxHoldCycles, 800U);
+    EXPECT_EQ(figures->owner, &taskHigh);
+
+    profiler.completed(&lockA, &taskHigh, true, 1, 1900);
+    EXPECT_EQ(figures->holds, 2U);
+    EXPECT_EQ(figures->holdCycles, 850U);
+    EXPECT_EQ(figures->owner, nullptr);
+}
+
+TEST(ContentionProfilerTest, QueueHighWaterAndTimeouts) {
+    ContentionProfiler profiler;
+    ASSERT_TRUE(profiler.add(&queue, "events", CONTENTION_QUEUE, 4));
+
+    // Sends from an interrupt carry no task
+    profiler.completed(&queue, nullptr, true, 1, 10);
+    profiler.completed(&queue, &taskLow, true, 2, 20);
+    profiler.completed(&queue, &taskLow, true, 3, 30);
+    profiler.completed(&queue, &taskHigh, false, 2, 40);
+
+    // A full queue makes the sender wait until it gives up; a failed poll is not a timeout
+    profiler.blocked(&queue, &taskLow, true, 0xFFFFFF00U);
+    profiler.failed(&queue, &taskLow, true, 0x00000100U);
+    profiler.failed(&queue, &taskHigh, false, 0x00000200U);
+
+    const ContentionFigures *figures = profiler.find(&queue);
+    ASSERT_NE(figures, nullptr);
+    EXPECT_EQ(figures->highWater, 3U);
+    EXPECT_EQ(figures->operations, 4U);
+    EXPECT_EQ(figures->contentions, 1U);
+    EXPECT_EQ(figures->timeouts, 1U);
+    EXPECT_EQ(figures->waitCycles, 0x200U);
+    EXPECT_EQ(figures->holds, 0U);
+
+    // A receive by the same task does not end a send wait
+    profiler.blocked(&queue, &taskLow, true, 1000);
+    profiler.completed(&queue, &taskLow, false, 0, 1100);
+    profiler.completed(&queue, &taskLow, true, 1, 1300);
+    EXPECT_EQ(figures->maxWaitCycles, 0x200U);
+    EXPECT_EQ(figures->waitCycles, 0x200U + 300U);
+}
+
+TEST(ContentionProfilerTest, RankPutsTheWorstFirst) {
+    ContentionProfiler profiler;
+    ASSERT_TRUE(profiler.add(&lockA, "a", CONTENTION_MUTEX, 1));
+    ASSERT_TRUE(profiler.add(&lockB, "b", CONTENTION_RECURSIVE_MUTEX, 1));
+    ASSERT_TRUE(profiler.add(&queue, "q", CONTENTION_QUEUE, 8));
+
+    profiler.blocked(&lockB, &taskHigh, false, 0);
+    profiler.completed(&lockB, &taskHigh, false, 0, 500);
+    profiler.blocked(&queue, &taskLow, false, 0);
+    profiler.completed(&queue, &taskLow, false, 0, 100);
+    profiler.blocked(&queue, &taskLow, false, 200);
+    profiler.completed(&queue, &taskLow, false, 0, 300);
+
+    const ContentionFigures *ranked[3] = {};
+    ASSERT_EQ(profiler.rank(ranked, 3), 3U);
+    EXPECT_EQ(ranked[0]->object, &lockB);
+    EXPECT_EQ(ranked[1]->object, &queue);
+    EXPECT_EQ(ranked[2]->object, &lockA);
+
+    ASSERT_EQ(profiler.rank(ranked, 1), 1U);
+    EXPECT_EQ(ranked[0]->object, &lockB);
+
+    // Reset keeps the holder so the next give still counts as a hold
+    profiler.reset();
+    EXPECT_EQ(profiler.find(&lockB)->waitCycles, 0U);
+    EXPECT_EQ(profiler.find(&lockB)->owner, &taskHigh);
+    profiler.completed(&lockB, &taskHigh, true, 1, 900);
+    EXPECT_EQ(profiler.find(&lockB)->holds, 1U);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "deadline_heap.h"
+
+TEST(DeadlineHeapTest, PopsInDeadlineOrder) {
+    DeadlineHeap<8> heap;
+    heap.schedule(3, 300);
+    heap.schedule(1, 100);
+    heap.schedule(5, 500);
+    heap.schedule(2, 200);
+    EXPECT_EQ(heap.size(), 4U);
+    EXPECT_FALSE(heap.schedule(8, 1));
+
+    uint32_t last = 0;
+    while(!heap.empty())
+    {
+        auto entry = heap.pop();
+        EXPECT_EQ(entry.deadline, entry.id * 100U);
+        EXPECT_GT(entry.deadline, last);
+        last = entry.deadline;
+    }
+    EXPECT_FALSE(heap.contains(3));
+}
+
+TEST(DeadlineHeapTest, OrdersAcrossTheClockWrap) {
+    DeadlineHeap<4> heap;
+    heap.schedule(0, 0x00000010U);          // After the wrap
+    heap.schedule(1, 0xFFFFFFF0U);          // Before it
+    heap.schedule(2, 0xC0000000U);          // Far before, still within 2^31 of the others
+    heap.schedule(3, 0xFFFFFFFFU);
+
+    EXPECT_EQ(heap.pop().id, 2U);
+    EXPECT_EQ(heap.pop().id, 1U);
+    EXPECT_EQ(heap.pop().id, 3U);
+    EXPECT_EQ(heap.pop().id, 0U);
+
+    EXPECT_TRUE(deadlineReached(0xFFFFFFF0U, 0x00000005U));
+    EXPECT_FALSE(deadlineReached(0x00000005U, 0xFFFFFFF0U));
+    EXPECT_TRUE(deadlineReached(7, 7));
+}
+
+TEST(DeadlineHeapTest, RescheduleAndRemove) {
+    DeadlineHeap<8> heap;
+    for(uint8_t id = 0; id < 8; id++)
+    {
+        heap.schedule(id, 1000U + id * 10U);
+    }
+
+    heap.schedule(7, 5);                    // Earlier than everything
+    EXPECT_EQ(heap.top().id, 7U);
+    heap.schedule(7, 5000);                 // Later than everything
+    EXPECT_EQ(heap.top().id, 0U);
+    EXPECT_EQ(heap.size(), 8U);
+
+    EXPECT_TRUE(heap.remove(0));
+    EXPECT_FALSE(heap.remove(0));
+    EXPECT_TRUE(heap.remove(4));
+    std::vector<uint8_t> order;
+    while(!heap.empty())
+    {
+        order.push_back(heap.pop().id);
+    }
+    EXPECT_EQ(order, (std::vector<uint8_t>{ 1, 2, 3, 5, 6, 7 }));
+}
+
+TEST(DeadlineHeapTest, MatchesASortedReference) {
+    constexpr size_t N = 32;
+    DeadlineHeap<N> heap;
+    std::vector<int64_t> reference(N, -1);  // Deadline per id, -1 when idle
+    std::mt19937 rng(7);
+    uint32_t now = 0xFFFF0000U;             // Runs across the wrap
+
+    for(int step = 0; step < 20000; step++)
+    {
+        uint8_t id = (uint8_t)(rng() % N);
+        switch(rng() % 3)
+        {
+            case 0:
+            case 1:
+            {
+                uint32_t deadline = now + rng() % 100000U;
+                heap.schedule(id, deadline);
+                reference[id] = deadline;
+                break;
+            }
+            default:
+                EXPECT_EQ(heap.remove(id), reference[id] >= 0);
+                reference[id] = -1;
+                break;
+        }
+
+        // The top is the reference entry closest ahead of now
+        size_t live = 0;
+        uint32_t best = 0;
+        bool found = false;
+        for(size_t i = 0; i < N; i++)
+        {
+            if(reference[i] < 0)
+            {
+                continue;
+            }
+            live++;
+            uint32_t ahead = (uint32_t)reference[i] - now;
+            if(!found || ahead < best)
+            {
+                best = ahead;
+                found = true;
+            }
+        }
+        ASSERT_EQ(heap.size(), live);
+        if(found)
+        {
+            ASSERT_EQ(heap.top().deadline - now, best);
+        }
+
+        // Time moves and due entries are taken off, as the timer interrupt does
+        now += rng() % 200U;
+        while(!heap.empty() && deadlineReached(heap.top().deadline, now))
+        {
+            reference[heap.pop().id] = -1;
+        }
+    }
+}
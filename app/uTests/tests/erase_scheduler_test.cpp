@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "erase_scheduler.h"
+
+TEST(EraseSchedulerTest, InitRejectsBadSizes) {
+    EraseScheduler scheduler;
+    EXPECT_FALSE(scheduler.init(0, 2));
+    EXPECT_FALSE(scheduler.init(ERASE_SCHEDULER_MAX_PAGES + 1U, 2));
+    EXPECT_TRUE(scheduler.init(ERASE_SCHEDULER_MAX_PAGES, 2));
+    EXPECT_EQ(scheduler.state(0), ERASE_PAGE_UNKNOWN);
+    EXPECT_EQ(scheduler.queued(), 0U);
+}
+
+TEST(EraseSchedulerTest, WritesQueueTheLookahead) {
+    EraseScheduler scheduler;
+    ASSERT_TRUE(scheduler.init(8, 2));
+    for(uint32_t page = 0; page < 8; page++)
+    {
+        scheduler.checked(page, page != 3);
+    }
+    EXPECT_EQ(scheduler.erased(), 7U);
+
+    // Page 1 is erased, page 2 is not and joins the queue
+    scheduler.written(0);
+    EXPECT_EQ(scheduler.state(0), ERASE_PAGE_WRITTEN);
+    EXPECT_EQ(scheduler.state(1), ERASE_PAGE_ERASED);
+    EXPECT_EQ(scheduler.queued(), 0U);
+
+    scheduler.written(1);
+    scheduler.written(2);
+    EXPECT_EQ(scheduler.state(3), ERASE_PAGE_QUEUED);
+    EXPECT_EQ(scheduler.state(4), ERASE_PAGE_ERASED);
+    EXPECT_EQ(scheduler.queued(), 1U);
+
+    uint32_t page = 0;
+    ASSERT_TRUE(scheduler.next(page));
+    EXPECT_EQ(page, 3U);
+    scheduler.started(page);
+    EXPECT_EQ(scheduler.queued(), 0U);
+    EXPECT_FALSE(scheduler.next(page));
+    EXPECT_FALSE(scheduler.request(3));
+
+    // Written pages are not blank-checked away while their erase runs
+    scheduler.checked(3, false);
+    EXPECT_EQ(scheduler.state(3), ERASE_PAGE_ERASING);
+    scheduler.finished(3, true);
+    EXPECT_EQ(scheduler.state(3), ERASE_PAGE_ERASED);
+}
+
+TEST(EraseSchedulerTest, PageTheWriterReachesFirstGoesFirst) {
+    EraseScheduler scheduler;
+    ASSERT_TRUE(scheduler.init(8, 3));
+
+    // The writer wraps: pages 6, 7, 0 follow page 5
+    scheduler.request(2);
+    scheduler.written(5);
+    EXPECT_EQ(scheduler.queued(), 4U);
+
+    uint32_t order[4];
+    for(uint32_t &page : order)
+    {
+        ASSERT_TRUE(scheduler.next(page));
+        scheduler.started(page);
+        scheduler.finished(page, true);
+    }
+    EXPECT_EQ(order[0], 6U);
+    EXPECT_EQ(order[1], 7U);
+    EXPECT_EQ(order[2], 0U);
+    EXPECT_EQ(order[3], 2U);
+    EXPECT_EQ(scheduler.erased(), 4U);
+}
+
+TEST(EraseSchedulerTest, SkippedRangeWaits) {
+    // Pages 4-7 share the code bank
+    EraseScheduler scheduler;
+    ASSERT_TRUE(scheduler.init(8, 0));
+    scheduler.request(5);
+    scheduler.request(1);
+
+    uint32_t page = 0;
+    ASSERT_TRUE(scheduler.next(page, 4, 4));
+    EXPECT_EQ(page, 1U);
+    scheduler.started(page);
+    scheduler.finished(page, false);
+    EXPECT_EQ(scheduler.state(1), ERASE_PAGE_UNKNOWN);
+
+    EXPECT_FALSE(scheduler.next(page, 4, 4));
+    ASSERT_TRUE(scheduler.next(page));
+    EXPECT_EQ(page, 5U);
+}
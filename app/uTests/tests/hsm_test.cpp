@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "hsm.h"
+#include "hsm_bus_machine.h"
+
+namespace {
+
+// ===============================
+// Semantics
+// ===============================
+
+struct NestedMachine;
+
+struct Recorder
+{
+    std::string log;
+    bool allowGuarded = false;
+    bool nestedResult = true;
+    Hsm<NestedMachine> *self = nullptr;
+};
+
+struct NestedMachine
+{
+    using Context = Recorder;
+    using Payload = int;
+
+    enum State : uint8_t { TOP, A, A1, A2, B, C };
+    enum Event : uint8_t { GO_A2, GO_B, SELF_A, INTERNAL, GUARDED, TO_C, UNHANDLED, NESTED, EVENT_COUNT };
+    static constexpr uint8_t INITIAL = TOP;
+
+    static void enterTop(Recorder &r) { r.log += "+TOP "; }
+    static void exitTop(Recorder &r) { r.log += "-TOP "; }
+    static void enterA(Recorder &r) { r.log += "+A "; }
+    static void exitA(Recorder &r) { r.log += "-A "; }
+    static void enterA1(Recorder &r) { r.log += "+A1 "; }
+    static void exitA1(Recorder &r) { r.log += "-A1 "; }
+    static void enterA2(Recorder &r) { r.log += "+A2 "; }
+    static void exitA2(Recorder &r) { r.log += "-A2 "; }
+    static void enterB(Recorder &r) { r.log += "+B "; }
+    static void enterC(Recorder &r) { r.log += "+C "; }
+
+    static void act(Recorder &r, const int &value) { r.log += "act" + std::to_string(value) + " "; }
+    static bool allowed(Recorder &r, const int &) { return r.allowGuarded; }
+    static void dispatchNested(Recorder &r, const int &) { r.nestedResult = r.self->dispatch(GO_B, 0); }
+
+    static constexpr HsmState<Recorder> states[] = {
+        { TOP, HSM_NONE, A,        enterTop, exitTop },
+        { A,   TOP,      A1,       enterA,   exitA },
+        { A1,  A,        HSM_NONE, enterA1,  exitA1 },
+        { A2,  A,        HSM_NONE, enterA2,  exitA2 },
+        { B,   TOP,      HSM_NONE, enterB,   nullptr },
+        { C,   HSM_NONE, HSM_NONE, enterC,   nullptr },
+    };
+
+    static constexpr HsmTransition<Recorder, int> transitions[] = {
+        { A1,  GO_A2,    A2,       nullptr, act },
+        { A,   GO_B,     B,        nullptr, act },
+        { A,   SELF_A,   A,        nullptr, act },
+        { TOP, INTERNAL, HSM_NONE, nullptr, act },
+        { A1,  GUARDED,  B,        allowed, act },
+        { A,   GUARDED,  A2,       nullptr, act },
+        { TOP, TO_C,     C,        nullptr, act },
+        { TOP, NESTED,   HSM_NONE, nullptr, dispatchNested },
+    };
+};
+
+struct TraceEntry
+{
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;
+};
+
+void recordTrace(void *ctx, uint8_t from, uint8_t to, uint8_t event)
+{
+    static_cast<std::vector<TraceEntry> *>(ctx)->push_back({from, to, event});
+}
+
+} // namespace
+
+TEST(HsmTest, StartEntersDefaultSubstatesTopDown) {
+    Recorder recorder;
+    std::vector<TraceEntry> trace;
+    Hsm<NestedMachine> hsm;
+    hsm.setTrace(recordTrace, &trace);
+    hsm.start(recorder);
+
+    EXPECT_EQ("+TOP +A +A1 ", recorder.log);
+    EXPECT_EQ(NestedMachine::A1, hsm.state());
+    EXPECT_TRUE(hsm.isIn(NestedMachine::A));
+    EXPECT_TRUE(hsm.isIn(NestedMachine::TOP));
+    EXPECT_FALSE(hsm.isIn(NestedMachine::B));
+    ASSERT_EQ(1U, trace.size());
+    EXPECT_EQ(HSM_NONE, trace[0].from);
+    EXPECT_EQ(NestedMachine::A1, trace[0].to);
+}
+
+TEST(HsmTest, ExitsActionEntriesInOrder) {
+    Recorder recorder;
+    Hsm<NestedMachine> hsm;
+    hsm.start(recorder);
+
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::GO_A2, 1));
+    EXPECT_EQ("-A1 act1 +A2 ", recorder.log);
+
+    // Handled by the parent of the current state
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::GO_B, 2));
+    EXPECT_EQ("-A2 -A act2 +B ", recorder.log);
+    EXPECT_EQ(NestedMachine::B, hsm.state());
+
+    // Leaving the outermost state
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::TO_C, 3));
+    EXPECT_EQ("-TOP act3 +C ", recorder.log);
+    EXPECT_FALSE(hsm.dispatch(NestedMachine::GO_B, 4));
+}
+
+TEST(HsmTest, SelfInternalAndGuardedTransitions) {
+    Recorder recorder;
+    std::vector<TraceEntry> trace;
+    Hsm<NestedMachine> hsm;
+    hsm.start(recorder);
+    hsm.setTrace(recordTrace, &trace);
+
+    // Self transition on a composite state leaves and re-enters it
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::SELF_A, 1));
+    EXPECT_EQ("-A1 -A act1 +A +A1 ", recorder.log);
+
+    // Internal transition runs the action only
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::INTERNAL, 2));
+    EXPECT_EQ("act2 ", recorder.log);
+    EXPECT_EQ(trace.back().from, trace.back().to);
+
+    // A failing guard passes the event on to the parent
+    recorder.log.clear();
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::GUARDED, 3));
+    EXPECT_EQ(NestedMachine::A2, hsm.state());
+
+    EXPECT_FALSE(hsm.dispatch(NestedMachine::UNHANDLED, 0));
+    EXPECT_FALSE(hsm.dispatch(NestedMachine::EVENT_COUNT, 0));
+    EXPECT_EQ(3U, trace.size());
+    EXPECT_EQ(NestedMachine::GUARDED, trace.back().event);
+}
+
+TEST(HsmTest, RefusesDispatchFromInsideAnAction) {
+    Recorder recorder;
+    Hsm<NestedMachine> hsm;
+    recorder.self = &hsm;
+    hsm.start(recorder);
+
+    EXPECT_TRUE(hsm.dispatch(NestedMachine::NESTED, 0));
+    EXPECT_FALSE(recorder.nestedResult);
+    EXPECT_EQ(NestedMachine::A1, hsm.state());
+}
+
+TEST(HsmTest, BusProtocolMatchesHandWrittenSwitch) {
+    const std::vector<uint8_t> events = busEvents(2000);
+
+    Bus bus;
+    Hsm<BusMachine> hsm;
+    hsm.start(bus);
+    SwitchBus reference;
+
+    for(size_t i = 0; i < events.size(); i++)
+    {
+        bus.now = (uint32_t)i;
+        reference.bus.now = (uint32_t)i;
+        ASSERT_EQ(reference.dispatch(events[i], (uint32_t)i), hsm.dispatch(events[i], (uint32_t)i));
+        ASSERT_EQ(reference.state, hsm.state());
+    }
+    EXPECT_EQ(reference.bus.sent, bus.sent);
+    EXPECT_EQ(reference.bus.faults, bus.faults);
+    EXPECT_GT(bus.faults, 0U);
+}
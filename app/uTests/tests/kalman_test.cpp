@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "kalman.h"
+#include "matrix.h"
+
+namespace {
+
+template<typename T, size_t R, size_t C>
+Matrix<T, R, C> randomMatrix(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix<T, R, C> m;
+    for(size_t r = 0; r < R; r++)
+    {
+        for(size_t c = 0; c < C; c++)
+        {
+            m(r, c) = (T)dist(rng);
+        }
+    }
+    return m;
+}
+
+template<typename A, typename B>
+double largestDifference(const A &a, const B &b)
+{
+    double worst = 0.0;
+    for(size_t r = 0; r < A::ROWS; r++)
+    {
+        for(size_t c = 0; c < A::COLS; c++)
+        {
+            worst = std::max(worst, std::fabs((double)a(r, c) - (double)b(r, c)));
+        }
+    }
+    return worst;
+}
+
+template<typename T, size_t R, size_t K, size_t C>
+Matrix<T, R, C> naiveProduct(const Matrix<T, R, K> &a, const Matrix<T, K, C> &b)
+{
+    Matrix<T, R, C> result;
+    for(size_t r = 0; r < R; r++)
+    {
+        for(size_t c = 0; c < C; c++)
+        {
+            for(size_t k = 0; k < K; k++)
+            {
+                result(r, c) += a(r, k) * b(k, c);
+            }
+        }
+    }
+    return result;
+}
+
+// A A' + I, comfortably positive definite
+template<typename T, size_t N>
+SymMatrix<T, N> randomSpd(std::mt19937 &rng)
+{
+    Matrix<T, N, N> a = randomMatrix<T, N, N>(rng);
+    return SymMatrix<T, N>(a * a.transpose() + Matrix<T, N, N>::identity());
+}
+
+// Constant velocity in 2-D, state x y vx vy, position measured
+constexpr double DT = 0.1;
+
+Matrix<double, 4, 4> constantVelocity()
+{
+    return Matrix<double, 4, 4>{1, 0, DT, 0,
+                                0, 1, 0, DT,
+                                0, 0, 1, 0,
+                                0, 0, 0, 1};
+}
+
+Matrix<double, 2, 4> positionOnly()
+{
+    return Matrix<double, 2, 4>{1, 0, 0, 0,
+                                0, 1, 0, 0};
+}
+
+} // namespace
+
+TEST(KalmanTest, ExpressionsMatchPlainLoops) {
+    std::mt19937 rng(1);
+    Matrix<double, 4, 3> a = randomMatrix<double, 4, 3>(rng);
+    Matrix<double, 3, 5> b = randomMatrix<double, 3, 5>(rng);
+    Matrix<double, 4, 5> c = randomMatrix<double, 4, 5>(rng);
+
+    Matrix<double, 4, 5> expected = naiveProduct(a, b);
+    Matrix<double, 4, 5> sum = a * b + 2.0 * c - c;
+    for(size_t r = 0; r < 4; r++)
+    {
+        for(size_t col = 0; col < 5; col++)
+        {
+            expected(r, col) += c(r, col);
+        }
+    }
+    EXPECT_LT(largestDifference(sum, expected), 1e-12);
+
+    // Nested products and transposes
+    Matrix<double, 5, 4> t = transpose(a * b);
+    EXPECT_LT(largestDifference(t, naiveProduct(a, b).transpose()), 1e-12);
+    Matrix<double, 3, 3> gram = a.transpose() * a;
+    EXPECT_DOUBLE_EQ(gram(0, 1), gram(1, 0));
+
+    // The destination read by the product on the right goes through a temporary
+    Matrix<double, 3, 3> f = randomMatrix<double, 3, 3>(rng);
+    Matrix<double, 3, 3> p = randomMatrix<double, 3, 3>(rng);
+    Matrix<double, 3, 3> fp = naiveProduct(f, p);
+    p = f * p;
+    EXPECT_LT(largestDifference(p, fp), 1e-12);
+    Matrix<double, 3, 3> square = p;
+    square = square.transpose();
+    EXPECT_DOUBLE_EQ(square(0, 2), p(2, 0));
+    square += square * f;
+    EXPECT_LT(largestDifference(square, Matrix<double, 3, 3>(p.transpose()) + naiveProduct(Matrix<double, 3, 3>(p.transpose()), f)), 1e-12);
+
+    Vector<float, 3> v = {1.0f, 2.0f, 3.0f};
+    EXPECT_FLOAT_EQ(dot(v, v), 14.0f);
+    EXPECT_FLOAT_EQ((v.transpose() * v)(0, 0), 14.0f);
+    EXPECT_FLOAT_EQ((-v)(2, 0), -3.0f);
+}
+
+TEST(KalmanTest, SymmetricStorageAndCholesky) {
+    std::mt19937 rng(2);
+    SymMatrix<double, 6> s = randomSpd<double, 6>(rng);
+    static_assert(sizeof(s) == 21 * sizeof(double), "upper triangle only");
+    EXPECT_EQ(&s(1, 4), &s(4, 1));
+
+    // A S A' against the full products
+    Matrix<double, 3, 6> a = randomMatrix<double, 3, 6>(rng);
+    Matrix<double, 6, 6> full = s;
+    SymMatrix<double, 3> q = quadraticForm(a, s);
+    EXPECT_LT(largestDifference(q, naiveProduct(naiveProduct(a, full), Matrix<double, 6, 3>(a.transpose()))), 1e-12);
+
+    Matrix<double, 6, 6> l;
+    ASSERT_TRUE(cholesky(s, l));
+    EXPECT_EQ(l(0, 5), 0.0);
+    EXPECT_LT(largestDifference(naiveProduct(l, Matrix<double, 6, 6>(l.transpose())), full), 1e-12);
+
+    Matrix<double, 6, 2> b = randomMatrix<double, 6, 2>(rng);
+    Matrix<double, 6, 2> x = b;
+    choleskySolve(l, x);
+    EXPECT_LT(largestDifference(naiveProduct(full, x), b), 1e-12);
+
+    SymMatrix<double, 2> indefinite;
+    indefinite(0, 0) = 1.0;
+    indefinite(0, 1) = 2.0;
+    indefinite(1, 1) = 1.0;
+    Matrix<double, 2, 2> unused;
+    EXPECT_FALSE(cholesky(indefinite, unused));
+}
+
+TEST(KalmanTest, EkfTracksAndScalarUpdatesMatchTheVectorOne) {
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 0.5);
+    Matrix<double, 4, 4> f = constantVelocity();
+    Matrix<double, 2, 4> h = positionOnly();
+    SymMatrix<double, 4> q = SymMatrix<double, 4>::diagonal(1e-4);
+    SymMatrix<double, 2> r = SymMatrix<double, 2>::diagonal(0.25);
+
+    ExtendedKalmanFilter<double, 4> vector;
+    ExtendedKalmanFilter<double, 4> scalar;
+    vector.reset(Vector<double, 4>{}, SymMatrix<double, 4>::diagonal(100.0));
+    scalar.reset(Vector<double, 4>{}, SymMatrix<double, 4>::diagonal(100.0));
+
+    Vector<double, 4> truth = {3.0, -2.0, 1.5, 0.5};
+    for(int step = 0; step < 300; step++)
+    {
+        truth = f * truth;
+        Vector<double, 2> z = {truth[0] + noise(rng), truth[1] + noise(rng)};
+
+        vector.predict(Vector<double, 4>(f * vector.state()), f, q);
+        ASSERT_TRUE(vector.update(Vector<double, 2>(z - h * vector.state()), h, r));
+
+        scalar.predict(Vector<double, 4>(f * scalar.state()), f, q);
+        for(size_t i = 0; i < 2; i++)
+        {
+            Matrix<double, 1, 4> row;
+            row(0, i) = 1.0;
+            ASSERT_TRUE(scalar.updateScalar(z[i] - scalar.state()[i], row, r(i, i)));
+        }
+    }
+
+    EXPECT_NEAR(vector.state()[2], 1.5, 0.1);
+    EXPECT_NEAR(vector.state()[3], 0.5, 0.1);
+    EXPECT_LT(largestDifference(vector.state(), scalar.state()), 1e-9);
+    EXPECT_LT(largestDifference(vector.covariance(), scalar.covariance()), 1e-12);
+
+    // A measurement that cannot be factored leaves the filter as it was
+    Vector<double, 4> before = vector.state();
+    EXPECT_FALSE(vector.update(Vector<double, 2>{1.0, 1.0}, h, SymMatrix<double, 2>::diagonal(-1e6)));
+    EXPECT_EQ(largestDifference(before, vector.state()), 0.0);
+}
+
+TEST(KalmanTest, UkfEqualsEkfOnALinearModel) {
+    Matrix<double, 4, 4> f = constantVelocity();
+    Matrix<double, 2, 4> h = positionOnly();
+    SymMatrix<double, 4> q = SymMatrix<double, 4>::diagonal(1e-3);
+    SymMatrix<double, 2> r = SymMatrix<double, 2>::diagonal(0.1);
+
+    ExtendedKalmanFilter<double, 4> ekf;
+    UnscentedKalmanFilter<double, 4> ukf(0.5, 2.0, 0.0);
+    ekf.reset(Vector<double, 4>{1.0, 2.0, 0.0, 0.0}, SymMatrix<double, 4>::diagonal(4.0));
+    ukf.reset(Vector<double, 4>{1.0, 2.0, 0.0, 0.0}, SymMatrix<double, 4>::diagonal(4.0));
+
+    for(int step = 0; step < 50; step++)
+    {
+        Vector<double, 2> z = {std::sin(0.1 * step), 0.05 * step};
+        ekf.predict(Vector<double, 4>(f * ekf.state()), f, q);
+        ASSERT_TRUE(ukf.predict([&](const Vector<double, 4> &s) { return Vector<double, 4>(f * s); }, q));
+        ASSERT_TRUE(ekf.update(Vector<double, 2>(z - h * ekf.state()), h, r));
+        ASSERT_TRUE(ukf.update([&](const Vector<double, 4> &s) { return Vector<double, 2>(h * s); }, z, r));
+    }
+    EXPECT_LT(largestDifference(ekf.state(), ukf.state()), 1e-9);
+    EXPECT_LT(largestDifference(ekf.covariance(), ukf.covariance()), 1e-9);
+}
+
+TEST(KalmanTest, UkfLocatesATargetFromRangeAndBearing) {
+    // A stationary target seen from an observer circling it: range and bearing are non-linear in the state
+    std::mt19937 rng(4);
+    std::normal_distribution<double> rangeNoise(0.0, 0.05);
+    std::normal_distribution<double> bearingNoise(0.0, 0.01);
+    const double targetX = 4.0;
+    const double targetY = -3.0;
+
+    UnscentedKalmanFilter<float, 2> ukf;
+    ukf.reset(Vector<float, 2>{0.0f, 0.0f}, SymMatrix<float, 2>::diagonal(25.0f));
+    SymMatrix<float, 2> q = SymMatrix<float, 2>::diagonal(1e-6f);
+    SymMatrix<float, 2> r;
+    r(0, 0) = 0.05f * 0.05f;
+    r(1, 1) = 0.01f * 0.01f;
+
+    for(int step = 0; step < 100; step++)
+    {
+        double ox = 10.0 * std::cos(0.05 * step);
+        double oy = 10.0 * std::sin(0.05 * step);
+        Vector<float, 2> z = {(float)(std::hypot(targetX - ox, targetY - oy) + rangeNoise(rng)),
+                              (float)(std::atan2(targetY - oy, targetX - ox) + bearingNoise(rng))};
+        auto measure = [&](const Vector<float, 2> &s) {
+            return Vector<float, 2>{(float)std::hypot(s[0] - ox, s[1] - oy), (float)std::atan2(s[1] - oy, s[0] - ox)};
+        };
+        ASSERT_TRUE(ukf.predict([](const Vector<float, 2> &s) { return s; }, q));
+        ASSERT_TRUE(ukf.update(measure, z, r));
+    }
+    EXPECT_NEAR(ukf.state()[0], targetX, 0.05);
+    EXPECT_NEAR(ukf.state()[1], targetY, 0.05);
+}
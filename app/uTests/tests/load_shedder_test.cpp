@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "load_shedder.h"
+
+namespace {
+
+// Service levels of one simulated component and the CPU each one costs
+struct Component
+{
+    const char *name;
+    uint8_t order;
+    std::vector<uint32_t> costPermille;     // Index is the level, back is the most degraded
+    uint8_t level;
+    std::string *journal;
+};
+
+void applyLevel(uint8_t level, void *ctx)
+{
+    Component *component = static_cast<Component *>(ctx);
+    component->level = level;
+    if(component->journal != nullptr)
+    {
+        *component->journal += component->name;
+        *component->journal += (char)('0' + level);
+        *component->journal += ' ';
+    }
+}
+
+// A CPU running fixed work plus the three sheddable components. Above the
+// deadline limit every period misses one deadline.
+struct Simulator
+{
+    Component logs = { "L", 0, { 200, 100, 20 }, 0, nullptr };
+    Component polling = { "P", 1, { 150, 60, 20 }, 0, nullptr };
+    Component telemetry = { "T", 2, { 100, 0 }, 0, nullptr };
+    LoadShedder shedder;
+    std::string journal;
+    uint32_t deadlineLimit = 950;
+
+    Simulator()
+    {
+        for(Component *component : { &telemetry, &logs, &polling })
+        {
+            component->journal = &journal;
+            LoadShedClient client = { component->name, component->order,
+                                      (uint8_t)(component->costPermille.size() - 1U), applyLevel, component };
+            EXPECT_TRUE(shedder.addClient(client));
+        }
+        journal.clear();
+    }
+
+    uint32_t load(uint32_t workPermille) const
+    {
+        uint32_t total = workPermille + logs.costPermille[logs.level] + polling.costPermille[polling.level] +
+                         telemetry.costPermille[telemetry.level];
+        return total > 1000U ? 1000U : total;
+    }
+
+    void run(uint32_t workPermille, uint32_t periods)
+    {
+        for(uint32_t i = 0; i < periods; i++)
+        {
+            uint32_t now = load(workPermille);
+            shedder.sample(now, now > deadlineLimit ? 1U : 0U);
+        }
+    }
+};
+
+} // namespace
+
+TEST(LoadShedderTest, ClientsAreOrderedAndStartAtFullService) {
+    Simulator sim;
+
+    ASSERT_EQ(3U, sim.shedder.clientCount());
+    EXPECT_STREQ("L", sim.shedder.client(0).name);
+    EXPECT_STREQ("P", sim.shedder.client(1).name);
+    EXPECT_STREQ("T", sim.shedder.client(2).name);
+    EXPECT_EQ(5U, sim.shedder.levelCount());
+    EXPECT_EQ(0U, sim.shedder.level());
+    EXPECT_EQ(450U, sim.load(0));
+
+    LoadShedClient invalid = { "X", 3, 0, applyLevel, nullptr };
+    EXPECT_FALSE(sim.shedder.addClient(invalid));
+}
+
+TEST(LoadShedderTest, ShedsInOrderAndRestoresInReverse) {
+    Simulator sim;
+
+    // Light work: nothing to do
+    sim.run(100, 20);
+    EXPECT_EQ(0U, sim.shedder.level());
+
+    // Heavy burst: the whole ladder is needed before the load fits
+    sim.run(750, 20);
+    EXPECT_EQ("L1 L2 P1 P2 T1 ", sim.journal);
+    EXPECT_EQ(5U, sim.shedder.level());
+    EXPECT_EQ(790U, sim.load(750));
+
+    // Back to light work: everything returns, last shed first
+    sim.journal.clear();
+    sim.run(100, 40);
+    EXPECT_EQ("T0 P1 P0 L1 L0 ", sim.journal);
+    EXPECT_EQ(0U, sim.shedder.level());
+
+    const LoadShedStats &stats = sim.shedder.stats();
+    EXPECT_EQ(5U, stats.peakLevel);
+    EXPECT_EQ(5U, stats.sheds);
+    EXPECT_EQ(5U, stats.restores);
+}
+
+TEST(LoadShedderTest, ModerateOverloadShedsOnlyWhatIsNeeded) {
+    Simulator sim;
+
+    // 450 + 450 is over the threshold, dropping log verbosity one step is enough
+    sim.run(450, 50);
+    EXPECT_EQ(1U, sim.shedder.level());
+    EXPECT_EQ(1U, sim.logs.level);
+    EXPECT_EQ(0U, sim.polling.level);
+    EXPECT_EQ(0U, sim.telemetry.level);
+}
+
+TEST(LoadShedderTest, HysteresisHoldsBetweenThresholds) {
+    Simulator sim;
+
+    sim.run(600, 10);
+    uint8_t level = sim.shedder.level();
+    ASSERT_GT(level, 0U);
+
+    // Restoring one step would push the load over again: with the load in the
+    // band between the thresholds the level holds instead of flapping
+    uint32_t before = sim.shedder.stats().sheds + sim.shedder.stats().restores;
+    sim.run(600, 200);
+    EXPECT_EQ(level, sim.shedder.level());
+    EXPECT_EQ(before, sim.shedder.stats().sheds + sim.shedder.stats().restores);
+}
+
+TEST(LoadShedderTest, DeadlineMissesShedAtLowLoad) {
+    Simulator sim;
+
+    // A starved high-priority task misses deadlines without the CPU looking busy
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        sim.shedder.sample(500, 1);
+    }
+    EXPECT_EQ(2U, sim.shedder.level());
+
+    // A single calm sample is not enough to restore
+    sim.shedder.sample(300, 0);
+    EXPECT_EQ(2U, sim.shedder.level());
+}
+
+TEST(LoadShedderTest, NoisyLoadDoesNotFlap) {
+    Simulator sim;
+    uint32_t seed = 12345;
+
+    // Work wanders around 400 +/- 150 every period
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        uint32_t work = 250U + (seed >> 16) % 300U;
+        uint32_t now = sim.load(work);
+        sim.shedder.sample(now, now > sim.deadlineLimit ? 1U : 0U);
+    }
+
+    const LoadShedStats &stats = sim.shedder.stats();
+    EXPECT_LT(stats.sheds + stats.restores, 60U);
+}
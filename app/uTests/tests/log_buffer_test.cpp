@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_buffer.h"
+
+namespace {
+
+enum : uint8_t { DEBUG, INFO, WARN, ERROR };
+
+struct Record
+{
+    uint8_t severity;
+    std::string text;
+};
+
+bool push(LogBuffer &buffer, uint8_t severity, const std::string &text)
+{
+    return buffer.push(severity, text.data(), text.size());
+}
+
+std::vector<Record> drainAll(LogBuffer &buffer)
+{
+    std::vector<Record> records;
+    char text[LOG_BUFFER_TEXT_MAX];
+    while(buffer.records() > 0)
+    {
+        Record record;
+        size_t length = buffer.pop(record.severity, text, sizeof(text));
+        record.text.assign(text, length);
+        records.push_back(record);
+    }
+    return records;
+}
+
+} // namespace
+
+TEST(LogBufferTest, QueuesWholeRecordsInOrder) {
+    uint8_t storage[256];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+
+    EXPECT_TRUE(push(buffer, INFO, "first"));
+    EXPECT_TRUE(push(buffer, ERROR, "second"));
+    EXPECT_TRUE(push(buffer, DEBUG, "third"));
+    EXPECT_EQ(3U, buffer.records());
+    EXPECT_EQ(5U, buffer.frontLength());
+
+    std::vector<Record> records = drainAll(buffer);
+    ASSERT_EQ(3U, records.size());
+    EXPECT_EQ("first", records[0].text);
+    EXPECT_EQ(ERROR, records[1].severity);
+    EXPECT_EQ("second", records[1].text);
+    EXPECT_EQ("third", records[2].text);
+    EXPECT_EQ(0U, buffer.used());
+}
+
+TEST(LogBufferTest, ReservesKeepRoomForMoreSevereRecords) {
+    uint8_t storage[200];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+    buffer.setReserve(INFO, 100);
+    buffer.setReserve(WARN, 40);
+
+    // Info stops at half of the buffer, nothing to evict below it
+    std::string line(18, 'i');
+    uint32_t accepted = 0;
+    while(push(buffer, INFO, line))
+    {
+        accepted++;
+    }
+    EXPECT_EQ(5U, accepted);
+    EXPECT_LE(buffer.used(), 100U);
+    EXPECT_EQ(1U, buffer.totalShed(INFO));
+
+    // Warnings and errors still have their share
+    EXPECT_TRUE(push(buffer, WARN, std::string(18, 'w')));
+    EXPECT_TRUE(push(buffer, ERROR, std::string(18, 'e')));
+    EXPECT_EQ(0U, buffer.totalShed(WARN));
+    EXPECT_EQ(0U, buffer.totalShed(ERROR));
+}
+
+TEST(LogBufferTest, EvictsOldestOfTheLeastSevereFirst) {
+    uint8_t storage[100];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+
+    // Ten records of 10 bytes fill the buffer
+    for(int i = 0; i < 10; i++)
+    {
+        std::string text = "rec " + std::to_string(i) + "...";
+        text.resize(8, '.');
+        ASSERT_TRUE(push(buffer, i % 2 == 0 ? INFO : DEBUG, text));
+    }
+    EXPECT_EQ(100U, buffer.used());
+
+    // An error needing two slots takes the two oldest debug records
+    EXPECT_TRUE(push(buffer, ERROR, std::string(18, 'E')));
+    EXPECT_EQ(2U, buffer.totalShed(DEBUG));
+
+    std::vector<Record> records = drainAll(buffer);
+    ASSERT_EQ(9U, records.size());
+    EXPECT_EQ("rec 0...", records[0].text);
+    EXPECT_EQ("rec 2...", records[1].text);
+    EXPECT_EQ("rec 4...", records[2].text);
+    EXPECT_EQ("rec 5...", records[3].text);
+    EXPECT_EQ(ERROR, records[8].severity);
+}
+
+TEST(LogBufferTest, ShedSummaryIsTakenOnce) {
+    uint8_t storage[64];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+    buffer.setReserve(DEBUG, 32);
+
+    for(int i = 0; i < 10; i++)
+    {
+        push(buffer, DEBUG, std::string(14, 'd'));
+    }
+    for(int i = 0; i < 4; i++)
+    {
+        push(buffer, ERROR, std::string(14, 'e'));
+    }
+
+    uint32_t counts[LOG_BUFFER_SEVERITIES];
+    ASSERT_TRUE(buffer.takeShed(counts));
+    EXPECT_EQ(10U, counts[DEBUG]);
+    EXPECT_EQ(0U, counts[INFO]);
+    EXPECT_EQ(0U, counts[ERROR]);
+    EXPECT_FALSE(buffer.takeShed(counts));
+
+    std::vector<Record> records = drainAll(buffer);
+    ASSERT_EQ(4U, records.size());
+    for(const Record &record : records)
+    {
+        EXPECT_EQ(ERROR, record.severity);
+    }
+}
+
+TEST(LogBufferTest, FloodOfChatterNeverCostsAnError) {
+    constexpr uint32_t CHATTY_THREADS = 4;
+    constexpr uint32_t CHATTER = 5000;
+    constexpr uint32_t ERRORS = 200;
+
+    // Same layout as the firmware: 2 KiB, debug half, info three quarters
+    uint8_t storage[2048];
+    LogBuffer buffer;
+    buffer.attach(storage, sizeof(storage));
+    buffer.setReserve(DEBUG, 1024);
+    buffer.setReserve(INFO, 512);
+    buffer.setReserve(WARN, 192);
+    std::mutex lock;
+
+    std::atomic<uint32_t> pushed[LOG_BUFFER_SEVERITIES] = {};
+    std::atomic<bool> producing{true};
+    std::vector<std::thread> producers;
+    for(uint32_t t = 0; t < CHATTY_THREADS; t++)
+    {
+        producers.emplace_back([&, t]() {
+            char text[96];
+            for(uint32_t i = 0; i < CHATTER; i++)
+            {
+                uint8_t severity = (uint8_t)((i + t) % 3U);     // Debug, info and warnings
+                int length = snprintf(text, sizeof(text), "chatter %u from thread %u, %s\n", i, t,
+                                      "padding the record to a realistic length");
+                std::lock_guard<std::mutex> guard(lock);
+                buffer.push(severity, text, (size_t)length);
+                pushed[severity]++;
+            }
+        });
+    }
+    std::thread errors([&]() {
+        char text[64];
+        for(uint32_t i = 0; i < ERRORS; i++)
+        {
+            int length = snprintf(text, sizeof(text), "error %u\n", i);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                buffer.push(ERROR, text, (size_t)length);
+                pushed[ERROR]++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    // A slow reader, like a debug probe polling RTT
+    uint32_t delivered[LOG_BUFFER_SEVERITIES] = {};
+    uint32_t nextError = 0;
+    bool errorsInOrder = true;
+    std::thread reader([&]() {
+        char text[LOG_BUFFER_TEXT_MAX + 1];
+        for(;;)
+        {
+            bool done = !producing.load();
+            size_t length = 0;
+            uint8_t severity = 0;
+            bool got = false;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(buffer.records() > 0)
+                {
+                    length = buffer.pop(severity, text, LOG_BUFFER_TEXT_MAX);
+                    got = true;
+                }
+            }
+            if(!got)
+            {
+                if(done)
+                {
+                    return;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            delivered[severity]++;
+            if(severity == ERROR)
+            {
+                text[length] = '\0';
+                unsigned int index = 0;
+                errorsInOrder = errorsInOrder && sscanf(text, "error %u", &index) == 1 && index == nextError;
+                nextError++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+
+    for(std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    errors.join();
+    producing = false;
+    reader.join();
+
+    EXPECT_EQ(ERRORS, delivered[ERROR]);
+    EXPECT_TRUE(errorsInOrder);
+    EXPECT_EQ(0U, buffer.totalShed(ERROR));
+
+    uint32_t shedChatter = 0;
+    for(uint8_t severity = 0; severity < LOG_BUFFER_SEVERITIES; severity++)
+    {
+        EXPECT_EQ(pushed[severity].load(), delivered[severity] + buffer.totalShed(severity));
+        if(severity != ERROR)
+        {
+            shedChatter += buffer.totalShed(severity);
+        }
+    }
+    EXPECT_GT(shedChatter, 0U);
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "mpsc_ring.h"
+
+TEST(MpscRingTest, FillsDrainsAndWraps) {
+    MpscRing<uint32_t, 8> ring;
+    uint32_t value;
+
+    EXPECT_FALSE(ring.pop(value));
+    for(uint32_t round = 0; round < 3; round++)
+    {
+        for(uint32_t i = 0; i < 8; i++)
+        {
+            EXPECT_TRUE(ring.push(round * 100U + i));
+        }
+        EXPECT_FALSE(ring.push(999));
+        EXPECT_EQ(8U, ring.size());
+
+        for(uint32_t i = 0; i < 8; i++)
+        {
+            ASSERT_TRUE(ring.pop(value));
+            EXPECT_EQ(round * 100U + i, value);
+        }
+        EXPECT_FALSE(ring.pop(value));
+        EXPECT_EQ(0U, ring.size());
+    }
+}
+
+TEST(MpscRingTest, ConcurrentProducersKeepOrderAndLoseNothing) {
+    constexpr uint32_t PRODUCERS = 4;
+    constexpr uint32_t ITEMS = 20000;
+    MpscRing<uint32_t, 64> ring;
+
+    std::vector<std::thread> producers;
+    for(uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&ring, p]() {
+            for(uint32_t i = 0; i < ITEMS; i++)
+            {
+                // Producer id in the top byte, sequence below
+                while(!ring.push((p << 24) | i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(PRODUCERS, 0);
+    uint32_t received = 0;
+    while(received < PRODUCERS * ITEMS)
+    {
+        uint32_t value;
+        if(!ring.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t producer = value >> 24;
+        ASSERT_LT(producer, PRODUCERS);
+        ASSERT_EQ(next[producer], value & 0xFFFFFFU);
+        next[producer]++;
+        received++;
+    }
+
+    for(std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_EQ(0U, ring.size());
+}
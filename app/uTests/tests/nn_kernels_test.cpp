@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "nn_model.h"
+#include "nn_quantizer.h"
+#include "nn_reference.h"
+#include "nn_test_model.h"
+
+namespace {
+
+// Shapes only, the planner never looks at the weights
+constexpr NnLayer PLANNED[] = {
+    {NN_OP_CONV1D, 128, 3, 8, 5, 2, nullptr, nullptr, {}},          // 384 -> 62 x 8 = 496
+    {NN_OP_MAX_POOL1D, 62, 8, 8, 2, 2, nullptr, nullptr, {}},       // -> 31 x 8 = 248
+    {NN_OP_CONV1D, 31, 8, 16, 3, 1, nullptr, nullptr, {}},          // -> 29 x 16 = 464
+    {NN_OP_DENSE, 29, 16, 4, 1, 1, nullptr, nullptr, {}},           // -> 4
+};
+
+constexpr NnArenaPlan<4> PLAN = nnPlanArena(PLANNED);
+
+static_assert(nnChainValid(PLANNED, 4), "the shapes chain");
+static_assert(PLAN.size == 496 + 384, "the largest pair of neighbours, and no more");
+
+// Largest error of the int8 output against the float one, in output steps; values the
+// calibration never saw saturate, so the float side is clamped to the calibrated range
+double outputError(TestModel &m, const std::vector<float> &x, std::vector<uint8_t> &arena, size_t *agree)
+{
+    std::vector<float> scratch(2U * nnLargestTensor(m.layers.data(), m.layers.size()));
+    const float *expected = nnReferenceInvoke(m.layers.data(), m.layers.size(), x.data(), scratch.data(), nullptr);
+
+    int8_t *in = nnInput(m.model, arena.data());
+    for(size_t i = 0; i < x.size(); i++)
+    {
+        in[i] = nnQuantize(x[i], m.model.inputScale, m.model.inputZero);
+    }
+    nnInvoke(m.model, arena.data());
+
+    size_t outputs = nnOutputSize(m.layers.back());
+    const int8_t *out = nnOutput(m.model, arena.data());
+    float lowest = nnDequantize(INT8_MIN, m.model.outputScale, m.model.outputZero);
+    float highest = nnDequantize(INT8_MAX, m.model.outputScale, m.model.outputZero);
+    double worst = 0.0;
+    size_t best = 0;
+    for(size_t o = 0; o < outputs; o++)
+    {
+        float got = nnDequantize(out[o], m.model.outputScale, m.model.outputZero);
+        float clamped = std::min(std::max(expected[o], lowest), highest);
+        worst = std::max(worst, (double)std::fabs(got - clamped) / m.model.outputScale);
+        best = expected[o] > expected[best] ? o : best;
+    }
+    *agree += nnArgMax(m.model, arena.data()) == best ? 1U : 0U;
+    return worst;
+}
+
+} // namespace
+
+TEST(NnKernelsTest, RequantisationRoundsAndClamps) {
+    int32_t multiplier = 0;
+    int8_t shift = 0;
+    nnQuantizeMultiplier(0.75, &multiplier, &shift);
+    EXPECT_EQ(multiplier, 0x60000000);
+    EXPECT_EQ(shift, 0);
+    nnQuantizeMultiplier(0.001, &multiplier, &shift);
+    EXPECT_EQ(shift, -9);
+    EXPECT_NEAR(multiplier / 2147483648.0 * std::ldexp(1.0, shift), 0.001, 1e-12);
+    nnQuantizeMultiplier(3.0, &multiplier, &shift);
+    EXPECT_EQ(shift, 2);
+
+    // 0.25 as 0.5 * 2^-1: 10 * 0.25 = 2.5 rounds up, -10 * 0.25 = -2.5 rounds up too
+    int32_t half = 0x40000000;
+    int8_t down = -1;
+    NnRequant rq = {&half, &down, 5, -128, 127};
+    EXPECT_EQ(nnRequantize(10, rq, 0), 5 + 3);
+    EXPECT_EQ(nnRequantize(-10, rq, 0), 5 - 2);
+    EXPECT_EQ(nnRequantize(1000, rq, 0), 127);
+    EXPECT_EQ(nnRequantize(-1000, rq, 0), -128);
+    rq.min = 5;     // Fused ReLU
+    EXPECT_EQ(nnRequantize(-10, rq, 0), 5);
+
+    NnTensorQuant q = nnChooseQuant(-1.0f, 3.0f);
+    EXPECT_NEAR(q.scale, 4.0f / 255.0f, 1e-7);
+    EXPECT_EQ(nnQuantize(0.0f, q.scale, q.zero), q.zero);
+    EXPECT_EQ(nnQuantize(-1.0f, q.scale, q.zero), -128);
+    EXPECT_EQ(nnQuantize(3.0f, q.scale, q.zero), 127);
+}
+
+TEST(NnKernelsTest, DotProductHandlesEveryTailLength) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(-128, 127);
+    int8_t a[67];
+    int8_t b[67];
+    for(size_t i = 0; i < 67; i++)
+    {
+        a[i] = (int8_t)dist(rng);
+        b[i] = (int8_t)dist(rng);
+    }
+    for(size_t offset = 0; offset < 4; offset++)
+    {
+        for(size_t n = 0; n + offset <= 67; n++)
+        {
+            int32_t expected = 0;
+            for(size_t i = 0; i < n; i++)
+            {
+                expected += (int32_t)a[offset + i] * b[offset + i];
+            }
+            ASSERT_EQ(nnDot(a + offset, b + offset, n), expected) << "offset " << offset << " n " << n;
+        }
+    }
+
+    int8_t low[4] = {-128, -128, -128, -128};
+    EXPECT_EQ(nnDot(low, low, 4), 4 * 16384);
+}
+
+TEST(NnKernelsTest, PoolingMatchesTheReference) {
+    // Six positions of two channels, windows of two positions at stride 2
+    const int8_t in[] = {1, -7, 5, -3, -128, 127, 4, 4, 3, -5, 6, 2};
+    int8_t maxOut[6];
+    int8_t avgOut[6];
+    nnMaxPool1d(in, 6, 2, 2, 2, maxOut);
+    nnAvgPool1d(in, 6, 2, 2, 2, avgOut);
+    const int8_t expectedMax[] = {5, -3, 4, 127, 6, 2};
+    const int8_t expectedAvg[] = {3, -5, -62, 66, 5, -2};
+    for(size_t i = 0; i < 6; i++)
+    {
+        EXPECT_EQ(maxOut[i], expectedMax[i]) << i;
+        EXPECT_EQ(avgOut[i], expectedAvg[i]) << i;
+    }
+    EXPECT_EQ(nnOutLength(6, 4, 2), 2U);
+    EXPECT_EQ(nnOutLength(3, 4, 1), 0U);
+}
+
+TEST(NnKernelsTest, PlannerSeparatesNeighboursAndReusesTheRest) {
+    for(size_t t = 0; t < 4; t++)
+    {
+        uint32_t aStart = PLAN.offset[t];
+        uint32_t aEnd = aStart + nnTensorBytes(PLANNED, 4, t);
+        uint32_t bStart = PLAN.offset[t + 1U];
+        uint32_t bEnd = bStart + nnTensorBytes(PLANNED, 4, t + 1U);
+        EXPECT_TRUE(aEnd <= bStart || bEnd <= aStart) << "tensors " << t << " and " << t + 1U;
+        EXPECT_LE(std::max(aEnd, bEnd), PLAN.size);
+        EXPECT_EQ(PLAN.offset[t] % NN_ARENA_ALIGN, 0U);
+    }
+
+    // Input and the first pool output never live together, so they share
+    EXPECT_EQ(PLAN.offset[0], PLAN.offset[2]);
+
+    constexpr NnLayer broken[] = {
+        {NN_OP_CONV1D, 16, 2, 4, 3, 1, nullptr, nullptr, {}},
+        {NN_OP_DENSE, 16, 4, 2, 1, 1, nullptr, nullptr, {}},
+    };
+    static_assert(!nnChainValid(broken, 2), "14 x 4 does not feed 16 x 4");
+}
+
+TEST(NnKernelsTest, QuantisedModelTracksTheFloatOne) {
+    std::mt19937 rng(7);
+    TestModel m;
+    addLayer(m, NN_OP_CONV1D, 128, 3, 8, 5, 2, true, rng);
+    addLayer(m, NN_OP_MAX_POOL1D, 62, 8, 8, 2, 2, false, rng);
+    addLayer(m, NN_OP_DEPTHWISE_CONV1D, 31, 8, 8, 3, 1, true, rng);
+    addLayer(m, NN_OP_CONV1D, 29, 8, 16, 3, 1, true, rng);
+    addLayer(m, NN_OP_AVG_POOL1D, 27, 16, 16, 3, 3, false, rng);
+    addLayer(m, NN_OP_DENSE, 9, 16, 4, 1, 1, false, rng);
+
+    std::vector<std::vector<float>> calibration;
+    for(int i = 0; i < 64; i++)
+    {
+        calibration.push_back(randomInput(m.inputSize(), rng));
+    }
+    quantise(m, calibration);
+
+    std::vector<uint8_t> arena(m.model.arenaSize);
+    double worst = 0.0;
+    size_t agree = 0;
+    constexpr size_t TRIALS = 200;
+    for(size_t i = 0; i < TRIALS; i++)
+    {
+        worst = std::max(worst, outputError(m, randomInput(m.inputSize(), rng), arena, &agree));
+    }
+
+    // A few steps of rounding per layer, and the same class almost every time
+    EXPECT_LT(worst, 6.0);
+    EXPECT_GE(agree, TRIALS * 95U / 100U);
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "real_fft.h"
+#include "spectrum.h"
+#include "fft_reference.h"
+
+namespace {
+
+constexpr double PI = FFT_REFERENCE_PI;
+
+template<size_t N>
+double floatError(uint32_t seed)
+{
+    std::vector<double> x = randomSignal(N, 1.0, seed);
+    std::vector<double> expected = naiveSpectrum(x);
+    float data[N];
+    for(size_t i = 0; i < N; i++)
+    {
+        data[i] = (float)x[i];
+    }
+    RealFft<float, N>::forward(data);
+
+    double worst = 0.0;
+    for(size_t i = 0; i < N; i++)
+    {
+        worst = std::max(worst, std::fabs(data[i] - expected[i]));
+    }
+    return worst / std::sqrt((double)N);
+}
+
+template<typename T, size_t N>
+double fixedError(double fullScale, uint32_t seed)
+{
+    std::vector<double> x = randomSignal(N, 0.9, seed);
+    std::vector<double> expected = naiveSpectrum(x);
+    T data[N];
+    for(size_t i = 0; i < N; i++)
+    {
+        data[i] = FftTraits<T>::fromDouble(x[i]);
+    }
+    RealFft<T, N>::forward(data);
+
+    double worst = 0.0;
+    for(size_t i = 0; i < N; i++)
+    {
+        worst = std::max(worst, std::fabs(data[i] / fullScale - expected[i] / N));
+    }
+    return worst;
+}
+
+} // namespace
+
+TEST(RealFftTest, ConstantTrigIsAccurate) {
+    for(uint32_t i = 0; i < 1024; i += 7)
+    {
+        EXPECT_NEAR(fftSinTurn(i, 1024), std::sin(2.0 * PI * i / 1024.0), 1e-15);
+        EXPECT_NEAR(fftCosTurn(i, 1024), std::cos(2.0 * PI * i / 1024.0), 1e-15);
+    }
+    static_assert(fftSinTurn(0, 16) == 0.0, "exact zero");
+    static_assert(fftCosTurn(4, 16) == 0.0, "exact quarter turn");
+    EXPECT_EQ(FftTraits<q15_t>::fromDouble(1.0), 32767);
+    EXPECT_EQ(FftTraits<q15_t>::fromDouble(-1.0), -32768);
+    EXPECT_EQ(FftTraits<q31_t>::fromDouble(0.5), 0x40000000);
+}
+
+TEST(RealFftTest, FloatMatchesTheDftForEveryStageMix) {
+    // N/2 of 8, 32 and 512 ends with a radix-2 stage, 16 and 256 are radix-4 only
+    EXPECT_LT(floatError<16>(1), 1e-6);
+    EXPECT_LT(floatError<32>(2), 1e-6);
+    EXPECT_LT(floatError<64>(3), 1e-6);
+    EXPECT_LT(floatError<512>(4), 1e-6);
+    EXPECT_LT(floatError<1024>(5), 1e-6);
+}
+
+TEST(RealFftTest, FixedPointIsScaledByN) {
+    EXPECT_LT((fixedError<q15_t, 64>(32768.0, 6)), 4.0 / 32768.0);
+    EXPECT_LT((fixedError<q15_t, 1024>(32768.0, 7)), 8.0 / 32768.0);
+    EXPECT_LT((fixedError<q31_t, 1024>(2147483648.0, 8)), 1e-8);
+
+    // A full-scale cosine reads 0.5 in its bin
+    q15_t tone[256];
+    for(size_t i = 0; i < 256; i++)
+    {
+        tone[i] = FftTraits<q15_t>::fromDouble(std::cos(2.0 * PI * 10.0 * i / 256.0));
+    }
+    RealFft<q15_t, 256>::forward(tone);
+    EXPECT_NEAR(tone[20], 16384, 8);
+    EXPECT_NEAR(tone[21], 0, 8);
+
+    // Full-scale DC lands in bin 0 without wrapping anywhere on the way
+    q15_t dc[64];
+    for(q15_t &v : dc)
+    {
+        v = -32768;
+    }
+    RealFft<q15_t, 64>::forward(dc);
+    EXPECT_EQ(dc[0], -32768);
+    EXPECT_EQ(dc[1], 0);
+    EXPECT_EQ(dc[2], 0);
+}
+
+TEST(RealFftTest, WindowsHaveTheirTextbookGains) {
+    using Hann = SpectrumWindow<float, 1024, SPECTRUM_WINDOW_HANN>;
+    EXPECT_NEAR(Hann::coherentGain(), 0.5, 1e-12);
+    EXPECT_NEAR(Hann::powerGain(), 0.375, 1e-12);
+    EXPECT_FLOAT_EQ(Hann::at(0), 0.0f);
+    EXPECT_FLOAT_EQ(Hann::at(512), 1.0f);
+    EXPECT_FLOAT_EQ(Hann::at(100), Hann::at(924));
+
+    using Flat = SpectrumWindow<q15_t, 256, SPECTRUM_WINDOW_FLAT_TOP>;
+    EXPECT_NEAR(Flat::coherentGain(), 0.2156, 1e-3);
+
+    float frame[1024];
+    for(float &v : frame)
+    {
+        v = 2.0f;
+    }
+    Hann::apply(frame);
+    EXPECT_FLOAT_EQ(frame[0], 0.0f);
+    EXPECT_FLOAT_EQ(frame[512], 2.0f);
+    EXPECT_FLOAT_EQ(frame[256], frame[768]);
+}
+
+TEST(RealFftTest, PowerMagnitudeAndBands) {
+    constexpr size_t N = 256;
+
+    // Tone of amplitude 0.5 centred on bin 20, no leakage without a window
+    float frame[N];
+    for(size_t i = 0; i < N; i++)
+    {
+        frame[i] = (float)(0.5 * std::sin(2.0 * PI * 20.0 * i / N));
+    }
+    RealFft<float, N>::forward(frame);
+
+    float power[N / 2U + 1U];
+    spectrumPower(frame, N, power);
+    EXPECT_NEAR(power[20], 64.0f * 64.0f, 1e-2);
+    EXPECT_NEAR(power[0], 0.0f, 1e-6);
+
+    SpectrumBand bands[] = {{0, 10}, {15, 25}, {100, 200}};
+    float energy[3];
+    spectrumBandEnergy(power, N / 2U + 1U, bands, 3, energy);
+    EXPECT_NEAR(energy[0], 0.0f, 1e-3);
+    EXPECT_NEAR(energy[1], 4096.0f, 1e-1);
+    EXPECT_NEAR(energy[2], 0.0f, 1e-3);
+
+    spectrumMagnitude(frame, N, frame);
+    EXPECT_NEAR(frame[20], 64.0f, 1e-3);
+    EXPECT_NEAR(frame[19], 0.0f, 1e-3);
+
+    EXPECT_EQ(spectrumBinOf(1000, 8000, 256), 32U);
+    EXPECT_EQ(spectrumIsqrt(1ULL << 62), 1ULL << 31);
+    EXPECT_EQ(spectrumIsqrt(99), 9U);
+}
+
+TEST(RealFftTest, AdcBlockToQ15Spectrum) {
+    constexpr size_t N = 64;
+
+    // 12-bit codes around mid-scale: DC offset removed, a tone in bin 4
+    uint16_t block[N];
+    for(size_t i = 0; i < N; i++)
+    {
+        block[i] = (uint16_t)(2048 + (int)std::lround(1000.0 * std::cos(2.0 * PI * 4.0 * i / N)));
+    }
+    q15_t *samples = spectrumLoadAdc(block, N, 12);
+    EXPECT_EQ((void *)samples, (void *)block);
+    EXPECT_EQ(samples[0], 1000 * 16);
+
+    RealFft<q15_t, N>::forward(samples);
+    SpectrumTraits<q15_t>::Power power[N / 2U + 1U];
+    spectrumPower(samples, N, power);
+    EXPECT_LT(power[0], 4U);
+    EXPECT_NEAR((double)spectrumIsqrt(power[4]), 8000.0, 8.0);
+
+    float floats[N];
+    uint16_t codes[2] = {0, 4095};
+    spectrumLoadAdc(codes, floats, 2, 12);
+    EXPECT_FLOAT_EQ(floats[0], -1.0f);
+    EXPECT_NEAR(floats[1], 1.0f, 1e-3);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "time_series.h"
+
+namespace {
+
+struct FlashSim
+{
+    size_t blockSize = 0;
+    std::map<uint32_t, std::vector<uint8_t>> blocks;
+};
+
+bool spillToSim(uint32_t index, const uint8_t *block, size_t size, void *ctx)
+{
+    FlashSim *sim = static_cast<FlashSim *>(ctx);
+    sim->blocks[index].assign(block, block + size);
+    return true;
+}
+
+bool loadFromSim(uint32_t index, uint8_t *block, size_t size, void *ctx)
+{
+    FlashSim *sim = static_cast<FlashSim *>(ctx);
+    auto it = sim->blocks.find(index);
+    if(it == sim->blocks.end() || it->second.size() != size)
+    {
+        return false;
+    }
+    memcpy(block, it->second.data(), size);
+    return true;
+}
+
+} // namespace
+
+TEST(TimeSeriesTest, FloatRoundTrip) {
+    std::vector<uint8_t> storage(4 * 256);
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), 256, 4, TsValueType::Float, nullptr, nullptr, nullptr };
+    ASSERT_TRUE(store.init(config));
+
+    const float values[] = { 1.0f, 1.0f, 1.5f, -3.25f, 1e-9f, 1e9f, 0.0f, 21.37f };
+    const uint32_t timestamps[] = { 0, 10, 20, 30, 45, 45, 5000, 100000 };
+    for(size_t i = 0; i < 8; i++)
+    {
+        ASSERT_TRUE(store.append(timestamps[i], values[i]));
+    }
+
+    TsQuery query = store.query(0, UINT32_MAX);
+    TsSample sample;
+    for(size_t i = 0; i < 8; i++)
+    {
+        ASSERT_TRUE(query.next(sample));
+        EXPECT_EQ(sample.timestamp, timestamps[i]);
+        EXPECT_EQ(sample.asFloat(), values[i]);
+    }
+    EXPECT_FALSE(query.next(sample));
+}
+
+TEST(TimeSeriesTest, IntRoundTripAcrossBlocks) {
+    std::vector<uint8_t> storage(8 * 64);
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), 64, 8, TsValueType::Int, nullptr, nullptr, nullptr };
+    ASSERT_TRUE(store.init(config));
+
+    const int32_t values[] = { 0, 5, -5, INT32_MAX, INT32_MIN, 7, 7, 7, 100, -100000 };
+    for(uint32_t i = 0; i < 40; i++)
+    {
+        ASSERT_TRUE(store.append(i * 250U, values[i % 10]));
+    }
+    EXPECT_GT(store.stats().sealedBlocks, 0U);
+
+    TsQuery query = store.query(0, UINT32_MAX);
+    TsSample sample;
+    for(uint32_t i = 0; i < 40; i++)
+    {
+        ASSERT_TRUE(query.next(sample));
+        EXPECT_EQ(sample.timestamp, i * 250U);
+        EXPECT_EQ(sample.asInt(), values[i % 10]);
+    }
+    EXPECT_FALSE(query.next(sample));
+}
+
+TEST(TimeSeriesTest, RejectsTimestampsGoingBackwards) {
+    std::vector<uint8_t> storage(2 * 128);
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), 128, 2, TsValueType::Int, nullptr, nullptr, nullptr };
+    ASSERT_TRUE(store.init(config));
+
+    EXPECT_TRUE(store.append(100U, (int32_t)1));
+    EXPECT_FALSE(store.append(99U, (int32_t)2));
+    EXPECT_EQ(store.stats().rejectedSamples, 1U);
+}
+
+TEST(TimeSeriesTest, SpillsAndQueriesRangeAcrossFlashAndRam) {
+    const size_t blockSize = 128;
+    std::vector<uint8_t> storage(3 * blockSize);
+    std::vector<uint8_t> scratch(blockSize);
+    FlashSim sim;
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), blockSize, 3, TsValueType::Int, spillToSim, loadFromSim, &sim };
+    ASSERT_TRUE(store.init(config));
+
+    for(uint32_t i = 0; i < 2000; i++)
+    {
+        ASSERT_TRUE(store.append(i * 100U, (int32_t)(i % 17)));
+    }
+    TimeSeriesStats stats = store.stats();
+    EXPECT_GT(stats.spilledBlocks, 0U);
+    EXPECT_EQ(stats.droppedBlocks, 0U);
+
+    // Range that starts in flash and ends in RAM
+    TsQuery query = store.query(1000U * 100U, 1999U * 100U, scratch.data());
+    TsSample sample;
+    uint32_t expected = 1000;
+    while(query.next(sample))
+    {
+        ASSERT_EQ(sample.timestamp, expected * 100U);
+        ASSERT_EQ(sample.asInt(), (int32_t)(expected % 17));
+        expected++;
+    }
+    EXPECT_EQ(expected, 2000U);
+
+    // Without a scratch buffer only RAM blocks are scanned
+    TsQuery ramOnly = store.query(0, UINT32_MAX);
+    ASSERT_TRUE(ramOnly.next(sample));
+    EXPECT_GT(sample.timestamp, 0U);
+}
+
+TEST(TimeSeriesTest, DropsOldestBlockWithoutSpill) {
+    std::vector<uint8_t> storage(2 * 64);
+    TimeSeriesStore store;
+    TimeSeriesConfig config = { storage.data(), 64, 2, TsValueType::Int, nullptr, nullptr, nullptr };
+    ASSERT_TRUE(store.init(config));
+
+    for(uint32_t i = 0; i < 500; i++)
+    {
+        ASSERT_TRUE(store.append(i, (int32_t)i));
+    }
+    EXPECT_GT(store.stats().droppedBlocks, 0U);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+#include "time_sync.h"
+
+namespace {
+
+// A device whose oscillator runs 40 ppm fast and booted 5 s before the host
+// clock started, talking to the host over a link with jittery latency
+struct LinkSim
+{
+    static constexpr double DRIFT = 40e-6;
+    static constexpr double BOOT_US = 5000000.0;
+
+    std::mt19937 rng { 1234 };
+    double trueUs = 0.0;
+
+    uint64_t localAt(double t) const { return (uint64_t)((t + BOOT_US) * (1.0 + DRIFT)); }
+    uint64_t hostAt(double t) const { return (uint64_t)t; }
+
+    double uniform(double lo, double hi)
+    {
+        return std::uniform_real_distribution<double>(lo, hi)(rng);
+    }
+
+    // One exchange starting now; the wire takes 2.5 ms plus up to 2 ms of jitter each way
+    void exchange(TimeSyncClock &clock)
+    {
+        uint64_t t1 = localAt(trueUs);
+        double arrive = trueUs + 2500.0 + uniform(0.0, 2000.0);
+        double reply = arrive + uniform(100.0, 3000.0);
+        double back = reply + 2500.0 + uniform(0.0, 2000.0);
+        clock.addSample(t1, hostAt(arrive), hostAt(reply), localAt(back));
+        trueUs = back;
+    }
+};
+
+} // namespace
+
+TEST(TimeSyncTest, MessageRoundTrip) {
+    TimeSyncMessage message = { TIME_SYNC_RESPONSE, 0xBEEF, 1ULL << 40, 123456789012345ULL, 0xFFFFFFFFFFULL };
+    uint8_t frame[TIME_SYNC_FRAME_SIZE];
+    ASSERT_EQ(message.encode(frame, sizeof(frame)), TIME_SYNC_FRAME_SIZE);
+    EXPECT_EQ(frame[0], TIME_SYNC_TAG);
+    EXPECT_EQ(message.encode(frame, sizeof(frame) - 1U), 0U);
+
+    TimeSyncMessage decoded = {};
+    ASSERT_TRUE(decoded.decode(frame, sizeof(frame)));
+    EXPECT_EQ(decoded.type, TIME_SYNC_RESPONSE);
+    EXPECT_EQ(decoded.sequence, 0xBEEF);
+    EXPECT_EQ(decoded.t1, message.t1);
+    EXPECT_EQ(decoded.t2, message.t2);
+    EXPECT_EQ(decoded.t3, message.t3);
+
+    EXPECT_FALSE(decoded.decode(frame, sizeof(frame) - 1U));
+    frame[1] = 7;
+    EXPECT_FALSE(decoded.decode(frame, sizeof(frame)));
+}
+
+TEST(TimeSyncTest, InconsistentAndSlowExchangesAreDiscarded) {
+    TimeSyncClock clock;
+    EXPECT_FALSE(clock.addSample(1000, 5000, 4000, 2000));
+    EXPECT_FALSE(clock.addSample(1000, 5000, 5100, 900000));
+    EXPECT_EQ(clock.stats().discarded, 2U);
+    EXPECT_FALSE(clock.synced());
+
+    EXPECT_TRUE(clock.addSample(1000, 5000, 5100, 1300));
+    EXPECT_TRUE(clock.synced());
+    EXPECT_EQ(clock.stats().steps, 1U);
+    // offset = ((5000 - 1000) + (5100 - 1300)) / 2 = 3900
+    EXPECT_EQ(clock.toReference(1300), 5200U);
+}
+
+TEST(TimeSyncTest, ConvergesBelowAMillisecondWithJitter) {
+    TimeSyncClock clock;
+    LinkSim sim;
+
+    // Exchanges every 2 s until eight are done, then every 16 s, for half an hour
+    int64_t worstUs = 0;
+    double squares = 0.0;
+    uint32_t checks = 0;
+    uint32_t exchanges = 0;
+    uint64_t lastRef = 0;
+    bool monotonic = true;
+    while(sim.trueUs < 1800e6)
+    {
+        sim.exchange(clock);
+        double next = sim.trueUs + (++exchanges < 8U ? 2e6 : 16e6);
+        ASSERT_TRUE(clock.synced());
+
+        // Check the clock between exchanges once the drift estimate has settled
+        for(double t = sim.trueUs + 1000.0; t < next; t += 97000.0)
+        {
+            uint64_t ref = clock.toReference(sim.localAt(t));
+            monotonic = monotonic && ref >= lastRef;
+            lastRef = ref;
+            if(t > 300e6)
+            {
+                int64_t error = std::llabs((int64_t)ref - (int64_t)sim.hostAt(t));
+                worstUs = error > worstUs ? error : worstUs;
+                squares += (double)error * (double)error;
+                checks++;
+            }
+        }
+        sim.trueUs = next;
+    }
+
+    // Uniform jitter of up to 2 ms each way leaves even the fastest exchanges a few hundred us asymmetric
+    double rmsUs = std::sqrt(squares / checks);
+    EXPECT_LT(worstUs, 1000);
+    EXPECT_LT(rmsUs, 350.0);
+    EXPECT_TRUE(monotonic);
+    EXPECT_EQ(clock.stats().steps, 1U);
+    EXPECT_GT(clock.stats().accepted, 20U);
+    // The reference runs 40 ppm slow against the local oscillator
+    EXPECT_NEAR(clock.stats().driftPpb, -40000, 2000);
+}
+
+TEST(TimeSyncTest, LargeOffsetStepsSmallOneSlews) {
+    TimeSyncClock clock;
+    ASSERT_TRUE(clock.addSample(0, 1000000, 1000000, 0));
+    EXPECT_EQ(clock.toReference(1000), 1001000U);
+
+    // The reference moved 1 ms: slewed at 500 ppm over 2 s, never backwards
+    clock.reset();
+    TimeSyncConfig config;
+    config.minFitSpanUs = UINT32_MAX;
+    clock.configure(config);
+    ASSERT_TRUE(clock.addSample(0, 1000000, 1000000, 0));
+    ASSERT_TRUE(clock.addSample(10000000, 11000000, 11000000, 10000000));
+    ASSERT_TRUE(clock.addSample(20000000, 21001000, 21001000, 20000000));
+    EXPECT_EQ(clock.stats().steps, 1U);
+    EXPECT_GT(clock.stats().lastCorrectionUs, 0);
+    uint64_t before = clock.toReference(20000000);
+    uint64_t mid = clock.toReference(20500000);
+    EXPECT_GT(mid, before + 500000U);
+    EXPECT_LE(mid, before + 500250U + 1U);
+
+    // With the window mean the whole correction is a third of a millisecond
+    uint64_t after = clock.toReference(30000000);
+    EXPECT_EQ(after - 30000000U, 1000000U + (uint64_t)clock.stats().lastCorrectionUs);
+}
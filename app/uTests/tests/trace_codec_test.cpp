@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "trace_codec.h"
+
+namespace {
+
+TraceEvent makeEvent(TraceKind kind, uint8_t port, uint64_t timeUs, uint32_t value)
+{
+    TraceEvent event = {};
+    event.kind = kind;
+    event.port = port;
+    event.timeUs = timeUs;
+    event.value = value;
+    return event;
+}
+
+std::vector<uint8_t> encodeAll(const std::vector<TraceEvent> &events)
+{
+    std::vector<uint8_t> trace(TRACE_MAGIC, TRACE_MAGIC + TRACE_MAGIC_SIZE);
+    TraceEncoder encoder;
+    for(const TraceEvent &event : events)
+    {
+        uint8_t out[TRACE_EVENT_MAX_HEADER + 64];
+        size_t n = encoder.encode(event, out, sizeof(out));
+        EXPECT_GT(n, 0U);
+        trace.insert(trace.end(), out, out + n);
+    }
+    return trace;
+}
+
+} // namespace
+
+TEST(TraceCodecTest, RoundTripsEveryKind) {
+    static const uint8_t bytes[] = "field data";
+    std::vector<TraceEvent> events = {
+        makeEvent(TRACE_UART_TX, 2, 10, 23),
+        makeEvent(TRACE_UART_TX_DONE, 2, 1500, 0),
+        makeEvent(TRACE_UART_RX, 2, 1500, 63),
+        makeEvent(TRACE_UART_STATE, 2, 101500, 0),
+        makeEvent(TRACE_UART_DATA, 2, 101500, 0),
+        makeEvent(TRACE_UART_ERROR, 2, 200000, 8),
+        makeEvent(TRACE_SMBUS_TX, 2, 5000000000ULL, 0x5A),
+        makeEvent(TRACE_DROPPED, 0, 5000000001ULL, 7),
+        makeEvent(TRACE_SPAN_START, TRACE_SPAN_SMBUS, 5000000001ULL, 70000),
+        makeEvent(TRACE_SPAN_END, TRACE_SPAN_SMBUS, 5000001200ULL, 70000),
+    };
+    events[3].status = 0x20;
+    events[4].length = sizeof(bytes) - 1;
+    events[4].data = bytes;
+    events[6].length = 11;
+    events[6].status = 1;
+    events[9].status = 2;
+
+    std::vector<uint8_t> trace = encodeAll(events);
+    TraceDecoder decoder;
+    ASSERT_TRUE(decoder.attach(trace.data(), trace.size()));
+
+    TraceEvent event;
+    for(const TraceEvent &expected : events)
+    {
+        ASSERT_TRUE(decoder.next(event));
+        EXPECT_EQ(expected.kind, event.kind);
+        EXPECT_EQ(expected.port, event.port);
+        EXPECT_EQ(expected.timeUs, event.timeUs);
+        EXPECT_EQ(expected.status, event.status);
+        EXPECT_EQ(expected.value, event.value);
+        EXPECT_EQ(expected.length, event.length);
+        if(expected.kind == TRACE_UART_DATA)
+        {
+            EXPECT_EQ(0, memcmp(bytes, event.data, event.length));
+        }
+    }
+    EXPECT_FALSE(decoder.next(event));
+    EXPECT_FALSE(decoder.malformed());
+}
+
+TEST(TraceCodecTest, FullBufferLeavesEncoderUnchanged) {
+    TraceEncoder encoder;
+    uint8_t small[2];
+    EXPECT_EQ(0U, encoder.encode(makeEvent(TRACE_UART_TX, 2, 1000000, 300), small, sizeof(small)));
+
+    // The next event must still carry the whole delta from the start
+    std::vector<uint8_t> trace(TRACE_MAGIC, TRACE_MAGIC + TRACE_MAGIC_SIZE);
+    uint8_t out[TRACE_EVENT_MAX_HEADER];
+    size_t n = encoder.encode(makeEvent(TRACE_UART_TX, 2, 1000000, 300), out, sizeof(out));
+    trace.insert(trace.end(), out, out + n);
+
+    TraceDecoder decoder;
+    TraceEvent event;
+    ASSERT_TRUE(decoder.attach(trace.data(), trace.size()));
+    ASSERT_TRUE(decoder.next(event));
+    EXPECT_EQ(1000000U, event.timeUs);
+}
+
+TEST(TraceCodecTest, RejectsDamage) {
+    std::vector<uint8_t> trace = encodeAll({ makeEvent(TRACE_UART_TX, 2, 10, 23), makeEvent(TRACE_UART_RX, 2, 20, 63) });
+
+    TraceDecoder decoder;
+    trace[0] = 'X';
+    EXPECT_FALSE(decoder.attach(trace.data(), trace.size()));
+
+    // A trace cut short by the recorder ends cleanly after the last whole event
+    trace[0] = TRACE_MAGIC[0];
+    trace.pop_back();
+    TraceEvent event;
+    ASSERT_TRUE(decoder.attach(trace.data(), trace.size()));
+    EXPECT_TRUE(decoder.next(event));
+    EXPECT_FALSE(decoder.next(event));
+    EXPECT_FALSE(decoder.malformed());
+
+    // An unknown tag in the middle is corruption
+    trace = encodeAll({ makeEvent(TRACE_UART_TX, 2, 10, 23), makeEvent(TRACE_UART_RX, 2, 20, 63) });
+    trace[TRACE_MAGIC_SIZE] = 0xF2;
+    ASSERT_TRUE(decoder.attach(trace.data(), trace.size()));
+    EXPECT_FALSE(decoder.next(event));
+    EXPECT_TRUE(decoder.malformed());
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tunables.h"
+
+TUNABLE_UINT(testPeriodMs, "test.period_ms", 100, 10, 1000);
+TUNABLE_INT(testOffset, "test.offset", -5, -100, 100);
+TUNABLE_UINT(testMask, "test.mask", 0x0F, 0, 0xFFFFFFFF);
+
+namespace {
+
+class TunablesTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { tunableResetAll(); }
+    void TearDown() override { tunableResetAll(); }
+
+    std::string run(const char *line, size_t capacity = 512)
+    {
+        std::vector<char> out(capacity);
+        EXPECT_TRUE(shell.execute(line, out.data(), out.size()));
+        return std::string(out.data());
+    }
+
+    TunableShell shell;
+};
+
+} // namespace
+
+TEST_F(TunablesTest, SectionHoldsEveryTunable) {
+    ASSERT_EQ(tunableCount(), 3U);
+    EXPECT_EQ(tunableAt(3), nullptr);
+
+    const Tunable *period = tunableFind("test.period_ms");
+    ASSERT_NE(period, nullptr);
+    EXPECT_EQ(period->value, &testPeriodMs);
+    EXPECT_EQ(tunableFind("test.period"), nullptr);
+    EXPECT_EQ(tunableFind("nothing"), nullptr);
+}
+
+TEST_F(TunablesTest, SetChecksTheRange) {
+    const Tunable *period = tunableFind("test.period_ms");
+    EXPECT_EQ(tunableSet(period, 500), TUNABLE_OK);
+    EXPECT_EQ(testPeriodMs, 500U);
+    EXPECT_EQ(tunableSet(period, 9), TUNABLE_OUT_OF_RANGE);
+    EXPECT_EQ(tunableSet(period, 1001), TUNABLE_OUT_OF_RANGE);
+    EXPECT_EQ(tunableSet(period, -1), TUNABLE_OUT_OF_RANGE);
+    EXPECT_EQ(testPeriodMs, 500U);
+    EXPECT_EQ(tunableSet(nullptr, 1), TUNABLE_UNKNOWN);
+
+    const Tunable *mask = tunableFind("test.mask");
+    EXPECT_EQ(tunableSet(mask, 0xFFFFFFFFLL), TUNABLE_OK);
+    EXPECT_EQ(tunableGet(mask), 0xFFFFFFFFLL);
+    EXPECT_EQ(tunableSet(mask, 0x100000000LL), TUNABLE_OUT_OF_RANGE);
+}
+
+TEST_F(TunablesTest, SignedValues) {
+    const Tunable *offset = tunableFind("test.offset");
+    EXPECT_EQ(testOffset, -5);
+    EXPECT_EQ(tunableGet(offset), -5);
+    EXPECT_EQ(tunableSet(offset, -100), TUNABLE_OK);
+    EXPECT_EQ(testOffset, -100);
+    EXPECT_EQ(tunableSet(offset, -101), TUNABLE_OUT_OF_RANGE);
+    EXPECT_EQ(tunableSet(offset, 0xFFFFFF9CLL), TUNABLE_OUT_OF_RANGE);
+    EXPECT_EQ(tunableSet(offset, 100), TUNABLE_OK);
+    EXPECT_EQ(tunableGet(offset), 100);
+}
+
+TEST_F(TunablesTest, SaveAndLoad) {
+    uint8_t blob[64];
+    size_t empty = tunableSave(blob, sizeof(blob));
+    EXPECT_GT(empty, 0U);
+    EXPECT_EQ(tunableLoad(blob, empty), 0);
+
+    tunableSet(tunableFind("test.period_ms"), 250);
+    tunableSet(tunableFind("test.offset"), -42);
+    size_t size = tunableSave(blob, sizeof(blob));
+    EXPECT_EQ(size, empty + 16U);
+    EXPECT_EQ(tunableSave(blob, size - 1U), 0U);
+
+    tunableResetAll();
+    EXPECT_EQ(testPeriodMs, 100U);
+    EXPECT_EQ(tunableLoad(blob, size), 2);
+    EXPECT_EQ(testPeriodMs, 250U);
+    EXPECT_EQ(testOffset, -42);
+    EXPECT_EQ(testMask, 0x0FU);
+
+    // Damage anywhere is caught by the CRC, nothing is applied
+    tunableResetAll();
+    blob[10] ^= 0x01;
+    EXPECT_EQ(tunableLoad(blob, size), -1);
+    EXPECT_EQ(tunableLoad(blob, size - 1U), -1);
+    EXPECT_EQ(testPeriodMs, 100U);
+}
+
+TEST_F(TunablesTest, ShellCommands) {
+    EXPECT_EQ(run("get test.period_ms"), "test.period_ms = 100 [10..1000] default 100\n");
+    EXPECT_EQ(run("set test.period_ms 0x200"), "test.period_ms = 512 [10..1000] default 100\n");
+    EXPECT_EQ(testPeriodMs, 512U);
+    EXPECT_EQ(run("  set  test.offset -7\r\n"), "test.offset = -7 [-100..100] default -5\n");
+    EXPECT_EQ(run("set test.offset 101"), "error: out of range\n");
+    EXPECT_EQ(run("set test.offset 1x"), "error: set takes a name and a number\n");
+    EXPECT_EQ(run("set test.nothing 1"), "error: unknown tunable\n");
+    EXPECT_EQ(run("reset test.offset"), "test.offset = -5 [-100..100] default -5\n");
+    EXPECT_EQ(run("reset all"), "3 tunables reset\n");
+    EXPECT_EQ(testPeriodMs, 100U);
+    EXPECT_EQ(run("save"), "error: no config store\n");
+
+    char out[16];
+    EXPECT_FALSE(shell.execute("reboot", out, sizeof(out)));
+    EXPECT_FALSE(shell.execute("", out, sizeof(out)));
+}
+
+TEST_F(TunablesTest, ShellListContinues) {
+    std::string all = run("list");
+    EXPECT_EQ(std::count(all.begin(), all.end(), '\n'), 3);
+
+    // A short buffer ends with where to continue, and continuing gets the rest
+    std::string first = run("list", 80);
+    size_t hint = first.find("... list ");
+    ASSERT_NE(hint, std::string::npos);
+    std::string from = first.substr(hint + 4);
+    from.pop_back();
+    std::string rest = run(from.c_str());
+    EXPECT_EQ(first.substr(0, hint) + rest, all);
+}
+
+TEST_F(TunablesTest, ShellSavesThroughHook) {
+    struct Store
+    {
+        std::vector<uint8_t> blob;
+    } store;
+    shell.setSave(
+        [](const uint8_t *blob, size_t size, void *ctx) {
+            static_cast<Store *>(ctx)->blob.assign(blob, blob + size);
+            return true;
+        },
+        &store);
+
+    run("set test.mask 0xFF");
+    std::string reply = run("save");
+    EXPECT_EQ(reply, "saved " + std::to_string(store.blob.size()) + " bytes\n");
+
+    tunableResetAll();
+    EXPECT_EQ(tunableLoad(store.blob.data(), store.blob.size()), 1);
+    EXPECT_EQ(testMask, 0xFFU);
+}
@@ -69,12 +69,12 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)15360)
+#define configTOTAL_HEAP_SIZE                    ((size_t)20480)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
-#define configQUEUE_REGISTRY_SIZE                8
+#define configQUEUE_REGISTRY_SIZE                16
 #define configUSE_RECURSIVE_MUTEXES              1
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
@@ -108,6 +108,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil             0
 #define INCLUDE_vTaskDelay                  1
 #define INCLUDE_xTaskGetSchedulerState      1
+#define INCLUDE_xTaskGetIdleTaskHandle      1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -156,6 +157,54 @@ standard names. */
 #define configENABLE_MPU                         0
 #define configENABLE_TRUSTZONE                   0
 
+/* Tickless idle: the power manager picks the deepest mode the active peripherals allow.
+   The board supplies vPortSuppressTicksAndSleep, timed by LPTIM1 since SysTick stops in Stop mode. */
+#define configUSE_TICKLESS_IDLE                  2
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void powerManagerPreSleep(uint32_t *expectedIdleTime);
+void powerManagerPostSleep(uint32_t *expectedIdleTime);
+void HAL_EnableCycleCounter(void);
+uint32_t HAL_GetCycleCount(void);
+void lockProfilerRegister(const void *object, const char *name, uint8_t type, uint32_t length);
+void lockProfilerUnregister(const void *object);
+void lockProfilerBlock(const void *object, const void *task, uint8_t sending);
+void lockProfilerDone(const void *object, const void *task, uint8_t sending, uint32_t waiting);
+void lockProfilerFailed(const void *object, const void *task, uint8_t sending);
+#ifdef __cplusplus
+}
+#endif
+#endif
+#define configPRE_SLEEP_PROCESSING(x)            powerManagerPreSleep(&(x))
+#define configPOST_SLEEP_PROCESSING(x)           powerManagerPostSleep(&(x))
+
+/* Run-time stats on the DWT cycle counter: the overload controller reads the idle task's share.
+   The counter stops in Stop mode, so the share is relative to the time the core was awake. */
+#define configGENERATE_RUN_TIME_STATS            1
+#define configRUN_TIME_COUNTER_TYPE              uint32_t
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() HAL_EnableCycleCounter()
+#define portGET_RUN_TIME_COUNTER_VALUE()         HAL_GetCycleCount()
+
+/* Contention profiling of the objects in the queue registry (lock_profiler.h). The hooks expand
+   inside queue.c; sends report before the item is copied, hence the + 1 on the fill level. */
+#define traceQUEUE_REGISTRY_ADD(xQueue, pcQueueName) \
+    lockProfilerRegister((xQueue), (pcQueueName), (xQueue)->ucQueueType, (uint32_t)(xQueue)->uxLength)
+#define traceQUEUE_DELETE(pxQueue)               lockProfilerUnregister(pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)     lockProfilerBlock((pxQueue), xTaskGetCurrentTaskHandle(), 1)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)  lockProfilerBlock((pxQueue), xTaskGetCurrentTaskHandle(), 0)
+#define traceQUEUE_SEND(pxQueue) \
+    lockProfilerDone((pxQueue), xTaskGetCurrentTaskHandle(), 1, (uint32_t)(pxQueue)->uxMessagesWaiting + 1U)
+#define traceQUEUE_RECEIVE(pxQueue) \
+    lockProfilerDone((pxQueue), xTaskGetCurrentTaskHandle(), 0, (uint32_t)(pxQueue)->uxMessagesWaiting - 1U)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+    lockProfilerDone((pxQueue), NULL, 1, (uint32_t)(pxQueue)->uxMessagesWaiting + 1U)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+    lockProfilerDone((pxQueue), NULL, 0, (uint32_t)(pxQueue)->uxMessagesWaiting - 1U)
+#define traceQUEUE_SEND_FAILED(pxQueue)          lockProfilerFailed((pxQueue), xTaskGetCurrentTaskHandle(), 1)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue)       lockProfilerFailed((pxQueue), xTaskGetCurrentTaskHandle(), 0)
+
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
\ No newline at end of file
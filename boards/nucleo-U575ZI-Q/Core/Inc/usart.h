@@ -35,13 +35,16 @@ extern "C" {
 extern UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN Private defines */
-
+extern DMA_HandleTypeDef handle_GPDMA1_Channel0;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel1;
+extern UART_HandleTypeDef hlpuart1;
+extern DMA_HandleTypeDef handle_LPDMA1_Channel0;
 /* USER CODE END Private defines */
 
 void MX_USART2_UART_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+void MX_LPUART1_UART_Init(void);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
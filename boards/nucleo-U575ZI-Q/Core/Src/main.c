@@ -31,6 +31,12 @@
 #include "logging.h"
 #include "SEGGER_RTT.h"
 #include "freertos_tasks.h"
+#include "power_manager.h"
+#include "work_queue.h"
+#include "cpu_budget.h"
+#include "trace_recorder.h"
+#include "lpuart_wake.h"
+#include "spi_bus.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -40,7 +46,11 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+/* Address byte the LPUART1 bus master uses for this node */
+#define LPUART_NODE_ADDRESS    0x12U
 
+/* Longest tickless sleep LPTIM1 can time on LSE with its 16-bit counter */
+#define WAKE_TIMER_MAX_TICKS   ((TickType_t)((0xFFFFULL * configTICK_RATE_HZ) / LSE_VALUE))
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -51,14 +61,24 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
+extern TIM_HandleTypeDef htim17;
 
+/* SPI1 serves the spi_bus transaction queue: RX on GPDMA1 channel 2, TX on
+ * channel 3, one block per transfer on the caller's buffers */
+SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef handle_GPDMA1_Channel2;
+DMA_HandleTypeDef handle_GPDMA1_Channel3;
+
+/* Transaction queue on SPI1, attached at startup, device drivers submit to it */
+SpiBus spiBus1;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void SystemPower_Config(void);
 /* USER CODE BEGIN PFP */
-
+static void WakeTimer_Init(void);
+static void MX_SPI1_Init(void);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -103,8 +123,43 @@ int main(void)
   MX_ICACHE_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
+  MX_LPUART1_UART_Init();
+  MX_SPI1_Init();
+  WakeTimer_Init();
   initLogging();
 
+  /* Track the clocks and domains CubeMX enabled, drivers acquire what they use */
+  powerManagerInit((1UL << POWER_CLOCK_USART2) | (1UL << POWER_CLOCK_I2C2) | (1UL << POWER_CLOCK_SPI1) |
+                   (1UL << POWER_CLOCK_DMA),
+                   (1UL << POWER_DOMAIN_VDDIO2));
+
+#ifdef PERIPHERAL_TRACE
+  /* Peripheral traffic on RTT channel 1 for host replay, capture it from reset */
+  if (traceRecorderStart() == HAL_OK)
+  {
+    traceRecorderAddUart(&huart2, 2);
+    traceRecorderAddSmbus(&hsmbus2, 2);
+  }
+#endif
+
+  /* SPI1 transaction queue, holds its clock while attached and the DMA clock while busy */
+  if (spiBusInit(&spiBus1, &hspi1, POWER_CLOCK_SPI1) != HAL_OK)
+  {
+    logWrite(LOG_ERROR, "SPI1 bus failed to attach\n\r");
+  }
+
+  /* LPUART1 listens for this node's address in Stop 2 */
+  if (lpuartWakeInit(&hlpuart1, LPUART_NODE_ADDRESS, LPUART_WAKE_ON_ADDRESS) != HAL_OK)
+  {
+    logWrite(LOG_ERROR, "LPUART1 wake-up receiver failed to start\n\r");
+  }
+
+  /* Shared workers for interrupt bottom halves, before anything can submit */
+  if (workQueueInit() != HAL_OK)
+  {
+    Error_Handler();
+  }
+
   /* Create SMBus task */
   TaskHandle_t smbusTaskHandle = NULL;
   BaseType_t xReturned = xTaskCreate(smbusTask, "smbusTask", 1024, NULL, tskIDLE_PRIORITY + 2, &smbusTaskHandle);
@@ -125,6 +180,17 @@ int main(void)
     Error_Handler();
   }
 
+  /* The two tasks share a priority and yield voluntarily; a budget keeps either from starving the other */
+  if (cpuBudgetInit(100, 10) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  (void)cpuBudgetRegister(smbusTaskHandle, "smbusTask", 400, CPU_BUDGET_DEMOTE);
+  (void)cpuBudgetRegister(uartTaskHandle, "uartTask", 400, CPU_BUDGET_DEMOTE);
+
+  /* Gate everything no driver claimed, tasks acquire their peripherals on start */
+  powerManagerGateUnused();
+
   /* Start scheduler */
   vTaskStartScheduler();
   /* USER CODE END 2 */
@@ -213,6 +279,758 @@ static void SystemPower_Config(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+  * @brief  Enable a peripheral clock on behalf of the power manager
+  * @param  clock PowerClock identifier
+  * @retval None
+  */
+void HAL_PeriphClockEnable(uint32_t clock)
+{
+  switch (clock)
+  {
+    case POWER_CLOCK_USART2:  __HAL_RCC_USART2_CLK_ENABLE();  break;
+    case POWER_CLOCK_LPUART1: __HAL_RCC_LPUART1_CLK_ENABLE(); break;
+    case POWER_CLOCK_I2C2:    __HAL_RCC_I2C2_CLK_ENABLE();    break;
+    case POWER_CLOCK_SPI1:    __HAL_RCC_SPI1_CLK_ENABLE();    break;
+    case POWER_CLOCK_DMA:     __HAL_RCC_GPDMA1_CLK_ENABLE();  break;
+    case POWER_CLOCK_TIM2:    __HAL_RCC_TIM2_CLK_ENABLE();    break;
+    default: break;
+  }
+}
+
+/**
+  * @brief  Gate a peripheral clock on behalf of the power manager
+  * @param  clock PowerClock identifier
+  * @retval None
+  */
+void HAL_PeriphClockDisable(uint32_t clock)
+{
+  switch (clock)
+  {
+    case POWER_CLOCK_USART2:  __HAL_RCC_USART2_CLK_DISABLE();  break;
+    case POWER_CLOCK_LPUART1: __HAL_RCC_LPUART1_CLK_DISABLE(); break;
+    case POWER_CLOCK_I2C2:    __HAL_RCC_I2C2_CLK_DISABLE();    break;
+    case POWER_CLOCK_SPI1:    __HAL_RCC_SPI1_CLK_DISABLE();    break;
+    case POWER_CLOCK_DMA:     __HAL_RCC_GPDMA1_CLK_DISABLE();  break;
+    case POWER_CLOCK_TIM2:    __HAL_RCC_TIM2_CLK_DISABLE();    break;
+    default: break;
+  }
+}
+
+/**
+  * @brief  Enable a power domain on behalf of the power manager
+  * @param  domain PowerDomain identifier
+  * @retval None
+  */
+void HAL_PowerDomainEnable(uint32_t domain)
+{
+  switch (domain)
+  {
+    case POWER_DOMAIN_VDDIO2: HAL_PWREx_EnableVddIO2();     break;
+    case POWER_DOMAIN_SRAM2:  __HAL_RCC_SRAM2_CLK_ENABLE(); break;
+    case POWER_DOMAIN_SRAM3:  __HAL_RCC_SRAM3_CLK_ENABLE(); break;
+    default: break;
+  }
+}
+
+/**
+  * @brief  Disable a power domain on behalf of the power manager
+  * @param  domain PowerDomain identifier
+  * @retval None
+  */
+void HAL_PowerDomainDisable(uint32_t domain)
+{
+  switch (domain)
+  {
+    case POWER_DOMAIN_VDDIO2: HAL_PWREx_DisableVddIO2();     break;
+    case POWER_DOMAIN_SRAM2:  __HAL_RCC_SRAM2_CLK_DISABLE(); break;
+    case POWER_DOMAIN_SRAM3:  __HAL_RCC_SRAM3_CLK_DISABLE(); break;
+    default: break;
+  }
+}
+
+/**
+  * @brief  Enter Stop mode from the tickless idle hook
+  * @param  depth PowerMode chosen by the power manager
+  * @retval None
+  */
+void HAL_EnterStopMode(uint32_t depth)
+{
+  if (depth >= POWER_MODE_STOP2)
+  {
+    HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+  }
+  else
+  {
+    HAL_PWREx_EnterSTOP1Mode(PWR_STOPENTRY_WFI);
+  }
+}
+
+/**
+  * @brief  Restore the clock tree after Stop mode
+  * @param  depth PowerMode that was used
+  * @retval None
+  */
+void HAL_ExitStopMode(uint32_t depth)
+{
+  (void)depth;
+  SystemClock_Config();
+}
+
+/**
+  * @brief  Clock LPTIM1 from LSE as the tickless idle wake-up timer
+  * @note   LPTIM1 and LSE keep running in Stop 2, SysTick does not
+  * @retval None
+  */
+static void WakeTimer_Init(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+
+  HAL_PWR_EnableBkUpAccess();
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_LSE;
+  RCC_OscInitStruct.LSEState = RCC_LSE_ON;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  __HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+  __HAL_RCC_LPTIM1_CLK_ENABLE();
+  __HAL_RCC_LPTIM1_CLKAM_ENABLE();
+
+  /* DIER only takes writes with the timer enabled, and settles in the LSE domain */
+  LPTIM1->CR = LPTIM_CR_ENABLE;
+  LPTIM1->DIER = LPTIM_DIER_ARRMIE;
+  while ((LPTIM1->ISR & LPTIM_ISR_DIEROK) == 0U)
+  {
+  }
+  LPTIM1->ICR = LPTIM_ICR_DIEROKCF;
+
+  /* Only wakes the core, the handler clears the flag */
+  HAL_NVIC_SetPriority(LPTIM1_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0U);
+  HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+}
+
+/**
+  * @brief  Tickless idle: stop SysTick and let LPTIM1 wake the core for the next timeout
+  * @note   Called by the idle task with the scheduler suspended. The power manager hooks
+  *         pick Sleep or Stop, LPTIM1 on LSE measures the time spent in either.
+  * @param  xExpectedIdleTime Ticks until the next task unblocks
+  * @retval None
+  */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+  if (xExpectedIdleTime > WAKE_TIMER_MAX_TICKS)
+  {
+    xExpectedIdleTime = WAKE_TIMER_MAX_TICKS;
+  }
+
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+  {
+    __enable_irq();
+    return;
+  }
+
+  /* Freeze SysTick, the part of the current tick it already counted carries over */
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+  if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U)
+  {
+    /* A tick is due, let the kernel take it */
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    __enable_irq();
+    return;
+  }
+  uint32_t tickCycles = SysTick->LOAD + 1U;
+  uint32_t tickLeft = SysTick->VAL;
+
+  /* Wake when the last idle tick is due, the kernel's timeout then runs on time */
+  uint64_t sleepCycles = (uint64_t)(xExpectedIdleTime - 1U) * tickCycles + tickLeft;
+  uint32_t counts = (uint32_t)((sleepCycles * LSE_VALUE) / ((uint64_t)tickCycles * configTICK_RATE_HZ));
+  if (counts == 0U)
+  {
+    counts = 1U;
+  }
+  LPTIM1->ARR = counts;
+  while ((LPTIM1->ISR & LPTIM_ISR_ARROK) == 0U)
+  {
+  }
+  LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+  LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_SNGSTRT;
+
+  /* The HAL tick would wake Sleep mode every millisecond, it is caught up below */
+  HAL_SuspendTick();
+
+  TickType_t idleTime = xExpectedIdleTime;
+  configPRE_SLEEP_PROCESSING(idleTime);
+  if (idleTime > 0U)
+  {
+    __DSB();
+    __WFI();
+    __ISB();
+  }
+  configPOST_SLEEP_PROCESSING(idleTime);
+
+  /* CNT returns to zero on the match, so read it before the flag */
+  uint32_t elapsed;
+  do
+  {
+    elapsed = LPTIM1->CNT;
+  } while (elapsed != LPTIM1->CNT);
+  if ((LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U)
+  {
+    elapsed = counts;
+  }
+
+  /* Disabling resets the counter, the interrupt enable stays */
+  LPTIM1->CR = 0U;
+  LPTIM1->CR = LPTIM_CR_ENABLE;
+  LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+  HAL_NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+
+  /* Whole ticks slept, counting the part of the tick in progress when SysTick stopped */
+  uint64_t cycles = ((uint64_t)elapsed * tickCycles * configTICK_RATE_HZ) / LSE_VALUE
+                    + (tickCycles - tickLeft);
+  TickType_t ticks = (TickType_t)(cycles / tickCycles);
+  uint32_t toNextTick = tickCycles - (uint32_t)(cycles % tickCycles);
+  if (toNextTick < 2U)
+  {
+    toNextTick = 2U;
+  }
+  if (ticks >= xExpectedIdleTime)
+  {
+    /* The tick interrupt counts the last one */
+    ticks = xExpectedIdleTime - 1U;
+    toNextTick = 2U;
+  }
+
+  /* Run the part of a tick left, then go back to full ticks from the next reload */
+  SysTick->LOAD = toNextTick - 1U;
+  SysTick->VAL = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  SysTick->LOAD = tickCycles - 1U;
+
+  vTaskStepTick(ticks);
+  __HAL_TIM_CLEAR_FLAG(&htim17, TIM_FLAG_UPDATE);
+  uwTick += ticks;
+  HAL_ResumeTick();
+
+  __enable_irq();
+}
+
+/**
+  * @brief  Create a worker task for the deferred work service
+  * @param  entry Worker function
+  * @param  arg Argument passed to the worker
+  * @param  name Task name
+  * @param  stackWords Stack depth in words
+  * @param  priority Priority above idle
+  * @param  handle Receives the task handle
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_WorkerCreate(void (*entry)(void *arg), void *arg, const char *name,
+                                   uint32_t stackWords, uint32_t priority, void **handle)
+{
+  TaskHandle_t task = NULL;
+  if (xTaskCreate(entry, name, (configSTACK_DEPTH_TYPE)stackWords, arg, tskIDLE_PRIORITY + priority, &task) != pdPASS)
+  {
+    return HAL_ERROR;
+  }
+  *handle = task;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Wake a worker, from a task or an interrupt
+  * @param  handle Worker task handle
+  * @retval None
+  */
+void HAL_WorkerNotify(void *handle)
+{
+  if (xPortIsInsideInterrupt())
+  {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)handle, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+  else
+  {
+    xTaskNotifyGive((TaskHandle_t)handle);
+  }
+}
+
+/**
+  * @brief  Block the calling worker until it is notified
+  * @param  timeoutMs Timeout, 0xFFFFFFFF waits forever
+  * @retval None
+  */
+void HAL_WorkerWait(uint32_t timeoutMs)
+{
+  TickType_t ticks = (timeoutMs == 0xFFFFFFFFU) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  (void)ulTaskNotifyTake(pdTRUE, ticks);
+}
+
+/**
+  * @brief  Cycle counter time the idle task has run, from the run-time stats
+  * @retval Idle cycles, wrapping with the cycle counter
+  */
+uint32_t HAL_GetIdleCycles(void)
+{
+  return (uint32_t)ulTaskGetIdleRunTimeCounter();
+}
+
+/**
+  * @brief  Name of a task, for reports
+  * @param  task Task handle, NULL for interrupt context
+  * @retval Task name
+  */
+const char *HAL_TaskName(const void *task)
+{
+  if (task == NULL)
+  {
+    return "isr";
+  }
+  return pcTaskGetName((TaskHandle_t)task);
+}
+
+/**
+  * @brief  Cycles a task has run, from the run-time stats
+  * @param  task Task handle
+  * @retval Run-time counter of the task, wrapping with the cycle counter
+  */
+uint32_t HAL_TaskRunTime(void *task)
+{
+  return (uint32_t)ulTaskGetRunTimeCounter((TaskHandle_t)task);
+}
+
+/**
+  * @brief  Base priority of a task
+  * @param  task Task handle
+  * @retval Priority above idle
+  */
+uint32_t HAL_TaskGetPriority(void *task)
+{
+  return (uint32_t)(uxTaskPriorityGet((TaskHandle_t)task) - tskIDLE_PRIORITY);
+}
+
+/**
+  * @brief  Change the priority of a task
+  * @param  task Task handle
+  * @param  priority Priority above idle
+  */
+void HAL_TaskSetPriority(void *task, uint32_t priority)
+{
+  vTaskPrioritySet((TaskHandle_t)task, tskIDLE_PRIORITY + priority);
+}
+
+/**
+  * @brief  Suspend a task
+  * @param  task Task handle
+  */
+void HAL_TaskSuspend(void *task)
+{
+  vTaskSuspend((TaskHandle_t)task);
+}
+
+/**
+  * @brief  Resume a suspended task
+  * @param  task Task handle
+  */
+void HAL_TaskResume(void *task)
+{
+  vTaskResume((TaskHandle_t)task);
+}
+
+/**
+  * @brief  Program one quad-word of internal flash
+  * @param  address Flash address, 16-byte aligned
+  * @param  pData Source, 16 bytes
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_FLASH_ProgramUnit(uint32_t address, const uint8_t *pData)
+{
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address, (uint32_t)pData);
+  HAL_FLASH_Lock();
+  HAL_ICACHE_Invalidate();
+  return status;
+}
+
+/**
+  * @brief  Program one burst of eight quad-words of internal flash
+  * @param  address Flash address, 128-byte aligned
+  * @param  pData Source, 128 bytes
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_FLASH_ProgramRow(uint32_t address, const uint8_t *pData)
+{
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_BURST, address, (uint32_t)pData);
+  HAL_FLASH_Lock();
+  HAL_ICACHE_Invalidate();
+  return status;
+}
+
+/**
+  * @brief  Start a page erase without waiting for it
+  * @param  address Any address in the page
+  * @retval HAL_BUSY if the controller is running an operation
+  */
+HAL_StatusTypeDef HAL_FLASH_EraseStart(uint32_t address)
+{
+  if (READ_BIT(FLASH->NSSR, FLASH_NSSR_BSY | FLASH_NSSR_WDW) != 0U)
+  {
+    return HAL_BUSY;
+  }
+
+  // BKER names the physical bank, which is the other one when the banks are swapped
+  uint32_t offset = address - FLASH_BASE;
+  uint32_t bank = offset / FLASH_BANK_SIZE;
+  if (READ_BIT(FLASH->OPTR, FLASH_OPTR_SWAP_BANK) != 0U)
+  {
+    bank ^= 1U;
+  }
+  uint32_t page = (offset % FLASH_BANK_SIZE) / FLASH_PAGE_SIZE;
+
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_SR_ERRORS | FLASH_FLAG_EOP);
+  MODIFY_REG(FLASH->NSCR, FLASH_NSCR_PNB | FLASH_NSCR_BKER,
+             FLASH_NSCR_PER | (page << FLASH_NSCR_PNB_Pos) | (bank != 0U ? FLASH_NSCR_BKER : 0U));
+  SET_BIT(FLASH->NSCR, FLASH_NSCR_STRT);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Result of the erase started by HAL_FLASH_EraseStart
+  * @retval HAL_BUSY while it runs, HAL_ERROR if an error flag was raised
+  */
+HAL_StatusTypeDef HAL_FLASH_EraseStatus(void)
+{
+  if (READ_BIT(FLASH->NSSR, FLASH_NSSR_BSY) != 0U)
+  {
+    return HAL_BUSY;
+  }
+
+  uint32_t errors = READ_BIT(FLASH->NSSR, FLASH_FLAG_SR_ERRORS);
+  CLEAR_BIT(FLASH->NSCR, FLASH_NSCR_PER | FLASH_NSCR_PNB | FLASH_NSCR_BKER);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_SR_ERRORS | FLASH_FLAG_EOP);
+  HAL_FLASH_Lock();
+  HAL_ICACHE_Invalidate();
+  return errors != 0U ? HAL_ERROR : HAL_OK;
+}
+
+/**
+  * @brief  Bank, by address, this code is linked into
+  * @retval 0 for the first megabyte of flash, 1 for the second
+  */
+uint32_t HAL_FLASH_CodeBank(void)
+{
+  return ((uint32_t)&HAL_FLASH_CodeBank - FLASH_BASE) / FLASH_BANK_SIZE;
+}
+
+/**
+  * @brief  Run TIM2 as a free-running 1 MHz counter for the microsecond timer service
+  * @note   The power manager has enabled the TIM2 clock
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_UsTimerStart(void)
+{
+  // Timer kernel clock is PCLK1, doubled when APB1 is divided
+  uint32_t clock = HAL_RCC_GetPCLK1Freq();
+  if (READ_BIT(RCC->CFGR2, RCC_CFGR2_PPRE1_2) != 0U)
+  {
+    clock *= 2U;
+  }
+  if (clock < 1000000U)
+  {
+    return HAL_ERROR;
+  }
+
+  TIM2->CR1 = 0U;
+  TIM2->DIER = 0U;
+  TIM2->PSC = clock / 1000000U - 1U;
+  TIM2->ARR = 0xFFFFFFFFU;
+  TIM2->CCMR1 = 0U;               // Channel 1 frozen output compare, used for its flag only
+  TIM2->EGR = TIM_EGR_UG;         // Load the prescaler
+  TIM2->SR = 0U;
+
+  // Callbacks may submit work, keep the interrupt within the kernel's reach
+  HAL_NVIC_SetPriority(TIM2_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0U);
+  HAL_NVIC_EnableIRQ(TIM2_IRQn);
+  TIM2->CR1 = TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Microsecond counter
+  * @retval TIM2 count
+  */
+uint32_t HAL_UsTimerNow(void)
+{
+  return TIM2->CNT;
+}
+
+/**
+  * @brief  Arm the compare interrupt for a counter value
+  * @param  deadline Counter value
+  * @retval None
+  */
+void HAL_UsTimerSetCompare(uint32_t deadline)
+{
+  TIM2->CCR1 = deadline;
+  TIM2->SR = ~TIM_SR_CC1IF;
+  SET_BIT(TIM2->DIER, TIM_DIER_CC1IE);
+}
+
+/**
+  * @brief  Disarm the compare interrupt
+  * @retval None
+  */
+void HAL_UsTimerDisableCompare(void)
+{
+  CLEAR_BIT(TIM2->DIER, TIM_DIER_CC1IE);
+}
+
+/**
+  * @brief  Raise the compare interrupt by software
+  * @retval None
+  */
+void HAL_UsTimerForce(void)
+{
+  SET_BIT(TIM2->DIER, TIM_DIER_CC1IE);
+  TIM2->EGR = TIM_EGR_CC1G;
+}
+
+/**
+  * @brief  Kernel clock of a UART after its prescaler, for the link's rate table
+  * @param  huart UART handle
+  * @retval Clock in Hz, 0 for an instance this board does not clock
+  */
+uint32_t HAL_UART_GetKernelClockFreq(UART_HandleTypeDef *huart)
+{
+  uint32_t clock = 0U;
+  if (huart->Instance == USART2)
+  {
+    clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_USART2);
+  }
+  else if (huart->Instance == LPUART1)
+  {
+    clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_LPUART1);
+  }
+  return clock / UARTPrescTable[huart->Init.ClockPrescaler];
+}
+
+/**
+  * @brief  Reprogram the baud rate of a running UART
+  * @note   Waits for the last frame to leave the shift register, then changes BRR with the UART disabled
+  * @param  huart UART handle, reception aborted by the caller
+  * @param  baudRate New rate
+  * @retval HAL_ERROR if the clock cannot generate the rate, HAL_TIMEOUT if transmission did not finish
+  */
+HAL_StatusTypeDef HAL_UART_SetBaudRate(UART_HandleTypeDef *huart, uint32_t baudRate)
+{
+  uint32_t clock = HAL_UART_GetKernelClockFreq(huart);
+  if (clock == 0U || baudRate == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  uint32_t brr;
+  if (huart->Instance == LPUART1)
+  {
+    brr = (uint32_t)((((uint64_t)clock * 256U) + (baudRate / 2U)) / baudRate);
+    if (brr < LPUART_BRR_MIN || brr > LPUART_BRR_MAX)
+    {
+      return HAL_ERROR;
+    }
+  }
+  else
+  {
+    brr = (clock + (baudRate / 2U)) / baudRate;
+    if (brr < UART_BRR_MIN || brr > UART_BRR_MAX)
+    {
+      return HAL_ERROR;
+    }
+  }
+
+  uint32_t start = HAL_GetTick();
+  while (__HAL_UART_GET_FLAG(huart, UART_FLAG_TC) == RESET)
+  {
+    if ((HAL_GetTick() - start) > 10U)
+    {
+      return HAL_TIMEOUT;
+    }
+  }
+
+  __HAL_UART_DISABLE(huart);
+  huart->Instance->BRR = brr;
+  huart->Init.BaudRate = baudRate;
+  __HAL_UART_ENABLE(huart);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Program SPI clock and mode for the next device, called by spi_bus between transfers
+  * @note   Takes the fastest prescaler that does not exceed the device clock
+  * @param  hspi SPI handle, idle
+  * @param  clockHz Maximum SCK frequency of the device
+  * @param  mode SPI mode 0-3, (CPOL << 1) | CPHA
+  * @retval HAL_ERROR if the kernel clock cannot be divided down to clockHz
+  */
+HAL_StatusTypeDef HAL_SPI_SetDeviceConfig(SPI_HandleTypeDef *hspi, uint32_t clockHz, uint8_t mode)
+{
+  static const uint32_t prescalers[] = {
+    SPI_BAUDRATEPRESCALER_2, SPI_BAUDRATEPRESCALER_4, SPI_BAUDRATEPRESCALER_8,
+    SPI_BAUDRATEPRESCALER_16, SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_64,
+    SPI_BAUDRATEPRESCALER_128, SPI_BAUDRATEPRESCALER_256
+  };
+
+  if (hspi->Instance != SPI1 || clockHz == 0U || mode > 3U)
+  {
+    return HAL_ERROR;
+  }
+
+  uint32_t kernel = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_SPI1);
+  uint32_t index = 0U;
+  while (index < (sizeof(prescalers) / sizeof(prescalers[0])) && (kernel >> (index + 1U)) > clockHz)
+  {
+    index++;
+  }
+  if (index == (sizeof(prescalers) / sizeof(prescalers[0])))
+  {
+    return HAL_ERROR;
+  }
+
+  /* HAL_SPI_Init on a ready handle only rewrites CFG1/CFG2 with SPE cleared */
+  hspi->Init.BaudRatePrescaler = prescalers[index];
+  hspi->Init.CLKPolarity = ((mode & 2U) != 0U) ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
+  hspi->Init.CLKPhase = ((mode & 1U) != 0U) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
+  return HAL_SPI_Init(hspi);
+}
+
+/**
+  * @brief  Set up one SPI1 DMA channel, one block per transfer
+  * @param  hdma Channel handle
+  * @param  instance GPDMA1 channel
+  * @param  request GPDMA1 request of the SPI1 direction
+  * @param  direction DMA_PERIPH_TO_MEMORY or DMA_MEMORY_TO_PERIPH
+  * @retval None
+  */
+static void SPI1_DMA_Init(DMA_HandleTypeDef *hdma, DMA_Channel_TypeDef *instance, uint32_t request, uint32_t direction)
+{
+  hdma->Instance = instance;
+  hdma->Init.Request = request;
+  hdma->Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+  hdma->Init.Direction = direction;
+  hdma->Init.SrcInc = (direction == DMA_MEMORY_TO_PERIPH) ? DMA_SINC_INCREMENTED : DMA_SINC_FIXED;
+  hdma->Init.DestInc = (direction == DMA_MEMORY_TO_PERIPH) ? DMA_DINC_FIXED : DMA_DINC_INCREMENTED;
+  hdma->Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+  hdma->Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+  hdma->Init.Priority = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+  hdma->Init.SrcBurstLength = 1;
+  hdma->Init.DestBurstLength = 1;
+  hdma->Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0|DMA_DEST_ALLOCATED_PORT0;
+  hdma->Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  hdma->Init.Mode = DMA_NORMAL;
+  if (HAL_DMA_Init(hdma) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  if (HAL_DMA_ConfigChannelAttributes(hdma, DMA_CHANNEL_NPRIV) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  SPI1 init, master on PA5 SCK, PA6 MISO and PA7 MOSI (Arduino header)
+  * @note   SPI1 is not in the .ioc, so the pins, clocks and DMA are set up here
+  *         instead of in HAL_SPI_MspInit. Clock and mode are placeholders,
+  *         spi_bus programs them per device through HAL_SPI_SetDeviceConfig
+  * @retval None
+  */
+static void MX_SPI1_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+  SPI_AutonomousModeConfTypeDef HAL_SPI_AutonomousMode_Cfg_Struct = {0};
+
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_SPI1;
+  PeriphClkInit.Spi1ClockSelection = RCC_SPI1CLKSOURCE_PCLK2;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  __HAL_RCC_SPI1_CLK_ENABLE();
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  /**SPI1 GPIO Configuration
+  PA5     ------> SPI1_SCK
+  PA6     ------> SPI1_MISO
+  PA7     ------> SPI1_MOSI
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  __HAL_RCC_GPDMA1_CLK_ENABLE();
+  SPI1_DMA_Init(&handle_GPDMA1_Channel2, GPDMA1_Channel2, GPDMA1_REQUEST_SPI1_RX, DMA_PERIPH_TO_MEMORY);
+  __HAL_LINKDMA(&hspi1, hdmarx, handle_GPDMA1_Channel2);
+  SPI1_DMA_Init(&handle_GPDMA1_Channel3, GPDMA1_Channel3, GPDMA1_REQUEST_SPI1_TX, DMA_MEMORY_TO_PERIPH);
+  __HAL_LINKDMA(&hspi1, hdmatx, handle_GPDMA1_Channel3);
+
+  hspi1.Instance = SPI1;
+  hspi1.Init.Mode = SPI_MODE_MASTER;
+  hspi1.Init.Direction = SPI_DIRECTION_2LINES;
+  hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+  hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
+  hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
+  hspi1.Init.NSS = SPI_NSS_SOFT;
+  hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;
+  hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
+  hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
+  hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+  hspi1.Init.CRCPolynomial = 0x7;
+  hspi1.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
+  hspi1.Init.NSSPolarity = SPI_NSS_POLARITY_LOW;
+  hspi1.Init.FifoThreshold = SPI_FIFO_THRESHOLD_01DATA;
+  hspi1.Init.MasterSSIdleness = SPI_MASTER_SS_IDLENESS_00CYCLE;
+  hspi1.Init.MasterInterDataIdleness = SPI_MASTER_INTERDATA_IDLENESS_00CYCLE;
+  hspi1.Init.MasterReceiverAutoSusp = SPI_MASTER_RX_AUTOSUSP_DISABLE;
+  hspi1.Init.MasterKeepIOState = SPI_MASTER_KEEP_IO_STATE_ENABLE;
+  hspi1.Init.IOSwap = SPI_IO_SWAP_DISABLE;
+  hspi1.Init.ReadyMasterManagement = SPI_RDY_MASTER_MANAGEMENT_INTERNALLY;
+  hspi1.Init.ReadyPolarity = SPI_RDY_POLARITY_HIGH;
+  if (HAL_SPI_Init(&hspi1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  HAL_SPI_AutonomousMode_Cfg_Struct.TriggerState = SPI_AUTO_MODE_DISABLE;
+  HAL_SPI_AutonomousMode_Cfg_Struct.TriggerSelection = SPI_GRP1_GPDMA_CH0_TCF_TRG;
+  HAL_SPI_AutonomousMode_Cfg_Struct.TriggerPolarity = SPI_TRIG_POLARITY_RISING;
+  if (HAL_SPIEx_SetConfigAutonomousMode(&hspi1, &HAL_SPI_AutonomousMode_Cfg_Struct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* Interrupts at configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY for the spi_bus callbacks */
+  HAL_NVIC_SetPriority(GPDMA1_Channel2_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(GPDMA1_Channel2_IRQn);
+  HAL_NVIC_SetPriority(GPDMA1_Channel3_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(GPDMA1_Channel3_IRQn);
+  HAL_NVIC_SetPriority(SPI1_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(SPI1_IRQn);
+}
+
 /* USER CODE END 4 */
 
 /**
@@ -22,6 +22,7 @@
 #include "stm32u5xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "us_timer.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -59,7 +60,14 @@ extern SMBUS_HandleTypeDef hsmbus2;
 extern TIM_HandleTypeDef htim17;
 
 /* USER CODE BEGIN EV */
-
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel0;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel1;
+extern UART_HandleTypeDef hlpuart1;
+extern DMA_HandleTypeDef handle_LPDMA1_Channel0;
+extern SPI_HandleTypeDef hspi1;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel2;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel3;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -208,4 +216,89 @@ void TIM17_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles TIM2 global interrupt, the microsecond timer compare.
+  */
+void TIM2_IRQHandler(void)
+{
+  if (READ_BIT(TIM2->SR, TIM_SR_CC1IF) != 0U)
+  {
+    TIM2->SR = ~TIM_SR_CC1IF;
+    usTimerCompareIrq();
+  }
+}
+
+/**
+  * @brief This function handles GPDMA1 Channel 0 global interrupt, USART2 transmit.
+  */
+void GPDMA1_Channel0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel0);
+}
+
+/**
+  * @brief This function handles GPDMA1 Channel 1 global interrupt, USART2 receive.
+  */
+void GPDMA1_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel1);
+}
+
+/**
+  * @brief This function handles GPDMA1 Channel 2 global interrupt, SPI1 receive.
+  */
+void GPDMA1_Channel2_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel2);
+}
+
+/**
+  * @brief This function handles GPDMA1 Channel 3 global interrupt, SPI1 transmit.
+  */
+void GPDMA1_Channel3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel3);
+}
+
+/**
+  * @brief This function handles SPI1 global interrupt, the end of a transfer.
+  */
+void SPI1_IRQHandler(void)
+{
+  HAL_SPI_IRQHandler(&hspi1);
+}
+
+/**
+  * @brief This function handles USART2 global interrupt.
+  */
+void USART2_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&huart2);
+}
+
+/**
+  * @brief This function handles LPDMA1 Channel 0 global interrupt, LPUART1 receive.
+  */
+void LPDMA1_Channel0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_LPDMA1_Channel0);
+}
+
+/**
+  * @brief This function handles LPUART1 global interrupt, including the Stop mode wake-up flag.
+  */
+void LPUART1_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&hlpuart1);
+}
+
+/**
+  * @brief This function handles LPTIM1 global interrupt, the tickless idle wake-up.
+  */
+void LPTIM1_IRQHandler(void)
+{
+  /* Waking the core is all it is for, vPortSuppressTicksAndSleep reads the time */
+  LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+}
+
 /* USER CODE END 1 */
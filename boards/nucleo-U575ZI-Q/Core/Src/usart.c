@@ -21,7 +21,108 @@
 #include "usart.h"
 
 /* USER CODE BEGIN 0 */
+/* USART2 carries the framed host link: TX on GPDMA1 channel 0, RX on channel 1
+ * looping over a one-node circular list so reception never stops */
+DMA_HandleTypeDef handle_GPDMA1_Channel0;
+DMA_HandleTypeDef handle_GPDMA1_Channel1;
+static DMA_NodeTypeDef Node_GPDMA1_Channel1;
+static DMA_QListTypeDef List_GPDMA1_Channel1;
 
+/**
+  * @brief  Set up the USART2 transmit channel, one block per transfer
+  * @param  uartHandle USART2 handle
+  * @retval None
+  */
+static void USART2_TxDMA_Init(UART_HandleTypeDef* uartHandle)
+{
+  handle_GPDMA1_Channel0.Instance = GPDMA1_Channel0;
+  handle_GPDMA1_Channel0.Init.Request = GPDMA1_REQUEST_USART2_TX;
+  handle_GPDMA1_Channel0.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+  handle_GPDMA1_Channel0.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  handle_GPDMA1_Channel0.Init.SrcInc = DMA_SINC_INCREMENTED;
+  handle_GPDMA1_Channel0.Init.DestInc = DMA_DINC_FIXED;
+  handle_GPDMA1_Channel0.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+  handle_GPDMA1_Channel0.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+  handle_GPDMA1_Channel0.Init.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+  handle_GPDMA1_Channel0.Init.SrcBurstLength = 1;
+  handle_GPDMA1_Channel0.Init.DestBurstLength = 1;
+  handle_GPDMA1_Channel0.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0|DMA_DEST_ALLOCATED_PORT0;
+  handle_GPDMA1_Channel0.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  handle_GPDMA1_Channel0.Init.Mode = DMA_NORMAL;
+  if (HAL_DMA_Init(&handle_GPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  __HAL_LINKDMA(uartHandle, hdmatx, handle_GPDMA1_Channel0);
+
+  if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel0, DMA_CHANNEL_NPRIV) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  Set up the USART2 receive channel as a circular linked list
+  * @note   The HAL points the node at the buffer passed to HAL_UARTEx_ReceiveToIdle_DMA
+  * @param  uartHandle USART2 handle
+  * @retval None
+  */
+static void USART2_RxDMA_Init(UART_HandleTypeDef* uartHandle)
+{
+  DMA_NodeConfTypeDef NodeConfig = {0};
+
+  NodeConfig.NodeType = DMA_GPDMA_LINEAR_NODE;
+  NodeConfig.Init.Request = GPDMA1_REQUEST_USART2_RX;
+  NodeConfig.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+  NodeConfig.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  NodeConfig.Init.SrcInc = DMA_SINC_FIXED;
+  NodeConfig.Init.DestInc = DMA_DINC_INCREMENTED;
+  NodeConfig.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+  NodeConfig.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+  NodeConfig.Init.SrcBurstLength = 1;
+  NodeConfig.Init.DestBurstLength = 1;
+  NodeConfig.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0|DMA_DEST_ALLOCATED_PORT0;
+  NodeConfig.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  NodeConfig.Init.Mode = DMA_NORMAL;
+  NodeConfig.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+  NodeConfig.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+  NodeConfig.DataHandlingConfig.DataAlignment = DMA_DATA_RIGHTALIGN_ZEROPADDED;
+  if (HAL_DMAEx_List_BuildNode(&NodeConfig, &Node_GPDMA1_Channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_InsertNode(&List_GPDMA1_Channel1, NULL, &Node_GPDMA1_Channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_SetCircularMode(&List_GPDMA1_Channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  handle_GPDMA1_Channel1.Instance = GPDMA1_Channel1;
+  handle_GPDMA1_Channel1.InitLinkedList.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+  handle_GPDMA1_Channel1.InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+  handle_GPDMA1_Channel1.InitLinkedList.LinkAllocatedPort = DMA_LINK_ALLOCATED_PORT0;
+  handle_GPDMA1_Channel1.InitLinkedList.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  handle_GPDMA1_Channel1.InitLinkedList.LinkedListMode = DMA_LINKEDLIST_CIRCULAR;
+  if (HAL_DMAEx_List_Init(&handle_GPDMA1_Channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_LinkQ(&handle_GPDMA1_Channel1, &List_GPDMA1_Channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  __HAL_LINKDMA(uartHandle, hdmarx, handle_GPDMA1_Channel1);
+
+  if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel1, DMA_CHANNEL_NPRIV) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
 /* USER CODE END 0 */
 
 UART_HandleTypeDef huart2;
@@ -107,7 +208,17 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
   /* USER CODE BEGIN USART2_MspInit 1 */
+    /* USART2 DMA Init, interrupts at configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY for the kernel calls in callbacks */
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+    USART2_TxDMA_Init(uartHandle);
+    USART2_RxDMA_Init(uartHandle);
 
+    HAL_NVIC_SetPriority(GPDMA1_Channel0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel0_IRQn);
+    HAL_NVIC_SetPriority(GPDMA1_Channel1_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel1_IRQn);
+    HAL_NVIC_SetPriority(USART2_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
   /* USER CODE END USART2_MspInit 1 */
   }
 }
@@ -130,11 +241,152 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_2|GPIO_PIN_3);
 
   /* USER CODE BEGIN USART2_MspDeInit 1 */
-
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
+    HAL_DMA_DeInit(uartHandle->hdmatx);
+    HAL_DMA_DeInit(uartHandle->hdmarx);
   /* USER CODE END USART2_MspDeInit 1 */
   }
 }
 
 /* USER CODE BEGIN 1 */
+/* LPUART1 wakes the core from Stop 2 on its address. It runs on LSE so it keeps
+ * receiving in Stop 2, with RX on LPDMA1 channel 0 over a one-node circular list.
+ * LPDMA1 is outside the power manager's DMA clock, which the host link gates. */
+UART_HandleTypeDef hlpuart1;
+DMA_HandleTypeDef handle_LPDMA1_Channel0;
+static DMA_NodeTypeDef Node_LPDMA1_Channel0;
+static DMA_QListTypeDef List_LPDMA1_Channel0;
 
+/**
+  * @brief  Set up the LPUART1 receive channel as a circular linked list
+  * @note   The channel is not autonomous: in Stop 2 received bytes wait in the RX FIFO
+  *         until the wake-up interrupt has the core back in Sleep with the bus clocks on
+  * @param  uartHandle LPUART1 handle
+  * @retval None
+  */
+static void LPUART1_RxDMA_Init(UART_HandleTypeDef* uartHandle)
+{
+  DMA_NodeConfTypeDef NodeConfig = {0};
+
+  NodeConfig.NodeType = DMA_LPDMA_LINEAR_NODE;
+  NodeConfig.Init.Request = LPDMA1_REQUEST_LPUART1_RX;
+  NodeConfig.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+  NodeConfig.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  NodeConfig.Init.SrcInc = DMA_SINC_FIXED;
+  NodeConfig.Init.DestInc = DMA_DINC_INCREMENTED;
+  NodeConfig.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+  NodeConfig.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+  NodeConfig.Init.SrcBurstLength = 1;
+  NodeConfig.Init.DestBurstLength = 1;
+  NodeConfig.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0|DMA_DEST_ALLOCATED_PORT0;
+  NodeConfig.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  NodeConfig.Init.Mode = DMA_NORMAL;
+  NodeConfig.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+  NodeConfig.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+  NodeConfig.DataHandlingConfig.DataAlignment = DMA_DATA_RIGHTALIGN_ZEROPADDED;
+  if (HAL_DMAEx_List_BuildNode(&NodeConfig, &Node_LPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_InsertNode(&List_LPDMA1_Channel0, NULL, &Node_LPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_SetCircularMode(&List_LPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  handle_LPDMA1_Channel0.Instance = LPDMA1_Channel0;
+  handle_LPDMA1_Channel0.InitLinkedList.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+  handle_LPDMA1_Channel0.InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+  handle_LPDMA1_Channel0.InitLinkedList.LinkAllocatedPort = DMA_LINK_ALLOCATED_PORT0;
+  handle_LPDMA1_Channel0.InitLinkedList.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+  handle_LPDMA1_Channel0.InitLinkedList.LinkedListMode = DMA_LINKEDLIST_CIRCULAR;
+  if (HAL_DMAEx_List_Init(&handle_LPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_DMAEx_List_LinkQ(&handle_LPDMA1_Channel0, &List_LPDMA1_Channel0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  __HAL_LINKDMA(uartHandle, hdmarx, handle_LPDMA1_Channel0);
+
+  if (HAL_DMA_ConfigChannelAttributes(&handle_LPDMA1_Channel0, DMA_CHANNEL_NPRIV) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  LPUART1 init, 9600 baud on LSE, PG7 TX and PG8 RX on VDDIO2
+  * @note   LSE is started by WakeTimer_Init; the pins and clocks are set up here
+  *         since HAL_UART_MspInit only knows USART2
+  * @retval None
+  */
+void MX_LPUART1_UART_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_LPUART1;
+  PeriphClkInit.Lpuart1ClockSelection = RCC_LPUART1CLKSOURCE_LSE;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* Keep the kernel clock requested in Stop 2 for reception and the wake-up flag */
+  __HAL_RCC_LPUART1_CLK_ENABLE();
+  __HAL_RCC_LPUART1_CLKAM_ENABLE();
+
+  __HAL_RCC_GPIOG_CLK_ENABLE();
+  /**LPUART1 GPIO Configuration
+  PG7     ------> LPUART1_TX
+  PG8     ------> LPUART1_RX
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_7|GPIO_PIN_8;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Alternate = GPIO_AF8_LPUART1;
+  HAL_GPIO_Init(GPIOG, &GPIO_InitStruct);
+
+  __HAL_RCC_LPDMA1_CLK_ENABLE();
+  LPUART1_RxDMA_Init(&hlpuart1);
+
+  hlpuart1.Instance = LPUART1;
+  hlpuart1.Init.BaudRate = 9600;
+  hlpuart1.Init.WordLength = UART_WORDLENGTH_8B;
+  hlpuart1.Init.StopBits = UART_STOPBITS_1;
+  hlpuart1.Init.Parity = UART_PARITY_NONE;
+  hlpuart1.Init.Mode = UART_MODE_TX_RX;
+  hlpuart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  hlpuart1.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  hlpuart1.Init.ClockPrescaler = UART_PRESCALER_DIV1;
+  hlpuart1.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  hlpuart1.FifoMode = UART_FIFOMODE_ENABLE;
+  if (HAL_UART_Init(&hlpuart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_UARTEx_SetRxFifoThreshold(&hlpuart1, UART_RXFIFO_THRESHOLD_1_8) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_UARTEx_EnableFifoMode(&hlpuart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* The wake-up flag raises the interrupt that leads lpuart_wake into its wake-up callback */
+  __HAL_UART_ENABLE_IT(&hlpuart1, UART_IT_WUF);
+
+  HAL_NVIC_SetPriority(LPDMA1_Channel0_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(LPDMA1_Channel0_IRQn);
+  HAL_NVIC_SetPriority(LPUART1_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(LPUART1_IRQn);
+}
 /* USER CODE END 1 */
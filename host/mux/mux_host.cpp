@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file           : mux_host.cpp
+  * @brief          : Host side of the channel mux link
+  ******************************************************************************
+  */
+
+#include "mux_host.h"
+
+bool MuxHost::addChannel(uint8_t id, uint8_t priority, uint16_t window)
+{
+    if(started || config.size() >= MUX_MAX_CHANNELS)
+    {
+        return false;
+    }
+
+    MuxChannelConfig channel = {};
+    channel.id = id;
+    channel.priority = priority;
+    channel.txSize = window;
+    channel.rxSize = window;
+    config.push_back(channel);
+    return true;
+}
+
+bool MuxHost::start(uint16_t maxPayload)
+{
+    // Buffers are allocated once, ChannelMux keeps pointers into them
+    buffers.resize(config.size());
+    for(size_t i = 0; i < config.size(); i++)
+    {
+        buffers[i].tx.resize(config[i].txSize);
+        buffers[i].rx.resize(config[i].rxSize);
+        config[i].txBuffer = buffers[i].tx.data();
+        config[i].rxBuffer = buffers[i].rx.data();
+    }
+
+    started = mux.init(config.data(), config.size(), maxPayload);
+    return started;
+}
+
+size_t MuxHost::send(uint8_t channel, const uint8_t *data, size_t length)
+{
+    return started ? mux.write(channel, data, length) : 0;
+}
+
+void MuxHost::feed(const uint8_t *data, size_t length)
+{
+    if(!started)
+    {
+        return;
+    }
+
+    mux.receive(data, length);
+
+    // Hand everything over right away so the window reopens for the firmware
+    uint8_t chunk[512];
+    for(const MuxChannelConfig &channel : config)
+    {
+        size_t n;
+        while((n = mux.read(channel.id, chunk, sizeof(chunk))) > 0)
+        {
+            if(dataHandler)
+            {
+                dataHandler(channel.id, chunk, n);
+            }
+        }
+    }
+}
+
+size_t MuxHost::drain(std::vector<uint8_t> &out)
+{
+    if(!started)
+    {
+        return 0;
+    }
+
+    size_t total = 0;
+    uint8_t frame[MUX_FRAME_SIZE(MUX_MAX_PAYLOAD)];
+    size_t n;
+    while((n = mux.poll(frame, sizeof(frame))) > 0)
+    {
+        out.insert(out.end(), frame, frame + n);
+        total += n;
+    }
+    return total;
+}
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file           : mux_host.h
+  * @brief          : Host side of the channel mux link
+  ******************************************************************************
+  * Wraps ChannelMux with heap-allocated buffers and a data handler so host
+  * tools can split a serial stream into channels and send on any of them.
+  * The transport is left to the caller: feed() takes bytes read from the
+  * port, drain() returns the bytes to write to it.
+  ******************************************************************************
+  */
+
+#ifndef MUX_HOST_H
+#define MUX_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "channel_mux.h"
+
+class MuxHost
+{
+public:
+    using DataHandler = std::function<void(uint8_t channel, const uint8_t *data, size_t length)>;
+
+    /**
+     * @brief Declare a channel, must match the firmware table (id and priority)
+     * @param window Receive window advertised to the firmware, up to 32 KB
+     */
+    bool addChannel(uint8_t id, uint8_t priority, uint16_t window = 4096);
+
+    /**
+     * @brief Start the mux once all channels are declared
+     */
+    bool start(uint16_t maxPayload = MUX_DEFAULT_PAYLOAD);
+
+    void onData(DataHandler handler) { dataHandler = std::move(handler); }
+
+    /**
+     * @brief Queue data on a channel
+     * @retval Bytes accepted, the rest must be retried after drain()
+     */
+    size_t send(uint8_t channel, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Process bytes received from the link and dispatch channel data
+     */
+    void feed(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Collect every frame ready to be written to the link
+     * @retval Number of bytes appended to out
+     */
+    size_t drain(std::vector<uint8_t> &out);
+
+    void refreshCredits() { mux.refreshCredits(); }
+
+    const MuxChannelStats *stats(uint8_t channel) const { return mux.stats(channel); }
+    const FrameDecoderStats &linkStats() const { return mux.linkStats(); }
+
+private:
+    struct Buffers
+    {
+        std::vector<uint8_t> tx;
+        std::vector<uint8_t> rx;
+    };
+
+    std::vector<MuxChannelConfig> config;
+    std::vector<Buffers> buffers;
+    ChannelMux mux;
+    DataHandler dataHandler;
+    bool started = false;
+};
+
+#endif /* MUX_HOST_H */
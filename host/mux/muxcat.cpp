@@ -0,0 +1,438 @@
+/**
+  ******************************************************************************
+  * @file           : muxcat.cpp
+  * @brief          : Serial console for the channel mux link
+  ******************************************************************************
+  * usage: muxcat <device> [-b baud] [-c id:priority[:name]]... [-i id]
+  *
+  * Prints every channel line by line with its name as prefix and sends
+  * stdin on the input channel (the shell by default). A channel named
+  * telemetry carries CBOR items, printed in diagnostic notation. Without -c
+  * the firmware's table (link_mux.h) is used: 1 alarm, 2 shell,
+  * 3 telemetry, 5 log.
+  ******************************************************************************
+  */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cbor.h"
+#include "mux_host.h"
+
+namespace {
+
+constexpr size_t CBOR_PENDING_MAX = 4096;     // An item still incomplete past this is taken as garbage
+
+struct ChannelInfo
+{
+    uint8_t priority;
+    std::string name;
+    std::string line;
+    std::vector<uint8_t> pending = {};  // CBOR bytes short of a whole item
+};
+
+bool printCbor(CborReader &reader, const CborItem &item, std::string &out, unsigned depth);
+
+/**
+ * @brief Print the entries of a container, count items or up to a break when indefinite
+ */
+bool printEntries(CborReader &reader, const CborItem &container, size_t count, std::string &out, unsigned depth)
+{
+    for(size_t i = 0; container.indefinite || i < count; i++)
+    {
+        CborItem item;
+        if(!reader.next(item))
+        {
+            return false;
+        }
+        if(item.type == CBOR_BREAK)
+        {
+            return container.indefinite;
+        }
+        if(i > 0)
+        {
+            out += container.type == CBOR_MAP ? (i % 2U == 0 ? ", " : ": ") : ", ";
+        }
+        if(!printCbor(reader, item, out, depth + 1U))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Append an item, with everything nested in it, in RFC 8949 diagnostic notation
+ */
+bool printCbor(CborReader &reader, const CborItem &item, std::string &out, unsigned depth)
+{
+    if(depth > CBOR_MAX_DEPTH)
+    {
+        return false;
+    }
+
+    char text[32];
+    switch(item.type)
+    {
+    case CBOR_UNSIGNED:
+        snprintf(text, sizeof(text), "%llu", (unsigned long long)item.value);
+        out += text;
+        return true;
+    case CBOR_NEGATIVE:
+        snprintf(text, sizeof(text), "-%llu", (unsigned long long)item.value + 1ULL);
+        out += text;
+        return true;
+    case CBOR_TEXT:
+        if(item.indefinite)
+        {
+            return false;
+        }
+        out += '"';
+        out.append((const char *)item.data, (size_t)item.value);
+        out += '"';
+        return true;
+    case CBOR_BYTES:
+        if(item.indefinite)
+        {
+            return false;
+        }
+        out += "h'";
+        for(uint64_t i = 0; i < item.value; i++)
+        {
+            snprintf(text, sizeof(text), "%02x", item.data[i]);
+            out += text;
+        }
+        out += '\'';
+        return true;
+    case CBOR_ARRAY:
+        out += '[';
+        if(!printEntries(reader, item, (size_t)item.value, out, depth))
+        {
+            return false;
+        }
+        out += ']';
+        return true;
+    case CBOR_MAP:
+        out += '{';
+        if(!printEntries(reader, item, (size_t)item.value * 2U, out, depth))
+        {
+            return false;
+        }
+        out += '}';
+        return true;
+    case CBOR_TAG:
+    {
+        snprintf(text, sizeof(text), "%llu(", (unsigned long long)item.value);
+        out += text;
+        CborItem tagged;
+        if(!reader.next(tagged) || !printCbor(reader, tagged, out, depth + 1U))
+        {
+            return false;
+        }
+        out += ')';
+        return true;
+    }
+    case CBOR_SIMPLE:
+        snprintf(text, sizeof(text), "simple(%llu)", (unsigned long long)item.value);
+        out += text;
+        return true;
+    case CBOR_FALSE:     out += "false"; return true;
+    case CBOR_TRUE:      out += "true"; return true;
+    case CBOR_NULL:      out += "null"; return true;
+    case CBOR_UNDEFINED: out += "undefined"; return true;
+    case CBOR_FLOAT:
+        snprintf(text, sizeof(text), "%g", item.number);
+        out += text;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Print every whole CBOR item received on a channel, keep the rest for later
+ */
+void printCborItems(ChannelInfo &info, const uint8_t *data, size_t length)
+{
+    info.pending.insert(info.pending.end(), data, data + length);
+
+    for(;;)
+    {
+        // skip() fails on a truncated item as well as a malformed one, more data tells them apart
+        CborReader scan(info.pending.data(), info.pending.size());
+        if(!scan.skip())
+        {
+            if(info.pending.size() > CBOR_PENDING_MAX)
+            {
+                printf("[%s] undecodable, %zu bytes dropped\n", info.name.c_str(), info.pending.size());
+                info.pending.clear();
+            }
+            return;
+        }
+
+        size_t size = scan.offset();
+        CborReader reader(info.pending.data(), size);
+        CborItem item;
+        std::string text;
+        if(reader.next(item) && printCbor(reader, item, text, 0))
+        {
+            printf("[%s] %s\n", info.name.c_str(), text.c_str());
+        }
+        info.pending.erase(info.pending.begin(), info.pending.begin() + (std::ptrdiff_t)size);
+    }
+}
+
+speed_t toSpeed(long baud)
+{
+    switch(baud)
+    {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      return B0;
+    }
+}
+
+int openSerial(const char *path, long baud)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(fd < 0)
+    {
+        fprintf(stderr, "muxcat: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0)
+    {
+        speed_t speed = toSpeed(baud);
+        if(speed == B0)
+        {
+            fprintf(stderr, "muxcat: unsupported baud rate %ld\n", baud);
+            close(fd);
+            return -1;
+        }
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    // Not a tty (a FIFO or a simulator socket) is fine, bytes are passed as is
+    return fd;
+}
+
+bool parseChannel(const char *arg, uint8_t &id, ChannelInfo &info)
+{
+    char name[64] = {0};
+    unsigned int channel = 0;
+    unsigned int priority = 0;
+    int fields = sscanf(arg, "%u:%u:%63s", &channel, &priority, name);
+    if(fields < 2 || channel == 0 || channel > 255 || priority > 255)
+    {
+        return false;
+    }
+
+    id = (uint8_t)channel;
+    info.priority = (uint8_t)priority;
+    info.name = fields == 3 ? name : "ch" + std::to_string(channel);
+    return true;
+}
+
+bool writeAll(int fd, const std::vector<uint8_t> &data)
+{
+    size_t done = 0;
+    while(done < data.size())
+    {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if(n < 0)
+        {
+            if(errno == EAGAIN)
+            {
+                usleep(1000);
+                continue;
+            }
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: muxcat <device> [-b baud] [-c id:priority[:name]]... [-i id]\n");
+        return 2;
+    }
+
+    const char *device = argv[1];
+    long baud = 115200;
+    uint8_t inputChannel = 2;
+    std::map<uint8_t, ChannelInfo> channels;
+
+    for(int i = 2; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            baud = strtol(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            inputChannel = (uint8_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            uint8_t id;
+            ChannelInfo info;
+            if(!parseChannel(argv[++i], id, info))
+            {
+                fprintf(stderr, "muxcat: bad channel '%s'\n", argv[i]);
+                return 2;
+            }
+            channels[id] = info;
+        }
+        else
+        {
+            fprintf(stderr, "muxcat: unknown option '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if(channels.empty())
+    {
+        channels[1] = {0, "alarm", ""};
+        channels[2] = {1, "shell", ""};
+        channels[3] = {2, "telemetry", ""};
+        channels[5] = {3, "log", ""};
+    }
+
+    MuxHost host;
+    for(const auto &entry : channels)
+    {
+        if(!host.addChannel(entry.first, entry.second.priority))
+        {
+            fprintf(stderr, "muxcat: too many channels\n");
+            return 2;
+        }
+    }
+    if(!host.start())
+    {
+        fprintf(stderr, "muxcat: invalid channel table\n");
+        return 2;
+    }
+
+    host.onData([&channels](uint8_t channel, const uint8_t *data, size_t length) {
+        ChannelInfo &info = channels[channel];
+        if(info.name == "telemetry")
+        {
+            printCborItems(info, data, length);
+            fflush(stdout);
+            return;
+        }
+        for(size_t i = 0; i < length; i++)
+        {
+            if(data[i] == '\n')
+            {
+                printf("[%s] %s\n", info.name.c_str(), info.line.c_str());
+                info.line.clear();
+            }
+            else if(data[i] != '\r')
+            {
+                info.line.push_back((char)data[i]);
+            }
+        }
+        fflush(stdout);
+    });
+
+    int fd = openSerial(device, baud);
+    if(fd < 0)
+    {
+        return 1;
+    }
+
+    struct pollfd fds[2] = {
+        { fd, POLLIN, 0 },
+        { STDIN_FILENO, POLLIN, 0 },
+    };
+    std::string input;
+    time_t lastRefresh = time(nullptr);
+
+    for(;;)
+    {
+        std::vector<uint8_t> out;
+        if(host.drain(out) > 0 && !writeAll(fd, out))
+        {
+            fprintf(stderr, "muxcat: write failed: %s\n", strerror(errno));
+            break;
+        }
+
+        if(poll(fds, 2, 50) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        if(fds[0].revents & POLLIN)
+        {
+            uint8_t buf[1024];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if(n > 0)
+            {
+                host.feed(buf, (size_t)n);
+            }
+        }
+        if(fds[0].revents & (POLLHUP | POLLERR))
+        {
+            fprintf(stderr, "muxcat: device closed\n");
+            break;
+        }
+
+        if(fds[1].revents & POLLIN)
+        {
+            char buf[256];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if(n <= 0)
+            {
+                fds[1].fd = -1;
+            }
+            else
+            {
+                input.append(buf, (size_t)n);
+            }
+        }
+        if(!input.empty())
+        {
+            size_t sent = host.send(inputChannel, (const uint8_t *)input.data(), input.size());
+            input.erase(0, sent);
+        }
+
+        // Lost credit frames are repaired by periodic re-advertising
+        time_t now = time(nullptr);
+        if(now != lastRefresh)
+        {
+            host.refreshCredits();
+            lastRefresh = now;
+        }
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,547 @@
+/**
+  ******************************************************************************
+  * @file           : model_converter.cpp
+  * @brief          : Float models to int8 headers for nn_model.h
+  ******************************************************************************
+  */
+
+#include "model_converter.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+namespace {
+
+struct Token
+{
+    std::string text;
+    unsigned line;
+};
+
+std::vector<Token> tokenize(const std::string &text)
+{
+    std::vector<Token> tokens;
+    unsigned line = 1;
+    size_t i = 0;
+    while(i < text.size())
+    {
+        char c = text[i];
+        if(c == '\n')
+        {
+            line++;
+            i++;
+        }
+        else if(c == '#')
+        {
+            while(i < text.size() && text[i] != '\n')
+            {
+                i++;
+            }
+        }
+        else if(isspace((unsigned char)c) || c == ',')
+        {
+            i++;
+        }
+        else
+        {
+            size_t start = i;
+            while(i < text.size() && !isspace((unsigned char)text[i]) && text[i] != ',' && text[i] != '#')
+            {
+                i++;
+            }
+            tokens.push_back(Token{text.substr(start, i - start), line});
+        }
+    }
+    return tokens;
+}
+
+class Reader
+{
+public:
+    explicit Reader(const std::string &text) : tokens(tokenize(text)) {}
+
+    bool done() const { return next >= tokens.size(); }
+    unsigned line() const { return tokens.empty() ? 1U : tokens[std::min(next, tokens.size() - 1U)].line; }
+
+    bool word(std::string &out)
+    {
+        if(done())
+        {
+            return false;
+        }
+        out = tokens[next++].text;
+        return true;
+    }
+
+    bool number(double &out)
+    {
+        if(done())
+        {
+            return false;
+        }
+        const std::string &text = tokens[next].text;
+        char *end = nullptr;
+        out = strtod(text.c_str(), &end);
+        if(end == text.c_str() || *end != '\0' || !std::isfinite(out))
+        {
+            return false;
+        }
+        next++;
+        return true;
+    }
+
+    bool count(uint32_t max, uint32_t &out)
+    {
+        double v = 0.0;
+        if(!number(v) || v < 1.0 || v > (double)max || v != floor(v))
+        {
+            return false;
+        }
+        out = (uint32_t)v;
+        return true;
+    }
+
+private:
+    std::vector<Token> tokens;
+    size_t next = 0;
+};
+
+std::string at(unsigned line, const std::string &what)
+{
+    return "line " + std::to_string(line) + ": " + what;
+}
+
+const char *opName(NnOp op)
+{
+    switch(op)
+    {
+        case NN_OP_DENSE:               return "dense";
+        case NN_OP_CONV1D:              return "conv1d";
+        case NN_OP_DEPTHWISE_CONV1D:    return "depthwise";
+        case NN_OP_MAX_POOL1D:          return "maxpool";
+        case NN_OP_AVG_POOL1D:          return "avgpool";
+    }
+    return "?";
+}
+
+const char *opConstant(NnOp op)
+{
+    switch(op)
+    {
+        case NN_OP_DENSE:               return "NN_OP_DENSE";
+        case NN_OP_CONV1D:              return "NN_OP_CONV1D";
+        case NN_OP_DEPTHWISE_CONV1D:    return "NN_OP_DEPTHWISE_CONV1D";
+        case NN_OP_MAX_POOL1D:          return "NN_OP_MAX_POOL1D";
+        case NN_OP_AVG_POOL1D:          return "NN_OP_AVG_POOL1D";
+    }
+    return "?";
+}
+
+bool isPool(NnOp op)
+{
+    return op == NN_OP_MAX_POOL1D || op == NN_OP_AVG_POOL1D;
+}
+
+template<typename T>
+void writeArray(FILE *out, const char *type, const char *name, size_t layer, const std::vector<T> &values)
+{
+    fprintf(out, "constexpr %s L%zu_%s[] = {", type, layer, name);
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        fprintf(out, "%s%ld,", i % 16U == 0 ? "\n    " : " ", (long)values[i]);
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+size_t argMax(const float *values, size_t count)
+{
+    size_t best = 0;
+    for(size_t i = 1; i < count; i++)
+    {
+        best = values[i] > values[best] ? i : best;
+    }
+    return best;
+}
+
+} // namespace
+
+bool ModelConverter::parse(const std::string &text, std::string &error)
+{
+    layers.clear();
+    Reader reader(text);
+    std::string keyword;
+    uint32_t length = 0;
+    uint32_t channels = 0;
+
+    if(!reader.word(keyword) || keyword != "input" || !reader.count(UINT16_MAX, length) || !reader.count(UINT16_MAX, channels))
+    {
+        error = at(reader.line(), "expected 'input <length> <channels>'");
+        return false;
+    }
+
+    while(reader.word(keyword))
+    {
+        unsigned line = reader.line();
+        NnFloatLayer shape = {};
+        shape.length = (uint16_t)length;
+        shape.channels = (uint16_t)channels;
+        shape.outChannels = (uint16_t)channels;
+        shape.kernel = 1;
+        shape.stride = 1;
+
+        uint32_t a = 1;
+        uint32_t b = 1;
+        uint32_t c = 1;
+        bool activation = true;
+        if(keyword == "conv1d")
+        {
+            shape.op = NN_OP_CONV1D;
+            if(!reader.count(UINT16_MAX, a) || !reader.count(UINT8_MAX, b) || !reader.count(UINT8_MAX, c))
+            {
+                error = at(line, "expected 'conv1d <filters> <kernel> <stride> relu|linear'");
+                return false;
+            }
+            shape.outChannels = (uint16_t)a;
+            shape.kernel = (uint8_t)b;
+            shape.stride = (uint8_t)c;
+        }
+        else if(keyword == "depthwise")
+        {
+            shape.op = NN_OP_DEPTHWISE_CONV1D;
+            if(!reader.count(UINT8_MAX, b) || !reader.count(UINT8_MAX, c))
+            {
+                error = at(line, "expected 'depthwise <kernel> <stride> relu|linear'");
+                return false;
+            }
+            shape.kernel = (uint8_t)b;
+            shape.stride = (uint8_t)c;
+        }
+        else if(keyword == "dense")
+        {
+            shape.op = NN_OP_DENSE;
+            if(!reader.count(UINT16_MAX, a))
+            {
+                error = at(line, "expected 'dense <outputs> relu|linear'");
+                return false;
+            }
+            shape.outChannels = (uint16_t)a;
+        }
+        else if(keyword == "maxpool" || keyword == "avgpool")
+        {
+            shape.op = keyword == "maxpool" ? NN_OP_MAX_POOL1D : NN_OP_AVG_POOL1D;
+            activation = false;
+            if(!reader.count(UINT8_MAX, b) || !reader.count(UINT8_MAX, c))
+            {
+                error = at(line, "expected '" + keyword + " <width> <stride>'");
+                return false;
+            }
+            shape.kernel = (uint8_t)b;
+            shape.stride = (uint8_t)c;
+        }
+        else
+        {
+            error = at(line, "unknown layer '" + keyword + "'");
+            return false;
+        }
+
+        if(activation)
+        {
+            std::string name;
+            if(!reader.word(name) || (name != "relu" && name != "linear"))
+            {
+                error = at(line, "expected relu or linear after " + keyword);
+                return false;
+            }
+            shape.relu = name == "relu";
+        }
+        if(nnOutputSize(shape) == 0)
+        {
+            error = at(line, keyword + " is wider than its " + std::to_string(length) + " input positions");
+            return false;
+        }
+
+        Layer layer = {};
+        layer.shape = shape;
+        layer.weights.resize(nnWeightCount(shape));
+        layer.bias.resize(nnBiasCount(shape));
+        for(std::vector<float> *values : {&layer.weights, &layer.bias})
+        {
+            for(float &v : *values)
+            {
+                double d = 0.0;
+                if(!reader.number(d))
+                {
+                    error = at(reader.line(), keyword + " needs " + std::to_string(layer.weights.size()) + " weights and "
+                               + std::to_string(layer.bias.size()) + " biases");
+                    return false;
+                }
+                v = (float)d;
+            }
+        }
+        layers.push_back(layer);
+
+        length = (uint32_t)nnOutLength(shape);
+        channels = shape.outChannels;
+    }
+
+    if(layers.empty())
+    {
+        error = "the model has no layers";
+        return false;
+    }
+    for(Layer &layer : layers)
+    {
+        layer.shape.weights = layer.weights.data();
+        layer.shape.bias = layer.bias.data();
+    }
+    return true;
+}
+
+bool ModelConverter::parseCalibration(const std::string &text, std::string &error)
+{
+    frames.clear();
+    size_t size = inputSize();
+    size_t start = 0;
+    unsigned line = 0;
+    while(start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        end = end == std::string::npos ? text.size() : end;
+        line++;
+
+        Reader reader(text.substr(start, end - start));
+        start = end + 1U;
+        if(reader.done())
+        {
+            continue;
+        }
+
+        std::vector<float> frame;
+        double v = 0.0;
+        while(reader.number(v))
+        {
+            frame.push_back((float)v);
+        }
+        if(!reader.done() || frame.size() != size)
+        {
+            error = at(line, "expected " + std::to_string(size) + " numbers");
+            return false;
+        }
+        frames.push_back(frame);
+    }
+
+    if(frames.empty())
+    {
+        error = "no calibration frames";
+        return false;
+    }
+    return true;
+}
+
+bool ModelConverter::quantise(std::string &error)
+{
+    if(layers.empty() || frames.empty())
+    {
+        error = "nothing to quantise";
+        return false;
+    }
+
+    std::vector<NnFloatLayer> shapes;
+    for(const Layer &layer : layers)
+    {
+        shapes.push_back(layer.shape);
+    }
+    std::vector<NnRange> ranges(layers.size() + 1U, NnRange{0.0f, 0.0f});
+    std::vector<float> scratch(2U * nnLargestTensor(shapes.data(), shapes.size()));
+    for(const std::vector<float> &frame : frames)
+    {
+        nnReferenceInvoke(shapes.data(), shapes.size(), frame.data(), scratch.data(), ranges.data());
+    }
+
+    inputQuant = nnChooseQuant(ranges[0].min, ranges[0].max);
+    NnTensorQuant in = inputQuant;
+    table.clear();
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        Layer &layer = layers[i];
+        layer.outQuant = isPool(layer.shape.op) ? in : nnChooseQuant(ranges[i + 1U].min, ranges[i + 1U].max);
+        layer.qWeights.resize(layer.weights.size());
+        layer.qBias.resize(layer.bias.size());
+        layer.multiplier.resize(layer.bias.size());
+        layer.shift.resize(layer.bias.size());
+        if(!nnQuantizeLayer(layer.shape, in, layer.outQuant, layer.qWeights.data(), layer.qBias.data(),
+                            layer.multiplier.data(), layer.shift.data(), layer.quantised))
+        {
+            error = "layer " + std::to_string(i) + " cannot be quantised";
+            return false;
+        }
+        table.push_back(layer.quantised);
+        in = layer.outQuant;
+    }
+
+    if(!nnChainValid(table.data(), table.size()))
+    {
+        error = "the layer shapes do not chain";
+        return false;
+    }
+    offsets.resize(table.size() + 1U);
+    uint32_t arena = nnPlanOffsets(table.data(), table.size(), offsets.data());
+    model = NnModel{table.data(), table.size(), offsets.data(), arena,
+                    inputQuant.scale, inputQuant.zero, in.scale, in.zero};
+    measure();
+    return true;
+}
+
+void ModelConverter::measure()
+{
+    std::vector<uint8_t> arena(model.arenaSize);
+    agreeing = 0;
+    for(Layer &layer : layers)
+    {
+        layer.worstSteps = 0.0;
+    }
+
+    for(const std::vector<float> &frame : frames)
+    {
+        // Layer by layer, each int8 layer fed the int8 output of the one before: the error accumulates
+        std::vector<float> reference = frame;
+        std::vector<int8_t> quantised(frame.size());
+        for(size_t i = 0; i < frame.size(); i++)
+        {
+            quantised[i] = nnQuantize(frame[i], inputQuant.scale, inputQuant.zero);
+        }
+
+        for(size_t l = 0; l < layers.size(); l++)
+        {
+            Layer &layer = layers[l];
+            size_t outputs = nnOutputSize(layer.shape);
+            std::vector<float> next(outputs);
+            nnReferenceLayer(layer.shape, reference.data(), next.data());
+
+            uint32_t single[2] = {0, (nnInputBytes(layer.quantised) + NN_ARENA_ALIGN - 1U) & ~(NN_ARENA_ALIGN - 1U)};
+            std::vector<uint8_t> scratch(single[1] + outputs);
+            NnModel one = {&layer.quantised, 1, single, (uint32_t)scratch.size(), 1.0f, 0, 1.0f, 0};
+            std::copy(quantised.begin(), quantised.end(), nnInput(one, scratch.data()));
+            nnInvoke(one, scratch.data());
+            const int8_t *out = nnOutput(one, scratch.data());
+
+            float lowest = nnDequantize(INT8_MIN, layer.outQuant.scale, layer.outQuant.zero);
+            float highest = nnDequantize(INT8_MAX, layer.outQuant.scale, layer.outQuant.zero);
+            for(size_t o = 0; o < outputs; o++)
+            {
+                float clamped = std::min(std::max(next[o], lowest), highest);
+                double steps = fabs(nnDequantize(out[o], layer.outQuant.scale, layer.outQuant.zero) - clamped) / layer.outQuant.scale;
+                layer.worstSteps = std::max(layer.worstSteps, steps);
+            }
+            quantised.assign(out, out + outputs);
+            reference.swap(next);
+        }
+
+        // The whole model through the planned arena, as on the device
+        int8_t *in = nnInput(model, arena.data());
+        for(size_t i = 0; i < frame.size(); i++)
+        {
+            in[i] = nnQuantize(frame[i], inputQuant.scale, inputQuant.zero);
+        }
+        nnInvoke(model, arena.data());
+        agreeing += nnArgMax(model, arena.data()) == argMax(reference.data(), reference.size()) ? 1U : 0U;
+    }
+}
+
+void ModelConverter::writeHeader(FILE *out, const std::string &name, const std::string &source) const
+{
+    std::string guard;
+    for(char c : name)
+    {
+        guard += (char)toupper((unsigned char)c);
+    }
+    guard += "_H";
+
+    fprintf(out, "/**\n");
+    fprintf(out, "  ******************************************************************************\n");
+    fprintf(out, "  * @file           : %s.h\n", name.c_str());
+    fprintf(out, "  * @brief          : int8 model generated by nnconvert from %s, do not edit\n", source.c_str());
+    fprintf(out, "  ******************************************************************************\n");
+    fprintf(out, "  * Input %u x %u, scale %.9g, zero point %d. Calibrated on %zu frames.\n",
+            (unsigned)layers[0].shape.length, (unsigned)layers[0].shape.channels,
+            (double)model.inputScale, (int)model.inputZero, frames.size());
+    fprintf(out, "  *\n");
+    fprintf(out, "  *   alignas(NN_ARENA_ALIGN) static uint8_t arena[%s::PLAN.size];\n", name.c_str());
+    fprintf(out, "  ******************************************************************************\n");
+    fprintf(out, "  */\n\n");
+    fprintf(out, "#ifndef %s\n#define %s\n\n#include \"nn_model.h\"\n\nnamespace %s {\n\n", guard.c_str(), guard.c_str(), name.c_str());
+
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        const Layer &layer = layers[i];
+        if(isPool(layer.shape.op))
+        {
+            continue;
+        }
+        writeArray(out, "int8_t", "WEIGHTS", i, layer.qWeights);
+        writeArray(out, "int32_t", "BIAS", i, layer.qBias);
+        writeArray(out, "int32_t", "MULTIPLIER", i, layer.multiplier);
+        writeArray(out, "int8_t", "SHIFT", i, layer.shift);
+    }
+
+    fprintf(out, "constexpr NnLayer LAYERS[] = {\n");
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        const NnLayer &q = layers[i].quantised;
+        fprintf(out, "    {%s, %u, %u, %u, %u, %u, ", opConstant(q.op), (unsigned)q.length, (unsigned)q.channels,
+                (unsigned)q.outChannels, (unsigned)q.kernel, (unsigned)q.stride);
+        if(isPool(q.op))
+        {
+            fprintf(out, "nullptr, nullptr, {nullptr, nullptr, 0, INT8_MIN, INT8_MAX}},\n");
+        }
+        else
+        {
+            fprintf(out, "L%zu_WEIGHTS, L%zu_BIAS, {L%zu_MULTIPLIER, L%zu_SHIFT, %d, %d, %d}},\n",
+                    i, i, i, i, (int)q.requant.outZero, (int)q.requant.min, (int)q.requant.max);
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    size_t count = layers.size();
+    fprintf(out, "static_assert(nnChainValid(LAYERS, %zu), \"layer shapes must chain\");\n\n", count);
+    fprintf(out, "constexpr NnArenaPlan<%zu> PLAN = nnPlanArena(LAYERS);\n\n", count);
+    fprintf(out, "constexpr NnModel MODEL = {LAYERS, %zu, PLAN.offset, PLAN.size, %.9gf, %d, %.9gf, %d};\n\n",
+            count, (double)model.inputScale, (int)model.inputZero, (double)model.outputScale, (int)model.outputZero);
+    fprintf(out, "constexpr size_t INPUT_SIZE = %zu;\n", inputSize());
+    fprintf(out, "constexpr size_t OUTPUTS = %zu;\n\n", nnOutputSize(layers.back().shape));
+    fprintf(out, "} // namespace %s\n\n#endif /* %s */\n", name.c_str(), guard.c_str());
+}
+
+void ModelConverter::printSummary(FILE *out) const
+{
+    fprintf(out, "layer  op          input      output     flash   scale       zero  worst steps\n");
+    size_t flash = 0;
+    size_t floatBytes = 0;
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        const Layer &layer = layers[i];
+        size_t bytes = layer.qWeights.size() + layer.qBias.size() * (2U * sizeof(int32_t) + 1U);
+        flash += bytes;
+        floatBytes += (layer.weights.size() + layer.bias.size()) * sizeof(float);
+
+        char input[24];
+        char output[24];
+        snprintf(input, sizeof(input), "%ux%u", (unsigned)layer.shape.length, (unsigned)layer.shape.channels);
+        snprintf(output, sizeof(output), "%zux%u", nnOutLength(layer.shape), (unsigned)layer.shape.outChannels);
+        fprintf(out, "%-6zu %-11s %-10s %-10s %-7zu %-11.4g %-5d %.2f\n", i, opName(layer.shape.op), input, output,
+                bytes, (double)layer.outQuant.scale, (int)layer.outQuant.zero, layer.worstSteps);
+    }
+
+    std::vector<NnFloatLayer> shapes;
+    for(const Layer &layer : layers)
+    {
+        shapes.push_back(layer.shape);
+    }
+    size_t floatArena = (inputSize() + 2U * nnLargestTensor(shapes.data(), shapes.size())) * sizeof(float);
+    fprintf(out, "flash %zu bytes (float %zu), arena %u bytes (float %zu)\n", flash, floatBytes, (unsigned)model.arenaSize, floatArena);
+    fprintf(out, "%zu calibration frames, %zu classified as in float (%.1f%%)\n", frames.size(), agreeing,
+            frames.empty() ? 0.0 : 100.0 * (double)agreeing / (double)frames.size());
+}
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file           : model_converter.h
+  * @brief          : Float models to int8 headers for nn_model.h
+  ******************************************************************************
+  * A model is a text file of layers, each followed by its float weights
+  * and biases in the layouts of nn_kernels.h; '#' starts a comment:
+  *
+  *   input <length> <channels>
+  *   conv1d <filters> <kernel> <stride> relu|linear   weights, biases
+  *   depthwise <kernel> <stride> relu|linear          weights, biases
+  *   dense <outputs> relu|linear                      weights, biases
+  *   maxpool <width> <stride>
+  *   avgpool <width> <stride>
+  *
+  * Activation ranges come from running the float model over calibration
+  * frames, one per line in the input layout, which should be real sensor
+  * data: anything outside the ranges they produce saturates on the device.
+  * The converter quantises with nn_quantizer.h, runs the int8 model over
+  * the same frames to report how far it strays from the float one, and
+  * writes a header of constant arrays with the layer table, the arena plan
+  * and the model descriptor.
+  ******************************************************************************
+  */
+
+#ifndef MODEL_CONVERTER_H
+#define MODEL_CONVERTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "nn_model.h"
+#include "nn_quantizer.h"
+#include "nn_reference.h"
+
+class ModelConverter
+{
+public:
+    /**
+     * @brief Read a model description
+     * @param error Set to the line and reason when the description is rejected
+     */
+    bool parse(const std::string &text, std::string &error);
+
+    /**
+     * @brief Read calibration frames, one per line
+     */
+    bool parseCalibration(const std::string &text, std::string &error);
+
+    /**
+     * @brief Quantise with the ranges of the calibration frames
+     */
+    bool quantise(std::string &error);
+
+    /**
+     * @brief Header defining namespace name with LAYERS, PLAN and MODEL
+     * @param source Model file named in the banner
+     */
+    void writeHeader(FILE *out, const std::string &name, const std::string &source) const;
+
+    /**
+     * @brief Shapes, memory and the int8 error against float per layer
+     */
+    void printSummary(FILE *out) const;
+
+    size_t inputSize() const { return layers.empty() ? 0U : (size_t)layers[0].shape.length * layers[0].shape.channels; }
+    uint32_t arenaSize() const { return model.arenaSize; }
+
+private:
+    struct Layer
+    {
+        NnFloatLayer shape;
+        std::vector<float> weights;
+        std::vector<float> bias;
+
+        std::vector<int8_t> qWeights;
+        std::vector<int32_t> qBias;
+        std::vector<int32_t> multiplier;
+        std::vector<int8_t> shift;
+        NnLayer quantised;
+        NnTensorQuant outQuant;
+        double worstSteps;              // Largest error of its output over the calibration frames
+    };
+
+    void measure();
+
+    std::vector<Layer> layers;
+    std::vector<std::vector<float>> frames;
+    NnTensorQuant inputQuant = {1.0f, 0};
+    std::vector<NnLayer> table;
+    std::vector<uint32_t> offsets;
+    NnModel model = {};
+    size_t agreeing = 0;                // Frames classified the same as in float
+};
+
+#endif /* MODEL_CONVERTER_H */
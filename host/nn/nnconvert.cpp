@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file           : nnconvert.cpp
+  * @brief          : Float model to an int8 model header for the firmware
+  ******************************************************************************
+  * usage: nnconvert <model> <calibration> [-n name] [-o header]
+  *
+  * Quantises the model described in <model> (see model_converter.h) over
+  * the frames in <calibration>, prints the per-layer summary and writes the
+  * header to -o, or to stdout with the summary going to stderr. The name
+  * is the namespace of the generated arrays, "model" by default.
+  ******************************************************************************
+  */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "model_converter.h"
+
+namespace {
+
+bool readFile(const char *path, std::string &text)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "nnconvert: cannot open %s\n", path);
+        return false;
+    }
+
+    char chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        text.append(chunk, n);
+    }
+    fclose(file);
+    return true;
+}
+
+bool validName(const std::string &name)
+{
+    if(name.empty() || isdigit((unsigned char)name[0]))
+    {
+        return false;
+    }
+    for(char c : name)
+    {
+        if(!isalnum((unsigned char)c) && c != '_')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 3)
+    {
+        fprintf(stderr, "usage: nnconvert <model> <calibration> [-n name] [-o header]\n");
+        return 2;
+    }
+
+    std::string name = "model";
+    const char *outPath = nullptr;
+    for(int i = 3; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "nnconvert: unknown option '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+    if(!validName(name))
+    {
+        fprintf(stderr, "nnconvert: '%s' is not a C++ identifier\n", name.c_str());
+        return 2;
+    }
+
+    std::string modelText;
+    std::string calibrationText;
+    if(!readFile(argv[1], modelText) || !readFile(argv[2], calibrationText))
+    {
+        return 1;
+    }
+
+    ModelConverter converter;
+    std::string error;
+    if(!converter.parse(modelText, error))
+    {
+        fprintf(stderr, "nnconvert: %s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+    if(!converter.parseCalibration(calibrationText, error))
+    {
+        fprintf(stderr, "nnconvert: %s: %s\n", argv[2], error.c_str());
+        return 1;
+    }
+    if(!converter.quantise(error))
+    {
+        fprintf(stderr, "nnconvert: %s\n", error.c_str());
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if(outPath != nullptr)
+    {
+        out = fopen(outPath, "w");
+        if(out == nullptr)
+        {
+            fprintf(stderr, "nnconvert: cannot write %s\n", outPath);
+            return 1;
+        }
+    }
+
+    const char *source = strrchr(argv[1], '/');
+    converter.writeHeader(out, name, source != nullptr ? source + 1 : argv[1]);
+    converter.printSummary(out == stdout ? stderr : stdout);
+    if(out != stdout && fclose(out) != 0)
+    {
+        fprintf(stderr, "nnconvert: cannot write %s\n", outPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file           : fleet.cpp
+  * @brief          : Many firmware nodes on shared buses, stepped in parallel
+  ******************************************************************************
+  */
+
+#include "fleet.h"
+
+#include <dlfcn.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t UART_BITS_PER_BYTE = 10;     // 8N1
+constexpr uint32_t SMBUS_BITS_PER_BYTE = 9;     // With the acknowledge
+constexpr uint32_t SMBUS_OVERHEAD_BITS = 11;    // Start, address byte with acknowledge, stop
+constexpr size_t LOG_CHUNK = 1024;
+
+bool readImage(const std::string &path, std::vector<uint8_t> &image)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if(file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t chunk[65536];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return !image.empty();
+}
+
+// Same power-on times on every run for a given node count
+uint64_t bootTime(uint32_t id, uint64_t spreadUs)
+{
+    uint64_t x = (uint64_t)id + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return spreadUs == 0 ? 0 : x % spreadUs;
+}
+
+} // namespace
+
+Fleet::~Fleet()
+{
+    // Tasks are joined before their code is unmapped
+    for(std::unique_ptr<Node> &node : nodes)
+    {
+        if(node->started)
+        {
+            node->api->stop();
+        }
+        if(node->library != nullptr)
+        {
+            dlclose(node->library);
+        }
+        if(node->imageFd >= 0)
+        {
+            close(node->imageFd);
+        }
+        if(node->log != nullptr)
+        {
+            fclose(node->log);
+        }
+    }
+}
+
+bool Fleet::loadNode(Node &node, const std::vector<uint8_t> &image, std::string &error)
+{
+    // The loader shares a module between dlopen calls of the same file, every node gets its own file
+    int fd = memfd_create("fleet_node", MFD_CLOEXEC);
+    if(fd < 0 || write(fd, image.data(), image.size()) != (ssize_t)image.size())
+    {
+        error = "cannot create a copy of the node module";
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    // The loader also matches modules by path, the descriptor stays open so no other node reuses it
+    node.imageFd = fd;
+    node.library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(node.library == nullptr)
+    {
+        error = dlerror();
+        return false;
+    }
+
+    FleetNodeApiFn entry = (FleetNodeApiFn)dlsym(node.library, "fleetNodeApi");
+    node.api = entry != nullptr ? entry() : nullptr;
+    if(node.api == nullptr || node.api->version != FLEET_NODE_API_VERSION)
+    {
+        error = "node module does not match this simulator";
+        return false;
+    }
+    return true;
+}
+
+bool Fleet::start(const FleetConfig &fleetConfig, std::string &error)
+{
+    config = fleetConfig;
+
+    std::vector<uint8_t> image;
+    if(!readImage(config.module, image))
+    {
+        error = "cannot read " + config.module;
+        return false;
+    }
+
+    buses.emplace_back(new SimBus("uart", SimBus::Access::COLLIDE, config.uartBaud, UART_BITS_PER_BYTE, 0,
+                                  config.nodes));
+    buses.emplace_back(new SimBus("smbus", SimBus::Access::ARBITRATE, config.smbusHz, SMBUS_BITS_PER_BYTE,
+                                  SMBUS_OVERHEAD_BITS, config.nodes));
+
+    for(size_t i = 0; i < config.nodes; i++)
+    {
+        nodes.emplace_back(new Node());
+        Node &node = *nodes.back();
+        node.fleet = this;
+        node.id = (uint32_t)i;
+        if(!loadNode(node, image, error))
+        {
+            return false;
+        }
+
+        if(!config.logDir.empty())
+        {
+            std::string path = config.logDir + "/node" + std::to_string(i) + ".log";
+            node.log = fopen(path.c_str(), "w");
+            if(node.log == nullptr)
+            {
+                error = "cannot write " + path;
+                return false;
+            }
+        }
+
+        node.bootUs = bootTime(node.id, config.bootSpreadUs);
+        node.nextWakeUs = node.bootUs;
+        FleetBusOps ops = { &node, transmit };
+        if(node.api->start(&ops, node.bootUs) != 0)
+        {
+            error = "firmware bring-up failed on node " + std::to_string(i);
+            return false;
+        }
+        node.started = true;
+    }
+
+    pool.reset(new WorkerPool(config.threads));
+    return true;
+}
+
+void Fleet::transmit(void *ctx, uint8_t bus, uint64_t timeUs, uint16_t address, const uint8_t *data, uint16_t length)
+{
+    // Runs on the node's task while its worker waits, nothing else touches the outbox
+    Node &node = *static_cast<Node *>(ctx);
+    if(bus < FLEET_BUS_COUNT)
+    {
+        std::shared_ptr<const std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>(data, data + length);
+        node.outbox[bus].push_back({ node.id, timeUs, address, bytes });
+    }
+}
+
+void Fleet::step(Node &node, uint64_t horizonUs)
+{
+    // Still powered off, its clock already stands at the power-on time
+    if(node.bootUs >= horizonUs)
+    {
+        return;
+    }
+
+    node.api->setBusBusy(FLEET_BUS_SMBUS, smbusBusyUntilUs);
+
+    for(const Event &event : node.inbox)
+    {
+        FleetEvent delivered = { event.bus, event.kind, 0, nullptr };
+        if(event.data != nullptr)
+        {
+            delivered.length = (uint16_t)event.data->size();
+            delivered.data = event.data->data();
+        }
+        node.api->deliver(&delivered);
+    }
+    node.inbox.clear();
+
+    node.api->run(horizonUs);
+    node.nextWakeUs = node.api->nextWakeUs();
+
+    if(node.log != nullptr)
+    {
+        char chunk[LOG_CHUNK];
+        size_t n;
+        while((n = node.api->readLog(chunk, sizeof(chunk))) > 0)
+        {
+            fwrite(chunk, 1, n, node.log);
+        }
+    }
+}
+
+void Fleet::settle(uint64_t horizonUs)
+{
+    for(size_t b = 0; b < buses.size(); b++)
+    {
+        // Node order breaks ties so the run does not depend on the worker scheduling
+        std::vector<BusFrame> started;
+        for(std::unique_ptr<Node> &node : nodes)
+        {
+            std::vector<BusFrame> &outbox = node->outbox[b];
+            started.insert(started.end(), outbox.begin(), outbox.end());
+            outbox.clear();
+        }
+        std::stable_sort(started.begin(), started.end(),
+                         [](const BusFrame &a, const BusFrame &b) { return a.requestUs < b.requestUs; });
+        for(BusFrame &frame : started)
+        {
+            buses[b]->submit(std::move(frame));
+        }
+
+        deliveries.clear();
+        buses[b]->advance(horizonUs, deliveries);
+        for(const BusDelivery &delivery : deliveries)
+        {
+            Event event = { (uint8_t)b, delivery.kind, delivery.data };
+            if(!delivery.broadcast)
+            {
+                nodes[delivery.node]->inbox.push_back(event);
+                continue;
+            }
+            for(std::unique_ptr<Node> &node : nodes)
+            {
+                if(node->id != delivery.node && node->bootUs < horizonUs)
+                {
+                    node->inbox.push_back(event);
+                }
+            }
+        }
+    }
+    smbusBusyUntilUs = buses[FLEET_BUS_SMBUS]->busyUntilUs();
+}
+
+void Fleet::run(uint64_t untilUs)
+{
+    std::vector<Node *> due;
+    while(now < untilUs)
+    {
+        uint64_t horizon = std::min(now + config.sliceUs, untilUs);
+
+        // Nodes with no task waking and no event pending catch up on a later slice
+        due.clear();
+        for(std::unique_ptr<Node> &node : nodes)
+        {
+            if(!node->inbox.empty() || node->nextWakeUs < horizon)
+            {
+                due.push_back(node.get());
+            }
+        }
+        pool->parallelFor(due.size(), [this, &due, horizon](size_t i) { step(*due[i], horizon); });
+        settle(horizon);
+        now = horizon;
+        sliceCount++;
+
+        // Skip whole slices in which no task wakes and no bus settles
+        uint64_t next = UINT64_MAX;
+        for(const std::unique_ptr<Node> &node : nodes)
+        {
+            next = std::min(next, node->inbox.empty() ? node->nextWakeUs : now);
+        }
+        for(const std::unique_ptr<SimBus> &bus : buses)
+        {
+            next = std::min(next, bus->nextSettleUs());
+        }
+        next = std::min(next, untilUs);
+        if(next > now + config.sliceUs)
+        {
+            now += (next - now) / config.sliceUs * config.sliceUs;
+        }
+    }
+
+    // Leave every clock at the fleet time
+    pool->parallelFor(nodes.size(), [this, untilUs](size_t i) { step(*nodes[i], untilUs); });
+}
+
+void Fleet::report(FILE *out, bool verbose) const
+{
+    double seconds = (double)now / 1e6;
+    for(const std::unique_ptr<SimBus> &bus : buses)
+    {
+        const BusStats &stats = bus->stats();
+        fprintf(out, "bus %-5s %llu frames, %llu collisions, %llu arbitration lost, %llu deferred, "
+                     "utilization %.1f%%, goodput %.0f B/s, latency avg %llu us max %llu us\n",
+                bus->name().c_str(), (unsigned long long)stats.frames, (unsigned long long)stats.collisions,
+                (unsigned long long)stats.arbitrationLost, (unsigned long long)stats.deferred,
+                now == 0 ? 0.0 : 100.0 * (double)stats.busyUs / (double)now,
+                seconds == 0 ? 0.0 : (double)stats.goodBytes / seconds,
+                (unsigned long long)stats.latency.averageUs(), (unsigned long long)stats.latency.maxUs);
+    }
+
+    for(const std::unique_ptr<SimBus> &bus : buses)
+    {
+        // Spread over the nodes, the fairness of the bus shows up as min/max
+        uint64_t minSent = UINT64_MAX, maxSent = 0, totalSent = 0;
+        uint64_t minLost = UINT64_MAX, maxLost = 0, totalLost = 0;
+        uint64_t maxLatency = 0, totalLatency = 0;
+        for(size_t i = 0; i < nodes.size(); i++)
+        {
+            const BusNodeStats &stats = bus->nodeStats(i);
+            minSent = std::min(minSent, stats.framesSent);
+            maxSent = std::max(maxSent, stats.framesSent);
+            totalSent += stats.framesSent;
+            minLost = std::min(minLost, stats.framesLost);
+            maxLost = std::max(maxLost, stats.framesLost);
+            totalLost += stats.framesLost;
+            maxLatency = std::max(maxLatency, stats.latency.maxUs);
+            totalLatency += stats.latency.averageUs();
+        }
+        size_t count = nodes.empty() ? 1 : nodes.size();
+        fprintf(out, "node %-5s sent min %llu avg %llu max %llu, lost min %llu avg %llu max %llu, "
+                     "latency avg %llu us max %llu us\n",
+                bus->name().c_str(), (unsigned long long)minSent, (unsigned long long)(totalSent / count),
+                (unsigned long long)maxSent, (unsigned long long)minLost, (unsigned long long)(totalLost / count),
+                (unsigned long long)maxLost, (unsigned long long)(totalLatency / count),
+                (unsigned long long)maxLatency);
+    }
+
+    if(!verbose)
+    {
+        return;
+    }
+    fprintf(out, "node   bus    sent  bytes  lost  deferred  received  rx-errors  latency-avg  latency-max\n");
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        for(const std::unique_ptr<SimBus> &bus : buses)
+        {
+            const BusNodeStats &stats = bus->nodeStats(i);
+            fprintf(out, "%4u   %-5s %5llu %6llu %5llu %9llu %9llu %10llu %9llu us %9llu us\n", (unsigned int)i,
+                    bus->name().c_str(), (unsigned long long)stats.framesSent, (unsigned long long)stats.bytesSent,
+                    (unsigned long long)stats.framesLost, (unsigned long long)stats.framesDeferred,
+                    (unsigned long long)stats.framesReceived, (unsigned long long)stats.receiveErrors,
+                    (unsigned long long)stats.latency.averageUs(), (unsigned long long)stats.latency.maxUs);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file           : fleet.h
+  * @brief          : Many firmware nodes on shared buses, stepped in parallel
+  ******************************************************************************
+  * Every node is a private copy of the firmware node module with its own
+  * virtual-time kernel. Nodes run in parallel on a worker pool one time
+  * slice at a time; between slices the buses settle the frames the nodes
+  * started and the resulting events are delivered at the slice boundary.
+  * Slices with nothing due anywhere are skipped, so quiet fleets advance
+  * at the pace of their next timer.
+  ******************************************************************************
+  */
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fleet_node_api.h"
+#include "sim_bus.h"
+#include "worker_pool.h"
+
+struct FleetConfig
+{
+    size_t nodes = 16;
+    size_t threads = 1;
+    uint64_t sliceUs = 100;         // Keep below a byte time so bus events are not reordered
+    uint64_t bootSpreadUs = 1000000;    // Nodes power on at spread times within this window
+    uint32_t uartBaud = 115200;
+    uint32_t smbusHz = 100000;
+    std::string module;             // Node module to load for every node
+    std::string logDir;             // Per-node firmware logs, empty to discard them
+};
+
+class Fleet
+{
+public:
+    Fleet() = default;
+    ~Fleet();
+    Fleet(const Fleet &) = delete;
+    Fleet &operator=(const Fleet &) = delete;
+
+    /**
+     * @brief Load and start every node
+     * @retval false with a message in error
+     */
+    bool start(const FleetConfig &config, std::string &error);
+
+    /**
+     * @brief Advance the whole fleet to untilUs
+     */
+    void run(uint64_t untilUs);
+
+    /**
+     * @brief Print bus totals and per-node figures, every node when verbose
+     */
+    void report(FILE *out, bool verbose) const;
+
+    uint64_t nowUs() const { return now; }
+    uint64_t slices() const { return sliceCount; }
+
+private:
+    struct Event
+    {
+        uint8_t bus;
+        uint8_t kind;
+        std::shared_ptr<const std::vector<uint8_t>> data;
+    };
+
+    struct Node
+    {
+        Fleet *fleet = nullptr;
+        uint32_t id = 0;
+        int imageFd = -1;
+        void *library = nullptr;
+        const FleetNodeApi *api = nullptr;
+        bool started = false;
+        FILE *log = nullptr;
+
+        std::vector<BusFrame> outbox[FLEET_BUS_COUNT];
+        std::vector<Event> inbox;
+        uint64_t bootUs = 0;
+        uint64_t nextWakeUs = 0;
+    };
+
+    static void transmit(void *ctx, uint8_t bus, uint64_t timeUs, uint16_t address, const uint8_t *data,
+                         uint16_t length);
+    bool loadNode(Node &node, const std::vector<uint8_t> &image, std::string &error);
+    void step(Node &node, uint64_t horizonUs);
+    void settle(uint64_t horizonUs);
+
+    FleetConfig config;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<std::unique_ptr<SimBus>> buses;
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<BusDelivery> deliveries;
+    uint64_t smbusBusyUntilUs = 0;
+    uint64_t now = 0;
+    uint64_t sliceCount = 0;
+};
+
+#endif /* FLEET_H */
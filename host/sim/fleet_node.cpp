@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file           : fleet_node.cpp
+  * @brief          : Firmware node module for the fleet simulator
+  ******************************************************************************
+  * Peripheral models of huart2 and hsmbus2 on the shared buses of the
+  * fleet. Transfers are handed to the simulator, which schedules the bus
+  * and answers with completion, reception and error events.
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include <memory>
+
+#include "SEGGER_RTT.h"
+#include "fleet_node_api.h"
+#include "sim_firmware.h"
+#include "sim_hal.h"
+
+extern "C" {
+// Routed to the drivers by hal_callbacks.cpp
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+}
+
+namespace {
+
+struct UartPort
+{
+    bool txBusy;
+    bool rxActive;
+    uint8_t *rxBuffer;
+    uint16_t rxSize;
+    uint16_t rxCount;
+    uint32_t error;
+};
+
+struct SmbusPort
+{
+    bool busy;
+    uint64_t busBusyUntilUs;
+};
+
+FleetBusOps busOps;
+std::unique_ptr<SimKernel> kernel;
+UartPort uart;
+SmbusPort smbus;
+
+void uartDeliver(const FleetEvent &event)
+{
+    switch(event.kind)
+    {
+    case FLEET_EVENT_TX_DONE:
+        uart.txBusy = false;
+        HAL_UART_TxCpltCallback(&huart2);
+        break;
+
+    case FLEET_EVENT_RX_DATA:
+    {
+        uint16_t room = uart.rxActive ? (uint16_t)(uart.rxSize - uart.rxCount) : 0;
+        uint16_t length = event.length < room ? event.length : room;
+        if(length > 0)
+        {
+            memcpy(uart.rxBuffer + uart.rxCount, event.data, length);
+            uart.rxCount += length;
+            uart.rxActive = uart.rxCount < uart.rxSize;
+        }
+        if(length < event.length)
+        {
+            // Bytes with no reception armed overrun the data register
+            uart.error |= HAL_UART_ERROR_ORE;
+            HAL_UART_ErrorCallback(&huart2);
+        }
+        break;
+    }
+
+    case FLEET_EVENT_RX_ERROR:
+        uart.error |= HAL_UART_ERROR_FE;
+        uart.rxActive = false;
+        HAL_UART_ErrorCallback(&huart2);
+        break;
+
+    default:
+        break;
+    }
+}
+
+int nodeStart(const FleetBusOps *ops, uint64_t bootUs)
+{
+    busOps = *ops;
+    memset(&uart, 0, sizeof(uart));
+    memset(&smbus, 0, sizeof(smbus));
+    kernel.reset(new SimKernel());
+
+    // Nothing is spawned yet, the clock just moves to the power-on time
+    kernel->run(bootUs);
+    return simFirmwareStart(*kernel) ? 0 : -1;
+}
+
+void nodeRun(uint64_t untilUs)
+{
+    kernel->run(untilUs);
+}
+
+uint64_t nodeNextWakeUs(void)
+{
+    return kernel->nextWakeUs();
+}
+
+void nodeDeliver(const FleetEvent *event)
+{
+    if(event->bus == FLEET_BUS_UART)
+    {
+        uartDeliver(*event);
+    }
+    else if(event->bus == FLEET_BUS_SMBUS)
+    {
+        // The firmware polls the SMBus status, a lost transfer just frees the port
+        smbus.busy = false;
+    }
+}
+
+void nodeSetBusBusy(uint8_t bus, uint64_t untilUs)
+{
+    if(bus == FLEET_BUS_SMBUS)
+    {
+        smbus.busBusyUntilUs = untilUs;
+    }
+}
+
+size_t nodeReadLog(char *buffer, size_t capacity)
+{
+    return SEGGER_RTT_ReadUpBufferNoLock(0, buffer, (unsigned)capacity);
+}
+
+void nodeStop(void)
+{
+    kernel.reset();
+    simSetKernel(nullptr);
+}
+
+const FleetNodeApi api = {
+    FLEET_NODE_API_VERSION,
+    nodeStart,
+    nodeRun,
+    nodeNextWakeUs,
+    nodeDeliver,
+    nodeSetBusBusy,
+    nodeReadLog,
+    nodeStop,
+};
+
+} // namespace
+
+extern "C" {
+
+__attribute__((visibility("default"))) const FleetNodeApi *fleetNodeApi(void)
+{
+    return &api;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if(huart != &huart2 || pData == NULL || Size == 0)
+    {
+        return HAL_ERROR;
+    }
+    if(uart.txBusy)
+    {
+        return HAL_BUSY;
+    }
+
+    uart.txBusy = true;
+    busOps.transmit(busOps.ctx, FLEET_BUS_UART, simKernel().nowUs(), 0, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if(huart != &huart2 || pData == NULL || Size == 0)
+    {
+        return HAL_ERROR;
+    }
+    if(uart.rxActive)
+    {
+        return HAL_BUSY;
+    }
+
+    uart.rxBuffer = pData;
+    uart.rxSize = Size;
+    uart.rxCount = 0;
+    uart.rxActive = true;
+    uart.error = HAL_UART_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    if(uart.txBusy && uart.rxActive)
+    {
+        return HAL_UART_STATE_BUSY_TX_RX;
+    }
+    if(uart.txBusy)
+    {
+        return HAL_UART_STATE_BUSY_TX;
+    }
+    return uart.rxActive ? HAL_UART_STATE_BUSY_RX : HAL_UART_STATE_READY;
+}
+
+uint32_t HAL_UART_GetError(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return uart.error;
+}
+
+HAL_StatusTypeDef HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbus, uint16_t DevAddress, uint8_t *pData,
+                                               uint16_t Size, uint32_t XferOptions)
+{
+    (void)XferOptions;
+    if(hsmbus != &hsmbus2 || pData == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    // Own transfer in flight, or another master seen on the bus
+    uint64_t now = simKernel().nowUs();
+    if(smbus.busy || smbus.busBusyUntilUs > now)
+    {
+        return HAL_BUSY;
+    }
+
+    smbus.busy = true;
+    busOps.transmit(busOps.ctx, FLEET_BUS_SMBUS, now, DevAddress, pData, Size);
+    return HAL_OK;
+}
+
+} // extern "C"
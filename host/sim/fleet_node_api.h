@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file           : fleet_node_api.h
+  * @brief          : Interface between the fleet simulator and a node module
+  ******************************************************************************
+  * A node module is the firmware linked with the simulation HAL into a
+  * shared object. Every node loads its own copy of the module, so the
+  * drivers' static state is per node, and drives it only through the
+  * table returned by fleetNodeApi().
+  *
+  * Bus transfers leave the node through FleetBusOps::transmit while one of
+  * its tasks runs; the simulator answers with events delivered between two
+  * runs, from the thread calling run(), the way interrupts would be.
+  ******************************************************************************
+  */
+
+#ifndef FLEET_NODE_API_H
+#define FLEET_NODE_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLEET_NODE_API_VERSION  1U
+
+typedef enum
+{
+    FLEET_BUS_UART = 0,         // Multi-drop line on huart2, everybody hears every frame
+    FLEET_BUS_SMBUS,            // Multi-master bus on hsmbus2
+    FLEET_BUS_COUNT
+} FleetBus;
+
+typedef enum
+{
+    FLEET_EVENT_TX_DONE = 0,    // Own frame left the bus
+    FLEET_EVENT_TX_LOST,        // Own frame lost arbitration
+    FLEET_EVENT_RX_DATA,        // Frame of another node received
+    FLEET_EVENT_RX_ERROR        // Frames collided on the line
+} FleetEventKind;
+
+typedef struct
+{
+    uint8_t bus;                // FleetBus
+    uint8_t kind;               // FleetEventKind
+    uint16_t length;
+    const uint8_t *data;        // RX_DATA bytes, valid during deliver()
+} FleetEvent;
+
+typedef struct
+{
+    void *ctx;
+    void (*transmit)(void *ctx, uint8_t bus, uint64_t timeUs, uint16_t address, const uint8_t *data, uint16_t length);
+} FleetBusOps;
+
+typedef struct
+{
+    uint32_t version;
+
+    /**
+     * @brief Bring the firmware up on a fresh kernel, powered on at bootUs
+     * @retval 0 on success
+     */
+    int (*start)(const FleetBusOps *ops, uint64_t bootUs);
+
+    /**
+     * @brief Run the tasks until virtual time reaches untilUs
+     */
+    void (*run)(uint64_t untilUs);
+
+    /**
+     * @brief Earliest time a task becomes ready, UINT64_MAX if none will on its own
+     */
+    uint64_t (*nextWakeUs)(void);
+
+    /**
+     * @brief Deliver a bus event at the current virtual time
+     */
+    void (*deliver)(const FleetEvent *event);
+
+    /**
+     * @brief Time until which the node sees the bus busy, as of the last bus update
+     */
+    void (*setBusBusy)(uint8_t bus, uint64_t untilUs);
+
+    /**
+     * @brief Read pending firmware log output
+     * @retval Bytes read
+     */
+    size_t (*readLog)(char *buffer, size_t capacity);
+
+    /**
+     * @brief Stop every task of the node
+     */
+    void (*stop)(void);
+} FleetNodeApi;
+
+typedef const FleetNodeApi *(*FleetNodeApiFn)(void);
+
+const FleetNodeApi *fleetNodeApi(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLEET_NODE_API_H */
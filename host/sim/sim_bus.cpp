@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file           : sim_bus.cpp
+  * @brief          : Shared bus models for the fleet simulator
+  ******************************************************************************
+  */
+
+#include "sim_bus.h"
+
+#include <algorithm>
+
+void LatencyStats::add(uint64_t us)
+{
+    count++;
+    totalUs += us;
+    if(us > maxUs)
+    {
+        maxUs = us;
+    }
+}
+
+SimBus::SimBus(const std::string &name, Access access, uint32_t bitRate, uint32_t bitsPerByte, uint32_t overheadBits,
+               size_t nodeCount)
+    : busName(name), access(access), bitRate(bitRate), bitsPerByte(bitsPerByte), overheadBits(overheadBits),
+      bitUs((1000000U + bitRate - 1U) / bitRate), nodes(nodeCount)
+{
+}
+
+uint64_t SimBus::durationUs(size_t bytes) const
+{
+    uint64_t bits = (uint64_t)bytes * bitsPerByte + overheadBits;
+    return (bits * 1000000U + bitRate - 1U) / bitRate;
+}
+
+void SimBus::submit(BusFrame frame)
+{
+    BusNodeStats &sender = nodes[frame.node];
+    sender.framesSent++;
+    sender.bytesSent += frame.data->size();
+    totals.frames++;
+
+    if(access == Access::ARBITRATE)
+    {
+        waiting.push_back(std::move(frame));
+        return;
+    }
+
+    Active entry = { std::move(frame), 0, 0, false };
+    entry.startUs = entry.frame.requestUs;
+    entry.endUs = entry.startUs + durationUs(entry.frame.data->size());
+    for(Active &other : active)
+    {
+        if(other.startUs < entry.endUs && entry.startUs < other.endUs)
+        {
+            other.collided = true;
+            entry.collided = true;
+        }
+    }
+
+    uint64_t from = std::max(entry.startUs, lastBusyEndUs);
+    if(entry.endUs > from)
+    {
+        totals.busyUs += entry.endUs - from;
+    }
+    lastBusyEndUs = std::max(lastBusyEndUs, entry.endUs);
+    active.push_back(std::move(entry));
+}
+
+void SimBus::complete(const Active &frame, uint64_t deliveredUs, std::vector<BusDelivery> &out)
+{
+    BusNodeStats &sender = nodes[frame.frame.node];
+    uint64_t latency = deliveredUs - frame.frame.requestUs;
+    sender.latency.add(latency);
+    totals.latency.add(latency);
+
+    // A UART sender cannot hear the collision, it completes either way
+    out.push_back({ frame.frame.node, false, FLEET_EVENT_TX_DONE, nullptr });
+    if(access == Access::ARBITRATE)
+    {
+        totals.goodBytes += frame.frame.data->size();
+        return;
+    }
+
+    if(frame.collided)
+    {
+        totals.collisions++;
+        sender.framesLost++;
+        out.push_back({ frame.frame.node, true, FLEET_EVENT_RX_ERROR, nullptr });
+    }
+    else
+    {
+        totals.goodBytes += frame.frame.data->size();
+        out.push_back({ frame.frame.node, true, FLEET_EVENT_RX_DATA, frame.frame.data });
+    }
+
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(i == frame.frame.node)
+        {
+            continue;
+        }
+        if(frame.collided)
+        {
+            nodes[i].receiveErrors++;
+        }
+        else
+        {
+            nodes[i].framesReceived++;
+        }
+    }
+}
+
+void SimBus::lose(const BusFrame &frame, uint64_t deliveredUs, std::vector<BusDelivery> &out)
+{
+    BusNodeStats &sender = nodes[frame.node];
+    sender.framesLost++;
+    sender.latency.add(deliveredUs - frame.requestUs);
+    totals.arbitrationLost++;
+    out.push_back({ frame.node, false, FLEET_EVENT_TX_LOST, nullptr });
+}
+
+void SimBus::advanceCollide(uint64_t horizonUs, std::vector<BusDelivery> &out)
+{
+    // Every frame that could still overlap a frame ending by the horizon has been submitted
+    size_t kept = 0;
+    for(size_t i = 0; i < active.size(); i++)
+    {
+        if(active[i].endUs <= horizonUs)
+        {
+            complete(active[i], horizonUs, out);
+        }
+        else
+        {
+            active[kept++] = std::move(active[i]);
+        }
+    }
+    active.resize(kept);
+}
+
+void SimBus::advanceArbitrate(uint64_t horizonUs, std::vector<BusDelivery> &out)
+{
+    for(;;)
+    {
+        if(!active.empty())
+        {
+            if(active.front().endUs > horizonUs)
+            {
+                break;
+            }
+            complete(active.front(), horizonUs, out);
+            active.clear();
+        }
+        if(waiting.empty())
+        {
+            break;
+        }
+
+        // A master requesting later within the same bit time could still join the arbitration
+        uint64_t startUs = std::max(freeAtUs, waiting.front().requestUs);
+        if(startUs + bitUs > horizonUs)
+        {
+            break;
+        }
+
+        size_t contenders = 0;
+        size_t winner = 0;
+        while(contenders < waiting.size() && waiting[contenders].requestUs < startUs + bitUs)
+        {
+            if(waiting[contenders].node < waiting[winner].node)
+            {
+                winner = contenders;
+            }
+            contenders++;
+        }
+
+        for(size_t i = 0; i < contenders; i++)
+        {
+            if(waiting[i].requestUs < startUs)
+            {
+                totals.deferred++;
+                nodes[waiting[i].node].framesDeferred++;
+            }
+            if(i != winner)
+            {
+                lose(waiting[i], horizonUs, out);
+            }
+        }
+
+        Active owner = { waiting[winner], startUs, startUs + durationUs(waiting[winner].data->size()), false };
+        waiting.erase(waiting.begin(), waiting.begin() + (ptrdiff_t)contenders);
+        totals.busyUs += owner.endUs - owner.startUs;
+        freeAtUs = owner.endUs;
+        lastBusyEndUs = owner.endUs;
+        active.push_back(std::move(owner));
+    }
+}
+
+void SimBus::advance(uint64_t horizonUs, std::vector<BusDelivery> &out)
+{
+    if(access == Access::COLLIDE)
+    {
+        advanceCollide(horizonUs, out);
+    }
+    else
+    {
+        advanceArbitrate(horizonUs, out);
+    }
+}
+
+uint64_t SimBus::busyUntilUs() const
+{
+    return lastBusyEndUs;
+}
+
+uint64_t SimBus::nextSettleUs() const
+{
+    uint64_t next = UINT64_MAX;
+    for(const Active &frame : active)
+    {
+        next = std::min(next, frame.endUs);
+    }
+    if(active.empty() && !waiting.empty())
+    {
+        next = std::max(freeAtUs, waiting.front().requestUs) + bitUs;
+    }
+    return next;
+}
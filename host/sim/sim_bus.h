@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * @file           : sim_bus.h
+  * @brief          : Shared bus models for the fleet simulator
+  ******************************************************************************
+  * A bus takes the frames the nodes started during a time slice and decides
+  * what happened to them once nothing started later can change the outcome:
+  *
+  *  - COLLIDE (multi-drop UART): a frame occupies the line for its bit
+  *    time; frames that overlap corrupt each other, every other node gets a
+  *    framing error instead of the data. The sender cannot tell.
+  *  - ARBITRATE (SMBus): a master starting while another one owns the bus
+  *    waits for the stop condition; masters starting within the same bit
+  *    time arbitrate and only the lowest node id keeps the bus.
+  *
+  * Outcomes are decided at slice boundaries, so events reach the nodes up
+  * to one slice after the frame ended on the wire.
+  ******************************************************************************
+  */
+
+#ifndef SIM_BUS_H
+#define SIM_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fleet_node_api.h"
+
+struct BusFrame
+{
+    uint32_t node;
+    uint64_t requestUs;
+    uint16_t address;
+    std::shared_ptr<const std::vector<uint8_t>> data;
+};
+
+struct BusDelivery
+{
+    uint32_t node;              // Target, or every node but this one for RX events
+    bool broadcast;
+    uint8_t kind;               // FleetEventKind
+    std::shared_ptr<const std::vector<uint8_t>> data;
+};
+
+struct LatencyStats
+{
+    uint64_t count = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+
+    void add(uint64_t us);
+    uint64_t averageUs() const { return count == 0 ? 0 : totalUs / count; }
+};
+
+struct BusNodeStats
+{
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t framesLost = 0;            // Collided or lost arbitration
+    uint64_t framesDeferred = 0;        // Waited for another master
+    uint64_t framesReceived = 0;
+    uint64_t receiveErrors = 0;
+    LatencyStats latency;               // Start request to the sender's completion event
+};
+
+struct BusStats
+{
+    uint64_t frames = 0;
+    uint64_t goodBytes = 0;
+    uint64_t collisions = 0;            // Frames corrupted on the line
+    uint64_t arbitrationLost = 0;
+    uint64_t deferred = 0;
+    uint64_t busyUs = 0;                // Time at least one frame was on the bus
+    LatencyStats latency;
+};
+
+class SimBus
+{
+public:
+    enum class Access { COLLIDE, ARBITRATE };
+
+    /**
+     * @param bitsPerByte 10 for 8N1 UART, 9 for SMBus with the acknowledge
+     * @param overheadBits Per frame: start, address byte and stop on SMBus
+     */
+    SimBus(const std::string &name, Access access, uint32_t bitRate, uint32_t bitsPerByte, uint32_t overheadBits,
+           size_t nodeCount);
+
+    /**
+     * @brief Frames started in the slice, in start time order
+     */
+    void submit(BusFrame frame);
+
+    /**
+     * @brief Settle every frame whose outcome is known at horizonUs
+     */
+    void advance(uint64_t horizonUs, std::vector<BusDelivery> &out);
+
+    /**
+     * @brief End of the bus activity known so far, what nodes see as busy
+     */
+    uint64_t busyUntilUs() const;
+
+    /**
+     * @brief Earliest horizon at which advance() settles something, UINT64_MAX if idle
+     */
+    uint64_t nextSettleUs() const;
+
+    const std::string &name() const { return busName; }
+    const BusStats &stats() const { return totals; }
+    const BusNodeStats &nodeStats(size_t node) const { return nodes[node]; }
+
+private:
+    struct Active
+    {
+        BusFrame frame;
+        uint64_t startUs;
+        uint64_t endUs;
+        bool collided;
+    };
+
+    uint64_t durationUs(size_t bytes) const;
+    void advanceCollide(uint64_t horizonUs, std::vector<BusDelivery> &out);
+    void advanceArbitrate(uint64_t horizonUs, std::vector<BusDelivery> &out);
+    void complete(const Active &frame, uint64_t deliveredUs, std::vector<BusDelivery> &out);
+    void lose(const BusFrame &frame, uint64_t deliveredUs, std::vector<BusDelivery> &out);
+
+    std::string busName;
+    Access access;
+    uint32_t bitRate;
+    uint32_t bitsPerByte;
+    uint32_t overheadBits;
+    uint64_t bitUs;
+
+    std::vector<Active> active;         // On the wire, not settled
+    std::vector<BusFrame> waiting;      // Arbitrated buses: not started yet
+    uint64_t freeAtUs = 0;              // Arbitrated buses: end of the owner's frame
+    uint64_t lastBusyEndUs = 0;
+
+    BusStats totals;
+    std::vector<BusNodeStats> nodes;
+};
+
+#endif /* SIM_BUS_H */
@@ -0,0 +1,38 @@
+/**
+  ******************************************************************************
+  * @file           : sim_firmware.cpp
+  * @brief          : Firmware bring-up for host simulation builds
+  ******************************************************************************
+  */
+
+#include "sim_firmware.h"
+
+#include "freertos_tasks.h"
+#include "logging.h"
+#include "power_manager.h"
+#include "sim_hal.h"
+#include "work_queue.h"
+
+namespace {
+
+constexpr uint32_t TASK_PRIORITY = 2;       // tskIDLE_PRIORITY + 2 on the board
+
+} // namespace
+
+bool simFirmwareStart(SimKernel &kernel)
+{
+    simSetKernel(&kernel);
+
+    initLogging();
+    powerManagerInit((1UL << POWER_CLOCK_USART2) | (1UL << POWER_CLOCK_I2C2), (1UL << POWER_DOMAIN_VDDIO2));
+    if(workQueueInit() != HAL_OK)
+    {
+        return false;
+    }
+
+    kernel.spawn("smbusTask", TASK_PRIORITY, []() { smbusTask(nullptr); });
+    kernel.spawn("uartTask", TASK_PRIORITY, []() { uartTask(nullptr); });
+
+    powerManagerGateUnused();
+    return true;
+}
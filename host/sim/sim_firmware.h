@@ -0,0 +1,23 @@
+/**
+  ******************************************************************************
+  * @file           : sim_firmware.h
+  * @brief          : Firmware bring-up for host simulation builds
+  ******************************************************************************
+  * Mirrors USER CODE 2 of the board's main(): logging, power bookkeeping,
+  * the work queue and the application tasks, created on a SimKernel
+  * instead of FreeRTOS.
+  ******************************************************************************
+  */
+
+#ifndef SIM_FIRMWARE_H
+#define SIM_FIRMWARE_H
+
+#include "sim_kernel.h"
+
+/**
+ * @brief Start the firmware on a kernel, the tasks first run with the kernel
+ * @retval false if a driver failed to initialize
+ */
+bool simFirmwareStart(SimKernel &kernel);
+
+#endif /* SIM_FIRMWARE_H */
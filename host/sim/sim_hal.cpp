@@ -0,0 +1,136 @@
+/**
+  ******************************************************************************
+  * @file           : sim_hal.cpp
+  * @brief          : Platform layer of hal_types.h for host simulation builds
+  ******************************************************************************
+  */
+
+#include "sim_hal.h"
+
+#include <stdint.h>
+
+namespace {
+
+constexpr uint32_t CYCLES_PER_US = SIM_CORE_CLOCK_HZ / 1000000U;
+constexpr uint32_t WAIT_FOREVER = 0xFFFFFFFFU;
+
+SimKernel *defaultKernel = nullptr;
+
+} // namespace
+
+UART_HandleTypeDef huart2 = { 2 };
+SMBUS_HandleTypeDef hsmbus2 = { 2 };
+
+void simSetKernel(SimKernel *kernel)
+{
+    defaultKernel = kernel;
+}
+
+SimKernel &simKernel()
+{
+    SimKernel *kernel = SimKernel::current();
+    return kernel != nullptr ? *kernel : *defaultKernel;
+}
+
+UART_HandleTypeDef *simUartHandle(uint8_t port)
+{
+    return port == huart2.port ? &huart2 : nullptr;
+}
+
+SMBUS_HandleTypeDef *simSmbusHandle(uint8_t port)
+{
+    return port == hsmbus2.port ? &hsmbus2 : nullptr;
+}
+
+extern "C" {
+
+void HAL_Delay_MS(uint32_t ms)
+{
+    simKernel().sleepUs((uint64_t)ms * 1000U);
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(simKernel().nowUs() / 1000U);
+}
+
+void HAL_EnableCycleCounter(void)
+{
+}
+
+uint32_t HAL_GetCycleCount(void)
+{
+    return (uint32_t)(simKernel().nowUs() * CYCLES_PER_US);
+}
+
+uint32_t HAL_GetIdleCycles(void)
+{
+    return (uint32_t)(simKernel().idleUs() * CYCLES_PER_US);
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return SIM_CORE_CLOCK_HZ;
+}
+
+// Only one task runs at a time and interrupts are delivered between tasks
+uint32_t HAL_CriticalEnter(void)
+{
+    return 0;
+}
+
+void HAL_CriticalExit(uint32_t state)
+{
+    (void)state;
+}
+
+HAL_StatusTypeDef HAL_WorkerCreate(void (*entry)(void *arg), void *arg, const char *name,
+                                   uint32_t stackWords, uint32_t priority, void **handle)
+{
+    (void)stackWords;
+    int id = simKernel().spawn(name, priority, [entry, arg]() { entry(arg); });
+    *handle = (void *)(intptr_t)(id + 1);
+    return HAL_OK;
+}
+
+void HAL_WorkerNotify(void *handle)
+{
+    simKernel().notify((int)(intptr_t)handle - 1);
+}
+
+void HAL_WorkerWait(uint32_t timeoutMs)
+{
+    simKernel().waitNotify(timeoutMs == WAIT_FOREVER ? SimKernel::FOREVER : (uint64_t)timeoutMs * 1000U);
+}
+
+void HAL_PeriphClockEnable(uint32_t clock)
+{
+    (void)clock;
+}
+
+void HAL_PeriphClockDisable(uint32_t clock)
+{
+    (void)clock;
+}
+
+void HAL_PowerDomainEnable(uint32_t domain)
+{
+    (void)domain;
+}
+
+void HAL_PowerDomainDisable(uint32_t domain)
+{
+    (void)domain;
+}
+
+void HAL_EnterStopMode(uint32_t depth)
+{
+    (void)depth;
+}
+
+void HAL_ExitStopMode(uint32_t depth)
+{
+    (void)depth;
+}
+
+} // extern "C"
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file           : sim_hal.h
+  * @brief          : Platform layer of hal_types.h for host simulation builds
+  ******************************************************************************
+  * Provides the functions the board normally implements (time, critical
+  * sections, worker tasks, clock gating) on top of a SimKernel, and the
+  * peripheral handles the firmware refers to. Peripheral transfers are left
+  * to a model such as the trace replay.
+  *
+  * These definitions must be linked as objects, not from an archive, so
+  * they take precedence over the weak fallbacks in the app libraries.
+  ******************************************************************************
+  */
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+
+#include "hal_types.h"
+#include "sim_kernel.h"
+
+#define SIM_CORE_CLOCK_HZ   160000000U
+#define SIM_MAX_PORTS       16U
+
+// The firmware only passes handles around, on the host they carry the instance number
+struct UART_HandleTypeDef
+{
+    uint8_t port;
+};
+
+struct SMBUS_HandleTypeDef
+{
+    uint8_t port;
+};
+
+/**
+ * @brief Kernel serving the HAL calls made outside of any task (initialization)
+ */
+void simSetKernel(SimKernel *kernel);
+
+/**
+ * @brief Kernel of the calling task, or the one set with simSetKernel
+ */
+SimKernel &simKernel();
+
+/**
+ * @brief Firmware handle of a peripheral instance
+ * @retval nullptr if the firmware has no such handle
+ */
+UART_HandleTypeDef *simUartHandle(uint8_t port);
+SMBUS_HandleTypeDef *simSmbusHandle(uint8_t port);
+
+#endif /* SIM_HAL_H */
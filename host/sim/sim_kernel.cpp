@@ -0,0 +1,232 @@
+/**
+  ******************************************************************************
+  * @file           : sim_kernel.cpp
+  * @brief          : Virtual-time task scheduler for running firmware on the host
+  ******************************************************************************
+  */
+
+#include "sim_kernel.h"
+
+namespace {
+
+thread_local SimKernel *currentKernel = nullptr;
+thread_local int currentId = -1;
+
+} // namespace
+
+SimKernel::~SimKernel()
+{
+    shutdown();
+}
+
+SimKernel *SimKernel::current()
+{
+    return currentKernel;
+}
+
+int SimKernel::currentTask()
+{
+    return currentId;
+}
+
+int SimKernel::spawn(const std::string &name, uint32_t priority, std::function<void()> entry)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    int id = (int)tasks.size();
+    tasks.emplace_back(new Task());
+    Task &task = *tasks.back();
+    task.name = name;
+    task.priority = priority;
+    task.entry = std::move(entry);
+    task.wakeUs = now;
+    task.thread = std::thread(&SimKernel::taskMain, this, id);
+    return id;
+}
+
+void SimKernel::taskMain(int id)
+{
+    currentKernel = this;
+    currentId = id;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    Task &task = *tasks[id];
+    task.turn.wait(lock, [&]() { return running == id || unwinding; });
+
+    if(!unwinding)
+    {
+        lock.unlock();
+        try
+        {
+            task.entry();
+        }
+        catch(const SimStopped &)
+        {
+        }
+        lock.lock();
+    }
+
+    task.state = State::DONE;
+    running = -1;
+    kernelTurn.notify_one();
+}
+
+void SimKernel::block(std::unique_lock<std::mutex> &lock, int id)
+{
+    Task &task = *tasks[id];
+    task.state = State::BLOCKED;
+    running = -1;
+    kernelTurn.notify_one();
+    task.turn.wait(lock, [&]() { return running == id || unwinding; });
+    if(unwinding)
+    {
+        throw SimStopped();
+    }
+}
+
+void SimKernel::sleepUs(uint64_t us)
+{
+    int id = currentId;
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks[id]->wakeUs = now + us;
+    tasks[id]->waitingNotify = false;
+    block(lock, id);
+}
+
+bool SimKernel::waitNotify(uint64_t timeoutUs)
+{
+    int id = currentId;
+    std::unique_lock<std::mutex> lock(mutex);
+    Task &task = *tasks[id];
+    if(task.notified)
+    {
+        task.notified = false;
+        return true;
+    }
+
+    task.wakeUs = timeoutUs == FOREVER ? FOREVER : now + timeoutUs;
+    task.waitingNotify = true;
+    block(lock, id);
+    task.waitingNotify = false;
+
+    bool notified = task.notified;
+    task.notified = false;
+    return notified;
+}
+
+void SimKernel::notify(int id)
+{
+    // Called by the running task, or by run()'s thread between switches
+    std::unique_lock<std::mutex> lock(mutex);
+    if(id >= 0 && (size_t)id < tasks.size())
+    {
+        Task &task = *tasks[id];
+        task.notified = true;
+        if(task.waitingNotify)
+        {
+            task.wakeUs = now;
+        }
+    }
+}
+
+int SimKernel::pickReady()
+{
+    int best = -1;
+    for(size_t i = 0; i < tasks.size(); i++)
+    {
+        const Task &task = *tasks[i];
+        if(task.state == State::DONE || task.wakeUs > now)
+        {
+            continue;
+        }
+        if(best < 0 || task.priority > tasks[best]->priority)
+        {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+uint64_t SimKernel::nextWakeUs()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return earliestWake();
+}
+
+uint64_t SimKernel::earliestWake() const
+{
+    uint64_t wake = FOREVER;
+    for(const std::unique_ptr<Task> &task : tasks)
+    {
+        if(task->state != State::DONE && task->wakeUs < wake)
+        {
+            wake = task->wakeUs;
+        }
+    }
+    return wake;
+}
+
+bool SimKernel::run(uint64_t untilUs)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    stopRequested = false;
+
+    for(;;)
+    {
+        if(stopRequested)
+        {
+            return false;
+        }
+
+        int next = pickReady();
+        if(next < 0)
+        {
+            // Nothing ready: jump to the earliest wake-up
+            uint64_t wake = earliestWake();
+            if(wake == FOREVER || wake > untilUs)
+            {
+                if(untilUs != FOREVER && untilUs > now)
+                {
+                    idle += untilUs - now;
+                    now = untilUs;
+                }
+                return true;
+            }
+            idle += wake - now;
+            now = wake;
+            continue;
+        }
+
+        Task &task = *tasks[next];
+        task.state = State::READY;
+        running = next;
+        switchCount++;
+        task.turn.notify_one();
+        kernelTurn.wait(lock, [&]() { return running == -1; });
+
+        if(stepHook)
+        {
+            lock.unlock();
+            stepHook();
+            lock.lock();
+        }
+    }
+}
+
+void SimKernel::shutdown()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        unwinding = true;
+        for(std::unique_ptr<Task> &task : tasks)
+        {
+            task->turn.notify_one();
+        }
+    }
+    for(std::unique_ptr<Task> &task : tasks)
+    {
+        if(task->thread.joinable())
+        {
+            task->thread.join();
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file           : sim_kernel.h
+  * @brief          : Virtual-time task scheduler for running firmware on the host
+  ******************************************************************************
+  * Each firmware task runs on its own host thread, but only one of them runs
+  * at a time: the kernel hands a baton to the highest-priority task that is
+  * ready and waits for it to block again (delay, notification wait or
+  * return). Code between blocking calls takes no virtual time, and virtual
+  * time jumps straight to the next wake-up when nothing is ready, so a run
+  * is deterministic and as fast as the host allows.
+  *
+  * Task code reaches its kernel through SimKernel::current(). Stopping the
+  * kernel unwinds every task from its blocking call with SimStopped.
+  ******************************************************************************
+  */
+
+#ifndef SIM_KERNEL_H
+#define SIM_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimStopped
+{
+};
+
+class SimKernel
+{
+public:
+    static constexpr uint64_t FOREVER = UINT64_MAX;
+
+    SimKernel() = default;
+    ~SimKernel();
+    SimKernel(const SimKernel &) = delete;
+    SimKernel &operator=(const SimKernel &) = delete;
+
+    /**
+     * @brief Create a task, it first runs once the kernel does
+     * @param priority Higher runs first among ready tasks
+     * @retval Task id
+     */
+    int spawn(const std::string &name, uint32_t priority, std::function<void()> entry);
+
+    /**
+     * @brief Run tasks until virtual time reaches untilUs, every task returned or stop() was called
+     * @retval false if stopped
+     */
+    bool run(uint64_t untilUs);
+
+    /**
+     * @brief Ask run() to return after the running task blocks, safe from task code
+     */
+    void stop() { stopRequested = true; }
+
+    /**
+     * @brief Called after every task switch, from the thread calling run()
+     */
+    void setStepHook(std::function<void()> hook) { stepHook = std::move(hook); }
+
+    uint64_t nowUs() const { return now; }
+
+    /**
+     * @brief Earliest time a task becomes ready, FOREVER if every task waits for a notification
+     */
+    uint64_t nextWakeUs();
+
+    uint64_t idleUs() const { return idle; }
+    uint64_t switches() const { return switchCount; }
+
+    // Task side, from code running under this kernel
+
+    static SimKernel *current();
+    static int currentTask();
+
+    void sleepUs(uint64_t us);
+
+    /**
+     * @brief Block until notified or the timeout expires
+     * @retval true if notified
+     */
+    bool waitNotify(uint64_t timeoutUs);
+
+    void notify(int task);
+
+private:
+    enum class State { READY, BLOCKED, DONE };
+
+    struct Task
+    {
+        std::string name;
+        uint32_t priority;
+        std::function<void()> entry;
+        std::thread thread;
+        State state = State::READY;
+        uint64_t wakeUs = 0;
+        bool waitingNotify = false;
+        bool notified = false;
+        std::condition_variable turn;
+    };
+
+    void taskMain(int id);
+    void block(std::unique_lock<std::mutex> &lock, int id);
+    int pickReady();
+    uint64_t earliestWake() const;
+    void shutdown();
+
+    std::mutex mutex;
+    std::condition_variable kernelTurn;
+    std::vector<std::unique_ptr<Task>> tasks;
+    int running = -1;
+    bool unwinding = false;
+    bool stopRequested = false;
+
+    uint64_t now = 0;
+    uint64_t idle = 0;
+    uint64_t switchCount = 0;
+    std::function<void()> stepHook;
+};
+
+#endif /* SIM_KERNEL_H */
@@ -0,0 +1,337 @@
+/**
+  ******************************************************************************
+  * @file           : trace_replay.cpp
+  * @brief          : Peripheral model answering HAL calls from a recorded trace
+  ******************************************************************************
+  */
+
+#include "trace_replay.h"
+
+#include <string.h>
+
+extern "C" {
+// Routed to the drivers by hal_callbacks.cpp
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+}
+
+namespace {
+
+TraceReplay *active = nullptr;
+
+} // namespace
+
+bool TraceReplay::load(const std::vector<uint8_t> &trace)
+{
+    // Decoded events point into the copy
+    storage = trace;
+    TraceDecoder decoder;
+    if(!decoder.attach(storage.data(), storage.size()))
+    {
+        return false;
+    }
+
+    TraceEvent event;
+    while(decoder.next(event))
+    {
+        endUs = event.timeUs;
+        if(event.kind == TRACE_DROPPED)
+        {
+            dropped += event.value;
+        }
+        else if(event.kind == TRACE_SPAN_START || event.kind == TRACE_SPAN_END)
+        {
+            // Request spans are for tracespans, the replay regenerates its own
+            continue;
+        }
+        else if(event.kind == TRACE_SMBUS_TX)
+        {
+            smbus[event.port].events.push_back(event);
+        }
+        else
+        {
+            ports[event.port].events.push_back(event);
+        }
+    }
+    return !decoder.malformed();
+}
+
+void TraceReplay::recordTo(std::vector<uint8_t> *out)
+{
+    recording = out;
+    encoder.reset();
+    if(recording != nullptr)
+    {
+        recording->assign(TRACE_MAGIC, TRACE_MAGIC + TRACE_MAGIC_SIZE);
+    }
+}
+
+bool TraceReplay::isInterrupt(TraceKind kind)
+{
+    return kind == TRACE_UART_TX_DONE || kind == TRACE_UART_ERROR || kind == TRACE_UART_RX_EVENT;
+}
+
+bool TraceReplay::isCall(TraceKind kind)
+{
+    return kind == TRACE_UART_TX || kind == TRACE_UART_RX || kind == TRACE_UART_STATE || kind == TRACE_SMBUS_TX;
+}
+
+bool TraceReplay::finished() const
+{
+    for(size_t i = 0; i < SIM_MAX_PORTS; i++)
+    {
+        for(const Port *port : { &ports[i], &smbus[i] })
+        {
+            for(size_t e = port->cursor; e < port->events.size(); e++)
+            {
+                if(isCall(port->events[e].kind))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void TraceReplay::deliver(Port &port, const TraceEvent &event)
+{
+    UART_HandleTypeDef *handle = simUartHandle(event.port);
+    port.result.interrupts++;
+    record(event.kind, event.port, 0, event.value, 0, nullptr);
+    if(handle == nullptr)
+    {
+        return;
+    }
+
+    switch(event.kind)
+    {
+    case TRACE_UART_TX_DONE:
+        HAL_UART_TxCpltCallback(handle);
+        break;
+    case TRACE_UART_ERROR:
+        port.lastError = event.value;
+        HAL_UART_ErrorCallback(handle);
+        break;
+    case TRACE_UART_RX_EVENT:
+        HAL_UARTEx_RxEventCallback(handle, (uint16_t)event.value);
+        break;
+    default:
+        break;
+    }
+}
+
+const TraceEvent *TraceReplay::take(Port &port, bool isSmbus, TraceKind kind)
+{
+    (void)isSmbus;
+
+    // Find the next recorded call of this kind within the look-ahead window
+    size_t found = port.events.size();
+    size_t calls = 0;
+    for(size_t i = port.cursor; i < port.events.size() && calls <= LOOKAHEAD; i++)
+    {
+        TraceKind recorded = port.events[i].kind;
+        if(recorded == kind)
+        {
+            found = i;
+            break;
+        }
+        if(isCall(recorded))
+        {
+            calls++;
+        }
+    }
+
+    if(found == port.events.size())
+    {
+        // The firmware made a call the field unit did not
+        port.result.divergences++;
+        return nullptr;
+    }
+
+    // Interrupts that happened before the call are delivered, calls the firmware skipped are counted
+    for(size_t i = port.cursor; i < found; i++)
+    {
+        const TraceEvent &skipped = port.events[i];
+        if(isInterrupt(skipped.kind))
+        {
+            deliver(port, skipped);
+        }
+        else if(isCall(skipped.kind))
+        {
+            port.result.divergences++;
+        }
+    }
+    port.cursor = found + 1U;
+
+    const TraceEvent &event = port.events[found];
+    uint64_t now = simKernel().nowUs();
+    uint64_t drift = now > event.timeUs ? now - event.timeUs : event.timeUs - now;
+    port.result.calls++;
+    port.result.driftTotalUs += drift;
+    if(drift > port.result.driftMaxUs)
+    {
+        port.result.driftMaxUs = drift;
+    }
+    return &event;
+}
+
+void TraceReplay::record(TraceKind kind, uint8_t port, uint8_t status, uint32_t value, uint32_t length,
+                         const uint8_t *data)
+{
+    if(recording == nullptr)
+    {
+        return;
+    }
+
+    TraceEvent event = {};
+    event.kind = kind;
+    event.port = port;
+    event.timeUs = simKernel().nowUs();
+    event.status = status;
+    event.value = value;
+    event.length = length;
+    event.data = data;
+
+    std::vector<uint8_t> out(TRACE_EVENT_MAX_HEADER + length);
+    size_t n = encoder.encode(event, out.data(), out.size());
+    recording->insert(recording->end(), out.begin(), out.begin() + (ptrdiff_t)n);
+}
+
+HAL_StatusTypeDef TraceReplay::uartTransmit(uint8_t port, uint16_t size)
+{
+    Port &target = ports[port & 0x0FU];
+    const TraceEvent *event = take(target, false, TRACE_UART_TX);
+    HAL_StatusTypeDef status = event != nullptr ? (HAL_StatusTypeDef)event->status : HAL_OK;
+    if(event != nullptr && event->value != size)
+    {
+        target.result.mismatches++;
+    }
+
+    record(TRACE_UART_TX, port, (uint8_t)status, size, 0, nullptr);
+    return status;
+}
+
+HAL_StatusTypeDef TraceReplay::uartReceive(uint8_t port, uint8_t *buffer, uint16_t size)
+{
+    Port &target = ports[port & 0x0FU];
+    const TraceEvent *event = take(target, false, TRACE_UART_RX);
+    HAL_StatusTypeDef status = event != nullptr ? (HAL_StatusTypeDef)event->status : HAL_OK;
+    if(event != nullptr && event->value != size)
+    {
+        target.result.mismatches++;
+    }
+
+    target.rxBuffer = status == HAL_OK ? buffer : nullptr;
+    target.rxSize = status == HAL_OK ? size : 0;
+    record(TRACE_UART_RX, port, (uint8_t)status, size, 0, nullptr);
+    return status;
+}
+
+HAL_UART_StateTypeDef TraceReplay::uartState(uint8_t port)
+{
+    Port &target = ports[port & 0x0FU];
+    const TraceEvent *event = take(target, false, TRACE_UART_STATE);
+    if(event != nullptr)
+    {
+        target.lastState = (HAL_UART_StateTypeDef)event->status;
+    }
+    record(TRACE_UART_STATE, port, (uint8_t)target.lastState, 0, 0, nullptr);
+
+    // The bytes the field unit read after this state, delivered into the pending reception
+    size_t offset = 0;
+    while(event != nullptr && target.cursor < target.events.size() &&
+          target.events[target.cursor].kind == TRACE_UART_DATA)
+    {
+        const TraceEvent &data = target.events[target.cursor++];
+        if(target.rxBuffer != nullptr && offset < target.rxSize)
+        {
+            size_t length = data.length < target.rxSize - offset ? data.length : target.rxSize - offset;
+            memcpy(target.rxBuffer + offset, data.data, length);
+            record(TRACE_UART_DATA, port, 0, 0, (uint32_t)length, target.rxBuffer + offset);
+            offset += length;
+        }
+    }
+    if(offset > 0 || target.lastState == HAL_UART_STATE_READY)
+    {
+        target.rxBuffer = nullptr;
+        target.rxSize = 0;
+    }
+    return target.lastState;
+}
+
+HAL_StatusTypeDef TraceReplay::smbusTransmit(uint8_t port, uint16_t address, uint16_t size)
+{
+    Port &target = smbus[port & 0x0FU];
+    const TraceEvent *event = take(target, true, TRACE_SMBUS_TX);
+    HAL_StatusTypeDef status = event != nullptr ? (HAL_StatusTypeDef)event->status : HAL_OK;
+    if(event != nullptr && (event->value != address || event->length != size))
+    {
+        target.result.mismatches++;
+    }
+
+    record(TRACE_SMBUS_TX, port, (uint8_t)status, address, size, nullptr);
+    return status;
+}
+
+void TraceReplay::report(FILE *out) const
+{
+    for(size_t i = 0; i < SIM_MAX_PORTS; i++)
+    {
+        const char *names[] = { "uart", "smbus" };
+        const Port *list[] = { &ports[i], &smbus[i] };
+        for(size_t k = 0; k < 2; k++)
+        {
+            const Port &port = *list[k];
+            if(port.events.empty())
+            {
+                continue;
+            }
+            const PortReport &r = port.result;
+            fprintf(out, "%s%u: %u calls, %u interrupts, %u divergences, %u mismatches, drift avg %llu us max %llu us\n",
+                    names[k], (unsigned int)i, (unsigned int)r.calls, (unsigned int)r.interrupts,
+                    (unsigned int)r.divergences, (unsigned int)r.mismatches,
+                    (unsigned long long)(r.calls == 0 ? 0 : r.driftTotalUs / r.calls),
+                    (unsigned long long)r.driftMaxUs);
+        }
+    }
+}
+
+void replaySetActive(TraceReplay *replay)
+{
+    active = replay;
+}
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)pData;
+    return active != nullptr ? active->uartTransmit(huart->port, Size) : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    return active != nullptr ? active->uartReceive(huart->port, pData, Size) : HAL_ERROR;
+}
+
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    return active != nullptr ? active->uartState(huart->port) : HAL_UART_STATE_RESET;
+}
+
+uint32_t HAL_UART_GetError(UART_HandleTypeDef *huart)
+{
+    return active != nullptr ? active->uartError(huart->port) : HAL_UART_ERROR_NONE;
+}
+
+HAL_StatusTypeDef HAL_SMBUS_Master_Transmit_IT(SMBUS_HandleTypeDef *hsmbus, uint16_t DevAddress, uint8_t *pData,
+                                               uint16_t Size, uint32_t XferOptions)
+{
+    (void)pData;
+    (void)XferOptions;
+    return active != nullptr ? active->smbusTransmit(hsmbus->port, DevAddress, Size) : HAL_ERROR;
+}
+
+} // extern "C"
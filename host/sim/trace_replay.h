@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file           : trace_replay.h
+  * @brief          : Peripheral model answering HAL calls from a recorded trace
+  ******************************************************************************
+  * Every HAL call the firmware makes on a port takes the next recorded call
+  * of the same kind and returns what the device returned in the field:
+  * status, UART state and the bytes a reception delivered. Interrupt events
+  * recorded before that call (transmit complete, errors, receive events)
+  * are delivered to the HAL callbacks first, in their recorded order.
+  *
+  * A firmware that behaves differently from the recorded one is resynced by
+  * looking a few calls ahead; skipped and unmatched calls are counted as
+  * divergences. The call times of the replay are compared with the recorded
+  * ones and the replay can itself be recorded, so two firmware versions can
+  * be run on the same field trace and their traces compared.
+  ******************************************************************************
+  */
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "hal_types.h"
+#include "sim_hal.h"
+#include "trace_codec.h"
+
+class TraceReplay
+{
+public:
+    static constexpr size_t LOOKAHEAD = 16;     // Recorded calls searched when resyncing
+
+    struct PortReport
+    {
+        uint32_t calls = 0;             // Firmware calls matched to the trace
+        uint32_t interrupts = 0;        // Interrupt events delivered
+        uint32_t divergences = 0;       // Calls the trace or the firmware did not have
+        uint32_t mismatches = 0;        // Matched calls with other lengths or addresses
+        uint64_t driftTotalUs = 0;      // Sum of |replay time - recorded time|
+        uint64_t driftMaxUs = 0;
+    };
+
+    /**
+     * @brief Decode a whole trace
+     * @retval false if the trace is not valid, events up to the damage are kept
+     */
+    bool load(const std::vector<uint8_t> &trace);
+
+    /**
+     * @brief Record the calls of the replay into out, in the trace format
+     */
+    void recordTo(std::vector<uint8_t> *out);
+
+    /**
+     * @brief Every recorded call has been replayed or skipped
+     */
+    bool finished() const;
+
+    uint32_t droppedInTrace() const { return dropped; }
+    uint64_t recordedEndUs() const { return endUs; }
+
+    /**
+     * @brief Print per-port results
+     */
+    void report(FILE *out) const;
+
+    // HAL side
+    HAL_StatusTypeDef uartTransmit(uint8_t port, uint16_t size);
+    HAL_StatusTypeDef uartReceive(uint8_t port, uint8_t *buffer, uint16_t size);
+    HAL_UART_StateTypeDef uartState(uint8_t port);
+    uint32_t uartError(uint8_t port) const { return ports[port & 0x0FU].lastError; }
+    HAL_StatusTypeDef smbusTransmit(uint8_t port, uint16_t address, uint16_t size);
+
+private:
+    struct Port
+    {
+        std::vector<TraceEvent> events;
+        size_t cursor = 0;
+
+        uint8_t *rxBuffer = nullptr;
+        uint16_t rxSize = 0;
+        uint32_t lastError = 0;
+        HAL_UART_StateTypeDef lastState = HAL_UART_STATE_READY;
+        PortReport result;
+    };
+
+    static bool isInterrupt(TraceKind kind);
+    static bool isCall(TraceKind kind);
+    const TraceEvent *take(Port &port, bool smbus, TraceKind kind);
+    void deliver(Port &port, const TraceEvent &event);
+    void record(TraceKind kind, uint8_t port, uint8_t status, uint32_t value, uint32_t length,
+                const uint8_t *data);
+
+    std::vector<uint8_t> storage;
+    Port ports[SIM_MAX_PORTS];          // UART ports
+    Port smbus[SIM_MAX_PORTS];
+    uint32_t dropped = 0;
+    uint64_t endUs = 0;
+
+    std::vector<uint8_t> *recording = nullptr;
+    TraceEncoder encoder;
+};
+
+/**
+ * @brief Route the UART and SMBus HAL functions to a replay
+ */
+void replaySetActive(TraceReplay *replay);
+
+#endif /* TRACE_REPLAY_H */
@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @file           : tracereplay.cpp
+  * @brief          : Runs the firmware tasks on the host against a field trace
+  ******************************************************************************
+  * usage: tracereplay dump <trace>
+  *        tracereplay run <trace> [-o out] [-l] [-t seconds]
+  *
+  * dump prints the events of a trace captured from RTT channel 1 of a
+  * PERIPHERAL_TRACE build. run boots the firmware tasks in virtual time,
+  * answers their UART and SMBus calls from the trace and reports per port
+  * how closely the firmware followed the recording. -o records the replay
+  * itself, -l prints the firmware log, -t stops after that much virtual time
+  * (by default the run ends with the trace).
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "SEGGER_RTT.h"
+#include "sim_firmware.h"
+#include "sim_kernel.h"
+#include "trace_codec.h"
+#include "trace_replay.h"
+
+namespace {
+
+constexpr uint64_t SLACK_US = 1000000;      // Run past the end of the trace for late calls
+
+bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "tracereplay: cannot open %s\n", path);
+        return false;
+    }
+
+    uint8_t chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+bool writeFile(const char *path, const std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "wb");
+    if(file == nullptr || fwrite(data.data(), 1, data.size(), file) != data.size())
+    {
+        fprintf(stderr, "tracereplay: cannot write %s\n", path);
+        if(file != nullptr)
+        {
+            fclose(file);
+        }
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+int dump(const std::vector<uint8_t> &trace)
+{
+    TraceDecoder decoder;
+    if(!decoder.attach(trace.data(), trace.size()))
+    {
+        fprintf(stderr, "tracereplay: not a peripheral trace\n");
+        return 1;
+    }
+
+    TraceEvent event;
+    while(decoder.next(event))
+    {
+        printf("%12llu us  port %u  %-12s status %u  value %u  length %u",
+               (unsigned long long)event.timeUs, (unsigned int)event.port, traceKindName(event.kind),
+               (unsigned int)event.status, (unsigned int)event.value, (unsigned int)event.length);
+        if(event.kind == TRACE_UART_DATA)
+        {
+            printf("  ");
+            for(uint32_t i = 0; i < event.length; i++)
+            {
+                printf("%02x", event.data[i]);
+            }
+        }
+        printf("\n");
+    }
+
+    if(decoder.malformed())
+    {
+        fprintf(stderr, "tracereplay: trace damaged at offset %zu\n", decoder.offset());
+        return 1;
+    }
+    return 0;
+}
+
+void drainLog()
+{
+    char chunk[256];
+    unsigned n;
+    while((n = SEGGER_RTT_ReadUpBufferNoLock(0, chunk, sizeof(chunk))) > 0)
+    {
+        fwrite(chunk, 1, n, stdout);
+    }
+}
+
+int run(const std::vector<uint8_t> &trace, const char *outPath, bool showLog, uint64_t limitUs)
+{
+    TraceReplay replay;
+    if(!replay.load(trace))
+    {
+        fprintf(stderr, "tracereplay: trace damaged, replaying the events before the damage\n");
+    }
+    if(replay.droppedInTrace() > 0)
+    {
+        fprintf(stderr, "tracereplay: %u events were dropped while recording\n", (unsigned int)replay.droppedInTrace());
+    }
+
+    std::vector<uint8_t> recorded;
+    if(outPath != nullptr)
+    {
+        replay.recordTo(&recorded);
+    }
+
+    SimKernel kernel;
+    replaySetActive(&replay);
+    if(!simFirmwareStart(kernel))
+    {
+        fprintf(stderr, "tracereplay: firmware bring-up failed\n");
+        replaySetActive(nullptr);
+        return 1;
+    }
+
+    kernel.setStepHook([&]() {
+        if(showLog)
+        {
+            drainLog();
+        }
+        if(replay.finished())
+        {
+            kernel.stop();
+        }
+    });
+
+    uint64_t untilUs = limitUs != 0 ? limitUs : replay.recordedEndUs() + SLACK_US;
+    auto start = std::chrono::steady_clock::now();
+    bool completed = !kernel.run(untilUs) || replay.finished();
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if(showLog)
+    {
+        drainLog();
+    }
+
+    printf("virtual time %.3f s (trace %.3f s), host %.1f ms, %llu task switches\n",
+           (double)kernel.nowUs() / 1e6, (double)replay.recordedEndUs() / 1e6, wallMs,
+           (unsigned long long)kernel.switches());
+    replay.report(stdout);
+    if(!completed)
+    {
+        printf("trace not fully replayed\n");
+    }
+
+    replaySetActive(nullptr);
+    if(outPath != nullptr && !writeFile(outPath, recorded))
+    {
+        return 1;
+    }
+    return completed ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 3 || (strcmp(argv[1], "dump") != 0 && strcmp(argv[1], "run") != 0))
+    {
+        fprintf(stderr, "usage: tracereplay dump <trace>\n"
+                        "       tracereplay run <trace> [-o out] [-l] [-t seconds]\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> trace;
+    if(!readFile(argv[2], trace))
+    {
+        return 1;
+    }
+    if(strcmp(argv[1], "dump") == 0)
+    {
+        return dump(trace);
+    }
+
+    const char *outPath = nullptr;
+    bool showLog = false;
+    uint64_t limitUs = 0;
+    for(int i = 3; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-l") == 0)
+        {
+            showLog = true;
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            limitUs = (uint64_t)(strtod(argv[++i], nullptr) * 1e6);
+        }
+        else
+        {
+            fprintf(stderr, "tracereplay: unknown option '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+
+    return run(trace, outPath, showLog, limitUs);
+}
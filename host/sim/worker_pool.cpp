@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : worker_pool.cpp
+  * @brief          : Fixed set of host threads running indexed jobs in parallel
+  ******************************************************************************
+  */
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    for(size_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&WorkerPool::workerMain, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        exiting = true;
+    }
+    start.notify_all();
+    for(std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::drain(const std::function<void(size_t)> &job, size_t count)
+{
+    for(size_t i = nextJob.fetch_add(1); i < count; i = nextJob.fetch_add(1))
+    {
+        job(i);
+    }
+}
+
+void WorkerPool::workerMain()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;)
+    {
+        start.wait(lock, [&]() { return exiting || generation != seen; });
+        if(exiting)
+        {
+            return;
+        }
+        seen = generation;
+
+        // A worker waking after the round ended finds no jobs left
+        if(jobCount == 0)
+        {
+            continue;
+        }
+        const std::function<void(size_t)> &job = *current;
+        size_t count = jobCount;
+        busy++;
+        lock.unlock();
+        drain(job, count);
+        lock.lock();
+        if(--busy == 0)
+        {
+            done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        current = &job;
+        jobCount = count;
+        nextJob.store(0);
+        generation++;
+    }
+    if(count > 1)
+    {
+        start.notify_all();
+    }
+
+    drain(job, count);
+
+    // Workers that picked up this round hold busy until they ran out of jobs
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return busy == 0; });
+    current = nullptr;
+    jobCount = 0;
+}
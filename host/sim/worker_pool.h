@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : worker_pool.h
+  * @brief          : Fixed set of host threads running indexed jobs in parallel
+  ******************************************************************************
+  */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+    /**
+     * @param threads Host threads including the caller, at least one
+     */
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief Call job(i) for every i below count and wait for all of them, the caller takes part
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &job);
+
+    size_t threads() const { return workers.size() + 1U; }
+
+private:
+    void workerMain();
+    void drain(const std::function<void(size_t)> &job, size_t count);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    const std::function<void(size_t)> *current = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextJob{0};
+    size_t busy = 0;
+    uint64_t generation = 0;
+    bool exiting = false;
+};
+
+#endif /* WORKER_POOL_H */
@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file           : span_waterfall.cpp
+  * @brief          : Per-request waterfalls from the span events of a trace
+  ******************************************************************************
+  */
+
+#include "span_waterfall.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t OTHER = TRACE_SPAN_STAGES;     // Summary row for time outside the inner stages
+
+double ms(uint64_t us)
+{
+    return (double)us / 1000.0;
+}
+
+uint64_t percentile(std::vector<uint64_t> &sorted, unsigned p)
+{
+    if(sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = (sorted.size() - 1U) * p / 100U;
+    return sorted[index];
+}
+
+} // namespace
+
+uint64_t SpanWaterfall::Request::otherUs() const
+{
+    uint64_t inner = 0;
+    for(size_t s = TRACE_SPAN_REQUEST + 1U; s < TRACE_SPAN_STAGES; s++)
+    {
+        inner += stages[s].durationUs();
+    }
+    return totalUs() > inner ? totalUs() - inner : 0;
+}
+
+bool SpanWaterfall::load(const uint8_t *trace, size_t size)
+{
+    TraceDecoder decoder;
+    if(!decoder.attach(trace, size))
+    {
+        return false;
+    }
+
+    // Ids wrap, so a start of a closed request opens a new one
+    std::unordered_map<uint32_t, size_t> open;
+    TraceEvent event;
+    while(decoder.next(event))
+    {
+        if(event.kind == TRACE_DROPPED)
+        {
+            droppedEvents += event.value;
+            continue;
+        }
+        if((event.kind != TRACE_SPAN_START && event.kind != TRACE_SPAN_END) || event.port >= TRACE_SPAN_STAGES)
+        {
+            continue;
+        }
+
+        auto found = open.find(event.value);
+        if(event.kind == TRACE_SPAN_START)
+        {
+            if(found == open.end() || (event.port == TRACE_SPAN_REQUEST && list[found->second].complete()))
+            {
+                Request request;
+                request.id = event.value;
+                list.push_back(request);
+                found = open.insert_or_assign(event.value, list.size() - 1U).first;
+            }
+            Stage &stage = list[found->second].stages[event.port];
+            stage.started = true;
+            stage.ended = false;
+            stage.startUs = event.timeUs;
+            continue;
+        }
+
+        if(found == open.end() || !list[found->second].stages[event.port].started)
+        {
+            unmatchedEnds++;
+            continue;
+        }
+        Stage &stage = list[found->second].stages[event.port];
+        stage.ended = true;
+        stage.endUs = event.timeUs;
+        stage.status = event.status;
+    }
+    return !decoder.malformed();
+}
+
+void SpanWaterfall::printSummary(FILE *out) const
+{
+    std::vector<uint64_t> durations[TRACE_SPAN_STAGES + 1U];
+    uint64_t totals[TRACE_SPAN_STAGES + 1U] = {};
+    uint32_t failures[TRACE_SPAN_STAGES] = {};
+    size_t incomplete = 0;
+
+    for(const Request &request : list)
+    {
+        if(!request.complete())
+        {
+            incomplete++;
+            continue;
+        }
+        for(size_t s = 0; s < TRACE_SPAN_STAGES; s++)
+        {
+            const Stage &stage = request.stages[s];
+            if(stage.started && stage.ended)
+            {
+                durations[s].push_back(stage.durationUs());
+                totals[s] += stage.durationUs();
+                failures[s] += stage.status != 0 ? 1U : 0U;
+            }
+        }
+        durations[OTHER].push_back(request.otherUs());
+        totals[OTHER] += request.otherUs();
+    }
+
+    fprintf(out, "%zu requests, %zu incomplete, %u unmatched ends, %u events dropped while recording\n",
+            list.size(), incomplete, (unsigned int)unmatchedEnds, (unsigned int)droppedEvents);
+    fprintf(out, "%-8s %7s %10s %10s %10s %10s %7s %7s\n", "stage", "count", "avg ms", "p50 ms", "p95 ms", "max ms",
+            "share", "failed");
+
+    uint64_t whole = totals[TRACE_SPAN_REQUEST];
+    for(size_t s = 0; s <= OTHER; s++)
+    {
+        std::vector<uint64_t> &d = durations[s];
+        std::sort(d.begin(), d.end());
+        fprintf(out, "%-8s %7zu %10.3f %10.3f %10.3f %10.3f %6.1f%% %7u\n",
+                s == OTHER ? "other" : traceSpanName((uint8_t)s), d.size(),
+                d.empty() ? 0.0 : ms(totals[s]) / (double)d.size(), ms(percentile(d, 50)), ms(percentile(d, 95)),
+                ms(d.empty() ? 0 : d.back()), whole == 0 ? 0.0 : 100.0 * (double)totals[s] / (double)whole,
+                s == OTHER ? 0U : (unsigned int)failures[s]);
+    }
+}
+
+void SpanWaterfall::printWaterfall(FILE *out, const Request &request, unsigned width) const
+{
+    const Stage &whole = request.stages[TRACE_SPAN_REQUEST];
+    uint64_t origin = whole.started ? whole.startUs : UINT64_MAX;
+    uint64_t end = whole.ended ? whole.endUs : 0;
+    for(const Stage &stage : request.stages)
+    {
+        if(stage.started)
+        {
+            origin = std::min(origin, stage.startUs);
+            end = std::max(end, stage.ended ? stage.endUs : stage.startUs);
+        }
+    }
+    if(origin == UINT64_MAX)
+    {
+        return;
+    }
+
+    uint64_t span = end > origin ? end - origin : 1U;
+    fprintf(out, "request %u at %.6f s: %.3f ms%s\n", (unsigned int)request.id, (double)origin / 1e6, ms(end - origin),
+            request.complete() ? "" : " (incomplete)");
+
+    for(size_t s = 0; s < TRACE_SPAN_STAGES; s++)
+    {
+        const Stage &stage = request.stages[s];
+        if(!stage.started)
+        {
+            continue;
+        }
+
+        uint64_t stop = stage.ended ? stage.endUs : end;
+        unsigned first = std::min(width - 1U, (unsigned)((stage.startUs - origin) * width / span));
+        unsigned last = (unsigned)((stop - origin) * width / span);
+        std::string bar(width, ' ');
+        for(unsigned c = first; c < width && (c < last || c == first); c++)
+        {
+            bar[c] = stage.ended ? '#' : '?';
+        }
+
+        fprintf(out, "  %-8s |%s| %9.3f +%9.3f ms%s\n", traceSpanName((uint8_t)s), bar.c_str(),
+                ms(stage.startUs - origin), ms(stop - stage.startUs),
+                stage.ended && stage.status != 0 ? "  failed" : "");
+    }
+}
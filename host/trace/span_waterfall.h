@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file           : span_waterfall.h
+  * @brief          : Per-request waterfalls from the span events of a trace
+  ******************************************************************************
+  * Groups the SPAN_START and SPAN_END events of a peripheral trace by
+  * correlation id into requests, one interval per stage, and breaks the
+  * request latency down by stage: how long commands wait for the SMBus
+  * task, how long the bus takes and how long the reply waits for the UART
+  * task. Time spent in none of the inner stages is reported as "other".
+  ******************************************************************************
+  */
+
+#ifndef SPAN_WATERFALL_H
+#define SPAN_WATERFALL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "trace_codec.h"
+
+class SpanWaterfall
+{
+public:
+    struct Stage
+    {
+        bool started = false;
+        bool ended = false;
+        uint64_t startUs = 0;
+        uint64_t endUs = 0;
+        uint8_t status = 0;         // HAL status at the end
+
+        uint64_t durationUs() const { return started && ended && endUs > startUs ? endUs - startUs : 0; }
+    };
+
+    struct Request
+    {
+        uint32_t id = 0;
+        Stage stages[TRACE_SPAN_STAGES];
+
+        // The request span has both ends
+        bool complete() const { return stages[TRACE_SPAN_REQUEST].started && stages[TRACE_SPAN_REQUEST].ended; }
+        uint64_t totalUs() const { return stages[TRACE_SPAN_REQUEST].durationUs(); }
+        uint64_t otherUs() const;
+    };
+
+    /**
+     * @brief Collect the spans of a whole trace
+     * @retval false if the trace is not valid, spans up to the damage are kept
+     */
+    bool load(const uint8_t *trace, size_t size);
+
+    const std::vector<Request> &requests() const { return list; }
+    uint32_t dropped() const { return droppedEvents; }
+    uint32_t unmatched() const { return unmatchedEnds; }
+
+    /**
+     * @brief Count, mean, percentiles and share of the latency per stage
+     */
+    void printSummary(FILE *out) const;
+
+    /**
+     * @brief One bar per stage, scaled to the request
+     * @param width Characters for the whole request
+     */
+    void printWaterfall(FILE *out, const Request &request, unsigned width) const;
+
+private:
+    std::vector<Request> list;
+    uint32_t droppedEvents = 0;
+    uint32_t unmatchedEnds = 0;         // Ends without a start, lost to drops or the capture start
+};
+
+#endif /* SPAN_WATERFALL_H */
@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file           : tracespans.cpp
+  * @brief          : Request waterfalls and latency breakdown from a trace
+  ******************************************************************************
+  * usage: tracespans <trace> [-n count] [-a] [-w width]
+  *
+  * Reads a trace captured from RTT channel 1 and prints the latency of host
+  * requests per stage (count, average, p50, p95, maximum and share of the
+  * total), then the waterfalls of the slowest requests, or with -a of all
+  * requests in arrival order. -n limits the waterfalls (10 by default,
+  * 0 for none), -w sets the bar width.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "span_waterfall.h"
+
+namespace {
+
+bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "tracespans: cannot open %s\n", path);
+        return false;
+    }
+
+    uint8_t chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: tracespans <trace> [-n count] [-a] [-w width]\n");
+        return 2;
+    }
+
+    size_t count = 10;
+    bool arrivalOrder = false;
+    unsigned width = 60;
+    for(int i = 2; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "-a") == 0)
+        {
+            arrivalOrder = true;
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            width = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            fprintf(stderr, "tracespans: unknown option '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+    if(width < 10U)
+    {
+        fprintf(stderr, "tracespans: width must be at least 10\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> trace;
+    if(!readFile(argv[1], trace))
+    {
+        return 1;
+    }
+
+    SpanWaterfall waterfall;
+    bool intact = waterfall.load(trace.data(), trace.size());
+    if(!intact)
+    {
+        fprintf(stderr, "tracespans: trace damaged, using the spans before the damage\n");
+    }
+    if(waterfall.requests().empty())
+    {
+        fprintf(stderr, "tracespans: no request spans in the trace\n");
+        return intact ? 0 : 1;
+    }
+
+    waterfall.printSummary(stdout);
+
+    std::vector<const SpanWaterfall::Request *> shown;
+    for(const SpanWaterfall::Request &request : waterfall.requests())
+    {
+        shown.push_back(&request);
+    }
+    if(!arrivalOrder)
+    {
+        std::stable_sort(shown.begin(), shown.end(), [](const SpanWaterfall::Request *a, const SpanWaterfall::Request *b) {
+            return a->totalUs() > b->totalUs();
+        });
+    }
+
+    for(size_t i = 0; i < shown.size() && i < count; i++)
+    {
+        printf("\n");
+        waterfall.printWaterfall(stdout, *shown[i], width);
+    }
+    return intact ? 0 : 1;
+}